@@ -10,6 +10,8 @@ include $(CLEAR_VARS)
 LOCAL_SRC_FILES:= \
     CameraHal.cpp \
     CameraHal_Utils.cpp \
+    CaptureBufferRing.cpp \
+    FW3AStatusService.cpp \
     MessageQueue.cpp \
     
 LOCAL_SHARED_LIBRARIES:= \
@@ -119,6 +121,26 @@ endif
 
 ################################################
 
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    FW3AStatusService.cpp \
+    FW3AStatusTest.cpp
+
+LOCAL_STATIC_LIBRARIES := \
+    libutils \
+    libcutils
+
+LOCAL_LDLIBS += -lpthread
+
+LOCAL_MODULE := FW3AStatusTest
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+################################################
+
 
 endif
 endif
@@ -118,6 +118,8 @@ CameraHal::CameraHal(int cameraId)
                      mCaptureRunning(0),
 #ifdef FW3A
                      fobj(NULL),
+                     m3AStatusReader(NULL),
+                     m3AStatus(NULL),
 #endif
                      file_index(0),
                      mflash(2),
@@ -179,11 +181,6 @@ CameraHal::CameraHal(int cameraId)
         mVideoBufferStatus[i] = BUFF_IDLE;
     }
 
-    for (i = 0; i < MAX_BURST; i++) {
-        mYuvBuffer[i] = 0;
-        mYuvBufferLen[i] = 0;
-    }
-
     CameraCreate();
 
     initDefaultParameters();
@@ -694,12 +691,11 @@ void CameraHal::previewThread()
 #ifdef FW3A
 
             if ( isStart_FW3A_AF ) {
-                err = ICam_ReadStatus(fobj->hnd, &fobj->status);
-                //ICAM_AF_STATUS_IDLE is the state when AF algorithm is not working,
-                //but waiting for the lens to go to start position.
-                //In this case, AF is running, so we are waiting for AF to finish like
-                //in ICAM_AF_STATUS_RUNNING state.
-                if ( (err == 0) && ( ICAM_AF_STATUS_RUNNING != fobj->status.af.status ) && ( ICAM_AF_STATUS_IDLE != fobj->status.af.status ) ) {
+                //The 3A status thread raises the focus event once AF leaves
+                //the running and idle (lens moving to start position) states.
+                if ( m3AStatus->takeEvents(FW3A_EVENT_FOCUS) ) {
+                    FW3AStatusSnapshot status3A;
+                    m3AStatus->getSnapshot(&status3A);
 
 #if PPM_INSTRUMENTATION || PPM_INSTRUMENTATION_ABS
 
@@ -707,14 +703,17 @@ void CameraHal::previewThread()
 
 #endif
 
-                    ICam_ReadMakerNote(fobj->hnd, &fobj->mnote);
+                    {
+                        Mutex::Autolock lock(m3AReadLock);
+                        ICam_ReadMakerNote(fobj->hnd, &fobj->mnote);
+                    }
 
                     if (FW3A_Stop_AF() < 0){
                         LOGE("ERROR FW3A_Stop_AF()");
                     }
 
                     bool focus_flag;
-                    if ( fobj->status.af.status == ICAM_AF_STATUS_SUCCESS ) {
+                    if ( FW3A_FOCUS_SUCCESS == status3A.focusState ) {
                         focus_flag = true;
                         LOGE("AF Success");
                     } else {
@@ -1095,6 +1094,10 @@ void CameraHal::previewThread()
                     }
 
 #ifdef FW3A
+                   // The status reads below share the 3A handle with the
+                   // polling thread
+                   m3AStatus->stop();
+
                    if( (flg_AF = FW3A_Stop_AF()) < 0){
                         LOGE("ERROR FW3A_Stop_AF()");
                         err = -1;
@@ -1623,7 +1626,6 @@ void CameraHal::nextPreview()
 {
     static int frame_count = 0;
     int zoom_inc, err;
-    struct timeval lowLightTime;
 
     //Zoom
     frame_count++;
@@ -1669,40 +1671,16 @@ void CameraHal::nextPreview()
 
 #ifdef FW3A
     if (isStart_FW3A != 0){
-    //Low light notification
-    if( ( fobj->settings.ae.framerate == 0 ) && ( ( frame_count % 10) == 0 ) ) {
-#if ( PPM_INSTRUMENTATION || PPM_INSTRUMENTATION_ABS ) && DEBUG_LOG
-
-        gettimeofday(&lowLightTime, NULL);
-
-#endif
-        err = ICam_ReadStatus(fobj->hnd, &fobj->status);
-        if (err == 0) {
-            if (fobj->status.ae.camera_shake == ICAM_SHAKE_HIGH_RISK2) {
-
-                //Avoid segfault. mParameters may be used somewhere else, e.g. in SetParameters()
-                {
-                    Mutex::Autolock lock(mLock);
-                    mParameters.set("low-light", "1");
-                }
-
-            } else {
-
-                //Avoid segfault. mParameters may be used somewhere else, e.g. in SetParameters()
-                {
-                    Mutex::Autolock lock(mLock);
-                    mParameters.set("low-light", "0");
-                }
-
-            }
-         }
-
-#if ( PPM_INSTRUMENTATION || PPM_INSTRUMENTATION_ABS ) && DEBUG_LOG
-
-        PPM("Low-light delay", &lowLightTime);
-
-#endif
+    //Low light notification, only when the 3A status thread saw a change
+    if( ( fobj->settings.ae.framerate == 0 ) && m3AStatus->takeEvents(FW3A_EVENT_LOW_LIGHT) ) {
+        FW3AStatusSnapshot status3A;
+        m3AStatus->getSnapshot(&status3A);
 
+        //Avoid segfault. mParameters may be used somewhere else, e.g. in SetParameters()
+        {
+            Mutex::Autolock lock(mLock);
+            mParameters.set("low-light", status3A.lowLight ? "1" : "0");
+        }
     }
     }
 #endif
@@ -1781,6 +1759,7 @@ int  CameraHal::ICapturePerform()
             rawMessage[RAW_THREAD_NUM_ARGS];
     int pixelFormat;
     exif_buffer *exif_buf;
+    int slot, queuedShots, ringCapacity;
     mode = ICAP_PROCESS_MODE_CONTINUOUS;
 
 #ifdef DEBUG_LOG
@@ -1961,14 +1940,24 @@ int  CameraHal::ICapturePerform()
         goto fail_config;
     }
 
-    allocatePictureBuffers(spec_res.buffer_size, mBurstShots);
+    ringCapacity = allocatePictureBuffers(spec_res.buffer_size, mBurstShots);
+    if ( 0 >= ringCapacity ) {
+        LOGE("Capture ring allocation failed");
+        goto fail_config;
+    }
 
-    for ( int i = 0; i < mBurstShots; i++ ) {
-        capture_buffer.buffer = (void *) NEXT_4K_ALIGN_ADDR((unsigned int) mYuvBuffer[i]);
+    mCaptureRing.beginBurst(mBurstShots);
+
+    // Queue at most one ring worth of buffers up front, the rest of the
+    // burst reuses slots as soon as the encoder side recycles them.
+    queuedShots = ( mBurstShots < ringCapacity ) ? mBurstShots : ringCapacity;
+    for ( int i = 0; i < queuedShots; i++ ) {
+        slot = mCaptureRing.acquire(true);
+        capture_buffer.buffer = (void *) NEXT_4K_ALIGN_ADDR((unsigned int) mCaptureRing.getBuffer(slot));
         capture_buffer.alloc_size = spec_res.buffer_size;
 
-        LOGE ("ICapture push buffer 0x%x, len %d",
-                ( unsigned int ) capture_buffer.buffer, capture_buffer.alloc_size);
+        LOGE ("ICapture push buffer 0x%x, len %d, slot %d",
+                ( unsigned int ) capture_buffer.buffer, capture_buffer.alloc_size, slot);
         status = icap_push_buffer(iobj->lib_private, &capture_buffer, &snapshotBuffer);
         if( ICAP_STATUS_FAIL == status){
             LOGE ("ICapture push buffer function failed");
@@ -2028,9 +2017,9 @@ int  CameraHal::ICapturePerform()
     if(FD_ISSET(snapshotReadyPipe[0], &descriptorSet))
         read(snapshotReadyPipe[0], &snapshotReadyMessage, sizeof(snapshotReadyMessage));
 
-    }
-
-    for ( int i = 0; i < mBurstShots; i++ ) {
+    // ICapture fills the queued buffers in order
+    slot = mCaptureRing.getOldest(CaptureBufferRing::OWNER_SENSOR);
+    mCaptureRing.transfer(slot, CaptureBufferRing::OWNER_SENSOR, CaptureBufferRing::OWNER_IPP);
 
 #if PPM_INSTRUMENTATION || PPM_INSTRUMENTATION_ABS
 
@@ -2081,8 +2070,9 @@ int  CameraHal::ICapturePerform()
     }
 #endif
 
-    procMessage[PROC_MSG_IDX_YUV_BUFF] = (unsigned int) mYuvBuffer[i];
-    procMessage[PROC_MSG_IDX_YUV_BUFFLEN] = mYuvBufferLen[i];
+    procMessage[PROC_MSG_IDX_YUV_BUFF] = (unsigned int) mCaptureRing.getBuffer(slot);
+    procMessage[PROC_MSG_IDX_YUV_BUFFLEN] = mCaptureRing.getLength(slot);
+    procMessage[PROC_MSG_IDX_RING_SLOT] = slot;
     procMessage[PROC_MSG_IDX_ROTATION] = rotation;
 
     procMessage[PROC_MSG_IDX_ZOOM] = mZoomTargetIdx;
@@ -2127,6 +2117,26 @@ int  CameraHal::ICapturePerform()
         rawMessage[3] = (unsigned int) NULL;
         write(rawPipe[1], &rawMessage, sizeof(rawMessage));
     }
+
+    if ( queuedShots < mBurstShots ) {
+        // Blocks only when every slot is still owned by IPP/encoder
+        slot = mCaptureRing.acquire(true);
+        if ( 0 > slot ) {
+            LOGE("No capture ring slot available");
+            goto fail_process;
+        }
+
+        capture_buffer.buffer = (void *) NEXT_4K_ALIGN_ADDR((unsigned int) mCaptureRing.getBuffer(slot));
+        capture_buffer.alloc_size = spec_res.buffer_size;
+
+        status = icap_push_buffer(iobj->lib_private, &capture_buffer, &snapshotBuffer);
+        if( ICAP_STATUS_FAIL == status){
+            LOGE ("ICapture push buffer function failed");
+            goto fail_process;
+        }
+
+        queuedShots++;
+    }
     }
 #ifdef DEBUG_LOG
 
@@ -2139,6 +2149,8 @@ int  CameraHal::ICapturePerform()
 fail_config :
 fail_process:
 
+    mCaptureRing.reclaim(CaptureBufferRing::OWNER_SENSOR);
+
     return -1;
 }
 
@@ -2864,6 +2876,7 @@ void CameraHal::procThread()
 
     void* input_buffer;
     unsigned int input_length;
+    int ringSlot;
 
     max_fd = procPipe[0] + 1;
 
@@ -2934,6 +2947,7 @@ void CameraHal::procThread()
 #endif
                 yuv_buffer = (void *) procMessage[PROC_MSG_IDX_YUV_BUFF];
                 yuv_len = procMessage[PROC_MSG_IDX_YUV_BUFFLEN];
+                ringSlot = procMessage[PROC_MSG_IDX_RING_SLOT];
                 image_rotation = procMessage[PROC_MSG_IDX_ROTATION];
                 image_zoom = zoom_step[procMessage[PROC_MSG_IDX_ZOOM]];
                 jpegQuality = procMessage[PROC_MSG_IDX_JPEG_QUALITY];
@@ -3054,6 +3068,8 @@ void CameraHal::procThread()
                }
 #endif
 
+                mCaptureRing.transfer(ringSlot, CaptureBufferRing::OWNER_IPP, CaptureBufferRing::OWNER_ENCODER);
+
 #if JPEG
                 err = 0;
 
@@ -3090,6 +3106,8 @@ void CameraHal::procThread()
 
                 JPEGPictureMemBase = new MemoryBase(JPEGPictureHeap, offset, jpegEncoder->jpegSize);
 #endif
+                mCaptureRing.transfer(ringSlot, CaptureBufferRing::OWNER_ENCODER, CaptureBufferRing::OWNER_APP);
+
                 /* Disable the jpeg message enabled check for now */
                 if(/*JpegPictureCallback*/ true) {
 
@@ -3124,6 +3142,9 @@ void CameraHal::procThread()
 
                 JPEGPictureMemBase.clear();
 
+                // The YUV data is no longer needed, hand the slot back to the sensor
+                mCaptureRing.recycle(ringSlot);
+
                 // Release constraint to DSP OPP by setting lowest Hz
                 SetDSPKHz(DSP3630_KHZ_MIN);
 
@@ -3142,46 +3163,28 @@ void CameraHal::procThread()
 
 int CameraHal::allocatePictureBuffers(size_t length, int burstCount)
 {
-    if (burstCount > MAX_BURST) {
-        LOGE("Can't handle burstCount(%d) larger then MAX_BURST(%d)",
-                burstCount, MAX_BURST);
-        return -1;
-    }
+    char value[PROPERTY_VALUE_MAX];
+    int budgetMB;
 
     length += ((2*PAGE) - 1) + 10*PAGE;
     length &= ~((2*PAGE) - 1);
     length += 2*PAGE;
 
-    for (int i = 0; i < burstCount; i++) {
-        if (mYuvBuffer[i] != NULL && mYuvBufferLen[i] == length) {
-            // proper buffer already allocated. skip alloc.
-            continue;
-        }
-
-        if (mYuvBuffer[i])
-            free(mYuvBuffer[i]);
+    property_get(CAPTURE_RING_BUDGET_PROP, value, STRINGIZE(CAPTURE_RING_DEFAULT_BUDGET_MB));
+    budgetMB = atoi(value);
+    if ( 0 >= budgetMB )
+        budgetMB = CAPTURE_RING_DEFAULT_BUDGET_MB;
+    // keeps the shift within a 32 bit size_t
+    if ( CAPTURE_RING_MAX_BUDGET_MB < budgetMB )
+        budgetMB = CAPTURE_RING_MAX_BUDGET_MB;
 
-        mYuvBuffer[i] = (uint8_t *) malloc(length);
-        mYuvBufferLen[i] = length;
-
-        if (mYuvBuffer[i] == NULL) {
-            LOGE("mYuvBuffer[%d] malloc failed", i);
-            return -1;
-        }
-    }
-
-    return NO_ERROR;
+    // Returns the ring capacity, which bounds the shots in flight
+    return mCaptureRing.configure(length, (size_t) budgetMB << 20, burstCount);
 }
 
 int CameraHal::freePictureBuffers(void)
 {
-    for (int i = 0; i < MAX_BURST; i++) {
-        if (mYuvBuffer[i]) {
-            free(mYuvBuffer[i]);
-            mYuvBuffer[i] = NULL;
-            mYuvBufferLen[i] = 0;
-        }
-    }
+    mCaptureRing.release();
 
     return NO_ERROR;
 }
@@ -4672,6 +4675,8 @@ exit:
 
 status_t  CameraHal::dump(int fd, const Vector<String16>& args) const
 {
+    mCaptureRing.dump(fd);
+
     return 0;
 }
 
@@ -46,6 +46,8 @@
 #include "MessageQueue.h"
 #include "overlay_common.h"
 #include "CameraHalParams.h"
+#include "CaptureBufferRing.h"
+#include "FW3AStatusService.h"
 
 #ifdef HARDWARE_OMX
 #include <JpegEncoderEXIF.h>
@@ -82,7 +84,6 @@ extern "C" {
 #define MAXIPPDynamicParams 10
 
 #endif
-#define MAX_BURST 15
 #define DSP_CACHE_ALIGNMENT 128
 #define BUFF_MAP_PADDING_TEST 256
 #define DSP_CACHE_ALIGN_MEM_ALLOC(__size__) \
@@ -261,6 +262,7 @@ enum {
 #endif
     PROC_MSG_IDX_YUV_BUFF,
     PROC_MSG_IDX_YUV_BUFFLEN,
+    PROC_MSG_IDX_RING_SLOT,
     PROC_MSG_IDX_ROTATION,
     PROC_MSG_IDX_ZOOM,
     PROC_MSG_IDX_JPEG_QUALITY,
@@ -420,6 +422,21 @@ public:
         }
     };
 
+#ifdef FW3A
+
+    class FW3AStatusReader : public FW3AStatusSource {
+        CameraHal* mHardware;
+    public:
+        FW3AStatusReader(CameraHal* hw)
+            : mHardware(hw) { }
+
+        virtual int readStatus(FW3AStatusSnapshot *snapshot) {
+            return mHardware->FW3A_ReadStatus(snapshot);
+        }
+    };
+
+#endif
+
     class RawThread : public Thread {
         CameraHal* mHardware;
     public:
@@ -475,6 +492,7 @@ public:
     int FW3A_Stop_AF();
     int FW3A_GetSettings() const;
     int FW3A_SetSettings();
+    int FW3A_ReadStatus(FW3AStatusSnapshot *snapshot);
 
 #endif
 
@@ -549,8 +567,7 @@ public:
     CameraParameters mParameters;
     sp<MemoryHeapBase> mPictureHeap, mJPEGPictureHeap;
     int mJPEGOffset, mJPEGLength;
-    unsigned int mYuvBufferLen[MAX_BURST];
-    void *mYuvBuffer[MAX_BURST];
+    CaptureBufferRing mCaptureRing;
     int  mPreviewFrameSize;
     sp<Overlay>  mOverlay;
     sp<PreviewThread>  mPreviewThread;
@@ -636,6 +653,12 @@ public:
     
 #ifdef FW3A
       lib3atest_obj *fobj;
+      FW3AStatusReader *m3AStatusReader;
+      FW3AStatusService *m3AStatus;
+      /* written by the 3A status thread only */
+      SICam_Status m3AStatusBuffer;
+      /* ICam status and maker note reads share fobj->hnd */
+      Mutex m3AReadLock;
 #endif
 
 #ifdef ICAP
@@ -351,6 +351,9 @@ int CameraHal::FW3A_Create()
         goto exit;
     }
 
+    m3AStatusReader = new FW3AStatusReader(this);
+    m3AStatus = new FW3AStatusService(m3AStatusReader);
+
 #ifdef DEBUG_LOG
 
     LOGD("FW3A Create - %d   fobj=%p", err, fobj);
@@ -446,6 +449,14 @@ int CameraHal::FW3A_Destroy()
 
 #endif
 
+    if ( NULL != m3AStatus ) {
+        m3AStatus->stop();
+        delete m3AStatus;
+        m3AStatus = NULL;
+        delete m3AStatusReader;
+        m3AStatusReader = NULL;
+    }
+
     ret = ICam_Destroy(fobj->hnd);
     if (ret < 0) {
         LOGE("Cannot Destroy2A");
@@ -491,6 +502,10 @@ int CameraHal::FW3A_Start()
         LOGE("3A FW Start - success");
     }
 
+    if ( m3AStatus->start() < 0 ) {
+        LOGE("Cannot start 3A status polling");
+    }
+
 #ifdef DEBUG_LOG
 
     LOG_FUNCTION_NAME_EXIT
@@ -516,6 +531,8 @@ int CameraHal::FW3A_Stop()
         return -1;
     }
 
+    m3AStatus->stop();
+
     //Stop 3AFW
     ret = ICam_ViewFinder(fobj->hnd, ICAM_DISABLE);
     if (0 > ret) {
@@ -645,6 +662,7 @@ int CameraHal::FW3A_Start_AF()
         return -1;
     } else {
         isStart_FW3A_AF = 1;
+        m3AStatus->armFocus();
         LOGD("3A FW AF Start - success");
     }
 
@@ -712,6 +730,39 @@ int CameraHal::FW3A_GetSettings() const
     return err;
 }
 
+int CameraHal::FW3A_ReadStatus(FW3AStatusSnapshot *snapshot)
+{
+    int err = 0;
+    Mutex::Autolock lock(m3AReadLock);
+
+    err = ICam_ReadStatus(fobj->hnd, &m3AStatusBuffer);
+    if ( err < 0 ) {
+        return err;
+    }
+
+    switch ( m3AStatusBuffer.af.status ) {
+        case ICAM_AF_STATUS_RUNNING:
+            snapshot->focusState = FW3A_FOCUS_RUNNING;
+            break;
+        case ICAM_AF_STATUS_IDLE:
+            snapshot->focusState = FW3A_FOCUS_IDLE;
+            break;
+        case ICAM_AF_STATUS_SUCCESS:
+            snapshot->focusState = FW3A_FOCUS_SUCCESS;
+            break;
+        default:
+            snapshot->focusState = FW3A_FOCUS_FAIL;
+            break;
+    }
+
+    snapshot->lowLight = ( ICAM_SHAKE_HIGH_RISK2 == m3AStatusBuffer.ae.camera_shake );
+    snapshot->shutter = m3AStatusBuffer.ae.shutter_cap;
+    snapshot->gain = m3AStatusBuffer.ae.again_cap;
+    snapshot->awbIndex = m3AStatusBuffer.awb.awb_index;
+
+    return 0;
+}
+
 int CameraHal::FW3A_SetSettings()
 {
     int err = 0;
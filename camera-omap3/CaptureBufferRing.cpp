@@ -0,0 +1,369 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file CaptureBufferRing.cpp
+*
+* Ownership tracking and statistics for the capture buffer ring.
+*
+*/
+
+#define LOG_TAG "CameraHal"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <new>
+#include <utils/Log.h>
+
+#include "CaptureBufferRing.h"
+
+namespace android {
+
+static const char *ownerNames[CaptureBufferRing::OWNER_MAX] = {
+    "free",
+    "sensor",
+    "ipp",
+    "encoder",
+    "app",
+};
+
+CaptureBufferRing::CaptureBufferRing()
+    : mSlots(NULL),
+      mCapacity(0),
+      mLength(0),
+      mInUse(0),
+      mInUseHighWater(0),
+      mBytesHighWater(0),
+      mAllocations(0),
+      mShots(0),
+      mStalls(0),
+      mShotTimeTotal(0),
+      mBurstStart(0),
+      mBurstShots(0),
+      mBurstRemaining(0),
+      mLastBurstShots(0),
+      mLastBurstTime(0)
+{
+}
+
+CaptureBufferRing::~CaptureBufferRing()
+{
+    release();
+}
+
+void CaptureBufferRing::freeSlots()
+{
+    if ( NULL == mSlots )
+        return;
+
+    for ( int i = 0; i < mCapacity; i++ ) {
+        if ( mSlots[i].buffer )
+            free(mSlots[i].buffer);
+    }
+
+    delete [] mSlots;
+    mSlots = NULL;
+    mCapacity = 0;
+    mLength = 0;
+    mInUse = 0;
+}
+
+int CaptureBufferRing::configure(size_t length, size_t budget, int shots)
+{
+    Mutex::Autolock lock(mLock);
+    Slot *slots;
+    int capacity, kept;
+
+    if ( 0 == length ) {
+        LOGE("Invalid capture buffer length");
+        return -1;
+    }
+
+    capacity = budget / length;
+    if ( capacity > shots )
+        capacity = shots;
+    if ( capacity < 1 )
+        capacity = 1;
+
+    if ( ( NULL != mSlots ) && ( length == mLength ) && ( capacity == mCapacity ) ) {
+        // proper ring already allocated. skip alloc.
+        return mCapacity;
+    }
+
+    // Buffers may still be owned by IPP/encoder from a previous burst
+    while ( 0 < mInUse ) {
+        mSlotFreed.wait(mLock);
+    }
+
+    if ( length != mLength )
+        freeSlots();
+
+    slots = new (std::nothrow) Slot[capacity];
+    if ( NULL == slots ) {
+        LOGE("Capture ring slot allocation failed");
+        freeSlots();
+        return -1;
+    }
+
+    // Keep the buffers of the previous ring, free the ones past the new one
+    kept = ( mCapacity < capacity ) ? mCapacity : capacity;
+    for ( int i = 0; i < mCapacity; i++ ) {
+        if ( i < kept )
+            slots[i].buffer = mSlots[i].buffer;
+        else if ( mSlots[i].buffer )
+            free(mSlots[i].buffer);
+    }
+    delete [] mSlots;
+    mSlots = slots;
+
+    for ( int i = 0; i < capacity; i++ ) {
+        mSlots[i].owner = OWNER_FREE;
+        mSlots[i].acquired = 0;
+        if ( i < kept )
+            continue;
+
+        mSlots[i].buffer = malloc(length);
+        if ( NULL == mSlots[i].buffer ) {
+            LOGE("Capture ring buffer %d malloc failed, shrinking ring to %d", i, i);
+            capacity = i;
+            break;
+        }
+        mAllocations++;
+    }
+
+    mCapacity = capacity;
+    mLength = length;
+
+    if ( mBytesHighWater < mLength * mCapacity )
+        mBytesHighWater = mLength * mCapacity;
+
+    LOGD("Capture ring configured: %d x %u bytes for %d shots (budget %u)",
+         mCapacity, (unsigned int) mLength, shots, (unsigned int) budget);
+
+    if ( 0 == mCapacity ) {
+        freeSlots();
+        return -1;
+    }
+
+    return mCapacity;
+}
+
+void CaptureBufferRing::release()
+{
+    Mutex::Autolock lock(mLock);
+
+    if ( 0 < mInUse ) {
+        LOGE("Releasing capture ring with %d slots still in use", mInUse);
+    }
+
+    freeSlots();
+    mBurstRemaining = 0;
+    mSlotFreed.broadcast();
+}
+
+int CaptureBufferRing::acquire(bool wait)
+{
+    Mutex::Autolock lock(mLock);
+    bool stalled = false;
+
+    while ( 1 ) {
+        // The ring may be released while we are waiting
+        if ( 0 == mCapacity )
+            return -1;
+
+        for ( int i = 0; i < mCapacity; i++ ) {
+            if ( OWNER_FREE == mSlots[i].owner ) {
+                mSlots[i].owner = OWNER_SENSOR;
+                mSlots[i].acquired = systemTime();
+                mInUse++;
+                if ( mInUse > mInUseHighWater )
+                    mInUseHighWater = mInUse;
+                if ( stalled )
+                    mStalls++;
+                return i;
+            }
+        }
+
+        if ( !wait )
+            return -1;
+
+        stalled = true;
+        mSlotFreed.wait(mLock);
+    }
+
+    return -1;
+}
+
+int CaptureBufferRing::transfer(int slot, Owner from, Owner to)
+{
+    Mutex::Autolock lock(mLock);
+
+    if ( ( 0 > slot ) || ( slot >= mCapacity ) ) {
+        LOGE("Invalid capture ring slot %d", slot);
+        return -1;
+    }
+
+    if ( from != mSlots[slot].owner ) {
+        LOGE("Capture ring slot %d owned by %s, expected %s",
+             slot, ownerNames[mSlots[slot].owner], ownerNames[from]);
+        return -1;
+    }
+
+    mSlots[slot].owner = to;
+
+    return 0;
+}
+
+void CaptureBufferRing::recycle(int slot)
+{
+    Mutex::Autolock lock(mLock);
+
+    if ( ( 0 > slot ) || ( slot >= mCapacity ) ) {
+        LOGE("Invalid capture ring slot %d", slot);
+        return;
+    }
+
+    if ( OWNER_FREE == mSlots[slot].owner )
+        return;
+
+    mShots++;
+    mBurstShots++;
+    mShotTimeTotal += systemTime() - mSlots[slot].acquired;
+
+    mSlots[slot].owner = OWNER_FREE;
+    mInUse--;
+
+    if ( ( 0 < mBurstRemaining ) && ( 0 == --mBurstRemaining ) ) {
+        mLastBurstShots = mBurstShots;
+        mLastBurstTime = systemTime() - mBurstStart;
+    }
+
+    mSlotFreed.broadcast();
+}
+
+int CaptureBufferRing::getOldest(Owner owner) const
+{
+    Mutex::Autolock lock(mLock);
+    int oldest = -1;
+
+    for ( int i = 0; i < mCapacity; i++ ) {
+        if ( owner != mSlots[i].owner )
+            continue;
+
+        if ( ( -1 == oldest ) || ( mSlots[i].acquired < mSlots[oldest].acquired ) )
+            oldest = i;
+    }
+
+    return oldest;
+}
+
+void CaptureBufferRing::reclaim(Owner owner)
+{
+    Mutex::Autolock lock(mLock);
+
+    for ( int i = 0; i < mCapacity; i++ ) {
+        if ( ( OWNER_FREE == owner ) || ( owner != mSlots[i].owner ) )
+            continue;
+
+        mSlots[i].owner = OWNER_FREE;
+        mInUse--;
+    }
+
+    // The aborted burst will never complete
+    mBurstRemaining = 0;
+    mSlotFreed.broadcast();
+}
+
+void *CaptureBufferRing::getBuffer(int slot) const
+{
+    Mutex::Autolock lock(mLock);
+
+    if ( ( 0 > slot ) || ( slot >= mCapacity ) )
+        return NULL;
+
+    return mSlots[slot].buffer;
+}
+
+size_t CaptureBufferRing::getLength(int slot) const
+{
+    Mutex::Autolock lock(mLock);
+
+    if ( ( 0 > slot ) || ( slot >= mCapacity ) )
+        return 0;
+
+    return mLength;
+}
+
+int CaptureBufferRing::getCapacity() const
+{
+    Mutex::Autolock lock(mLock);
+
+    return mCapacity;
+}
+
+void CaptureBufferRing::beginBurst(int shots)
+{
+    Mutex::Autolock lock(mLock);
+
+    mBurstStart = systemTime();
+    mBurstShots = 0;
+    mBurstRemaining = shots;
+}
+
+void CaptureBufferRing::dump(int fd) const
+{
+    Mutex::Autolock lock(mLock);
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    unsigned int avgShotMs = 0;
+    unsigned int burstFpsX100 = 0;
+
+    if ( 0 < mShots )
+        avgShotMs = (unsigned int) ( ( mShotTimeTotal / mShots ) / 1000000LL );
+
+    if ( 0 < mLastBurstTime )
+        burstFpsX100 = (unsigned int) ( ( (nsecs_t) mLastBurstShots * 100000000000LL ) / mLastBurstTime );
+
+    snprintf(buffer, SIZE, "Capture ring: %d slots x %u bytes, %d in use\n",
+             mCapacity, (unsigned int) mLength, mInUse);
+    write(fd, buffer, strlen(buffer));
+
+    for ( int i = 0; i < mCapacity; i++ ) {
+        snprintf(buffer, SIZE, "    slot %d: %p owner %s\n",
+                 i, mSlots[i].buffer, ownerNames[mSlots[i].owner]);
+        write(fd, buffer, strlen(buffer));
+    }
+
+    snprintf(buffer, SIZE, "    high water: %d slots, %u bytes, %u allocations\n",
+             mInUseHighWater, (unsigned int) mBytesHighWater, mAllocations);
+    write(fd, buffer, strlen(buffer));
+
+    snprintf(buffer, SIZE, "    shots: %u, avg shot-to-release %u ms, stalls %u\n",
+             mShots, avgShotMs, mStalls);
+    write(fd, buffer, strlen(buffer));
+
+    snprintf(buffer, SIZE, "    last burst: %u shots in %u ms (%u.%02u shots/s)\n",
+             mLastBurstShots, (unsigned int) ( mLastBurstTime / 1000000LL ),
+             burstFpsX100 / 100, burstFpsX100 % 100);
+    write(fd, buffer, strlen(buffer));
+}
+
+}; // namespace android
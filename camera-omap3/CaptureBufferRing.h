@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file CaptureBufferRing.h
+*
+* Persistent ring of YUV picture buffers shared by ICapture, IPP and the
+* JPEG encoder. Every slot is owned by exactly one stage at a time, so a
+* burst can keep recycling the same memory without allocating in the
+* shot path.
+*
+*/
+
+#ifndef CAPTURE_BUFFER_RING_H
+#define CAPTURE_BUFFER_RING_H
+
+#include <utils/threads.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+/* Default memory budget of the ring, overridable by CAPTURE_RING_BUDGET_PROP */
+#define CAPTURE_RING_DEFAULT_BUDGET_MB  64
+#define CAPTURE_RING_MAX_BUDGET_MB      1024
+#define CAPTURE_RING_BUDGET_PROP        "debug.camera.capture_budget_mb"
+
+class CaptureBufferRing {
+public:
+
+    enum Owner {
+        OWNER_FREE = 0,
+        OWNER_SENSOR,
+        OWNER_IPP,
+        OWNER_ENCODER,
+        OWNER_APP,
+        OWNER_MAX
+    };
+
+    CaptureBufferRing();
+    ~CaptureBufferRing();
+
+    /* (Re)allocates the ring for "shots" buffers of "length" bytes, at most
+     * as many as fit in "budget". Existing buffers are kept when the length
+     * matches, so repeated shots never reallocate; the ring only grows when
+     * a longer burst needs it and gives back what a shorter one doesn't.
+     * Returns the number of slots or -1 on failure. */
+    int configure(size_t length, size_t budget, int shots);
+
+    /* Frees all buffers. Only valid once no stage can touch them anymore */
+    void release();
+
+    /* Takes a free slot and hands it to the sensor. Blocks until a slot is
+     * recycled when "wait" is set, otherwise returns -1 if none is free. */
+    int acquire(bool wait);
+    int transfer(int slot, Owner from, Owner to);
+    void recycle(int slot);
+
+    /* Returns the slot held longest by "owner", -1 if none */
+    int getOldest(Owner owner) const;
+
+    /* Returns every slot held by "owner" to the ring, used on error paths */
+    void reclaim(Owner owner);
+
+    void *getBuffer(int slot) const;
+    size_t getLength(int slot) const;
+    int getCapacity() const;
+
+    /* Burst throughput is measured from beginBurst() until the last of
+     * "shots" slots has been recycled by the encoder/app side. */
+    void beginBurst(int shots);
+    void dump(int fd) const;
+
+private:
+
+    struct Slot {
+        void   *buffer;
+        Owner   owner;
+        nsecs_t acquired;
+    };
+
+    void freeSlots();
+
+    mutable Mutex mLock;
+    Condition mSlotFreed;
+    Slot *mSlots;
+    int mCapacity;
+    size_t mLength;
+
+    // statistics, reported through dump()
+    int mInUse;
+    int mInUseHighWater;
+    size_t mBytesHighWater;
+    unsigned int mAllocations;
+    unsigned int mShots;
+    unsigned int mStalls;
+    nsecs_t mShotTimeTotal;
+    nsecs_t mBurstStart;
+    unsigned int mBurstShots;
+    int mBurstRemaining;
+    unsigned int mLastBurstShots;
+    nsecs_t mLastBurstTime;
+};
+
+}; // namespace android
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file FW3AStatusService.cpp
+*
+* Adaptive rate 3A status polling thread.
+*
+*/
+
+#define LOG_TAG "CameraHal"
+
+#include <string.h>
+#include <utils/Log.h>
+#include <cutils/atomic.h>
+
+#include "FW3AStatusService.h"
+
+namespace android {
+
+FW3AStatusService::FW3AStatusService(FW3AStatusSource *source)
+    : mSource(source),
+      mRunning(false),
+      mFocusArmed(false),
+      mFirstPoll(false),
+      mIntervalMs(FW3A_POLL_FAST_MS),
+      mPolls(0),
+      mSequence(0),
+      mEvents(0)
+{
+    memset(&mSnapshot, 0, sizeof(mSnapshot));
+}
+
+FW3AStatusService::~FW3AStatusService()
+{
+    stop();
+}
+
+int FW3AStatusService::start()
+{
+    {
+        Mutex::Autolock lock(mLock);
+
+        if ( mRunning )
+            return 0;
+
+        mRunning = true;
+        mFirstPoll = true;
+        mIntervalMs = FW3A_POLL_FAST_MS;
+    }
+
+    mThread = new PollThread(this);
+    if ( mThread->run("Camera3AStatusThread", PRIORITY_DISPLAY) != NO_ERROR ) {
+        LOGE("Couldn't start 3A status thread");
+        Mutex::Autolock lock(mLock);
+        mRunning = false;
+        mThread.clear();
+        return -1;
+    }
+
+    return 0;
+}
+
+void FW3AStatusService::stop()
+{
+    sp<PollThread> thread;
+
+    {
+        Mutex::Autolock lock(mLock);
+
+        mRunning = false;
+        mFocusArmed = false;
+        mWake.signal();
+        thread = mThread;
+        mThread.clear();
+    }
+
+    if ( thread != 0 ) {
+        thread->requestExitAndWait();
+    }
+
+    // Events of a stopped 3A session are stale
+    android_atomic_and(0, &mEvents);
+}
+
+void FW3AStatusService::armFocus()
+{
+    Mutex::Autolock lock(mLock);
+
+    android_atomic_and(~FW3A_EVENT_FOCUS, &mEvents);
+    mFocusArmed = true;
+    mIntervalMs = FW3A_POLL_FAST_MS;
+    mWake.signal();
+}
+
+void FW3AStatusService::getSnapshot(FW3AStatusSnapshot *snapshot) const
+{
+    int32_t before, after;
+
+    do {
+        before = android_atomic_acquire_load(&mSequence);
+        memcpy(snapshot, &mSnapshot, sizeof(*snapshot));
+        // the copy has to be done before the sequence is checked again
+        android_memory_barrier();
+        after = android_atomic_acquire_load(&mSequence);
+    } while ( ( before & 1 ) || ( before != after ) );
+}
+
+int FW3AStatusService::takeEvents(int mask)
+{
+    return android_atomic_and(~mask, &mEvents) & mask;
+}
+
+void FW3AStatusService::publish(const FW3AStatusSnapshot &snapshot)
+{
+    // Single writer. The increment only orders what comes before it, the
+    // odd sequence has to be out before any byte of the snapshot.
+    android_atomic_inc(&mSequence);
+    android_memory_barrier();
+    memcpy(&mSnapshot, &snapshot, sizeof(mSnapshot));
+    android_atomic_inc(&mSequence);
+}
+
+bool FW3AStatusService::pollOnce()
+{
+    FW3AStatusSnapshot current, previous;
+    int events = 0;
+    bool changed, first;
+
+    {
+        Mutex::Autolock lock(mLock);
+
+        if ( !mRunning )
+            return false;
+
+        mWake.waitRelative(mLock, ms2ns(mIntervalMs));
+
+        if ( !mRunning )
+            return false;
+
+        first = mFirstPoll;
+    }
+
+    memset(&current, 0, sizeof(current));
+    if ( mSource->readStatus(&current) < 0 ) {
+        LOGE("3A status read failed");
+        return true;
+    }
+
+    current.timestamp = systemTime();
+    mPolls++;
+
+    getSnapshot(&previous);
+
+    changed = ( current.focusState != previous.focusState ) ||
+              ( current.lowLight != previous.lowLight ) ||
+              ( current.shutter != previous.shutter ) ||
+              ( current.gain != previous.gain ) ||
+              ( current.awbIndex != previous.awbIndex );
+
+    // The snapshot of a previous session may already hold the new value,
+    // the first poll of a session always reports it
+    if ( first || ( current.lowLight != previous.lowLight ) )
+        events |= FW3A_EVENT_LOW_LIGHT;
+
+    publish(current);
+
+    {
+        Mutex::Autolock lock(mLock);
+
+        mFirstPoll = false;
+
+        // FW3A_FOCUS_IDLE means the lens is still moving to its start position
+        if ( mFocusArmed &&
+             ( FW3A_FOCUS_RUNNING != current.focusState ) &&
+             ( FW3A_FOCUS_IDLE != current.focusState ) ) {
+            events |= FW3A_EVENT_FOCUS;
+            mFocusArmed = false;
+        }
+
+        // Poll fast while the algorithms move, back off once converged
+        if ( mFocusArmed || changed ) {
+            mIntervalMs = FW3A_POLL_FAST_MS;
+        } else if ( mIntervalMs < FW3A_POLL_SLOW_MS ) {
+            mIntervalMs *= 2;
+            if ( mIntervalMs > FW3A_POLL_SLOW_MS )
+                mIntervalMs = FW3A_POLL_SLOW_MS;
+        }
+    }
+
+    if ( events )
+        android_atomic_or(events, &mEvents);
+
+    return true;
+}
+
+}; // namespace android
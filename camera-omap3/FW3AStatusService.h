@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file FW3AStatusService.h
+*
+* Background 3A status poller. The poll rate follows the convergence of
+* the 3A algorithms, the latest status is published as a lock-free
+* snapshot and focus/exposure changes are batched into event bits that
+* the preview thread collects once per loop.
+*
+*/
+
+#ifndef FW3A_STATUS_SERVICE_H
+#define FW3A_STATUS_SERVICE_H
+
+#include <stdint.h>
+#include <utils/threads.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+#define FW3A_POLL_FAST_MS       33
+#define FW3A_POLL_SLOW_MS       300
+
+/* Event bits returned by FW3AStatusService::takeEvents() */
+#define FW3A_EVENT_FOCUS        (1<<0)
+#define FW3A_EVENT_LOW_LIGHT    (1<<1)
+
+enum FW3AFocusState {
+    FW3A_FOCUS_IDLE = 0,
+    FW3A_FOCUS_RUNNING,
+    FW3A_FOCUS_SUCCESS,
+    FW3A_FOCUS_FAIL
+};
+
+typedef struct {
+    int focusState;
+    int lowLight;
+    uint32_t shutter;
+    uint32_t gain;
+    uint32_t awbIndex;
+    nsecs_t timestamp;
+} FW3AStatusSnapshot;
+
+/* Translates the 3A library status into a snapshot. Implemented on top of
+ * ICam_ReadStatus in the HAL and by a scripted mock in FW3AStatusTest. */
+class FW3AStatusSource {
+public:
+    virtual ~FW3AStatusSource() {}
+    virtual int readStatus(FW3AStatusSnapshot *snapshot) = 0;
+};
+
+class FW3AStatusService {
+public:
+
+    FW3AStatusService(FW3AStatusSource *source);
+    ~FW3AStatusService();
+
+    int start();
+    void stop();
+
+    /* Called when AF is started so completion is reported at the fast rate */
+    void armFocus();
+
+    /* Lock-free, may be called from any thread */
+    void getSnapshot(FW3AStatusSnapshot *snapshot) const;
+
+    /* Atomically returns and clears the pending events in "mask" */
+    int takeEvents(int mask);
+
+    unsigned int getPollCount() const { return mPolls; }
+    unsigned int getPollInterval() const { return mIntervalMs; }
+
+private:
+
+    class PollThread : public Thread {
+        FW3AStatusService* mService;
+    public:
+        PollThread(FW3AStatusService* service)
+            : Thread(false), mService(service) { }
+
+        virtual bool threadLoop() {
+            return mService->pollOnce();
+        }
+    };
+
+    bool pollOnce();
+    void publish(const FW3AStatusSnapshot &snapshot);
+
+    FW3AStatusSource *mSource;
+    sp<PollThread> mThread;
+
+    Mutex mLock;
+    Condition mWake;
+    bool mRunning;
+    bool mFocusArmed;
+    bool mFirstPoll;
+    unsigned int mIntervalMs;
+    unsigned int mPolls;
+
+    // seqlock protected snapshot, odd sequence means update in progress
+    volatile int32_t mSequence;
+    FW3AStatusSnapshot mSnapshot;
+    volatile int32_t mEvents;
+};
+
+}; // namespace android
+
+#endif
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "FW3AStatusService.h"
+
+using namespace android;
+
+/* Scripted stand-in for the 3A library. AF finishes "afPolls" reads after
+ * it is started, exposure keeps moving for "aePolls" reads and settles. */
+class MockFW3A : public FW3AStatusSource {
+public:
+    MockFW3A() : reads(0), afPolls(0), afSuccess(true), aePolls(0), lowLight(0), shutter(1000) { }
+
+    virtual int readStatus(FW3AStatusSnapshot *snapshot) {
+        Mutex::Autolock lock(mLock);
+
+        reads++;
+
+        if ( afPolls > 0 ) {
+            afPolls--;
+            snapshot->focusState = ( afPolls & 1 ) ? FW3A_FOCUS_IDLE : FW3A_FOCUS_RUNNING;
+        } else {
+            snapshot->focusState = afSuccess ? FW3A_FOCUS_SUCCESS : FW3A_FOCUS_FAIL;
+        }
+
+        if ( aePolls > 0 ) {
+            aePolls--;
+            shutter += 100;
+        }
+
+        snapshot->shutter = shutter;
+        snapshot->gain = 256;
+        snapshot->lowLight = lowLight;
+
+        return 0;
+    }
+
+    void startFocus(int polls, bool success) {
+        Mutex::Autolock lock(mLock);
+        afPolls = polls;
+        afSuccess = success;
+    }
+
+    void moveExposure(int polls) {
+        Mutex::Autolock lock(mLock);
+        aePolls = polls;
+    }
+
+    Mutex mLock;
+    unsigned int reads;
+    int afPolls;
+    bool afSuccess;
+    int aePolls;
+    int lowLight;
+    unsigned int shutter;
+};
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if ( !(cond) ) { \
+        printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+static int waitEvents(FW3AStatusService &service, int mask, int timeoutMs)
+{
+    int events = 0;
+
+    while ( ( 0 == events ) && ( timeoutMs > 0 ) ) {
+        events = service.takeEvents(mask);
+        usleep(5000);
+        timeoutMs -= 5;
+    }
+
+    return events;
+}
+
+int main(int argc, char **argv)
+{
+    MockFW3A mock;
+    FW3AStatusSnapshot snapshot;
+    unsigned int reads;
+
+    FW3AStatusService service(&mock);
+
+    printf("\nStarting 3A status service");
+    CHECK(0 == service.start());
+
+    // The first poll reports the low light state, there is no previous one
+    CHECK(FW3A_EVENT_LOW_LIGHT == waitEvents(service, FW3A_EVENT_LOW_LIGHT, 2000));
+
+    // Focus completion is reported exactly once
+    mock.startFocus(6, true);
+    service.armFocus();
+    CHECK(FW3A_EVENT_FOCUS == waitEvents(service, FW3A_EVENT_FOCUS, 2000));
+    service.getSnapshot(&snapshot);
+    CHECK(FW3A_FOCUS_SUCCESS == snapshot.focusState);
+    usleep(200 * 1000);
+    CHECK(0 == service.takeEvents(FW3A_EVENT_FOCUS));
+
+    // A failed focus is reported as well
+    mock.startFocus(2, false);
+    service.armFocus();
+    CHECK(FW3A_EVENT_FOCUS == waitEvents(service, FW3A_EVENT_FOCUS, 2000));
+    service.getSnapshot(&snapshot);
+    CHECK(FW3A_FOCUS_FAIL == snapshot.focusState);
+
+    // Low light transitions are batched into a single event
+    {
+        Mutex::Autolock lock(mock.mLock);
+        mock.lowLight = 1;
+    }
+    CHECK(FW3A_EVENT_LOW_LIGHT == waitEvents(service, FW3A_EVENT_LOW_LIGHT, 2000));
+    service.getSnapshot(&snapshot);
+    CHECK(1 == snapshot.lowLight);
+
+    // Converged status backs off to the slow rate
+    usleep(2000 * 1000);
+    CHECK(FW3A_POLL_SLOW_MS == service.getPollInterval());
+    {
+        Mutex::Autolock lock(mock.mLock);
+        reads = mock.reads;
+    }
+    usleep(1000 * 1000);
+    {
+        Mutex::Autolock lock(mock.mLock);
+        reads = mock.reads - reads;
+    }
+    printf("\nConverged: %u reads/s", reads);
+    CHECK(reads <= ( 1000 / FW3A_POLL_SLOW_MS ) + 1);
+
+    // Moving exposure brings the fast rate back
+    mock.moveExposure(50);
+    usleep(( FW3A_POLL_SLOW_MS + 2 * FW3A_POLL_FAST_MS ) * 1000);
+    CHECK(FW3A_POLL_FAST_MS == service.getPollInterval());
+
+    // A change stop() dropped before it was taken is reported after a restart
+    {
+        Mutex::Autolock lock(mock.mLock);
+        mock.lowLight = 0;
+    }
+    usleep(4 * FW3A_POLL_FAST_MS * 1000);
+    service.stop();
+    CHECK(0 == service.start());
+    CHECK(FW3A_EVENT_LOW_LIGHT == waitEvents(service, FW3A_EVENT_LOW_LIGHT, 2000));
+    service.getSnapshot(&snapshot);
+    CHECK(0 == snapshot.lowLight);
+
+    service.stop();
+    printf("\n%u polls, %d failures\n", service.getPollCount(), failures);
+
+    return failures ? 1 : 0;
+}
@@ -7,7 +7,8 @@ include $(CLEAR_VARS)
 include external/opencore/Config.mk
 LOCAL_C_INCLUDES := \
     $(PV_INCLUDES) \
-    hardware/ti/omap3/liboverlay
+    hardware/ti/omap3/liboverlay \
+    hardware/ti/omap3/libtiutils
 
 LOCAL_SRC_FILES := \
     android_surface_output_omap34xx.cpp \
@@ -30,6 +31,8 @@ LOCAL_SHARED_LIBRARIES := \
     libicuuc \
     libopencore_player
 
+LOCAL_STATIC_LIBRARIES := libtiutils_yuv
+
 # do not prelink
 LOCAL_PRELINK_MODULE := false
 
@@ -40,6 +40,7 @@ static int mDebugFps = 0;
 #include "pvmf_video.h"
 #include <media/PVPlayer.h>
 #include "v4l2_utils.h"
+#include "YuvConvert.h"
 
 using namespace android;
 
@@ -55,8 +56,6 @@ typedef struct WriteResponseData{
  int iDequeueIndex;
 
 
-static void convertYuv420pToYuv422i(int width, int height, void* src, void* dst);
-
 static int Calculate_TotalRefFrames(int nWidth, int nHeight)
 {
     LOGD("Calculate_TotalRefFrames");
@@ -104,10 +103,12 @@ AndroidSurfaceOutputOmap34xx::AndroidSurfaceOutputOmap34xx() :
     * In order to get the same behavior as the previous releases, lets reset it to 0.
     */
     mNumberOfFramesToHold = 0;
+    mUnmatchedFrames = 0;
 }
 
 AndroidSurfaceOutputOmap34xx::~AndroidSurfaceOutputOmap34xx()
 {
+    LOGD_IF(mUnmatchedFrames, "%u frames were not in an overlay buffer", mUnmatchedFrames);
     mUseOverlay = false;
     mInitialized = false;
     if(mOverlay.get() != NULL){
@@ -221,6 +222,7 @@ bool AndroidSurfaceOutputOmap34xx::initCheck()
             LOGE("problem with bufferallocations\n");
              return mInitialized;
    }
+        mBufferIndex.clear();
         for (int i = 0; i < mbufferAlloc.maxBuffers; i++) {
             data = (mapping_data_t *)mOverlay->getBufferAddress((void*)i);
             if (data == NULL)
@@ -237,6 +239,12 @@ bool AndroidSurfaceOutputOmap34xx::initCheck()
             }else{
                 LOGV("buffer = %d allocated addr=%#lx\n", i, (unsigned long) mbufferAlloc.buffer_address[i]);
             }
+            // the decoder gets the buffers from mbufferAlloc in this order,
+            // writeAsync() maps the frames back to the overlay buffer numbers
+            if (!mBufferIndex.add(i, data->ptr, data->length)) {
+                LOGE("Vendor Speicifc(34xx)MIO: overlay buffer %d overlaps another one", i);
+                return mInitialized;
+            }
         }
     }
     mInitialized = true;
@@ -361,32 +369,39 @@ PVMFCommandId  AndroidSurfaceOutputOmap34xx::writeAsync(uint8 aFormatType, int32
                  {
             // Convert from YUV420 to YUV422 for software codec
             if (mConvert) {
-                convertYuv420pToYuv422i(iVideoWidth, iVideoHeight, aData, mbufferAlloc.buffer_address[bufEnc]);
+                // YUYV, every row starts on a 4 KB boundary of the overlay buffer
+                YuvPlanarFrame frame = YuvConvert::Contiguous(aData, iVideoWidth, iVideoHeight);
+                uint32_t pitch = (iVideoWidth * 2 + ARMPAGESIZE - 1) & ~(ARMPAGESIZE - 1);
+                YuvConvert::I420ToPacked422(frame, 0, 0, iVideoWidth, iVideoHeight,
+                                            (uint8_t*)mbufferAlloc.buffer_address[bufEnc], pitch,
+                                            YuvConvert::ORDER_YUYV);
             } else {
-                int i;
-                for (i = 0; i < mbufferAlloc.maxBuffers; i++) {
-                    /**
-                    *In order to support the offset from the decoded buffers, we have to check for
-                    * the range of offset with in the buffer. Here we can't check for the base address
-                    * and also, the offset should be used for crop window position calculation
-                    **/
-                    uint32 offsetinPixels = data_header_info.nOffset;
-                    if(mbufferAlloc.buffer_address[i] == aData - offsetinPixels){
-                        cropY = (offsetinPixels)/ARMPAGESIZE;
-                        cropX = (offsetinPixels)%ARMPAGESIZE;
-                        if( (cropY != icropY) || (cropX != icropX))
-                        {
-                            icropY = cropY;
-                            icropX = cropX;
-                            mOverlay->setCrop((uint32_t)cropX, (uint32_t)cropY, iVideoDisplayWidth, iVideoDisplayHeight);
-                        }
-                        break;
+                /**
+                *In order to support the offset from the decoded buffers, we have to check for
+                * the range of offset with in the buffer. Here we can't check for the base address
+                * and also, the offset should be used for crop window position calculation
+                **/
+                uint32 offsetinPixels = data_header_info.nOffset;
+                size_t offsetInBuffer;
+                int i = mBufferIndex.lookup(aData - offsetinPixels, &offsetInBuffer);
+                if (i >= 0 && offsetInBuffer == 0) {
+                    cropY = (offsetinPixels)/ARMPAGESIZE;
+                    cropX = (offsetinPixels)%ARMPAGESIZE;
+                    if( (cropY != icropY) || (cropX != icropX))
+                    {
+                        icropY = cropY;
+                        icropX = cropX;
+                        mOverlay->setCrop((uint32_t)cropX, (uint32_t)cropY, iVideoDisplayWidth, iVideoDisplayHeight);
                     }
+                    bufEnc = i;
+                } else {
+                    bufEnc = mbufferAlloc.maxBuffers;
                 }
-            bufEnc = i;
             }
             if (bufEnc == mbufferAlloc.maxBuffers) {
-                LOGE("AndroidSurfaceOutputOmap34xx::writeAsync: aData does not match any v4l buffer address\n");
+                mUnmatchedFrames++;
+                LOGE("AndroidSurfaceOutputOmap34xx::writeAsync: aData does not match any v4l buffer address (%u so far)\n",
+                     mUnmatchedFrames);
                 status = PVMFFailure;
                 WriteResponse resp(status, cmdid, aContext, aTimestamp);
                 iWriteResponseQueue.push_back(resp);
@@ -693,45 +708,6 @@ void AndroidSurfaceOutputOmap34xx::closeFrameBuf()
  }
 
 
-static void convertYuv420pToYuv422i (int width, int height, void* src, void* dst)
-{
-    // calculate total number of pixels, and offsets to U and V planes
-    uint32_t pixelCount =  height * width;
-
-    uint8_t* ySrc = (uint8_t*) src;
-    uint8_t* uSrc = (uint8_t*) ((uint8_t*)src + pixelCount);
-    uint8_t* vSrc = (uint8_t*) ((uint8_t*)src + pixelCount + pixelCount/4);
-    uint8_t *p = (uint8_t*) dst;
-    uint32_t page_width = (width * 2   + 4096 -1) & ~(4096 -1);  // width rounded to the 4096 bytes
-
-   //LOGI("Coverting YUV420 to YUV422 - Height %d and Width %d", height, width);
-
-     // convert lines
-    for (int i = 0; i < height  ; i += 2) {
-        for (int j = 0; j < width; j+= 2) {
-
-         //  These Y have the same CR and CRB....
-         //  Y0 Y01......
-         //  Y1 Y11......
-
-         // SRC buffer from the algorithm might be giving YVU420 as well
-         *(uint32_t *)(p) = (   ((uint32_t)(ySrc[1] << 16)   | (uint32_t)(ySrc[0]))  & 0x00ff00ff ) |
-                                    (  ((uint32_t)(*uSrc << 8) | (uint32_t)(*vSrc << 24))  & 0xff00ff00 ) ;
-
-         *(uint32_t *)(p + page_width) = (   ((uint32_t)(ySrc[width +1] << 16)   | (uint32_t)(ySrc[width]))    & 0x00ff00ff ) |
-                                                            (  ((uint32_t)(*uSrc++ << 8) | (uint32_t)(*vSrc++ << 24))   & 0xff00ff00 );
-
-            p += 4;
-            ySrc += 2;
-         }
-
-        // skip the next y line, we already converted it
-        ySrc += width;     // skip the next row as it was already filled above
-        p    += 2* page_width - width * 2; //go to the beginning of the next row
-    }
-}
-
-
 // factory function for playerdriver linkage
 extern "C" AndroidSurfaceOutputOmap34xx* createVideoMio()
 {
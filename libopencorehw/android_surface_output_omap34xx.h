@@ -29,6 +29,7 @@
 #include "android_surface_output.h"
 #include "buffer_alloc_omap34xx.h"
 #include "overlay_common.h"
+#include "OverlayBufferIndex.h"
 
 // support for shared contiguous physical memory
 #include <ui/Overlay.h>
@@ -68,6 +69,8 @@ private:
     int             icropY;
     int             icropX;
     int             mBuffersQueuedToDSS;
+    OverlayBufferIndex mBufferIndex;
+    uint32_t        mUnmatchedFrames;   // decoded frames not in any overlay buffer
 };
 
 #endif // ANDROID_SURFACE_OUTPUT_OMAP34XX_H_INCLUDED
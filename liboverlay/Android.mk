@@ -20,7 +20,7 @@ include $(CLEAR_VARS)
 LOCAL_PRELINK_MODULE := false
 LOCAL_MODULE_PATH := $(TARGET_OUT_SHARED_LIBRARIES)/hw
 LOCAL_SHARED_LIBRARIES := liblog libcutils
-LOCAL_SRC_FILES := v4l2_utils.c TIOverlay.cpp
+LOCAL_SRC_FILES := v4l2_utils.c sysfs_cache.cpp TIOverlay.cpp
 
 ifeq ($(TARGET_BOARD_PLATFORM),omap4)
 LOCAL_CFLAGS := -DTARGET_OMAP4
@@ -48,3 +48,34 @@ LOCAL_SRC_FILES := TIOverlay_test.cpp
 LOCAL_MODULE := overlay_test
 LOCAL_MODULE_TAGS:= optional
 include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+ifeq ($(TARGET_BOARD_PLATFORM),omap4)
+LOCAL_CFLAGS := -DTARGET_OMAP4
+endif
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+LOCAL_SRC_FILES := v4l2_utils.c sysfs_cache.cpp TIOverlay.cpp TIOverlay_bench.cpp
+LOCAL_MODULE := overlay_bench
+LOCAL_MODULE_TAGS:= optional
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES := sysfs_cache.cpp sysfs_cache_test.cpp
+LOCAL_STATIC_LIBRARIES := libcutils
+LOCAL_LDLIBS += -lpthread
+LOCAL_MODULE := overlay_sysfs_test
+LOCAL_MODULE_TAGS:= optional
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+ifeq ($(TARGET_BOARD_PLATFORM),omap4)
+LOCAL_CFLAGS := -DTARGET_OMAP4
+endif
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/host
+LOCAL_SRC_FILES := v4l2_utils.c sysfs_cache.cpp TIOverlay.cpp TIOverlay_host_test.cpp
+LOCAL_STATIC_LIBRARIES := libcutils
+LOCAL_LDFLAGS := -Wl,--wrap=open -Wl,--wrap=ioctl
+LOCAL_LDLIBS += -lpthread -lrt -lm
+LOCAL_MODULE := overlay_host_test
+LOCAL_MODULE_TAGS:= optional
+include $(BUILD_HOST_EXECUTABLE)
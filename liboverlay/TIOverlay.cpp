@@ -41,13 +41,11 @@ extern "C" {
 #include <cutils/atomic.h>
 #include "overlay_common.h"
 #include "TIOverlay.h"
+#include "sysfs_cache.h"
 
 #define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
 #define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
 
-int sysfile_write(const char* pathname, const void* buf, size_t size);
-int sysfile_read(const char* pathname, const void* buf, size_t size);
-
 #ifdef TARGET_OMAP4
 //currently picoDLP is excluded, till it is thoroughly validated with .35 kernel
 #define MAX_DISPLAY_CNT 3
@@ -179,44 +177,6 @@ struct hdmi_data hdmi[] = {
     {-1,    -1,     -1,     1,  1,  0} /*VESA or custome code, hence rely on kernel timings*/
 };
 
-int sysfile_write(const char* pathname, const void* buf, size_t size) {
-    int fd = open(pathname, O_WRONLY);
-    if (fd == -1) {
-        LOGE("Can't open [%s]", pathname);
-        return -1;
-    }
-    size_t written_size = write(fd, buf, size);
-    if (written_size <= 0) {
-        LOGE("Can't write [%s]", pathname);
-        close(fd);
-        return -1;
-    }
-    if (close(fd) == -1) {
-        LOGE("cant close [%s]", pathname);
-        return -1;
-    }
-    return 0;
-}
-
-int sysfile_read(const char* pathname, void* buf, size_t size) {
-    int fd = open(pathname, O_RDONLY);
-    if (fd == -1) {
-        LOGE("Can't open the file[%s]", pathname);
-        return -1;
-    }
-    size_t bytesread = read(fd, buf, size);
-    if ((int)bytesread < 0) {
-        LOGE("cant read from file[%s]", pathname);
-        close(fd);
-        return -1;
-    }
-    if (close(fd) == -1) {
-        LOGE("cant close file[%s]", pathname);
-        return -1;
-    }
-    return bytesread;
-}
-
 int InitDisplayManagerMetaData() {
     /**
     *Initialize the display names and the associated paths to enable
@@ -305,6 +265,17 @@ int overlay_control_context_t::create_shared_overlayobj(overlay_object** overlay
         LOGE("Failed to initialize overlay mutex\n");
     }
 
+    if (ret == 0 && (ret = pthread_mutex_init(&p->qlock, &p->attr)) != 0) {
+        LOGE("Failed to initialize overlay queue mutex\n");
+        pthread_mutex_destroy(&p->lock);
+    }
+
+    if (ret == 0 && (ret = pthread_mutex_init(&p->dqlock, &p->attr)) != 0) {
+        LOGE("Failed to initialize overlay dequeue mutex\n");
+        pthread_mutex_destroy(&p->qlock);
+        pthread_mutex_destroy(&p->lock);
+    }
+
     if (ret != 0) {
         munmap(p, size);
         close(fd);
@@ -329,6 +300,11 @@ void overlay_control_context_t::destroy_shared_overlayobj(overlay_object *overla
             LOGE("Failed to uninitialize overlay mutex!\n");
         }
 
+        if (pthread_mutex_destroy(&(overlayobj->qlock)) ||
+            pthread_mutex_destroy(&(overlayobj->dqlock))) {
+            LOGE("Failed to uninitialize overlay data path mutexes!\n");
+        }
+
         if (pthread_mutexattr_destroy(&(overlayobj->attr))) {
             LOGE("Failed to uninitialize the overlay mutex attr!\n");
         }
@@ -818,6 +794,9 @@ int overlay_data_context_t::disable_streaming_locked(overlay_object* overlayobj,
             fd = overlayobj->getctrl_videofd();
             linkfd = overlayobj->getctrl_linkvideofd();
         }
+        /* qlock keeps a concurrent queueBuffer from counting a buffer the
+         * stream off is about to drop */
+        pthread_mutex_lock(&overlayobj->qlock);
         ret = v4l2_overlay_stream_off( fd );
         if (linkfd > 0 ) {
             v4l2_overlay_stream_off( linkfd );
@@ -828,7 +807,9 @@ int overlay_data_context_t::disable_streaming_locked(overlay_object* overlayobj,
         } else {
             overlayobj->streamEn = 0;
             overlayobj->qd_buf_count = 0;
+            android_atomic_inc(&overlayobj->streamGen);
         }
+        pthread_mutex_unlock(&overlayobj->qlock);
     }
     LOG_FUNCTION_NAME_EXIT
     return ret;
@@ -849,6 +830,22 @@ int overlay_data_context_t::disable_streaming(overlay_object* overlayobj, bool i
     return ret;
 }
 
+/* Waits for in-flight queue/dequeue calls to drain, used by the control
+ * operations that reallocate or unmap the buffers. Stream off first so a
+ * blocked DQBUF returns. Caller holds the state lock.
+ */
+void overlay_data_context_t::quiesce_datapath_locked(overlay_object* overlayobj)
+{
+    pthread_mutex_lock(&overlayobj->dqlock);
+    pthread_mutex_lock(&overlayobj->qlock);
+}
+
+void overlay_data_context_t::resume_datapath_locked(overlay_object* overlayobj)
+{
+    pthread_mutex_unlock(&overlayobj->qlock);
+    pthread_mutex_unlock(&overlayobj->dqlock);
+}
+
 // ****************************************************************************
 // Control module context: used only in the control context
 // ****************************************************************************
@@ -1473,6 +1470,11 @@ int overlay_control_context_t::overlay_commit(struct overlay_control_device_t *d
     int ret = 0;
     overlay_ctrl_t finalWindow;
     char overlaymanagername[PATH_MAX];
+    char disablepanelpath[PATH_MAX];
+#ifndef TARGET_OMAP4
+    char displaytimings[PATH_MAX];
+#endif
+    SysfsBatch sysfsBatch;
     int strmatch;
     int fd = overlayobj->getctrl_videofd();
     overlay_data_t eCropData;
@@ -1481,6 +1483,8 @@ int overlay_control_context_t::overlay_commit(struct overlay_control_device_t *d
     int videopipezorder = stage->zorder;
     int transkey = stage->colorkey;
 
+    overlaymanagername[0] = '\0';
+
 #ifndef TARGET_OMAP4
     /** NOTE: In order to support HDMI without app explicitly requesting for
     * the screen ID, this is the alternative path check for the overlay manager.
@@ -1578,38 +1582,20 @@ int overlay_control_context_t::overlay_commit(struct overlay_control_device_t *d
         LOGD("Manager path [%s]", overlayobj->overlaymanagerpath);
         LOGD("Manager name [%s]", managerMetaData[overlayobj->mDisplayMetaData.mManagerIndex].managername);
         LOGD("Display name [%s]", screenMetaData[overlayobj->mDisplayMetaData.mPanelIndex].displayname);
+        /** All sysfs writes of the panel switch go out as one batch, the
+        * cache skips the ones that would not change the attribute.
+        */
         if (overlayobj->mDisplayMetaData.mTobeDisabledPanelIndex != -1) {
-            char disablepanelpath[PATH_MAX];
             sprintf(disablepanelpath, "/sys/devices/platform/omapdss/display%d/enabled", \
                 overlayobj->mDisplayMetaData.mTobeDisabledPanelIndex);
-            if (sysfile_write(disablepanelpath, "0", sizeof("0")) < 0) {
-                LOGE("panel disable failed");
-                ret = -1;
-                goto end;
-            }
+            sysfsBatch.add(disablepanelpath, "0");
         }
 
         if (!overlayobj->mData.s3d_active) {
-            if (sysfile_write(overlayobj->overlayenabled, "0", sizeof("0")) < 0) {
-                LOGE("Failed: overlay Disable");
-                ret = -1;
-                goto end;
-            }
-
-            /* Set the manager to the overlay */
-            if (sysfile_read(overlayobj->overlaymanagerpath, &overlaymanagername, PATH_MAX) < 0) {
-                LOGE("Overlay manager Name Get failed [%d]", __LINE__);
-                ret = -1;
-                goto end;
-            }
-            strtok(overlaymanagername, "\n");
-            LOGI("Before assigning Overlay-Manager to Overlay");
-            LOGI("overlaymanagerpath= %s, overlaymanagername= %s",overlayobj->overlaymanagerpath,overlaymanagername);
-
             /**
              * Before setting the manager, reset the overlay window to the default
              * this is to support the panels of various timings. The Actual window
-             * is set after manager is set.
+             * is set after manager is set. Streaming is already off at this point.
              * Assumption# The lowest resolution panel is QQVGA
              */
             if ((ret = v4l2_overlay_set_position(fd, 0, 0, QQVGA_WIDTH, QQVGA_HEIGHT))) {
@@ -1617,50 +1603,42 @@ int overlay_control_context_t::overlay_commit(struct overlay_control_device_t *d
                 goto end;
             }
 
-            if (sysfile_write(overlayobj->overlaymanagerpath, \
-                managerMetaData[overlayobj->mDisplayMetaData.mManagerIndex].managername, PATH_MAX) < 0) {
-                LOGE("Unable to set the overlay->manager");
-                ret = -1;
-                goto end;
-            }
+            sysfsBatch.add(overlayobj->overlayenabled, "0");
 
-            if (sysfile_read(overlayobj->overlaymanagerpath, &overlaymanagername, PATH_MAX) < 0) {
-                LOGE("Overlay manager Name Get failed [%d]", __LINE__);
-                ret = -1;
-                goto end;
-            }
-            strtok(overlaymanagername, "\n");
-            LOGI("After assigning  Overlay-Manager to Overlay");
-            LOGI("overlaymanagerpath= %s, overlaymanagername= %s",overlayobj->overlaymanagerpath,overlaymanagername);
+            /* Set the manager to the overlay */
+            sysfsBatch.add(overlayobj->overlaymanagerpath,
+                managerMetaData[overlayobj->mDisplayMetaData.mManagerIndex].managername);
 
 #ifdef TARGET_OMAP4
 
             /** Set the manager display to the panel*/
-            if (sysfile_write(managerMetaData[overlayobj->mDisplayMetaData.mManagerIndex].managerdisplay, \
-                screenMetaData[overlayobj->mDisplayMetaData.mPanelIndex].displayname, PATH_MAX) < 0) {
-                LOGE("Unable to set the manager->display");
-                ret = -1;
-                goto end;
-            }
+            sysfsBatch.add(managerMetaData[overlayobj->mDisplayMetaData.mManagerIndex].managerdisplay, \
+                screenMetaData[overlayobj->mDisplayMetaData.mPanelIndex].displayname);
 #else
-            char displaytimings[PATH_MAX];
             sprintf(displaytimings, "/sys/devices/platform/omapdss/display%d/timings", overlayobj->mDisplayMetaData.mPanelIndex);
             if (!strcmp(managerMetaData[overlayobj->mDisplayMetaData.mManagerIndex].managername, "tv")) {
-                if (sysfile_write(displaytimings, "ntsc", sizeof("ntsc")) < 0) {
-                    LOGE("Setting display timings failed");
-                    ret = -1;
-                    goto end;
-                }
+                sysfsBatch.add(displaytimings, "ntsc");
             }
 #endif
 
             // Enable the requested panel here
-            if (sysfile_write(screenMetaData[overlayobj->mDisplayMetaData.mPanelIndex].displayenabled, "1", sizeof("1")) < 0) {
-                LOGE("Panel enable failed");
+            sysfsBatch.add(screenMetaData[overlayobj->mDisplayMetaData.mPanelIndex].displayenabled, "1");
+
+            if (sysfs_cache().apply(sysfsBatch) < 0) {
+                LOGE("Panel switch failed");
                 ret = -1;
                 goto end;
             }
+
+            strcpy(overlaymanagername, managerMetaData[overlayobj->mDisplayMetaData.mManagerIndex].managername);
+            LOGI("overlaymanagerpath= %s, overlaymanagername= %s",overlayobj->overlaymanagerpath,overlaymanagername);
         } else {
+            if (sysfs_cache().apply(sysfsBatch) < 0) {
+                LOGE("panel disable failed");
+                ret = -1;
+                goto end;
+            }
+
             //Currently need to disable streaming to change display id
             ret = v4l2_overlay_set_display_id(fd, data->panel);
             if(ret)
@@ -1985,6 +1963,7 @@ int overlay_data_context_t::overlay_resizeInput(struct overlay_data_device_t *de
 
     pthread_mutex_lock(&ctx->omap_overlay->lock);
     ret = ctx->disable_streaming_locked(ctx->omap_overlay);
+    ctx->quiesce_datapath_locked(ctx->omap_overlay);
 
     if ((ctx->omap_overlay->w == (unsigned int)w) && (ctx->omap_overlay->h == (unsigned int)h) && (ctx->omap_overlay->attributes_changed == 0)){
         LOGE("Same as current width and height. Attributes did not change either. So do nothing.");
@@ -2089,6 +2068,7 @@ int overlay_data_context_t::overlay_resizeInput(struct overlay_data_device_t *de
     LOG_FUNCTION_NAME_EXIT
 end:
 
+    ctx->resume_datapath_locked(ctx->omap_overlay);
     pthread_mutex_unlock(&ctx->omap_overlay->lock);
     return ret;
 }
@@ -2387,8 +2367,14 @@ int overlay_data_context_t::overlay_dequeueBuffer(struct overlay_data_device_t *
     int rc1;
     int i = -1;
     int ii = -1;
+    int32_t gen;
+    bool dqFailed = false;
+
+    /* Only dequeuers serialize here, queueBuffer and the control side keep
+     * going while DQBUF waits for the display. */
+    pthread_mutex_lock(&ctx->omap_overlay->dqlock);
+    gen = android_atomic_acquire_load(&ctx->omap_overlay->streamGen);
 
-    pthread_mutex_lock(&ctx->omap_overlay->lock);
     if (ctx->omap_overlay->streamEn == 0) {
         LOGE("Cannot dequeue when streaming is disabled. ctx->omap_overlay->qd_buf_count = %d", ctx->omap_overlay->qd_buf_count);
         rc = -EPERM;
@@ -2401,11 +2387,7 @@ int overlay_data_context_t::overlay_dequeueBuffer(struct overlay_data_device_t *
 
     else if ( (rc = v4l2_overlay_dq_buf(fd, &i, EMEMORY_MMAP, NULL, 0 )) != 0 ) {
         LOGE("Failed to DQ/%d\n", rc);
-       //in order to recover from DQ failure scenario, let's disable the stream.
-       //the stream gets re-enabled in the subsequent Q buffer call
-       //if streamoff also fails!!! just return the errorcode to the client
-       rc = disable_streaming_locked(ctx->omap_overlay, true);
-       if (rc == 0) { rc = -1; } //this is required for TIHardwareRenderer
+        dqFailed = true;
     }
     else if ( i < 0 || i > ctx->omap_overlay->num_buffers ) {
         LOGE("dqbuffer i=%d",i);
@@ -2413,7 +2395,12 @@ int overlay_data_context_t::overlay_dequeueBuffer(struct overlay_data_device_t *
     }
     else {
         *((int *)buffer) = i;
-        ctx->omap_overlay->qd_buf_count --;
+        pthread_mutex_lock(&ctx->omap_overlay->qlock);
+        // a stream off since the DQBUF already reset the count
+        if (gen == ctx->omap_overlay->streamGen) {
+            ctx->omap_overlay->qd_buf_count --;
+        }
+        pthread_mutex_unlock(&ctx->omap_overlay->qlock);
         LOGV("INDEX DEQUEUE = %d", i);
         LOGV("qd_buf_count --");
     }
@@ -2427,7 +2414,22 @@ int overlay_data_context_t::overlay_dequeueBuffer(struct overlay_data_device_t *
 
     LOGV("qd_buf_count = %d", ctx->omap_overlay->qd_buf_count);
 
-    pthread_mutex_unlock(&ctx->omap_overlay->lock);
+    pthread_mutex_unlock(&ctx->omap_overlay->dqlock);
+
+    if (dqFailed) {
+        //in order to recover from DQ failure scenario, let's disable the stream.
+        //the stream gets re-enabled in the subsequent Q buffer call
+        //if streamoff also fails!!! just return the errorcode to the client
+        //Nothing to recover when the control side stopped the stream meanwhile.
+        pthread_mutex_lock(&ctx->omap_overlay->lock);
+        if (gen == android_atomic_acquire_load(&ctx->omap_overlay->streamGen)) {
+            rc = disable_streaming_locked(ctx->omap_overlay, true);
+        } else {
+            rc = 0;
+        }
+        pthread_mutex_unlock(&ctx->omap_overlay->lock);
+        if (rc == 0) { rc = -1; } //this is required for TIHardwareRenderer
+    }
 
     return ( rc );
 }
@@ -2450,6 +2452,7 @@ int overlay_data_context_t::overlay_queueBuffer(struct overlay_data_device_t *de
     }
     int fd = ctx->omap_overlay->getdata_videofd();
     int linkfd = ctx->omap_overlay->getdata_linkvideofd();
+    int qd_buf_count;
 
     if ( !ctx->omap_overlay->controlReady ) {
         LOGI("Control not ready but queue buffer requested!!!\n");
@@ -2465,13 +2468,15 @@ int overlay_data_context_t::overlay_queueBuffer(struct overlay_data_device_t *de
    noofbuffer++;
 #endif
 
-    pthread_mutex_lock(&ctx->omap_overlay->lock);
+    /* QBUF doesn't block, qlock is only held for the ioctl and the count
+     * so a dequeuer waiting for the display doesn't stall the producer. */
+    pthread_mutex_lock(&ctx->omap_overlay->qlock);
 
     int rc = v4l2_overlay_q_buf(fd, (int)buffer, EMEMORY_MMAP, NULL, 0);
     if (rc < 0) {
         LOGD("queueBuffer failed. rc = %d", rc);
-        rc = -EPERM;
-        goto EXIT;
+        pthread_mutex_unlock(&ctx->omap_overlay->qlock);
+        return -EPERM;
     }
 
     if (linkfd > 0) {
@@ -2486,18 +2491,26 @@ int overlay_data_context_t::overlay_queueBuffer(struct overlay_data_device_t *de
     if (ctx->omap_overlay->qd_buf_count < ctx->omap_overlay->num_buffers && rc == 0) {
         ctx->omap_overlay->qd_buf_count ++;
     }
+    qd_buf_count = ctx->omap_overlay->qd_buf_count;
+
+    pthread_mutex_unlock(&ctx->omap_overlay->qlock);
 
     if (ctx->omap_overlay->streamEn == 0) {
         /*DSS2: 2 buffers need to be queue before enable streaming*/
-        ctx->omap_overlay->dataReady = 1;
-        rc = ctx->enable_streaming_locked(ctx->omap_overlay);
+        pthread_mutex_lock(&ctx->omap_overlay->lock);
+        /* re-check, another queuer may have won the race or a stream off
+         * from the control side may have dropped what we just queued */
+        if ((ctx->omap_overlay->streamEn == 0) && (ctx->omap_overlay->qd_buf_count > 0)) {
+            ctx->omap_overlay->dataReady = 1;
+            rc = ctx->enable_streaming_locked(ctx->omap_overlay);
+        }
+        qd_buf_count = ctx->omap_overlay->qd_buf_count;
+        pthread_mutex_unlock(&ctx->omap_overlay->lock);
     }
     if (rc == 0) {
-        rc = ctx->omap_overlay->qd_buf_count;
+        rc = qd_buf_count;
     }
 
-EXIT:
-    pthread_mutex_unlock(&ctx->omap_overlay->lock);
     return ( rc );
 }
 
@@ -2569,6 +2582,7 @@ int overlay_data_context_t::overlay_data_close(struct hw_device_t *dev) {
         if ((rc = (ctx->disable_streaming_locked(ctx->omap_overlay)))) {
             LOGE("Stream Off Failed!/%d\n", rc);
         }
+        ctx->quiesce_datapath_locked(ctx->omap_overlay);
 
         for (i = 0; i < ctx->omap_overlay->mappedbufcount; i++) {
             LOGV("Unmap Buffer/%d/%08lx/%d", i, (unsigned long)ctx->omap_overlay->buffers[i], ctx->omap_overlay->buffers_len[i] );
@@ -2589,6 +2603,7 @@ int overlay_data_context_t::overlay_data_close(struct hw_device_t *dev) {
             close(linkfd);
         }
 
+        ctx->resume_datapath_locked(ctx->omap_overlay);
         pthread_mutex_unlock(&ctx->omap_overlay->lock);
 
         ctx->omap_overlay->dataReady = 0;
@@ -117,14 +117,25 @@ public:
     uint32_t dataReady;    // Only updated by the data side
     uint32_t streamEn;
 
+    /** lock is the state lock, taken by control operations (commit, crop,
+     * resize, stream on/off). The data path does not hold it across the
+     * V4L2 ioctls: qlock serializes queuers and guards qd_buf_count and
+     * streamGen, dqlock serializes dequeuers. Ordering is
+     * lock -> dqlock -> qlock, the data path never takes lock while
+     * holding qlock or dqlock.
+     */
     pthread_mutex_t lock;
+    pthread_mutex_t qlock;
+    pthread_mutex_t dqlock;
     pthread_mutexattr_t attr;
 
     uint32_t dispW;
     uint32_t dispH;
 
     // Need to count Qd buffers to be sure we don't block DQ'ing when exiting
-    int qd_buf_count;
+    volatile int32_t qd_buf_count;
+    // Bumped on every stream off, tells the data path its buffers were dropped
+    volatile int32_t streamGen;
 
     overlay_ctrl_t      mCtl;
     overlay_ctrl_t      mCtlStage;
@@ -274,6 +285,8 @@ public:
     static int  enable_streaming_locked(overlay_object* ovly, bool isDatapath = true);
     static int  disable_streaming(overlay_object* ovly, bool isDatapath = true);
     static int  disable_streaming_locked(overlay_object* ovly, bool isDatapath = true);
+    static void quiesce_datapath_locked(overlay_object* ovly);
+    static void resume_datapath_locked(overlay_object* ovly);
 
     overlay_object* omap_overlay;
 
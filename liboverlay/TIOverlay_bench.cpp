@@ -0,0 +1,276 @@
+/*
+* Copyright (C) Texas Instruments - http://www.ti.com/
+*
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/** Producer/consumer contention benchmark for the overlay data path.
+*
+* Runs overlay_queueBuffer and overlay_dequeueBuffer from two threads on any
+* V4L2 output device with MMAP buffers (omap_vout, vivid, v4l2loopback):
+*
+*   overlay_bench -d /dev/video1 -n 600 [-c]
+*
+* -c wraps every data call in one big lock, which is how the data path was
+* serialized before queue and dequeue got their own locks.
+*/
+
+#include <hardware/hardware.h>
+#include <hardware/overlay.h>
+
+extern "C" {
+#include "v4l2_utils.h"
+}
+
+#include <pthread.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <linux/videodev.h>
+
+#include <cutils/log.h>
+#include "overlay_common.h"
+#include "TIOverlay.h"
+
+struct latency_t {
+    uint64_t total;
+    uint64_t max;
+    unsigned int calls;
+};
+
+struct bench_t {
+    overlay_data_context_t* ctx;
+    int frames;
+    int coarse;
+    pthread_mutex_t bigLock;
+
+    // buffers owned by the producer, refilled by the consumer
+    pthread_mutex_t freeLock;
+    pthread_cond_t freeCond;
+    int freeList[NUM_OVERLAY_BUFFERS_MAX];
+    int freeCount;
+
+    volatile int done;
+    latency_t queue;
+    latency_t dequeue;
+    unsigned int dequeueRetries;
+};
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void account(latency_t* l, uint64_t start)
+{
+    uint64_t delta = now_us() - start;
+    l->total += delta;
+    l->calls++;
+    if (delta > l->max) {
+        l->max = delta;
+    }
+}
+
+static void* producer(void* arg)
+{
+    bench_t* b = (bench_t*)arg;
+    overlay_object* obj = b->ctx->omap_overlay;
+
+    for (int frame = 0; frame < b->frames; frame++) {
+        int index;
+
+        pthread_mutex_lock(&b->freeLock);
+        while (b->freeCount == 0 && !b->done) {
+            pthread_cond_wait(&b->freeCond, &b->freeLock);
+        }
+        if (b->done) {
+            pthread_mutex_unlock(&b->freeLock);
+            break;
+        }
+        index = b->freeList[--b->freeCount];
+        pthread_mutex_unlock(&b->freeLock);
+
+        // touch the first line like a decoder would
+        memset(obj->buffers[index], frame & 0xff, obj->w * 2);
+
+        uint64_t start = now_us();
+        if (b->coarse) {
+            pthread_mutex_lock(&b->bigLock);
+        }
+        int rc = overlay_data_context_t::overlay_queueBuffer(b->ctx, (overlay_buffer_t)index);
+        if (b->coarse) {
+            pthread_mutex_unlock(&b->bigLock);
+        }
+        account(&b->queue, start);
+
+        if (rc < 0) {
+            LOGE("queueBuffer failed %d", rc);
+            pthread_mutex_lock(&b->freeLock);
+            b->freeList[b->freeCount++] = index;
+            pthread_mutex_unlock(&b->freeLock);
+        }
+    }
+
+    b->done = 1;
+    return NULL;
+}
+
+static void* consumer(void* arg)
+{
+    bench_t* b = (bench_t*)arg;
+
+    while (!b->done) {
+        overlay_buffer_t buffer;
+
+        uint64_t start = now_us();
+        if (b->coarse) {
+            pthread_mutex_lock(&b->bigLock);
+        }
+        int rc = overlay_data_context_t::overlay_dequeueBuffer(b->ctx, &buffer);
+        if (b->coarse) {
+            pthread_mutex_unlock(&b->bigLock);
+        }
+
+        if (rc != 0) {
+            // not enough buffers queued yet, or the stream restarts
+            b->dequeueRetries++;
+            usleep(1000);
+            continue;
+        }
+        account(&b->dequeue, start);
+
+        pthread_mutex_lock(&b->freeLock);
+        b->freeList[b->freeCount++] = (int)buffer;
+        pthread_cond_signal(&b->freeCond);
+        pthread_mutex_unlock(&b->freeLock);
+    }
+
+    pthread_mutex_lock(&b->freeLock);
+    pthread_cond_signal(&b->freeCond);
+    pthread_mutex_unlock(&b->freeLock);
+    return NULL;
+}
+
+static void print_latency(const char* name, latency_t* l)
+{
+    printf("%-8s calls %6u  avg %6llu us  max %6llu us\n", name, l->calls,
+           l->calls ? (unsigned long long)(l->total / l->calls) : 0ULL,
+           (unsigned long long)l->max);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* device = "/dev/video1";
+    uint32_t width = 320;
+    uint32_t height = 240;
+    uint32_t num_buffers = NUM_OVERLAY_BUFFERS_REQUESTED;
+    bench_t b;
+    int opt;
+
+    memset(&b, 0, sizeof(b));
+    b.frames = 300;
+
+    while ((opt = getopt(argc, argv, "d:n:b:w:h:c")) != -1) {
+        switch (opt) {
+            case 'd': device = optarg; break;
+            case 'n': b.frames = atoi(optarg); break;
+            case 'b': num_buffers = atoi(optarg); break;
+            case 'w': width = atoi(optarg); break;
+            case 'h': height = atoi(optarg); break;
+            case 'c': b.coarse = 1; break;
+            default:
+                printf("usage: %s [-d device] [-n frames] [-b buffers] [-w width] [-h height] [-c]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (num_buffers > NUM_OVERLAY_BUFFERS_MAX) {
+        num_buffers = NUM_OVERLAY_BUFFERS_MAX;
+    }
+
+    int fd = open(device, O_RDWR);
+    if (fd < 0) {
+        printf("can't open %s\n", device);
+        return 1;
+    }
+
+    if (v4l2_overlay_init(fd, width, height, OVERLAY_FORMAT_YCbYCr_422_I) ||
+        v4l2_overlay_req_buf(fd, &num_buffers, 0, 0, EMEMORY_MMAP)) {
+        printf("%s doesn't take %dx%d YUYV MMAP output buffers\n", device, width, height);
+        close(fd);
+        return 1;
+    }
+
+    /* The data context only needs the fields the data path reads, no
+     * control device or shared overlay object is involved. */
+    overlay_object* obj = (overlay_object*)calloc(1, sizeof(overlay_object));
+    obj->init(fd, width, height, OVERLAY_FORMAT_YCbYCr_422_I, num_buffers, 0);
+    obj->mDataHandle.video_fd = fd;
+    obj->controlReady = 1;
+    obj->optimalQBufCnt = NUM_BUFFERS_TO_BE_QUEUED_FOR_OPTIMAL_PERFORMANCE;
+    obj->buffers = new void*[num_buffers];
+    obj->buffers_len = new size_t[num_buffers];
+    obj->mapping_data = new mapping_data_t;
+    pthread_mutex_init(&obj->lock, NULL);
+    pthread_mutex_init(&obj->qlock, NULL);
+    pthread_mutex_init(&obj->dqlock, NULL);
+
+    for (uint32_t i = 0; i < num_buffers; i++) {
+        if (v4l2_overlay_map_buf(fd, i, &obj->buffers[i], &obj->buffers_len[i])) {
+            printf("can't map buffer %d\n", i);
+            return 1;
+        }
+        b.freeList[b.freeCount++] = i;
+    }
+    obj->mappedbufcount = num_buffers;
+
+    b.ctx = (overlay_data_context_t*)calloc(1, sizeof(overlay_data_context_t));
+    b.ctx->omap_overlay = obj;
+    pthread_mutex_init(&b.bigLock, NULL);
+    pthread_mutex_init(&b.freeLock, NULL);
+    pthread_cond_init(&b.freeCond, NULL);
+
+    printf("%s: %dx%d, %d buffers, %d frames, %s locking\n", device, width, height,
+           num_buffers, b.frames, b.coarse ? "coarse" : "split");
+
+    pthread_t producerThread, consumerThread;
+    uint64_t start = now_us();
+    pthread_create(&consumerThread, NULL, consumer, &b);
+    pthread_create(&producerThread, NULL, producer, &b);
+    pthread_join(producerThread, NULL);
+    pthread_join(consumerThread, NULL);
+    uint64_t elapsed = now_us() - start;
+
+    printf("%.1f fps, %u dequeue retries\n", b.queue.calls * 1000000.0 / elapsed, b.dequeueRetries);
+    print_latency("queue", &b.queue);
+    print_latency("dequeue", &b.dequeue);
+
+    overlay_data_context_t::disable_streaming(obj);
+    for (uint32_t i = 0; i < num_buffers; i++) {
+        v4l2_overlay_unmap_buf(obj->buffers[i], obj->buffers_len[i]);
+    }
+    close(fd);
+
+    return 0;
+}
@@ -0,0 +1,615 @@
+/*
+* Copyright (C) Texas Instruments - http://www.ti.com/
+*
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with this library; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/** Host integration harness for the overlay HAL.
+*
+* Drives the control and data entry points of TIOverlay.cpp the way
+* SurfaceFlinger and a video renderer do, on a Linux host:
+*
+*   - /dev/videoN opened by v4l2_overlay_open() is redirected to a V4L2
+*     output device with MMAP buffers (v4l2loopback or vivid).
+*   - omapdss sysfs lives in a fake tree under a temp directory, see
+*     SysfsCache::setRoot().
+*   - DSS-only ioctls the host driver rejects (overlay window, zorder,
+*     rotation, TI controls, s3d) are emulated per fd, everything on the
+*     buffer queue goes to the real driver.
+*
+*   overlay_host_test -d /dev/video0 [-n frames] [-r fps] [-w width] [-h height]
+*                     [-R] [-l max_latency_ms]
+*
+* -R resizes and re-crops the input halfway through. -l fails the run when
+* the 99th percentile of queue or dequeue latency exceeds the limit.
+*/
+
+#include <hardware/hardware.h>
+#include <hardware/overlay.h>
+
+extern "C" {
+#include "v4l2_utils.h"
+}
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/videodev.h>
+
+#include <cutils/log.h>
+#include "overlay_common.h"
+#include "sysfs_cache.h"
+
+extern "C" struct overlay_module_t HAL_MODULE_INFO_SYM;
+
+#define OMAPDSS "/sys/devices/platform/omapdss"
+#define MAX_FAKE_FDS 1024
+#define MAX_FAKE_CTRLS 16
+
+// ****************************************************************************
+// Fake DSS: redirected device node and emulated OMAP-only ioctls
+// ****************************************************************************
+
+struct fake_ctrl_t {
+    uint32_t id;
+    int32_t value;
+};
+
+struct fake_dss_t {
+    int pipeline;
+    int hasWindow;
+    struct v4l2_format window;
+    int hasPrivate;
+    struct v4l2_format priv;
+    int hasCrop;
+    struct v4l2_crop crop;
+    struct v4l2_framebuffer fbuf;
+    fake_ctrl_t ctrls[MAX_FAKE_CTRLS];
+    int numCtrls;
+};
+
+static const char* gDevice = NULL;
+static int gNextPipeline = 1;   // pipeline 0 is the graphics plane
+static fake_dss_t gFake[MAX_FAKE_FDS];
+static unsigned int gEmulated = 0;
+
+extern "C" int __real_open(const char* pathname, int flags, ...);
+extern "C" int __real_ioctl(int fd, unsigned long request, ...);
+
+extern "C" int __wrap_open(const char* pathname, int flags, ...)
+{
+    mode_t mode = 0;
+
+    if (flags & O_CREAT) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, int);
+        va_end(ap);
+    }
+
+    if (gDevice && !strncmp(pathname, "/dev/video", strlen("/dev/video"))) {
+        int fd = __real_open(gDevice, flags, mode);
+        if ((fd >= 0) && (fd < MAX_FAKE_FDS)) {
+            memset(&gFake[fd], 0, sizeof(gFake[fd]));
+            gFake[fd].pipeline = gNextPipeline++;
+        }
+        return fd;
+    }
+
+    return __real_open(pathname, flags, mode);
+}
+
+static fake_ctrl_t* fake_ctrl(fake_dss_t* dss, uint32_t id)
+{
+    for (int i = 0; i < dss->numCtrls; i++) {
+        if (dss->ctrls[i].id == id) {
+            return &dss->ctrls[i];
+        }
+    }
+    if (dss->numCtrls == MAX_FAKE_CTRLS) {
+        return NULL;
+    }
+    dss->ctrls[dss->numCtrls].id = id;
+    dss->ctrls[dss->numCtrls].value = 0;
+    return &dss->ctrls[dss->numCtrls++];
+}
+
+/* Returns 0 when the request was emulated, -1 to keep the driver's error */
+static int fake_dss_ioctl(int fd, unsigned long request, void* arg)
+{
+    if ((fd < 0) || (fd >= MAX_FAKE_FDS) || (gFake[fd].pipeline == 0)) {
+        return -1;
+    }
+    fake_dss_t* dss = &gFake[fd];
+
+    switch (request) {
+    case VIDIOC_G_FMT:
+    case VIDIOC_S_FMT: {
+        struct v4l2_format* fmt = (struct v4l2_format*)arg;
+        int set = (request == VIDIOC_S_FMT);
+        if (fmt->type == V4L2_BUF_TYPE_VIDEO_OVERLAY) {
+            if (!dss->hasWindow) {
+                memset(&dss->window, 0, sizeof(dss->window));
+                dss->window.type = V4L2_BUF_TYPE_VIDEO_OVERLAY;
+                dss->window.fmt.win.w.width = LCD_WIDTH;
+                dss->window.fmt.win.w.height = LCD_HEIGHT;
+                dss->hasWindow = 1;
+            }
+            if (set) {
+                dss->window = *fmt;
+            } else {
+                *fmt = dss->window;
+            }
+            return 0;
+        }
+        if (fmt->type == V4L2_BUF_TYPE_PRIVATE) {
+            if (set) {
+                dss->priv = *fmt;
+                dss->hasPrivate = 1;
+            } else if (dss->hasPrivate) {
+                *fmt = dss->priv;
+            } else {
+                memset(fmt->fmt.raw_data, 0, sizeof(fmt->fmt.raw_data));
+            }
+            return 0;
+        }
+        return -1;
+    }
+    case VIDIOC_G_CROP:
+    case VIDIOC_S_CROP: {
+        struct v4l2_crop* crop = (struct v4l2_crop*)arg;
+        if (request == VIDIOC_S_CROP) {
+            dss->crop = *crop;
+            dss->hasCrop = 1;
+            return 0;
+        }
+        if (!dss->hasCrop) {
+            struct v4l2_format fmt;
+            memset(&fmt, 0, sizeof(fmt));
+            fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+            if (__real_ioctl(fd, VIDIOC_G_FMT, &fmt) < 0) {
+                return -1;
+            }
+            memset(&dss->crop, 0, sizeof(dss->crop));
+            dss->crop.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+            dss->crop.c.width = fmt.fmt.pix.width;
+            dss->crop.c.height = fmt.fmt.pix.height;
+            dss->hasCrop = 1;
+        }
+        *crop = dss->crop;
+        return 0;
+    }
+    case VIDIOC_G_CTRL:
+    case VIDIOC_S_CTRL: {
+        struct v4l2_control* ctrl = (struct v4l2_control*)arg;
+        if (ctrl->id == V4L2_CID_TI_DISPC_OVERLAY) {
+            if (request == VIDIOC_S_CTRL) {
+                return -1;
+            }
+            ctrl->value = dss->pipeline;
+            return 0;
+        }
+        fake_ctrl_t* value = fake_ctrl(dss, ctrl->id);
+        if (value == NULL) {
+            return -1;
+        }
+        if (request == VIDIOC_S_CTRL) {
+            value->value = ctrl->value;
+        } else {
+            ctrl->value = value->value;
+        }
+        return 0;
+    }
+    case VIDIOC_G_FBUF:
+        *(struct v4l2_framebuffer*)arg = dss->fbuf;
+        return 0;
+    case VIDIOC_S_FBUF:
+        dss->fbuf = *(struct v4l2_framebuffer*)arg;
+        return 0;
+    }
+
+    return -1;
+}
+
+extern "C" int __wrap_ioctl(int fd, unsigned long request, ...)
+{
+    va_list ap;
+    va_start(ap, request);
+    void* arg = va_arg(ap, void*);
+    va_end(ap);
+
+    int ret = __real_ioctl(fd, request, arg);
+    if ((ret < 0) && ((errno == EINVAL) || (errno == ENOTTY))) {
+        int saved = errno;
+        if (fake_dss_ioctl(fd, request, arg) == 0) {
+            gEmulated++;
+            return 0;
+        }
+        errno = saved;
+    }
+    return ret;
+}
+
+// ****************************************************************************
+// Fake omapdss sysfs tree
+// ****************************************************************************
+
+static char gRoot[PATH_MAX];
+
+static void mkdirs(const char* path)
+{
+    char tmp[PATH_MAX];
+    strcpy(tmp, path);
+    for (char* p = tmp + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(tmp, 0755);
+            *p = '/';
+        }
+    }
+    mkdir(tmp, 0755);
+}
+
+static void fake_attr(const char* attr, const char* value)
+{
+    char path[PATH_MAX];
+    snprintf(path, PATH_MAX, "%s%s", gRoot, attr);
+    *strrchr(path, '/') = '\0';
+    mkdirs(path);
+    snprintf(path, PATH_MAX, "%s%s", gRoot, attr);
+    FILE* f = fopen(path, "w");
+    if (f) {
+        fprintf(f, "%s\n", value);
+        fclose(f);
+    }
+}
+
+static int create_fake_sysfs(const char* tmpdir)
+{
+#ifdef TARGET_OMAP4
+    static const char* displays[] = { "lcd", "lcd2", "hdmi" };
+    static const char* managers[] = { "lcd", "2lcd", "tv" };
+#else
+    static const char* displays[] = { "lcd", "tv", "dvi" };
+    static const char* managers[] = { "lcd", "tv" };
+#endif
+    char attr[PATH_MAX];
+    unsigned int i;
+
+    snprintf(gRoot, PATH_MAX, "%s/omapdss_XXXXXX", tmpdir);
+    if (mkdtemp(gRoot) == NULL) {
+        printf("can't create %s\n", gRoot);
+        return -1;
+    }
+
+    for (i = 0; i < 4; i++) {
+        sprintf(attr, OMAPDSS "/overlay%d/manager", i);
+        fake_attr(attr, "lcd");
+        sprintf(attr, OMAPDSS "/overlay%d/enabled", i);
+        fake_attr(attr, i ? "0" : "1");
+    }
+    fake_attr(OMAPDSS "/overlay0/color_mode", "0");
+
+    for (i = 0; i < sizeof(managers) / sizeof(managers[0]); i++) {
+        sprintf(attr, OMAPDSS "/manager%d/name", i);
+        fake_attr(attr, managers[i]);
+        sprintf(attr, OMAPDSS "/manager%d/display", i);
+        fake_attr(attr, displays[i]);
+        sprintf(attr, OMAPDSS "/manager%d/trans_key_enabled", i);
+        fake_attr(attr, "0");
+        sprintf(attr, OMAPDSS "/manager%d/trans_key_type", i);
+        fake_attr(attr, "gfx-destination");
+        sprintf(attr, OMAPDSS "/manager%d/trans_key_value", i);
+        fake_attr(attr, "0");
+    }
+
+    for (i = 0; i < sizeof(displays) / sizeof(displays[0]); i++) {
+        sprintf(attr, OMAPDSS "/display%d/name", i);
+        fake_attr(attr, displays[i]);
+        sprintf(attr, OMAPDSS "/display%d/enabled", i);
+        fake_attr(attr, i ? "0" : "1");
+        sprintf(attr, OMAPDSS "/display%d/timings", i);
+        fake_attr(attr, "26000,800/24/40/72,480/3/1/4");
+        sprintf(attr, OMAPDSS "/display%d/code", i);
+        fake_attr(attr, "CEA:4");
+    }
+
+    sysfs_cache().setRoot(gRoot);
+    return 0;
+}
+
+static void remove_fake_sysfs()
+{
+    char cmd[PATH_MAX + 16];
+    sysfs_cache().setRoot(NULL);
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", gRoot);
+    system(cmd);
+}
+
+// ****************************************************************************
+// Measurements
+// ****************************************************************************
+
+struct samples_t {
+    uint32_t* us;
+    int count;
+    int max;
+};
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void samples_init(samples_t* s, int max)
+{
+    s->us = (uint32_t*)calloc(max, sizeof(uint32_t));
+    s->count = 0;
+    s->max = max;
+}
+
+static void samples_add(samples_t* s, uint64_t us)
+{
+    if (s->count < s->max) {
+        s->us[s->count++] = (uint32_t)us;
+    }
+}
+
+static int compare_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+/* Prints avg/p50/p99/max and returns p99 */
+static uint32_t samples_report(const char* name, samples_t* s)
+{
+    if (s->count == 0) {
+        printf("%-10s no samples\n", name);
+        return 0;
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < s->count; i++) {
+        total += s->us[i];
+    }
+    qsort(s->us, s->count, sizeof(uint32_t), compare_u32);
+
+    uint32_t p99 = s->us[(s->count * 99) / 100];
+    printf("%-10s n %5d  avg %7llu  p50 %7u  p99 %7u  max %7u us\n", name, s->count,
+           (unsigned long long)(total / s->count), s->us[s->count / 2], p99, s->us[s->count - 1]);
+    return p99;
+}
+
+static int failures = 0;
+
+#define STEP(name, cond) \
+    do { \
+        uint64_t _start = now_us(); \
+        int _ok = (cond); \
+        printf("%-24s %s  %6llu us\n", name, _ok ? "ok    " : "FAILED", \
+               (unsigned long long)(now_us() - _start)); \
+        if (!_ok) failures++; \
+    } while (0)
+
+// ****************************************************************************
+// Scenario
+// ****************************************************************************
+
+int main(int argc, char* argv[])
+{
+    const char* tmpdir = "/tmp";
+    uint32_t width = 320;
+    uint32_t height = 240;
+    int frames = 300;
+    int fps = 30;
+    int resize = 0;
+    int maxLatencyMs = 0;
+    int opt;
+
+    gDevice = "/dev/video0";
+    while ((opt = getopt(argc, argv, "d:n:r:w:h:t:Rl:")) != -1) {
+        switch (opt) {
+            case 'd': gDevice = optarg; break;
+            case 'n': frames = atoi(optarg); break;
+            case 'r': fps = atoi(optarg); break;
+            case 'w': width = atoi(optarg); break;
+            case 'h': height = atoi(optarg); break;
+            case 't': tmpdir = optarg; break;
+            case 'R': resize = 1; break;
+            case 'l': maxLatencyMs = atoi(optarg); break;
+            default:
+                printf("usage: %s [-d device] [-n frames] [-r fps] [-w width] [-h height]"
+                       " [-t tmpdir] [-R] [-l max_latency_ms]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (fps <= 0) {
+        fps = 30;
+    }
+
+    if (create_fake_sysfs(tmpdir)) {
+        return 1;
+    }
+
+    printf("overlay host harness: %s, %ux%u, %d frames @ %d fps, fake sysfs %s\n\n",
+           gDevice, width, height, frames, fps, gRoot);
+
+    hw_module_t* module = &HAL_MODULE_INFO_SYM.common;
+    overlay_control_device_t* ctrl = NULL;
+    overlay_data_device_t* data = NULL;
+    overlay_t* overlay = NULL;
+    int numBuffers = 0;
+
+    // control side, as SurfaceFlinger does it
+    STEP("open control", module->methods->open(module, OVERLAY_HARDWARE_CONTROL,
+                                               (hw_device_t**)&ctrl) == 0);
+    if (ctrl == NULL) {
+        goto done;
+    }
+    STEP("createOverlay", (overlay = ctrl->createOverlay(ctrl, width, height,
+                                                         OVERLAY_FORMAT_YCbYCr_422_I)) != NULL);
+    if (overlay == NULL) {
+        goto close_ctrl;
+    }
+    STEP("setPosition", ctrl->setPosition(ctrl, overlay, 0, 0, LCD_WIDTH, LCD_HEIGHT) == 0);
+    STEP("setParameter", ctrl->setParameter(ctrl, overlay, OVERLAY_TRANSFORM, 0) == 0);
+    STEP("stage", ctrl->stage(ctrl, overlay) == 0);
+    STEP("commit", ctrl->commit(ctrl, overlay) == 0);
+
+    // data side, as a video renderer does it
+    STEP("open data", module->methods->open(module, OVERLAY_HARDWARE_DATA,
+                                            (hw_device_t**)&data) == 0);
+    if (data == NULL) {
+        goto destroy;
+    }
+    STEP("initialize", data->initialize(data, overlay->getHandleRef(overlay)) == 0);
+    STEP("setCrop", data->setCrop(data, 0, 0, width, height) == 0);
+    STEP("getBufferCount", (numBuffers = data->getBufferCount(data)) > 0);
+    for (int i = 0; i < numBuffers; i++) {
+        mapping_data_t* map = (mapping_data_t*)data->getBufferAddress(data, (overlay_buffer_t)i);
+        if ((map == NULL) || (map->ptr == NULL)) {
+            printf("getBufferAddress(%d)         FAILED\n", i);
+            failures++;
+            numBuffers = 0;
+        }
+    }
+
+    if (numBuffers > 0) {
+        samples_t queueLat, dequeueLat, interval;
+        int freeList[NUM_OVERLAY_BUFFERS_MAX];
+        int freeCount = 0;
+        int late = 0;
+        int dropped = 0;
+        uint64_t period = 1000000 / fps;
+        uint64_t next, lastDisplay = 0, start;
+
+        samples_init(&queueLat, frames);
+        samples_init(&dequeueLat, frames);
+        samples_init(&interval, frames);
+        for (int i = 0; i < numBuffers; i++) {
+            freeList[freeCount++] = i;
+        }
+
+        printf("\nstreaming %d buffers\n", numBuffers);
+        start = next = now_us();
+
+        for (int frame = 0; frame < frames; frame++) {
+            if (resize && (frame == frames / 2)) {
+                STEP("resizeInput", data->resizeInput(data, width / 2, height / 2) == 0);
+                STEP("setCrop", data->setCrop(data, 0, 0, width / 2, height / 2) == 0);
+                // resizeInput stops the stream, every buffer is ours again
+                freeCount = 0;
+                for (int i = 0; i < numBuffers; i++) {
+                    freeList[freeCount++] = i;
+                }
+            }
+
+            // renderer pacing
+            uint64_t now = now_us();
+            if (now < next) {
+                usleep(next - now);
+            } else if (now > next + period / 2) {
+                late++;
+            }
+            next += period;
+
+            if (freeCount == 0) {
+                dropped++;
+                continue;
+            }
+            int index = freeList[--freeCount];
+
+            uint64_t t = now_us();
+            int rc = data->queueBuffer(data, (overlay_buffer_t)index);
+            samples_add(&queueLat, now_us() - t);
+            if (rc < 0) {
+                freeList[freeCount++] = index;
+                dropped++;
+                continue;
+            }
+
+            if (rc >= NUM_BUFFERS_TO_BE_QUEUED_FOR_OPTIMAL_PERFORMANCE) {
+                overlay_buffer_t buffer;
+                t = now_us();
+                if (data->dequeueBuffer(data, &buffer) == 0) {
+                    uint64_t done = now_us();
+                    samples_add(&dequeueLat, done - t);
+                    if (lastDisplay) {
+                        samples_add(&interval, done - lastDisplay);
+                    }
+                    lastDisplay = done;
+                    freeList[freeCount++] = (int)buffer;
+                }
+            }
+        }
+
+        uint64_t elapsed = now_us() - start;
+        printf("\n%.2f fps (target %d), %d late, %d dropped\n",
+               (frames - dropped) * 1000000.0 / elapsed, fps, late, dropped);
+
+        uint32_t qp99 = samples_report("queue", &queueLat);
+        uint32_t dqp99 = samples_report("dequeue", &dequeueLat);
+        samples_report("interval", &interval);
+
+        if (interval.count > 1) {
+            double mean = 0, var = 0;
+            for (int i = 0; i < interval.count; i++) {
+                mean += interval.us[i];
+            }
+            mean /= interval.count;
+            for (int i = 0; i < interval.count; i++) {
+                var += (interval.us[i] - mean) * (interval.us[i] - mean);
+            }
+            printf("%-10s stddev %.0f us (%.1f%% of the period)\n", "interval",
+                   sqrt(var / interval.count), 100.0 * sqrt(var / interval.count) / period);
+        }
+
+        if (maxLatencyMs && ((qp99 > (uint32_t)maxLatencyMs * 1000) ||
+                             (dqp99 > (uint32_t)maxLatencyMs * 1000))) {
+            printf("p99 latency above %d ms\n", maxLatencyMs);
+            failures++;
+        }
+        printf("\n");
+    }
+
+    STEP("close data", data->common.close(&data->common) == 0);
+destroy:
+    ctrl->destroyOverlay(ctrl, overlay);
+close_ctrl:
+    STEP("close control", ctrl->common.close(&ctrl->common) == 0);
+done:
+    printf("\nsysfs: %u writes, %u skipped, %u opens; %u emulated DSS ioctls\n",
+           sysfs_cache().getWriteCount(), sysfs_cache().getSkipCount(),
+           sysfs_cache().getOpenCount(), gEmulated);
+    printf("%d failures\n", failures);
+
+    remove_fake_sysfs();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Stands in for the OMAP kernel videodev header when liboverlay is built
+ * for the host test harness (overlay_host_test). Only used through
+ * LOCAL_C_INCLUDES of that module.
+ */
+
+#ifndef TIOVERLAY_HOST_VIDEODEV_H_
+#define TIOVERLAY_HOST_VIDEODEV_H_
+
+#include <linux/videodev2.h>
+
+#ifndef PAGE_SIZE
+#define PAGE_SIZE 4096
+#endif
+
+/* Upstream struct v4l2_window has no OMAP zorder field. v4l2_utils leaves
+ * it alone on the host, the harness emulates the overlay window anyway. */
+#define TIOVERLAY_HOST_NO_ZORDER 1
+
+#endif  // TIOVERLAY_HOST_VIDEODEV_H_
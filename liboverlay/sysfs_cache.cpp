@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#define LOG_TAG "TIOverlay"
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cutils/log.h>
+#include "sysfs_cache.h"
+
+static SysfsCache gSysfsCache;
+
+SysfsCache& sysfs_cache()
+{
+    return gSysfsCache;
+}
+
+int sysfile_write(const char* pathname, const void* buf, size_t size)
+{
+    return gSysfsCache.write(pathname, buf, size);
+}
+
+int sysfile_read(const char* pathname, void* buf, size_t size)
+{
+    return gSysfsCache.read(pathname, buf, size);
+}
+
+/* Length of the value without the terminating NUL or trailing newline */
+static size_t value_length(const char* buf, size_t size)
+{
+    size_t len = strnlen(buf, size);
+    while ((len > 0) && (buf[len - 1] == '\n')) {
+        len--;
+    }
+    return len;
+}
+
+static bool is_volatile_attribute(const char* pathname)
+{
+    static const char* suffix[] = { "/enabled", "/timings", "/manager" };
+    size_t len = strlen(pathname);
+
+    for (size_t i = 0; i < sizeof(suffix) / sizeof(suffix[0]); i++) {
+        size_t slen = strlen(suffix[i]);
+        if ((len >= slen) && !strcmp(pathname + len - slen, suffix[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Used when the cache table is full, same as the historical helpers */
+static int sysfile_write_uncached(const char* pathname, const void* buf, size_t size)
+{
+    int fd = open(pathname, O_WRONLY);
+    if (fd == -1) {
+        LOGE("Can't open [%s]", pathname);
+        return -1;
+    }
+    ssize_t written_size = ::write(fd, buf, size);
+    close(fd);
+    if (written_size <= 0) {
+        LOGE("Can't write [%s]", pathname);
+        return -1;
+    }
+    return 0;
+}
+
+static int sysfile_read_uncached(const char* pathname, void* buf, size_t size)
+{
+    int fd = open(pathname, O_RDONLY);
+    if (fd == -1) {
+        LOGE("Can't open the file[%s]", pathname);
+        return -1;
+    }
+    ssize_t bytesread = ::read(fd, buf, size);
+    close(fd);
+    if (bytesread < 0) {
+        LOGE("cant read from file[%s]", pathname);
+        return -1;
+    }
+    return bytesread;
+}
+
+int SysfsBatch::add(const char* pathname, const char* value)
+{
+    for (int i = 0; i < count; i++) {
+        if (!strcmp(path[i], pathname)) {
+            strncpy(this->value[i], value, SYSFS_CACHE_VALUE_MAX - 1);
+            this->value[i][SYSFS_CACHE_VALUE_MAX - 1] = '\0';
+            return 0;
+        }
+    }
+
+    if (count >= SYSFS_BATCH_MAX) {
+        LOGE("sysfs batch full, dropping [%s]", pathname);
+        return -1;
+    }
+
+    path[count] = pathname;
+    strncpy(this->value[count], value, SYSFS_CACHE_VALUE_MAX - 1);
+    this->value[count][SYSFS_CACHE_VALUE_MAX - 1] = '\0';
+    count++;
+    return 0;
+}
+
+SysfsCache::SysfsCache()
+    : mRoot(NULL), mCount(0), mWrites(0), mSkips(0), mOpens(0)
+{
+    pthread_mutex_init(&mLock, NULL);
+}
+
+SysfsCache::~SysfsCache()
+{
+    pthread_mutex_lock(&mLock);
+    reset_locked();
+    free(mRoot);
+    pthread_mutex_unlock(&mLock);
+    pthread_mutex_destroy(&mLock);
+}
+
+void SysfsCache::reset_locked()
+{
+    for (int i = 0; i < mCount; i++) {
+        if (mEntries[i].rdfd >= 0) {
+            close(mEntries[i].rdfd);
+        }
+        if (mEntries[i].wrfd >= 0) {
+            close(mEntries[i].wrfd);
+        }
+    }
+    mCount = 0;
+}
+
+void SysfsCache::setRoot(const char* root)
+{
+    pthread_mutex_lock(&mLock);
+    reset_locked();
+    free(mRoot);
+    mRoot = root ? strdup(root) : NULL;
+    pthread_mutex_unlock(&mLock);
+}
+
+/* Attribute name below SYSFS_OMAPDSS_PATH, NULL for any other path */
+static const char* attribute_name(const char* pathname)
+{
+    static const size_t prefix = sizeof(SYSFS_OMAPDSS_PATH) - 1;
+
+    if (strncmp(pathname, SYSFS_OMAPDSS_PATH, prefix)) {
+        return NULL;
+    }
+    return pathname + prefix;
+}
+
+void SysfsCache::invalidate(const char* pathname)
+{
+    const char* name = pathname ? attribute_name(pathname) : NULL;
+
+    pthread_mutex_lock(&mLock);
+    for (int i = 0; i < mCount; i++) {
+        if ((pathname == NULL) || (name && !strcmp(mEntries[i].name, name))) {
+            mEntries[i].known = false;
+        }
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+SysfsCache::Entry* SysfsCache::lookup_locked(const char* pathname)
+{
+    const char* name = attribute_name(pathname);
+
+    if (name == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < mCount; i++) {
+        if (!strcmp(mEntries[i].name, name)) {
+            return &mEntries[i];
+        }
+    }
+
+    if ((mCount >= SYSFS_CACHE_MAX_ENTRIES) || (strlen(name) >= SYSFS_CACHE_NAME_MAX)) {
+        LOGE("sysfs cache can't track [%s]", pathname);
+        return NULL;
+    }
+
+    Entry* entry = &mEntries[mCount++];
+    strcpy(entry->name, name);
+    entry->rdfd = -1;
+    entry->wrfd = -1;
+    entry->known = false;
+    entry->isVolatile = is_volatile_attribute(pathname);
+    entry->value[0] = '\0';
+    return entry;
+}
+
+int SysfsCache::open_locked(const char* name, int flags)
+{
+    char fullpath[PATH_MAX];
+
+    snprintf(fullpath, PATH_MAX, "%s" SYSFS_OMAPDSS_PATH "%s", mRoot ? mRoot : "", name);
+    int fd = open(fullpath, flags);
+    if (fd < 0) {
+        LOGE("Can't open [%s]", fullpath);
+        return -1;
+    }
+    mOpens++;
+    return fd;
+}
+
+int SysfsCache::read_locked(Entry* entry, void* buf, size_t size)
+{
+    if (entry->rdfd < 0) {
+        entry->rdfd = open_locked(entry->name, O_RDONLY);
+        if (entry->rdfd < 0) {
+            return -1;
+        }
+    }
+
+    // sysfs refills the attribute buffer on every read at offset 0
+    ssize_t bytesread = pread(entry->rdfd, buf, size, 0);
+    if (bytesread < 0) {
+        LOGE("cant read from file[" SYSFS_OMAPDSS_PATH "%s]", entry->name);
+        close(entry->rdfd);
+        entry->rdfd = -1;
+        entry->known = false;
+        return -1;
+    }
+
+    if ((size_t)bytesread < size) {
+        ((char*)buf)[bytesread] = '\0';
+    }
+
+    size_t len = value_length((const char*)buf, bytesread);
+    if (len < SYSFS_CACHE_VALUE_MAX) {
+        memcpy(entry->value, buf, len);
+        entry->value[len] = '\0';
+        entry->known = true;
+    } else {
+        entry->known = false;
+    }
+
+    return bytesread;
+}
+
+int SysfsCache::write_locked(Entry* entry, const char* value, size_t len)
+{
+    char current[SYSFS_CACHE_VALUE_MAX];
+
+    if (len < SYSFS_CACHE_VALUE_MAX) {
+        if (entry->isVolatile && (read_locked(entry, current, sizeof(current) - 1) < 0)) {
+            entry->known = false;
+        }
+        if (entry->known && (strlen(entry->value) == len) &&
+            !memcmp(entry->value, value, len)) {
+            mSkips++;
+            return 0;
+        }
+    }
+
+    if (entry->wrfd < 0) {
+        entry->wrfd = open_locked(entry->name, O_WRONLY);
+        if (entry->wrfd < 0) {
+            return -1;
+        }
+    }
+
+    ssize_t written_size = pwrite(entry->wrfd, value, len, 0);
+    if (written_size <= 0) {
+        LOGE("Can't write [" SYSFS_OMAPDSS_PATH "%s]", entry->name);
+        close(entry->wrfd);
+        entry->wrfd = -1;
+        entry->known = false;
+        return -1;
+    }
+
+    if (mRoot) {
+        // a fake tree is made of regular files, drop the tail of longer values
+        ftruncate(entry->wrfd, len);
+    }
+
+    mWrites++;
+    if (len < SYSFS_CACHE_VALUE_MAX) {
+        memcpy(entry->value, value, len);
+        entry->value[len] = '\0';
+        entry->known = true;
+    } else {
+        entry->known = false;
+    }
+    return 0;
+}
+
+int SysfsCache::read(const char* pathname, void* buf, size_t size)
+{
+    char fullpath[PATH_MAX];
+    int ret;
+
+    pthread_mutex_lock(&mLock);
+    Entry* entry = lookup_locked(pathname);
+    if (entry) {
+        ret = read_locked(entry, buf, size);
+    } else {
+        snprintf(fullpath, PATH_MAX, "%s%s", mRoot ? mRoot : "", pathname);
+        ret = sysfile_read_uncached(fullpath, buf, size);
+    }
+    pthread_mutex_unlock(&mLock);
+    return ret;
+}
+
+int SysfsCache::write(const char* pathname, const void* buf, size_t size)
+{
+    char fullpath[PATH_MAX];
+    size_t len = value_length((const char*)buf, size);
+    int ret;
+
+    pthread_mutex_lock(&mLock);
+    Entry* entry = lookup_locked(pathname);
+    if (entry) {
+        ret = write_locked(entry, (const char*)buf, len);
+    } else {
+        snprintf(fullpath, PATH_MAX, "%s%s", mRoot ? mRoot : "", pathname);
+        ret = sysfile_write_uncached(fullpath, buf, len);
+    }
+    pthread_mutex_unlock(&mLock);
+    return ret;
+}
+
+int SysfsCache::apply(SysfsBatch& batch)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&mLock);
+    for (int i = 0; i < batch.count; i++) {
+        Entry* entry = lookup_locked(batch.path[i]);
+        size_t len = value_length(batch.value[i], SYSFS_CACHE_VALUE_MAX);
+        char fullpath[PATH_MAX];
+        int err;
+
+        if (entry) {
+            err = write_locked(entry, batch.value[i], len);
+        } else {
+            snprintf(fullpath, PATH_MAX, "%s%s", mRoot ? mRoot : "", batch.path[i]);
+            err = sysfile_write_uncached(fullpath, batch.value[i], len);
+        }
+        if (err) {
+            LOGE("sysfs batch write [%s]=[%s] failed", batch.path[i], batch.value[i]);
+            ret = -1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mLock);
+
+    batch.count = 0;
+    return ret;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef TIOVERLAY_SYSFS_CACHE_H_
+#define TIOVERLAY_SYSFS_CACHE_H_
+
+#include <pthread.h>
+#include <limits.h>
+#include <sys/types.h>
+
+#define SYSFS_CACHE_MAX_ENTRIES  48
+#define SYSFS_CACHE_NAME_MAX     32
+#define SYSFS_CACHE_VALUE_MAX    64
+#define SYSFS_OMAPDSS_PATH       "/sys/devices/platform/omapdss/"
+#define SYSFS_BATCH_MAX          8
+
+/** Writes collected during one overlay commit. Applied in order by
+ * SysfsCache::apply(), repeated writes to the same attribute collapse
+ * into the last one.
+ */
+class SysfsBatch {
+public:
+    SysfsBatch() : count(0) {}
+    int add(const char* pathname, const char* value);
+
+    int count;
+    const char* path[SYSFS_BATCH_MAX];
+    char value[SYSFS_BATCH_MAX][SYSFS_CACHE_VALUE_MAX];
+};
+
+/** Keeps one persistent fd per omapdss sysfs attribute and the last value
+ * seen on it, so repeated reads avoid open/close and writes that would not
+ * change anything are skipped.
+ *
+ * Attributes the kernel or other clients change behind our back (enabled,
+ * timings, overlay manager) are re-read through the cached fd before a
+ * write is skipped. Everything else trusts the last written value.
+ *
+ * Entries keep the attribute name relative to SYSFS_OMAPDSS_PATH, paths
+ * outside of it or longer than SYSFS_CACHE_NAME_MAX go uncached.
+ */
+class SysfsCache {
+public:
+    SysfsCache();
+    ~SysfsCache();
+
+    /** Redirects every path below "root", used to run against a fake
+     * sysfs tree. Drops all cached fds and values. */
+    void setRoot(const char* root);
+
+    int read(const char* pathname, void* buf, size_t size);
+    int write(const char* pathname, const void* buf, size_t size);
+    int apply(SysfsBatch& batch);
+
+    /** Forgets the cached value of one attribute, or all when NULL */
+    void invalidate(const char* pathname);
+
+    unsigned int getWriteCount() const { return mWrites; }
+    unsigned int getSkipCount() const { return mSkips; }
+    unsigned int getOpenCount() const { return mOpens; }
+
+private:
+    struct Entry {
+        char name[SYSFS_CACHE_NAME_MAX];
+        int rdfd;
+        int wrfd;
+        bool known;
+        bool isVolatile;
+        char value[SYSFS_CACHE_VALUE_MAX];
+    };
+
+    Entry* lookup_locked(const char* pathname);
+    int open_locked(const char* name, int flags);
+    int read_locked(Entry* entry, void* buf, size_t size);
+    int write_locked(Entry* entry, const char* value, size_t len);
+    void reset_locked();
+
+    pthread_mutex_t mLock;
+    char* mRoot;
+    int mCount;
+    Entry mEntries[SYSFS_CACHE_MAX_ENTRIES];
+
+    unsigned int mWrites;
+    unsigned int mSkips;
+    unsigned int mOpens;
+};
+
+SysfsCache& sysfs_cache();
+
+int sysfile_write(const char* pathname, const void* buf, size_t size);
+int sysfile_read(const char* pathname, void* buf, size_t size);
+
+#endif  // TIOVERLAY_SYSFS_CACHE_H_
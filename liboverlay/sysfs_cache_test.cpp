@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Runs the sysfs cache against a fake omapdss tree in a temp directory:
+ *   sysfs_cache_test [tmpdir]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "sysfs_cache.h"
+
+#define OMAPDSS "/sys/devices/platform/omapdss"
+
+static int failures = 0;
+static char root[PATH_MAX];
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+static void mkdirs(const char* path)
+{
+    char tmp[PATH_MAX];
+    strcpy(tmp, path);
+    for (char* p = tmp + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(tmp, 0755);
+            *p = '/';
+        }
+    }
+    mkdir(tmp, 0755);
+}
+
+static void fake_attr(const char* attr, const char* value)
+{
+    char path[PATH_MAX];
+    sprintf(path, "%s%s", root, attr);
+    *strrchr(path, '/') = '\0';
+    mkdirs(path);
+    sprintf(path, "%s%s", root, attr);
+    FILE* f = fopen(path, "w");
+    fprintf(f, "%s\n", value);
+    fclose(f);
+}
+
+static void fake_value(const char* attr, char* value)
+{
+    char path[PATH_MAX];
+    sprintf(path, "%s%s", root, attr);
+    FILE* f = fopen(path, "r");
+    value[0] = '\0';
+    if (f) {
+        fgets(value, PATH_MAX, f);
+        strtok(value, "\n");
+        fclose(f);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    char value[PATH_MAX];
+    SysfsCache& cache = sysfs_cache();
+    unsigned int writes, opens;
+
+    snprintf(root, PATH_MAX, "%s/sysfs_cache_XXXXXX", (argc > 1) ? argv[1] : "/tmp");
+    if (mkdtemp(root) == NULL) {
+        printf("can't create %s\n", root);
+        return 1;
+    }
+
+    fake_attr(OMAPDSS "/overlay1/manager", "lcd");
+    fake_attr(OMAPDSS "/overlay1/enabled", "1");
+    fake_attr(OMAPDSS "/manager0/display", "lcd");
+    fake_attr(OMAPDSS "/display0/enabled", "1");
+    fake_attr(OMAPDSS "/display1/enabled", "0");
+    cache.setRoot(root);
+
+    // reads go through one persistent fd
+    for (int i = 0; i < 100; i++) {
+        CHECK(sysfile_read(OMAPDSS "/overlay1/manager", value, PATH_MAX) > 0);
+    }
+    strtok(value, "\n");
+    CHECK(!strcmp(value, "lcd"));
+    CHECK(cache.getOpenCount() == 1);
+
+    // writing the current value is skipped
+    writes = cache.getWriteCount();
+    CHECK(sysfile_write(OMAPDSS "/overlay1/manager", "lcd", sizeof("lcd")) == 0);
+    CHECK(cache.getWriteCount() == writes);
+
+    // a real change reaches the file, shorter values don't keep stale bytes
+    CHECK(sysfile_write(OMAPDSS "/overlay1/manager", "2lcd", PATH_MAX) == 0);
+    CHECK(sysfile_write(OMAPDSS "/overlay1/manager", "tv", sizeof("tv")) == 0);
+    fake_value(OMAPDSS "/overlay1/manager", value);
+    CHECK(!strcmp(value, "tv"));
+
+    // volatile attributes notice changes made behind the cache
+    CHECK(sysfile_write(OMAPDSS "/overlay1/enabled", "0", sizeof("0")) == 0);
+    fake_attr(OMAPDSS "/overlay1/enabled", "1");
+    writes = cache.getWriteCount();
+    CHECK(sysfile_write(OMAPDSS "/overlay1/enabled", "0", sizeof("0")) == 0);
+    CHECK(cache.getWriteCount() == writes + 1);
+    fake_value(OMAPDSS "/overlay1/enabled", value);
+    CHECK(!strcmp(value, "0"));
+
+    // a panel switch batch only writes what differs, plus the first write
+    // to manager0/display whose value was never seen
+    SysfsBatch batch;
+    batch.add(OMAPDSS "/display1/enabled", "0");
+    batch.add(OMAPDSS "/overlay1/enabled", "0");
+    batch.add(OMAPDSS "/overlay1/manager", "lcd");
+    batch.add(OMAPDSS "/manager0/display", "lcd");
+    batch.add(OMAPDSS "/display0/enabled", "1");
+    writes = cache.getWriteCount();
+    CHECK(cache.apply(batch) == 0);
+    CHECK(cache.getWriteCount() == writes + 2);
+    fake_value(OMAPDSS "/overlay1/manager", value);
+    CHECK(!strcmp(value, "lcd"));
+
+    // repeating the same commit costs no write and no open
+    writes = cache.getWriteCount();
+    opens = cache.getOpenCount();
+    for (int i = 0; i < 100; i++) {
+        batch.add(OMAPDSS "/overlay1/manager", "lcd");
+        batch.add(OMAPDSS "/manager0/display", "lcd");
+        batch.add(OMAPDSS "/display0/enabled", "1");
+        CHECK(cache.apply(batch) == 0);
+    }
+    CHECK(cache.getWriteCount() == writes);
+    CHECK(cache.getOpenCount() == opens);
+
+    // paths outside omapdss still work, they just aren't cached
+    fake_attr("/sys/class/graphics/fb0/rotate", "0");
+    opens = cache.getOpenCount();
+    CHECK(sysfile_write("/sys/class/graphics/fb0/rotate", "1", sizeof("1")) == 0);
+    CHECK(sysfile_read("/sys/class/graphics/fb0/rotate", value, PATH_MAX) > 0);
+    CHECK(value[0] == '1');
+    CHECK(cache.getOpenCount() == opens);
+
+    // failures are reported and stop the batch
+    batch.add(OMAPDSS "/display9/enabled", "1");
+    CHECK(cache.apply(batch) < 0);
+
+    printf("%u writes, %u skipped, %u opens, %d failures\n",
+           cache.getWriteCount(), cache.getSkipCount(), cache.getOpenCount(), failures);
+
+    cache.setRoot(NULL);
+    sprintf(value, "rm -rf %s", root);
+    system(value);
+
+    return failures ? 1 : 0;
+}
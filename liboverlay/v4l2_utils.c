@@ -520,7 +520,9 @@ int v4l2_overlay_set_zorder(int fd, int value)
     if (ret)
         return ret;
 
+#ifndef TIOVERLAY_HOST_NO_ZORDER
     fmt.fmt.win.zorder = value & 0x3;
+#endif
     ret = v4l2_overlay_ioctl(fd, VIDIOC_S_FMT, &fmt, "set zorder");
     return ret;
 }
@@ -536,7 +538,11 @@ int v4l2_overlay_get_zorder(int fd, int* value)
     if (ret)
         return ret;
 
+#ifdef TIOVERLAY_HOST_NO_ZORDER
+    *value = 0;
+#else
     *value = fmt.fmt.win.zorder;
+#endif
     return ret;
 }
 
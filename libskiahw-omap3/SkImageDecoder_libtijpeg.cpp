@@ -33,6 +33,8 @@
 */
 
 #include "SkImageDecoder_libtijpeg.h"
+#include <stdlib.h>
+#include <cutils/properties.h>
 
 #define PRINTF // SkDebugf
 //#define PRINTF printf
@@ -116,6 +118,9 @@ OMX_ERRORTYPE OMX_EventHandler(OMX_HANDLETYPE hComponent,
 OMX_ERRORTYPE OMX_EmptyBufferDone(OMX_HANDLETYPE hComponent, OMX_PTR ptr, OMX_BUFFERHEADERTYPE* pBuffer)
 {
     SkTIJPEGImageDecoder * ImgDec = (SkTIJPEGImageDecoder *)ptr;
+    // chunks before the last one only go back to FeedInput()
+    if (!ImgDec->EmptyBufferDone(pBuffer))
+        return OMX_ErrorNone;
     ImgDec->iLastState = ImgDec->iState;
     ImgDec->iState = SkTIJPEGImageDecoder::STATE_EMPTY_BUFFER_DONE_CALLED;
     sem_post(ImgDec->semaphore) ;
@@ -164,14 +169,17 @@ SkTIJPEGImageDecoder::~SkTIJPEGImageDecoder()
         free(semaphore) ;
         semaphore = NULL;
     }
+    FreeInputChunks();
     gTIJpegDecMutex.unlock();
 }
 
 SkTIJPEGImageDecoder::SkTIJPEGImageDecoder()
 {
     mLoad = 0;
-    mDeleteAttempts = 0;
-    pInBuffHead = NULL;
+    for (int i = 0; i < INPUT_CHUNKS; i++) {
+        pInBuffHead[i] = NULL;
+        mInputChunk[i] = NULL;
+    }
     pOutBuffHead = NULL;
     pOMXHandle = NULL;
     mProgressive = 0;
@@ -182,6 +190,17 @@ SkTIJPEGImageDecoder::SkTIJPEGImageDecoder()
     //Initialize JpegDecoderParams structure
     memset((void*)&jpegDecParams, 0, sizeof(JpegDecoderParams));
 
+    char value[PROPERTY_VALUE_MAX];
+    property_get("debug.skiahw.jpegdec.chunk", value, "");
+    mChunkSize = (value[0] ? atoi(value) : INPUT_CHUNK_SIZE) * 1024;
+    mChunkSize = (OMX_U32)((mChunkSize + ALIGN_128_BYTE - 1) & ~(ALIGN_128_BYTE - 1));
+    mInputChunks = mChunkSize ? INPUT_CHUNKS : 1;
+    mInputChunkSize = 0;
+    mFeedSize = 0;
+    mChunksQueued = 0;
+    mStreamRead = 0;
+    mEosBuffHead = NULL;
+
     semaphore = (sem_t*)malloc(sizeof(sem_t)) ;
     sem_init(semaphore, 0x00, 0x00);
 
@@ -368,6 +387,8 @@ OMX_S32 SkTIJPEGImageDecoder::ParseJpegHeader (OMX_U8* JpgBuffer, OMX_S32 lSize,
         OMX_U8 *data = NULL;
 
         for ( a=0;a<15 /* 7 originally */;a++ ) {
+            if ( pos >= (OMX_U32)lSize )
+                return 0;
             marker = JpgBuffer[pos++];
             //PRINTF("MARKER IS %x\n",marker);
             if ( marker != 0xff )
@@ -380,6 +401,8 @@ OMX_S32 SkTIJPEGImageDecoder::ParseJpegHeader (OMX_U8* JpgBuffer, OMX_S32 lSize,
         }
 
         /* Read the length of the section.*/
+        if ( pos + 2 > (OMX_U32)lSize )
+            return 0;
         data = &JpgBuffer[pos];
         lh = data[0];
         ll = data[1];
@@ -391,6 +414,9 @@ OMX_S32 SkTIJPEGImageDecoder::ParseJpegHeader (OMX_U8* JpgBuffer, OMX_S32 lSize,
             return 0;
         }
 
+        /* a header that continues past the buffer is reported as no header */
+        if ( pos + itemlen > (OMX_U32)lSize )
+            return 0;
         pos += itemlen; /* Move position by the whole section.*/
 
         //PRINTF("Jpeg section marker 0x%02x size %d\n",marker, itemlen);
@@ -609,6 +635,11 @@ void SkTIJPEGImageDecoder::EventHandler(OMX_HANDLETYPE hComponent,
             }else{
                 PRINTF ("Libskiahw(decoder) already handling Error!!!");
             }
+            {
+                // FeedInput() may be waiting for a chunk that won't come back
+                android::Mutex::Autolock lock(mFeedLock);
+                mFeedCond.signal();
+            }
             break;
 
         default:
@@ -620,7 +651,15 @@ void SkTIJPEGImageDecoder::EventHandler(OMX_HANDLETYPE hComponent,
 
 OMX_S32 SkTIJPEGImageDecoder::fill_data(OMX_U8* pBuf, SkStream* stream, OMX_S32 bufferSize)
 {
-    OMX_U32 nFilledLen = stream->read(pBuf, bufferSize);
+    OMX_U32 nFilledLen = 0;
+    OMX_U32 nRead;
+
+    // slow streams return what they have, keep reading until the chunk is full or the stream ends
+    while (nFilledLen < (OMX_U32)bufferSize &&
+            (nRead = stream->read(pBuf + nFilledLen, bufferSize - nFilledLen)) > 0) {
+        nFilledLen += nRead;
+    }
+    mStreamRead += nFilledLen;
     PRINTF ("Populated Input Buffer: nAllocLen = %d, nFilledLen =%ld\n", bufferSize, nFilledLen);
 
 #if JPEG_DECODER_DUMP_INPUT_AND_OUTPUT
@@ -643,6 +682,89 @@ OMX_S32 SkTIJPEGImageDecoder::fill_data(OMX_U8* pBuf, SkStream* stream, OMX_S32
     return nFilledLen;
 }
 
+bool SkTIJPEGImageDecoder::AllocInputChunks(OMX_U32 size)
+{
+    if (size <= mInputChunkSize)
+        return true;
+
+    FreeInputChunks();
+    for (int i = 0; i < mInputChunks; i++) {
+        mInputChunk[i] = (OMX_U8*)memalign(ALIGN_128_BYTE, size);
+        if (mInputChunk[i] == NULL)
+            return false;
+    }
+    mInputChunkSize = size;
+    return true;
+}
+
+void SkTIJPEGImageDecoder::FreeInputChunks()
+{
+    mInputChunkSize = 0;
+    for (int i = 0; i < INPUT_CHUNKS; i++) {
+        free(mInputChunk[i]);
+        mInputChunk[i] = NULL;
+    }
+}
+
+bool SkTIJPEGImageDecoder::EmptyBufferDone(OMX_BUFFERHEADERTYPE* pBuffHead)
+{
+    android::Mutex::Autolock lock(mFeedLock);
+    mChunksQueued--;
+    mFeedCond.signal();
+    return pBuffHead == mEosBuffHead;
+}
+
+/* Runs in Run() once the component executes and the output buffer is queued.
+ * The first chunk was read with the header; every chunk the codec hands back
+ * is refilled from the stream and queued again, so the reads from a slow stream
+ * overlap with the decode. The chunk the stream ends in carries EOS, the
+ * decode ends on its EmptyBufferDone as before. */
+void SkTIJPEGImageDecoder::FeedInput()
+{
+    OMX_U32 streamLength = inStream->getLength();
+    int chunk = 0;
+
+    mFeedLock.lock();
+    mEosBuffHead = NULL;
+    mChunksQueued = 0;
+
+    for (;;) {
+        OMX_BUFFERHEADERTYPE* pBuffHead = pInBuffHead[chunk];
+        bool eos = mInputChunks == 1 || pBuffHead->nFilledLen < mFeedSize ||
+                   (streamLength && mStreamRead >= streamLength);
+
+        pBuffHead->nFlags = eos ? OMX_BUFFERFLAG_EOS : 0;
+        if (eos)
+            mEosBuffHead = pBuffHead;
+        mChunksQueued++;
+        mFeedLock.unlock();
+
+        OMX_EmptyThisBuffer(pOMXHandle, pInBuffHead[chunk]);
+        if (eos)
+            return;
+
+        chunk = (chunk + 1) % mInputChunks;
+
+        mFeedLock.lock();
+        while (mChunksQueued == mInputChunks && iState == STATE_EXECUTING) {
+            if (mFeedCond.waitRelative(mFeedLock, seconds(7)) != android::NO_ERROR) {
+                SkDebugf("\n%s():%d::Decoder timed out waiting for an input chunk",__FUNCTION__,__LINE__);
+                iState = STATE_ERROR;
+                sem_post(semaphore);
+            }
+        }
+        if (iState != STATE_EXECUTING) {
+            mFeedLock.unlock();
+            return;
+        }
+        mFeedLock.unlock();
+
+        // the codec is done with this chunk, read the next one while it works on the other
+        pInBuffHead[chunk]->nFilledLen = fill_data(mInputChunk[chunk], inStream, mFeedSize);
+        mFeedLock.lock();
+    }
+}
+
 bool SkTIJPEGImageDecoder::onDecode(SkImageDecoder* dec_impl, SkStream* stream, SkBitmap* bm, SkBitmap::Config prefConfig, SkImageDecoder::Mode mode)
 {
 
@@ -665,6 +787,7 @@ bool SkTIJPEGImageDecoder::onDecode(SkImageDecoder* dec_impl, SkStream* stream,
     int nOutWidth, nInWidth;
     int nOutHeight, nInHeight;
     OMX_S32 inputFileSize;
+    OMX_U32 inputChunkSize = 0;
     OMX_S32 nCompId = 100;
     OMX_U32 outBuffSize;
     OMX_U32 tempSize;
@@ -675,7 +798,6 @@ bool SkTIJPEGImageDecoder::onDecode(SkImageDecoder* dec_impl, SkStream* stream,
     OMX_CONFIG_SCALEFACTORTYPE ScaleFactor;
     OMX_CUSTOM_IMAGE_DECODE_SUBREGION SubRegionDecode;
     OMX_INDEXTYPE nCustomIndex = OMX_IndexMax;
-    void* inputBuffer = NULL;
     void* outputBuffer = NULL;
     char strTIJpegDec[] = "OMX.TI.JPEG.decoder";
     char strColorFormat[] = "OMX.TI.JPEG.decoder.Config.OutputColorFormat";
@@ -708,18 +830,29 @@ bool SkTIJPEGImageDecoder::onDecode(SkImageDecoder* dec_impl, SkStream* stream,
     if (SkImageDecoder::kDecodeBounds_Mode == mode) {
         inputFileSize = ParseJpegHeader(stream , &JpegHeaderInfo);
     }else{
-        inputFileSize = stream->getLength();
-        inputFileSize = (OMX_U32)((inputFileSize + ALIGN_128_BYTE - 1) & ~(ALIGN_128_BYTE - 1));
-        inputBuffer = memalign(ALIGN_128_BYTE, inputFileSize);
-        if (inputBuffer == NULL) {
+        // the first chunk goes to the header parser, the rest is read while the codec decodes.
+        // A stream shorter than a chunk goes in one piece.
+        mFeedSize = stream->getLength();
+        if (mChunkSize && (mFeedSize == 0 || mFeedSize > mChunkSize))
+            mFeedSize = mChunkSize;
+        inputChunkSize = (OMX_U32)((mFeedSize + ALIGN_128_BYTE - 1) & ~(ALIGN_128_BYTE - 1));
+        if (!AllocInputChunks(inputChunkSize)) {
             PRINTF("%s():%d::ERROR!!!: Could not allocate memory for inputBuffer.\n",__FUNCTION__,__LINE__);
             goto EXIT;
         }
 
         stream->rewind();
-        nRead = fill_data((OMX_U8*)inputBuffer, stream, stream->getLength());
-
-        inputFileSize = ParseJpegHeader((OMX_U8*)inputBuffer, inputFileSize, &JpegHeaderInfo);
+        mStreamRead = 0;
+        nRead = fill_data(mInputChunk[0], stream, mFeedSize);
+
+        inputFileSize = ParseJpegHeader(mInputChunk[0], nRead, &JpegHeaderInfo);
+        if (inputFileSize == 0 && mChunkSize && nRead == (int)mChunkSize) {
+            // the header is longer than a chunk (a big EXIF thumbnail), parse it from the stream
+            inputFileSize = ParseJpegHeader(stream, &JpegHeaderInfo);
+            stream->rewind();
+            mStreamRead = 0;
+            nRead = fill_data(mInputChunk[0], stream, mFeedSize);
+        }
     }
 
 #ifdef TIME_DECODE
@@ -817,8 +950,6 @@ bool SkTIJPEGImageDecoder::onDecode(SkImageDecoder* dec_impl, SkStream* stream,
     PRINTF("InPortDef.format.image.nFrameHeight = %d\n", InPortDef.format.image.nFrameHeight);
 
     if (SkImageDecoder::kDecodeBounds_Mode == mode) {
-        if(inputBuffer != NULL)
-            free(inputBuffer);
         gTIJpegDecMutex.unlock();
         PRINTF("Jpeg Header Parsing Done.\n");
         PRINTF("Leaving Critical Section 1 \n");
@@ -851,7 +982,7 @@ bool SkTIJPEGImageDecoder::onDecode(SkImageDecoder* dec_impl, SkStream* stream,
             mProgressive != JpegHeaderInfo.nProgressive ||
             InPortDef.format.image.eColorFormat != JPEGToOMXColorFormat(JpegHeaderInfo.nFormat) ||
             outBuffSize > OutPortDef.nBufferSize ||
-            (OMX_U32) inputFileSize > InPortDef.nBufferSize)
+            inputChunkSize > InPortDef.nBufferSize)
     {
         //reset the subregion decode flag for next decode to use the current OMX handle
         nSubRegDecode = false;
@@ -921,7 +1052,7 @@ bool SkTIJPEGImageDecoder::onDecode(SkImageDecoder* dec_impl, SkStream* stream,
         }
 
         InPortDef.eDir = OMX_DirInput;
-        InPortDef.nBufferCountActual =1;
+        InPortDef.nBufferCountActual = mInputChunks;
         InPortDef.nBufferCountMin = 1;
         InPortDef.bEnabled = OMX_TRUE;
         InPortDef.bPopulated = OMX_FALSE;
@@ -933,7 +1064,7 @@ bool SkTIJPEGImageDecoder::onDecode(SkImageDecoder* dec_impl, SkStream* stream,
         InPortDef.format.image.nSliceHeight = -1;
         InPortDef.format.image.bFlagErrorConcealment = OMX_FALSE;
         InPortDef.format.image.eCompressionFormat = OMX_IMAGE_CodingJPEG;
-        InPortDef.nBufferSize = inputFileSize;
+        InPortDef.nBufferSize = inputChunkSize;
 
         if (InPortDef.eDir == nIndex1 ) {
             InPortDef.nPortIndex = nIndex1;
@@ -1062,14 +1193,16 @@ bool SkTIJPEGImageDecoder::onDecode(SkImageDecoder* dec_impl, SkStream* stream,
             goto EXIT;
         }
 
-        eError = OMX_UseBuffer(pOMXHandle, &pInBuffHead,  InPortDef.nPortIndex,  (void *)&nCompId, InPortDef.nBufferSize, (OMX_U8*)inputBuffer);
-        if ( eError != OMX_ErrorNone ) {
-            PRINTF ("JPEGDec test:: %d:error= %x\n", __LINE__, eError);
-        iState = STATE_ERROR;
-            goto EXIT;
+        for (int i = 0; i < mInputChunks; i++) {
+            eError = OMX_UseBuffer(pOMXHandle, &pInBuffHead[i],  InPortDef.nPortIndex,  (void *)&nCompId, InPortDef.nBufferSize, mInputChunk[i]);
+            if ( eError != OMX_ErrorNone ) {
+                PRINTF ("JPEGDec test:: %d:error= %x\n", __LINE__, eError);
+            iState = STATE_ERROR;
+                goto EXIT;
+            }
         }
         // assign nFilledLen to actual amount read during fill_data
-        pInBuffHead->nFilledLen = nRead;
+        pInBuffHead[0]->nFilledLen = nRead;
 
         eError = OMX_UseBuffer(pOMXHandle, &pOutBuffHead,  OutPortDef.nPortIndex,  (void *)&nCompId, OutPortDef.nBufferSize, (OMX_U8*)outputBuffer);
         if ( eError != OMX_ErrorNone ) {
@@ -1163,9 +1296,12 @@ bool SkTIJPEGImageDecoder::onDecode(SkImageDecoder* dec_impl, SkStream* stream,
         pOutBuffHead->pBuffer = (OMX_U8*)outputBuffer;
         pOutBuffHead->nAllocLen = outBuffSize;
 
+        // the chunks move when the whole stream needs bigger ones
+        for (int i = 0; i < mInputChunks; i++) {
+            pInBuffHead[i]->pBuffer = mInputChunk[i];
+        }
         // assign nFilledLen to actual amount read during fill_data
-        pInBuffHead->nFilledLen = nRead;
-        pInBuffHead->pBuffer = (OMX_U8*)inputBuffer;
+        pInBuffHead[0]->nFilledLen = nRead;
 
         iState = STATE_EXECUTING;
         {
@@ -1179,8 +1315,9 @@ bool SkTIJPEGImageDecoder::onDecode(SkImageDecoder* dec_impl, SkStream* stream,
 #endif
 
     Run();
-    if(inputBuffer != NULL)
-        free(inputBuffer);
+    // a whole stream buffer is as big as the last JPEG, don't keep it around
+    if (mChunkSize == 0)
+        FreeInputChunks();
     gTIJpegDecMutex.unlock();
     PRINTF("Leaving Critical Section 2 \n");
     return true;
@@ -1190,8 +1327,9 @@ EXIT:
         sem_post(semaphore);
         Run();
     }
-    if(inputBuffer != NULL)
-        free(inputBuffer);
+
+    if (mChunkSize == 0)
+        FreeInputChunks();
 
     if(outputBuffer != NULL)
         free(outputBuffer);
@@ -1325,12 +1463,15 @@ while(1){
                     }
 
                     /* Free buffers */
-                    eError = OMX_FreeBuffer(pOMXHandle, InPortDef.nPortIndex, pInBuffHead);
-                    if ( eError != OMX_ErrorNone ) {
-                        PRINTF("Error from OMX_FreeBuffer. Input port.\n");
-                        iState = STATE_ERROR;
-                        break;
+                    for (int i = 0; i < mInputChunks && iState != STATE_ERROR; i++) {
+                        eError = OMX_FreeBuffer(pOMXHandle, InPortDef.nPortIndex, pInBuffHead[i]);
+                        if ( eError != OMX_ErrorNone ) {
+                            PRINTF("Error from OMX_FreeBuffer. Input port.\n");
+                            iState = STATE_ERROR;
+                        }
                     }
+                    if (iState == STATE_ERROR)
+                        break;
 
                     eError = OMX_FreeBuffer(pOMXHandle, OutPortDef.nPortIndex, pOutBuffHead);
                     if ( eError != OMX_ErrorNone ) {
@@ -1348,9 +1489,8 @@ while(1){
             break;
 
         case STATE_EXECUTING:
-            pInBuffHead->nFlags = OMX_BUFFERFLAG_EOS;
-            OMX_EmptyThisBuffer(pOMXHandle, pInBuffHead);
             OMX_FillThisBuffer(pOMXHandle, pOutBuffHead);
+            FeedInput();
             clock_gettime( CLOCK_REALTIME, &timeout );
             timeout.tv_sec += 7;
             break;
@@ -1391,11 +1531,13 @@ while(1){
             /*### Do different things based on iLastState */
 
             if ( iState == STATE_INVALID ) {
-                if (pInBuffHead != NULL) {
-                    /* Free buffers if it got allocated */
-                    eError = OMX_FreeBuffer(pOMXHandle, InPortDef.nPortIndex, pInBuffHead);
-                    if ( eError != OMX_ErrorNone ) {
-                        PRINTF("Error from OMX_FreeBuffer. Input port.\n");
+                for (int i = 0; i < mInputChunks; i++) {
+                    if (pInBuffHead[i] != NULL) {
+                        /* Free buffers if it got allocated */
+                        eError = OMX_FreeBuffer(pOMXHandle, InPortDef.nPortIndex, pInBuffHead[i]);
+                        if ( eError != OMX_ErrorNone ) {
+                            PRINTF("Error from OMX_FreeBuffer. Input port.\n");
+                        }
                     }
                 }
                 if (pOutBuffHead != NULL) {
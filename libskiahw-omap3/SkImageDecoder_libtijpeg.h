@@ -76,6 +76,11 @@ extern "C" {
 #define SEQ_WIDTH   5776
 #define SEQ_HEIGHT  4336
 
+#define INPUT_CHUNKS 2              // compressed data in flight while the stream delivers the next chunk
+// KB, debug.skiahw.jpegdec.chunk. 0 feeds the whole stream at once, the default until
+// the DSP codec is verified to take a stream in several buffers before EOS
+#define INPUT_CHUNK_SIZE 0
+
 class SkTIJPEGImageDecoder
 {
 
@@ -122,15 +127,13 @@ public:
     void Run();
     void PrintState();
     void FillBufferDone(OMX_U8* pBuffer, OMX_U32 nFilledLen);
+    bool EmptyBufferDone(OMX_BUFFERHEADERTYPE* pBuffHead);
     void EventHandler(OMX_HANDLETYPE hComponent,
     									OMX_EVENTTYPE eEvent,
     									OMX_U32 nData1,
     									OMX_U32 nData2,
     									OMX_PTR pEventData);
     int GetLoad(){ return mLoad; }
-    void IncDeleteAttempts() {mDeleteAttempts++;}
-    void ResetDeleteAttempts() {mDeleteAttempts = 0;}
-    int GetDeleteAttempts() {return mDeleteAttempts;}
 
 
 private:
@@ -145,7 +148,7 @@ private:
 	} JPEG_HEADER_INFO;
 
         OMX_HANDLETYPE pOMXHandle;
-        OMX_BUFFERHEADERTYPE *pInBuffHead;
+        OMX_BUFFERHEADERTYPE *pInBuffHead[INPUT_CHUNKS];
         OMX_BUFFERHEADERTYPE *pOutBuffHead;
         OMX_PARAM_PORTDEFINITIONTYPE InPortDef;
         OMX_PARAM_PORTDEFINITIONTYPE OutPortDef;
@@ -154,10 +157,26 @@ private:
         SkBitmap* bitmap;
         android::Mutex       gTIJpegDecMutex;
     int mLoad;
-    int mDeleteAttempts;
     int mProgressive;
     bool nSubRegDecode;
     bool inStateTransition;
+
+    // input chunks, refilled from the stream while the codec works. Kept with the decoder
+    // when streaming, a whole stream buffer is freed after each decode
+    OMX_U8* mInputChunk[INPUT_CHUNKS];
+    OMX_U32 mInputChunkSize;        // allocated size of each chunk
+    OMX_U32 mChunkSize;             // debug.skiahw.jpegdec.chunk in bytes, 0 for the whole stream
+    OMX_U32 mFeedSize;              // bytes read into a chunk in the current decode
+    int mInputChunks;               // chunks given to the codec, 1 when not streaming
+    int mChunksQueued;              // chunks the codec has not returned yet
+    OMX_U32 mStreamRead;
+    OMX_BUFFERHEADERTYPE* mEosBuffHead;
+    android::Mutex mFeedLock;
+    android::Condition mFeedCond;
+
+    bool AllocInputChunks(OMX_U32 size);
+    void FreeInputChunks();
+    void FeedInput();
 	OMX_S16 GetYUVformat(OMX_U8 * Data);
 	OMX_S16 Get16m(const void * Short);
 	OMX_S32 ParseJpegHeader (SkStream* stream, JPEG_HEADER_INFO* JpegHeaderInfo);
@@ -33,113 +33,401 @@
 */
 
 #include "SkImageDecoder_libtijpeg_entry.h"
+#include <cutils/properties.h>
+#include <pthread.h>
+#include <stdlib.h>
 
 #define PRINTF SkDebugf
 
-const int DESIRED_LOAD = 1;
-const int MAX_DEL_ATTEMPTS = 3;
-const unsigned int MAX_DECODERS = 1;
+const unsigned int MAX_DECODERS = 4;
+const unsigned int DEFAULT_DECODERS = 1;
+
+// the DSP decodes sub regions from MCU boundaries, 16x16 covers every subsampling
+const int REGION_ALIGN = 16;
 
 static SkTIJPEGImageDecoderListWrapper SkTIJPEGImageDecoderList;
 static android::Mutex SkTIJPEGImageDecoderListLock;
 
+// everything below is protected by SkTIJPEGImageDecoderListLock
+static android::Condition SkTIJPEGImageDecoderAvailable;
+static unsigned int gPoolCapacity = 0;      // 0 until the properties are read
+static unsigned int gPoolQueueDepth = 0;
+static unsigned int gNextTicket = 0;        // FIFO order of decodes waiting for a decoder
+static unsigned int gServingTicket = 0;
+static SkTIJPEGImageDecoderEntry::PoolStats gPoolStats;
+static android::sp<CodecLifetimeManager> gDecoderLifetime;
+
+// set on a thread that asks libskia for its own JPEG decoder
+static pthread_key_t gBypassHWKey;
+static pthread_once_t gBypassHWOnce = PTHREAD_ONCE_INIT;
+
+static void CreateBypassHWKey()
+{
+    pthread_key_create(&gBypassHWKey, NULL);
+}
+
+/* debug.skiahw.jpegdec.instances caps the number of OMX decoders, each with
+ * its own handle. Whether the DSP runs several JPEG decoder instances at the
+ * same time isn't verified, so there is one unless the property asks for
+ * more. debug.skiahw.jpegdec.queue is how many decodes may wait for a
+ * decoder before the next decode goes to libjpeg instead. */
+static void ReadPoolProperties()
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    property_get("debug.skiahw.jpegdec.instances", value, "0");
+    gPoolCapacity = atoi(value);
+    if (gPoolCapacity == 0)
+        gPoolCapacity = DEFAULT_DECODERS;
+    else if (gPoolCapacity > MAX_DECODERS)
+        gPoolCapacity = MAX_DECODERS;
+
+    property_get("debug.skiahw.jpegdec.queue", value, "-1");
+    gPoolQueueDepth = (atoi(value) < 0) ? gPoolCapacity : atoi(value);
+
+    gPoolStats.capacity = gPoolCapacity;
+    SkDebugf("SkTIJPEGImageDecoder pool: %d decoders, %d queued", gPoolCapacity, gPoolQueueDepth);
+}
+
 SkTIJPEGImageDecoderEntry::~SkTIJPEGImageDecoderEntry()
 {
     SkDebugf("SkTIJPEGImageDecoderEntry::~SkTIJPEGImageDecoderEntry()");
+    SkDELETE(mTileArm);
+    if (mTileStream != NULL)
+        mTileStream->unref();
 }
 
 SkTIJPEGImageDecoderEntry::SkTIJPEGImageDecoderEntry()
 {
     //Initialize JpegDecoderParams structure
     memset((void*)&jpegDecParams, 0, sizeof(JpegDecoderParams));
+    mTileStream = NULL;
+    mTileWidth = 0;
+    mTileHeight = 0;
+    mTileArm = NULL;
 }
 
-bool SkTIJPEGImageDecoderEntry::WatchdogCallback(void* __item)
+/* Runs on the lifetime manager thread. Decoders are unlinked under the list
+ * lock but torn down outside of it, so the OMX state transitions of a release
+ * don't hold up decodes looking for a decoder. */
+nsecs_t SkTIJPEGImageDecoderEntry::ReleaseIdleDecoders(nsecs_t idleTimeout, bool memoryPressure, unsigned int* released)
 {
-    bool restart = false;
+    android::List<SkTIJPEGImageDecoderList_Item*> expired;
     android::List<SkTIJPEGImageDecoderList_Item*>::iterator iter;
-    SkTIJPEGImageDecoderList_Item* item = reinterpret_cast<SkTIJPEGImageDecoderList_Item*>(__item);
-
-    android::Mutex::Autolock autolock(SkTIJPEGImageDecoderListLock);
-    SkDebugf("SkTIJPEGImageDecoderEntry::WatchdogCallback() item=0x%x", item);
+    nsecs_t next = -1;
 
-    if(item->Decoder->GetLoad() == 0 || item->Decoder->GetDeleteAttempts() >= MAX_DEL_ATTEMPTS)
     {
-        if(item->Decoder->GetDeleteAttempts() > MAX_DEL_ATTEMPTS)
-            SkDebugf("    Restart attempt limit reached. deleting...");
-
-        // watchdog has expired, delete our reference to Decoder object
-        SkAutoTDelete<SkTIJPEGImageDecoder> autodelete(item->Decoder);
-        // reset the strong pointer, okay to do here since lifetime will last longer than reset
-        item->WatchdogTimer.clear();
-        // delete item from Decoder list
-        for(iter = SkTIJPEGImageDecoderList.list.begin(); iter != SkTIJPEGImageDecoderList.list.end(); iter++)
+        android::Mutex::Autolock autolock(SkTIJPEGImageDecoderListLock);
+        nsecs_t now = systemTime();
+
+        iter = SkTIJPEGImageDecoderList.list.begin();
+        while (iter != SkTIJPEGImageDecoderList.list.end())
         {
-            if(((SkTIJPEGImageDecoderList_Item*)*iter) == item)
-            {
-                SkTIJPEGImageDecoderList.list.erase(iter);
-                break;
+            SkTIJPEGImageDecoderList_Item* item = *iter;
+            nsecs_t idle = now - item->LastUsed;
+
+            // never delete a decoder that a decode has checked out
+            if (item->Busy) {
+                if (next < 0 || idleTimeout < next)
+                    next = idleTimeout;
+                iter++;
+            } else if (memoryPressure || idle >= idleTimeout) {
+                expired.push_back(item);
+                iter = SkTIJPEGImageDecoderList.list.erase(iter);
+                gPoolStats.instances--;
+            } else {
+                if (next < 0 || idleTimeout - idle < next)
+                    next = idleTimeout - idle;
+                iter++;
             }
         }
-    }else{
-        // Decoder is still doing something, increment deleltion attempt, restart watchdog
-        SkDebugf("  Decoder is still doing something, restart watchdog");
-        item->Decoder->IncDeleteAttempts();
-        restart = true;
+
+        // a decode waiting for a free slot may now create a decoder
+        if (!expired.empty())
+            SkTIJPEGImageDecoderAvailable.broadcast();
     }
-    return restart;
 
-    // return DeleteFromListIfDecoderNotWorking<SkTIJPEGImageDecoderList_Item*, SkTIJPEGImageDecoder>(__item, SkTIJPEGImageDecoderList);
+    *released = 0;
+    for (iter = expired.begin(); iter != expired.end(); iter++)
+    {
+        SkDebugf("SkTIJPEGImageDecoderEntry: releasing idle decoder 0x%x%s", *iter,
+                 memoryPressure ? " (memory pressure)" : "");
+        SkDELETE((*iter)->Decoder);
+        delete *iter;
+        (*released)++;
+    }
+    return next;
 }
-bool SkTIJPEGImageDecoderEntry::onDecode(SkStream* stream, SkBitmap* bm, Mode mode)
-{
 
-    bool result;
-    bool itemFound = false;
-    SkBitmap::Config prefConfig = this->getPrefConfig(k32Bit_SrcDepth, false);
+void SkTIJPEGImageDecoderEntry::GetPoolStats(PoolStats* stats)
+{
+    {
+        android::Mutex::Autolock autolock(SkTIJPEGImageDecoderListLock);
+        *stats = gPoolStats;
+    }
+    if (gDecoderLifetime != NULL)
+        gDecoderLifetime->getStats(&stats->lifetime);
+    else
+        memset(&stats->lifetime, 0, sizeof(stats->lifetime));
+}
 
+SkTIJPEGImageDecoderList_Item* SkTIJPEGImageDecoderEntry::AcquireDecoder(bool allowFallback)
+{
     android::List<SkTIJPEGImageDecoderList_Item*>::iterator iter;
+    SkTIJPEGImageDecoderList_Item* item = NULL;
+    nsecs_t waitStart = 0;
+    unsigned int ticket;
 
-    { // scope for lock: SkTIJPEGImageDecoderListLock
+    // should only need lock when accesing and modifying static list of decoders
+    //      - decoder will handle locking its own critical section
+    //      - the Busy flag keeps the lifetime manager from deleting a decoder while it is working
+    android::Mutex::Autolock autolock(SkTIJPEGImageDecoderListLock);
 
-        // should only need lock when accesing and modifying static list of decoders
-        //      - decoder will handle locking its own critical section
-        //      - check decoder load in watchdog callback and make sure not to delete Decoder while it is working
-        android::Mutex::Autolock autolock(SkTIJPEGImageDecoderListLock);
+    if (gPoolCapacity == 0) {
+        ReadPoolProperties();
+        gDecoderLifetime = new CodecLifetimeManager(ReleaseIdleDecoders);
+        gDecoderLifetime->run("Decoder Lifetime", ANDROID_PRIORITY_BACKGROUND);
+    }
 
-        //TODO: Need algo to select decoder from list
-        //      Maybe we can keep list sorted by Load and just pick off from the beginning of the list
-        //      Below will work for now as we are not supporting parallel decodes anyways
+    // the pool is saturated and enough decodes are already queued behind it,
+    // libjpeg will finish this one sooner than waiting would
+    if (allowFallback && (gNextTicket - gServingTicket) >= gPoolQueueDepth &&
+        SkTIJPEGImageDecoderList.list.size() >= gPoolCapacity) {
+        bool idle = false;
         for(iter = SkTIJPEGImageDecoderList.list.begin(); iter != SkTIJPEGImageDecoderList.list.end(); iter++)
         {
-            SkTIJPEGImageDecoderList_Item* item = static_cast<SkTIJPEGImageDecoderList_Item*>(*iter);
-            if(item->Decoder->GetLoad() < DESIRED_LOAD)
+            if(!(*iter)->Busy)
             {
-                itemFound = true;
-                item->WatchdogTimer->restart();
+                idle = true;
                 break;
             }
         }
+        if (!idle) {
+            gPoolStats.armDecodes++;
+            return NULL;
+        }
+    }
 
-        if(!itemFound)
+    // decoders are handed out in arrival order
+    ticket = gNextTicket++;
+    for(;;)
+    {
+        if (ticket == gServingTicket)
         {
-            if(SkTIJPEGImageDecoderList.list.empty() || SkTIJPEGImageDecoderList.list.size() < MAX_DECODERS)
+            for(iter = SkTIJPEGImageDecoderList.list.begin(); iter != SkTIJPEGImageDecoderList.list.end(); iter++)
             {
-                SkTIJPEGImageDecoderList_Item* type = new SkTIJPEGImageDecoderList_Item;
-                type->Decoder =  SkNEW(SkTIJPEGImageDecoder);
-                type->WatchdogTimer = new DecoderWatchdog(this, (void*)type, (nsecs_t) 10*1000*1000*1000);
-                type->WatchdogTimer->run("Decoder Watchdog", ANDROID_PRIORITY_DISPLAY);
-                SkTIJPEGImageDecoderList.list.insert(SkTIJPEGImageDecoderList.list.begin(), type);
-                iter = SkTIJPEGImageDecoderList.list.begin();
-            } else {
-                // oh well, tried our best. just return an decoder from the top of the list
-                iter = SkTIJPEGImageDecoderList.list.begin();
-                static_cast<SkTIJPEGImageDecoderList_Item*>(*iter)->WatchdogTimer->restart();
+                if(!(*iter)->Busy)
+                {
+                    item = *iter;
+                    break;
+                }
             }
+
+            if (item == NULL && SkTIJPEGImageDecoderList.list.size() < gPoolCapacity)
+            {
+                item = new SkTIJPEGImageDecoderList_Item;
+                item->Decoder =  SkNEW(SkTIJPEGImageDecoder);
+                item->Busy = false;
+                item->LastUsed = 0;
+                SkTIJPEGImageDecoderList.list.insert(SkTIJPEGImageDecoderList.list.begin(), item);
+                gPoolStats.instances++;
+            }
+
+            if (item != NULL)
+                break;
         }
-    } //SkTIJPEGImageDecoderListLock
+
+        if (waitStart == 0)
+        {
+            waitStart = systemTime();
+            gPoolStats.queuedDecodes++;
+        }
+        SkTIJPEGImageDecoderAvailable.wait(SkTIJPEGImageDecoderListLock);
+    }
+
+    // a decoder that never decoded still has its OMX handle to get
+    gDecoderLifetime->codecUsed(item->LastUsed != 0);
+    item->Busy = true;
+    gServingTicket++;
+    gPoolStats.hwDecodes++;
+    if (waitStart != 0 && (systemTime() - waitStart) > gPoolStats.maxQueueWait)
+        gPoolStats.maxQueueWait = systemTime() - waitStart;
+
+    // the next ticket may already be able to take another idle decoder
+    SkTIJPEGImageDecoderAvailable.broadcast();
+    return item;
+}
+
+void SkTIJPEGImageDecoderEntry::ReleaseDecoder(SkTIJPEGImageDecoderList_Item* item)
+{
+    android::Mutex::Autolock autolock(SkTIJPEGImageDecoderListLock);
+    item->Busy = false;
+    item->LastUsed = systemTime();
+    SkTIJPEGImageDecoderAvailable.broadcast();
+}
+
+/* libskia's JPEG factory asks SkImageDecoder_HWJPEG_Factory first, which
+ * steps aside for this thread so libskia builds its own libjpeg decoder. */
+SkImageDecoder* SkTIJPEGImageDecoderEntry::NewArmDecoder(SkStream* stream)
+{
+    SkImageDecoder* decoder;
+
+    pthread_once(&gBypassHWOnce, CreateBypassHWKey);
+    pthread_setspecific(gBypassHWKey, (void*)1);
+    stream->rewind();
+    decoder = SkImageDecoder::Factory(stream);
+    pthread_setspecific(gBypassHWKey, NULL);
+    stream->rewind();
+
+    if (decoder != NULL && decoder->getFormat() != kJPEG_Format) {
+        SkDELETE(decoder);
+        decoder = NULL;
+    }
+    if (decoder == NULL)
+        SkDebugf("SkTIJPEGImageDecoder: libskia has no libjpeg decoder");
+    return decoder;
+}
+
+bool SkTIJPEGImageDecoderEntry::onDecodeArm(SkStream* stream, SkBitmap* bm, SkBitmap::Config prefConfig, Mode mode)
+{
+    SkAutoTDelete<SkImageDecoder> armDecoder(NewArmDecoder(stream));
+
+    if (armDecoder.get() == NULL)
+        return false;
+
+    armDecoder->setSampleSize(this->getSampleSize());
+    armDecoder->setDitherImage(this->getDitherImage());
+    armDecoder->setAllocator(this->getAllocator());
+
+    stream->rewind();
+    return armDecoder->decode(stream, bm, prefConfig, mode);
+}
+
+bool SkTIJPEGImageDecoderEntry::onDecode(SkStream* stream, SkBitmap* bm, Mode mode)
+{
+    bool result;
+    SkBitmap::Config prefConfig = this->getPrefConfig(k32Bit_SrcDepth, false);
+
+    // libjpeg can't do sub region decodes, those always wait for the hardware
+    bool subRegion = jpegDecParams.nXOrg || jpegDecParams.nYOrg ||
+                     jpegDecParams.nXLength || jpegDecParams.nYLength;
+
+    SkTIJPEGImageDecoderList_Item* item = AcquireDecoder(!subRegion);
+    if (item == NULL) {
+        return onDecodeArm(stream, bm, prefConfig, mode);
+    }
 
     //propagate the decoder parameters to the decoder object.
-    static_cast<SkTIJPEGImageDecoderList_Item*>(*iter)->Decoder->SetJpegDecodeParameters((void*)&jpegDecParams);
-    return static_cast<SkTIJPEGImageDecoderList_Item*>(*iter)->Decoder->onDecode(this, stream, bm, prefConfig, mode);
+    item->Decoder->SetJpegDecodeParameters((void*)&jpegDecParams);
+    result = item->Decoder->onDecode(this, stream, bm, prefConfig, mode);
+
+    ReleaseDecoder(item);
+    return result;
+}
+
+/* Only the header is read here. Every region is a decode of its own on a
+ * pooled decoder, which needs nothing more than the stream. */
+bool SkTIJPEGImageDecoderEntry::onBuildTileIndex(SkStream* stream, int* width, int* height)
+{
+    SkAutoTDelete<SkImageDecoder> boundsDecoder(NewArmDecoder(stream));
+    SkBitmap bm;
+
+    if (boundsDecoder.get() == NULL || !boundsDecoder->decode(stream, &bm, kDecodeBounds_Mode))
+        return false;
+
+    SkDELETE(mTileArm);
+    mTileArm = NULL;
+    if (mTileStream != NULL)
+        mTileStream->unref();
+
+    mTileStream = stream;
+    *width = mTileWidth = bm.width();
+    *height = mTileHeight = bm.height();
+    return true;
+}
+
+/* The DSP decodes the region grown out to MCU boundaries into a buffer sized
+ * for that region alone, the margin is cropped off afterwards. With the pool
+ * saturated the region goes to libjpeg, which stops at the last MCU row of it. */
+bool SkTIJPEGImageDecoderEntry::onDecodeRegion(SkBitmap* bm, SkIRect rect)
+{
+    SkTIJPEGImageDecoderList_Item* item;
+    JpegDecoderParams region;
+    SkBitmap decoded;
+    bool result;
+
+    if (mTileStream == NULL || !rect.intersect(0, 0, mTileWidth, mTileHeight))
+        return false;
+
+    memset(&region, 0, sizeof(region));
+    region.nXOrg = rect.fLeft & ~(REGION_ALIGN - 1);
+    region.nYOrg = rect.fTop & ~(REGION_ALIGN - 1);
+    region.nXLength = SkMin32((rect.fRight + REGION_ALIGN - 1) & ~(REGION_ALIGN - 1), mTileWidth) - region.nXOrg;
+    region.nYLength = SkMin32((rect.fBottom + REGION_ALIGN - 1) & ~(REGION_ALIGN - 1), mTileHeight) - region.nYOrg;
+
+    item = AcquireDecoder(true);
+    if (item == NULL)
+        return onDecodeRegionArm(bm, rect);
+
+    item->Decoder->SetJpegDecodeParameters((void*)&region);
+    mTileStream->rewind();
+    result = item->Decoder->onDecode(this, mTileStream, &decoded,
+                                     this->getPrefConfig(k32Bit_SrcDepth, false), kDecodePixels_Mode);
+    ReleaseDecoder(item);
+
+    if (!result)
+        return onDecodeRegionArm(bm, rect);
+
+    // the decoder may have scaled by something other than the sample size
+    int x = (rect.fLeft - region.nXOrg) * decoded.width() / region.nXLength;
+    int y = (rect.fTop - region.nYOrg) * decoded.height() / region.nYLength;
+    int w = SkMin32(SkMax32(rect.width() * decoded.width() / region.nXLength, 1), decoded.width() - x);
+    int h = SkMin32(SkMax32(rect.height() * decoded.height() / region.nYLength, 1), decoded.height() - y);
+
+    if (x == 0 && y == 0 && w == decoded.width() && h == decoded.height()) {
+        *bm = decoded;
+        return true;
+    }
+
+    bm->setConfig(decoded.config(), w, h);
+    if (!this->allocPixelRef(bm, NULL))
+        return false;
+
+    int bytesPerPixel = decoded.bytesPerPixel();
+    for (int row = 0; row < h; row++) {
+        memcpy((char*)bm->getPixels() + row * bm->rowBytes(),
+               (char*)decoded.getPixels() + (y + row) * decoded.rowBytes() + x * bytesPerPixel,
+               w * bytesPerPixel);
+    }
+    return true;
+}
+
+bool SkTIJPEGImageDecoderEntry::onDecodeRegionArm(SkBitmap* bm, const SkIRect& rect)
+{
+    if (mTileArm == NULL) {
+        int width, height;
+
+        // the index holds a reference of its own and seeks the stream as it needs
+        mTileArm = NewArmDecoder(mTileStream);
+        if (mTileArm == NULL)
+            return false;
+        mTileStream->ref();
+        if (!mTileArm->buildTileIndex(mTileStream, &width, &height)) {
+            SkDELETE(mTileArm);
+            mTileArm = NULL;
+            return false;
+        }
+    }
+
+    mTileArm->setSampleSize(this->getSampleSize());
+    mTileArm->setDitherImage(this->getDitherImage());
+    mTileArm->setAllocator(this->getAllocator());
+    return mTileArm->decodeRegion(bm, rect, this->getPrefConfig(k32Bit_SrcDepth, false));
+}
+
+extern "C" SkImageDecoder* SkImageDecoder_HWJPEG_Factory() {
+    pthread_once(&gBypassHWOnce, CreateBypassHWKey);
+    if (pthread_getspecific(gBypassHWKey) != NULL)
+        return NULL;
+    return SkNEW(SkTIJPEGImageDecoderEntry);
 }
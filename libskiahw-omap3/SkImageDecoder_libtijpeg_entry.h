@@ -46,14 +46,12 @@ extern "C" {
 }
 class SkTIJPEGImageDecoderEntry;
 
-typedef WatchdogThread<SkTIJPEGImageDecoderEntry> DecoderWatchdog;
-// typedef SkTIJPEGImageCodecList_Item<SkTIJPEGImageDecoder, DecoderWatchdog> SkTIJPEGImageDecoderList_Item;
-
 class SkTIJPEGImageDecoderList_Item
 {
 public:
     SkTIJPEGImageDecoder* Decoder;
-    android::sp<DecoderWatchdog>  WatchdogTimer;
+    nsecs_t LastUsed;   // when the last decode on it finished
+    bool Busy;      // checked out by a decode, owned by the list lock
 };
 
 class SkTIJPEGImageDecoderListWrapper
@@ -66,9 +64,9 @@ public:
             android::List<SkTIJPEGImageDecoderList_Item*>::iterator iter = list.begin();
             SkTIJPEGImageDecoderList_Item* item = static_cast<SkTIJPEGImageDecoderList_Item*>(*iter);
             SkAutoTDelete<SkTIJPEGImageDecoder> autodelete(item->Decoder);
-            item->WatchdogTimer.clear();
             SkDebugf("SkTIJPEGImageDecoder Cleanup: 0x%x", item);
             list.erase(iter);
+            delete item;
         }
     }
     android::List<SkTIJPEGImageDecoderList_Item*> list;
@@ -76,11 +74,12 @@ public:
 
 class SkTIJPEGImageDecoderEntry :public SkImageDecoder
 {
-    friend class WatchdogThread<SkTIJPEGImageDecoderEntry>;
     friend class SkTIJPEGImageDecoder;
 
 protected:
 	virtual bool onDecode(SkStream* stream, SkBitmap* bm, Mode);
+	virtual bool onBuildTileIndex(SkStream* stream, int* width, int* height);
+	virtual bool onDecodeRegion(SkBitmap* bm, SkIRect rect);
 
 public:
     typedef struct JpegDecoderParams
@@ -105,16 +104,42 @@ public:
         return true;
     }
 
+    typedef struct PoolStats
+    {
+        unsigned int capacity;      /* decoders allowed in the pool */
+        unsigned int instances;     /* decoders currently alive */
+        unsigned int hwDecodes;     /* decodes run on a pooled decoder */
+        unsigned int armDecodes;    /* decodes sent to libjpeg, pool saturated */
+        unsigned int queuedDecodes; /* decodes that had to wait for a decoder */
+        nsecs_t maxQueueWait;       /* longest wait for a decoder */
+        CodecLifetimeManager::Stats lifetime;
+    }PoolStats;
+
+    static void GetPoolStats(PoolStats* stats);
+
+    /* libjpeg decoder of libskia for stream, used when every hardware decoder
+     * is taken. NULL if libskia has none. */
+    static SkImageDecoder* NewArmDecoder(SkStream* stream);
+
 
 private:
     JpegDecoderParams jpegDecParams;
-    bool WatchdogCallback(void* param);
+    static nsecs_t ReleaseIdleDecoders(nsecs_t idleTimeout, bool memoryPressure, unsigned int* released);
+    SkTIJPEGImageDecoderList_Item* AcquireDecoder(bool allowFallback);
+    void ReleaseDecoder(SkTIJPEGImageDecoderList_Item* item);
+    bool onDecodeArm(SkStream* stream, SkBitmap* bm, SkBitmap::Config prefConfig, Mode mode);
+    bool onDecodeRegionArm(SkBitmap* bm, const SkIRect& rect);
+
+    // set by onBuildTileIndex, the decoder owns the stream from then on
+    SkStream* mTileStream;
+    int mTileWidth;
+    int mTileHeight;
+    // libjpeg tile index, only built once a region has to be decoded on ARM
+    SkImageDecoder* mTileArm;
 };
 
 
-extern "C" SkImageDecoder* SkImageDecoder_HWJPEG_Factory() {
-    return SkNEW(SkTIJPEGImageDecoderEntry);
-}
+extern "C" SkImageDecoder* SkImageDecoder_HWJPEG_Factory();
 
 #endif
 
@@ -89,11 +89,15 @@ OMX_ERRORTYPE OMX_JPEGE_EventHandler(OMX_HANDLETYPE hComponent,
 SkTIJPEGImageEncoder::SkTIJPEGImageEncoder()
 {
     mLoad = 0;
-    mDeleteAttempts = 0;
     pInBuffHead = NULL;
     pOutBuffHead = NULL;
     pOMXHandle = NULL;
     pEncodedOutputBuffer = NULL;
+    nEncodedOutputFilledLen = 0;
+    mInBuffer = NULL;
+    mInBuffCapacity = 0;
+    mOutBytesPerPixelQ16 = 0;
+    mLastQuality = 0;
     semaphore = NULL;
     semaphore = (sem_t*)malloc(sizeof(sem_t)) ;
     sem_init(semaphore, 0x00, 0x00);
@@ -129,6 +133,8 @@ SkTIJPEGImageEncoder::~SkTIJPEGImageEncoder()
         free(pEncodedOutputBuffer);
         pEncodedOutputBuffer = NULL;
     }
+    free(mInBuffer);
+    mInBuffer = NULL;
     sem_destroy(semaphore);
     if (semaphore != NULL) {
         free(semaphore) ;
@@ -304,20 +310,46 @@ bool SkTIJPEGImageEncoder::onEncode(SkImageEncoder* enc_impl, SkWStream* stream,
         return false;
     }
 
+    // encodes on this encoder use the copy buffer, the OMX handle and the output buffer in turn
+    android::Mutex::Autolock lock(gTIJpegEncMutex);
+
     inBuffSize = nWidthNew * nHeightNew * nBytesPerPixel;
     if (inBuffSize < 1600)
         inBuffSize = 1600;
 
     inBuffSize = (OMX_U32)((inBuffSize + ALIGN_128_BYTE - 1) & ~(ALIGN_128_BYTE - 1));
-    void *inputBuffer = memalign(ALIGN_128_BYTE, inBuffSize);
+    void *inputBuffer;
+
+#if EVEN_RES_ONLY
+    int row = w * nBytesPerPixel;
+    OMX_U32 bitmapSize = row * h;
+
+    // the DSP reads aligned, packed pixels where they are
+    if (((size_t)bm.getPixels() & (ALIGN_128_BYTE - 1)) == 0 && bm.rowBytes() == row &&
+            (bitmapSize & (ALIGN_128_BYTE - 1)) == 0 && bitmapSize >= 1600) {
+        inputBuffer = bm.getPixels();
+        inBuffSize = bitmapSize;
+    } else {
+        inputBuffer = GetCopyBuffer(inBuffSize);
+        if ( inputBuffer == NULL) {
+            PRINTF("\n %s():%d:: ERROR:: inputBuffer Allocation Failed. \n", __FUNCTION__,__LINE__);
+            return false;
+        }
+
+        if (bm.rowBytes() == row) {
+            memcpy(inputBuffer, bm.getPixels(), bitmapSize);
+        } else {
+            for (int i = 0; i < h; i++)
+                memcpy((char *)inputBuffer + i * row, (char *)bm.getPixels() + i * bm.rowBytes(), row);
+        }
+    }
+#else
+    inputBuffer = GetCopyBuffer(inBuffSize);
     if ( inputBuffer == NULL) {
         PRINTF("\n %s():%d:: ERROR:: inputBuffer Allocation Failed. \n", __FUNCTION__,__LINE__);
         return false;
     }
 
-#if EVEN_RES_ONLY
-    memcpy(inputBuffer, bm.getPixels(), bm.getSize());
-#else
     //This padding logic can be used for the odd sized image encoding
     //when TI DSP codec used
     int pad_width = w%MULTIPLE;
@@ -382,36 +414,69 @@ bool SkTIJPEGImageEncoder::onEncode(SkImageEncoder* enc_impl, SkWStream* stream,
     }
 
 #endif
-    OMX_U32 outBuffSize = bm.width() * bm.height();
-    if( quality < 10){
-        outBuffSize /=10;
-    }
-    else if (quality <100){
-        outBuffSize /= (100/quality);
-    }
-    /*Adding memory to include Thumbnail, comments & markers information and header (depends on the app)*/
-    outBuffSize += 12288;
-    outBuffSize = (OMX_U32)((outBuffSize + ALIGN_128_BYTE - 1) & ~(ALIGN_128_BYTE - 1));
+
+    OMX_U32 outBuffSize = EstimateOutputSize(w * h, quality);
+    OMX_U32 maxOutBuffSize = (OMX_U32)((w * h * nBytesPerPixel + 12288 + ALIGN_128_BYTE - 1) & ~(ALIGN_128_BYTE - 1));
 
     PRINTF("\nOriginal: w = %d, h = %d", bm.width(), bm.height());
-    if (encodeImage(outBuffSize,inputBuffer, inBuffSize, w, h, quality, bm.config())){
+    while (encodeImage(outBuffSize,inputBuffer, inBuffSize, w, h, quality, bm.config())){
+        // a full buffer may hold a truncated JPEG, encode again into one twice the size
+        if (nEncodedOutputFilledLen >= OutPortDef.nBufferSize && OutPortDef.nBufferSize < maxOutBuffSize) {
+            outBuffSize = OutPortDef.nBufferSize * 2;
+            if (outBuffSize > maxOutBuffSize)
+                outBuffSize = maxOutBuffSize;
+            SkDebugf("JPEG did not fit in %d bytes, encoding again into %d", OutPortDef.nBufferSize, outBuffSize);
+            continue;
+        }
+
+        mOutBytesPerPixelQ16 = (OMX_U32)(((unsigned long long)nEncodedOutputFilledLen << 16) / (w * h));
+        mLastQuality = quality;
         stream->write(pEncodedOutputBuffer, nEncodedOutputFilledLen);
-        free(inputBuffer);
         return true;
     }
 
-    free(inputBuffer);
     return false;
 }
 
+void *SkTIJPEGImageEncoder::GetCopyBuffer(OMX_U32 size)
+{
+    // grows only, released with the encoder once it goes idle
+    if (mInBuffer == NULL || mInBuffCapacity < size) {
+        free(mInBuffer);
+        mInBuffCapacity = 0;
+        mInBuffer = memalign(ALIGN_128_BYTE, size);
+        if (mInBuffer == NULL)
+            return NULL;
+        mInBuffCapacity = size;
+    }
+    return mInBuffer;
+}
 
-bool SkTIJPEGImageEncoder::encodeImage(int outBuffSize, void *inputBuffer, int inBuffSize, int width, int height, int quality, SkBitmap::Config config)
+OMX_U32 SkTIJPEGImageEncoder::EstimateOutputSize(int pixels, int quality)
 {
+    unsigned long long outBuffSize;
+
+    if (mOutBytesPerPixelQ16 != 0 && quality == mLastQuality) {
+        // what the last encode at this quality produced
+        outBuffSize = ((unsigned long long)pixels * mOutBytesPerPixelQ16) >> 16;
+        /*Adding memory to include Thumbnail, comments & markers information and header (depends on the app)*/
+        outBuffSize += 12288;
+
+        // keep the handle while its buffer is big enough, a new one gets a quarter more
+        if (pOMXHandle != NULL && outBuffSize <= OutPortDef.nBufferSize)
+            return OutPortDef.nBufferSize;
+        outBuffSize = outBuffSize * 5 / 4;
+    } else {
+        // quality/200 bytes per pixel, twice what a typical photo takes
+        outBuffSize = (unsigned long long)pixels * quality / 200 + 12288;
+    }
+    return (OMX_U32)((outBuffSize + ALIGN_128_BYTE - 1) & ~(ALIGN_128_BYTE - 1));
+}
 
-    gTIJpegEncMutex.lock();
-    /* Critical section */
-    PRINTF("Entering Critical Section \n");
 
+bool SkTIJPEGImageEncoder::encodeImage(int outBuffSize, void *inputBuffer, int inBuffSize, int width, int height, int quality, SkBitmap::Config config)
+{
+    /* Called with gTIJpegEncMutex held */
     int reuseHandle = 0;
     int nRetval;
     int nIndex1;
@@ -500,6 +565,8 @@ bool SkTIJPEGImageEncoder::encodeImage(int outBuffSize, void *inputBuffer, int i
             iState = STATE_ERROR;
             goto EXIT;
         }
+        // kept for the encodes that reuse the handle
+        pEncodedOutputBuffer = (OMX_U8*)outputBuffer;
 
         // reset semaphore if we previously used it
         if(iState == STATE_EXIT){
@@ -722,24 +789,23 @@ bool SkTIJPEGImageEncoder::encodeImage(int outBuffSize, void *inputBuffer, int i
     }
 #endif
 
+    nEncodedOutputFilledLen = 0;
     Run();
 
-    gTIJpegEncMutex.unlock();
-    PRINTF("Leaving Critical Section 2 \n");
-
-    return true;
+    // nothing came out when the component failed during the encode
+    return nEncodedOutputFilledLen > 0;
 
 EXIT:
-    if(outputBuffer != NULL)
-        free(outputBuffer);
-
     if (iState == STATE_ERROR) {
         sem_post(semaphore);
         Run();
     }
 
-    gTIJpegEncMutex.unlock();
-    PRINTF("Leaving Critical Section 3 \n");
+    // freed after Run(), the component may still have had it
+    if(outputBuffer != NULL) {
+        free(outputBuffer);
+        pEncodedOutputBuffer = NULL;
+    }
 
     return false;
 
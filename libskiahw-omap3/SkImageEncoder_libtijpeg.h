@@ -93,6 +93,8 @@ public:
     ~SkTIJPEGImageEncoder();
     bool onEncode(SkImageEncoder* enc_impl, SkWStream* stream, const SkBitmap& bm, int quality);
     bool encodeImage(int outBuffSize, void *inputBuffer, int inBuffSize, int width, int height, int quality, SkBitmap::Config config);
+    void *GetCopyBuffer(OMX_U32 size);
+    OMX_U32 EstimateOutputSize(int pixels, int quality);
     bool SetJpegEncodeParameters(JpegEncoderParams * jep) {memcpy(&jpegEncParams, jep, sizeof(JpegEncoderParams)); return true;}
     void Run();
     void PrintState();
@@ -103,9 +105,6 @@ public:
                                             OMX_U32 nData2,
                                             OMX_PTR pEventData);
     int GetLoad(){ return mLoad; }
-    void IncDeleteAttempts() {mDeleteAttempts++;}
-    void ResetDeleteAttempts() {mDeleteAttempts = 0;}
-    int GetDeleteAttempts() {return mDeleteAttempts;}
 
 private:
 
@@ -119,7 +118,13 @@ private:
     OMX_U32 nEncodedOutputFilledLen;
     android::Mutex gTIJpegEncMutex;
     int mLoad;
-    int mDeleteAttempts;
+
+    // copy buffer for bitmaps the DSP can't read in place, kept between encodes
+    void *mInBuffer;
+    OMX_U32 mInBuffCapacity;
+    // last JPEG size per pixel (Q16) at mLastQuality, sizes the next output buffer
+    OMX_U32 mOutBytesPerPixelQ16;
+    int mLastQuality;
 
      bool onEncodeSW(SkWStream* stream, const SkBitmap& bm, int quality);
 
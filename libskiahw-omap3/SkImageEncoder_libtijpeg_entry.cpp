@@ -37,11 +37,11 @@
 #define PRINTF SkDebugf
 
 const int DESIRED_LOAD = 1;
-const int MAX_DEL_ATTEMPTS = 3;
 const unsigned int MAX_ENCODERS = 1;
 
 static SkTIJPEGImageEncoderListWrapper SkTIJPEGImageEncoderList;
 static android::Mutex SkTIJPEGImageEncoderListLock;
+static android::sp<CodecLifetimeManager> gEncoderLifetime;
 
 SkTIJPEGImageEncoderEntry::~SkTIJPEGImageEncoderEntry()
 {
@@ -53,64 +53,79 @@ SkTIJPEGImageEncoderEntry::SkTIJPEGImageEncoderEntry()
 
 }
 
-bool SkTIJPEGImageEncoderEntry::WatchdogCallback(void* __item)
+/* Runs on the lifetime manager thread, see ReleaseIdleDecoders() */
+nsecs_t SkTIJPEGImageEncoderEntry::ReleaseIdleEncoders(nsecs_t idleTimeout, bool memoryPressure, unsigned int* released)
 {
-    bool restart = false;
+    android::List<SkTIJPEGImageEncoderList_Item*> expired;
     android::List<SkTIJPEGImageEncoderList_Item*>::iterator iter;
-    SkTIJPEGImageEncoderList_Item* item = reinterpret_cast<SkTIJPEGImageEncoderList_Item*>(__item);
+    nsecs_t next = -1;
 
-    android::Mutex::Autolock autolock(SkTIJPEGImageEncoderListLock);
-    SkDebugf("SkTIJPEGImageEncoderEntry::WatchdogCallback() item=0x%x", item);
-
-    if(item->Encoder->GetLoad() == 0 || item->Encoder->GetDeleteAttempts() >= MAX_DEL_ATTEMPTS)
     {
-        if(item->Encoder->GetDeleteAttempts() > MAX_DEL_ATTEMPTS)
-            SkDebugf("    Restart attempt limit reached. deleting...");
-
-        // watchdog has expired, delete our reference to encoder object
-        SkAutoTDelete<SkTIJPEGImageEncoder> autodelete(item->Encoder);
-        // reset the strong pointer, okay to do here since lifetime will last longer than reset
-        item->WatchdogTimer.clear();
-        // delete item from encoder list
-        for(iter = SkTIJPEGImageEncoderList.list.begin(); iter != SkTIJPEGImageEncoderList.list.end(); iter++)
+        android::Mutex::Autolock autolock(SkTIJPEGImageEncoderListLock);
+        nsecs_t now = systemTime();
+
+        iter = SkTIJPEGImageEncoderList.list.begin();
+        while (iter != SkTIJPEGImageEncoderList.list.end())
         {
-            if(((SkTIJPEGImageEncoderList_Item*)*iter) == item)
-            {
-                SkTIJPEGImageEncoderList.list.erase(iter);
-                break;
+            SkTIJPEGImageEncoderList_Item* item = *iter;
+            nsecs_t idle = now - item->LastUsed;
+
+            // never delete an encoder while it is working
+            if (item->Users > 0) {
+                if (next < 0 || idleTimeout < next)
+                    next = idleTimeout;
+                iter++;
+            } else if (memoryPressure || idle >= idleTimeout) {
+                expired.push_back(item);
+                iter = SkTIJPEGImageEncoderList.list.erase(iter);
+            } else {
+                if (next < 0 || idleTimeout - idle < next)
+                    next = idleTimeout - idle;
+                iter++;
             }
         }
-    }else{
-        // encoder is still doing something, increase delete attempt, restart watchdog
-        SkDebugf("  encoder is still doing something, restart watchdog");
-        item->Encoder->IncDeleteAttempts();
-        restart = true;
     }
-    return restart;
+
+    *released = 0;
+    for (iter = expired.begin(); iter != expired.end(); iter++)
+    {
+        SkDebugf("SkTIJPEGImageEncoderEntry: releasing idle encoder 0x%x%s", *iter,
+                 memoryPressure ? " (memory pressure)" : "");
+        SkDELETE((*iter)->Encoder);
+        delete *iter;
+        (*released)++;
+    }
+    return next;
 }
+
 bool SkTIJPEGImageEncoderEntry::onEncode(SkWStream* stream, const SkBitmap& bm, int quality)
 {
     bool result;
     bool itemFound = false;
     android::List<SkTIJPEGImageEncoderList_Item*>::iterator iter;
+    SkTIJPEGImageEncoderList_Item* item;
 
     { // scope for lock: SkTIJPEGImageEncoderListLock
 
         // should only need lock when accesing and modifying static list of encoders
         //      - encoder will handle locking its own critical section
-        //      - check encoder load in watchdog callback and make sure not to delete encoder while it is working
+        //      - Users keeps the lifetime manager from deleting an encoder while it is working
         android::Mutex::Autolock autolock(SkTIJPEGImageEncoderListLock);
 
+        if (gEncoderLifetime == NULL) {
+            gEncoderLifetime = new CodecLifetimeManager(SkTIJPEGImageEncoderEntry::ReleaseIdleEncoders);
+            gEncoderLifetime->run("Encoder Lifetime", ANDROID_PRIORITY_BACKGROUND);
+        }
+
         //TODO: Need algo to select encoder from list
         //      Maybe we can keep list sorted by Load and just pick off from the beginning of the list
         //      Below will work for now as we are not supporting parallel decodes anyways
         for(iter = SkTIJPEGImageEncoderList.list.begin(); iter != SkTIJPEGImageEncoderList.list.end(); iter++)
         {
-            SkTIJPEGImageEncoderList_Item* item = static_cast<SkTIJPEGImageEncoderList_Item*>(*iter);
-            if(item->Encoder->GetLoad() < DESIRED_LOAD)
+            // Users is bumped under this lock, unlike the encoder's own load
+            if(static_cast<SkTIJPEGImageEncoderList_Item*>(*iter)->Users < DESIRED_LOAD)
             {
                 itemFound = true;
-                item->WatchdogTimer->restart();
                 break;
             }
         }
@@ -121,17 +136,26 @@ bool SkTIJPEGImageEncoderEntry::onEncode(SkWStream* stream, const SkBitmap& bm,
             {
                 SkTIJPEGImageEncoderList_Item* type = new SkTIJPEGImageEncoderList_Item;
                 type->Encoder =  SkNEW(SkTIJPEGImageEncoder);
-                type->WatchdogTimer = new EncoderWatchdog(this, (void*)type, (nsecs_t) 10*1000*1000*1000);
-                type->WatchdogTimer->run("Encoder Watchdog", ANDROID_PRIORITY_DISPLAY);
+                type->LastUsed = 0;
+                type->Users = 0;
                 SkTIJPEGImageEncoderList.list.insert(SkTIJPEGImageEncoderList.list.begin(), type);
                 iter = SkTIJPEGImageEncoderList.list.begin();
             } else {
                 // oh well, tried our best. just return an encoder from the top of the list
                 iter = SkTIJPEGImageEncoderList.list.begin();
-                static_cast<SkTIJPEGImageEncoderList_Item*>(*iter)->WatchdogTimer->restart();
             }
         }
+
+        item = static_cast<SkTIJPEGImageEncoderList_Item*>(*iter);
+        // an encoder that never encoded still has its OMX handle to get
+        gEncoderLifetime->codecUsed(item->LastUsed != 0);
+        item->Users++;
     } //SkTIJPEGImageEncoderListLock
 
-    return static_cast<SkTIJPEGImageEncoderList_Item*>(*iter)->Encoder->onEncode(this, stream, bm, quality);
+    result = item->Encoder->onEncode(this, stream, bm, quality);
+
+    android::Mutex::Autolock autolock(SkTIJPEGImageEncoderListLock);
+    item->Users--;
+    item->LastUsed = systemTime();
+    return result;
 }
@@ -47,13 +47,12 @@ extern "C" {
 }
 class SkTIJPEGImageEncoderEntry;
 
-typedef WatchdogThread<SkTIJPEGImageEncoderEntry> EncoderWatchdog;
-
 class SkTIJPEGImageEncoderList_Item
 {
 public:
     SkTIJPEGImageEncoder* Encoder;
-    android::sp<EncoderWatchdog>  WatchdogTimer;
+    nsecs_t LastUsed;   // when the last encode on it finished
+    int Users;          // encodes holding it, owned by the list lock
 };
 
 class SkTIJPEGImageEncoderListWrapper
@@ -66,9 +65,9 @@ public:
             android::List<SkTIJPEGImageEncoderList_Item*>::iterator iter = list.begin();
             SkTIJPEGImageEncoderList_Item* item = static_cast<SkTIJPEGImageEncoderList_Item*>(*iter);
             SkAutoTDelete<SkTIJPEGImageEncoder> autodelete(item->Encoder);
-            item->WatchdogTimer.clear();
             SkDebugf("SkTIJPEGImageEncoder Cleanup: 0x%x", item);
             list.erase(iter);
+            delete item;
         }
     }
     android::List<SkTIJPEGImageEncoderList_Item*> list;
@@ -76,8 +75,6 @@ public:
 
 class SkTIJPEGImageEncoderEntry :public SkImageEncoder
 {
-    friend class WatchdogThread<SkTIJPEGImageEncoderEntry>;
-
 protected:
 	virtual bool onEncode(SkWStream* stream, const SkBitmap& bm, int quality);
 
@@ -86,7 +83,7 @@ public:
     ~SkTIJPEGImageEncoderEntry();
 
 private:
-    bool WatchdogCallback(void* param);
+    static nsecs_t ReleaseIdleEncoders(nsecs_t idleTimeout, bool memoryPressure, unsigned int* released);
 };
 
 extern "C" SkImageEncoder* SkImageEncoder_HWJPEG_Factory() {
@@ -26,6 +26,17 @@
 * ============================================================================ */
 
 #include "SkImageUtility.h"
+#include <stdlib.h>
+#include <cutils/properties.h>
+
+using namespace android;
+
+#define LIFETIME_MIN_IDLE       1000000000LL    // 1 s
+#define LIFETIME_MAX_IDLE       30000000000LL   // 30 s
+#define LIFETIME_POLL           1000000000LL    // meminfo poll while codecs are alive
+#define LIFETIME_FIRST_INTERVAL 2500000000LL    // 4 intervals make the old 10 s watchdog
+#define LIFETIME_SCALE          4
+#define LIFETIME_DEFAULT_MINFREE 16384          // KB of MemFree + Cached
 
 OMX_COLOR_FORMATTYPE SkBitmapToOMXColorFormat(SkBitmap::Config config)
 {
@@ -62,3 +73,133 @@ OMX_COLOR_FORMATTYPE JPEGToOMXColorFormat(int format)
 }
 
 
+
+CodecLifetimeManager::CodecLifetimeManager(ReleaseIdleFunc releaseIdle)
+    : Thread(false),
+      mReleaseIdle(releaseIdle),
+      mKick(false),
+      mNextCheck(-1),
+      mLastUse(0),
+      mLastRelease(0),
+      mRequestInterval(LIFETIME_FIRST_INTERVAL),
+      mBurstGap(0)
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    property_get("debug.skiahw.codec.minfree", value, "");
+    mMinFreeKb = value[0] ? atol(value) : LIFETIME_DEFAULT_MINFREE;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+nsecs_t CodecLifetimeManager::idleTimeout_l()
+{
+    nsecs_t timeout = mRequestInterval * LIFETIME_SCALE;
+
+    if (timeout < mBurstGap)
+        timeout = mBurstGap;
+
+    if (timeout < LIFETIME_MIN_IDLE)
+        timeout = LIFETIME_MIN_IDLE;
+    else if (timeout > LIFETIME_MAX_IDLE)
+        timeout = LIFETIME_MAX_IDLE;
+    return timeout;
+}
+
+void CodecLifetimeManager::codecUsed(bool warm)
+{
+    Mutex::Autolock lock(mLock);
+    nsecs_t now = systemTime();
+    nsecs_t interval = mLastUse ? now - mLastUse : LIFETIME_FIRST_INTERVAL;
+
+    mLastUse = now;
+    if (warm) {
+        mStats.warmHits++;
+    } else {
+        mStats.coldStarts++;
+        /* The instance released since the last request was still wanted.
+         * Keep the next ones a bit longer than this gap between bursts,
+         * unless the gap is so long that nothing should stay warm over it. */
+        if (mLastRelease)
+            mBurstGap = (interval <= LIFETIME_MAX_IDLE) ? interval + interval / 4 : 0;
+        mLastRelease = 0;
+    }
+
+    // a long pause says nothing about the spacing inside a burst
+    if (interval > LIFETIME_MAX_IDLE)
+        interval = LIFETIME_MAX_IDLE;
+    mRequestInterval += (interval - mRequestInterval) / 8;
+
+    // the thread waits without a timeout only while the pool is empty
+    if (mNextCheck < 0) {
+        mKick = true;
+        mWakeup.signal();
+    }
+}
+
+void CodecLifetimeManager::getStats(Stats* stats)
+{
+    Mutex::Autolock lock(mLock);
+
+    *stats = mStats;
+    stats->requestInterval = mRequestInterval;
+    stats->idleTimeout = idleTimeout_l();
+}
+
+bool CodecLifetimeManager::memoryPressure()
+{
+    char line[128];
+    long memFree = -1, cached = -1;
+    FILE* meminfo;
+
+    if (mMinFreeKb <= 0)
+        return false;
+
+    meminfo = fopen("/proc/meminfo", "r");
+    if (meminfo == NULL)
+        return false;
+    while (fgets(line, sizeof(line), meminfo) && (memFree < 0 || cached < 0)) {
+        sscanf(line, "MemFree: %ld kB", &memFree);
+        sscanf(line, "Cached: %ld kB", &cached);
+    }
+    fclose(meminfo);
+
+    return memFree >= 0 && cached >= 0 && memFree + cached < mMinFreeKb;
+}
+
+bool CodecLifetimeManager::threadLoop()
+{
+    nsecs_t timeout, lastUse;
+
+    {
+        Mutex::Autolock lock(mLock);
+        if (!mKick) {
+            if (mNextCheck < 0)
+                mWakeup.wait(mLock);
+            else
+                mWakeup.waitRelative(mLock, mNextCheck < LIFETIME_POLL ? mNextCheck : LIFETIME_POLL);
+        }
+        mKick = false;
+        timeout = idleTimeout_l();
+        lastUse = mLastUse;
+    }
+
+    // the pool takes its own lock, never call it with mLock held
+    bool pressure = memoryPressure();
+    unsigned int released = 0;
+    nsecs_t next = mReleaseIdle(timeout, pressure, &released);
+
+    Mutex::Autolock lock(mLock);
+    if (pressure) {
+        mStats.pressureReleased += released;
+        // don't let the next burst pin instances for long again
+        mBurstGap = 0;
+    } else if (released) {
+        mStats.released += released;
+        mLastRelease = systemTime();
+    }
+    if (next < 0 && mLastUse != lastUse)
+        next = 0;   // an instance may have been created while we were releasing
+    mNextCheck = next;
+
+    return true;
+}
@@ -48,52 +48,58 @@ extern "C" {
 
 #define ALIGN_128_BYTE 128
 
-template <class TYPE>
-class WatchdogThread : public android::Thread
+/* Decides how long idle codec instances stay warm and releases them.
+ *
+ * The pool reports every checkout with codecUsed(). From the spacing of the
+ * checkouts the manager keeps a few request intervals' worth of idle time, and
+ * when a release turned out premature because the next request had to cold
+ * start, enough to bridge the gap between such bursts. Under memory pressure,
+ * MemFree + Cached from /proc/meminfo below debug.skiahw.codec.minfree (KB),
+ * every idle instance goes at once.
+ *
+ * Releasing is done by the pool's ReleaseIdleFunc on the manager thread. It
+ * only touches instances nobody has checked out, so it can't race with a
+ * decode or encode in flight. */
+class CodecLifetimeManager : public android::Thread
 {
 public:
-    WatchdogThread(TYPE* caller, void* caller_param, nsecs_t time):
-            android::Thread(false),
-            mCaller(caller),
-            mCallerParam(caller_param),
-            mTime(time){};
-    virtual ~WatchdogThread(){SkDebugf("~WatchdogThread()");}
-    void restart(){
-        android::Mutex::Autolock autolock(mLock);
-        mRestartTimer.signal();
-    }
-    virtual bool threadLoop(){
-        android::status_t err;
-        bool restart = false;
-        SkDebugf("WatchdogThread: Entering threadLoop()");
-        for(;;){
-            android::Mutex::Autolock autolock(mLock);
-            // SkDebugf("WatchdogThread: waitRelative %l", mTime);
-            err = mRestartTimer.waitRelative(mLock, mTime);
-            // SkDebugf("WatchdogThread: waitRelative done %d", err);
-            if(err == -ETIMEDOUT){
-                break;
-            }
-        }
-        // class that instantiates WatchdogThread must implement a "bool WatchdogCallback(void*)" function
-        // i know...not the best practice
-        restart = mCaller->WatchdogCallback(mCallerParam);
-        return restart;
-    }
+    /* Release instances idle for idleTimeout or longer, all idle ones when
+     * memoryPressure is set. Returns the time until the next check is due,
+     * or -1 when the pool is empty. */
+    typedef nsecs_t (*ReleaseIdleFunc)(nsecs_t idleTimeout, bool memoryPressure, unsigned int* released);
+
+    typedef struct Stats
+    {
+        unsigned int warmHits;          /* checkouts served by a warm instance */
+        unsigned int coldStarts;        /* checkouts that created an instance */
+        unsigned int released;          /* instances released after idling */
+        unsigned int pressureReleased;  /* instances released under memory pressure */
+        nsecs_t requestInterval;        /* average time between checkouts */
+        nsecs_t idleTimeout;            /* current keep-warm time */
+    } Stats;
+
+    CodecLifetimeManager(ReleaseIdleFunc releaseIdle);
+    virtual ~CodecLifetimeManager() {}
+
+    void codecUsed(bool warm);
+    void getStats(Stats* stats);
+
 private:
-    android::Condition mRestartTimer;
-    TYPE* mCaller;
-    void* mCallerParam;
-    android::Mutex mLock;
-    nsecs_t mTime;
-};
+    virtual bool threadLoop();
+    nsecs_t idleTimeout_l();
+    bool memoryPressure();
 
-template <class CODEC_TYPE, class WATCHDOG_TYPE>
-class SkTIJPEGImageCodecList_Item
-{
-public:
-    CODEC_TYPE* Codec;
-    android::sp<WATCHDOG_TYPE>  WatchdogTimer;
+    ReleaseIdleFunc mReleaseIdle;
+    android::Mutex mLock;
+    android::Condition mWakeup;
+    bool mKick;
+    nsecs_t mNextCheck;         // -1 while the pool is empty
+    nsecs_t mLastUse;
+    nsecs_t mLastRelease;
+    nsecs_t mRequestInterval;
+    nsecs_t mBurstGap;          // idle time that would have avoided the last cold start
+    long mMinFreeKb;
+    Stats mStats;
 };
 
 //  gives a way to increment mLoad and automatically decrement when this class instantiation goes out of scope
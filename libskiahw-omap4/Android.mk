@@ -33,6 +33,8 @@ LOCAL_CFLAGS += -fpic -fstrict-aliasing
 
 LOCAL_SRC_FILES+= \
         SkImageDecoder_libtijpeg.cpp \
+        SkJpegHwAvailability.cpp \
+        SkMpoIndex.cpp \
         SkAllocator.cpp \
         SkMemory.cpp \
 
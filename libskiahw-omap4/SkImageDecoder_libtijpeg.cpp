@@ -33,10 +33,14 @@
 */
 
 #include "SkImageDecoder_libtijpeg.h"
+#include "SkJpegHwAvailability.h"
 
 #include <timm_osal_error.h>
 #include <timm_osal_memory.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <cutils/properties.h>
 
 
 #define LOG_TAG "LIBSKIAHW"
@@ -55,6 +59,15 @@ TIMM_OSAL_U32 actualSize = 0;
 TIMM_OSAL_ERRORTYPE bReturnStatus = TIMM_OSAL_ERR_NONE;
 /* Data pipes for both the ports */
 TIMM_OSAL_PTR dataPipes[OMX_JPEGD_TEST_NUM_PORTS];
+
+///Set on a thread that asks libskia for its own JPEG decoder
+static pthread_key_t gBypassHWKey;
+static pthread_once_t gBypassHWOnce = PTHREAD_ONCE_INIT;
+
+static void CreateBypassHWKey()
+{
+    pthread_key_create(&gBypassHWKey, NULL);
+}
 //////////////////////////////////////////////////////////////////////////
 
 OMX_ERRORTYPE OMX_EventHandler(OMX_HANDLETYPE hComponent,
@@ -134,12 +147,8 @@ SkTIJPEGImageDecoder::~SkTIJPEGImageDecoder()
     /*### Do different things based on iLastState */
     LIBSKIAHW_LOGDA("Calling FREEHANDLE\n");
     if (pOMXHandle) {
-        eError = OMX_FreeHandle(pOMXHandle);
-        if ( (eError != OMX_ErrorNone) )    {
-            LIBSKIAHW_LOGEA("Error in Free Handle function\n");
-        }
+        SkJpegHwAvailability::Get().freeHandle(pOMXHandle);
         pOMXHandle = NULL;
-        OMX_Deinit();
     }
 
     if (pARMHandle) {
@@ -147,8 +156,7 @@ SkTIJPEGImageDecoder::~SkTIJPEGImageDecoder()
         pARMHandle=NULL;
         }
 
-    if(JpegHeaderInfo.MPIndexIFDTags.MPEntry)
-        delete[] JpegHeaderInfo.MPIndexIFDTags.MPEntry;
+    SkMpoIndex::Free(&JpegHeaderInfo.MPIndexIFDTags);
 
     LOG_FUNCTION_NAME_EXIT
     }
@@ -165,13 +173,15 @@ SkTIJPEGImageDecoder::SkTIJPEGImageDecoder()
 
     pOMXHandle = NULL;
     pARMHandle = NULL;
+    mArmOnly = false;
+    mView = -1;
     pBeforeDecodeTime = NULL;
     pDecodeTime = NULL;
     pAfterDecodeTime = NULL;
 
-    JpegHeaderInfo.MPIndexIFDTags.MPEntry = NULL;
+    memset(&JpegHeaderInfo.MPIndexIFDTags, 0, sizeof(JpegHeaderInfo.MPIndexIFDTags));
+    memset(&jpegDecParams, 0, sizeof(jpegDecParams));
     fileType = TYPE_JPG;
-    finalBytesRead = 0;
 
     LIBSKIAHW_LOGDB("semaphore created semaphore = 0x%x", semaphore);
 
@@ -269,23 +279,6 @@ OMX_S16 SkTIJPEGImageDecoder::GetYUVformat(OMX_U8 * Data)
     return (image_format);
     }
 
-/* BigEndianRead32Bits() gets a 32-bit value into a pointer variable */
-void SkTIJPEGImageDecoder::BigEndianRead32Bits(OMX_U32 *pVal,OMX_U8* ptr)
-{
-    *pVal = (OMX_U32)((*(ptr+3)));
-    *pVal |= (OMX_U32)((*(ptr+2)) <<8);
-    *pVal |= (OMX_U32)((*(ptr+1)) <<16);
-    *pVal |= (OMX_U32)((*(ptr)) <<24);
-}
-
-/* BigEndianRead16Bits() gets a 16-bit value into a pointer variable  */
-void SkTIJPEGImageDecoder::BigEndianRead16Bits(OMX_U16 *pVal,OMX_U8* ptr)
-{
-    *pVal = *ptr;
-    *pVal <<=8;
-    *pVal |= *(ptr+1);
-}
-
 OMX_S32 SkTIJPEGImageDecoder::ParseJpegHeader (SkStream* stream, JPEG_HEADER_INFO* JpgHdrInfo)
     {
     LOG_FUNCTION_NAME
@@ -298,11 +291,10 @@ OMX_S32 SkTIJPEGImageDecoder::ParseJpegHeader (SkStream* stream, JPEG_HEADER_INF
     OMX_U8 *Data = NULL;
     size_t bytesRead=0;
     JpgHdrInfo->nProgressive = 0; /*Default value is non progressive*/
-    OMX_U32 littleEndian = 0, skipFactor = 0, nextIFDOffset = 0, nextOffset = 0, tagValOffset = 0;
-    OMX_U32 tagCount, tagValue;
-    OMX_U8 *pOffsetRef;
-    OMX_U8 *pOffsetVal;
-    OMX_U16 MPIndexCount, tagID, tagType;
+
+    /* A pooled decoder sees many files, forget what the last one was */
+    fileType = TYPE_JPG;
+    SkMpoIndex::Free(&JpgHdrInfo->MPIndexIFDTags);
 
     a = stream->readU8();bytesRead++;
     if ( a != 0xff || stream->readU8() != M_SOI )
@@ -354,6 +346,22 @@ OMX_S32 SkTIJPEGImageDecoder::ParseJpegHeader (SkStream* stream, JPEG_HEADER_INF
             LIBSKIAHW_LOGEA("invalid marker");
             }
 
+        /* Only frame headers and the stereo segments are looked at, the rest
+           (EXIF with its thumbnail, quantization and huffman tables...) is skipped
+           without copying it. */
+        if ( marker == M_COM || marker == M_JFIF || marker == M_EXIF ||
+             marker == M_DQT || marker == M_DHT || marker == M_DRI )
+            {
+            got = stream->skip(itemlen-2);
+            bytesRead += got;
+            if ( got != itemlen-2 )
+                {
+                LIBSKIAHW_LOGEA("Premature end of file?");
+                return 0;
+                }
+            continue;
+            }
+
         Data = (OMX_U8 *)malloc(itemlen);
         if ( Data == NULL )
             {
@@ -529,26 +537,10 @@ OMX_S32 SkTIJPEGImageDecoder::ParseJpegHeader (SkStream* stream, JPEG_HEADER_INF
                         {
                             LIBSKIAHW_LOGDA("Valid MPO type file \n");
                             fileType = TYPE_MPO;
-                            pOffsetRef = Data + MP_START_OF_OFFSET_REF; // Start of reference
-                            finalBytesRead  =bytesRead + 4 - got;// reset and add MP Format ID
-
-                            if(*(pOffsetRef) == 0x49 && *(pOffsetRef+1) == 0x49 /*&& *(pOffsetRef+2) == 0x2A && *(pOffsetRef+3) == 0x00 */)
-                            {
-                                //LIBSKIAHW_LOGDA("Little Endian \n");
-                                littleEndian = 1;
-                            }
-                            Data += 0x0A;//Skipping to read the offset
-                            // Read 0th IFD offset
-                            if(littleEndian)
-                                skipFactor = (OMX_U32) (*Data);
-                            else
-                                BigEndianRead32Bits(&skipFactor,Data);
 
-                            Data = pOffsetRef + skipFactor; // Jump to 0th IFD
-
-                            // Reset the offset value
-                            nextIFDOffset = 0;
-                            tagValue = 0;
+                            // the segment body starts right after the length
+                            if(!SkMpoIndex::Parse(Data + 2, itemlen - 2, bytesRead - got, &JpgHdrInfo->MPIndexIFDTags))
+                                goto EXIT;
 
                              //Default parameters for now
                             JpgHdrInfo->s3dDesc.nType = 0x01; // STEROSCOPIC IMAGES
@@ -556,212 +548,8 @@ OMX_S32 SkTIJPEGImageDecoder::ParseJpegHeader (SkStream* stream, JPEG_HEADER_INF
                             JpgHdrInfo->s3dDesc.nFrameOrder = S3D_ORDER_LF;
                             JpgHdrInfo->s3dDesc.nSubSampling = S3D_SS_NONE;
                             JpgHdrInfo->s3dDesc.nSeparation = NULL;
-
-                            do
-                            {
-                                Data += nextIFDOffset;
-                                //nextIFDOffset = 0;
-
-                                if(littleEndian)
-                                {
-                                    MPIndexCount = (OMX_U16)((*Data) + (*(Data+1)<<8));
-                                }
-                                else
-                                {
-                                    BigEndianRead16Bits(&MPIndexCount,Data);
-                                }
-                                Data += sizeof(OMX_U16);
-
-                                for(int j=0;j<MPIndexCount;j++)
-                                {
-                                    if(littleEndian)
-                                    {
-                                        tagID = (OMX_U16)((*Data) + (*(Data+1)<<8));
-                                        Data += sizeof(OMX_U16);
-
-                                        tagType = (OMX_U16)((*Data) + (*(Data+1)<<8));
-                                        Data += sizeof(OMX_U16);
-
-                                        tagCount = (OMX_U32)((*Data) + (*(Data+1)<<8) +
-                                                              (*(Data+2)<<16) + (*(Data+3)<<24));
-                                        Data += sizeof(OMX_U32);
-
-                                        tagValue = (OMX_U32)((*Data) + (*(Data+1)<<8) +
-                                                              (*(Data+2)<<16) + (*(Data+3)<<24));
-                                        Data += sizeof(OMX_U32);
-
-                                    }
-                                    else
-                                    {
-                                        BigEndianRead16Bits(&tagID,Data);
-                                        Data += sizeof(OMX_U16);
-
-                                        BigEndianRead16Bits(&tagType,Data);
-                                        Data += sizeof(OMX_U16);
-
-                                        BigEndianRead32Bits(&tagCount,Data);
-                                        Data += sizeof(OMX_U32);
-
-                                        BigEndianRead32Bits(&tagValue,Data);
-                                        Data += sizeof(OMX_U32);
-                                    }
-
-                                    switch (tagID)
-                                    {
-                                        case TAGID_MPFVERSION://MPFVersion
-
-                                            if((tagType != (OMX_U16)TAG_TYPE_UNDEFINED))
-                                                goto EXIT;
-
-                                            //LIBSKIAHW_LOGDA("MPF Version \n");
-                                            JpgHdrInfo->MPIndexIFDTags.MPFVersion = tagValue;
-                                            //TODO: Passed this structure to upper layers
-                                            break;
-                                        case TAGID_NIMAGES://Number of Images
-
-                                            if((tagType != (OMX_U16)TAG_TYPE_LONG))
-                                                goto EXIT;
-
-                                            JpgHdrInfo->MPIndexIFDTags.numberOfImages = (OMX_U8) tagValue;
-                                            //LIBSKIAHW_LOGDA("Number of Images %x \n", JpgHdrInfo->MPIndexIFDTags.numberOfImages);
-                                            //TODO: Passed this structure to upper layers
-                                            break;
-                                        case TAGID_MPENTRY://MPEntry
-
-                                            if((tagType != (OMX_U16)TAG_TYPE_UNDEFINED))
-                                                goto EXIT;
-
-                                            //LIBSKIAHW_LOGDA("MPEntry \n");
-                                            pOffsetVal = pOffsetRef + tagValue;
-                                            JpgHdrInfo->MPIndexIFDTags.MPEntry = new MP_ENTRY[(int)(tagCount/16)];
-                                            for(int i=0;i<(int)(tagCount/16);i++)
-                                            {
-                                                JpgHdrInfo->MPIndexIFDTags.MPEntry[i].imageAttribute =
-                                                (OMX_U32)((*pOffsetVal) + (*(pOffsetVal+1)<<8) + (*(pOffsetVal+2)<<16) + (*(pOffsetVal+3)<<24));
-                                                pOffsetVal += sizeof(OMX_U32);
-                                               // LIBSKIAHW_LOGDA("MPEntryAttribute %x \n", JpgHdrInfo->MPIndexIFDTags.MPEntry[i].imageAttribute);
-
-                                                JpgHdrInfo->MPIndexIFDTags.MPEntry[i].imageSize =
-                                                (OMX_U32)((*pOffsetVal) + (*(pOffsetVal+1)<<8) + (*(pOffsetVal+2)<<16) + (*(pOffsetVal+3)<<24));
-                                                pOffsetVal += sizeof(OMX_U32);
-                                               //  LIBSKIAHW_LOGDA("MPEntry ImageSize %x \n", JpgHdrInfo->MPIndexIFDTags.MPEntry[i].imageSize);
-
-                                                JpgHdrInfo->MPIndexIFDTags.MPEntry[i].dataOffset =
-                                                (OMX_U32)((*pOffsetVal) + (*(pOffsetVal+1)<<8) + (*(pOffsetVal+2)<<16) + (*(pOffsetVal+3)<<24));
-                                                pOffsetVal += sizeof(OMX_U32);
-                                                // LIBSKIAHW_LOGDA("MPEntry dataOffset%x \n", JpgHdrInfo->MPIndexIFDTags.MPEntry[i].dataOffset);
-
-                                                JpgHdrInfo->MPIndexIFDTags.MPEntry[i].dependentImage1=
-                                                (OMX_U16)((*pOffsetVal) + (*(pOffsetVal+1)<<8));
-                                                pOffsetVal += sizeof(OMX_U16);
-                                                // LIBSKIAHW_LOGDA("MPEntrydependentImage1  %x \n", JpgHdrInfo->MPIndexIFDTags.MPEntry[i].dependentImage1);
-
-                                                JpgHdrInfo->MPIndexIFDTags.MPEntry[i].dependentImage2 =
-                                                (OMX_U16)((*pOffsetVal) + (*(pOffsetVal+1)<<8));
-                                                pOffsetVal += sizeof(OMX_U16);
-                                                //  LIBSKIAHW_LOGDA("MPEntry dependentImage2  %x \n", JpgHdrInfo->MPIndexIFDTags.MPEntry[i].dependentImage2);
-
-                                            }
-
-                                            pOffsetVal = NULL;
-                                        break;
-                                        case TAGID_UIDLIST://Indifidual Image Unique ID list
-
-                                            if((tagType != (OMX_U16)TAG_TYPE_UNDEFINED))
-                                                goto EXIT;
-
-                                            //LIBSKIAHW_LOGDA("Image Unique ID list Non-supported\n");
-                                            //TODO: Passed this structure to upper layers
-
-                                        break;
-                                        case TAGID_TFRAMES://Total number of capture frames
-
-                                            if((tagType != (OMX_U16)TAG_TYPE_LONG))
-                                                goto EXIT;
-
-                                            JpgHdrInfo->MPIndexIFDTags.totalFrames = (OMX_U8) tagValue;
-                                            //TODO: Passed this structure to upper layers
-                                            //LIBSKIAHW_LOGDA("Number of captures frames  %x \n", JpgHdrInfo->MPIndexIFDTags.totalFrames);
-
-                                        break;
-                                        case TAGID_MPIMAGENUM: //MP Individual Image Number
-
-                                             if((tagType != (OMX_U16)TAG_TYPE_LONG))
-                                                goto EXIT;
-
-                                            JpgHdrInfo->MPIndexIFDTags.MPIndividualNum= tagValue;
-                                            //LIBSKIAHW_LOGDA("MP Individual Image Number  %x \n", JpgHdrInfo->MPIndexIFDTags.MPIndividualNum);
-
-                                            if(tagValue == 0x1)
-                                                JpgHdrInfo->s3dDesc.nFrameOrder = S3D_ORDER_LF;
-
-                                        break;
-                                        case TAGID_PANSCANORIENTATION: // Panorama Scanning Orientation
-
-                                             if((tagType != (OMX_U16)TAG_TYPE_LONG))
-                                                goto EXIT;
-
-                                            //LIBSKIAHW_LOGDA("Panorama Scanning Information not yet supported \n");
-                                            //TODO: Passed this structure to upper layers
-
-                                        break;
-                                        case TAGID_BVPOINTNUM: //Base Viewpoint Number
-
-                                            if((tagType != (OMX_U16)TAG_TYPE_LONG))
-                                                goto EXIT;
-
-                                            JpgHdrInfo->MPIndexIFDTags.baseViewpointNum= tagValue;
-                                            //LIBSKIAHW_LOGDA("Base Viewpoint Number %x  \n", JpgHdrInfo->MPIndexIFDTags.baseViewpointNum);
-                                            //TODO: Passed this structure to upper layers
-
-                                        break;
-                                        case TAGID_CONVANG: //Convergence Angle
-
-                                            if((tagType != (OMX_U16)TAG_TYPE_SRATIONAL))
-                                                goto EXIT;
-
-                                            JpgHdrInfo->MPIndexIFDTags.convergenceAngle = tagValue;// Need to convert it to a 64 bits value according to standard
-                                            //LIBSKIAHW_LOGDA("Convergence Angle  %x \n", JpgHdrInfo->MPIndexIFDTags.convergenceAngle );
-                                            //TODO: Passed this structure to upper layers
-
-                                        break;
-                                        case TAGID_BASELINELEN: //Base Line Length
-
-                                            if((tagType != (OMX_U16)TAG_TYPE_RATIONAL))
-                                                goto EXIT;
-
-                                            JpgHdrInfo->MPIndexIFDTags.baselineLength= tagValue;// Need to convert it to a 64 bits value according to standard
-                                            //LIBSKIAHW_LOGDA("Base Line Length  %x \n", JpgHdrInfo->MPIndexIFDTags.baselineLength);
-                                            //TODO: Passed this structure to upper layers
-
-                                        break;
-                                        default:
-                                            LIBSKIAHW_LOGDA("Not Supported \n");
-                                        break;
-                                    }
-                                }
-                                //At the end of the IFD, read the nextIFD offset
-                                if(littleEndian)
-                                {
-                                    nextIFDOffset = (OMX_U32)((*Data) + (*(Data+1)<<8) +
-                                                          (*(Data+2)<<16) + (*(Data+3)<<24));
-                                    //LIBSKIAHW_LOGDA("Resseting offset %x \n", nextIFDOffset);
-                                }
-                                else
-                                {
-                                    BigEndianRead32Bits(&nextIFDOffset,Data);
-                                }
-                                if((nextIFDOffset >(itemlen-6))) //APP2 field length (2bytes) + MPformat ID (4 bytes)
-                                    {
-                                        //LIBSKIAHW_LOGDA("size of app %d \n", itemlen);
-                                        nextIFDOffset =0;
-                                    }
-
-                                Data = pOffsetRef; // Reset
-
-                            }while(nextIFDOffset!=NULL);
-                            Data = pOffsetRef -MP_START_OF_OFFSET_REF;
                         }
+                    break;
                     }
             default:
                      {
@@ -831,6 +619,8 @@ void SkTIJPEGImageDecoder::EventHandler(OMX_HANDLETYPE hComponent,
     {
     LOG_FUNCTION_NAME
 
+    SkJpegHwAvailability::Get().onEvent(eEvent, nData1);
+
     switch ( eEvent )
         {
 
@@ -930,11 +720,17 @@ bool SkTIJPEGImageDecoder::onDecode(SkStream* stream, SkBitmap* bm, Mode mode)
 {
     LOG_FUNCTION_NAME
     LIBSKIAHW_LOGEB ("Process %x calling onDecode", getpid());
-    if(IsHwFormat(stream) && IsHwAvailable())
+    if(IsHwFormat(stream) && !mArmOnly && IsHwAvailable())
         {
         LOG_FUNCTION_NAME_EXIT
         return onDecodeOmx(stream, bm, mode);
 
+        }
+    else if(jpegDecParams.nXLength && jpegDecParams.nYLength)
+        {
+        ///Regions SIMCOP can't take are decoded from the wrapper's libjpeg tile index
+        LOG_FUNCTION_NAME_EXIT
+        return false;
         }
     else
         {
@@ -943,30 +739,34 @@ bool SkTIJPEGImageDecoder::onDecode(SkStream* stream, SkBitmap* bm, Mode mode)
         }
 }
 
-///Method which tries to acquire SIMCOP resource
+///Method which tries to acquire SIMCOP resource. Whether the component exists and
+///whether it is worth asking is answered process wide, so a decoder without a handle
+///only goes to OMX when a handle is likely to be granted.
 bool SkTIJPEGImageDecoder::IsHwAvailable()
 {
     LOG_FUNCTION_NAME
-    char strTIJpegDec[] = "OMX.TI.DUCATI1.IMAGE.JPEGD";
     OMX_ERRORTYPE eError = OMX_ErrorNone;
 
-    AutoTimeMillis atm("Init time: ");
-
     if(pOMXHandle)
         {
         return true;
         }
 
-    OMX_Init();
+    if (!SkJpegHwAvailability::Get().isAvailable())
+        {
+        LOG_FUNCTION_NAME_EXIT
+        return false;
+        }
+
+    AutoTimeMillis atm("Init time: ");
 
     OMX_CALLBACKTYPE JPEGCallBack ={OMX_EventHandler, OMX_EmptyBufferDone, OMX_FillBufferDone};
 
-    eError = OMX_GetHandle(&pOMXHandle, strTIJpegDec, (void *)this, &JPEGCallBack);
+    eError = SkJpegHwAvailability::Get().getHandle(&pOMXHandle, (void *)this, &JPEGCallBack);
     if ( (eError != OMX_ErrorNone) ||  (pOMXHandle == NULL) )
         {
         LIBSKIAHW_LOGEB ("Error in Get Handle function eError %d\n", eError);
         pOMXHandle = NULL;
-         OMX_Deinit();
          LOG_FUNCTION_NAME_EXIT
          return false;
         }
@@ -980,21 +780,28 @@ bool SkTIJPEGImageDecoder::IsHwAvailable()
 
 }
 
-bool SkTIJPEGImageDecoder::isValidStream(SkStream* stream, int nextFileOffset)
+///libskia's JPEG factory asks SkImageDecoder_HWJPEG_Factory first, which steps aside for this thread
+SkImageDecoder* SkTIJPEGImageDecoder::NewArmDecoder(SkStream* stream)
 {
-        OMX_U8 a = 0;
+    SkImageDecoder* decoder;
 
-        a = stream->readU8();
-        if ( a != 0xff || stream->readU8() != M_SOI )
+    pthread_once(&gBypassHWOnce, CreateBypassHWKey);
+    pthread_setspecific(gBypassHWKey, (void*)1);
+    stream->rewind();
+    decoder = SkImageDecoder::Factory(stream);
+    pthread_setspecific(gBypassHWKey, NULL);
+    stream->rewind();
+
+    if (decoder != NULL && decoder->getFormat() != kJPEG_Format)
         {
-            stream->rewind();
-            return false;
+        SkDELETE(decoder);
+        decoder = NULL;
         }
-        else
+    if (decoder == NULL)
         {
-            stream->rewind();
-            return true;
+        LIBSKIAHW_LOGEA("libskia has no libjpeg decoder");
         }
+    return decoder;
 }
 
 ///Method for decoding using ARM decoder
@@ -1002,22 +809,37 @@ bool SkTIJPEGImageDecoder::onDecodeArm(SkStream* stream, SkBitmap* bm, Mode mode
 {
     if(!pARMHandle)
         {
-        pARMHandle = SkNEW(SkJPEGImageDecoder);
+        pARMHandle = NewArmDecoder(stream);
         if(!pARMHandle)
             {
             return false;
             }
         }
     bool ret=false;
-    int nextFileOffset;
     stream->rewind();
 
     pARMHandle->setSampleSize(this->getSampleSize());
     pARMHandle->setDitherImage(this->getDitherImage());
     pARMHandle->SetDeviceConfig(this->GetDeviceConfig());
+    // the S3D allocator of an earlier MPO must not stick
+    pARMHandle->setAllocator(this->getAllocator());
     int scaleFactor = this->getSampleSize();
+    int views = SkMpoIndex::Views(&JpegHeaderInfo.MPIndexIFDTags);
 
-    if(fileType== TYPE_MPO)
+    if(fileType== TYPE_MPO && mView >= 0)
+    {
+        // one view as a plain 2D image, straight from its offset
+        if(mView >= views)
+            return false;
+
+        SkMpoViewStream view(stream, SkMpoIndex::ViewOffset(&JpegHeaderInfo.MPIndexIFDTags, mView),
+                             SkMpoIndex::ViewLength(&JpegHeaderInfo.MPIndexIFDTags, mView));
+        if(!view.isValid())
+            return false;
+
+        return pARMHandle->decode(&view, bm, mode);
+    }
+    else if(fileType== TYPE_MPO)
     {
         //LIBSKIAHW_LOGDA("ARM decoder for MPO file thread Id %x , scaleFactor=%d, mode=%d, config=%d \n", pthread_self(), scaleFactor, mode, this->GetDeviceConfig());
         bm->setConfig(this->GetDeviceConfig(), (JpegHeaderInfo.nWidth/scaleFactor),(JpegHeaderInfo.nHeight/scaleFactor), JpegHeaderInfo.s3dDesc);
@@ -1030,24 +852,15 @@ bool SkTIJPEGImageDecoder::onDecodeArm(SkStream* stream, SkBitmap* bm, Mode mode
         S3DAllocator.config(fileType, bm->width(), (bm->height() *JpegHeaderInfo.MPIndexIFDTags.numberOfImages), JpegHeaderInfo.MPIndexIFDTags.numberOfImages);
         pARMHandle->setAllocator(&S3DAllocator);
 
-        for(int i=0;i < JpegHeaderInfo.MPIndexIFDTags.numberOfImages;i++)
+        // Each view is decoded from its own window on the stream, found through
+        // the MP index with bulk skips instead of reading up to it
+        for(int i=0;i < views;i++)
         {
-            // The offset of the first image is 0, so skip from next image
-            if(i)
-            {
-                nextFileOffset = JpegHeaderInfo.MPIndexIFDTags.MPEntry[i].dataOffset + finalBytesRead;
-
-                stream->rewind();
-                // Skipping to offset
-                for(int j=0;j<nextFileOffset;j++)
-                    stream->read(NULL, 1);
-                /*int realSize = stream->skip((size_t) (myoffset));
-                LIBSKIAHW_LOGDA("Skipping by %d bytes \n", realSize);*/
-
-                if(!isValidStream(stream, nextFileOffset))
-                    return true;
-            }
-            ret = pARMHandle->decode(stream, bm, mode);
+            SkMpoViewStream view(stream, SkMpoIndex::ViewOffset(&JpegHeaderInfo.MPIndexIFDTags, i),
+                                 SkMpoIndex::ViewLength(&JpegHeaderInfo.MPIndexIFDTags, i));
+            if(!view.isValid())
+                break;
+            ret = pARMHandle->decode(&view, bm, mode);
         }
         S3DAllocator.reset(bm);
         return ret;
@@ -1071,7 +884,7 @@ bool SkTIJPEGImageDecoder::onDecodeOmx(SkStream* stream, SkBitmap* bm, Mode mode
     {
     LOG_FUNCTION_NAME
 
-    android::gTIJpegDecMutex.lock();
+    mDecodeLock.lock();
     /* Critical section */
 
 #ifdef TIME_DECODE
@@ -1086,6 +899,8 @@ bool SkTIJPEGImageDecoder::onDecodeOmx(SkStream* stream, SkBitmap* bm, Mode mode
     int nIndex2;
     int scaleFactor;
     int bitsPerPixel;
+    int nOutWidth;
+    int nOutHeight;
     void *p_out=NULL;
     MemAllocBlock *MemReqDescTiler;
     OMX_S32 nCompId = 100;
@@ -1120,7 +935,19 @@ bool SkTIJPEGImageDecoder::onDecodeOmx(SkStream* stream, SkBitmap* bm, Mode mode
     if (config == SkBitmap::kNo_Config)
         config = SkImageDecoder::GetDeviceConfig();
 
-    bm->setConfig(config, JpegHeaderInfo.nWidth/scaleFactor, JpegHeaderInfo.nHeight/scaleFactor);
+    ///A sub region only needs an output buffer of its own size
+    if (jpegDecParams.nXLength && jpegDecParams.nYLength)
+        {
+        nOutWidth = jpegDecParams.nXLength/scaleFactor;
+        nOutHeight = jpegDecParams.nYLength/scaleFactor;
+        }
+    else
+        {
+        nOutWidth = JpegHeaderInfo.nWidth/scaleFactor;
+        nOutHeight = JpegHeaderInfo.nHeight/scaleFactor;
+        }
+
+    bm->setConfig(config, nOutWidth, nOutHeight);
     bm->setIsOpaque(true);
     LIBSKIAHW_LOGDB("bm->width() = %d\n", bm->width());
     LIBSKIAHW_LOGDB("bm->height() = %d\n", bm->height());
@@ -1129,7 +956,7 @@ bool SkTIJPEGImageDecoder::onDecodeOmx(SkStream* stream, SkBitmap* bm, Mode mode
 
     if (SkImageDecoder::kDecodeBounds_Mode == mode)
         {
-        android::gTIJpegDecMutex.unlock();
+        mDecodeLock.unlock();
         LIBSKIAHW_LOGDA("Leaving Critical Section 1 \n");
         return true;
         }
@@ -1217,13 +1044,13 @@ bool SkTIJPEGImageDecoder::onDecodeOmx(SkStream* stream, SkBitmap* bm, Mode mode
     OutPortDef.eDomain = OMX_PortDomainImage;
     OutPortDef.format.image.cMIMEType = (OMX_STRING)"OMXJPEGD";
     OutPortDef.format.image.pNativeRender = 0;
-    OutPortDef.format.image.nFrameWidth = JpegHeaderInfo.nWidth/scaleFactor;
+    OutPortDef.format.image.nFrameWidth = nOutWidth;
     LIBSKIAHW_LOGDB("\nOutPortDef.format.image.nFrameWidth = %d\n", (int)OutPortDef.format.image.nFrameWidth);
 
-    OutPortDef.format.image.nFrameHeight = JpegHeaderInfo.nHeight/scaleFactor;
+    OutPortDef.format.image.nFrameHeight = nOutHeight;
     LIBSKIAHW_LOGDB("\nOutPortDef.format.image.nFrameHeight = %d\n", (int)OutPortDef.format.image.nFrameHeight);
 
-    OutPortDef.format.image.nStride = JpegHeaderInfo.nWidth/scaleFactor;
+    OutPortDef.format.image.nStride = nOutWidth;
     LIBSKIAHW_LOGDB("\n OutPortDef.format.image.nStride = %d\n", (int)OutPortDef.format.image.nStride);
 
     OutPortDef.format.image.nSliceHeight = 0;
@@ -1257,7 +1084,7 @@ bool SkTIJPEGImageDecoder::onDecodeOmx(SkStream* stream, SkBitmap* bm, Mode mode
         bitsPerPixel = 2;
         }
 
-    OutPortDef.nBufferSize = (JpegHeaderInfo.nWidth / scaleFactor ) * (JpegHeaderInfo.nHeight / scaleFactor) * bitsPerPixel ;
+    OutPortDef.nBufferSize = nOutWidth * nOutHeight * bitsPerPixel ;
     LIBSKIAHW_LOGDB("Output buffer size is %ld\n", OutPortDef.nBufferSize);
 
 
@@ -1295,10 +1122,10 @@ bool SkTIJPEGImageDecoder::onDecodeOmx(SkStream* stream, SkBitmap* bm, Mode mode
     pSubRegionDecode.nVersion.s.nRevision = 0x0;
     pSubRegionDecode.nVersion.s.nStep = 0x0;
 
-    pSubRegionDecode.nXOrg = 0;
-    pSubRegionDecode.nYOrg = 0;
-    pSubRegionDecode.nXLength = 0;
-    pSubRegionDecode.nYLength = 0;
+    pSubRegionDecode.nXOrg = jpegDecParams.nXOrg;
+    pSubRegionDecode.nYOrg = jpegDecParams.nYOrg;
+    pSubRegionDecode.nXLength = jpegDecParams.nXLength;
+    pSubRegionDecode.nYLength = jpegDecParams.nYLength;
 
     /* Set Parameteres OMX_IMAGE_PARAM_DECODE_SUBREGION   */
     eError = OMX_SetParameter(pOMXHandle,(OMX_INDEXTYPE)OMX_TI_IndexParamDecodeSubregion,&pSubRegionDecode);
@@ -1343,7 +1170,7 @@ bool SkTIJPEGImageDecoder::onDecodeOmx(SkStream* stream, SkBitmap* bm, Mode mode
 
     LIBSKIAHW_LOGDB(" \n THE ADDRESSSS OFFFF BM->getPixels(): %p  \n", bm->getPixels());
 }
-    android::gTIJpegDecMutex.unlock();
+    mDecodeLock.unlock();
     pBeforeDecodeTime=new AutoTimeMillis("Before_BufferDecode Time");
     Run();
 
@@ -1354,7 +1181,7 @@ EXIT:
         sem_post(semaphore);
         Run();
     }
-    android::gTIJpegDecMutex.unlock();
+    mDecodeLock.unlock();
     LIBSKIAHW_LOGDA("Leaving Critical Section 3 \n");
 
     LOG_FUNCTION_NAME_EXIT
@@ -1576,17 +1403,156 @@ void SkTIJPEGImageDecoder::Run()
     LOG_FUNCTION_NAME_EXIT
     }
 
-///@optimization Use one global instance of decoder so that we don't have to call OMX_GetHandle, OMX_FreeHandle every time
-static SkTIJPEGImageDecoder gJpegDecoder;
+///@optimization Keep a small pool of decoder instances so that we don't have to call OMX_GetHandle,
+///OMX_FreeHandle every time. Each instance owns its OMX handle, so decodes on different instances run
+///concurrently. debug.skiahw.jpegdec.instances sets the pool size, debug.skiahw.jpegdec.queue how many
+///decodes may wait for an instance before the next one is decoded on ARM.
+#define MAX_DECODER_INSTANCES 4
+#define DEFAULT_DECODER_INSTANCES 1
+
+class SkTIJPEGImageDecoderPool {
+public:
+    SkTIJPEGImageDecoderPool()
+        {
+        mCapacity = 0;
+        mQueueDepth = 0;
+        mNextTicket = 0;
+        mServingTicket = 0;
+        memset(mDecoders, 0, sizeof(mDecoders));
+        memset(mBusy, 0, sizeof(mBusy));
+        }
+
+    ~SkTIJPEGImageDecoderPool()
+        {
+        for (int i = 0; i < MAX_DECODER_INSTANCES; i++)
+            {
+            delete mDecoders[i];
+            }
+        }
+
+    ///Returns an idle decoder in arrival order, or NULL when the pool is saturated and
+    ///enough decodes are already waiting
+    SkTIJPEGImageDecoder* acquire()
+        {
+        android::Mutex::Autolock lock(mLock);
+        SkTIJPEGImageDecoder* decoder = NULL;
+        unsigned int ticket;
+        int idle;
+
+        if (mCapacity == 0)
+            {
+            readProperties();
+            }
+
+        idle = findIdle();
+        if ((idle < 0) && ((mNextTicket - mServingTicket) >= mQueueDepth))
+            {
+            return NULL;
+            }
+
+        ticket = mNextTicket++;
+        while ((ticket != mServingTicket) || ((idle = findIdle()) < 0))
+            {
+            mAvailable.wait(mLock);
+            }
+
+        if (mDecoders[idle] == NULL)
+            {
+            mDecoders[idle] = new SkTIJPEGImageDecoder;
+            }
+        mBusy[idle] = true;
+        mServingTicket++;
+        mAvailable.broadcast();
+
+        return mDecoders[idle];
+        }
+
+    void release(SkTIJPEGImageDecoder* decoder)
+        {
+        android::Mutex::Autolock lock(mLock);
+
+        for (unsigned int i = 0; i < mCapacity; i++)
+            {
+            if (mDecoders[i] == decoder)
+                {
+                mBusy[i] = false;
+                }
+            }
+        mAvailable.broadcast();
+        }
+
+private:
+    void readProperties()
+        {
+        char value[PROPERTY_VALUE_MAX];
+
+        property_get("debug.skiahw.jpegdec.instances", value, "0");
+        mCapacity = atoi(value);
+        if (mCapacity == 0)
+            {
+            mCapacity = DEFAULT_DECODER_INSTANCES;
+            }
+        else if (mCapacity > MAX_DECODER_INSTANCES)
+            {
+            mCapacity = MAX_DECODER_INSTANCES;
+            }
+
+        property_get("debug.skiahw.jpegdec.queue", value, "-1");
+        mQueueDepth = (atoi(value) < 0) ? mCapacity : atoi(value);
+
+        LIBSKIAHW_LOGDB("decoder pool: %d instances, %d queued", mCapacity, mQueueDepth);
+        }
+
+    ///Instances are created on first use, so an unused slot counts as idle
+    int findIdle()
+        {
+        for (unsigned int i = 0; i < mCapacity; i++)
+            {
+            if (!mBusy[i])
+                {
+                return i;
+                }
+            }
+        return -1;
+        }
+
+    android::Mutex mLock;
+    android::Condition mAvailable;
+    SkTIJPEGImageDecoder* mDecoders[MAX_DECODER_INSTANCES];
+    bool mBusy[MAX_DECODER_INSTANCES];
+    unsigned int mCapacity;
+    unsigned int mQueueDepth;
+    unsigned int mNextTicket;
+    unsigned int mServingTicket;
+};
+
+static SkTIJPEGImageDecoderPool gJpegDecoderPool;
+
+///SIMCOP decodes sub regions from MCU boundaries, 16x16 covers every subsampling
+#define REGION_ALIGN 16
 
 ///Wrapper class which will be created every time by the factory method.
-///This class wraps the handle to the global singleton jpeg decoder instance
+///It borrows a decoder from the pool for the duration of one decode.
 class SkJPEGTIImageDecoderWrapper : public SkImageDecoder {
 public:
-    SkJPEGTIImageDecoderWrapper(SkImageDecoder* ptr)
+    SkJPEGTIImageDecoderWrapper(int view = -1) : mView(view)
         {
-        mPtr = ptr;
+            memset(&mDecParams, 0, sizeof(mDecParams));
+            mTileStream = NULL;
+            mTileWidth = 0;
+            mTileHeight = 0;
+            mTileArm = NULL;
+        }
+
+    virtual ~SkJPEGTIImageDecoderWrapper()
+        {
+            SkDELETE(mTileArm);
+            if (mTileStream != NULL)
+                {
+                mTileStream->unref();
+                }
         }
+
     virtual Format getFormat() const {
         return kJPEG_Format;
     }
@@ -1595,18 +1561,164 @@ protected:
     virtual bool onDecode(SkStream* stream, SkBitmap* bm,
                           Mode mode)
         {
-            mPtr->setSampleSize(this->getSampleSize());
-            mPtr->setDitherImage(this->getDitherImage());
-            mPtr->SetDeviceConfig(this->GetDeviceConfig());
-            return mPtr->decode(stream, bm, mode);
+            SkTIJPEGImageDecoder* decoder = gJpegDecoderPool.acquire();
+            if (decoder == NULL)
+                {
+                // pool saturated, a private instance still handles MPO and JPS on ARM
+                SkTIJPEGImageDecoder armDecoder;
+                armDecoder.SetArmOnly(true);
+                return decodeWith(&armDecoder, stream, bm, mode);
+                }
+
+            bool ret = decodeWith(decoder, stream, bm, mode);
+            gJpegDecoderPool.release(decoder);
+            return ret;
         }
-public:
-    SkImageDecoder *mPtr;
+
+    ///Only the header is read here, the decoder owns the stream from then on
+    virtual bool onBuildTileIndex(SkStream* stream, int* width, int* height)
+        {
+            SkAutoTDelete<SkImageDecoder> boundsDecoder(SkTIJPEGImageDecoder::NewArmDecoder(stream));
+            SkBitmap bm;
+
+            if (boundsDecoder.get() == NULL || !boundsDecoder->decode(stream, &bm, kDecodeBounds_Mode))
+                {
+                return false;
+                }
+
+            SkDELETE(mTileArm);
+            mTileArm = NULL;
+            if (mTileStream != NULL)
+                {
+                mTileStream->unref();
+                }
+
+            mTileStream = stream;
+            *width = mTileWidth = bm.width();
+            *height = mTileHeight = bm.height();
+            return true;
+        }
+
+    ///SIMCOP decodes the region grown out to MCU boundaries into a buffer of that
+    ///size and the margin is cropped off. Anything SIMCOP doesn't take goes to the
+    ///libjpeg tile index, which stops at the last MCU row of the region.
+    virtual bool onDecodeRegion(SkBitmap* bm, SkIRect rect)
+        {
+            SkBitmap decoded;
+            bool ret = false;
+
+            if (mTileStream == NULL || !rect.intersect(0, 0, mTileWidth, mTileHeight))
+                {
+                return false;
+                }
+
+            SkTIJPEGImageDecoder* decoder = gJpegDecoderPool.acquire();
+            if (decoder != NULL)
+                {
+                mDecParams.nXOrg = rect.fLeft & ~(REGION_ALIGN - 1);
+                mDecParams.nYOrg = rect.fTop & ~(REGION_ALIGN - 1);
+                mDecParams.nXLength = SkMin32((rect.fRight + REGION_ALIGN - 1) & ~(REGION_ALIGN - 1), mTileWidth) - mDecParams.nXOrg;
+                mDecParams.nYLength = SkMin32((rect.fBottom + REGION_ALIGN - 1) & ~(REGION_ALIGN - 1), mTileHeight) - mDecParams.nYOrg;
+
+                mTileStream->rewind();
+                ret = decodeWith(decoder, mTileStream, &decoded, kDecodePixels_Mode);
+                gJpegDecoderPool.release(decoder);
+                }
+
+            if (!ret)
+                {
+                memset(&mDecParams, 0, sizeof(mDecParams));
+                return decodeRegionArm(bm, rect);
+                }
+
+            int x = (rect.fLeft - mDecParams.nXOrg) * decoded.width() / mDecParams.nXLength;
+            int y = (rect.fTop - mDecParams.nYOrg) * decoded.height() / mDecParams.nYLength;
+            int w = SkMin32(SkMax32(rect.width() * decoded.width() / mDecParams.nXLength, 1), decoded.width() - x);
+            int h = SkMin32(SkMax32(rect.height() * decoded.height() / mDecParams.nYLength, 1), decoded.height() - y);
+            memset(&mDecParams, 0, sizeof(mDecParams));
+
+            if (x == 0 && y == 0 && w == decoded.width() && h == decoded.height())
+                {
+                *bm = decoded;
+                return true;
+                }
+
+            bm->setConfig(decoded.config(), w, h);
+            if (!this->allocPixelRef(bm, NULL))
+                {
+                return false;
+                }
+
+            int bytesPerPixel = decoded.bytesPerPixel();
+            for (int row = 0; row < h; row++)
+                {
+                memcpy((char*)bm->getPixels() + row * bm->rowBytes(),
+                       (char*)decoded.getPixels() + (y + row) * decoded.rowBytes() + x * bytesPerPixel,
+                       w * bytesPerPixel);
+                }
+            return true;
+        }
+
+private:
+    bool decodeRegionArm(SkBitmap* bm, const SkIRect& rect)
+        {
+            if (mTileArm == NULL)
+                {
+                int width, height;
+
+                ///The index holds a reference of its own and seeks the stream as it needs
+                mTileArm = SkTIJPEGImageDecoder::NewArmDecoder(mTileStream);
+                if (mTileArm == NULL)
+                    {
+                    return false;
+                    }
+                mTileStream->ref();
+                if (!mTileArm->buildTileIndex(mTileStream, &width, &height))
+                    {
+                    SkDELETE(mTileArm);
+                    mTileArm = NULL;
+                    return false;
+                    }
+                }
+
+            mTileArm->setSampleSize(this->getSampleSize());
+            mTileArm->setDitherImage(this->getDitherImage());
+            mTileArm->setAllocator(this->getAllocator());
+            return mTileArm->decodeRegion(bm, rect, this->getPrefConfig(k32Bit_SrcDepth, false));
+        }
+
+    bool decodeWith(SkTIJPEGImageDecoder* decoder, SkStream* stream, SkBitmap* bm, Mode mode)
+        {
+            decoder->SetJpegDecodeParameters(&mDecParams);
+            decoder->SetView(mView);
+            decoder->setSampleSize(this->getSampleSize());
+            decoder->setDitherImage(this->getDitherImage());
+            decoder->SetDeviceConfig(this->GetDeviceConfig());
+            decoder->setAllocator(this->getAllocator());
+            return decoder->decode(stream, bm, mode);
+        }
+
+    int mView;
+    SkTIJPEGImageDecoder::JpegDecoderParams mDecParams;
+    SkStream* mTileStream;
+    int mTileWidth;
+    int mTileHeight;
+    SkImageDecoder* mTileArm;
 };
 
 ///LIBSKIAHW Factory method
 extern "C" SkImageDecoder* SkImageDecoder_HWJPEG_Factory() {
-    return new SkJPEGTIImageDecoderWrapper(&gJpegDecoder);
+    pthread_once(&gBypassHWOnce, CreateBypassHWKey);
+    if (pthread_getspecific(gBypassHWKey) != NULL)
+        {
+        return NULL;
+        }
+    return new SkJPEGTIImageDecoderWrapper;
+}
+
+///Decoder for a single view of an MPO file, 0 being the first
+extern "C" SkImageDecoder* SkImageDecoder_HWJPEG_ViewFactory(int view) {
+    return new SkJPEGTIImageDecoderWrapper(view);
 }
 
 
@@ -29,6 +29,7 @@
 #include "SkBitmap.h"
 #include "SkStream.h"
 #include "SkAllocator.h"
+#include "SkMpoIndex.h"
 #include "SkImageDecoder.h"
 #include <stdio.h>
 #include <string.h>
@@ -51,11 +52,6 @@ extern "C" {
 
 };
 
-
-namespace android {
-    Mutex       gTIJpegDecMutex;
-}; //namespace android
-
 ///LIBSKIAHW Logging Functions
 #define ENABLE_LOGD
 #ifdef ENABLE_LOGD
@@ -123,75 +119,8 @@ namespace android {
 #define JPS_MISCF_SS_MASK 0x03     /* MASK for bit 16 and bit 17 Subsampling*/
 #define MPO_MISCF_SS_MASK 0x03     /* MASK for bit 16 and bit 17 Subsampling*/
 
-#define MP_START_OF_OFFSET_REF 6
-#define TAGID_MPFVERSION 0xB000
-#define TAGID_NIMAGES 0xB001
-#define TAGID_MPENTRY 0xB002
-#define TAGID_UIDLIST 0xB003
-#define TAGID_TFRAMES 0xB004
-#define TAGID_MPIMAGENUM 0xB101
-#define TAGID_PANSCANORIENTATION 0xB201
-#define TAGID_BVPOINTNUM 0xB204
-#define TAGID_CONVANG 0xB205
-#define TAGID_BASELINELEN 0xB206
-
-typedef enum
-{
-        TAG_TYPE_BYTE = 0x1,
-        TAG_TYPE_ASCII = 0x2,
-        TAG_TYPE_SHORT = 0x3,
-        TAG_TYPE_LONG = 0x4,
-        TAG_TYPE_RATIONAL = 0x5,
-        TAG_TYPE_UNDEFINED = 0x7,
-        TAG_TYPE_SLONG = 0x9,
-        TAG_TYPE_SRATIONAL = 0xA
-} TAG_TYPE;
-
-typedef struct MP_ENTRY
-{
-    OMX_U32     imageAttribute;
-    OMX_U32     imageSize;
-    OMX_U32     dataOffset;
-    OMX_U16     dependentImage1;
-    OMX_U16     dependentImage2;
-}MP_ENTRY;
-
-typedef struct MP_FIELDS_SUPPORTED
-{
-    OMX_U32     MPFVersion;
-    OMX_U8     numberOfImages;
-    MP_ENTRY*    MPEntry; //Image UIDList not supported for nows
-    OMX_U8     totalFrames;
-    OMX_U8     MPIndividualNum;
-    OMX_U8     panOrientation;
-    OMX_U8     panOverlap_H;
-    OMX_U8     panOverlap_V;
-    OMX_U8     baseViewpointNum;
-    OMX_U8     convergenceAngle;
-    OMX_U8     baselineLength;
-    OMX_U8     verticalDivergence;
-    OMX_U8     axisDistance_X;
-    OMX_U8     axisDistance_Y;
-    OMX_U8     axisDistance_Z;
-    OMX_U8     yawAngle;
-    OMX_U8     pitchAngle;
-    OMX_U8     rollAngle;
-}MP_FIELDS_SUPPORTED;
-
 class AutoTimeMillis;
 
-class SkJPEGImageDecoder : public SkImageDecoder {
-public:
-    virtual Format getFormat() const {
-        return kJPEG_Format;
-    }
-
-protected:
-    virtual bool onDecode(SkStream* stream, SkBitmap* bm,
-                          Mode);
-};
-
-
 class SkTIJPEGImageDecoder :public SkImageDecoder
 {
 protected:
@@ -216,11 +145,18 @@ public:
         // Huffman Table
         // SectionDecode;
         // SubRegionDecode
+        OMX_U32 nXOrg;         /* X origin*/
+        OMX_U32 nYOrg;         /* Y origin*/
+        OMX_U32 nXLength;      /* X length*/
+        OMX_U32 nYLength;      /* Y length*/
     }JpegDecoderParams;
 
     SkTIJPEGImageDecoder();
     ~SkTIJPEGImageDecoder();
     bool SetJpegDecodeParameters(JpegDecoderParams * jdp) {memcpy(&jpegDecParams, jdp, sizeof(JpegDecoderParams)); return true;}
+    void SetArmOnly(bool armOnly) { mArmOnly = armOnly; }
+    ///Decode a single view of an MPO, -1 (the default) stacks all of them
+    void SetView(int view) { mView = view; }
     virtual Format getFormat() const { return kJPEG_Format; }
     void Run();
     void PrintState();
@@ -265,7 +201,7 @@ private:
     } JPEG_HEADER_INFO;
 
         OMX_HANDLETYPE pOMXHandle;
-        SkJPEGImageDecoder *pARMHandle;
+        SkImageDecoder *pARMHandle;
         AutoTimeMillis *pDecodeTime, *pBeforeDecodeTime, *pAfterDecodeTime;
         OMX_BUFFERHEADERTYPE *pInBuffHead;
         OMX_BUFFERHEADERTYPE *pOutBuffHead;
@@ -278,12 +214,12 @@ private:
 
         TIS3DHeapAllocator S3DAllocator;
         int fileType;
-        size_t finalBytesRead;
+        android::Mutex mDecodeLock;
+        bool mArmOnly;
+        int mView;
 
     OMX_S16 GetYUVformat(OMX_U8 * Data);
     OMX_S16 Get16m(const void * Short);
-    void BigEndianRead32Bits(OMX_U32 *pVal,OMX_U8* ptr);
-    void BigEndianRead16Bits(OMX_U16 *pVal,OMX_U8* ptr);
     OMX_S32 ParseJpegHeader (SkStream* stream, JPEG_HEADER_INFO* JpegHeaderInfo);
     OMX_S32 fill_data(OMX_BUFFERHEADERTYPE *pBuf, SkStream* stream, OMX_S32 bufferSize);
     void FixFrameSize(JPEG_HEADER_INFO* JpegHeaderInfo);
@@ -291,9 +227,11 @@ private:
     bool IsHwAvailable();
     bool onDecodeOmx(SkStream* stream, SkBitmap* bm, Mode);
     bool onDecodeArm(SkStream* stream, SkBitmap* bm, Mode);
-    bool isValidStream(SkStream* stream, int nextFileOffset);
 
 public:
+    ///libjpeg decoder of libskia for stream, NULL if libskia has none
+    static SkImageDecoder* NewArmDecoder(SkStream* stream);
+
     sem_t *semaphore;
     JPEGDEC_State iState;
     JPEGDEC_State iLastState;
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file SkJpegHwAvailability.cpp
+*
+* This file implements SkJpegHwAvailability
+*
+*/
+
+#define LOG_TAG "LIBSKIAHW"
+
+#include "SkJpegHwAvailability.h"
+
+#include <string.h>
+#include <utils/Log.h>
+
+#define MIN_BACKOFF 100000000LL     // 100 ms
+#define MAX_BACKOFF 5000000000LL    // 5 s
+
+const char* SkJpegHwAvailability::ComponentName = "OMX.TI.DUCATI1.IMAGE.JPEGD";
+
+static OMX_ERRORTYPE ProbeEventHandler(OMX_HANDLETYPE hComponent, OMX_PTR pAppData, OMX_EVENTTYPE eEvent,
+                                       OMX_U32 nData1, OMX_U32 nData2, OMX_PTR pEventData)
+    {
+    return OMX_ErrorNone;
+    }
+
+static OMX_ERRORTYPE ProbeBufferDone(OMX_HANDLETYPE hComponent, OMX_PTR pAppData, OMX_BUFFERHEADERTYPE* pBuffHead)
+    {
+    return OMX_ErrorNone;
+    }
+
+SkJpegHwAvailability& SkJpegHwAvailability::Get()
+    {
+    static SkJpegHwAvailability gHwAvailability;
+    return gHwAvailability;
+    }
+
+SkJpegHwAvailability::SkJpegHwAvailability()
+    {
+    mProbed = false;
+    mSupported = false;
+    mContended = false;
+    mRetryAt = 0;
+    mBackoff = 0;
+    memset(&mStats, 0, sizeof(mStats));
+    }
+
+///Looks the component up in the core's registry, which costs no Ducati resources.
+///Only a core that can't enumerate makes us create a throwaway handle.
+void SkJpegHwAvailability::probe_l()
+    {
+    char name[OMX_MAX_STRINGNAME_SIZE];
+    OMX_ERRORTYPE eError;
+    bool enumerated = false;
+
+    mProbed = true;
+
+    if (OMX_Init() != OMX_ErrorNone)
+        {
+        LOGE("SIMCOP probe: OMX_Init failed, decoding on ARM");
+        return;
+        }
+
+    for (OMX_U32 i = 0; ; i++)
+        {
+        eError = OMX_ComponentNameEnum(name, sizeof(name), i);
+        if (eError != OMX_ErrorNone)
+            {
+            enumerated = (eError == OMX_ErrorNoMore);
+            break;
+            }
+        if (strcmp(name, ComponentName) == 0)
+            {
+            mSupported = true;
+            break;
+            }
+        }
+
+    if (!mSupported && !enumerated)
+        {
+        OMX_CALLBACKTYPE callbacks = {ProbeEventHandler, ProbeBufferDone, ProbeBufferDone};
+        OMX_HANDLETYPE handle = NULL;
+
+        mStats.probes++;
+        eError = OMX_GetHandle(&handle, (OMX_STRING)ComponentName, this, &callbacks);
+        if (eError == OMX_ErrorNone && handle != NULL)
+            {
+            OMX_FreeHandle(handle);
+            mSupported = true;
+            }
+        else if (eError == OMX_ErrorInsufficientResources)
+            {
+            mSupported = true;
+            contended_l();
+            }
+        }
+
+    LOGD("SIMCOP probe: %s is %s", ComponentName, mSupported ? "present" : "missing");
+    if (!mSupported)
+        {
+        OMX_Deinit();
+        }
+    }
+
+void SkJpegHwAvailability::contended_l()
+    {
+    mStats.contentions++;
+    mContended = true;
+    mBackoff = (mBackoff == 0) ? MIN_BACKOFF : mBackoff * 2;
+    if (mBackoff > MAX_BACKOFF)
+        {
+        mBackoff = MAX_BACKOFF;
+        }
+    mRetryAt = systemTime() + mBackoff;
+    }
+
+bool SkJpegHwAvailability::isAvailable()
+    {
+    android::Mutex::Autolock lock(mLock);
+
+    if (!mProbed)
+        {
+        probe_l();
+        }
+    if (!mSupported)
+        {
+        return false;
+        }
+
+    if (mContended)
+        {
+        nsecs_t now = systemTime();
+        if (now < mRetryAt)
+            {
+            mStats.armRouted++;
+            return false;
+            }
+        // this caller tries for a handle, everyone else stays on ARM until it reports back
+        mRetryAt = now + mBackoff;
+        }
+    return true;
+    }
+
+OMX_ERRORTYPE SkJpegHwAvailability::getHandle(OMX_HANDLETYPE* handle, OMX_PTR appData, OMX_CALLBACKTYPE* callbacks)
+    {
+    OMX_ERRORTYPE eError;
+
+        {
+        android::Mutex::Autolock lock(mLock);
+        if (!mProbed)
+            {
+            probe_l();
+            }
+        if (!mSupported)
+            {
+            return OMX_ErrorComponentNotFound;
+            }
+        }
+
+    // creating the remote component takes a while, don't hold up availability checks
+    eError = OMX_GetHandle(handle, (OMX_STRING)ComponentName, appData, callbacks);
+
+    android::Mutex::Autolock lock(mLock);
+    if (eError == OMX_ErrorNone && *handle != NULL)
+        {
+        mStats.handles++;
+        mContended = false;
+        mBackoff = 0;
+        }
+    else
+        {
+        *handle = NULL;
+        contended_l();
+        LOGE("SIMCOP handle refused (0x%x), decoding on ARM for %lld ms", eError, mBackoff / 1000000);
+        }
+    return eError;
+    }
+
+void SkJpegHwAvailability::freeHandle(OMX_HANDLETYPE handle)
+    {
+    if (OMX_FreeHandle(handle) != OMX_ErrorNone)
+        {
+        LOGE("Error in Free Handle function");
+        }
+    }
+
+void SkJpegHwAvailability::onEvent(OMX_EVENTTYPE eEvent, OMX_U32 nData1)
+    {
+    android::Mutex::Autolock lock(mLock);
+
+    if (eEvent == OMX_EventError &&
+            ((OMX_ERRORTYPE)nData1 == OMX_ErrorInsufficientResources ||
+             (OMX_ERRORTYPE)nData1 == OMX_ErrorResourcesLost ||
+             (OMX_ERRORTYPE)nData1 == OMX_ErrorResourcesPreempted))
+        {
+        contended_l();
+        }
+    else if (eEvent == OMX_EventResourcesAcquired)
+        {
+        mContended = false;
+        mBackoff = 0;
+        }
+    }
+
+void SkJpegHwAvailability::getStats(Stats* stats)
+    {
+    android::Mutex::Autolock lock(mLock);
+    *stats = mStats;
+    }
+
+void SkJpegHwAvailability::reset()
+    {
+    android::Mutex::Autolock lock(mLock);
+
+    if (mSupported)
+        {
+        OMX_Deinit();
+        }
+    mProbed = false;
+    mSupported = false;
+    mContended = false;
+    mRetryAt = 0;
+    mBackoff = 0;
+    memset(&mStats, 0, sizeof(mStats));
+    }
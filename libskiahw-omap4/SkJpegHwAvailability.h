@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file SkJpegHwAvailability.h
+*
+* Process wide view of the SIMCOP JPEG decoder: whether the component exists
+* at all, and whether it is worth asking for a handle right now.
+*
+*/
+
+#ifndef SkJpegHwAvailability_DEFINED
+#define SkJpegHwAvailability_DEFINED
+
+#include <utils/threads.h>
+
+extern "C" {
+#include "OMX_Core.h"
+#include "OMX_Component.h"
+};
+
+///The component is probed once per process, with OMX_Init kept for the lifetime
+///of the process so handles don't bring the core up and down. After that
+///isAvailable() is a flag check: a decoder that fails to get its handle, or is
+///told the resource was lost or preempted, marks the hardware contended and
+///decodes go to ARM without touching OMX until the back off expires or the
+///component reports OMX_EventResourcesAcquired.
+class SkJpegHwAvailability {
+public:
+    typedef struct Stats
+        {
+        unsigned int probes;        ///< OMX_GetHandle calls made only to probe
+        unsigned int handles;       ///< handles given to decoders
+        unsigned int contentions;   ///< handle refusals and resource loss events
+        unsigned int armRouted;     ///< isAvailable() answers of no while contended
+        } Stats;
+
+    static SkJpegHwAvailability& Get();
+
+    ///True when the component exists and is not known to be taken
+    bool isAvailable();
+
+    ///OMX_GetHandle for the decoder component, with the outcome recorded
+    OMX_ERRORTYPE getHandle(OMX_HANDLETYPE* handle, OMX_PTR appData, OMX_CALLBACKTYPE* callbacks);
+    void freeHandle(OMX_HANDLETYPE handle);
+
+    ///Feed every component event through here, only resource events are kept
+    void onEvent(OMX_EVENTTYPE eEvent, OMX_U32 nData1);
+
+    void getStats(Stats* stats);
+
+    ///Forget the probe and release the core, for tests
+    void reset();
+
+    static const char* ComponentName;
+
+private:
+    SkJpegHwAvailability();
+
+    void probe_l();
+    void contended_l();
+
+    android::Mutex mLock;
+    bool mProbed;
+    bool mSupported;
+    bool mContended;
+    nsecs_t mRetryAt;
+    nsecs_t mBackoff;
+    Stats mStats;
+};
+
+#endif
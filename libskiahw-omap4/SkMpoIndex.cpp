@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file SkMpoIndex.cpp
+*
+* This file implements SkMpoIndex and SkMpoViewStream
+*
+*/
+
+#include "SkMpoIndex.h"
+
+#include <string.h>
+
+#define MP_ENTRY_SIZE   16
+#define MP_TAG_SIZE     12
+#define MP_MAX_IFDS     4   // only 2 are defined (index, attributes), bounds a looping next-IFD chain
+
+static OMX_U16 Read16(const OMX_U8* p, bool littleEndian)
+{
+    return littleEndian ? (OMX_U16)(p[0] | (p[1] << 8)) : (OMX_U16)((p[0] << 8) | p[1]);
+}
+
+static OMX_U32 Read32(const OMX_U8* p, bool littleEndian)
+{
+    return littleEndian ? (OMX_U32)(p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24))
+                        : (OMX_U32)((p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+}
+
+bool SkMpoIndex::Parse(const OMX_U8* data, OMX_U32 length, OMX_U32 streamOffset, MP_FIELDS_SUPPORTED* fields)
+{
+    const OMX_U8* ref = data + 4;   // offsets in the index are relative to the byte order mark
+    OMX_U32 refLength;
+    OMX_U32 ifdOffset;
+    bool littleEndian;
+
+    Free(fields);
+
+    if (length < 12 || memcmp(data, "MPF", 4) != 0)
+        return false;
+    refLength = length - 4;
+
+    if (ref[0] == 0x49 && ref[1] == 0x49)
+        littleEndian = true;
+    else if (ref[0] == 0x4D && ref[1] == 0x4D)
+        littleEndian = false;
+    else
+        return false;
+
+    fields->offsetRef = streamOffset + 4;
+    ifdOffset = Read32(ref + 4, littleEndian);
+
+    for (int ifd = 0; ifd < MP_MAX_IFDS && ifdOffset != 0; ifd++)
+    {
+        if (ifdOffset > refLength - 2)
+            return false;
+
+        OMX_U16 count = Read16(ref + ifdOffset, littleEndian);
+        const OMX_U8* tag = ref + ifdOffset + 2;
+
+        if ((OMX_U32)count * MP_TAG_SIZE + 4 > refLength - ifdOffset - 2)
+            return false;
+
+        for (int j = 0; j < count; j++, tag += MP_TAG_SIZE)
+        {
+            OMX_U16 tagID = Read16(tag, littleEndian);
+            OMX_U16 tagType = Read16(tag + 2, littleEndian);
+            OMX_U32 tagCount = Read32(tag + 4, littleEndian);
+            OMX_U32 tagValue = Read32(tag + 8, littleEndian);
+
+            switch (tagID)
+            {
+                case TAGID_MPFVERSION:
+                    if (tagType != TAG_TYPE_UNDEFINED)
+                        return false;
+                    fields->MPFVersion = tagValue;
+                    break;
+
+                case TAGID_NIMAGES:
+                    if (tagType != TAG_TYPE_LONG)
+                        return false;
+                    fields->numberOfImages = (OMX_U8)tagValue;
+                    break;
+
+                case TAGID_MPENTRY:
+                {
+                    OMX_U32 entries = tagCount / MP_ENTRY_SIZE;
+
+                    if (tagType != TAG_TYPE_UNDEFINED)
+                        return false;
+                    if (tagValue > refLength || entries > (refLength - tagValue) / MP_ENTRY_SIZE)
+                        return false;
+
+                    delete[] fields->MPEntry;
+                    fields->MPEntry = new MP_ENTRY[entries];
+                    fields->numberOfEntries = entries;
+
+                    const OMX_U8* entry = ref + tagValue;
+                    for (OMX_U32 i = 0; i < entries; i++, entry += MP_ENTRY_SIZE)
+                    {
+                        fields->MPEntry[i].imageAttribute = Read32(entry, littleEndian);
+                        fields->MPEntry[i].imageSize = Read32(entry + 4, littleEndian);
+                        fields->MPEntry[i].dataOffset = Read32(entry + 8, littleEndian);
+                        fields->MPEntry[i].dependentImage1 = Read16(entry + 12, littleEndian);
+                        fields->MPEntry[i].dependentImage2 = Read16(entry + 14, littleEndian);
+                    }
+                    break;
+                }
+
+                case TAGID_UIDLIST:
+                    if (tagType != TAG_TYPE_UNDEFINED)
+                        return false;
+                    break;
+
+                case TAGID_TFRAMES:
+                    if (tagType != TAG_TYPE_LONG)
+                        return false;
+                    fields->totalFrames = (OMX_U8)tagValue;
+                    break;
+
+                case TAGID_MPIMAGENUM:
+                    if (tagType != TAG_TYPE_LONG)
+                        return false;
+                    fields->MPIndividualNum = tagValue;
+                    break;
+
+                case TAGID_PANSCANORIENTATION:
+                    if (tagType != TAG_TYPE_LONG)
+                        return false;
+                    break;
+
+                case TAGID_BVPOINTNUM:
+                    if (tagType != TAG_TYPE_LONG)
+                        return false;
+                    fields->baseViewpointNum = tagValue;
+                    break;
+
+                // the rationals only keep their offset, as before
+                case TAGID_CONVANG:
+                    if (tagType != TAG_TYPE_SRATIONAL)
+                        return false;
+                    fields->convergenceAngle = tagValue;
+                    break;
+
+                case TAGID_BASELINELEN:
+                    if (tagType != TAG_TYPE_RATIONAL)
+                        return false;
+                    fields->baselineLength = tagValue;
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        ifdOffset = Read32(tag, littleEndian);
+    }
+
+    return true;
+}
+
+void SkMpoIndex::Free(MP_FIELDS_SUPPORTED* fields)
+{
+    delete[] fields->MPEntry;
+    memset(fields, 0, sizeof(MP_FIELDS_SUPPORTED));
+}
+
+int SkMpoIndex::Views(const MP_FIELDS_SUPPORTED* fields)
+{
+    if (fields->MPEntry == NULL)
+        return 0;
+    return (fields->numberOfImages < fields->numberOfEntries) ? fields->numberOfImages : fields->numberOfEntries;
+}
+
+size_t SkMpoIndex::ViewOffset(const MP_FIELDS_SUPPORTED* fields, int view)
+{
+    // the first view is where the file starts, its data offset is always 0
+    return view ? fields->offsetRef + fields->MPEntry[view].dataOffset : 0;
+}
+
+size_t SkMpoIndex::ViewLength(const MP_FIELDS_SUPPORTED* fields, int view)
+{
+    return fields->MPEntry[view].imageSize;
+}
+
+bool SkMpoIndex::Seek(SkStream* stream, size_t offset)
+{
+    if (!stream->rewind())
+        return false;
+
+    while (offset > 0)
+    {
+        size_t skipped = stream->skip(offset);
+        if (skipped == 0)
+            return false;
+        offset -= skipped;
+    }
+    return true;
+}
+
+SkMpoViewStream::SkMpoViewStream(SkStream* stream, size_t offset, size_t length)
+    : fStream(stream), fOffset(offset), fLength(length), fPosition(0), fValid(false)
+{
+    OMX_U8 soi[2];
+
+    if (this->rewind() && this->read(soi, 2) == 2 && soi[0] == 0xFF && soi[1] == 0xD8)
+        fValid = this->rewind();
+}
+
+bool SkMpoViewStream::rewind()
+{
+    fPosition = 0;
+    return SkMpoIndex::Seek(fStream, fOffset);
+}
+
+size_t SkMpoViewStream::read(void* buffer, size_t size)
+{
+    if (buffer == NULL && size == 0)
+    {
+        if (fLength)
+            return fLength;
+        size_t total = fStream->getLength();
+        return (total > fOffset) ? total - fOffset : 0;
+    }
+
+    if (fLength && size > fLength - fPosition)
+        size = fLength - fPosition;
+
+    size_t done = fStream->read(buffer, size);
+    fPosition += done;
+    return done;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file SkMpoIndex.h
+*
+* MP Index IFD of a Multi Picture Object (CIPA DC-007) and random access to
+* the individual views it lists.
+*
+*/
+
+#ifndef SkMpoIndex_DEFINED
+#define SkMpoIndex_DEFINED
+
+#include "SkStream.h"
+
+extern "C" {
+#include "OMX_Types.h"
+};
+
+#define TAGID_MPFVERSION 0xB000
+#define TAGID_NIMAGES 0xB001
+#define TAGID_MPENTRY 0xB002
+#define TAGID_UIDLIST 0xB003
+#define TAGID_TFRAMES 0xB004
+#define TAGID_MPIMAGENUM 0xB101
+#define TAGID_PANSCANORIENTATION 0xB201
+#define TAGID_BVPOINTNUM 0xB204
+#define TAGID_CONVANG 0xB205
+#define TAGID_BASELINELEN 0xB206
+
+typedef enum
+{
+        TAG_TYPE_BYTE = 0x1,
+        TAG_TYPE_ASCII = 0x2,
+        TAG_TYPE_SHORT = 0x3,
+        TAG_TYPE_LONG = 0x4,
+        TAG_TYPE_RATIONAL = 0x5,
+        TAG_TYPE_UNDEFINED = 0x7,
+        TAG_TYPE_SLONG = 0x9,
+        TAG_TYPE_SRATIONAL = 0xA
+} TAG_TYPE;
+
+typedef struct MP_ENTRY
+{
+    OMX_U32     imageAttribute;
+    OMX_U32     imageSize;
+    OMX_U32     dataOffset;
+    OMX_U16     dependentImage1;
+    OMX_U16     dependentImage2;
+}MP_ENTRY;
+
+typedef struct MP_FIELDS_SUPPORTED
+{
+    OMX_U32     MPFVersion;
+    OMX_U8     numberOfImages;
+    MP_ENTRY*    MPEntry; //Image UIDList not supported for nows
+    OMX_U32    numberOfEntries; // MPEntry elements actually present
+    OMX_U32    offsetRef;       // stream offset the MPEntry data offsets are relative to
+    OMX_U8     totalFrames;
+    OMX_U8     MPIndividualNum;
+    OMX_U8     panOrientation;
+    OMX_U8     panOverlap_H;
+    OMX_U8     panOverlap_V;
+    OMX_U8     baseViewpointNum;
+    OMX_U8     convergenceAngle;
+    OMX_U8     baselineLength;
+    OMX_U8     verticalDivergence;
+    OMX_U8     axisDistance_X;
+    OMX_U8     axisDistance_Y;
+    OMX_U8     axisDistance_Z;
+    OMX_U8     yawAngle;
+    OMX_U8     pitchAngle;
+    OMX_U8     rollAngle;
+}MP_FIELDS_SUPPORTED;
+
+class SkMpoIndex {
+public:
+    ///Parses an APP2 MPF segment. data points at the "MPF" identifier right after
+    ///the segment length, streamOffset is where that is in the stream. Any index
+    ///already in fields is released first. Returns false for a malformed index.
+    static bool Parse(const OMX_U8* data, OMX_U32 length, OMX_U32 streamOffset, MP_FIELDS_SUPPORTED* fields);
+    static void Free(MP_FIELDS_SUPPORTED* fields);
+
+    ///Number of views that can be decoded, at most numberOfImages
+    static int Views(const MP_FIELDS_SUPPORTED* fields);
+    ///Where a view starts in the stream and how long it is, 0 for a length the index doesn't give
+    static size_t ViewOffset(const MP_FIELDS_SUPPORTED* fields, int view);
+    static size_t ViewLength(const MP_FIELDS_SUPPORTED* fields, int view);
+
+    ///Positions stream at offset with a rewind and bulk skips
+    static bool Seek(SkStream* stream, size_t offset);
+};
+
+///One view of an MPO as a stream of its own. Rewinding goes back to the start of
+///the view, not of the file, and reads stop at the end of the view, so a
+///decoder can be pointed at any view directly.
+class SkMpoViewStream : public SkStream {
+public:
+    SkMpoViewStream(SkStream* stream, size_t offset, size_t length);
+
+    ///The view starts where the index says and begins with SOI
+    bool isValid() const { return fValid; }
+
+    virtual bool rewind();
+    virtual size_t read(void* buffer, size_t size);
+
+private:
+    SkStream* fStream;
+    size_t fOffset;
+    size_t fLength;
+    size_t fPosition;
+    bool fValid;
+};
+
+#endif
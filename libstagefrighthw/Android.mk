@@ -14,6 +14,7 @@ LOCAL_SRC_FILES := \
 LOCAL_C_INCLUDES:= \
         $(TOP)/frameworks/base/include/media/stagefright/openmax \
         $(TOP)/hardware/ti/omap3/liboverlay \
+        $(TOP)/hardware/ti/omap3/libtiutils \
 	$(TOP)/hardware/ti/omx/ducati/domx/system/omx_core/inc
 LOCAL_SHARED_LIBRARIES :=       \
         libbinder               \
@@ -26,6 +27,8 @@ LOCAL_SHARED_LIBRARIES :=       \
         libmedia \
         liblog \
 
+LOCAL_STATIC_LIBRARIES := libtiutils_yuv
+
 LOCAL_MODULE := libstagefrighthw
 
 include $(BUILD_SHARED_LIBRARY)
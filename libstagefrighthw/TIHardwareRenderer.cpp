@@ -21,6 +21,7 @@
 #include <surfaceflinger/ISurface.h>
 #include <ui/Overlay.h>
 #include <cutils/properties.h>
+#include "YuvConvert.h"
 
 #define UNLIKELY( exp ) (__builtin_expect( (exp) != 0, false ))
 
@@ -104,10 +105,8 @@ TIHardwareRenderer::TIHardwareRenderer(
       mIndex(0),
       release_frame_cb(0),
       mCropX(-1),
-      mCropY(-1) {
-
-    sp<IMemory> mem;
-    mapping_data_t *data;
+      mCropY(-1),
+      mCopyFallbacks(0) {
 
     CHECK(mISurface.get() != NULL);
     CHECK(mDecodedWidth > 0);
@@ -190,16 +189,8 @@ TIHardwareRenderer::TIHardwareRenderer(
     }
 #endif
 
-    for (size_t i = 0; i < (size_t)mOverlay->getBufferCount(); ++i) {
-        data = (mapping_data_t *)mOverlay->getBufferAddress((void *)i);
-        CHECK(data != NULL);
-        mVideoHeaps[i] = new MemoryHeapBase(data->fd,data->length, 0, data->offset);
-        mem = new MemoryBase(mVideoHeaps[i], 0, data->length);
-        CHECK(mem.get() != NULL);
-        LOGV("mem->pointer[%d] = %p", i, mem->pointer());
-        mOverlayAddresses.push(mem);
-        buffers_queued_to_dss[i] = 0;
-    }
+    mapBuffers();
+
     char value[PROPERTY_VALUE_MAX];
     property_get("debug.video.showfps", value, "0");
     mDebugFps = atoi(value);
@@ -224,8 +215,6 @@ void TIHardwareRenderer::resizeRenderer(void* resize_params) {
         mCropX = mCropY = -1;
 
         //unmap and delete the heap space for the old buffers
-        sp<IMemory> mem;
-        mapping_data_t *data;
         sp<IMemory> mem_tobe_deleted;
         unsigned int sz = mOverlayAddresses.size();
         if (mOverlay.get() != NULL) {
@@ -245,16 +234,27 @@ void TIHardwareRenderer::resizeRenderer(void* resize_params) {
         //resize the overlay for the new width and height
         mOverlay->resizeInput(mDecodedWidth, mDecodedHeight);
         //create imem for the new buffers
-        for (size_t i = 0; i < (size_t)mOverlay->getBufferCount(); ++i) {
-            data = (mapping_data_t *)mOverlay->getBufferAddress((void *)i);
-            CHECK(data != NULL);
-            mVideoHeaps[i] = new MemoryHeapBase(data->fd,data->length, 0, data->offset);
-            mem = new MemoryBase(mVideoHeaps[i], 0, data->length);
-            CHECK(mem.get() != NULL);
-            LOGV("mem->pointer[%d] = %p", i, mem->pointer());
-            mOverlayAddresses.push(mem);
-            buffers_queued_to_dss[i] = 0;
-        }
+        mapBuffers();
+    }
+}
+
+void TIHardwareRenderer::mapBuffers() {
+    sp<IMemory> mem;
+    mapping_data_t *data;
+
+    mBufferIndex.clear();
+    for (size_t i = 0; i < (size_t)mOverlay->getBufferCount(); ++i) {
+        data = (mapping_data_t *)mOverlay->getBufferAddress((void *)i);
+        CHECK(data != NULL);
+        mVideoHeaps[i] = new MemoryHeapBase(data->fd,data->length, 0, data->offset);
+        mem = new MemoryBase(mVideoHeaps[i], 0, data->length);
+        CHECK(mem.get() != NULL);
+        LOGV("mem->pointer[%d] = %p", i, mem->pointer());
+        mOverlayAddresses.push(mem);
+        buffers_queued_to_dss[i] = 0;
+        // the decoder gets these buffers through getBuffers(), their index is
+        // the overlay buffer number render() queues
+        CHECK(mBufferIndex.add(i, mem->pointer(), data->length));
     }
 }
 
@@ -262,6 +262,8 @@ TIHardwareRenderer::~TIHardwareRenderer() {
     sp<IMemory> mem;
     unsigned int sz = mOverlayAddresses.size();
 
+    LOGD_IF(mCopyFallbacks, "%u frames were copied into the overlay", mCopyFallbacks);
+
     if (mOverlay.get() != NULL) {
 
         for (size_t i = 0; i < sz; ++i) {
@@ -280,140 +282,6 @@ TIHardwareRenderer::~TIHardwareRenderer() {
     }
 }
 
-// return a byte offset from any pointer
-static inline const void *byteOffset(const void* p, size_t offset) {
-    return ((uint8_t*)p + offset);
-}
-
-static void convertYuv420ToNV12(
-        int width, int height, const void *src, void *dst) {
-    //LOGI("Coverting YUV420 to NV-12 height %d and Width %d", height, width);
-   uint32_t stride = 4096;
-    //copy y-buffer, almost bytewise copy, except for stride jumps.
-    {
-        uint8_t* p1y = (uint8_t*) src;
-        uint8_t* p2y = (uint8_t*) dst;
-        for(int i=0;i<height;i++)
-        {
-            //copy whole row of Y pixels. source and desination will point to new row each time.
-            memcpy(p2y+i*stride, p1y+i*width,width);
-        }
-    }
-
-//copy uv buffers
-//rearrange from  planar [uuu][vvvv] to packed planar [uvuvuv]  packages pixel wise
-    {
-        uint8_t* p2uv  = NULL;
-        p2uv  = (uint8_t*) dst;
-        p2uv  += stride * height;
-
-        uint8_t* p1u = ((uint8_t*) src + (width*height));
-        uint8_t* p1v = ((uint8_t*) p1u + ((width/2)*(height/2)));
-
-        for(int i=0;(i<height/2);i++)
-        {
-            for(int j=0,j1=0;(j<width/2);j++,j1+=2)
-            {
-                p2uv[j1] = p1u[j];
-                p2uv[j1+1] = p1v[j];
-            }
-            p2uv+=stride;
-            p1u+=width/2;
-            p1v+=width/2;
-        }
-    }
-}
-
-static void convertYuv420ToYuv422(
-        int width, int height, const void *src, void *dst) {
-
-#ifdef TARGET_OMAP4
-  // calculate total number of pixels, and offsets to U and V planes
-    uint32_t pixelCount =  height * width;
-
-    uint8_t* ySrc = (uint8_t*) src;
-    uint8_t* uSrc = (uint8_t*) ((uint8_t*)src + pixelCount);
-    uint8_t* vSrc = (uint8_t*) ((uint8_t*)src + pixelCount + pixelCount/4);
-    uint8_t *p = (uint8_t*) dst;
-    uint32_t page_width = (width * 2   + 4096 -1) & ~(4096 -1);  // width rounded to the 4096 bytes
-
-   //LOGI("Coverting YUV420 to YUV422 - Height %d and Width %d", height, width);
-
-     // convert lines
-    for (int i = 0; i < height  ; i += 2) {
-        for (int j = 0; j < width; j+= 2) {
-
-         //  These Y have the same CR and CRB....
-         //  Y0 Y01......
-         //  Y1 Y11......
-
-         // SRC buffer from the algorithm might be giving YVU420 as well
-         *(uint32_t *)(p) = (   ((uint32_t)(ySrc[1] << 16)   | (uint32_t)(ySrc[0]))  & 0x00ff00ff ) |
-                                    (  ((uint32_t)(*uSrc << 8) | (uint32_t)(*vSrc << 24))  & 0xff00ff00 ) ;
-
-         *(uint32_t *)(p + page_width) = (   ((uint32_t)(ySrc[width +1] << 16)   | (uint32_t)(ySrc[width]))    & 0x00ff00ff ) |
-                                                            (  ((uint32_t)(*uSrc++ << 8) | (uint32_t)(*vSrc++ << 24))   & 0xff00ff00 );
-
-            p += 4;
-            ySrc += 2;
-         }
-
-        // skip the next y line, we already converted it
-        ySrc += width;     // skip the next row as it was already filled above
-        p    += 2* page_width - width * 2; //go to the beginning of the next row
-    }
-
-#else
-    // calculate total number of pixels, and offsets to U and V planes
-    int pixelCount = height * width;
-    int srcLineLength = width / 4;
-    int destLineLength = width / 2;
-    uint32_t* ySrc = (uint32_t*) src;
-    const uint16_t* uSrc = (const uint16_t*) byteOffset(src, pixelCount);
-    const uint16_t* vSrc = (const uint16_t*) byteOffset(uSrc, pixelCount >> 2);
-    uint32_t *p = (uint32_t*) dst;
-
-    // convert lines
-    for (int i = 0; i < height; i += 2) {
-
-        // upsample by repeating the UV values on adjacent lines
-        // to save memory accesses, we handle 2 adjacent lines at a time
-        // convert 4 pixels in 2 adjacent lines at a time
-        for (int j = 0; j < srcLineLength; j++) {
-
-            // fetch 4 Y values for each line
-            uint32_t y0 = ySrc[0];
-            uint32_t y1 = ySrc[srcLineLength];
-            ySrc++;
-
-            // fetch 2 U/V values
-            uint32_t u = *uSrc++;
-            uint32_t v = *vSrc++;
-
-            // assemble first U/V pair, leave holes for Y's
-            uint32_t uv = (u | (v << 16)) & 0x00ff00ff;
-
-            // OR y values and write to memory
-            p[0] = ((y0 & 0xff) << 8) | ((y0 & 0xff00) << 16) | uv;
-            p[destLineLength] = ((y1 & 0xff) << 8) | ((y1 & 0xff00) << 16) | uv;
-            p++;
-
-            // assemble second U/V pair, leave holes for Y's
-            uv = ((u >> 8) | (v << 8)) & 0x00ff00ff;
-
-            // OR y values and write to memory
-            p[0] = ((y0 >> 8) & 0xff00) | (y0 & 0xff000000) | uv;
-            p[destLineLength] = ((y1 >> 8) & 0xff00) | (y1 & 0xff000000) | uv;
-            p++;
-        }
-
-        // skip the next y line, we already converted it
-        ySrc += srcLineLength;
-        p += destLineLength;
-    }
-#endif
-}
-
 void TIHardwareRenderer::render(
         const void *data, size_t size, void *platformPrivate) {
 
@@ -422,7 +290,6 @@ void TIHardwareRenderer::render(
     }
 
     overlay_buffer_t overlay_buffer;
-    size_t i = 0;
     int cropX = 0;
     int cropY = 0;
 
@@ -431,41 +298,44 @@ void TIHardwareRenderer::render(
     }
 
     if (mColorFormat == OMX_COLOR_FormatYUV420Planar) {
+        YuvPlanarFrame frame = YuvConvert::Contiguous(data, mDecodedWidth, mDecodedHeight);
+        uint8_t* dst = (uint8_t*)mOverlayAddresses[mIndex]->pointer();
 #ifdef TARGET_OMAP4
-        convertYuv420ToNV12(mDecodedWidth, mDecodedHeight, data, mOverlayAddresses[mIndex]->pointer());
+        // NV12 in a 2D tiler buffer, 4 KB rows with the UV plane below the Y plane
+        YuvConvert::I420ToNV12(frame, 0, 0, mDecodedWidth, mDecodedHeight,
+                               dst, dst + ARMPAGESIZE * mDecodedHeight, ARMPAGESIZE);
 #else
-        convertYuv420ToYuv422(mDecodedWidth, mDecodedHeight, data, mOverlayAddresses[mIndex]->pointer());
+        YuvConvert::I420ToPacked422(frame, 0, 0, mDecodedWidth, mDecodedHeight,
+                                    dst, mDecodedWidth * 2, YuvConvert::ORDER_UYVY);
 #endif
     }
     else {
-        for (; i < mOverlayAddresses.size(); ++i) {
-            /**
-            *In order to support the offset from the decoded buffers, we have to check for
-            * the range of offset with in the buffer. Here we can't check for the base address
-            * and also, the offset should be used for crop window position calculation
-            * we are getting the Baseaddress + offset
-            **/
-            unsigned int offsetinPixels = (char*)data - (char*)mOverlayAddresses[i]->pointer();
-            if(offsetinPixels < size){
-                cropY = (offsetinPixels)/ARMPAGESIZE;
-                cropX = (offsetinPixels)%ARMPAGESIZE;
-                if( (cropY != mCropY) || (cropX != mCropX))
-                {
-                    mCropY = cropY;
-                    mCropX = cropX;
-                    mOverlay->setCrop((uint32_t)cropX, (uint32_t)cropY, mDisplayWidth, mDisplayHeight);
-                }
-                break;
+        /**
+        *In order to support the offset from the decoded buffers, we have to check for
+        * the range of offset with in the buffer. Here we can't check for the base address
+        * and also, the offset should be used for crop window position calculation
+        * we are getting the Baseaddress + offset
+        **/
+        size_t offsetinPixels;
+        int index = mBufferIndex.lookup(data, &offsetinPixels);
+
+        if (index >= 0) {
+            cropY = (offsetinPixels)/ARMPAGESIZE;
+            cropX = (offsetinPixels)%ARMPAGESIZE;
+            if( (cropY != mCropY) || (cropX != mCropX))
+            {
+                mCropY = cropY;
+                mCropX = cropX;
+                mOverlay->setCrop((uint32_t)cropX, (uint32_t)cropY, mDisplayWidth, mDisplayHeight);
             }
+            mIndex = index;
         }
-
-        if (i == mOverlayAddresses.size()) {
-            LOGE("Doing a memcpy. Report this issue.");
+        else {
+            // the first one is worth a report, after that the count tells the story
+            if (mCopyFallbacks++ == 0)
+                LOGE("Doing a memcpy. Report this issue.");
             memcpy(mOverlayAddresses[mIndex]->pointer(), data, size);
         }
-        else{
-            mIndex = i;
-        }
 
     }
 
@@ -27,6 +27,7 @@
 #include <OMX_Component.h>
 #include <OMX_TI_IVCommon.h>
 #include "overlay_common.h"
+#include "OverlayBufferIndex.h"
 
 namespace android {
 
@@ -56,6 +57,9 @@ public:
     virtual void resizeRenderer(void* resize_params);
     virtual void requestRendererClone(bool enable);
 
+    // frames that weren't in an overlay buffer and had to be copied into one
+    uint32_t copyFallbacks() const { return mCopyFallbacks; }
+
 private:
     sp<ISurface> mISurface;
     size_t mDisplayWidth, mDisplayHeight;
@@ -72,6 +76,11 @@ private:
     release_rendered_buffer_callback release_frame_cb;
     void  *cookie;
 
+    OverlayBufferIndex mBufferIndex;
+    uint32_t mCopyFallbacks;
+
+    void mapBuffers();
+
     TIHardwareRenderer(const TIHardwareRenderer &);
     TIHardwareRenderer &operator=(const TIHardwareRenderer &);
 
@@ -41,3 +41,22 @@ include $(BUILD_SHARED_LIBRARY)
 
 
 
+################################################
+# YUV conversions and the overlay buffer index of the video renderers, static
+# so the renderers don't pull in the OMX dependencies of libtiutils
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+    YuvConvert.cpp \
+    YuvConvert_neon.cpp \
+    OverlayBufferIndex.cpp
+
+LOCAL_ARM_MODE := arm
+LOCAL_CFLAGS += -O2
+
+LOCAL_MODULE:= libtiutils_yuv
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_STATIC_LIBRARY)
+
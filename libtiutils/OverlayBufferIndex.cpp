@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "OverlayBufferIndex.h"
+
+namespace android {
+
+OverlayBufferIndex::OverlayBufferIndex()
+{
+    clear();
+}
+
+void OverlayBufferIndex::clear()
+{
+    mCount = 0;
+    mNext = 0;
+}
+
+bool OverlayBufferIndex::add(int index, const void* base, size_t length)
+{
+    const uint8_t* p = (const uint8_t*)base;
+    int pos;
+
+    if (index != mCount || mCount == MAX_BUFFERS || p == NULL || length == 0)
+        return false;
+
+    // insertion sort, there are only a few buffers and they are added once
+    for (pos = mCount; pos > 0 && mBuffers[mSorted[pos - 1]].base > p; pos--)
+        ;
+    if (pos > 0 && contains(mSorted[pos - 1], p))
+        return false;
+    if (pos < mCount && mBuffers[mSorted[pos]].base < p + length)
+        return false;
+
+    for (int i = mCount; i > pos; i--)
+        mSorted[i] = mSorted[i - 1];
+    mSorted[pos] = index;
+    mBuffers[index].base = p;
+    mBuffers[index].length = length;
+    mCount++;
+    return true;
+}
+
+int OverlayBufferIndex::lookup(const void* ptr, size_t* offset)
+{
+    const uint8_t* p = (const uint8_t*)ptr;
+    int index = -1;
+
+    if (mCount == 0)
+        return -1;
+
+    if (contains(mNext, p)) {
+        index = mNext;
+    } else {
+        // last sorted buffer starting at or below p
+        int lo = 0, hi = mCount;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (mBuffers[mSorted[mid]].base <= p)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo > 0 && contains(mSorted[lo - 1], p))
+            index = mSorted[lo - 1];
+    }
+
+    if (index >= 0) {
+        mNext = (index + 1 == mCount) ? 0 : index + 1;
+        if (offset != NULL)
+            *offset = p - mBuffers[index].base;
+    }
+    return index;
+}
+
+};
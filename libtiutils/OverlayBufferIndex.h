@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef OVERLAY_BUFFER_INDEX_H
+#define OVERLAY_BUFFER_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace android {
+
+///Maps a pointer into one of the overlay buffers back to the buffer's index.
+///The renderers register the buffers when they map them, the decoder then
+///hands back pointers into them (base plus a crop offset) for every frame.
+///
+///The decoders return their buffers in the order they got them, so the
+///buffer after the last hit is tried first and almost every frame is found
+///with one compare. Anything else is a binary search over the buffers
+///sorted by address.
+///
+///Not thread safe, each renderer owns one and uses it from its render thread.
+class OverlayBufferIndex
+{
+public:
+    enum {
+        MAX_BUFFERS = 32,   ///< NUM_OVERLAY_BUFFERS_MAX of liboverlay
+    };
+
+    OverlayBufferIndex();
+
+    ///Forgets all buffers, for when the overlay gets resized
+    void clear();
+
+    ///Registers [base, base + length) as buffer index. Indexes are the overlay
+    ///buffer numbers, they must be registered as 0, 1, 2...
+    ///Returns false if the buffer doesn't fit or overlaps one already registered.
+    bool add(int index, const void* base, size_t length);
+
+    ///Index of the buffer ptr points into and the offset of ptr in it,
+    ///-1 if ptr isn't in any of the buffers
+    int lookup(const void* ptr, size_t* offset = NULL);
+
+    int size() const { return mCount; }
+    const void* base(int index) const { return mBuffers[index].base; }
+
+private:
+    struct Buffer {
+        const uint8_t* base;
+        size_t length;
+    };
+
+    inline bool contains(int index, const uint8_t* p) const
+    {
+        return p >= mBuffers[index].base && (size_t)(p - mBuffers[index].base) < mBuffers[index].length;
+    }
+
+    Buffer mBuffers[MAX_BUFFERS];   ///< by index
+    int mSorted[MAX_BUFFERS];       ///< indexes in address order
+    int mCount;
+    int mNext;                      ///< the buffer after the last hit
+};
+
+};
+
+#endif /// OVERLAY_BUFFER_INDEX_H
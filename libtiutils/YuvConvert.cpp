@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "YuvConvert.h"
+
+#include <endian.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef AT_HWCAP
+#define AT_HWCAP 16
+#endif
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+
+namespace android {
+
+/* --- scalar, the reference ------------------------------------------------ */
+
+static void scalarInterleaveUV(const uint8_t* u, const uint8_t* v, uint8_t* dst, int n)
+{
+    for (int i = 0; i < n; i++) {
+        dst[2 * i] = u[i];
+        dst[2 * i + 1] = v[i];
+    }
+}
+
+static void scalarPackYUYV(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int n)
+{
+    for (int i = 0; i < n; i++) {
+        dst[4 * i] = y[2 * i];
+        dst[4 * i + 1] = u[i];
+        dst[4 * i + 2] = y[2 * i + 1];
+        dst[4 * i + 3] = v[i];
+    }
+}
+
+static void scalarPackUYVY(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int n)
+{
+    for (int i = 0; i < n; i++) {
+        dst[4 * i] = u[i];
+        dst[4 * i + 1] = y[2 * i];
+        dst[4 * i + 2] = v[i];
+        dst[4 * i + 3] = y[2 * i + 1];
+    }
+}
+
+static const YuvConvertRows gScalarRows = { scalarInterleaveUV, scalarPackYUYV, scalarPackUYVY };
+
+/* --- words ------------------------------------------------------------------
+ * Whole words are loaded and the output words are assembled with shifts
+ * and masks, one store per four output bytes. Loads and stores go through
+ * memcpy, the rows don't have to be aligned. */
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+
+static void wordInterleaveUV(const uint8_t* u, const uint8_t* v, uint8_t* dst, int n)
+{
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        uint32_t u4, v4, out[2];
+        memcpy(&u4, u + i, 4);
+        memcpy(&v4, v + i, 4);
+        out[0] = (u4 & 0xff) | ((v4 & 0xff) << 8) | ((u4 & 0xff00) << 8) | ((v4 & 0xff00) << 16);
+        out[1] = ((u4 >> 16) & 0xff) | ((v4 >> 8) & 0xff00) | ((u4 >> 8) & 0xff0000) | (v4 & 0xff000000);
+        memcpy(dst + 2 * i, out, 8);
+    }
+    scalarInterleaveUV(u + i, v + i, dst + 2 * i, n - i);
+}
+
+/* yFirst puts Y in the even bytes (YUYV), otherwise chroma goes first (UYVY) */
+static inline void wordPack(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int n,
+                            bool yFirst)
+{
+    int i = 0;
+
+    for (; i + 2 <= n; i += 2) {
+        uint32_t y4, out[2];
+        uint16_t u2, v2;
+        memcpy(&y4, y + 2 * i, 4);
+        memcpy(&u2, u + i, 2);
+        memcpy(&v2, v + i, 2);
+        // Y in bytes 0 and 2, chroma in 1 and 3, then shifted a byte for UYVY
+        uint32_t luma0 = (y4 & 0xff) | ((y4 & 0xff00) << 8);
+        uint32_t luma1 = ((y4 >> 16) & 0xff) | ((y4 >> 8) & 0xff0000);
+        uint32_t chroma0 = (u2 & 0xff) | ((v2 & 0xff) << 16);
+        uint32_t chroma1 = (u2 >> 8) | ((v2 & 0xff00) << 8);
+        if (yFirst) {
+            out[0] = luma0 | (chroma0 << 8);
+            out[1] = luma1 | (chroma1 << 8);
+        } else {
+            out[0] = chroma0 | (luma0 << 8);
+            out[1] = chroma1 | (luma1 << 8);
+        }
+        memcpy(dst + 4 * i, out, 8);
+    }
+    if (yFirst) {
+        scalarPackYUYV(y + 2 * i, u + i, v + i, dst + 4 * i, n - i);
+    } else {
+        scalarPackUYVY(y + 2 * i, u + i, v + i, dst + 4 * i, n - i);
+    }
+}
+
+static void wordPackYUYV(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int n)
+{
+    wordPack(y, u, v, dst, n, true);
+}
+
+static void wordPackUYVY(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int n)
+{
+    wordPack(y, u, v, dst, n, false);
+}
+
+static const YuvConvertRows gWordRows = { wordInterleaveUV, wordPackYUYV, wordPackUYVY };
+
+#else
+
+// the shifts above assume little endian words
+static const YuvConvertRows gWordRows = gScalarRows;
+
+#endif
+
+/* --- selection ------------------------------------------------------------- */
+
+static bool cpuHasNeon()
+{
+#if defined(__arm__)
+    unsigned long entry[2];
+    bool neon = false;
+    int fd = open("/proc/self/auxv", O_RDONLY);
+
+    if (fd < 0)
+        return false;
+    while (read(fd, entry, sizeof(entry)) == sizeof(entry) && entry[0] != 0) {
+        if (entry[0] == AT_HWCAP) {
+            neon = (entry[1] & HWCAP_NEON) != 0;
+            break;
+        }
+    }
+    close(fd);
+    return neon;
+#else
+    return false;
+#endif
+}
+
+static YuvConvert::Impl gImpl = YuvConvert::IMPL_AUTO;
+static const YuvConvertRows* gRows = NULL;
+
+static const YuvConvertRows* rowsOf(YuvConvert::Impl impl)
+{
+    switch (impl) {
+        case YuvConvert::IMPL_SCALAR:
+            return &gScalarRows;
+        case YuvConvert::IMPL_WORD:
+            return &gWordRows;
+        case YuvConvert::IMPL_NEON:
+            return cpuHasNeon() ? YuvConvertNeonRows() : NULL;
+        default:
+            return NULL;
+    }
+}
+
+bool YuvConvert::Available(Impl impl)
+{
+    return rowsOf(impl) != NULL;
+}
+
+const char* YuvConvert::Name(Impl impl)
+{
+    switch (impl) {
+        case IMPL_SCALAR: return "scalar";
+        case IMPL_WORD: return "word";
+        case IMPL_NEON: return "neon";
+        default: return "auto";
+    }
+}
+
+YuvConvert::Impl YuvConvert::Select(Impl impl)
+{
+    if (impl == IMPL_AUTO) {
+#if defined(__arm__)
+        // without NEON the word kernels save the ARM three of every four stores
+        impl = Available(IMPL_NEON) ? IMPL_NEON : IMPL_WORD;
+#else
+        // host compilers vectorize the byte loops on their own
+        impl = IMPL_SCALAR;
+#endif
+    }
+
+    // a racing first conversion selects the same rows, the pointer store is atomic
+    const YuvConvertRows* rows = rowsOf(impl);
+    if (rows != NULL) {
+        gRows = rows;
+        gImpl = impl;
+    }
+    return gImpl;
+}
+
+static inline const YuvConvertRows* currentRows()
+{
+    if (gRows == NULL)
+        YuvConvert::Select(YuvConvert::IMPL_AUTO);
+    return gRows;
+}
+
+/* --- conversions ----------------------------------------------------------- */
+
+YuvPlanarFrame YuvConvert::Contiguous(const void* buffer, int width, int height)
+{
+    YuvPlanarFrame frame;
+
+    frame.y = (const uint8_t*)buffer;
+    frame.u = frame.y + width * height;
+    frame.v = frame.u + (width / 2) * (height / 2);
+    frame.yStride = width;
+    frame.uvStride = width / 2;
+    return frame;
+}
+
+void YuvConvert::I420ToNV12(const YuvPlanarFrame& src, int left, int top, int width, int height,
+                            uint8_t* dstY, uint8_t* dstUV, uint32_t dstStride)
+{
+    const YuvConvertRows* rows = currentRows();
+    const uint8_t* y = src.y + top * src.yStride + left;
+    const uint8_t* u = src.u + (top / 2) * src.uvStride + left / 2;
+    const uint8_t* v = src.v + (top / 2) * src.uvStride + left / 2;
+
+    for (int i = 0; i < height; i++) {
+        memcpy(dstY, y, width);
+        y += src.yStride;
+        dstY += dstStride;
+    }
+    for (int i = 0; i < height / 2; i++) {
+        rows->interleaveUV(u, v, dstUV, width / 2);
+        u += src.uvStride;
+        v += src.uvStride;
+        dstUV += dstStride;
+    }
+}
+
+void YuvConvert::I420ToPacked422(const YuvPlanarFrame& src, int left, int top, int width, int height,
+                                 uint8_t* dst, uint32_t dstStride, PackedOrder order)
+{
+    const YuvConvertRows* rows = currentRows();
+    void (*pack)(const uint8_t*, const uint8_t*, const uint8_t*, uint8_t*, int) =
+        (order == ORDER_YUYV) ? rows->packYUYV : rows->packUYVY;
+    const uint8_t* y = src.y + top * src.yStride + left;
+    const uint8_t* u = src.u + (top / 2) * src.uvStride + left / 2;
+    const uint8_t* v = src.v + (top / 2) * src.uvStride + left / 2;
+
+    for (int i = 0; i < height; i += 2) {
+        pack(y, u, v, dst, width / 2);
+        pack(y + src.yStride, u, v, dst + dstStride, width / 2);
+        y += 2 * src.yStride;
+        u += src.uvStride;
+        v += src.uvStride;
+        dst += 2 * dstStride;
+    }
+}
+
+};
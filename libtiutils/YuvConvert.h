@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef YUV_CONVERT_H
+#define YUV_CONVERT_H
+
+#include <stdint.h>
+
+namespace android {
+
+///Planar 4:2:0 source frame (I420: Y, then U, then V). Each plane has its own
+///start and the chroma planes share a stride.
+struct YuvPlanarFrame
+{
+    const uint8_t* y;
+    const uint8_t* u;
+    const uint8_t* v;
+    uint32_t yStride;
+    uint32_t uvStride;
+};
+
+///Conversions from the planar output of the software video decoders to the
+///layouts the overlay takes. Rows are converted by one of several
+///implementations that all produce the same bytes, the fastest one the CPU
+///supports is picked the first time a conversion runs.
+///
+///Crop rectangles start on even coordinates and have even sizes, like the
+///4:2:0 chroma they index into.
+class YuvConvert
+{
+public:
+    enum Impl {
+        IMPL_AUTO,
+        IMPL_SCALAR,    ///< byte at a time, the reference
+        IMPL_WORD,      ///< 32/64 bit words in plain C, any CPU
+        IMPL_NEON,      ///< ARM NEON, when built with it and the CPU has it
+    };
+
+    enum PackedOrder {
+        ORDER_YUYV,     ///< Y0 U Y1 V
+        ORDER_UYVY,     ///< U Y0 V Y1
+    };
+
+    ///A frame of width x height laid out as one contiguous I420 buffer
+    static YuvPlanarFrame Contiguous(const void* buffer, int width, int height);
+
+    ///Switches the implementation, IMPL_AUTO picks the fastest available one.
+    ///Returns the implementation in use, which stays the same if impl isn't available.
+    static Impl Select(Impl impl);
+    static bool Available(Impl impl);
+    static const char* Name(Impl impl);
+
+    ///The crop rectangle of src to NV12: dstY rows and the interleaved UV rows at
+    ///dstUV, both dstStride bytes apart
+    static void I420ToNV12(const YuvPlanarFrame& src, int left, int top, int width, int height,
+                           uint8_t* dstY, uint8_t* dstUV, uint32_t dstStride);
+
+    ///The crop rectangle of src to packed 4:2:2, dstStride bytes between rows.
+    ///Both rows of a 4:2:0 chroma row get the same chroma.
+    static void I420ToPacked422(const YuvPlanarFrame& src, int left, int top, int width, int height,
+                                uint8_t* dst, uint32_t dstStride, PackedOrder order);
+};
+
+///Row kernels of one implementation, n is in chroma samples
+struct YuvConvertRows
+{
+    void (*interleaveUV)(const uint8_t* u, const uint8_t* v, uint8_t* dst, int n);
+    void (*packYUYV)(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int n);
+    void (*packUYVY)(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int n);
+};
+
+///NULL when the library was built without NEON
+extern const YuvConvertRows* YuvConvertNeonRows();
+
+};
+
+#endif /// YUV_CONVERT_H
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+///NEON row kernels of YuvConvert. Built for every target, they only exist
+///when the compiler targets NEON (armv7-a-neon), the CPU is checked at runtime.
+
+#include "YuvConvert.h"
+
+#include <stddef.h>
+
+#if defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+
+namespace android {
+
+/* The tails are short, a byte loop is enough for them */
+
+static void neonInterleaveUV(const uint8_t* u, const uint8_t* v, uint8_t* dst, int n)
+{
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x2_t uv;
+        uv.val[0] = vld1q_u8(u + i);
+        uv.val[1] = vld1q_u8(v + i);
+        vst2q_u8(dst + 2 * i, uv);
+    }
+    for (; i < n; i++) {
+        dst[2 * i] = u[i];
+        dst[2 * i + 1] = v[i];
+    }
+}
+
+static void neonPackYUYV(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int n)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        // even and odd luma of 16 pixels
+        uint8x8x2_t luma = vld2_u8(y + 2 * i);
+        uint8x8x4_t out;
+        out.val[0] = luma.val[0];
+        out.val[1] = vld1_u8(u + i);
+        out.val[2] = luma.val[1];
+        out.val[3] = vld1_u8(v + i);
+        vst4_u8(dst + 4 * i, out);
+    }
+    for (; i < n; i++) {
+        dst[4 * i] = y[2 * i];
+        dst[4 * i + 1] = u[i];
+        dst[4 * i + 2] = y[2 * i + 1];
+        dst[4 * i + 3] = v[i];
+    }
+}
+
+static void neonPackUYVY(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int n)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        uint8x8x2_t luma = vld2_u8(y + 2 * i);
+        uint8x8x4_t out;
+        out.val[0] = vld1_u8(u + i);
+        out.val[1] = luma.val[0];
+        out.val[2] = vld1_u8(v + i);
+        out.val[3] = luma.val[1];
+        vst4_u8(dst + 4 * i, out);
+    }
+    for (; i < n; i++) {
+        dst[4 * i] = u[i];
+        dst[4 * i + 1] = y[2 * i];
+        dst[4 * i + 2] = v[i];
+        dst[4 * i + 3] = y[2 * i + 1];
+    }
+}
+
+static const YuvConvertRows gNeonRows = { neonInterleaveUV, neonPackYUYV, neonPackUYVY };
+
+const YuvConvertRows* YuvConvertNeonRows()
+{
+    return &gNeonRows;
+}
+
+};
+
+#else
+
+namespace android {
+
+const YuvConvertRows* YuvConvertNeonRows()
+{
+    return NULL;
+}
+
+};
+
+#endif
@@ -0,0 +1,214 @@
+/* AudioChain.cpp
+ **
+ ** Copyright 2009-2011 Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_TAG "AudioChain"
+#include <utils/Log.h>
+
+#include <AudioChain.h>
+#include <AudioProcessors.h>
+
+namespace android
+{
+
+AudioChain::AudioChain() :
+    mCount(0),
+    mCapacity(0),
+    mOutputRate(0),
+    mBudget(0),
+    mOverBudget(0)
+{
+}
+
+AudioChain::~AudioChain()
+{
+    clear();
+}
+
+status_t AudioChain::add(AudioProcessor *node)
+{
+    if (mCount == MAX_NODES) {
+        delete node;
+        return NO_MEMORY;
+    }
+
+    memset(&mNodes[mCount], 0, sizeof(mNodes[mCount]));
+    mNodes[mCount].processor = node;
+    mNodes[mCount].stats.name = node->name();
+    mCount++;
+    return NO_ERROR;
+}
+
+void AudioChain::clear()
+{
+    for (size_t i = 0; i < mCount; i++)
+        delete mNodes[i].processor;
+    mCount = 0;
+}
+
+AudioProcessor *AudioChain::find(const char *name) const
+{
+    for (size_t i = 0; i < mCount; i++) {
+        if (!strcmp(mNodes[i].processor->name(), name))
+            return mNodes[i].processor;
+    }
+    return NULL;
+}
+
+status_t AudioChain::parse(const char *spec)
+{
+    char list[128];
+    char *save = NULL;
+    bool resampled = false;
+
+    clear();
+    strncpy(list, spec, sizeof(list) - 1);
+    list[sizeof(list) - 1] = 0;
+
+    for (char *item = strtok_r(list, ", ", &save); item; item = strtok_r(NULL, ", ", &save)) {
+        char *arg = strchr(item, ':');
+        if (arg) *arg++ = 0;
+
+        AudioProcessor *node;
+        if (!strcmp(item, "aec") && resampled) {
+            // the echo reference comes at the capture rate
+            LOGE("aec has to come before resample");
+            clear();
+            return BAD_VALUE;
+        }
+        else if (!strcmp(item, "aec"))
+            node = new EchoCanceller(arg ? atoi(arg) : 256);
+        else if (!strcmp(item, "ns"))
+            node = new NoiseSuppressor(arg ? atoi(arg) : -15);
+        else if (!strcmp(item, "gain") && arg)
+            node = new GainProcessor(atoi(arg));
+        else if (!strcmp(item, "resample") && arg) {
+            const char *quality = strchr(arg, ':');
+            node = new Resampler(atoi(arg), quality ? atoi(quality + 1) : -1);
+            resampled = true;
+        }
+        else {
+            LOGE("Unknown processing node %s", item);
+            clear();
+            return BAD_VALUE;
+        }
+
+        status_t err = add(node);
+        if (err != NO_ERROR) {
+            LOGE("More than %d processing nodes", MAX_NODES);
+            clear();
+            return err;
+        }
+    }
+    return NO_ERROR;
+}
+
+status_t AudioChain::configure(int rate, int channels, size_t periodFrames, nsecs_t budget)
+{
+    size_t frames = periodFrames;
+
+    mCapacity = periodFrames;
+    for (size_t i = 0; i < mCount; i++) {
+        status_t err = mNodes[i].processor->configure(rate, channels, frames);
+        if (err != NO_ERROR) {
+            LOGE("%s can't take %d Hz, %d channels", mNodes[i].processor->name(), rate, channels);
+            return err;
+        }
+        frames = mNodes[i].processor->outputFrames(frames);
+        if (frames > mCapacity) mCapacity = frames;
+        mNodes[i].recent = 0;
+    }
+
+    mOutputRate = rate;
+    mBudget = budget;
+    return NO_ERROR;
+}
+
+void AudioChain::process(AudioBlock &block)
+{
+    nsecs_t start = systemTime(SYSTEM_TIME_THREAD);
+    nsecs_t now = start;
+    bool over = false;
+
+    for (size_t i = 0; i < mCount; i++) {
+        Node &node = mNodes[i];
+
+        if (!node.processor->enabled()) continue;
+
+        if (mBudget && !node.processor->essential() && now - start + node.recent > mBudget) {
+            node.stats.skipped++;
+            // forget the cost slowly, the node gets another go once the
+            // rest of the chain settles
+            node.recent -= node.recent / 8;
+            over = true;
+            continue;
+        }
+
+        node.processor->process(block);
+
+        nsecs_t end = systemTime(SYSTEM_TIME_THREAD);
+        nsecs_t cost = end - now;
+        now = end;
+
+        node.stats.blocks++;
+        node.stats.total += cost;
+        if (cost > node.stats.worst) node.stats.worst = cost;
+        // 1/8 of the newest block, quick to notice a node got expensive
+        node.recent += (cost - node.recent) / 8;
+    }
+
+    if (over && mOverBudget++ == 0)
+        LOGW("Processing over its budget of %lld us, skipping nodes", ns2us(mBudget));
+}
+
+void AudioChain::reset()
+{
+    for (size_t i = 0; i < mCount; i++)
+        mNodes[i].processor->reset();
+}
+
+size_t AudioChain::stats(Stats *stats, size_t max) const
+{
+    size_t n = mCount < max ? mCount : max;
+
+    for (size_t i = 0; i < n; i++)
+        stats[i] = mNodes[i].stats;
+    return n;
+}
+
+void AudioChain::resetStats()
+{
+    for (size_t i = 0; i < mCount; i++) {
+        const char *name = mNodes[i].stats.name;
+        memset(&mNodes[i].stats, 0, sizeof(mNodes[i].stats));
+        mNodes[i].stats.name = name;
+    }
+    mOverBudget = 0;
+}
+
+void AudioChain::dump() const
+{
+    for (size_t i = 0; i < mCount; i++) {
+        const Stats &s = mNodes[i].stats;
+        LOGD("%-10s %u blocks, %u skipped, %lld us average, %lld us worst", s.name, s.blocks,
+                s.skipped, s.blocks ? ns2us(s.total / s.blocks) : 0, ns2us(s.worst));
+    }
+}
+
+}
@@ -0,0 +1,139 @@
+/* AudioChain.h
+ **
+ ** Copyright 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_TI_AUDIO_CHAIN_H
+#define ANDROID_HARDWARE_TI_AUDIO_CHAIN_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <utils/Errors.h>
+#include <utils/Timers.h>
+
+namespace android
+{
+
+// One period of capture, 16 bit interleaved, processed in place
+struct AudioBlock {
+    int16_t *       data;
+    size_t          frames;
+    size_t          capacity;       // frames data has room for
+    int             channels;
+    int             rate;
+    // What was played while this block was captured, same rate,
+    // refChannels interleaved, frames long. NULL when nothing was.
+    const int16_t * reference;
+    int             refChannels;
+};
+
+// A node of the chain. Nodes run on the capture thread, once per block:
+// no allocation, no locks and no system calls in process().
+class AudioProcessor {
+public:
+    AudioProcessor(const char *name, bool essential = false) :
+        mName(name), mEssential(essential), mEnabled(true) {}
+    virtual ~AudioProcessor() {}
+
+    const char *name() const { return mName; }
+
+    // Essential nodes run even when the block is over budget, the ones
+    // that change the format of the block are.
+    bool essential() const { return mEssential; }
+
+    bool enabled() const { return mEnabled; }
+    void setEnabled(bool enabled) { mEnabled = enabled; }
+
+    // Called before the first block and whenever the input format changes.
+    // rate is the input rate on the way in and the output rate on the way out.
+    virtual status_t configure(int &rate, int channels, size_t maxFrames) = 0;
+
+    // Frames out for frames in, the chain sizes the block with it
+    virtual size_t outputFrames(size_t frames) const { return frames; }
+
+    // Drops whatever state the node learnt, after an xrun for one
+    virtual void reset() {}
+
+    virtual void process(AudioBlock &block) = 0;
+
+private:
+    const char *    mName;
+    bool            mEssential;
+    bool            mEnabled;
+};
+
+// The capture processing graph of AudioEngine: a line of nodes run in
+// order on each block, within a compute budget. A node that isn't
+// essential is skipped for the block when what's left of the budget
+// wouldn't cover its recent cost. Every node's thread CPU time is counted.
+class AudioChain {
+public:
+    enum { MAX_NODES = 8 };
+
+    struct Stats {
+        const char *    name;
+        uint32_t        blocks;     // processed
+        uint32_t        skipped;    // dropped for the budget
+        nsecs_t         total;      // thread CPU time
+        nsecs_t         worst;
+    };
+
+    AudioChain();
+    ~AudioChain();
+
+    // Builds the chain from a list like "aec:256,ns,gain:6,resample:16000",
+    // see AudioProcessors.h for the nodes and their argument. aec can't
+    // follow resample, its reference is at the capture rate
+    status_t parse(const char *spec);
+
+    // Takes ownership of node
+    status_t add(AudioProcessor *node);
+    void clear();
+
+    size_t size() const { return mCount; }
+    AudioProcessor *node(size_t i) const { return mNodes[i].processor; }
+    AudioProcessor *find(const char *name) const;
+
+    // budget is the CPU time a block may take, 0 for no limit
+    status_t configure(int rate, int channels, size_t periodFrames, nsecs_t budget);
+
+    // Frames the data of a block has to have room for
+    size_t capacity() const { return mCapacity; }
+    int outputRate() const { return mOutputRate; }
+
+    void process(AudioBlock &block);
+    void reset();
+
+    size_t stats(Stats *stats, size_t max) const;
+    void resetStats();
+    void dump() const;
+
+private:
+    struct Node {
+        AudioProcessor *    processor;
+        Stats               stats;
+        nsecs_t             recent;     // decaying average of the cost
+    };
+
+    Node                mNodes[MAX_NODES];
+    size_t              mCount;
+    size_t              mCapacity;
+    int                 mOutputRate;
+    nsecs_t             mBudget;
+    uint32_t            mOverBudget;    // blocks that had to skip a node
+};
+
+}
+#endif
@@ -29,13 +29,23 @@
 #include <utils/threads.h>
 #include <utils/Log.h>
 #include <utils/String8.h>
+#include <cutils/properties.h>
 
 #include <AudioEngine.h>
+#include <AudioProcessors.h>
 
 #define BUFFER_COUNT        20
 #define AUDIO_CHUNK_SIZE    2048
 #define RING_SIZE           BUFFER_COUNT * AUDIO_CHUNK_SIZE
 
+// Share of the period the processing may take, in percent
+#define DEFAULT_BUDGET      "50"
+
+// What s_write passes on unless omap.audio.acoustics.reference says
+// otherwise, as "rate:channels": the output handles of alsa_omap3
+#define REFERENCE_RATE      ALSA_DEFAULT_SAMPLE_RATE
+#define REFERENCE_CHANNELS  2
+
 namespace android
 {
 
@@ -44,25 +54,29 @@ AudioEngine::AudioEngine(acoustic_device_t *dev) :
     mInput(0),
     running(false),
     readRng(RING_SIZE),
-    writeRng(RING_SIZE)
+    writeRng(RING_SIZE),
+    refBuffer(0),
+    refRate(0),
+    sourceSize(AUDIO_CHUNK_SIZE),
+    mProcess(false),
+    mRate(0),
+    mRefRate(REFERENCE_RATE),
+    mRefChannels(REFERENCE_CHANNELS),
+    mRefPhase(0),
+    mRefCarry(0),
+    mRefSize(0),
+    mEcho(false)
 {
-    sourceBuffer = new char[AUDIO_CHUNK_SIZE];
-    procBuffer = new char[AUDIO_CHUNK_SIZE];
-    refBuffer = new char[RING_SIZE];
-    feedback = new char[AUDIO_CHUNK_SIZE];
-
-    memset(sourceBuffer, 0, AUDIO_CHUNK_SIZE);
-    memset(procBuffer, 0, AUDIO_CHUNK_SIZE);
-    memset(refBuffer, 0, RING_SIZE);
-    memset(feedback, 0, AUDIO_CHUNK_SIZE);
+    sourceBuffer = new char[sourceSize];
+
+    memset(sourceBuffer, 0, sourceSize);
 }
 
 AudioEngine::~AudioEngine()
 {
-    delete sourceBuffer;
-    delete procBuffer;
-    delete refBuffer;
-    delete feedback;
+    delete [] sourceBuffer;
+    delete [] refBuffer;
+    delete [] refRate;
 }
 
 bool AudioEngine::isRunning()
@@ -74,32 +88,34 @@ bool AudioEngine::threadLoop()
 {
     running = true;
 
-    uint32_t bytes = AUDIO_CHUNK_SIZE;
-    snd_pcm_sframes_t n, frames = snd_pcm_bytes_to_frames(mInput->handle, bytes);
+    snd_pcm_sframes_t n, frames = snd_pcm_bytes_to_frames(mInput->handle, AUDIO_CHUNK_SIZE);
 
     do {
         char *buffer = sourceBuffer;
-        do {
-            n = snd_pcm_readi(mInput->handle, buffer, frames);
-            if (n < frames && n != -EAGAIN) {
-                if (n < 0)
-                    recover(n);
-                else {
-                    frames -= n;
-                    buffer += snd_pcm_frames_to_bytes(mInput->handle, n);
-                    snd_pcm_prepare(mInput->handle);
-                }
+        snd_pcm_sframes_t left = frames;
+
+        while (left && !exitPending()) {
+            n = snd_pcm_readi(mInput->handle, buffer, left);
+            if (n == -EAGAIN)
+                continue;
+            if (n < 0) {
+                // start the period over, the processing state is stale too
+                recover(n);
+                mChain.reset();
+                buffer = sourceBuffer;
+                left = frames;
+                continue;
             }
-        } while (frames);
-
-        bytes = writeRng.copy(refBuffer, RING_SIZE);
-        // If we didn't get enough, then fill with silence.
-        if (bytes < RING_SIZE)
-            memset(refBuffer + bytes, 0, RING_SIZE - bytes);
+            left -= n;
+            buffer += snd_pcm_frames_to_bytes(mInput->handle, n);
+        }
+        if (left)
+            break;
 
-        process_data();
+        size_t bytes = AUDIO_CHUNK_SIZE;
+        process_data(bytes);
 
-        readRng.write(procBuffer, AUDIO_CHUNK_SIZE);
+        readRng.write(sourceBuffer, bytes);
 
     } while (!exitPending());
 
@@ -117,14 +133,76 @@ void AudioEngine::onFirstRef()
 {
 }
 
+// set_rate_near may have given the PCM another rate than the stream's
+static unsigned int hardwareRate(alsa_handle_t *handle)
+{
+    snd_pcm_hw_params_t *params;
+    unsigned int rate = 0;
+    int dir = 0;
+
+    snd_pcm_hw_params_alloca(&params);
+    if (snd_pcm_hw_params_current(handle->handle, params) < 0 ||
+        snd_pcm_hw_params_get_rate(params, &rate, &dir) < 0 || !rate)
+        return handle->sampleRate;
+    return rate;
+}
+
 status_t AudioEngine::setHandle(alsa_handle_t *handle)
 {
+    // the capture thread goes with the handle it reads
+    requestExitAndWait();
+
     mInput = handle;
-    return NO_ERROR;
+    if (!mInput)
+        return NO_ERROR;
+
+    char value[PROPERTY_VALUE_MAX];
+    char budget[PROPERTY_VALUE_MAX];
+    property_get("omap.audio.acoustics", value, "");
+    mChain.parse(value);
+
+    // the chain runs at the rate captured, a PCM that couldn't take the
+    // stream's is converted back to it last unless the chain already does
+    mRate = hardwareRate(mInput);
+    if (mRate != mInput->sampleRate && !mChain.find("resample")) {
+        property_get("omap.audio.resample.budget", budget, "");
+        LOGI("Capture at %u Hz resampled to %u Hz", mRate, mInput->sampleRate);
+        mChain.add(new Resampler(mInput->sampleRate, -1,
+                                 budget[0] ? atoi(budget) : Resampler::DEFAULT_MAC_BUDGET));
+    }
+
+    mProcess = mChain.size() && mInput->format == SND_PCM_FORMAT_S16_LE;
+    if (mProcess) {
+        size_t frames = snd_pcm_bytes_to_frames(mInput->handle, AUDIO_CHUNK_SIZE);
+        property_get("omap.audio.acoustics.budget", budget, DEFAULT_BUDGET);
+        nsecs_t period = seconds(frames) / mRate * atoi(budget) / 100;
+
+        mProcess = mChain.configure(mRate, mInput->channels, frames, period) == NO_ERROR;
+    } else if (mChain.size()) {
+        LOGW("Capture format %d can't be processed", mInput->format);
+    }
+
+    // nodes that change the rate want more room than a period
+    size_t size = mProcess ? snd_pcm_frames_to_bytes(mInput->handle, mChain.capacity()) : 0;
+    if (size > sourceSize) {
+        delete [] sourceBuffer;
+        sourceBuffer = new char[size];
+        sourceSize = size;
+    }
+
+    setReference();
+
+    LOGD("Capture processing: %s", !mProcess ? "none" : value[0] ? value : "resample");
+
+    return run("AudioEngine", PRIORITY_URGENT_AUDIO);
 }
 
 status_t AudioEngine::cleanup()
 {
+    requestExitAndWait();
+    if (mProcess)
+        mChain.dump();
+    mInput = 0;
     return NO_ERROR;
 }
 
@@ -152,18 +230,117 @@ status_t AudioEngine::recover(int err)
     return err;
 }
 
-void AudioEngine::process_data()
+// The playback format s_write passes, converted to the capture rate when
+// the chain has an echo canceller. The canceller mixes the channels down.
+void AudioEngine::setReference()
 {
-    snd_pcm_sframes_t frames = snd_pcm_bytes_to_frames(mInput->handle, AUDIO_CHUNK_SIZE);
-
-    // At this point:
-    //      sourceBuffer contains AUDIO_CHUNK_SIZE bytes of captured audio
-    //      procBuffer is expected to be filled with AUDIO_CHUNK_SIZE processed capture data
-    //      refBuffer contains RING_SIZE of playback audio that was sent out
-    //      feedback is a scratch buffer for the audio processing.
-    //      frames is the number of samples in the procBuffer.
+    char value[PROPERTY_VALUE_MAX];
+    unsigned int rate = REFERENCE_RATE;
+    int channels = REFERENCE_CHANNELS;
+
+    property_get("omap.audio.acoustics.reference", value, "");
+    if (value[0] && (sscanf(value, "%u:%d", &rate, &channels) < 1 || !rate ||
+                     channels < 1 || channels > ALSAResampler::MAX_CHANNELS)) {
+        LOGW("Bad echo reference format %s", value);
+        rate = REFERENCE_RATE;
+        channels = REFERENCE_CHANNELS;
+    }
+    mRefRate = rate;
+    mRefChannels = channels;
+    mRefPhase = 0;
+    mRefCarry = 0;
+
+    AudioProcessor *aec = mProcess ? mChain.find("aec") : NULL;
+    size_t frames = snd_pcm_bytes_to_frames(mInput->handle, AUDIO_CHUNK_SIZE);
+    // playback frames a block takes, one more for the remainder
+    size_t refFrames = (size_t)(((uint64_t)frames * mRefRate + mRate - 1) / mRate) + 1;
+    size_t outFrames = frames;
+
+    mEcho = aec != NULL;
+    if (mEcho && mRefRate != mRate) {
+        mEcho = mRefResampler.configure(mRefRate, mRate, mRefChannels, refFrames,
+                                        ALSAResampler::QUALITY_LOW) == NO_ERROR;
+        if (mEcho && mRefResampler.outputFrames(refFrames) > outFrames)
+            outFrames = mRefResampler.outputFrames(refFrames);
+    }
+    if (aec && !mEcho) {
+        LOGW("No echo reference at %u Hz from %u Hz, aec bypassed", mRate, mRefRate);
+        aec->setEnabled(false);
+    }
+
+    delete [] refBuffer;
+    delete [] refRate;
+    refBuffer = new char[refFrames * mRefChannels * sizeof(int16_t)];
+    // what a block resamples past its frames goes to the next one
+    mRefSize = 2 * outFrames;
+    refRate = new char[mRefSize * mRefChannels * sizeof(int16_t)];
+}
 
-    //process_rx(sourceBuffer, procBuffer, refBuffer, feedback, frames);
+void AudioEngine::process_data(size_t &bytes)
+{
+    // The playback of the same period is the echo reference. It's taken in
+    // step with the capture, what played in the block's time at the
+    // playback rate, straight out of the ring unless it wraps there.
+    size_t frames = snd_pcm_bytes_to_frames(mInput->handle, bytes);
+    uint64_t owed = (uint64_t)frames * mRefRate + mRefPhase;
+    size_t refFrames = (size_t)(owed / mRate);
+    size_t refBytes = refFrames * mRefChannels * sizeof(int16_t);
+    mRefPhase = owed % mRate;
+
+    RingBuffer::Region region;
+    size_t n = writeRng.peek(refBytes, region);
+    const char *reference = NULL;
+
+    if (!mEcho) {
+        // nothing to cancel, the ring still drains at the playback rate
+    } else if (!n) {
+        // the reference picks up again with the playback
+        mRefCarry = 0;
+        if (mRefRate != mRate)
+            mRefResampler.reset();
+    } else if (n == refBytes && region.size[1] == 0) {
+        reference = region.data[0];
+    } else {
+        memcpy(refBuffer, region.data[0], region.size[0]);
+        memcpy(refBuffer + region.size[0], region.data[1], region.size[1]);
+        memset(refBuffer + n, 0, refBytes - n);
+        reference = refBuffer;
+    }
+
+    if (reference && mRefRate != mRate) {
+        size_t frameBytes = mRefChannels * sizeof(int16_t);
+        size_t out = mRefCarry + mRefResampler.resample((const int16_t *)reference, refFrames,
+                                                        (int16_t *)(refRate + mRefCarry * frameBytes),
+                                                        mRefSize - mRefCarry);
+        if (out < frames)
+            memset(refRate + out * frameBytes, 0, (frames - out) * frameBytes);
+        reference = refRate;
+        // read before the next block moves the carry down
+        mRefCarry = out > frames ? out - frames : 0;
+    }
+
+    if (mProcess) {
+        AudioBlock block;
+        block.data = (int16_t *)sourceBuffer;
+        block.frames = frames;
+        block.capacity = mChain.capacity();
+        block.channels = mInput->channels;
+        block.rate = mRate;
+        block.reference = (const int16_t *)reference;
+        block.refChannels = mRefChannels;
+
+        mChain.process(block);
+
+        bytes = snd_pcm_frames_to_bytes(mInput->handle, block.frames);
+    }
+
+    if (mRefCarry)
+        memmove(refRate, refRate + frames * mRefChannels * sizeof(int16_t),
+                mRefCarry * mRefChannels * sizeof(int16_t));
+
+    // If playback overran the reference meanwhile it's gone either way
+    if (n)
+        writeRng.consume(n);
 }
 
 }
@@ -20,6 +20,8 @@
 
 #include <AudioHardwareALSA.h>
 #include <RingBuffer.h>
+#include <AudioChain.h>
+#include <ALSAResampler.h>
 
 namespace android
 {
@@ -51,12 +53,26 @@ private:
     RingBuffer          readRng;
     RingBuffer          writeRng;
 
-    char *              sourceBuffer;
-    char *              procBuffer;
-    char *              refBuffer;
-    char *              feedback;
+    char *              sourceBuffer;   // captured, then processed in place
+    char *              refBuffer;      // reference when it wraps in writeRng
+    char *              refRate;        // reference at the capture rate
+    size_t              sourceSize;
 
-    void process_data();
+    AudioChain          mChain;
+    bool                mProcess;       // the capture format suits the chain
+    unsigned int        mRate;          // granted the PCM, mInput's is the stream's
+
+    // The playback written is the echo reference, 16 bit at its own rate
+    unsigned int        mRefRate;
+    int                 mRefChannels;
+    uint64_t            mRefPhase;      // of the playback owed the next block, in 1/mRate
+    size_t              mRefCarry;      // frames resampled ahead, at the start of refRate
+    size_t              mRefSize;       // frames refRate holds
+    bool                mEcho;          // an aec node gets the reference
+    ALSAResampler       mRefResampler;  // mRefRate to mRate
+
+    void setReference();
+    void process_data(size_t &bytes);
 };
 
 }
@@ -0,0 +1,291 @@
+/* AudioProcessors.cpp
+ **
+ ** Copyright 2009-2011 Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#define LOG_TAG "AudioProcessors"
+#include <utils/Log.h>
+
+#include <AudioProcessors.h>
+
+namespace android
+{
+
+static inline int16_t clamp16(int32_t v)
+{
+    return v > 32767 ? 32767 : v < -32768 ? -32768 : v;
+}
+
+/* --- echo canceller ---------------------------------------------------- */
+
+// NLMS step size and the regularization of the reference energy, per tap
+#define AEC_MU      0.5f
+#define AEC_DELTA   1e-4f
+
+EchoCanceller::EchoCanceller(int taps) :
+    AudioProcessor("aec"),
+    mTaps(taps > 0 ? taps : 256),
+    mChannels(0),
+    mMaxFrames(0),
+    mHistory(NULL),
+    mEnergy(0)
+{
+    for (int c = 0; c < MAX_CHANNELS; c++)
+        mWeights[c] = NULL;
+}
+
+EchoCanceller::~EchoCanceller()
+{
+    delete [] mHistory;
+    for (int c = 0; c < MAX_CHANNELS; c++)
+        delete [] mWeights[c];
+}
+
+status_t EchoCanceller::configure(int &rate, int channels, size_t maxFrames)
+{
+    if (channels < 1 || channels > MAX_CHANNELS) return BAD_VALUE;
+
+    delete [] mHistory;
+    for (int c = 0; c < MAX_CHANNELS; c++) {
+        delete [] mWeights[c];
+        mWeights[c] = NULL;
+    }
+
+    mChannels = channels;
+    mMaxFrames = maxFrames;
+    mHistory = new float[mTaps - 1 + maxFrames];
+    for (int c = 0; c < channels; c++)
+        mWeights[c] = new float[mTaps];
+    reset();
+
+    return NO_ERROR;
+}
+
+void EchoCanceller::reset()
+{
+    if (!mHistory) return;
+
+    memset(mHistory, 0, (mTaps - 1 + mMaxFrames) * sizeof(float));
+    for (int c = 0; c < mChannels; c++)
+        memset(mWeights[c], 0, mTaps * sizeof(float));
+}
+
+void EchoCanceller::process(AudioBlock &block)
+{
+    size_t frames = block.frames < mMaxFrames ? block.frames : mMaxFrames;
+    float *ref = mHistory + mTaps - 1;
+
+    // mono reference after the taps - 1 samples of the last block
+    if (block.reference) {
+        const int16_t *in = block.reference;
+        float scale = 1.0f / (32768.0f * block.refChannels);
+        for (size_t n = 0; n < frames; n++) {
+            int32_t sum = 0;
+            for (int c = 0; c < block.refChannels; c++)
+                sum += *in++;
+            ref[n] = sum * scale;
+        }
+    } else {
+        memset(ref, 0, frames * sizeof(float));
+    }
+
+    mEnergy = 0;
+    for (int k = 0; k < mTaps - 1; k++)
+        mEnergy += mHistory[k] * mHistory[k];
+
+    int16_t *data = block.data;
+    for (size_t n = 0; n < frames; n++) {
+        // the window ends on the current reference sample
+        const float *x = mHistory + n;
+        mEnergy += x[mTaps - 1] * x[mTaps - 1];
+        if (mEnergy < 0) mEnergy = 0;
+
+        for (int c = 0; c < mChannels; c++) {
+            float *w = mWeights[c];
+            float echo = 0;
+            for (int k = 0; k < mTaps; k++)
+                echo += w[k] * x[k];
+
+            float e = data[c] / 32768.0f - echo;
+            data[c] = clamp16((int32_t)lrintf(e * 32768.0f));
+
+            float step = AEC_MU * e / (mEnergy + AEC_DELTA * mTaps);
+            for (int k = 0; k < mTaps; k++)
+                w[k] += step * x[k];
+        }
+        data += mChannels;
+
+        mEnergy -= x[0] * x[0];
+    }
+
+    memmove(mHistory, mHistory + frames, (mTaps - 1) * sizeof(float));
+}
+
+/* --- noise suppression ------------------------------------------------- */
+
+// how fast the noise estimate may rise, dB per second
+#define NS_RISE_DB  3.0f
+
+NoiseSuppressor::NoiseSuppressor(int floorDb) :
+    AudioProcessor("ns"),
+    mFloor(powf(10.0f, (floorDb < 0 ? floorDb : -15) / 20.0f)),
+    mNoise(-1),
+    mGain(1),
+    mRise(1)
+{
+}
+
+status_t NoiseSuppressor::configure(int &rate, int channels, size_t maxFrames)
+{
+    if (rate <= 0) return BAD_VALUE;
+
+    mRise = powf(10.0f, NS_RISE_DB / 10.0f * maxFrames / rate);
+    reset();
+    return NO_ERROR;
+}
+
+void NoiseSuppressor::reset()
+{
+    mNoise = -1;
+    mGain = 1;
+}
+
+void NoiseSuppressor::process(AudioBlock &block)
+{
+    size_t samples = block.frames * block.channels;
+    int16_t *data = block.data;
+
+    if (samples == 0) return;
+
+    float power = 0;
+    for (size_t i = 0; i < samples; i++)
+        power += (float)data[i] * data[i];
+    power /= samples;
+
+    // minimum statistics: down at once, up slowly
+    if (mNoise < 0 || power < mNoise)
+        mNoise = power;
+    else
+        mNoise *= mRise;
+
+    float gain = power > 0 ? sqrtf(1.0f - (mNoise < power ? mNoise / power : 1.0f)) : mFloor;
+    if (gain < mFloor) gain = mFloor;
+
+    // ramp from the gain of the last block, in Q15
+    int32_t g = (int32_t)(mGain * 32768.0f);
+    int32_t target = (int32_t)(gain * 32768.0f);
+    int32_t delta = (target - g) / (int32_t)block.frames;
+    for (size_t n = 0; n < block.frames; n++) {
+        for (int c = 0; c < block.channels; c++, data++)
+            *data = clamp16((*data * g) >> 15);
+        g += delta;
+    }
+
+    mGain = gain;
+}
+
+/* --- gain ---------------------------------------------------------------- */
+
+GainProcessor::GainProcessor(int db) :
+    AudioProcessor("gain")
+{
+    // +24 dB keeps a full scale sample times the gain in 32 bits
+    if (db > 24) db = 24;
+    mGain = (int32_t)lrintf(powf(10.0f, db / 20.0f) * 4096.0f);
+}
+
+status_t GainProcessor::configure(int &rate, int channels, size_t maxFrames)
+{
+    return NO_ERROR;
+}
+
+void GainProcessor::process(AudioBlock &block)
+{
+    size_t samples = block.frames * block.channels;
+    int16_t *data = block.data;
+
+    for (size_t i = 0; i < samples; i++)
+        data[i] = clamp16((data[i] * mGain + 2048) >> 12);
+}
+
+/* --- resampler ----------------------------------------------------------- */
+
+Resampler::Resampler(int rate, int quality, uint32_t budget) :
+    AudioProcessor("resample", true),
+    mInRate(0),
+    mOutRate(rate),
+    mChannels(0),
+    mQuality(quality),
+    mBudget(budget),
+    mInput(NULL),
+    mMaxFrames(0)
+{
+}
+
+Resampler::~Resampler()
+{
+    delete [] mInput;
+}
+
+status_t Resampler::configure(int &rate, int channels, size_t maxFrames)
+{
+    if (rate <= 0 || mOutRate <= 0 || channels < 1 || channels > MAX_CHANNELS)
+        return BAD_VALUE;
+
+    mInRate = rate;
+    mChannels = channels;
+    if (mInRate != mOutRate) {
+        int quality = mQuality >= 0 ? mQuality :
+                ALSAResampler::qualityFor(mBudget, mInRate, mOutRate, channels);
+        status_t err = mResampler.configure(mInRate, mOutRate, channels, maxFrames, quality);
+        if (err != NO_ERROR)
+            return err;
+    }
+
+    delete [] mInput;
+    mInput = new int16_t[maxFrames * channels];
+    mMaxFrames = maxFrames;
+
+    rate = mOutRate;
+    return NO_ERROR;
+}
+
+size_t Resampler::outputFrames(size_t frames) const
+{
+    return mInRate == mOutRate ? frames : mResampler.outputFrames(frames);
+}
+
+void Resampler::reset()
+{
+    mResampler.reset();
+}
+
+void Resampler::process(AudioBlock &block)
+{
+    size_t frames = block.frames < mMaxFrames ? block.frames : mMaxFrames;
+
+    // the reference is at the input rate, nothing after this can use it
+    block.reference = NULL;
+    block.rate = mOutRate;
+    if (mInRate == mOutRate || frames == 0) return;
+
+    memcpy(mInput, block.data, frames * mChannels * sizeof(int16_t));
+    block.frames = mResampler.resample(mInput, frames, block.data, block.capacity);
+}
+
+}
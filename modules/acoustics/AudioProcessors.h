@@ -0,0 +1,108 @@
+/* AudioProcessors.h
+ **
+ ** Copyright 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#ifndef ANDROID_HARDWARE_TI_AUDIO_PROCESSORS_H
+#define ANDROID_HARDWARE_TI_AUDIO_PROCESSORS_H
+
+#include <AudioChain.h>
+#include <ALSAResampler.h>
+
+namespace android
+{
+
+// "aec[:taps]": NLMS echo canceller, subtracts the echo of the block's
+// reference from every capture channel. taps must cover the echo path,
+// 256 by default (32 ms at 8 kHz).
+class EchoCanceller : public AudioProcessor {
+public:
+    enum { MAX_CHANNELS = 2 };
+
+    EchoCanceller(int taps = 256);
+    virtual ~EchoCanceller();
+
+    virtual status_t configure(int &rate, int channels, size_t maxFrames);
+    virtual void reset();
+    virtual void process(AudioBlock &block);
+
+private:
+    int         mTaps;
+    int         mChannels;
+    size_t      mMaxFrames;
+    float *     mHistory;       // mono reference, taps - 1 old samples then the block
+    float *     mWeights[MAX_CHANNELS];
+    float       mEnergy;        // of the reference under the filter
+};
+
+// "ns[:floor]": noise suppression. The noise level is tracked as the
+// minimum of the block levels and blocks get a Wiener gain of at least
+// floor dB, -15 by default, ramped over the block.
+class NoiseSuppressor : public AudioProcessor {
+public:
+    NoiseSuppressor(int floorDb = -15);
+
+    virtual status_t configure(int &rate, int channels, size_t maxFrames);
+    virtual void reset();
+    virtual void process(AudioBlock &block);
+
+private:
+    float       mFloor;
+    float       mNoise;         // mean square
+    float       mGain;          // of the last block
+    float       mRise;          // per block growth of the noise estimate
+};
+
+// "gain:dB": fixed gain with saturation, up to +24 dB
+class GainProcessor : public AudioProcessor {
+public:
+    GainProcessor(int db);
+
+    virtual status_t configure(int &rate, int channels, size_t maxFrames);
+    virtual void process(AudioBlock &block);
+
+private:
+    int32_t     mGain;          // Q12
+};
+
+// "resample:rate[:quality]": polyphase conversion to rate, the block grows
+// or shrinks. quality is an ALSAResampler::Quality, by default the best
+// whose multiply-accumulates per second fit budget.
+class Resampler : public AudioProcessor {
+public:
+    enum { MAX_CHANNELS = ALSAResampler::MAX_CHANNELS };
+    enum { DEFAULT_MAC_BUDGET = 8000000 };
+
+    Resampler(int rate, int quality = -1, uint32_t budget = DEFAULT_MAC_BUDGET);
+    virtual ~Resampler();
+
+    virtual status_t configure(int &rate, int channels, size_t maxFrames);
+    virtual size_t outputFrames(size_t frames) const;
+    virtual void reset();
+    virtual void process(AudioBlock &block);
+
+private:
+    int         mInRate;
+    int         mOutRate;
+    int         mChannels;
+    int         mQuality;
+    uint32_t    mBudget;
+    int16_t *   mInput;
+    size_t      mMaxFrames;
+    ALSAResampler mResampler;
+};
+
+}
+#endif
@@ -15,76 +15,248 @@
  ** limitations under the License.
  */
 
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
 #define LOG_TAG "RingBuffer"
 #include <utils/Log.h>
+#include <cutils/atomic.h>
 
 #include <RingBuffer.h>
 
 namespace android
 {
 
-RingBuffer::RingBuffer(size_t size) :
+static inline void futexWait(volatile int32_t *addr, int32_t value)
+{
+    syscall(__NR_futex, addr, FUTEX_WAIT, value, NULL, NULL, 0);
+}
+
+static inline void futexWake(volatile int32_t *addr)
+{
+    syscall(__NR_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+RingBuffer::RingBuffer(size_t size, Mode mode) :
         mSize(size),
-        mEmpty(1),
-        mBegin(0),
-        mEnd(0)
+        mMode(mode),
+        mWritePos(0),
+        mReservePos(0),
+        mWriterWaiting(0),
+        mDataSeq(0),
+        mReadPos(0),
+        mReaderWaiting(0),
+        mSpaceSeq(0),
+        mPeekPos(0),
+        mResetPos(0)
 {
-    mBuffer = new char[mSize];
-    memset(mBuffer, 0, mSize);
+    // Half a ring of slack lets the writer go on while the reader copies
+    // out of a full ring in OVERWRITE mode.
+    size_t storage = 1;
+    size_t needed = (mMode == OVERWRITE) ? mSize + mSize / 2 : mSize;
+    while (storage < needed) storage <<= 1;
+    mMask = storage - 1;
+
+    mBuffer = new char[storage];
+    memset(mBuffer, 0, storage);
 }
 
 RingBuffer::~RingBuffer()
 {
-    delete mBuffer;
+    delete [] mBuffer;
 }
 
 void RingBuffer::reset()
 {
-    mEmpty = 1;
-    mBegin = 0;
-    mEnd = 0;
-    memset(mBuffer, 0, mSize);
+    android_atomic_release_store(android_atomic_acquire_load(&mWritePos), &mResetPos);
+
+    // the dropped data is room for a waiting writer
+    android_memory_barrier();
+    if (mWriterWaiting) {
+        android_atomic_inc(&mSpaceSeq);
+        futexWake(&mSpaceSeq);
+    }
+}
+
+// Whether a reset to resetPos still drops something between pos and end.
+// The positions wrap, one that's behind the reader or ahead of the writer is
+// a reset that's long done.
+bool RingBuffer::pending(uint32_t resetPos, uint32_t pos, uint32_t end)
+{
+    return (int32_t)(resetPos - pos) > 0 && (int32_t)(end - resetPos) >= 0;
+}
+
+// Consumer: start and size of the unread data
+size_t RingBuffer::unread(uint32_t &begin)
+{
+    uint32_t end = android_atomic_acquire_load(&mWritePos);
+    uint32_t pos = mReadPos;
+    uint32_t resetPos = android_atomic_acquire_load(&mResetPos);
+
+    if (pending(resetPos, pos, end)) pos = resetPos;
+    // the writer went around, what's older than a ring is gone
+    if (end - pos > mSize) pos = end - mSize;
+
+    begin = pos;
+    return end - pos;
+}
+
+// Producer: free space, BLOCK mode
+size_t RingBuffer::room()
+{
+    uint32_t pos = android_atomic_acquire_load(&mReadPos);
+    uint32_t resetPos = android_atomic_acquire_load(&mResetPos);
+
+    if (pending(resetPos, pos, mWritePos)) pos = resetPos;
+    return mSize - (mWritePos - pos);
+}
+
+void RingBuffer::fill(Region &region, uint32_t pos, size_t size)
+{
+    size_t offset = pos & mMask;
+    size_t first = mMask + 1 - offset;
+
+    if (first > size) first = size;
+    region.data[0] = mBuffer + offset;
+    region.size[0] = first;
+    region.data[1] = mBuffer;
+    region.size[1] = size - first;
+}
+
+// Consumer: whether the writer left the data from begin on alone while it
+// was being read
+bool RingBuffer::intact(uint32_t begin)
+{
+    if (mMode == BLOCK) return true;
+
+    android_memory_barrier();
+    uint32_t reserved = android_atomic_acquire_load(&mReservePos);
+    return reserved - begin <= mMask + 1;
+}
+
+size_t RingBuffer::reserve(size_t size, Region &region)
+{
+    uint32_t pos = mWritePos;
+    size_t n = (mMode == BLOCK) ? room() : mSize;
+
+    if (n > size) n = size;
+    fill(region, pos, n);
+
+    if (n && mMode == OVERWRITE) {
+        // The reader checks this after copying. It has to be out before any
+        // byte of the reservation lands.
+        if ((int32_t)(pos + n - (uint32_t)mReservePos) > 0)
+            android_atomic_release_store(pos + n, &mReservePos);
+        android_memory_barrier();
+    }
+
+    return n;
+}
+
+void RingBuffer::commit(size_t size)
+{
+    if (size == 0) return;
+
+    android_atomic_release_store(mWritePos + size, &mWritePos);
+
+    // Pairs with the barrier in waitForData(), one of the two sides sees
+    // the other.
+    android_memory_barrier();
+    if (mReaderWaiting) {
+        android_atomic_inc(&mDataSeq);
+        futexWake(&mDataSeq);
+    }
+}
+
+void RingBuffer::waitForData()
+{
+    android_atomic_release_store(1, &mReaderWaiting);
+    android_memory_barrier();
+
+    int32_t seq = android_atomic_acquire_load(&mDataSeq);
+    uint32_t begin;
+    if (unread(begin) == 0) futexWait(&mDataSeq, seq);
+
+    android_atomic_release_store(0, &mReaderWaiting);
+}
+
+void RingBuffer::waitForRoom()
+{
+    android_atomic_release_store(1, &mWriterWaiting);
+    android_memory_barrier();
+
+    int32_t seq = android_atomic_acquire_load(&mSpaceSeq);
+    if (room() == 0) futexWait(&mSpaceSeq, seq);
+
+    android_atomic_release_store(0, &mWriterWaiting);
 }
 
 size_t RingBuffer::write(const void *buffer, size_t size)
 {
     if (size == 0) return 0;
 
-    char *cbuf = (char *)buffer;
-    if (size > mSize) {
+    const char *cbuf = (const char *)buffer;
+    if (size > mSize && mMode == OVERWRITE) {
         LOGE("Single write is larger than ring size (%d > %d)."
                 " Only writing last portion.", size, mSize);
         cbuf += (size - mSize);
         size = mSize;
     }
 
-    mLock.lock();
-
-    size_t avail = (mEmpty || mBegin <= mEnd) ? mSize + mBegin - mEnd : mBegin - mEnd;
-    size_t len = mSize - mEnd;
+    size_t len = size;
+    while (len) {
+        Region region;
+        size_t n = reserve(len, region);
+        if (n == 0) {
+            waitForRoom();
+            continue;
+        }
 
-    if (len > size) len = size;
+        memcpy(region.data[0], cbuf, region.size[0]);
+        memcpy(region.data[1], cbuf + region.size[0], region.size[1]);
+        commit(n);
 
-    // Fill until we wrap.
-    memcpy(mBuffer + mEnd, cbuf, len);
-    cbuf += len;
-    mEnd = (mEnd + len) % mSize;
+        cbuf += n;
+        len -= n;
+    }
 
-    len = size - len;
+    return size;
+}
 
-    // Fill remaining data.
-    if (len) {
-        memcpy(mBuffer, cbuf, len);
-        mEnd = len;
-    }
+size_t RingBuffer::peek(size_t size, Region &region)
+{
+    uint32_t begin;
+    size_t n = unread(begin);
 
-    mEmpty = 0;
-    if (size > avail) mBegin = mEnd;
+    if (n > size) n = size;
+    fill(region, begin, n);
+    mPeekPos = begin;
 
-    mCond.signal();
-    mLock.unlock();
+    return n;
+}
 
-    return size;
+bool RingBuffer::consume(size_t size)
+{
+    // Overwritten data stays unread, unread() skips past it next time
+    if (!intact(mPeekPos)) return false;
+
+    uint32_t pos = mPeekPos + size;
+    android_atomic_release_store(pos, &mReadPos);
+
+    // Drags a reset the reader went past along, so it can't come back as
+    // pending once the positions wrap. A reset() in between wins.
+    uint32_t resetPos = android_atomic_acquire_load(&mResetPos);
+    if ((int32_t)(pos - resetPos) > 0)
+        android_atomic_cmpxchg(resetPos, pos, &mResetPos);
+
+    android_memory_barrier();
+    if (mWriterWaiting) {
+        android_atomic_inc(&mSpaceSeq);
+        futexWake(&mSpaceSeq);
+    }
+    return true;
 }
 
 size_t RingBuffer::read(void *buffer, size_t size)
@@ -98,24 +270,22 @@ size_t RingBuffer::read(void *buffer, size_t size)
     char *cbuf = (char *)buffer;
     size_t len = size;
 
-    mLock.lock();
-
     while (len) {
-        if (mEmpty) mCond.wait(mLock);
-
-        size_t s = (mBegin < mEnd) ? mEnd - mBegin : mSize - mBegin;
-        if (len < s) s = len;
+        Region region;
+        size_t n = peek(len, region);
+        if (n == 0) {
+            waitForData();
+            continue;
+        }
 
-        memcpy(cbuf, mBuffer + mBegin, s);
-        cbuf += s;
-        len -= s;
+        memcpy(cbuf, region.data[0], region.size[0]);
+        memcpy(cbuf + region.size[0], region.data[1], region.size[1]);
+        if (!consume(n)) continue;
 
-        mBegin = (mBegin + s) % mSize;
-        if (mBegin == mEnd) mEmpty = 1;
+        cbuf += n;
+        len -= n;
     }
 
-    mLock.unlock();
-
     return size;
 }
 
@@ -128,31 +298,16 @@ size_t RingBuffer::copy(void *buffer, size_t size)
     }
 
     char *cbuf = (char *)buffer;
-    size_t len = size;
-
-    mLock.lock();
-
-    if (len && !mEmpty) {
-        size_t s = (mBegin < mEnd) ? mEnd - mBegin : mSize - mBegin;
-        if (len < s) s = len;
-
-        memcpy(cbuf, mBuffer + mBegin, s);
-        cbuf += s;
-        len -= s;
-
-        if (len) {
-            s = mEnd;
-            if (len < s) s = len;
-            if (s) {
-                memcpy(cbuf, mBuffer, s);
-                len -= s;
-            }
-        }
-    }
+    size_t n;
 
-    mLock.unlock();
+    do {
+        Region region;
+        n = peek(size, region);
+        memcpy(cbuf, region.data[0], region.size[0]);
+        memcpy(cbuf + region.size[0], region.data[1], region.size[1]);
+    } while (!intact(mPeekPos));
 
-    return size - len;
+    return n;
 }
 
 }
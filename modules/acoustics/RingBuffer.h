@@ -18,30 +18,94 @@
 #ifndef RING_BUFFER_H
 #define RING_BUFFER_H
 
-#include <utils/threads.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 namespace android
 {
 
+// Single producer, single consumer byte ring. One thread writes, one thread
+// reads or copies, neither takes a lock: the producer only moves the write
+// position and the consumer only moves the read position. A thread only
+// sleeps, on a futex, when it has to wait for the other side: the reader on
+// an empty ring, the writer on a full one in BLOCK mode. The other side only
+// makes the wake-up call when somebody sleeps.
+//
+// In OVERWRITE mode a write never waits, it drops the oldest data instead.
+// The storage is larger than the ring so the reader can tell when the writer
+// overran what it was reading, it then moves on to the data that's left.
 class RingBuffer
 {
 public:
-    RingBuffer(size_t size);
+    enum Mode {
+        OVERWRITE,      // full ring: the oldest data goes
+        BLOCK,          // full ring: the writer waits
+    };
+
+    // Up to two pieces of the ring, the second one after the wrap
+    struct Region {
+        char *      data[2];
+        size_t      size[2];
+    };
+
+    RingBuffer(size_t size, Mode mode = OVERWRITE);
     ~RingBuffer();
 
+    // Drops the unread data, from either side
     void reset();
+
+    // Producer side, write() copies all of buffer, waiting for room in BLOCK mode
     size_t write(const void *buffer, size_t size);
+    // Reserves up to size bytes without waiting, returns how many
+    size_t reserve(size_t size, Region &region);
+    void commit(size_t size);
+
+    // Consumer side, read() waits for all of size
     size_t read(void *buffer, size_t size);
+    // The unread data, without consuming it
     size_t copy(void *buffer, size_t size);
+    // Up to size unread bytes without waiting, returns how many
+    size_t peek(size_t size, Region &region);
+    // Consumes what peek() returned. False if the writer overwrote part of
+    // it in the meantime (OVERWRITE mode only), it must be dropped then.
+    bool consume(size_t size);
+
+    size_t size() const { return mSize; }
 
 private:
+    enum { CACHE_LINE = 64 };
+
+    size_t      unread(uint32_t &begin);
+    size_t      room();
+    static bool pending(uint32_t resetPos, uint32_t pos, uint32_t end);
+    void        fill(Region &region, uint32_t pos, size_t size);
+    bool        intact(uint32_t begin);
+    void        waitForData();
+    void        waitForRoom();
+
+    // read only after construction
     char *      mBuffer;
     size_t      mSize;
-    int         mEmpty;
-    size_t      mBegin;
-    size_t      mEnd;
-    Mutex       mLock;
-    Condition   mCond;
+    uint32_t    mMask;          // storage is mMask + 1 bytes, a power of two
+    Mode        mMode;
+    char        mPad0[CACHE_LINE];
+
+    // producer
+    volatile int32_t mWritePos;     // bytes ever committed
+    volatile int32_t mReservePos;   // bytes ever reserved, the writer may touch up to here
+    volatile int32_t mWriterWaiting;
+    volatile int32_t mDataSeq;      // the reader sleeps on this one
+    char        mPad1[CACHE_LINE];
+
+    // consumer
+    volatile int32_t mReadPos;      // bytes ever consumed
+    volatile int32_t mReaderWaiting;
+    volatile int32_t mSpaceSeq;     // and the writer on this one
+    uint32_t    mPeekPos;           // where the region of the last peek() starts
+    char        mPad2[CACHE_LINE];
+
+    // either side
+    volatile int32_t mResetPos;     // a reset() drops everything before this
 };
 
 }
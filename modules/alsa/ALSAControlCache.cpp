@@ -0,0 +1,376 @@
+/* ALSAControlCache.cpp
+ **
+ ** Copyright 2009-2011 Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "ALSAControlCache"
+#include <utils/Log.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ALSAControlCache.h"
+
+namespace android
+{
+
+// by name, the lowest numid first among elements of the same name
+int ALSAControlCache::compare(const void *a, const void *b)
+{
+    const Control *ca = (const Control *)a;
+    const Control *cb = (const Control *)b;
+    int c = strcmp(ca->name, cb->name);
+    return c ? c : (int)ca->numid - (int)cb->numid;
+}
+
+ALSAControlCache::ALSAControlCache(const char *device) :
+    mCtl(NULL),
+    mEvents(false),
+    mControls(NULL),
+    mCount(0),
+    mByNumid(NULL),
+    mMaxNumid(0),
+    mStaged(NULL),
+    mStagedCount(0)
+{
+    snd_ctl_elem_list_t *list;
+    int err;
+
+    memset(&mStats, 0, sizeof(mStats));
+
+    // non blocking is for the events, reads and writes of elements
+    // don't block either way
+    err = snd_ctl_open(&mCtl, device, SND_CTL_NONBLOCK);
+    if (err < 0) {
+        LOGE("Unable to open the controls of %s: %s", device, snd_strerror(err));
+        mCtl = NULL;
+        return;
+    }
+
+    err = snd_ctl_subscribe_events(mCtl, 1);
+    if (err < 0)
+        LOGW("No control events from %s, routes read every element back: %s",
+                device, snd_strerror(err));
+    mEvents = err >= 0;
+
+    snd_ctl_elem_list_alloca(&list);
+    if ((err = snd_ctl_elem_list(mCtl, list)) < 0 ||
+        (err = snd_ctl_elem_list_alloc_space(list, snd_ctl_elem_list_get_count(list))) < 0 ||
+        (err = snd_ctl_elem_list(mCtl, list)) < 0) {
+        LOGE("Unable to list the controls of %s: %s", device, snd_strerror(err));
+        snd_ctl_close(mCtl);
+        mCtl = NULL;
+        return;
+    }
+
+    mCount = snd_ctl_elem_list_get_used(list);
+    mControls = new Control[mCount];
+    memset(mControls, 0, mCount * sizeof(Control));
+    for (unsigned int i = 0; i < mCount; i++) {
+        Control &c = mControls[i];
+        strncpy(c.name, snd_ctl_elem_list_get_name(list, i), sizeof(c.name) - 1);
+        c.numid = snd_ctl_elem_list_get_numid(list, i);
+        if (c.numid > mMaxNumid) mMaxNumid = c.numid;
+    }
+    snd_ctl_elem_list_free_space(list);
+
+    qsort(mControls, mCount, sizeof(Control), compare);
+
+    mByNumid = new Control *[mMaxNumid + 1];
+    memset(mByNumid, 0, (mMaxNumid + 1) * sizeof(Control *));
+    for (unsigned int i = 0; i < mCount; i++)
+        mByNumid[mControls[i].numid] = &mControls[i];
+
+    mStaged = new Control *[mCount];
+
+    LOGV("%u controls on %s", mCount, device);
+}
+
+ALSAControlCache::~ALSAControlCache()
+{
+    for (unsigned int i = 0; i < mCount; i++) {
+        for (unsigned int item = 0; item < mControls[i].items; item++)
+            free(mControls[i].itemNames[item]);
+        delete [] mControls[i].itemNames;
+    }
+    delete [] mControls;
+    delete [] mByNumid;
+    delete [] mStaged;
+
+    if (mCtl)
+        snd_ctl_close(mCtl);
+}
+
+ALSAControlCache::Control *ALSAControlCache::find(const char *name)
+{
+    unsigned int low = 0, high = mCount;
+
+    while (low < high) {
+        unsigned int mid = (low + high) / 2;
+        if (strcmp(mControls[mid].name, name) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low < mCount && !strcmp(mControls[low].name, name))
+        return &mControls[low];
+
+    LOGE("Control '%s' not found", name);
+    return NULL;
+}
+
+// Reads the info of the element the first time and its values every time
+status_t ALSAControlCache::load(Control &c)
+{
+    snd_ctl_elem_info_t *info;
+    snd_ctl_elem_value_t *value;
+    int err;
+
+    snd_ctl_elem_info_alloca(&info);
+    snd_ctl_elem_value_alloca(&value);
+
+    if (!c.count) {
+        snd_ctl_elem_info_set_numid(info, c.numid);
+        if ((err = snd_ctl_elem_info(mCtl, info)) < 0) {
+            LOGE("Unable to get the info of '%s': %s", c.name, snd_strerror(err));
+            return BAD_VALUE;
+        }
+
+        c.type = snd_ctl_elem_info_get_type(info);
+        if (snd_ctl_elem_info_get_count(info) > MAX_VALUES) {
+            LOGE("'%s' has %u values, more than %d", c.name,
+                    snd_ctl_elem_info_get_count(info), MAX_VALUES);
+            return BAD_VALUE;
+        }
+
+        switch (c.type) {
+            case SND_CTL_ELEM_TYPE_BOOLEAN:
+                c.min = 0;
+                c.max = 1;
+                break;
+            case SND_CTL_ELEM_TYPE_INTEGER:
+                c.min = snd_ctl_elem_info_get_min(info);
+                c.max = snd_ctl_elem_info_get_max(info);
+                break;
+            case SND_CTL_ELEM_TYPE_ENUMERATED:
+                c.items = snd_ctl_elem_info_get_items(info);
+                c.itemNames = new char *[c.items];
+                for (unsigned int item = 0; item < c.items; item++) {
+                    snd_ctl_elem_info_set_item(info, item);
+                    snd_ctl_elem_info(mCtl, info);
+                    c.itemNames[item] = strdup(snd_ctl_elem_info_get_item_name(info));
+                }
+                c.min = 0;
+                c.max = c.items - 1;
+                break;
+            default:
+                LOGE("'%s' isn't a switch, a volume or an enumeration", c.name);
+                return BAD_VALUE;
+        }
+        c.count = snd_ctl_elem_info_get_count(info);
+    }
+
+    snd_ctl_elem_value_set_numid(value, c.numid);
+    if ((err = snd_ctl_elem_read(mCtl, value)) < 0) {
+        LOGE("Unable to read '%s': %s", c.name, snd_strerror(err));
+        return BAD_VALUE;
+    }
+    for (unsigned int i = 0; i < c.count; i++) {
+        switch (c.type) {
+            case SND_CTL_ELEM_TYPE_BOOLEAN:
+                c.value[i] = snd_ctl_elem_value_get_boolean(value, i);
+                break;
+            case SND_CTL_ELEM_TYPE_INTEGER:
+                c.value[i] = snd_ctl_elem_value_get_integer(value, i);
+                break;
+            default:
+                c.value[i] = snd_ctl_elem_value_get_enumerated(value, i);
+                break;
+        }
+    }
+
+    c.known = true;
+    mStats.reads++;
+    return NO_ERROR;
+}
+
+status_t ALSAControlCache::set(const char *name, unsigned int value, int index)
+{
+    if (!mCtl) return NO_INIT;
+
+    Control *c = find(name);
+    if (!c || (!c->known && load(*c) != NO_ERROR))
+        return BAD_VALUE;
+
+    if ((long)value < c->min || (long)value > c->max) {
+        LOGE("%u is out of the range of '%s', %ld to %ld", value, name, c->min, c->max);
+        return BAD_VALUE;
+    }
+    if (index >= (int)c->count) {
+        LOGE("'%s' has no value %d", name, index);
+        return BAD_VALUE;
+    }
+
+    if (!c->stagedMask)
+        mStaged[mStagedCount++] = c;
+    for (unsigned int i = 0; i < c->count; i++) {
+        if (index < 0 || (int)i == index) {
+            c->next[i] = value;
+            c->stagedMask |= 1 << i;
+        }
+    }
+    return NO_ERROR;
+}
+
+status_t ALSAControlCache::set(const char *name, const char *item)
+{
+    if (!mCtl) return NO_INIT;
+
+    Control *c = find(name);
+    if (!c || (!c->known && load(*c) != NO_ERROR))
+        return BAD_VALUE;
+
+    for (unsigned int i = 0; i < c->items; i++) {
+        if (!strcmp(c->itemNames[i], item))
+            return set(name, i, -1);
+    }
+
+    LOGE("'%s' has no item '%s'", name, item);
+    return BAD_VALUE;
+}
+
+status_t ALSAControlCache::get(const char *name, unsigned int &value, int index)
+{
+    if (!mCtl) return NO_INIT;
+
+    sync();
+
+    Control *c = find(name);
+    if (!c || (!c->known && load(*c) != NO_ERROR))
+        return BAD_VALUE;
+    if (index < 0 || index >= (int)c->count)
+        return BAD_VALUE;
+
+    value = c->stagedMask & (1 << index) ? c->next[index] : c->value[index];
+    return NO_ERROR;
+}
+
+// Marks the elements written elsewhere since the last look
+void ALSAControlCache::sync()
+{
+    snd_ctl_event_t *event;
+
+    if (!mEvents) {
+        invalidate();
+        return;
+    }
+
+    snd_ctl_event_alloca(&event);
+    while (snd_ctl_read(mCtl, event) > 0) {
+        if (snd_ctl_event_get_type(event) != SND_CTL_EVENT_ELEM)
+            continue;
+        unsigned int numid = snd_ctl_event_elem_get_numid(event);
+        if (numid <= mMaxNumid && mByNumid[numid])
+            mByNumid[numid]->known = false;
+    }
+}
+
+int ALSAControlCache::apply()
+{
+    snd_ctl_elem_value_t *value;
+    int written = 0;
+    int err = 0;
+
+    if (!mCtl) return NO_INIT;
+
+    snd_ctl_elem_value_alloca(&value);
+
+    // our own writes of the last apply come back here as well, they cost
+    // one read of the element on its next use
+    sync();
+
+    for (unsigned int s = 0; s < mStagedCount; s++) {
+        Control &c = *mStaged[s];
+        unsigned int mask = c.stagedMask;
+        bool change = false;
+
+        c.stagedMask = 0;
+        if (!c.known && load(c) != NO_ERROR) {
+            err = BAD_VALUE;
+            continue;
+        }
+
+        for (unsigned int i = 0; i < c.count; i++) {
+            if (mask & (1 << i) && c.next[i] != c.value[i])
+                change = true;
+            else
+                c.next[i] = c.value[i];
+        }
+        if (!change) {
+            mStats.skipped++;
+            continue;
+        }
+
+        snd_ctl_elem_value_clear(value);
+        snd_ctl_elem_value_set_numid(value, c.numid);
+        for (unsigned int i = 0; i < c.count; i++) {
+            switch (c.type) {
+                case SND_CTL_ELEM_TYPE_BOOLEAN:
+                    snd_ctl_elem_value_set_boolean(value, i, c.next[i]);
+                    break;
+                case SND_CTL_ELEM_TYPE_INTEGER:
+                    snd_ctl_elem_value_set_integer(value, i, c.next[i]);
+                    break;
+                default:
+                    snd_ctl_elem_value_set_enumerated(value, i, c.next[i]);
+                    break;
+            }
+        }
+
+        int result = snd_ctl_elem_write(mCtl, value);
+        if (result < 0) {
+            LOGE("Unable to write '%s': %s", c.name, snd_strerror(result));
+            c.known = false;
+            err = result;
+            continue;
+        }
+        memcpy(c.value, c.next, c.count * sizeof(long));
+        mStats.writes++;
+        written++;
+    }
+    mStagedCount = 0;
+
+    return err < 0 ? err : written;
+}
+
+void ALSAControlCache::discard()
+{
+    for (unsigned int s = 0; s < mStagedCount; s++)
+        mStaged[s]->stagedMask = 0;
+    mStagedCount = 0;
+}
+
+void ALSAControlCache::invalidate()
+{
+    for (unsigned int i = 0; i < mCount; i++)
+        mControls[i].known = false;
+}
+
+void ALSAControlCache::resetStats()
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+}
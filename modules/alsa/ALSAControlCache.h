@@ -0,0 +1,108 @@
+/* ALSAControlCache.h
+ **
+ ** Copyright (C) 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#ifndef ANDROID_ALSA_CONTROL_CACHE
+#define ANDROID_ALSA_CONTROL_CACHE
+
+#include <alsa/asoundlib.h>
+#include <utils/Errors.h>
+
+namespace android
+{
+
+// The mixer of a card as ALSAControl sets it, but with the elements
+// resolved once when the card is opened and their values cached. set()
+// only stages a value; apply() writes the elements whose staged value
+// differs from the cached one, in the order they were first staged.
+// A route is then the whole list of its controls, and switching routes
+// writes only what the two routes set differently.
+//
+// The cache follows writes made elsewhere (the modem, another process)
+// through the card's control events, an element changed behind its back
+// is read again before the next apply().
+//
+// Not thread safe, the HAL serializes routing.
+class ALSAControlCache
+{
+public:
+    enum { MAX_VALUES = 8 };    // values cached per element, ABE has 1 or 2
+
+    struct Stats {
+        unsigned int    writes;     // elements written
+        unsigned int    skipped;    // staged with the value they had
+        unsigned int    reads;      // elements read, first use and events
+    };
+
+    ALSAControlCache(const char *device);
+    ~ALSAControlCache();
+
+    status_t initCheck() const { return mCtl ? NO_ERROR : NO_INIT; }
+
+    // index -1 stages all the values of the element, as ALSAControl
+    status_t set(const char *name, unsigned int value, int index = -1);
+    // an item of an enumerated element
+    status_t set(const char *name, const char *item);
+
+    // The staged value if there is one, the element's otherwise
+    status_t get(const char *name, unsigned int &value, int index = 0);
+
+    // Writes the staged values that change something, returns the number
+    // of elements written or a negative error
+    int apply();
+    // Drops the staged values
+    void discard();
+
+    // Reads every cached element again on its next use
+    void invalidate();
+
+    const Stats &stats() const { return mStats; }
+    void resetStats();
+
+private:
+    struct Control {
+        char                name[44];       // SNDRV_CTL_ELEM_ID_NAME_MAXLEN
+        unsigned int        numid;
+        snd_ctl_elem_type_t type;
+        unsigned int        count;
+        long                min;
+        long                max;
+        bool                known;          // values read, count is once the info is
+        unsigned int        stagedMask;     // values next has
+        long                value[MAX_VALUES];
+        long                next[MAX_VALUES];
+        unsigned int        items;          // of an enumeration
+        char **             itemNames;
+    };
+
+    static int compare(const void *a, const void *b);
+    Control *find(const char *name);
+    status_t load(Control &control);
+    void sync();
+
+    snd_ctl_t *         mCtl;
+    bool                mEvents;        // subscribed to the card's
+    Control *           mControls;      // sorted by name
+    unsigned int        mCount;
+    Control **          mByNumid;
+    unsigned int        mMaxNumid;
+    Control **          mStaged;        // in staging order
+    unsigned int        mStagedCount;
+    Stats               mStats;
+};
+
+}
+#endif    // ANDROID_ALSA_CONTROL_CACHE
@@ -0,0 +1,333 @@
+/* ALSAResampler.cpp
+ **
+ ** Copyright (C) 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "ALSAResampler"
+#include <utils/Log.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_HAVE_NEON) || defined(__ARM_NEON__)
+#define RESAMPLER_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include "ALSAResampler.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace android
+{
+
+// The taps when interpolating and the stop band attenuation in dB of each
+// quality. The transition band of a Kaiser window of that attenuation
+// over that many taps ends at the lower Nyquist frequency.
+static const struct {
+    int     taps;
+    double  attenuation;
+} kQuality[ALSAResampler::QUALITY_COUNT] = {
+    { 16, 50.0 },       // QUALITY_LOW
+    { 32, 70.0 },       // QUALITY_MEDIUM
+    { 64, 96.0 },       // QUALITY_HIGH
+};
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static int tapsFor(int quality, int inRate, int outRate)
+{
+    int taps = kQuality[quality].taps;
+
+    // decimating, the cut off goes down and the filter gets longer by M/L
+    if (inRate > outRate)
+        taps = (int)(((int64_t)taps * inRate + outRate - 1) / outRate);
+    return (taps + 7) & ~7;
+}
+
+// modified Bessel function of the first kind, order 0
+static double besselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+// The output sample of taps input samples, rounded from Q30
+static inline int32_t dot(const int16_t *x, const int32_t *h, int taps)
+{
+#ifdef RESAMPLER_NEON
+    int64x2_t acc = vdupq_n_s64(0);
+
+    for (int i = 0; i < taps; i += 4) {
+        int32x4_t a = vmovl_s16(vld1_s16(x + i));
+        int32x4_t b = vld1q_s32(h + i);
+        acc = vmlal_s32(acc, vget_low_s32(a), vget_low_s32(b));
+        acc = vmlal_s32(acc, vget_high_s32(a), vget_high_s32(b));
+    }
+    int64_t sum = vgetq_lane_s64(acc, 0) + vgetq_lane_s64(acc, 1);
+#else
+    int64_t sum = 0;
+
+    for (int i = 0; i < taps; i += 4) {
+        sum += (int64_t)x[i] * h[i];
+        sum += (int64_t)x[i + 1] * h[i + 1];
+        sum += (int64_t)x[i + 2] * h[i + 2];
+        sum += (int64_t)x[i + 3] * h[i + 3];
+    }
+#endif
+    sum = (sum + (1 << 29)) >> 30;
+    return sum > 32767 ? 32767 : sum < -32768 ? -32768 : (int32_t)sum;
+}
+
+ALSAResampler::ALSAResampler() :
+    mInRate(0),
+    mOutRate(0),
+    mChannels(0),
+    mQuality(QUALITY_LOW),
+    mL(1),
+    mM(1),
+    mTaps(0),
+    mPhases(0),
+    mCoefs(NULL),
+    mMaxFrames(0),
+    mHave(0),
+    mPhase(0)
+{
+    for (int c = 0; c < MAX_CHANNELS; c++)
+        mWork[c] = NULL;
+}
+
+ALSAResampler::~ALSAResampler()
+{
+    free(mCoefs);
+    for (int c = 0; c < MAX_CHANNELS; c++)
+        free(mWork[c]);
+}
+
+uint32_t ALSAResampler::cost(int quality, int inRate, int outRate, int channels)
+{
+    if (quality < 0 || quality >= QUALITY_COUNT || inRate <= 0 || outRate <= 0)
+        return 0;
+    return (uint32_t)tapsFor(quality, inRate, outRate) * outRate * channels;
+}
+
+int ALSAResampler::qualityFor(uint32_t budget, int inRate, int outRate, int channels)
+{
+    for (int q = QUALITY_COUNT - 1; q > QUALITY_LOW; q--)
+        if (cost(q, inRate, outRate, channels) <= budget)
+            return q;
+    return QUALITY_LOW;
+}
+
+status_t ALSAResampler::configure(int inRate, int outRate, int channels,
+                                  size_t maxFrames, int quality)
+{
+    if (inRate <= 0 || outRate <= 0 || channels < 1 || channels > MAX_CHANNELS ||
+        !maxFrames || quality < 0 || quality >= QUALITY_COUNT) {
+        LOGE("Resampler: cannot convert %d to %d Hz, %d channels, quality %d",
+             inRate, outRate, channels, quality);
+        return BAD_VALUE;
+    }
+
+    uint32_t g = gcd(inRate, outRate);
+    uint32_t L = outRate / g;
+    uint32_t M = inRate / g;
+    int taps = tapsFor(quality, inRate, outRate);
+    // one phase per 1/L of a frame, or the nearest of MAX_PHASES + 1 when
+    // L is more, the last being the first a frame on
+    uint32_t phases = L <= MAX_PHASES ? L : MAX_PHASES + 1;
+
+    bool same = mCoefs && L == mL && M == mM && taps == mTaps && quality == mQuality;
+    bool resize = maxFrames != mMaxFrames || taps != mTaps || channels != mChannels;
+    int32_t *coefs = NULL;
+    int16_t *work[MAX_CHANNELS] = { NULL };
+    double *h = NULL;
+    bool failed = false;
+
+    // all of it is allocated before any of it is replaced, a configure
+    // that fails leaves the last one working
+    if (!same) {
+        coefs = (int32_t *)malloc(phases * taps * sizeof(int32_t));
+        h = (double *)malloc(taps * sizeof(double));
+        failed = !coefs || !h;
+    }
+    for (int c = 0; resize && c < channels; c++) {
+        work[c] = (int16_t *)malloc((taps - 1 + maxFrames) * sizeof(int16_t));
+        failed = failed || !work[c];
+    }
+    if (failed) {
+        free(coefs);
+        free(h);
+        for (int c = 0; c < MAX_CHANNELS; c++)
+            free(work[c]);
+        return NO_MEMORY;
+    }
+
+    if (!same) {
+        free(mCoefs);
+        mCoefs = coefs;
+    }
+    if (resize) {
+        for (int c = 0; c < MAX_CHANNELS; c++) {
+            free(mWork[c]);
+            mWork[c] = work[c];
+        }
+    }
+
+    mInRate = inRate;
+    mOutRate = outRate;
+    mChannels = channels;
+    mQuality = quality;
+    mL = L;
+    mM = M;
+    mTaps = taps;
+    mPhases = phases;
+    mMaxFrames = maxFrames;
+
+    if (!same) {
+        // cut off in input cycles per frame, the transition band ending
+        // at the lower Nyquist
+        double A = kQuality[quality].attenuation;
+        double beta = A > 50.0 ? 0.1102 * (A - 8.7) :
+                      0.5842 * pow(A - 21.0, 0.4) + 0.07886 * (A - 21.0);
+        double ratio = outRate < inRate ? (double)outRate / inRate : 1.0;
+        double transition = (A - 7.95) / (14.36 * taps);
+        double cutoff = 0.5 * ratio - transition / 2;
+        if (cutoff < 0.25 * ratio)
+            cutoff = 0.25 * ratio;
+        double half = taps / 2.0;
+        double i0beta = besselI0(beta);
+
+        uint32_t stride = L <= MAX_PHASES ? L : MAX_PHASES;
+        for (uint32_t p = 0; p < phases; p++) {
+            double frac = (double)p / stride;
+            double sum = 0;
+
+            // tap j weighs the frame taps/2 - 1 - j before the output
+            for (int j = 0; j < taps; j++) {
+                double d = frac + half - 1 - j;
+                double x = d / half;
+                double w = x * x < 1.0 ? besselI0(beta * sqrt(1.0 - x * x)) / i0beta : 0.0;
+                double s = d == 0 ? 1.0 : sin(2 * M_PI * cutoff * d) / (2 * M_PI * cutoff * d);
+                h[j] = 2 * cutoff * s * w;
+                sum += h[j];
+            }
+
+            // unity gain at DC for every phase, the rounding put on the
+            // largest tap
+            int32_t *q = mCoefs + p * taps;
+            int32_t total = 0;
+            int peak = 0;
+            for (int j = 0; j < taps; j++) {
+                q[j] = (int32_t)floor(h[j] / sum * (1 << 30) + 0.5);
+                total += q[j];
+                if (abs(q[j]) > abs(q[peak]))
+                    peak = j;
+            }
+            q[peak] += (1 << 30) - total;
+        }
+        free(h);
+    }
+
+    LOGI("Resampler: %d to %d Hz, %d channels, quality %d, %d taps, %u phases",
+         inRate, outRate, channels, quality, taps, phases);
+    reset();
+    return NO_ERROR;
+}
+
+size_t ALSAResampler::outputFrames(size_t frames) const
+{
+    if (!mL)
+        return frames;
+    return (size_t)(((uint64_t)frames * mL + mM - 1) / mM) + 1;
+}
+
+void ALSAResampler::reset()
+{
+    // a filter length of silence, the first output is due once the first
+    // half of it is in
+    mHave = mTaps ? mTaps - 1 : 0;
+    mPhase = 0;
+    for (int c = 0; c < mChannels; c++)
+        if (mWork[c])
+            memset(mWork[c], 0, mHave * sizeof(int16_t));
+}
+
+size_t ALSAResampler::resample(const int16_t *in, size_t frames, int16_t *out,
+                               size_t capacity)
+{
+    size_t written = 0;
+
+    if (!mMaxFrames)
+        return 0;
+
+    while (frames) {
+        size_t n = frames < mMaxFrames ? frames : mMaxFrames;
+
+        for (int c = 0; c < mChannels; c++) {
+            int16_t *dst = mWork[c] + mHave;
+            const int16_t *src = in + c;
+            for (size_t i = 0; i < n; i++, src += mChannels)
+                dst[i] = *src;
+        }
+        mHave += n;
+        in += n * mChannels;
+        frames -= n;
+
+        size_t pos = 0;
+        while (pos + mTaps <= mHave) {
+            if (written < capacity) {
+                uint32_t phase = mPhases == mL ? mPhase :
+                        (uint32_t)(((uint64_t)mPhase * (mPhases - 1) + mL / 2) / mL);
+                const int32_t *h = mCoefs + phase * mTaps;
+                int16_t *dst = out + written * mChannels;
+
+                for (int c = 0; c < mChannels; c++)
+                    dst[c] = dot(mWork[c] + pos, h, mTaps);
+                written++;
+            }
+            mPhase += mM;
+            pos += mPhase / mL;
+            mPhase %= mL;
+        }
+
+        // what the next outputs still need, less than a filter length
+        size_t keep = pos < mHave ? mHave - pos : 0;
+        for (int c = 0; c < mChannels; c++)
+            memmove(mWork[c], mWork[c] + pos, keep * sizeof(int16_t));
+        mHave = keep;
+    }
+    return written;
+}
+
+};        // namespace android
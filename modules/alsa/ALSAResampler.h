@@ -0,0 +1,96 @@
+/* ALSAResampler.h
+ **
+ ** Copyright (C) 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#ifndef ANDROID_ALSA_RESAMPLER_H
+#define ANDROID_ALSA_RESAMPLER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <utils/Errors.h>
+
+namespace android
+{
+
+// Polyphase sample rate conversion of 16 bit interleaved frames, for a
+// PCM granted another rate than its stream's. AudioEngine converts its
+// echo reference with it; the stream transfers of the OMAP modules are in
+// hardware/alsa_sound, so they can only warn about a mismatch. Nothing
+// here needs the Android audio HAL.
+//
+// The rates are taken as the ratio L/M of two integers: each output frame
+// is a Kaiser windowed sinc, cut off below the lower of the two Nyquist
+// frequencies, of taps input frames. Its phases, one per 1/L of an input
+// frame up to MAX_PHASES, are Q30 and the products summed in 64 bits,
+// NEON does 4 of them at a time: Q15 coefficients would put their
+// rounding noise at -80 dB, above what 16 bits carry. The quality sets
+// the taps, the stop band and how close to Nyquist the pass band goes;
+// taps grow with M/L when decimating.
+class ALSAResampler
+{
+public:
+    enum Quality {
+        QUALITY_LOW = 0,        // 16 taps, 50 dB, voice
+        QUALITY_MEDIUM,         // 32 taps, 70 dB
+        QUALITY_HIGH,           // 64 taps, 96 dB, music
+        QUALITY_COUNT
+    };
+
+    enum { MAX_CHANNELS = 2, MAX_PHASES = 1024 };
+
+    ALSAResampler();
+    ~ALSAResampler();
+
+    // Multiply-accumulates per second a quality costs
+    static uint32_t cost(int quality, int inRate, int outRate, int channels);
+    // The best quality within budget multiply-accumulates per second,
+    // QUALITY_LOW when none is
+    static int qualityFor(uint32_t budget, int inRate, int outRate, int channels);
+
+    // maxFrames is the most input frames of one resample()
+    status_t configure(int inRate, int outRate, int channels, size_t maxFrames,
+                       int quality);
+
+    // Output frames out has to have room for, for frames in
+    size_t outputFrames(size_t frames) const;
+
+    // Takes all of in, returns the frames written to out. The output lags
+    // the input by half the taps.
+    size_t resample(const int16_t *in, size_t frames, int16_t *out, size_t capacity);
+
+    void reset();
+
+    int quality() const { return mQuality; }
+    int taps() const { return mTaps; }
+
+private:
+    int         mInRate;
+    int         mOutRate;
+    int         mChannels;
+    int         mQuality;
+    uint32_t    mL;             // output frames per M input frames
+    uint32_t    mM;
+    int         mTaps;          // per phase, a multiple of 8
+    uint32_t    mPhases;
+    int32_t *   mCoefs;         // mPhases x mTaps, Q30
+    int16_t *   mWork[MAX_CHANNELS];    // held input then the new frames
+    size_t      mMaxFrames;
+    size_t      mHave;          // frames in mWork
+    uint32_t    mPhase;         // of the next output, in 1/mL of a frame
+};
+
+};        // namespace android
+#endif    // ANDROID_ALSA_RESAMPLER_H
@@ -0,0 +1,226 @@
+/* ALSARouteGraph.cpp
+ **
+ ** Copyright 2009-2011 Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "ALSARouteGraph"
+#include <utils/Log.h>
+
+#include <string.h>
+
+#include "ALSARouteGraph.h"
+#include "ALSAControlCache.h"
+
+#define NOT_SET     (~0U)
+
+namespace android
+{
+
+static unsigned int length(const RouteSetting *list)
+{
+    unsigned int n = 0;
+    while (list && list[n].control)
+        n++;
+    return n;
+}
+
+ALSARouteGraph::ALSARouteGraph(const RoutePath *paths, size_t count) :
+    mPathCount(count),
+    mEntryCount(0),
+    mSlotCount(0),
+    mPlanCount(0)
+{
+    unsigned int entries = 0;
+
+    for (size_t p = 0; p < count; p++)
+        entries += length(paths[p].on) + length(paths[p].off);
+
+    mPaths = new Path[count];
+    mEntries = new Entry[entries];
+    // never more controls than settings
+    mSlots = new Slot[entries];
+    mPlan = new unsigned int[entries];
+
+    for (size_t p = 0; p < count; p++) {
+        Path &path = mPaths[p];
+        path.path = &paths[p];
+        path.active = path.nextActive = false;
+        add(paths[p].on, path.on, path.onCount);
+        add(paths[p].off, path.off, path.offCount);
+    }
+
+    LOGV("%u paths setting %u controls", (unsigned int)count, mSlotCount);
+}
+
+ALSARouteGraph::~ALSARouteGraph()
+{
+    delete [] mPaths;
+    delete [] mEntries;
+    delete [] mSlots;
+    delete [] mPlan;
+}
+
+unsigned int ALSARouteGraph::slotOf(const char *control)
+{
+    unsigned int s;
+
+    for (s = 0; s < mSlotCount; s++) {
+        if (!strcmp(mSlots[s].control, control))
+            return s;
+    }
+
+    mSlots[s].control = control;
+    mSlots[s].current = mSlots[s].next = NULL;
+    mSlots[s].order = NOT_SET;
+    mSlotCount++;
+    return s;
+}
+
+void ALSARouteGraph::add(const RouteSetting *list, unsigned int &first, unsigned int &count)
+{
+    first = mEntryCount;
+    count = length(list);
+    for (unsigned int i = 0; i < count; i++) {
+        mEntries[mEntryCount].setting = &list[i];
+        mEntries[mEntryCount].slot = slotOf(list[i].control);
+        mEntryCount++;
+    }
+}
+
+// Settings of two paths setting a control alike are the same
+bool ALSARouteGraph::same(const RouteSetting *a, const RouteSetting *b)
+{
+    if (a == b) return true;
+    if (!a || !b || a->index != b->index) return false;
+    if (a->item || b->item)
+        return a->item && b->item && !strcmp(a->item, b->item);
+    return a->value == b->value;
+}
+
+size_t ALSARouteGraph::select(uint32_t devices, uint32_t flags)
+{
+    unsigned int order = 0;
+    size_t changed = 0;
+
+    for (unsigned int s = 0; s < mSlotCount; s++) {
+        mSlots[s].next = mSlots[s].current;
+        mSlots[s].order = NOT_SET;
+    }
+
+    for (size_t p = 0; p < mPathCount; p++) {
+        Path &path = mPaths[p];
+        const RoutePath &rp = *path.path;
+
+        path.nextActive = path.active;
+        if (!(devices & rp.scope))
+            continue;
+
+        path.nextActive = (devices & rp.devices) && !(devices & rp.exclude) &&
+                          (flags & rp.flags) == rp.flags;
+
+        unsigned int first = path.nextActive ? path.on : path.off;
+        unsigned int count = path.nextActive ? path.onCount : path.offCount;
+        for (unsigned int e = first; e < first + count; e++) {
+            Slot &slot = mSlots[mEntries[e].slot];
+            slot.next = mEntries[e].setting;
+            slot.order = order++;
+        }
+    }
+
+    // the plan is in the order the route leaves each control, as the
+    // routing code it replaces wrote them last
+    mPlanCount = 0;
+    for (unsigned int s = 0; s < mSlotCount; s++) {
+        if (mSlots[s].order == NOT_SET)
+            continue;
+
+        unsigned int i = mPlanCount++;
+        while (i > 0 && mSlots[mPlan[i - 1]].order > mSlots[s].order) {
+            mPlan[i] = mPlan[i - 1];
+            i--;
+        }
+        mPlan[i] = s;
+
+        if (!same(mSlots[s].current, mSlots[s].next))
+            changed++;
+    }
+
+    LOGV("route %08x flags %x sets %u controls, changes %u", devices, flags,
+            mPlanCount, (unsigned int)changed);
+    return changed;
+}
+
+size_t ALSARouteGraph::changes(const RouteSetting **list, size_t size) const
+{
+    size_t n = 0;
+
+    for (unsigned int i = 0; i < mPlanCount; i++) {
+        const Slot &slot = mSlots[mPlan[i]];
+        if (same(slot.current, slot.next))
+            continue;
+        if (n < size)
+            list[n] = slot.next;
+        n++;
+    }
+    return n;
+}
+
+status_t ALSARouteGraph::stage(ALSAControlCache &mixer) const
+{
+    for (unsigned int i = 0; i < mPlanCount; i++) {
+        const RouteSetting *setting = mSlots[mPlan[i]].next;
+        status_t err;
+
+        if (setting->item)
+            err = mixer.set(setting->control, setting->item);
+        else
+            err = mixer.set(setting->control, setting->value, setting->index);
+
+        if (err != NO_ERROR) {
+            LOGE("Route not set, '%s' refused", setting->control);
+            mixer.discard();
+            return err;
+        }
+    }
+    return NO_ERROR;
+}
+
+void ALSARouteGraph::commit()
+{
+    for (unsigned int s = 0; s < mSlotCount; s++)
+        mSlots[s].current = mSlots[s].next;
+    for (size_t p = 0; p < mPathCount; p++)
+        mPaths[p].active = mPaths[p].nextActive;
+}
+
+bool ALSARouteGraph::isOn(const char *path) const
+{
+    for (size_t p = 0; p < mPathCount; p++) {
+        if (!strcmp(mPaths[p].path->name, path))
+            return mPaths[p].nextActive;
+    }
+    return false;
+}
+
+const RouteSetting *ALSARouteGraph::current(const char *control) const
+{
+    for (unsigned int s = 0; s < mSlotCount; s++) {
+        if (!strcmp(mSlots[s].control, control))
+            return mSlots[s].current;
+    }
+    return NULL;
+}
+
+}
@@ -0,0 +1,131 @@
+/* ALSARouteGraph.h
+ **
+ ** Copyright (C) 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#ifndef ANDROID_ALSA_ROUTE_GRAPH
+#define ANDROID_ALSA_ROUTE_GRAPH
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <utils/Errors.h>
+
+namespace android
+{
+
+class ALSAControlCache;
+
+// A value a path gives a mixer control, a NULL control ends a list
+struct RouteSetting {
+    const char *    control;
+    const char *    item;       // of an enumeration, NULL for a value
+    unsigned int    value;
+    int             index;      // -1 for all the values of the control
+};
+
+// A path is on when the route has one of its devices, none of the devices
+// it excludes and all of its flags; it then sets its on list, its off list
+// otherwise. A route only changes the paths of its scope, the outputs or
+// the inputs, those of the other side are left as they are.
+struct RoutePath {
+    const char *            name;
+    uint32_t                scope;
+    uint32_t                devices;
+    uint32_t                exclude;
+    uint32_t                flags;
+    const RouteSetting *    on;
+    const RouteSetting *    off;
+};
+
+// The routes of a board as a table of paths instead of code. Paths are
+// in priority order: the last one to set a control wins, so a path can
+// refine an earlier one (FM on top of the speaker) and a route resolves
+// to one value per control whatever the number of paths setting it.
+//
+// select() resolves a route against the current one without touching
+// the card, which makes the transitions of a table checkable on a host.
+// stage() hands the whole route to an ALSAControlCache, which writes only
+// the controls the card doesn't already have: a control another writer
+// (the modem) changed is set back even when the route didn't change it.
+//
+// Not thread safe, the HAL serializes routing.
+class ALSARouteGraph
+{
+public:
+    ALSARouteGraph(const RoutePath *paths, size_t count);
+    ~ALSARouteGraph();
+
+    // Resolves the route of devices with flags, returns the number of
+    // controls it changes from the current route
+    size_t select(uint32_t devices, uint32_t flags);
+
+    // The settings of the selected route that change a control, in the
+    // order the route sets them
+    size_t changes(const RouteSetting **list, size_t size) const;
+
+    // Stages every control of the selected route, all or none: on error
+    // nothing the mixer had staged is left
+    status_t stage(ALSAControlCache &mixer) const;
+
+    // Makes the selected route the current one
+    void commit();
+
+    // The path is on in the selected route
+    bool isOn(const char *path) const;
+
+    // What the current route set a control to, NULL if no route did yet
+    const RouteSetting *current(const char *control) const;
+
+    size_t controls() const { return mSlotCount; }
+
+private:
+    struct Slot {
+        const char *            control;
+        const RouteSetting *    current;
+        const RouteSetting *    next;
+        unsigned int            order;      // of next in the route, ~0 if not set
+    };
+
+    struct Entry {
+        const RouteSetting *    setting;
+        unsigned int            slot;
+    };
+
+    struct Path {
+        const RoutePath *       path;
+        unsigned int            on;         // first entry
+        unsigned int            onCount;
+        unsigned int            off;
+        unsigned int            offCount;
+        bool                    active;
+        bool                    nextActive;
+    };
+
+    static bool same(const RouteSetting *a, const RouteSetting *b);
+    unsigned int slotOf(const char *control);
+    void add(const RouteSetting *list, unsigned int &first, unsigned int &count);
+
+    Path *          mPaths;
+    size_t          mPathCount;
+    Entry *         mEntries;
+    unsigned int    mEntryCount;
+    Slot *          mSlots;
+    unsigned int    mSlotCount;
+    unsigned int *  mPlan;          // slots the selected route sets, in order
+    unsigned int    mPlanCount;
+};
+
+}
+#endif    // ANDROID_ALSA_ROUTE_GRAPH
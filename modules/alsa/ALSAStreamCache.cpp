@@ -0,0 +1,269 @@
+/* ALSAStreamCache.cpp
+ **
+ ** Copyright 2009-2011 Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "ALSAStreamCache"
+#include <utils/Log.h>
+
+#include <string.h>
+
+#include "ALSAStreamCache.h"
+
+namespace android
+{
+
+ALSAStreamCache::ALSAStreamCache(nsecs_t hold) :
+    Thread(false),
+    mHold(hold),
+    mCount(0)
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+ALSAStreamCache::~ALSAStreamCache()
+{
+    requestExit();
+    mLock.lock();
+    mCond.signal();
+    mLock.unlock();
+    requestExitAndWait();
+
+    // the streams still own the PCMs that aren't parked
+    flush();
+}
+
+void ALSAStreamCache::setHold(nsecs_t hold)
+{
+    Mutex::Autolock lock(mLock);
+    mHold = hold;
+    mCond.signal();
+}
+
+bool ALSAStreamCache::same(const Config &a, const Config &b)
+{
+    return !strcmp(a.device, b.device) && a.stream == b.stream &&
+           a.format == b.format && a.channels == b.channels && a.rate == b.rate &&
+           a.mmap == b.mmap && a.latency == b.latency && a.devices == b.devices;
+}
+
+ssize_t ALSAStreamCache::indexOf(snd_pcm_t *pcm) const
+{
+    for (size_t i = 0; i < mCount; i++)
+        if (mEntries[i].pcm == pcm)
+            return i;
+    return -1;
+}
+
+// closes a parked PCM, only forgets one a stream has
+void ALSAStreamCache::removeLocked(size_t index)
+{
+    if (mEntries[index].parked)
+        snd_pcm_close(mEntries[index].pcm);
+    mEntries[index] = mEntries[--mCount];
+}
+
+status_t ALSAStreamCache::add(snd_pcm_t *pcm, const Config &config, const Granted &granted)
+{
+    Mutex::Autolock lock(mLock);
+    ssize_t index = indexOf(pcm);
+
+    if (index < 0) {
+        // make room at the expense of the parked PCM closest to expiring
+        if (mCount == MAX_PCMS) {
+            ssize_t oldest = -1;
+            for (size_t i = 0; i < mCount; i++)
+                if (mEntries[i].parked &&
+                    (oldest < 0 || mEntries[i].expires < mEntries[oldest].expires))
+                    oldest = i;
+            if (oldest < 0)
+                return NO_MEMORY;
+            removeLocked(oldest);
+            mStats.evicted++;
+        }
+        index = mCount++;
+    }
+
+    Entry &entry = mEntries[index];
+    entry.pcm = pcm;
+    entry.config = config;
+    entry.granted = granted;
+    entry.parked = false;
+    entry.expires = 0;
+    return NO_ERROR;
+}
+
+status_t ALSAStreamCache::park(snd_pcm_t *pcm)
+{
+    mLock.lock();
+    ssize_t index = indexOf(pcm);
+    if (index < 0 || mHold <= 0) {
+        if (index >= 0)
+            removeLocked(index);
+        mLock.unlock();
+        return close(pcm);
+    }
+    mLock.unlock();
+
+    // not parked yet, nothing else touches it while it drains
+    int err = snd_pcm_drain(pcm);
+    if (err < 0)
+        err = snd_pcm_drop(pcm);
+
+    mLock.lock();
+    index = indexOf(pcm);
+    if (err < 0 || index < 0) {
+        LOGW("PCM %p won't stop, closed: %s", pcm, snd_strerror(err));
+        if (index >= 0)
+            removeLocked(index);
+        mLock.unlock();
+        snd_pcm_close(pcm);
+        return err < 0 ? err : NO_ERROR;
+    }
+    mEntries[index].parked = true;
+    mEntries[index].expires = systemTime() + mHold;
+    mStats.parked++;
+    LOGV("Parked %s %s", mEntries[index].config.device,
+         snd_pcm_stream_name(mEntries[index].config.stream));
+    mCond.signal();
+    mLock.unlock();
+    return NO_ERROR;
+}
+
+snd_pcm_t *ALSAStreamCache::resume(const Config &config, Granted &granted)
+{
+    snd_pcm_t *pcm = NULL;
+
+    mLock.lock();
+    for (size_t i = 0; i < mCount; i++) {
+        if (mEntries[i].parked && same(mEntries[i].config, config)) {
+            mEntries[i].parked = false;
+            pcm = mEntries[i].pcm;
+            granted = mEntries[i].granted;
+            break;
+        }
+    }
+    if (!pcm) {
+        // the device is wanted in another configuration
+        for (size_t i = 0; i < mCount; ) {
+            if (mEntries[i].parked && mEntries[i].config.stream == config.stream &&
+                !strcmp(mEntries[i].config.device, config.device)) {
+                removeLocked(i);
+                mStats.evicted++;
+            } else {
+                i++;
+            }
+        }
+        mStats.missed++;
+    }
+    mLock.unlock();
+
+    if (!pcm)
+        return NULL;
+
+    int err = snd_pcm_prepare(pcm);
+    Mutex::Autolock lock(mLock);
+    if (err < 0) {
+        LOGW("Parked %s won't prepare: %s", config.device, snd_strerror(err));
+        ssize_t index = indexOf(pcm);
+        if (index >= 0)
+            removeLocked(index);
+        snd_pcm_close(pcm);
+        mStats.missed++;
+        return NULL;
+    }
+    mStats.resumed++;
+    return pcm;
+}
+
+status_t ALSAStreamCache::close(snd_pcm_t *pcm)
+{
+    mLock.lock();
+    ssize_t index = indexOf(pcm);
+    bool parked = index >= 0 && mEntries[index].parked;
+    if (index >= 0) {
+        mEntries[index].parked = false;
+        removeLocked(index);
+    }
+    mLock.unlock();
+
+    if (!parked)
+        snd_pcm_drain(pcm);
+    int err = snd_pcm_close(pcm);
+    LOGV("snd_pcm_close(%p): %s", pcm, err < 0 ? snd_strerror(err) : "no error");
+    return err;
+}
+
+void ALSAStreamCache::flush()
+{
+    Mutex::Autolock lock(mLock);
+
+    for (size_t i = 0; i < mCount; ) {
+        if (mEntries[i].parked)
+            removeLocked(i);
+        else
+            i++;
+    }
+}
+
+size_t ALSAStreamCache::parkedCount() const
+{
+    Mutex::Autolock lock(mLock);
+    size_t parked = 0;
+
+    for (size_t i = 0; i < mCount; i++)
+        if (mEntries[i].parked)
+            parked++;
+    return parked;
+}
+
+ALSAStreamCache::Stats ALSAStreamCache::stats() const
+{
+    Mutex::Autolock lock(mLock);
+    return mStats;
+}
+
+bool ALSAStreamCache::threadLoop()
+{
+    Mutex::Autolock lock(mLock);
+
+    if (exitPending())
+        return false;
+
+    // a hold of 0 closes them all
+    nsecs_t now = systemTime();
+    nsecs_t next = 0;
+    for (size_t i = 0; i < mCount; ) {
+        Entry &entry = mEntries[i];
+        if (entry.parked && (entry.expires <= now || mHold <= 0)) {
+            LOGV("Hold of %s %s over", entry.config.device,
+                 snd_pcm_stream_name(entry.config.stream));
+            removeLocked(i);
+            mStats.expired++;
+            continue;
+        }
+        if (entry.parked && (!next || entry.expires < next))
+            next = entry.expires;
+        i++;
+    }
+
+    if (next)
+        mCond.waitRelative(mLock, next - now);
+    else
+        mCond.wait(mLock);
+    return !exitPending();
+}
+
+};        // namespace android
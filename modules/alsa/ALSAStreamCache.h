@@ -0,0 +1,125 @@
+/* ALSAStreamCache.h
+ **
+ ** Copyright (C) 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#ifndef ANDROID_ALSA_STREAM_CACHE_H
+#define ANDROID_ALSA_STREAM_CACHE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <alsa/asoundlib.h>
+#include <utils/threads.h>
+#include <utils/Timers.h>
+
+namespace android
+{
+
+// The PCMs of the streams, kept open across standby. A PCM is added with
+// the configuration it was opened for and the buffer the hardware granted
+// it. A stream going to standby parks its PCM drained instead of closing
+// it; opening the same configuration again resumes it with a
+// snd_pcm_prepare, the open and the hw/sw parameters skipped.
+//
+// A parked PCM keeps its path powered: the thread closes the ones not
+// resumed within the hold time, and a resume that misses closes those
+// parked on the same device and direction, which would keep it busy.
+class ALSAStreamCache : public Thread
+{
+public:
+    enum {
+        MAX_PCMS        = 8,
+        DEFAULT_HOLD    = 3000,     // ms
+    };
+
+    // What the hw and sw parameters of a PCM were set from
+    struct Config {
+        char                device[32];
+        snd_pcm_stream_t    stream;
+        snd_pcm_format_t    format;
+        unsigned int        channels;
+        unsigned int        rate;
+        bool                mmap;
+        int                 latency;    // us asked for
+        uint32_t            devices;    // of the stream, they pick the thresholds
+    };
+
+    // What the hardware granted
+    struct Granted {
+        snd_pcm_uframes_t   bufferSize;
+        unsigned int        latency;    // us
+    };
+
+    struct Stats {
+        unsigned int    parked;
+        unsigned int    resumed;
+        unsigned int    missed;         // resumes that found no PCM
+        unsigned int    expired;        // closed at the end of the hold
+        unsigned int    evicted;        // closed for a resume or a full cache
+    };
+
+    ALSAStreamCache(nsecs_t hold = milliseconds(DEFAULT_HOLD));
+    virtual ~ALSAStreamCache();
+
+    // 0 closes PCMs on standby as they were
+    void setHold(nsecs_t hold);
+
+    // Records an open PCM, set up for config
+    status_t add(snd_pcm_t *pcm, const Config &config, const Granted &granted);
+
+    // Drains the PCM and keeps it for the hold time. One that wasn't
+    // added, or won't drain, is closed.
+    status_t park(snd_pcm_t *pcm);
+
+    // The parked PCM of config, prepared, NULL when there is none
+    snd_pcm_t *resume(const Config &config, Granted &granted);
+
+    // Drains and closes the PCM, whether it was added or not
+    status_t close(snd_pcm_t *pcm);
+
+    // Closes the parked PCMs
+    void flush();
+
+    size_t parkedCount() const;
+    Stats stats() const;
+
+private:
+    ALSAStreamCache(const ALSAStreamCache &);
+    ALSAStreamCache& operator = (const ALSAStreamCache &);
+
+    struct Entry {
+        snd_pcm_t * pcm;
+        Config      config;
+        Granted     granted;
+        bool        parked;
+        nsecs_t     expires;
+    };
+
+    virtual bool threadLoop();
+
+    ssize_t indexOf(snd_pcm_t *pcm) const;
+    void removeLocked(size_t index);
+    static bool same(const Config &a, const Config &b);
+
+    mutable Mutex   mLock;
+    Condition       mCond;
+    nsecs_t         mHold;
+    Entry           mEntries[MAX_PCMS];
+    size_t          mCount;
+    Stats           mStats;
+};
+
+};        // namespace android
+#endif    // ANDROID_ALSA_STREAM_CACHE_H
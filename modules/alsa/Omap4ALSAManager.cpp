@@ -19,42 +19,12 @@
 #define LOG_TAG "Omap4ALSAManager"
 #include <utils/Log.h>
 
+#include <string.h>
+
 #include "Omap4ALSAManager.h"
 
 namespace android {
 
-const char *Omap4ALSAManager::MAIN_MIC = "omap.audio.mic.main";
-const char *Omap4ALSAManager::SUB_MIC = "omap.audio.mic.sub";
-const char *Omap4ALSAManager::POWER_MODE = "omap.audio.power";
-
-// Voice record during voice call voice uplink gain
-// value: -120dB..29dB step 1dB (-120 is mute)
-const char *Omap4ALSAManager::VOICEMEMO_VUL_GAIN =
-                                "omap.audio.voicerecord.vul.gain";
-// Voice record during voice call voice downling gain
-// value: -120dB..29dB step 1dB (-120 is mute)
-const char *Omap4ALSAManager::VOICEMEMO_VDL_GAIN =
-                                "omap.audio.voicerecord.vdl.gain";
-// Voice record during voice call multimedia gain
-// value: -120dB..29dB step 1dB (-120 is mute)
-const char *Omap4ALSAManager::VOICEMEMO_MM_GAIN =
-                                "omap.audio.voicerecord.mm.gain";
-// Voice record during voice call tone gain
-// value: -120dB..29dB step 1dB (-120 is mute)
-const char *Omap4ALSAManager::VOICEMEMO_TONE_GAIN =
-                                "omap.audio.voicerecord.tone.gain";
-const char *Omap4ALSAManager::DL2L_EQ_PROFILE = "omap.audio.dl2l.eq";
-const char *Omap4ALSAManager::DL2R_EQ_PROFILE = "omap.audio.dl2r.eq";
-const char *Omap4ALSAManager::DL1_EQ_PROFILE = "omap.audio.dl1.eq";
-const char *Omap4ALSAManager::AMIC_EQ_PROFILE = "omap.audio.amic.eq";
-const char *Omap4ALSAManager::DMIC_EQ_PROFILE = "omap.audio.dmic.eq";
-const char *Omap4ALSAManager::SDT_EQ_PROFILE = "omap.audio.sdt.eq";
-
-const char *Omap4ALSAManager::DL1_EAR_MONO_MIXER = "omap.audio.ear.DL1monomixer";
-const char *Omap4ALSAManager::DL1_HEAD_MONO_MIXER = "omap.audio.head.DL1monomixer";
-const char *Omap4ALSAManager::DL2_SPEAK_MONO_MIXER = "omap.audio.speak.DL2monomixer";
-const char *Omap4ALSAManager::DL2_AUX_MONO_MIXER = "omap.audio.aux.DL2monomixer";
-
 const char  *Omap4ALSAManager::MicNameList[]= {
     "AMic0",  // for Analog Main mic
     "AMic1",  //  for Analog Sub mic
@@ -81,191 +51,185 @@ const char  *Omap4ALSAManager::EqualizerProfileList[] = {
     "eof"
 };
 
-status_t Omap4ALSAManager::set(const String8& key, const String8& value)
+// First and last item of a list a parameter takes
+#define ITEMS(list, first)  (list), (first), (int)(sizeof(list) / sizeof((list)[0])) - 2
+
+struct ParamInfo {
+    const char              *key;
+    const char * const      *items;     // NULL for an integer
+    int                     min;        // first item or lowest integer
+    int                     max;
+    int                     differs;    // parameter it can't equal, or PARAM_COUNT
+};
+
+typedef Omap4ALSAManager M;
+
+static const ParamInfo params[] = {
+    { "omap.audio.mic.main", ITEMS(M::MicNameList, 0), M::SUB_MIC },
+    { "omap.audio.mic.sub", ITEMS(M::MicNameList, 0), M::MAIN_MIC },
+    { "omap.audio.power", ITEMS(M::PowerModeList, 0), M::PARAM_COUNT },
+    { "omap.audio.dl2l.eq", ITEMS(M::EqualizerProfileList, 0), M::PARAM_COUNT },
+    { "omap.audio.dl2r.eq", ITEMS(M::EqualizerProfileList, 0), M::PARAM_COUNT },
+    { "omap.audio.dl1.eq", ITEMS(M::EqualizerProfileList, 0), M::PARAM_COUNT },
+    // "Flat response" is not supported by DMIC/AMIC
+    { "omap.audio.amic.eq", ITEMS(M::EqualizerProfileList, 1), M::PARAM_COUNT },
+    { "omap.audio.dmic.eq", ITEMS(M::EqualizerProfileList, 1), M::PARAM_COUNT },
+    { "omap.audio.sdt.eq", ITEMS(M::EqualizerProfileList, 0), M::PARAM_COUNT },
+    // Voice record during voice call voice uplink, voice downlink,
+    // multimedia and tone gains
+    // value: -120dB..29dB step 1dB (-120 is mute)
+    { "omap.audio.voicerecord.vul.gain", NULL, -120, 29, M::PARAM_COUNT },
+    { "omap.audio.voicerecord.vdl.gain", NULL, -120, 29, M::PARAM_COUNT },
+    { "omap.audio.voicerecord.mm.gain", NULL, -120, 29, M::PARAM_COUNT },
+    { "omap.audio.voicerecord.tone.gain", NULL, -120, 29, M::PARAM_COUNT },
+    // DL1 and DL2 Mono Mixer switches
+    { "omap.audio.ear.DL1monomixer", NULL, 0, 1, M::PARAM_COUNT },
+    { "omap.audio.head.DL1monomixer", NULL, 0, 1, M::PARAM_COUNT },
+    { "omap.audio.speak.DL2monomixer", NULL, 0, 1, M::PARAM_COUNT },
+    { "omap.audio.aux.DL2monomixer", NULL, 0, 1, M::PARAM_COUNT },
+};
+
+// one entry per parameter
+typedef char paramTableSize[sizeof(params) / sizeof(params[0]) == M::PARAM_COUNT ? 1 : -1];
+
+Omap4ALSAManager::Omap4ALSAManager()
 {
-    String8 temp = value;
-    if (validateValueForKey(key, temp) == NO_ERROR) {
-        LOGV("set by Value:: %s::%s", key.string(), value.string());
-        if (mParams.indexOfKey(key) < 0) {
-            mParams.add(key, value);
-            return NO_ERROR;
-        } else {
-            mParams.replaceValueFor(key, value);
-            return ALREADY_EXISTS;
-        }
-    }
-    return BAD_VALUE;
+    for (int i = 0; i < PARAM_COUNT; i++)
+        mValues[i] = NOT_SET;
 }
 
-status_t Omap4ALSAManager::setFromProperty(const String8& key) {
-    status_t status = NO_ERROR;
-    char value[PROPERTY_VALUE_MAX];
+Omap4ALSAManager::~Omap4ALSAManager()
+{
+}
 
-    if (property_get(key.string(), value, ""))
-    {
-        LOGV("setFromProperty:: %s::%s", key.string(), value);
-        String8 temp = String8(value);
-        if (validateValueForKey(key, temp) == NO_ERROR) {
-            mParams.add(key, (String8)value);
-            return NO_ERROR;
-        }
-    }
-    return BAD_VALUE;
+status_t Omap4ALSAManager::get(Param param, int& value) const
+{
+    int v = get(param);
+
+    if (v == NOT_SET)
+        return BAD_VALUE;
+    value = v;
+    return NO_ERROR;
+}
+
+status_t Omap4ALSAManager::get(Param param, const char*& value) const
+{
+    int v = get(param);
+
+    if (v == NOT_SET || !params[param].items)
+        return BAD_VALUE;
+    value = params[param].items[v];
+    return NO_ERROR;
+}
+
+status_t Omap4ALSAManager::set(Param param, int value)
+{
+    Mutex::Autolock lock(mLock);
+
+    if (validateValue(param, value) != NO_ERROR)
+        return BAD_VALUE;
+
+    LOGV("set %s::%d", params[param].key, value);
+    int32_t old = mValues[param];
+    android_atomic_release_store(value, &mValues[param]);
+    return old == NOT_SET ? NO_ERROR : ALREADY_EXISTS;
+}
+
+status_t Omap4ALSAManager::set(Param param, const char *value)
+{
+    int parsed;
+
+    if (parse(param, value, parsed) != NO_ERROR)
+        return BAD_VALUE;
+    return set(param, parsed);
 }
 
-status_t Omap4ALSAManager::setFromProperty(const String8& key, const String8& init) {
-    status_t status = NO_ERROR;
+status_t Omap4ALSAManager::setFromProperty(Param param, const char *init)
+{
     char value[PROPERTY_VALUE_MAX];
 
-    if (property_get(key.string(), value, init.string()))
-    {
-        LOGV("setFromProperty:: %s::%s", key.string(), value);
-        String8 temp = String8(value);
-        if (validateValueForKey(key, temp) == NO_ERROR) {
-            mParams.add(key, (String8)value);
+    if (property_get(params[param].key, value, init)) {
+        LOGV("setFromProperty:: %s::%s", params[param].key, value);
+        if (set(param, value) != BAD_VALUE)
             return NO_ERROR;
-        }
     }
     return BAD_VALUE;
 }
 
-status_t Omap4ALSAManager::get(const String8& key, String8& value)
+status_t Omap4ALSAManager::remove(Param param)
 {
-    if (mParams.indexOfKey(key) >= 0) {
-        value = mParams.valueFor(key);
-        return NO_ERROR;
-    } else {
+    Mutex::Autolock lock(mLock);
+
+    if (mValues[param] == NOT_SET)
         return BAD_VALUE;
-    }
+    android_atomic_release_store(NOT_SET, &mValues[param]);
+    return NO_ERROR;
 }
 
-status_t Omap4ALSAManager::get(const String8& key, int& value)
+void Omap4ALSAManager::clear()
 {
-    String8 stringValue;
-    if (mParams.indexOfKey(key) >= 0) {
-        stringValue = mParams.valueFor(key);
-        value = atoi((const char *)stringValue);
-        return NO_ERROR;
-    } else {
-        return BAD_VALUE;
-    }
+    Mutex::Autolock lock(mLock);
+
+    for (int i = 0; i < PARAM_COUNT; i++)
+        android_atomic_release_store(NOT_SET, &mValues[i]);
 }
 
+status_t Omap4ALSAManager::validateValue(Param param, int value) const
+{
+    if (param < 0 || param >= PARAM_COUNT)
+        return BAD_VALUE;
+
+    const ParamInfo &info = params[param];
+    if (value < info.min || value > info.max)
+        return BAD_VALUE;
+    // don't allow same mic for main and sub
+    if (info.differs != PARAM_COUNT && get((Param)info.differs) == value)
+        return BAD_VALUE;
+    return NO_ERROR;
+}
 
-status_t Omap4ALSAManager::validateValueForKey(const String8& key, String8& value)
+status_t Omap4ALSAManager::parse(Param param, const char *value, int& parsed) const
 {
-    int noMatch = 1;
-    int i = 0;
-    int gain;
-
-    if (key == (String8)MAIN_MIC) {
-        LOGV("validate main mic");
-
-        if ((mParams.indexOfKey((String8)SUB_MIC) >= 0) &&
-           (value == mParams.valueFor((String8)SUB_MIC))) {
-            // don't allow same mic for main and sub
-            return BAD_VALUE;
-        } else {
-            while (noMatch && strcmp(MicNameList[i], "eof")) {
-                noMatch = strcmp(MicNameList[i], value.string());
-                if (noMatch) i++;
-                else break;
-            }
-            if(noMatch)
-                return BAD_VALUE;
-            else
+    const ParamInfo &info = params[param];
+
+    if (!value)
+        return BAD_VALUE;
+
+    if (info.items) {
+        for (int i = info.min; i <= info.max; i++) {
+            if (!strcmp(info.items[i], value)) {
+                parsed = i;
                 return NO_ERROR;
-        }
-    }
-    else if (key == (String8)SUB_MIC) {
-        LOGV("validate SUB mic");
-        if ((mParams.indexOfKey((String8)MAIN_MIC) >= 0) &&
-           (value == mParams.valueFor((String8)MAIN_MIC))) {
-            // don't allow same mic for main and sub
-            return BAD_VALUE;
-        } else {
-            while (noMatch && strcmp(MicNameList[i], "eof")) {
-                noMatch = strcmp(MicNameList[i], value.string());
-                if (noMatch) i++;
-                else break;
             }
-            if(noMatch)
-                return BAD_VALUE;
-            else
-                return NO_ERROR;
         }
+        return BAD_VALUE;
     }
-    else if (key == (String8)POWER_MODE) {
-        LOGV("validate power mode");
-        while (noMatch && strcmp(PowerModeList[i], "eof")) {
-                noMatch = strcmp(PowerModeList[i], value.string());
-                if (noMatch) i++;
-                else break;
-            }
-            if(noMatch)
-                return BAD_VALUE;
-            else
-                return NO_ERROR;
-    }
-    else if ((key == (String8)DL2L_EQ_PROFILE) ||
-             (key == (String8)DL2R_EQ_PROFILE) ||
-             (key == (String8)DL1_EQ_PROFILE) ||
-             (key == (String8)SDT_EQ_PROFILE)) {
-        LOGV("validate equalizer profile");
-        while (noMatch && strcmp(EqualizerProfileList[i], "eof")) {
-                noMatch = strcmp(EqualizerProfileList[i], value.string());
-                if (noMatch) i++;
-                else break;
-            }
-            if(noMatch)
-                return BAD_VALUE;
-            else
-                return NO_ERROR;
-    }
-    else if ((key == (String8)AMIC_EQ_PROFILE) ||
-             (key == (String8)DMIC_EQ_PROFILE)) {
-        LOGV("validate DMIC/AMIC equalizer profile");
-        i++; // "Flat response" is not supported by DMIC/AMIC
-        while (noMatch && strcmp(EqualizerProfileList[i], "eof")) {
-                noMatch = strcmp(EqualizerProfileList[i], value.string());
-                if (noMatch) i++;
-                else break;
-            }
-            if(noMatch)
-                return BAD_VALUE;
-            else
-                return NO_ERROR;
-    }
-    else if ((key == (String8)VOICEMEMO_VUL_GAIN) ||
-             (key == (String8)VOICEMEMO_VDL_GAIN) ||
-             (key == (String8)VOICEMEMO_MM_GAIN) ||
-             (key == (String8)VOICEMEMO_TONE_GAIN)) {
-        LOGV("validate Voice Memo gains");
-        gain = atoi((const char *)value);
-        if ((-120 <= gain) && (gain <= 29))
-            return NO_ERROR;
-        else
-            return BAD_VALUE;
-    }
-    else {
-        // @TODO: add constraints as required
-        return NO_ERROR;
-    }
+
+    char *end;
+    long v = strtol(value, &end, 10);
+    if (end == value || v < info.min || v > info.max)
+        return BAD_VALUE;
+    parsed = (int)v;
+    return NO_ERROR;
 }
 
-status_t Omap4ALSAManager::remove(const String8& key)
+Omap4ALSAManager::Param Omap4ALSAManager::find(const char *key)
 {
-    if (mParams.indexOfKey(key) >= 0) {
-        mParams.removeItem(key);
-        return NO_ERROR;
-    } else {
-        return BAD_VALUE;
+    for (int i = 0; i < PARAM_COUNT; i++) {
+        if (!strcmp(params[i].key, key))
+            return (Param)i;
     }
+    return PARAM_COUNT;
 }
 
-Omap4ALSAManager::~Omap4ALSAManager()
+const char *Omap4ALSAManager::keyOf(Param param)
+{
+    return params[param].key;
+}
+
+const char * const *Omap4ALSAManager::itemsOf(Param param)
 {
-    mParams.clear();
+    return params[param].items;
 }
 
 }; //namespace Android
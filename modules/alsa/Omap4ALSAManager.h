@@ -15,61 +15,99 @@
  ** limitations under the License.
  */
 
-#include <utils/String8.h>
-#include <utils/KeyedVector.h>
-#include <cutils/properties.h>
+#ifndef ANDROID_OMAP4_ALSA_MANAGER_H
+#define ANDROID_OMAP4_ALSA_MANAGER_H
+
+#include <stdint.h>
 #include <stdlib.h>
+#include <cutils/atomic.h>
+#include <cutils/properties.h>
+#include <utils/Errors.h>
+#include <utils/threads.h>
 
 namespace android
 {
 
-class String8;
-
+// The tunable parameters of the OMAP4 HAL, "omap.audio.*" as properties
+// and AudioParameter keys.
+//
+// The parameters are a table fixed at build time, addressed by the ids
+// below. A value is kept preparsed in one word: the index of an item of
+// its list, or an integer checked against its range, so the routing and
+// voice call paths read them without a lookup, a string or a lock.
+// Writers are serialized, readers get the last value stored.
 class Omap4ALSAManager
 {
     public:
-        Omap4ALSAManager() {}
+        // in the order of the table in Omap4ALSAManager.cpp
+        enum Param {
+            MAIN_MIC,
+            SUB_MIC,
+            POWER_MODE,
+            DL2L_EQ_PROFILE,
+            DL2R_EQ_PROFILE,
+            DL1_EQ_PROFILE,
+            AMIC_EQ_PROFILE,
+            DMIC_EQ_PROFILE,
+            SDT_EQ_PROFILE,
+            VOICEMEMO_VUL_GAIN,
+            VOICEMEMO_VDL_GAIN,
+            VOICEMEMO_MM_GAIN,
+            VOICEMEMO_TONE_GAIN,
+            DL1_EAR_MONO_MIXER,
+            DL1_HEAD_MONO_MIXER,
+            DL2_SPEAK_MONO_MIXER,
+            DL2_AUX_MONO_MIXER,
+            PARAM_COUNT
+        };
+
+        // value of a parameter never set
+        enum { NOT_SET = -0x7fffffff - 1 };
+
+        Omap4ALSAManager();
         virtual ~Omap4ALSAManager();
 
-        status_t remove(const String8& key);
-        status_t get(const String8& key, String8& value);
-        status_t get(const String8& key, int& value);
-
-        status_t set(const String8& key, const String8& value);
-        status_t setFromProperty(const String8& key);
-        status_t setFromProperty(const String8& key, const String8& init);
-
-        status_t validateValueForKey(const String8& key, String8& value);
-
-        // the keys
-        static const char* MAIN_MIC;
-        static const char* SUB_MIC;
-        static const char* POWER_MODE;
-        static const char* DL2L_EQ_PROFILE;
-        static const char* DL2R_EQ_PROFILE;
-        static const char* DL1_EQ_PROFILE;
-        static const char* AMIC_EQ_PROFILE;
-        static const char* DMIC_EQ_PROFILE;
-        static const char* SDT_EQ_PROFILE;
-        static const char* VOICEMEMO_VUL_GAIN;
-        static const char* VOICEMEMO_VDL_GAIN;
-        static const char* VOICEMEMO_MM_GAIN;
-        static const char* VOICEMEMO_TONE_GAIN;
-        static const char *DL1_EAR_MONO_MIXER;
-        static const char *DL1_HEAD_MONO_MIXER;
-        static const char *DL2_SPEAK_MONO_MIXER;
-        static const char *DL2_AUX_MONO_MIXER;
-
-        // list of properties per devices
-        KeyedVector <String8, String8> mParams;
-
-        size_t size() { return mParams.size(); }
+        // Lock free. The item index or the integer, NOT_SET if none
+        int get(Param param) const {
+            return android_atomic_acquire_load(&mValues[param]);
+        }
+        status_t get(Param param, int& value) const;
+        // the item of a list parameter, a static string
+        status_t get(Param param, const char*& value) const;
+
+        // NO_ERROR when first set, ALREADY_EXISTS when replaced,
+        // BAD_VALUE when the value is not one the parameter takes
+        status_t set(Param param, int value);
+        status_t set(Param param, const char *value);
+        status_t setFromProperty(Param param, const char *init = "");
+        status_t remove(Param param);
+        void clear();
+
+        status_t validateValue(Param param, int value) const;
+        // the item index or the integer value is parsed to
+        status_t parse(Param param, const char *value, int& parsed) const;
+
+        // by "omap.audio.*" key, PARAM_COUNT if there is none
+        static Param find(const char *key);
+        static const char *keyOf(Param param);
+        // the items of a list parameter, NULL for an integer one
+        static const char * const *itemsOf(Param param);
+
+        size_t size() const { return PARAM_COUNT; }
 
         static const char  *MicNameList[];
         static const char  *PowerModeList[];
         static const char  *EqualizerProfileList[];
 
+    private:
+        // both copies would share no lock
+        Omap4ALSAManager(const Omap4ALSAManager&);
+        Omap4ALSAManager& operator=(const Omap4ALSAManager&);
+
+        Mutex                   mLock;      // writers
+        volatile int32_t        mValues[PARAM_COUNT];
 };
 
 
 }; // namespace android
+#endif    // ANDROID_OMAP4_ALSA_MANAGER_H
@@ -0,0 +1,717 @@
+/* VoiceCallControl.cpp
+ **
+ ** Copyright 2009-2011 Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "VoiceCallControl"
+#include <utils/Log.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "VoiceCallControl.h"
+
+namespace android
+{
+
+#define HANDSET     AudioModemInterface::AUDIO_MODEM_HANDSET
+#define HANDFREE    AudioModemInterface::AUDIO_MODEM_HANDFREE
+#define HEADSET     AudioModemInterface::AUDIO_MODEM_HEADSET
+#define BLUETOOTH   AudioModemInterface::AUDIO_MODEM_BLUETOOTH
+#define AUX         AudioModemInterface::AUDIO_MODEM_AUX
+
+#define ALL         0xFFFFFFFF
+#define VALUE(control, value)       { control, NULL, value, -1 }
+#define VALUE_AT(control, value, i) { control, NULL, value, i }
+#define ITEM(control, item)         { control, item, 0, -1 }
+#define END                         { NULL, NULL, 0, -1 }
+
+// ----------------------------------------------------------------------------
+// The OMAP4 voice call paths, as the voiceCallCodec* functions set them
+
+static const RouteSetting handsetOn[] = {
+    ITEM("EP Playback", "On"),
+    VALUE("Earphone Playback Volume", AUDIO_CODEC_EARPIECE_GAIN),
+    VALUE("Sidetone Mixer Playback", 1),
+    VALUE("DL1 PDM Switch", 1),
+    VALUE("SDT DL Volume", AUDIO_ABE_SIDETONE_DL_VOL_HANDSET),
+    VALUE("AUDUL Voice UL Volume", AUDIO_ABE_AUDUL_VOICE_VOL_HANDSET),
+    VALUE("SDT UL Volume", AUDIO_ABE_SIDETONE_UL_VOL_HANDSET),
+    END
+};
+
+static const RouteSetting handfreeOn[] = {
+    ITEM("HF Left Playback", "HF DAC"),
+    ITEM("HF Right Playback", "HF DAC"),
+    VALUE("Handsfree Playback Volume", AUDIO_CODEC_HANDFREE_GAIN),
+    VALUE("SDT DL Volume", AUDIO_ABE_SIDETONE_DL_VOL_HANDFREE),
+    VALUE("AUDUL Voice UL Volume", AUDIO_ABE_AUDUL_VOICE_VOL_HANDFREE),
+    VALUE("SDT UL Volume", AUDIO_ABE_SIDETONE_UL_VOL_HANDFREE),
+    END
+};
+
+// in headset the microphone always comes from analog
+static const RouteSetting headsetOn[] = {
+    ITEM("HS Left Playback", "HS DAC"),
+    ITEM("HS Right Playback", "HS DAC"),
+    VALUE("Headset Playback Volume", AUDIO_CODEC_HEADSET_GAIN),
+    VALUE("Sidetone Mixer Playback", 1),
+    VALUE("DL1 PDM Switch", 1),
+    VALUE("SDT DL Volume", AUDIO_ABE_SIDETONE_DL_VOL_HEADSET),
+    ITEM("Analog Left Capture Route", "Headset Mic"),
+    ITEM("Analog Right Capture Route", "Headset Mic"),
+    VALUE("Capture Preamplifier Volume", AUDIO_CODEC_CAPTURE_PREAMP_ATT_HEADSET),
+    VALUE("Capture Volume", AUDIO_CODEC_CAPTURE_VOL_HEADSET),
+    VALUE("AUDUL Voice UL Volume", AUDIO_ABE_AUDUL_VOICE_VOL_HEADSET),
+    VALUE("AMIC_UL PDM Switch", 1),
+    ITEM("MUX_VX0", "AMic0"),
+    ITEM("MUX_VX1", "AMic0"),
+    VALUE("SDT UL Volume", AUDIO_ABE_SIDETONE_UL_VOL_HEADSET),
+    END
+};
+
+static const RouteSetting bluetoothOn[] = {
+    VALUE("Sidetone Mixer Playback", 1),
+    VALUE("SDT DL Volume", AUDIO_ABE_SIDETONE_DL_VOL_BLUETOOTH),
+    VALUE("AUDUL Voice UL Volume", AUDIO_ABE_AUDUL_VOICE_VOL_BLUETOOTH),
+    VALUE_AT("DL1 PDM Switch", 0, 0),
+    VALUE("DL1 BT_VX Switch", 1),
+    VALUE_AT("AMIC_UL PDM Switch", 0, 0),
+    ITEM("MUX_VX0", "BT Left"),
+    ITEM("MUX_VX1", "BT Left"),
+    VALUE("BT UL Volume", AUDIO_ABE_BT_MIC_UL_VOL),
+    VALUE("SDT UL Volume", AUDIO_ABE_SIDETONE_UL_VOL_BLUETOOTH),
+    END
+};
+
+static const RouteSetting dl1VoiceOn[] = {
+    VALUE("DL1 Mono Mixer", 1),
+    VALUE("DL1 Mixer Voice", 1),
+    END
+};
+
+static const RouteSetting dl1VoiceOff[] = {
+    VALUE_AT("DL1 Mixer Voice", 0, 0),
+    VALUE_AT("DL1 Mono Mixer", 0, 0),
+    END
+};
+
+static const RouteSetting dl2VoiceOn[] = {
+    VALUE("DL2 Mono Mixer", 1),
+    VALUE("DL2 Mixer Voice", 1),
+    END
+};
+
+static const RouteSetting dl2VoiceOff[] = {
+    VALUE_AT("DL2 Mixer Voice", 0, 0),
+    VALUE_AT("DL2 Mono Mixer", 0, 0),
+    END
+};
+
+static const RouteSetting handsetAnalogMicOn[] = {
+    ITEM("Analog Left Capture Route", "Main Mic"),
+    VALUE("Capture Preamplifier Volume", AUDIO_CODEC_CAPTURE_PREAMP_ATT_HANDSET),
+    VALUE("Capture Volume", AUDIO_CODEC_CAPTURE_VOL_HANDSET),
+    END
+};
+
+static const RouteSetting handfreeAnalogMicOn[] = {
+    ITEM("Analog Left Capture Route", "Main Mic"),
+    VALUE("Capture Preamplifier Volume", AUDIO_CODEC_CAPTURE_PREAMP_ATT_HANDFREE),
+    VALUE("Capture Volume", AUDIO_CODEC_CAPTURE_VOL_HANDFREE),
+    END
+};
+
+static const RouteSetting dualAnalogMicOn[] = {
+    ITEM("Analog Right Capture Route", "Sub Mic"),
+    END
+};
+
+static const RouteSetting handsetAmicUlOn[] = {
+    VALUE("AMIC_UL PDM Switch", 1),
+    VALUE("AMIC UL Volume", AUDIO_ABE_AMIC_UL_VOL_HANDSET),
+    END
+};
+
+static const RouteSetting handfreeAmicUlOn[] = {
+    VALUE("AMIC_UL PDM Switch", 1),
+    VALUE("AMIC UL Volume", AUDIO_ABE_AMIC_UL_VOL_HANDFREE),
+    END
+};
+
+static const RouteSetting dmicOnlyOn[] = {
+    VALUE_AT("AMIC_UL PDM Switch", 0, 0),
+    END
+};
+
+static const RouteSetting multimediaOn[] = {
+    VALUE("DL1 Mono Mixer", 1),
+    VALUE("DL2 Mono Mixer", 1),
+    END
+};
+
+static const RouteSetting callOn[] = {
+    VALUE("Voice Capture Mixer Capture", 1),
+    VALUE("Sidetone Mixer Capture", 1),
+    END
+};
+
+static const RouteSetting callOff[] = {
+    VALUE("SDT UL Volume", 0),
+    VALUE_AT("Sidetone Mixer Capture", 0, 0),
+    ITEM("Analog Left Capture Route", "Off"),
+    ITEM("Analog Right Capture Route", "Off"),
+    VALUE("Capture Preamplifier Volume", 0),
+    VALUE("Capture Volume", 0),
+    VALUE_AT("AMIC_UL PDM Switch", 0, 0),
+    ITEM("MUX_VX0", "None"),
+    ITEM("MUX_VX1", "None"),
+    VALUE("AUDUL Voice UL Volume", 0),
+    VALUE_AT("Voice Capture Mixer Capture", 0, 0),
+    END
+};
+
+#define MIC_ANALOG      VoiceCallControl::MIC_ANALOG
+#define MIC_AMIC_UL     VoiceCallControl::MIC_AMIC_UL
+#define MIC_DMIC_ONLY   VoiceCallControl::MIC_DMIC_ONLY
+#define MULTIMIC        VoiceCallControl::MULTIMIC
+#define MULTIMEDIA      VoiceCallControl::MULTIMEDIA
+#define CALL_ON         VoiceCallControl::CALL_ON
+#define CALL_OFF        VoiceCallControl::CALL_OFF
+
+static const RoutePath voiceCallRoutes[] = {
+    { "handset",            ALL, HANDSET,   0, 0,               handsetOn,          NULL },
+    { "handfree",           ALL, HANDFREE,  0, 0,               handfreeOn,         NULL },
+    { "headset",            ALL, HEADSET,   0, 0,               headsetOn,          NULL },
+    { "bluetooth",          ALL, BLUETOOTH, 0, 0,               bluetoothOn,        NULL },
+    { "dl1-voice",          ALL, HANDSET | HEADSET | BLUETOOTH,
+                                            0, 0,               dl1VoiceOn,         dl1VoiceOff },
+    { "dl2-voice",          ALL, HANDFREE,  0, 0,               dl2VoiceOn,         dl2VoiceOff },
+    { "handset-analog-mic", ALL, HANDSET,   0, MIC_ANALOG,      handsetAnalogMicOn, NULL },
+    { "handfree-analog-mic",ALL, HANDFREE,  0, MIC_ANALOG,      handfreeAnalogMicOn,NULL },
+    { "dual-analog-mic",    ALL, HANDSET | HANDFREE,
+                                            0, MIC_ANALOG | MULTIMIC,
+                                                                dualAnalogMicOn,    NULL },
+    { "handset-amic-ul",    ALL, HANDSET,   0, MIC_AMIC_UL,     handsetAmicUlOn,    NULL },
+    { "handfree-amic-ul",   ALL, HANDFREE,  0, MIC_AMIC_UL,     handfreeAmicUlOn,   NULL },
+    { "dmic-only",          ALL, HANDSET | HANDFREE,
+                                            0, MIC_DMIC_ONLY,   dmicOnlyOn,         NULL },
+    { "multimedia",         ALL, HANDSET | HANDFREE | HEADSET | BLUETOOTH,
+                                            0, MULTIMEDIA,      multimediaOn,       NULL },
+    { "call",               ALL, CALL_ON,   0, 0,               callOn,             NULL },
+    { "call-off",           ALL, CALL_OFF,  0, 0,               callOff,            NULL },
+};
+
+// ----------------------------------------------------------------------------
+
+static int modeIndex(uint32_t modes)
+{
+    switch (modes) {
+    case HANDSET:   return 0;
+    case HANDFREE:  return 1;
+    case HEADSET:   return 2;
+    case BLUETOOTH: return 3;
+    default:        return 4;
+    }
+}
+
+static unsigned int pcmRate(uint32_t rate)
+{
+    return rate == AudioModemInterface::PCM_16_KHZ ? 16000 : 8000;
+}
+
+VoiceCallControl::VoiceCallControl(AudioModemInterface *modem, const char *card,
+                                   const char *pcm, const RoutePath *paths, size_t count) :
+    Thread(false),
+    mModem(modem),
+    mMixer(card),
+    mRoutes(paths ? paths : voiceCallRoutes,
+            paths ? count : sizeof(voiceCallRoutes) / sizeof(voiceCallRoutes[0])),
+    mGeneration(0),
+    mApplied(0),
+    mPending(false),
+    mFirstRequest(0),
+    mLastRequest(0),
+    mEqualizerCount(0),
+    mCallEqualizerCount(0),
+    mInCall(false),
+    mModes(0),
+    mRate(AudioModemInterface::PCM_8_KHZ),
+    mMultiMic(false),
+    mFlags(0),
+    mPlayback(NULL),
+    mCapture(NULL),
+    mPcmRate(0)
+{
+    strncpy(mPcmName, pcm, sizeof(mPcmName) - 1);
+    mPcmName[sizeof(mPcmName) - 1] = '\0';
+    mMainMic[0] = mSubMic[0] = '\0';
+    mCallMainMic[0] = mCallSubMic[0] = '\0';
+    mRoutedMainMic[0] = mRoutedSubMic[0] = '\0';
+
+    mTarget.devices = 0;
+    mTarget.mode = AudioSystem::MODE_INVALID;
+    mTarget.multimedia = false;
+
+    for (int i = 0; i < MODES; i++) {
+        mConfig[i].multiMic = false;
+        mConfig[i].sampleRate = AudioModemInterface::PCM_8_KHZ;
+    }
+    memcpy(mCallConfigs, mConfig, sizeof(mConfig));
+    mCallConfig = mConfig[0];
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+VoiceCallControl::~VoiceCallControl()
+{
+    requestExit();
+    mLock.lock();
+    mRequestCond.signal();
+    mLock.unlock();
+    requestExitAndWait();
+
+    closePcm();
+}
+
+status_t VoiceCallControl::initCheck() const
+{
+    return mMixer.initCheck();
+}
+
+void VoiceCallControl::setConfig(uint32_t modes, const VoiceCallConfig &config)
+{
+    Mutex::Autolock lock(mLock);
+    mConfig[modeIndex(modes)] = config;
+}
+
+void VoiceCallControl::setMicrophones(const char *main, const char *sub)
+{
+    Mutex::Autolock lock(mLock);
+    strncpy(mMainMic, main, sizeof(mMainMic) - 1);
+    mMainMic[sizeof(mMainMic) - 1] = '\0';
+    strncpy(mSubMic, sub, sizeof(mSubMic) - 1);
+    mSubMic[sizeof(mSubMic) - 1] = '\0';
+}
+
+void VoiceCallControl::setEqualizer(const char *control, const char *profile)
+{
+    Mutex::Autolock lock(mLock);
+    unsigned int i;
+
+    for (i = 0; i < mEqualizerCount; i++) {
+        if (!strcmp(mEqualizers[i].control, control))
+            break;
+    }
+    if (i == EQUALIZERS) {
+        LOGE("No room for the %s profile", control);
+        return;
+    }
+    if (i == mEqualizerCount) {
+        strncpy(mEqualizers[i].control, control, NAME_LEN - 1);
+        mEqualizers[i].control[NAME_LEN - 1] = '\0';
+        mEqualizerCount++;
+    }
+    strncpy(mEqualizers[i].profile, profile, NAME_LEN - 1);
+    mEqualizers[i].profile[NAME_LEN - 1] = '\0';
+}
+
+void VoiceCallControl::request(uint32_t devices, int mode, bool multimedia)
+{
+    LOGV("%s: devices %04x mode %d multimedia %d", __FUNCTION__, devices, mode, multimedia);
+
+    // Ignore input devices
+    if (devices & AudioSystem::DEVICE_IN_ALL)
+        return;
+
+    Mutex::Autolock lock(mLock);
+    mStats.requests++;
+    if (mTarget.devices == devices && mTarget.mode == mode && !multimedia)
+        return;
+
+    nsecs_t now = systemTime();
+    if (!mPending) {
+        mPending = true;
+        mFirstRequest = now;
+    }
+    mLastRequest = now;
+    mTarget.devices = devices;
+    mTarget.mode = mode;
+    mTarget.multimedia |= multimedia;
+    mGeneration++;
+    mRequestCond.signal();
+}
+
+void VoiceCallControl::flush()
+{
+    Mutex::Autolock lock(mLock);
+    while (mApplied != mGeneration && !exitPending())
+        mAppliedCond.wait(mLock);
+}
+
+VoiceCallControl::Stats VoiceCallControl::stats() const
+{
+    Mutex::Autolock lock(mLock);
+    return mStats;
+}
+
+bool VoiceCallControl::threadLoop()
+{
+    Target target;
+    unsigned int generation;
+    nsecs_t first;
+
+    mLock.lock();
+    while (!mPending && !exitPending())
+        mRequestCond.wait(mLock);
+
+    // a routing change comes as several requests, wait for the last one
+    // but not longer than the latency allowed to the first
+    while (!exitPending()) {
+        nsecs_t now = systemTime();
+        nsecs_t settled = mLastRequest + milliseconds(SETTLE_TIME);
+        nsecs_t latest = mFirstRequest + milliseconds(MAX_LATENCY);
+        nsecs_t deadline = settled < latest ? settled : latest;
+
+        if (now >= deadline)
+            break;
+        mRequestCond.waitRelative(mLock, deadline - now);
+    }
+    if (exitPending()) {
+        mLock.unlock();
+        return false;
+    }
+
+    target = mTarget;
+    generation = mGeneration;
+    first = mFirstRequest;
+    mTarget.multimedia = false;
+    mPending = false;
+
+    // what the properties asked for when the requests were made
+    memcpy(mCallConfigs, mConfig, sizeof(mConfig));
+    strcpy(mCallMainMic, mMainMic);
+    strcpy(mCallSubMic, mSubMic);
+    memcpy(mCallEqualizers, mEqualizers, sizeof(mEqualizers));
+    mCallEqualizerCount = mEqualizerCount;
+    mLock.unlock();
+
+    update(target);
+
+    mLock.lock();
+    nsecs_t latency = systemTime() - first;
+    if (latency > mStats.maxLatency)
+        mStats.maxLatency = latency;
+    mStats.updates++;
+    mApplied = generation;
+    mAppliedCond.broadcast();
+    mLock.unlock();
+
+    return true;
+}
+
+uint32_t VoiceCallControl::modemModes(uint32_t devices) const
+{
+    if (devices & HANDSET)
+        return HANDSET;
+    if (devices & HANDFREE)
+        return HANDFREE;
+    if (devices & HEADSET)
+        return HEADSET;
+#ifdef AUDIO_BLUETOOTH
+    if (devices & BLUETOOTH)
+        return BLUETOOTH;
+#endif
+
+    LOGE("Devices %04x not supported...", devices);
+    if (!mModes) {
+        LOGE("No current devices switch to AUDIO_MODEM_HANDSET...");
+        return HANDSET;
+    }
+    LOGE("Stay on the current devices: %04x...", mModes);
+    return mModes;
+}
+
+uint32_t VoiceCallControl::routeFlags(bool multiMic, bool multimedia) const
+{
+    uint32_t flags = 0;
+    bool mainDigital = mCallMainMic[0] == 'D';
+    bool subDigital = mCallSubMic[0] == 'D';
+
+    if (mCallMainMic[0] == 'A' || mCallSubMic[0] == 'A')
+        flags |= MIC_ANALOG;
+    if (mCallMainMic[0] || mCallSubMic[0])
+        flags |= mainDigital && subDigital ? MIC_DMIC_ONLY : MIC_AMIC_UL;
+    if (multiMic)
+        flags |= MULTIMIC;
+    if (multimedia)
+        flags |= MULTIMEDIA;
+    return flags;
+}
+
+status_t VoiceCallControl::update(const Target &target)
+{
+    LOGV("%s: devices %04x mode %d multimedia %d", __FUNCTION__,
+         target.devices, target.mode, target.multimedia);
+
+    if (target.mode != AudioSystem::MODE_IN_CALL) {
+        // out of a call the HAL owns the controls, a call that isn't
+        // there has nothing to stop
+        return mInCall ? stopCall() : (status_t)NO_ERROR;
+    }
+
+    uint32_t modes = modemModes(target.devices);
+    mCallConfig = mCallConfigs[modeIndex(modes)];
+    if (!mInCall)
+        return startCall(modes);
+    return changeCall(modes, target.multimedia);
+}
+
+status_t VoiceCallControl::startCall(uint32_t modes)
+{
+    status_t error;
+    uint32_t rate = mCallConfig.sampleRate;
+
+    LOGV("Start Voice call: %04x", modes);
+
+    if (rate == AudioModemInterface::INVALID_SAMPLE_RATE) {
+        rate = mModem->GetVoiceCallSampleRate();
+        mStats.modemCalls++;
+        LOGV("Sample rate used for this voice call: %d", rate);
+        if (rate != AudioModemInterface::PCM_8_KHZ && rate != AudioModemInterface::PCM_16_KHZ) {
+            LOGE("Invalid Sample rate used for this voice call set to 8KHz");
+            rate = AudioModemInterface::PCM_8_KHZ;
+        }
+    }
+
+    error = mModem->setModemRouting(modes, rate);
+    mStats.modemCalls++;
+    if (error < 0) {
+        LOGE("Unable to set Modem Voice Call routing: %s", strerror(error));
+        return error;
+    }
+    error = mModem->setModemVoiceCallMultiMic(mCallConfig.multiMic ?
+                AudioModemInterface::MODEM_DOUBLE_MIC : AudioModemInterface::MODEM_SINGLE_MIC);
+    mStats.modemCalls++;
+    if (error < 0) {
+        LOGE("Unable to set Modem Voice Call multimic.: %s", strerror(error));
+        return error;
+    }
+    error = mModem->OpenModemVoiceCallStream();
+    mStats.modemCalls++;
+    if (error < 0) {
+        LOGE("Unable to open Modem Voice Call stream: %s", strerror(error));
+        return error;
+    }
+
+    mInCall = true;
+    mModes = modes;
+    mRate = rate;
+    mMultiMic = mCallConfig.multiMic;
+
+    error = route(modes | CALL_ON, routeFlags(mMultiMic, false));
+    if (error != NO_ERROR)
+        return error;
+    return openPcm(pcmRate(rate));
+}
+
+status_t VoiceCallControl::changeCall(uint32_t modes, bool multimedia)
+{
+    status_t error = NO_ERROR;
+    uint32_t rate = mRate;
+
+    // a rate the modem reported holds for the whole call
+    if (mCallConfig.sampleRate != AudioModemInterface::INVALID_SAMPLE_RATE)
+        rate = mCallConfig.sampleRate;
+
+    if (modes != mModes || rate != mRate) {
+        error = mModem->setModemRouting(modes, rate);
+        mStats.modemCalls++;
+        if (error < 0) {
+            LOGE("Unable to set Modem Voice Call routing: %s", strerror(error));
+            return error;
+        }
+    }
+    if (mCallConfig.multiMic != mMultiMic) {
+        error = mModem->setModemVoiceCallMultiMic(mCallConfig.multiMic ?
+                    AudioModemInterface::MODEM_DOUBLE_MIC : AudioModemInterface::MODEM_SINGLE_MIC);
+        mStats.modemCalls++;
+        if (error < 0) {
+            LOGE("Unable to set Modem Voice Call multimic.: %s", strerror(error));
+            return error;
+        }
+    }
+
+    // the multimedia paths stay on top of the call until it changes mode
+    bool shared = multimedia || (modes == mModes && (mFlags & MULTIMEDIA));
+    uint32_t flags = routeFlags(mCallConfig.multiMic, shared);
+    bool changed = modes != mModes || flags != mFlags ||
+                   strcmp(mCallMainMic, mRoutedMainMic) ||
+                   strcmp(mCallSubMic, mRoutedSubMic);
+
+    mModes = modes;
+    mRate = rate;
+    mMultiMic = mCallConfig.multiMic;
+
+    // a multimedia route may have changed controls of the call, routing
+    // it again writes back only those
+    if (changed || multimedia) {
+        error = route(modes | CALL_ON, flags);
+        if (error != NO_ERROR)
+            return error;
+    } else {
+        LOGI("Audio Modem Mode doesn't changed: no update needed");
+    }
+
+    if (pcmRate(rate) != mPcmRate)
+        error = openPcm(pcmRate(rate));
+    return error;
+}
+
+status_t VoiceCallControl::stopCall()
+{
+    status_t error;
+
+    LOGV("Stop Voice call");
+
+    error = mModem->CloseModemVoiceCallStream();
+    mStats.modemCalls++;
+    if (error < 0)
+        LOGE("Unable to close Modem Voice Call stream: %s", strerror(error));
+
+    mInCall = false;
+    mModes = 0;
+    closePcm();
+    return route(CALL_OFF, 0);
+}
+
+status_t VoiceCallControl::route(uint32_t devices, uint32_t flags)
+{
+    status_t error;
+
+    Mutex::Autolock lock(mControlLock);
+
+    mRoutes.select(devices, flags);
+    error = mRoutes.stage(mMixer);
+    if (error == NO_ERROR && (devices & CALL_ON))
+        error = stageMicrophones(devices & ~CALL_ON, flags & MULTIMIC);
+    if (error == NO_ERROR && (devices & CALL_ON)) {
+        for (unsigned int i = 0; i < mCallEqualizerCount && error == NO_ERROR; i++)
+            error = mMixer.set(mCallEqualizers[i].control, mCallEqualizers[i].profile);
+    }
+    if (error != NO_ERROR) {
+        LOGE("Voice call route %08x not set", devices);
+        mMixer.discard();
+        return error;
+    }
+
+    int written = mMixer.apply();
+    if (written < 0) {
+        LOGE("Voice call route %08x not written: %s", devices, snd_strerror(written));
+        return written;
+    }
+    mRoutes.commit();
+    mStats.controlWrites += written;
+
+    mFlags = flags;
+    strcpy(mRoutedMainMic, mCallMainMic);
+    strcpy(mRoutedSubMic, mCallSubMic);
+    return NO_ERROR;
+}
+
+// The uplink mixes of the microphones the properties chose, their names
+// make the values so they can't be in the paths
+status_t VoiceCallControl::stageMicrophones(uint32_t modes, bool multiMic)
+{
+    status_t error = NO_ERROR;
+    char volume[NAME_LEN];
+    const char *main = mCallMainMic;
+    const char *sub = mCallSubMic;
+
+    if (!(modes & (HANDSET | HANDFREE)) || !main[0])
+        return NO_ERROR;
+
+    if (main[0] == 'D') {
+        snprintf(volume, sizeof(volume), "DMIC%c UL Volume", main[4] + 1);
+        error = mMixer.set(volume, modes == HANDSET ? AUDIO_ABE_DMIC_MAIN_UL_VOL_HANDSET
+                                                    : AUDIO_ABE_DMIC_MAIN_UL_VOL_HANDFREE);
+    }
+    if (error == NO_ERROR && sub[0] == 'D') {
+        snprintf(volume, sizeof(volume), "DMIC%c UL Volume", sub[4] + 1);
+        error = mMixer.set(volume, modes == HANDSET ? AUDIO_ABE_DMIC_SUB_UL_VOL_HANDSET
+                                                    : AUDIO_ABE_DMIC_SUB_UL_VOL_HANDFREE);
+    }
+    if (error == NO_ERROR)
+        error = mMixer.set("MUX_VX0", main);
+    if (error == NO_ERROR)
+        error = mMixer.set("MUX_VX1", multiMic && sub[0] ? sub : main);
+    return error;
+}
+
+status_t VoiceCallControl::openPcm(unsigned int rate)
+{
+    int error;
+
+    closePcm();
+
+    if ((error = snd_pcm_open(&mCapture, mPcmName, SND_PCM_STREAM_CAPTURE, 0)) < 0) {
+        LOGE("Modem PCM capture open error: %d:%s", error, snd_strerror(error));
+        mCapture = NULL;
+        return INVALID_OPERATION;
+    }
+    if ((error = snd_pcm_open(&mPlayback, mPcmName, SND_PCM_STREAM_PLAYBACK, 0)) < 0) {
+        LOGE("Modem PCM playback open error: %d:%s", error, snd_strerror(error));
+        mPlayback = NULL;
+        closePcm();
+        return INVALID_OPERATION;
+    }
+    mStats.pcmOpens++;
+
+    if ((error = snd_pcm_set_params(mCapture, SND_PCM_FORMAT_S16_LE,
+                    SND_PCM_ACCESS_RW_INTERLEAVED, 2, rate, 1, AUDIO_MODEM_PCM_LATENCY)) < 0 ||
+        (error = snd_pcm_set_params(mPlayback, SND_PCM_FORMAT_S16_LE,
+                    SND_PCM_ACCESS_RW_INTERLEAVED, 2, rate, 1, AUDIO_MODEM_PCM_LATENCY)) < 0) {
+        LOGE("Modem PCM params error: %s", snd_strerror(error));
+        closePcm();
+        return INVALID_OPERATION;
+    }
+
+    if ((error = snd_pcm_start(mCapture)) < 0 ||
+        (error = snd_pcm_start(mPlayback)) < 0) {
+        LOGE("Modem PCM start error: %d:%s", error, snd_strerror(error));
+        closePcm();
+        return INVALID_OPERATION;
+    }
+
+    LOGV("Modem PCM %s open at %u Hz", mPcmName, rate);
+    mPcmRate = rate;
+    return NO_ERROR;
+}
+
+void VoiceCallControl::closePcm()
+{
+    if (mCapture) {
+        snd_pcm_drop(mCapture);
+        snd_pcm_close(mCapture);
+        mCapture = NULL;
+    }
+    if (mPlayback) {
+        snd_pcm_drop(mPlayback);
+        snd_pcm_close(mPlayback);
+        mPlayback = NULL;
+    }
+    mPcmRate = 0;
+}
+
+};        // namespace android
@@ -0,0 +1,291 @@
+/* VoiceCallControl.h
+ **
+ ** Copyright (C) 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#ifndef ANDROID_VOICE_CALL_CONTROL_H
+#define ANDROID_VOICE_CALL_CONTROL_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <alsa/asoundlib.h>
+#include <utils/threads.h>
+#include <utils/Timers.h>
+
+#include "audio_modem_interface.h"
+#include "ALSAControlCache.h"
+#include "ALSARouteGraph.h"
+
+//
+// Audio Codec fine tuning paratemers:
+//
+// TODO put in property keys
+// Preamplifier attenuation gain are
+//  index       gain
+//  1           0dB
+//  0           6dB
+#define AUDIO_CODEC_CAPTURE_PREAMP_ATT_HANDSET      1
+#define AUDIO_CODEC_CAPTURE_PREAMP_ATT_HANDFREE     1
+#define AUDIO_CODEC_CAPTURE_PREAMP_ATT_HEADSET      1
+
+// amplifier volumes are
+//  index       gain
+//  0           6dB
+//  1           12dB
+//  2           18dB
+//  3           24dB
+//  4           30dB
+#define AUDIO_CODEC_CAPTURE_VOL_HANDSET             3
+#define AUDIO_CODEC_CAPTURE_VOL_HANDFREE            3
+#define AUDIO_CODEC_CAPTURE_VOL_HEADSET             3
+
+// amplifier volumes are
+//  index       gain
+//  0           -24dB
+//  ...
+//  15          6dB
+//
+//  step 2dB
+#define AUDIO_CODEC_EARPIECE_GAIN        15
+
+// amplifier volumes are
+//  index       gain
+//  0           -52dB
+//  ...
+//  29          6dB
+//
+//  step 2dB
+#define AUDIO_CODEC_HANDFREE_GAIN        23
+
+// amplifier volumes are
+//  index       gain
+//  0           -30dB
+//  ...
+//  15          0dB
+//
+//  step 2dB
+#define AUDIO_CODEC_HEADSET_GAIN        15
+
+// ABE Audio UL voice mixer Volume
+// Range values: min=0,max=149,step=1
+// dBscale-min=-120.00dB,step=1.00dB,mute=0
+#define AUDIO_ABE_AUDUL_VOICE_VOL_HANDSET       120
+#define AUDIO_ABE_AUDUL_VOICE_VOL_HANDFREE      120
+#define AUDIO_ABE_AUDUL_VOICE_VOL_HEADSET       120
+#define AUDIO_ABE_AUDUL_VOICE_VOL_BLUETOOTH     120
+
+// DMIC ABE Uplink Volume
+// Range values: min=0,max=149,step=1
+// dBscale-min=-120.00dB,step=1.00dB,mute=0
+#define AUDIO_ABE_DMIC_MAIN_UL_VOL_HANDFREE     140
+#define AUDIO_ABE_DMIC_SUB_UL_VOL_HANDFREE      140
+#define AUDIO_ABE_DMIC_MAIN_UL_VOL_HANDSET      140
+#define AUDIO_ABE_DMIC_SUB_UL_VOL_HANDSET       140
+
+// AMIC ABE Uplink Volume
+// Range values: min=0,max=149,step=1
+// dBscale-min=-120.00dB,step=1.00dB,mute=0
+#define AUDIO_ABE_AMIC_UL_VOL_HANDFREE          120
+#define AUDIO_ABE_AMIC_UL_VOL_HANDSET           120
+
+// Bluetooth MIC ABE Uplink Volume
+// Range values: min=0,max=149,step=1
+// dBscale-min=-120.00dB,step=1.00dB,mute=0
+#define AUDIO_ABE_BT_MIC_UL_VOL 120
+
+// Sidetone Downlink Volume
+// Range values: min=0,max=149,step=1
+// dBscale-min=-120.00dB,step=1.00dB,mute=0
+#define AUDIO_ABE_SIDETONE_DL_VOL_HANDSET       118
+#define AUDIO_ABE_SIDETONE_DL_VOL_HANDFREE     0
+#define AUDIO_ABE_SIDETONE_DL_VOL_HEADSET       118
+#define AUDIO_ABE_SIDETONE_DL_VOL_BLUETOOTH     118
+
+// Sidetone Uplink Volume
+// Range values: min=0,max=149,step=1
+// dBscale-min=-120.00dB,step=1.00dB,mute=0
+#define AUDIO_ABE_SIDETONE_UL_VOL_HANDSET       90
+#define AUDIO_ABE_SIDETONE_UL_VOL_HANDFREE      0
+#define AUDIO_ABE_SIDETONE_UL_VOL_HEADSET       90
+#define AUDIO_ABE_SIDETONE_UL_VOL_BLUETOOTH     90
+
+// Audio ALSA PCM configuration
+#define AUDIO_MODEM_PCM_LATENCY     500000
+
+namespace android
+{
+
+// What the properties of one modem mode ask of a call
+struct VoiceCallConfig {
+    bool        multiMic;
+    uint32_t    sampleRate;     // PCM_8_KHZ, PCM_16_KHZ, INVALID_SAMPLE_RATE
+                                // for the one the modem reports
+};
+
+// The codec, modem and PCM side of a voice call as a state machine.
+// request() only records the devices and mode the HAL asks for; the
+// control thread waits for the burst of requests a routing change makes
+// to settle, then moves the call from the state it is in to the latest
+// one asked for in a single pass:
+//
+//  - the modem is told what changed only: the stream is opened and
+//    closed with the call, the routing set when the mode or the rate
+//    change, the microphones when their number does
+//  - the modem PCM is opened with the call and only opened again when
+//    its rate changes
+//  - the codec controls are a table of paths resolved by an
+//    ALSARouteGraph and written through an ALSAControlCache, a mode
+//    change writes the controls the two modes set differently
+//
+// The codec paths select on the modem mode plus CALL_ON or CALL_OFF,
+// and on the flags below: the microphones the properties chose and a
+// multimedia route set on top of the call.
+class VoiceCallControl : public Thread
+{
+public:
+    enum {
+        SETTLE_TIME     = 20,       // ms without a request before applying
+        MAX_LATENCY     = 60,       // ms from a request to its controls at most
+    };
+
+    // pseudo devices of the route
+    enum {
+        CALL_ON         = 0x40000000,
+        CALL_OFF        = 0x80000000,
+    };
+
+    // route flags
+    enum {
+        MIC_ANALOG      = 0x01,     // one of the microphones is analog
+        MIC_AMIC_UL     = 0x02,     // the AMIC uplink is needed
+        MIC_DMIC_ONLY   = 0x04,     // both microphones are digital
+        MULTIMIC        = 0x08,
+        MULTIMEDIA      = 0x10,     // a multimedia route shares the DL paths
+    };
+
+    struct Stats {
+        unsigned int    requests;       // taken by request()
+        unsigned int    updates;        // passes of the control thread
+        unsigned int    modemCalls;
+        unsigned int    pcmOpens;
+        unsigned int    controlWrites;
+        nsecs_t         maxLatency;     // from a request to its pass done
+    };
+
+    // The OMAP4 voice call paths unless a table is given
+    VoiceCallControl(AudioModemInterface *modem,
+                     const char *card = "hw:00",
+                     const char *pcm = "hw:0,5",
+                     const RoutePath *paths = NULL, size_t count = 0);
+    virtual ~VoiceCallControl();
+
+    status_t initCheck() const;
+
+    // What calls in a modem mode use, from its properties
+    void setConfig(uint32_t modes, const VoiceCallConfig &config);
+    // The microphones the next update routes, "AMic0", "DMic1"...
+    void setMicrophones(const char *main, const char *sub);
+    // A profile of one of the ABE equalizers, by control name
+    void setEqualizer(const char *control, const char *profile);
+
+    // The call for devices in mode. Input devices are ignored, the last
+    // request of a burst wins; multimedia tells that a multimedia route
+    // was just set over the call paths.
+    void request(uint32_t devices, int mode, bool multimedia);
+
+    // Keeps the control thread off the codec while the HAL routes
+    void lock() { mControlLock.lock(); }
+    void unlock() { mControlLock.unlock(); }
+
+    // Waits until the requests made so far are applied
+    void flush();
+
+    Stats stats() const;
+
+private:
+    enum { EQUALIZERS = 8, NAME_LEN = 44, MODES = 5 };
+
+    struct Target {
+        uint32_t    devices;
+        int         mode;
+        bool        multimedia;
+    };
+
+    struct Equalizer {
+        char        control[NAME_LEN];
+        char        profile[NAME_LEN];
+    };
+
+    virtual bool threadLoop();
+
+    uint32_t    modemModes(uint32_t devices) const;
+    uint32_t    routeFlags(bool multiMic, bool multimedia) const;
+    status_t    update(const Target &target);
+    status_t    startCall(uint32_t modes);
+    status_t    changeCall(uint32_t modes, bool multimedia);
+    status_t    stopCall();
+    status_t    route(uint32_t devices, uint32_t flags);
+    status_t    stageMicrophones(uint32_t modes, bool multiMic);
+    status_t    openPcm(unsigned int rate);
+    void        closePcm();
+
+    AudioModemInterface *   mModem;
+    char                    mPcmName[NAME_LEN];
+    ALSAControlCache        mMixer;
+    ALSARouteGraph          mRoutes;
+
+    // requests and properties, under mLock
+    mutable Mutex           mLock;
+    Condition               mRequestCond;
+    Condition               mAppliedCond;
+    Target                  mTarget;
+    unsigned int            mGeneration;    // of mTarget
+    unsigned int            mApplied;       // last generation applied
+    bool                    mPending;       // requests not taken yet
+    nsecs_t                 mFirstRequest;  // of those
+    nsecs_t                 mLastRequest;
+    VoiceCallConfig         mConfig[MODES]; // handset, handfree, headset, bt, aux
+    char                    mMainMic[8];
+    char                    mSubMic[8];
+    Equalizer               mEqualizers[EQUALIZERS];
+    unsigned int            mEqualizerCount;
+    Stats                   mStats;
+
+    // codec, under mControlLock
+    Mutex                   mControlLock;
+
+    // control thread only: the properties of the pass
+    VoiceCallConfig         mCallConfigs[MODES];
+    VoiceCallConfig         mCallConfig;    // of the mode of the call
+    char                    mCallMainMic[8];
+    char                    mCallSubMic[8];
+    Equalizer               mCallEqualizers[EQUALIZERS];
+    unsigned int            mCallEqualizerCount;
+
+    // and the call as applied
+    bool                    mInCall;
+    uint32_t                mModes;
+    uint32_t                mRate;          // AudioModemInterface sample rate
+    bool                    mMultiMic;
+    uint32_t                mFlags;         // of the route
+    char                    mRoutedMainMic[8];
+    char                    mRoutedSubMic[8];
+    snd_pcm_t *             mPlayback;
+    snd_pcm_t *             mCapture;
+    unsigned int            mPcmRate;       // Hz, 0 when closed
+};
+
+};        // namespace android
+#endif    // ANDROID_VOICE_CALL_CONTROL_H
@@ -32,17 +32,25 @@ ifeq ($(strip $(BOARD_USES_ALSA_AUDIO)),true)
   endif
 
   ifeq ($(strip $(TARGET_BOARD_PLATFORM)), omap3)
-    LOCAL_SRC_FILES:= alsa_omap3.cpp
+    LOCAL_SRC_FILES:= alsa_omap3.cpp \
+                       ALSAControlCache.cpp \
+                       ALSARouteGraph.cpp
     ifeq ($(strip $(BOARD_USES_TI_OMAP_MODEM_AUDIO)),true)
       LOCAL_SRC_FILES += alsa_omap3_modem.cpp
     endif
   endif
   ifeq ($(strip $(TARGET_BOARD_PLATFORM)), omap4)
     LOCAL_SRC_FILES:= alsa_omap4.cpp \
-                       Omap4ALSAManager.cpp
+                       alsa_geometry.cpp \
+                       ALSAControlCache.cpp \
+                       ALSARouteGraph.cpp \
+                       alsa_omap4_routes.cpp \
+                       Omap4ALSAManager.cpp \
+                       ALSAStreamCache.cpp
     LOCAL_SHARED_LIBRARIES += libmedia
     ifeq ($(strip $(BOARD_USES_TI_OMAP_MODEM_AUDIO)),true)
-      LOCAL_SRC_FILES += alsa_omap4_modem.cpp
+      LOCAL_SRC_FILES += alsa_omap4_modem.cpp \
+                         VoiceCallControl.cpp
     endif
   endif
 
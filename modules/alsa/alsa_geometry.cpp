@@ -0,0 +1,70 @@
+/* alsa_geometry.cpp
+ **
+ ** Copyright 2009-2011 Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "ALSAGeometry"
+#include <utils/Log.h>
+
+#include "alsa_geometry.h"
+
+namespace android
+{
+
+status_t pcmSetGeometry(snd_pcm_t *pcm, snd_pcm_hw_params_t *params,
+                        unsigned int latency, bool pingPong, PcmGeometry &geometry)
+{
+    unsigned int bufferTime = latency;
+    unsigned int periods;
+    int err;
+
+    err = snd_pcm_hw_params_set_buffer_time_near(pcm, params, &bufferTime, NULL);
+    if (err < 0) {
+        LOGE("Unable to set buffer time to %u usec: %s", latency, snd_strerror(err));
+        return err;
+    }
+
+    if (pingPong) {
+        // the DMA of a ping-pong device flips between two halves
+        periods = 2;
+        err = snd_pcm_hw_params_set_periods(pcm, params, periods, 0);
+    } else {
+        periods = bufferTime / PCM_MIN_PERIOD_TIME;
+        if (periods < 2) periods = 2;
+        if (periods > PCM_MAX_PERIODS) periods = PCM_MAX_PERIODS;
+        err = snd_pcm_hw_params_set_periods_near(pcm, params, &periods, NULL);
+    }
+    if (err < 0) {
+        LOGE("Unable to set %u periods in %u usec: %s", periods, bufferTime, snd_strerror(err));
+        return err;
+    }
+
+    if ((err = snd_pcm_hw_params_get_period_size(params, &geometry.periodSize, NULL)) < 0 ||
+        (err = snd_pcm_hw_params_get_buffer_size(params, &geometry.bufferSize)) < 0 ||
+        (err = snd_pcm_hw_params_get_period_time(params, &geometry.periodTime, NULL)) < 0 ||
+        (err = snd_pcm_hw_params_get_buffer_time(params, &geometry.bufferTime, NULL)) < 0) {
+        LOGE("Unable to get the buffer geometry: %s", snd_strerror(err));
+        return err;
+    }
+    geometry.periods = periods;
+
+    if (geometry.bufferTime != latency)
+        LOGW("Latency of %u usec not granted, got %u", latency, geometry.bufferTime);
+    LOGV("%u periods of %lu frames for %u usec", periods, geometry.periodSize, geometry.bufferTime);
+
+    return NO_ERROR;
+}
+
+}
@@ -0,0 +1,52 @@
+/* alsa_geometry.h
+ **
+ ** Copyright (C) 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#ifndef ANDROID_ALSA_GEOMETRY
+#define ANDROID_ALSA_GEOMETRY
+
+#include <alsa/asoundlib.h>
+#include <utils/Errors.h>
+
+// Buffer sizing of an ALSA PCM from a latency target, for the OMAP modules.
+// Nothing here needs the Android audio HAL, the host test runs it against
+// the ALSA dummy and loopback drivers.
+
+namespace android
+{
+
+// Shortest period, bounds the wake-ups of a stream to 200 per second
+#define PCM_MIN_PERIOD_TIME     5000    // in usec
+#define PCM_MAX_PERIODS         4
+
+struct PcmGeometry {
+    snd_pcm_uframes_t   periodSize;
+    snd_pcm_uframes_t   bufferSize;
+    unsigned int        periods;
+    unsigned int        periodTime;     // in usec
+    unsigned int        bufferTime;     // in usec
+};
+
+// Sizes the buffer of hw params that have their access, format, channels
+// and rate set for a latency target, the time a frame spends in the
+// buffer. The periods are as many as the target has room for, periods of
+// at least PCM_MIN_PERIOD_TIME, between 2 and PCM_MAX_PERIODS. pingPong
+// devices get exactly 2. geometry is what the hardware granted.
+status_t pcmSetGeometry(snd_pcm_t *pcm, snd_pcm_hw_params_t *params,
+                        unsigned int latency, bool pingPong, PcmGeometry &geometry);
+
+}
+#endif    // ANDROID_ALSA_GEOMETRY
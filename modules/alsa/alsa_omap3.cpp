@@ -20,6 +20,8 @@
 
 #include "AudioHardwareALSA.h"
 #include <media/AudioRecord.h>
+#include "ALSAControlCache.h"
+#include "ALSARouteGraph.h"
 
 #ifdef AUDIO_MODEM_TI
 #include "audio_modem_interface.h"
@@ -52,6 +54,10 @@ static status_t s_resetDefaults(alsa_handle_t *handle);
     AudioModemAlsa *audioModem;
 #endif
 
+    // the routing controls of the card, and the routes setting them
+    static ALSAControlCache *mixer;
+    static ALSARouteGraph *routes;
+
 static hw_module_methods_t s_module_methods = {
     open            : s_device_open
 };
@@ -475,57 +481,88 @@ void setFmControls(uint32_t devices, int mode)
 LOGV("%s", __FUNCTION__);
 }
 
+// Zoom2 board doesn't have earpiece device, speaker device is used instead
+static const RouteSetting handsfreeOn[] = {
+    { "HandsfreeR Switch",                      NULL,       1,  -1 },
+    { "HandsfreeL Switch",                      NULL,       1,  -1 },
+    { "HandsfreeR Mux",                         "AudioR2",  0,  -1 },
+    { "HandsfreeL Mux",                         "AudioL2",  0,  -1 },
+    { NULL }
+};
+
+static const RouteSetting handsfreeOff[] = {
+    { "HandsfreeR Switch",                      NULL,       0,  -1 },
+    { "HandsfreeL Switch",                      NULL,       0,  -1 },
+    { NULL }
+};
+
+static const RouteSetting headsetOn[] = {
+    { "HeadsetR Mixer AudioR2",                 NULL,       1,  -1 },
+    { "HeadsetL Mixer AudioL2",                 NULL,       1,  -1 },
+    { "HandsfreeR Mux",                         "AudioR2",  0,  -1 },
+    { "HandsfreeL Mux",                         "AudioL2",  0,  -1 },
+    { NULL }
+};
+
+static const RouteSetting headsetOff[] = {
+    { "HeadsetR Mixer AudioR2",                 NULL,       0,  -1 },
+    { "HeadsetL Mixer AudioL2",                 NULL,       0,  -1 },
+    { NULL }
+};
+
+static const RouteSetting mainMicOn[] = {
+    { "Analog Left Main Mic Capture Switch",    NULL,       1,  -1 },
+    { "Analog Right Sub Mic Capture Switch",    NULL,       1,  -1 },
+    { NULL }
+};
+
+static const RouteSetting mainMicOff[] = {
+    { "Analog Left Main Mic Capture Switch",    NULL,       0,  -1 },
+    { "Analog Right Sub Mic Capture Switch",    NULL,       0,  -1 },
+    { NULL }
+};
+
+static const RouteSetting headsetMicOn[] = {
+    { "Analog Left Headset Mic Capture Switch", NULL,       1,  -1 },
+    { NULL }
+};
+
+static const RouteSetting headsetMicOff[] = {
+    { "Analog Left Headset Mic Capture Switch", NULL,       0,  -1 },
+    { NULL }
+};
+
+static const RoutePath omap3Routes[] = {
+//    name              scope       devices
+//                      exclude     flags   on              off
+    { "handsfree",      0x0000FFFF, AudioSystem::DEVICE_OUT_SPEAKER |
+                                    AudioSystem::DEVICE_OUT_EARPIECE,
+                        0,          0,      handsfreeOn,    handsfreeOff },
+    { "headset",        0x0000FFFF, AudioSystem::DEVICE_OUT_WIRED_HEADSET,
+                        0,          0,      headsetOn,      headsetOff },
+    { "main-mic",       0xFFFF0000, AudioSystem::DEVICE_IN_BUILTIN_MIC,
+                        0,          0,      mainMicOn,      mainMicOff },
+    { "headset-mic",    0xFFFF0000, AudioSystem::DEVICE_IN_WIRED_HEADSET,
+                        0,          0,      headsetMicOn,   headsetMicOff },
+};
+
 void setDefaultControls(uint32_t devices, int mode)
 {
 LOGV("%s", __FUNCTION__);
-    ALSAControl control("hw:00");
 
 #ifdef AUDIO_MODEM_TI
+    ALSAControl control("hw:00");
     audioModem->voiceCallControls(devices, mode, &control);
 #endif
-    /* check whether the devices is input or not */
-    /* for output devices */
-    if (devices & 0x0000FFFF){
-        // Zoom2 board doesn't have earpiece device
-        // speaker device is used instead
-        if (devices & (AudioSystem::DEVICE_OUT_SPEAKER |
-                   AudioSystem::DEVICE_OUT_EARPIECE)) {
-            control.set("HandsfreeR Switch", 1); // on
-            control.set("HandsfreeL Switch", 1); // on
-            control.set("HandsfreeR Mux", "AudioR2");
-            control.set("HandsfreeL Mux", "AudioL2");
-        } else {
-            control.set("HandsfreeR Switch", (unsigned int)0); // off
-            control.set("HandsfreeL Switch", (unsigned int)0); // off
-        }
-
-        if (devices & AudioSystem::DEVICE_OUT_WIRED_HEADSET) {
-            control.set("HeadsetR Mixer AudioR2", 1); // on
-            control.set("HeadsetL Mixer AudioL2", 1); // on
-            control.set("HandsfreeR Mux", "AudioR2");
-            control.set("HandsfreeL Mux", "AudioL2");
-        } else {
-            control.set("HeadsetR Mixer AudioR2", (unsigned int)0); // off
-            control.set("HeadsetL Mixer AudioL2", (unsigned int)0); // off
-        }
-    }
 
-    /* for input devices */
-    if (devices >> 16) {
-        if (devices & AudioSystem::DEVICE_IN_BUILTIN_MIC) {
-            control.set("Analog Left Main Mic Capture Switch", 1); // on
-            control.set("Analog Right Sub Mic Capture Switch", 1); // on
-        } else {
-            control.set("Analog Left Main Mic Capture Switch", (unsigned int)0); // off
-            control.set("Analog Right Sub Mic Capture Switch", (unsigned int)0); // off
-        }
+    routes->select(devices, 0);
+    if (routes->stage(*mixer) != NO_ERROR)
+        return;
 
-        if (devices & AudioSystem::DEVICE_IN_WIRED_HEADSET) {
-            control.set("Analog Left Headset Mic Capture Switch", 1); // on
-        } else {
-            control.set("Analog Left Headset Mic Capture Switch", (unsigned int)0); // off
-        }
-    }
+    // only what the new route sets differently reaches the card
+    if (mixer->apply() < 0)
+        LOGE("Route %08x not fully set", devices);
+    routes->commit();
 }
 
 void setAlsaControls(alsa_handle_t *handle, uint32_t devices, int mode, uint32_t channels)
@@ -563,6 +600,13 @@ static status_t s_init(alsa_device_t *module, ALSAHandleList &list)
     audioModem = new AudioModemAlsa(&control);
 #endif
 
+    if (!mixer)
+        mixer = new ALSAControlCache("hw:00");
+    if (mixer->initCheck() != NO_ERROR)
+        LOGE("No mixer controls, routes won't be set");
+    if (!routes)
+        routes = new ALSARouteGraph(omap3Routes, ARRAY_SIZE(omap3Routes));
+
     return NO_ERROR;
 }
 
@@ -21,6 +21,9 @@
 #include "AudioHardwareALSA.h"
 #include <media/AudioRecord.h>
 #include "alsa_omap4.h"
+#include "alsa_geometry.h"
+#include "ALSAControlCache.h"
+#include "ALSAStreamCache.h"
 
 static bool fm_enable = false;
 static bool mActive = false;
@@ -46,6 +49,13 @@ static status_t s_resetDefaults(alsa_handle_t *handle);
 
     Omap4ALSAManager propMgr;
 
+    // the routing controls of the card, written as the difference between routes
+    static ALSAControlCache *mixer;
+    // the routes of alsa_omap4_routes.cpp
+    static ALSARouteGraph *routes;
+    // the PCMs of the streams in standby, resumed without an open
+    static ALSAStreamCache *pcmCache;
+
 static hw_module_methods_t s_module_methods = {
     open            : s_device_open
 };
@@ -122,7 +132,9 @@ static alsa_handle_t _defaults[] = {
         channels    : Integer number of channels
         sampleRate  : Desired sample rate in Hz
         latency     : Desired Delay in usec for the ALSA buffer
-        bufferSize  : Desired Number of samples for the ALSA buffer
+        bufferSize  : Desired Number of samples for the ALSA buffer, the
+                      buffer and its periods are sized for it unless the
+                      omap.audio.latency properties set a target
         mmap        : true (1) to use mmap, false (0) to use standard writei
         modPrivate  : pointer to the function specific to this handle
 */
@@ -298,17 +310,54 @@ const char *streamName(alsa_handle_t *handle)
     return snd_pcm_stream_name(direction(handle));
 }
 
+// The latency target of the property, 0 when the handle keeps the buffer
+// of its defaults. bufferSize is that buffer; the handle's own latency
+// and bufferSize are what the last open was granted.
+static int requestedLatency(alsa_handle_t *handle, snd_pcm_uframes_t *bufferSize)
+{
+    char latency[PROPERTY_VALUE_MAX];
+
+    *bufferSize = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(_defaults); i++) {
+        if (_defaults[i].devices == handle->devices) {
+            *bufferSize = _defaults[i].bufferSize;
+            break;
+        }
+    }
+    if (property_get(direction(handle) == SND_PCM_STREAM_PLAYBACK ?
+                     "omap.audio.latency.playback" : "omap.audio.latency.capture",
+                     latency, NULL) > 0 && atoi(latency) > 0)
+        return atoi(latency);
+    return 0;
+}
+
+// What the PCM of the handle is set up from, a parked PCM of the same
+// configuration needs none of it done again
+static void streamConfig(alsa_handle_t *handle, const char *device,
+                         ALSAStreamCache::Config &config)
+{
+    snd_pcm_uframes_t bufferSize;
+
+    memset(&config, 0, sizeof(config));
+    strncpy(config.device, device, sizeof(config.device) - 1);
+    config.stream = direction(handle);
+    config.format = handle->format;
+    config.channels = handle->channels;
+    config.rate = handle->sampleRate;
+    config.mmap = handle->mmap;
+    config.latency = requestedLatency(handle, &bufferSize);
+    config.devices = handle->devices;
+}
+
 status_t setHardwareParams(alsa_handle_t *handle)
 {
     snd_pcm_hw_params_t *hardwareParams;
     status_t err;
 
-    snd_pcm_uframes_t periodSize = 0, bufferSize = 0, reqBuffSize = 0;
-    unsigned int periodTime, bufferTime;
+    snd_pcm_uframes_t reqBuffSize = 0;
     unsigned int requestedRate = handle->sampleRate;
-    int numPeriods = 0;
-    char pwr[PROPERTY_VALUE_MAX];
-    int status = 0;
+    int reqLatency = 0;
+    PcmGeometry geometry;
 
     // snd_pcm_format_description() and snd_pcm_format_name() do not perform
     // proper bounds checking.
@@ -325,6 +374,7 @@ status_t setHardwareParams(alsa_handle_t *handle)
     const char* device = deviceName(handle,
                                     handle->curDev,
                                     AudioSystem::MODE_NORMAL);
+    bool pingPong = strcmp(device, MM_LP_DEVICE) == 0;
 
     if (snd_pcm_hw_params_malloc(&hardwareParams) < 0) {
         LOG_ALWAYS_FATAL("Failed to allocate ALSA hardware parameters!");
@@ -394,72 +444,27 @@ status_t setHardwareParams(alsa_handle_t *handle)
     else
         LOGV("Set %s sample rate to %u HZ", streamName(handle), requestedRate);
 
-    if (strcmp(device, MM_LP_DEVICE) == 0) {
-        numPeriods = 2;
-        LOGI("Using ping-pong!");
-    } else {
-        numPeriods = 4;
-        LOGI("Using FIFO");
-    }
+    reqLatency = requestedLatency(handle, &reqBuffSize);
+    // the time of the buffer of the defaults at the rate granted
+    if (reqLatency <= 0)
+        reqLatency = (int)((uint64_t)reqBuffSize * 1000000 / requestedRate);
 
-    //get the default array index
-    for (size_t i = 0; i < ARRAY_SIZE(_defaults); i++) {
-        if (_defaults[i].devices == handle->devices) {
-            reqBuffSize = _defaults[i].bufferSize;
-            break;
-        }
-    }
-    bufferSize = reqBuffSize;
-
-    // try the requested buffer size
-    err = snd_pcm_hw_params_set_buffer_size_near(handle->handle, hardwareParams,
-            &bufferSize);
-    if (err < 0) {
-        LOGE("Unable to set buffer size to %d:  %s",
-                (int)bufferSize, snd_strerror(err));
-        goto done;
-    }
-    // did we get what we asked for? we should.
-    if (bufferSize != reqBuffSize) {
-         LOGW("Requested buffer size %d not granted, got %d",
-                (int)reqBuffSize, (int)bufferSize);
-    }
-    // set the period size for our buffer
-    periodSize = bufferSize / numPeriods;
-    err = snd_pcm_hw_params_set_period_size_near(handle->handle,
-            hardwareParams, &periodSize, NULL);
-    if (err < 0) {
-        LOGE("Unable to set period size to %d:  %s", (int)periodSize, snd_strerror(err));
-        goto done;
-    }
-    // check our period time
-    err = snd_pcm_hw_params_get_period_time(hardwareParams, &periodTime, NULL);
-    if (err < 0) {
-        LOGE("Unable to get period time:  %s", snd_strerror(err));
-        goto done;
-    }
-    // get the buffer time
-    err = snd_pcm_hw_params_get_buffer_time(hardwareParams, &bufferTime, NULL);
-    if (err < 0) {
-        LOGE("Unable to set buffer time:  %s", snd_strerror(err));
-        goto done;
-    }
-    // get the buffer size again in case setting the period size changed it
-    err = snd_pcm_hw_params_get_buffer_size(hardwareParams, &bufferSize);
-    if (err < 0) {
-        LOGE("Unable to set buffer size:  %s", snd_strerror(err));
+    err = pcmSetGeometry(handle->handle, hardwareParams, reqLatency, pingPong, geometry);
+    if (err < 0)
         goto done;
-    }
 
-    if (strcmp(device, MM_LP_DEVICE) == 0) {
+    LOGI("Using %s: %u periods of %d frames", pingPong ? "ping-pong" : "FIFO",
+            geometry.periods, (int)geometry.periodSize);
+
+    if (pingPong) {
         // we have to overwrite our ALSA size if we want to
         // force Flinger to write for each period. This is done
         // here internally becuase the latency() API is defined as const
-        handle->bufferSize = periodSize;
-        handle->latency = periodTime;
+        handle->bufferSize = geometry.periodSize;
+        handle->latency = geometry.periodTime;
     } else {
-        handle->bufferSize = bufferSize;
-        handle->latency = bufferTime;
+        handle->bufferSize = geometry.bufferSize;
+        handle->latency = geometry.bufferTime;
     }
 
     LOGI("Buffer size: %d", (int)(handle->bufferSize));
@@ -556,208 +561,48 @@ status_t setSoftwareParams(alsa_handle_t *handle)
 void setAlsaControls(alsa_handle_t *handle, uint32_t devices, int mode, uint32_t channels)
 {
     LOGV("%s: devices %08x mode %d channels %08x", __FUNCTION__, devices, mode, channels);
-    ALSAControl control("hw:00");
 
-    /* check whether the devices is input or not */
-    /* for output devices */
-    if (devices & 0x0000FFFF){
-        if (devices & AudioSystem::DEVICE_OUT_SPEAKER) {
-            /* OMAP4 ABE */
-            control.set("DL2 Mixer Multimedia", 1);		// MM_DL    -> DL2 Mixer
-            control.set("DL2 Media Playback Volume", 118);
-            /* TWL6040 */
-            control.set("HF Left Playback", "HF DAC");		// HFDAC L -> HF Mux
-            control.set("HF Right Playback", "HF DAC");		// HFDAC R -> HF Mux
-            control.set("Handsfree Playback Volume", 23);
-            if (fm_enable) {
-                LOGE("FM Enabled, DL2 Capture-Playback Vol ON");
-                control.set("DL2 Capture Playback Volume", 115);
-                control.set("DL1 Capture Playback Volume", 0, -1);
-            }
-            else {
-                LOGI("FM Disabled, DL2 Capture-Playback Vol OFF");
-                control.set("DL2 Capture Playback Volume", 0, -1);
-            }
-            if (propMgr.setFromProperty((String8)Omap4ALSAManager::DL2_SPEAK_MONO_MIXER, (String8)"0") == NO_ERROR) {
-                String8 value;
-                if (propMgr.get((String8)Omap4ALSAManager::DL2_SPEAK_MONO_MIXER, value) == NO_ERROR) {
-                    LOGD("DL2 Mono Mixer value %s",value.string());
-                    control.set("DL2 Mono Mixer", atoi(value.string()));
-                }
-            }
-        } else {
-            /* OMAP4 ABE */
-            control.set("DL2 Mixer Multimedia", 0, 0);
-            control.set("DL2 Media Playback Volume", 0, -1);
-            control.set("DL2 Capture Playback Volume", 0, -1);
-            /* TWL6040 */
-            control.set("HF Left Playback", "Off");
-            control.set("HF Right Playback", "Off");
-            control.set("Handsfree Playback Volume", 0, -1);
-        }
+    routes->select(devices, fm_enable ? OMAP4_ROUTE_FM : 0);
+    if (routes->stage(*mixer) != NO_ERROR)
+        return;
 
-        if ((devices & AudioSystem::DEVICE_OUT_WIRED_HEADSET) ||
-            (devices & AudioSystem::DEVICE_OUT_LOW_POWER)) {
-            /* TWL6040 */
-            control.set("HS Left Playback", "HS DAC");		// HSDAC L -> HS Mux
-            control.set("HS Right Playback", "HS DAC");		// HSDAC R -> HS Mux
-            control.set("Headset Playback Volume", 15);
-            if (propMgr.setFromProperty((String8)Omap4ALSAManager::DL1_HEAD_MONO_MIXER, (String8)"0") == NO_ERROR) {
-                String8 value;
-                if (propMgr.get((String8)Omap4ALSAManager::DL1_HEAD_MONO_MIXER, value) == NO_ERROR) {
-                    LOGD("DL1 Mono Mixer value %s",value.string());
-                    control.set("DL1 Mono Mixer", atoi(value.string()));
-                }
-            }
-        } else {
-            /* TWL6040 */
-            control.set("HS Left Playback", "Off");
-            control.set("HS Right Playback", "Off");
-            control.set("Headset Playback Volume", 0, -1);
-        }
-
-        if (devices & AudioSystem::DEVICE_OUT_EARPIECE) {
-            /* TWL6040 */
-            control.set("EP Playback", "On");		// HSDACL -> Earpiece
-            control.set("Earphone Playback Volume", 15);
-            if (propMgr.setFromProperty((String8)Omap4ALSAManager::DL1_EAR_MONO_MIXER, (String8)"1") == NO_ERROR) {
-                String8 value;
-                if (propMgr.get((String8)Omap4ALSAManager::DL1_EAR_MONO_MIXER, value) == NO_ERROR) {
-                    LOGD("DL1 Mono Mixer value %s",value.string());
-                    control.set("DL1 Mono Mixer", atoi(value.string()));
-                }
-            }
-        } else {
-            /* TWL6040 */
-            control.set("Earphone Playback Volume", 0, -1);
-            control.set("EP Playback", "Off");
-        }
-        if ((devices & AudioSystem::DEVICE_OUT_EARPIECE) ||
-            (devices & AudioSystem::DEVICE_OUT_WIRED_HEADSET) ||
-            (devices & AudioSystem::DEVICE_OUT_LOW_POWER)) {
-            /* OMAP4 ABE */
-            control.set("DL1 Mixer Multimedia", 1);		// MM_DL    -> DL1 Mixer
-            control.set("Sidetone Mixer Playback", 1);		// DL1 Mixer-> Sidetone Mixer
-            control.set("SDT DL Volume", 118);
-            control.set("DL1 Media Playback Volume", 118);
-            control.set("DL1 PDM Switch", 1);
-            if (fm_enable) {
-                LOGI("FM Enabled, DL1 Capture-Playback Vol ON");
-                control.set("DL1 Capture Playback Volume", 115);
-                control.set("DL2 Capture Playback Volume", 0, -1);
-            }
-            else {
-                LOGI("FM Disabled, DL1 Capture-Playback Vol OFF");
-                control.set("DL1 Capture Playback Volume", 0, -1);
-            }
-        } else {
-            /* OMAP4 ABE */
-            control.set("DL1 Mixer Multimedia", 0, 0);
-            control.set("Sidetone Mixer Playback", 0, 0);
-            control.set("SDT DL Volume", 0, 0);
-            control.set("DL1 PDM Switch", 0, 0);
-            control.set("DL1 Media Playback Volume", 0, -1);
-            control.set("DL1 Capture Playback Volume", 0, -1);
-        }
-        if (devices & AudioSystem::DEVICE_OUT_FM_TRANSMIT) {
-            /* OMAP4 ABE */
-            control.set("DL1 Mixer Multimedia", 1);             // MM_DL    -> DL1 Mixer
-            control.set("Sidetone Mixer Playback", 1);          // DL1 Mixer-> Sidetone Mixer
-            control.set("SDT DL Volume", 118);
-            control.set("DL1 Media Playback Volume", 118);
-            control.set("DL1 MM_EXT Switch", 1);
-            control.set("DL1 PDM Switch", 0, 0);
-        } else {
-            /* Disable MM_EXT Switch */
-            control.set("DL1 MM_EXT Switch", 0, 0);
-        }
-        if ((devices & AudioSystem::DEVICE_OUT_BLUETOOTH_SCO) ||
-            (devices & AudioSystem::DEVICE_OUT_BLUETOOTH_SCO_HEADSET) ||
-            (devices & AudioSystem::DEVICE_OUT_BLUETOOTH_SCO_CARKIT)) {
-            /* OMAP4 ABE */
-            /* Bluetooth: DL1 Mixer */
-            control.set("DL1 Mixer Multimedia", 1);        // MM_DL    -> DL1 Mixer
-            control.set("Sidetone Mixer Playback", 1);     // DL1 Mixer-> Sidetone Mixer
-            control.set("SDT DL Volume", 118);
-            control.set("DL1 BT_VX Switch", 1);            // Sidetone Mixer -> BT-VX-DL
-            control.set("DL1 Media Playback Volume", 118);
-        } else {
-            control.set("DL1 BT_VX Switch", 0, 0);
+    /* what the routes leave to the properties */
+    /* for output devices */
+    if (devices & 0x0000FFFF) {
+        int value;
+        if (routes->isOn("speaker") &&
+            propMgr.setFromProperty(Omap4ALSAManager::DL2_SPEAK_MONO_MIXER, "0") == NO_ERROR &&
+            propMgr.get(Omap4ALSAManager::DL2_SPEAK_MONO_MIXER, value) == NO_ERROR) {
+            LOGD("DL2 Mono Mixer value %d", value);
+            mixer->set("DL2 Mono Mixer", value);
         }
-        if ((devices & AudioSystem::DEVICE_OUT_SPEAKER) ||
-            (devices & AudioSystem::DEVICE_OUT_AUX_DIGITAL)) {
-            // Setting DL2 EQ's to 800Hz cut-off frequency, as setting
-            // to flat response saturates the audio quality in the
-            // handsfree speakers
-            control.set("DL2 Left Equalizer", "High-pass 0dB");
-            control.set("DL2 Right Equalizer", "High-pass 0dB");
+        if (routes->isOn("headset") &&
+            propMgr.setFromProperty(Omap4ALSAManager::DL1_HEAD_MONO_MIXER, "0") == NO_ERROR &&
+            propMgr.get(Omap4ALSAManager::DL1_HEAD_MONO_MIXER, value) == NO_ERROR) {
+            LOGD("DL1 Mono Mixer value %d", value);
+            mixer->set("DL1 Mono Mixer", value);
         }
-        if ((devices & AudioSystem::DEVICE_OUT_WIRED_HEADSET) ||
-            (devices & AudioSystem::DEVICE_OUT_EARPIECE)) {
-            control.set("DL1 Equalizer", "Flat response");
+        if (routes->isOn("earpiece") &&
+            propMgr.setFromProperty(Omap4ALSAManager::DL1_EAR_MONO_MIXER, "1") == NO_ERROR &&
+            propMgr.get(Omap4ALSAManager::DL1_EAR_MONO_MIXER, value) == NO_ERROR) {
+            LOGD("DL1 Mono Mixer value %d", value);
+            mixer->set("DL1 Mono Mixer", value);
         }
-        control.set("TWL6040 Power Mode", "Low-Power");
-
     }
 
     /* for input devices */
     if (devices >> 16) {
-        if (devices & AudioSystem::DEVICE_IN_BUILTIN_MIC) {
+        if (routes->isOn("main-mic"))
             configMicChoices(devices);
-            /* TWL6040 */
-            control.set("Analog Left Capture Route", "Main Mic");	// Main Mic -> Mic Mux
-            control.set("Analog Right Capture Route", "Sub Mic");	// Sub Mic  -> Mic Mux
-            control.set("Capture Preamplifier Volume", 1);
-            control.set("Capture Volume", 4);
-        } else if (devices & AudioSystem::DEVICE_IN_WIRED_HEADSET) {
-            /* TWL6040 */
-            control.set("Analog Left Capture Route", "Headset Mic");	// Headset Mic -> Mic Mux
-            control.set("Analog Right Capture Route", "Headset Mic");	// Headset Mic -> Mic Mux
-            control.set("Capture Preamplifier Volume", 1);
-            control.set("Capture Volume", 4);
-            control.set("AMIC_UL PDM Switch", 1);
-            control.set("MUX_UL00", "AMic1");
-            control.set("MUX_UL11", "AMic0");
-        } else if (devices & OMAP4_IN_FM) {
-            /* TWL6040 */
-            control.set("Analog Left Capture Route", "Aux/FM Left");     // FM -> Mic Mux
-            control.set("Analog Right Capture Route", "Aux/FM Right");   // FM -> Mic Mux
-            control.set("Capture Preamplifier Volume", 1);
-            control.set("Capture Volume", 1);
-            control.set("AMIC_UL PDM Switch", 1);
-            control.set("MUX_UL10", "AMic1");
-            control.set("MUX_UL11", "AMic0");
-        } else if(devices & OMAP4_IN_SCO) {
-            LOGI("OMAP4 ABE set for BT SCO Headset");
-            control.set("AMIC_UL PDM Switch", 0, 0);
-            control.set("MUX_UL00", "BT Right");
-            control.set("MUX_UL01", "BT Left");
-            control.set("MUX_UL10", "BT Right");
-            control.set("MUX_UL11", "BT Left");
-            control.set("BT UL Volume", 120);
-            control.set("Voice Capture Mixer Capture", 1);
-        } else if (devices & AudioSystem::DEVICE_IN_VOICE_CALL) {
-            LOGI("OMAP4 ABE set for VXREC");
-            configVoiceMemo (channels);
-            control.set("MUX_UL00", "VX Right");
-            control.set("MUX_UL01", "VX Left");
-        } else {
-            /* TWL6040 */
-            control.set("Analog Left Capture Route", "Off");
-            control.set("Analog Right Capture Route", "Off");
-            control.set("Capture Preamplifier Volume", 0, -1);
-            control.set("Capture Volume", 0, -1);
-            control.set("BT UL VOlume", 0, -1);        // BT UL --> MUTE
-            control.set("Voice Capture Mixer Capture", 0, 0);
-            control.set("AMIC_UL PDM Switch", 0, 0);
-            /* ABE */
-            control.set("MUX_UL00", "None");
-            control.set("MUX_UL01", "None");
-            control.set("MUX_UL10", "None");
-            control.set("MUX_UL11", "None");
-        }
+        else if (routes->isOn("voice-memo"))
+            configVoiceMemo(channels);
     }
 
+    // only what the new route sets differently reaches the card
+    if (mixer->apply() < 0)
+        LOGE("Route %08x not fully set", devices);
+    routes->commit();
+
     handle->curDev = devices;
     handle->curMode = mode;
     handle->curChannels = channels;
@@ -788,42 +633,44 @@ static status_t s_init(alsa_device_t *module, ALSAHandleList &list)
     audioModem = new AudioModemAlsa();
 #endif
 
-    propMgr = Omap4ALSAManager();
+    if (!mixer)
+        mixer = new ALSAControlCache("hw:00");
+    if (mixer->initCheck() != NO_ERROR)
+        LOGE("No mixer controls, routes won't be set");
+    if (!routes)
+        routes = new ALSARouteGraph(omap4Routes, omap4RouteCount);
+    if (!pcmCache) {
+        char hold[PROPERTY_VALUE_MAX];
+        property_get("omap.audio.standby.hold", hold, "");
+        pcmCache = new ALSAStreamCache(hold[0] ? milliseconds(atoi(hold)) :
+                                       milliseconds(ALSAStreamCache::DEFAULT_HOLD));
+        pcmCache->run("ALSAStreamCache", PRIORITY_NORMAL);
+    }
+
+    propMgr.clear();
 
     // initialize mics and power mode from system property defaults
-    status = propMgr.setFromProperty((String8)Omap4ALSAManager::MAIN_MIC);
-    status = propMgr.setFromProperty((String8)Omap4ALSAManager::SUB_MIC);
-    status = propMgr.setFromProperty((String8)Omap4ALSAManager::POWER_MODE);
-
-    // initialize other tunable parameters with internal default values
-    status = propMgr.set((String8)Omap4ALSAManager::DL2L_EQ_PROFILE,
-                         (String8)Omap4ALSAManager::EqualizerProfileList[1]);
-    status = propMgr.set((String8)Omap4ALSAManager::DL2R_EQ_PROFILE,
-                         (String8)Omap4ALSAManager::EqualizerProfileList[1]);
-    status = propMgr.set((String8)Omap4ALSAManager::DL1_EQ_PROFILE,
-                         (String8)Omap4ALSAManager::EqualizerProfileList[0]);
-    status = propMgr.set((String8)Omap4ALSAManager::AMIC_EQ_PROFILE,
-                         (String8)Omap4ALSAManager::EqualizerProfileList[1]);
-    status = propMgr.set((String8)Omap4ALSAManager::DMIC_EQ_PROFILE,
-                         (String8)Omap4ALSAManager::EqualizerProfileList[1]);
-    status = propMgr.set((String8)Omap4ALSAManager::DL1_EAR_MONO_MIXER,
-                         (String8)"1");
-    status = propMgr.set((String8)Omap4ALSAManager::DL1_HEAD_MONO_MIXER,
-                         (String8)"0");
-    status = propMgr.set((String8)Omap4ALSAManager::DL2_SPEAK_MONO_MIXER,
-                         (String8)"0");
-    status = propMgr.set((String8)Omap4ALSAManager::DL2_AUX_MONO_MIXER,
-                         (String8)"0");
+    status = propMgr.setFromProperty(Omap4ALSAManager::MAIN_MIC);
+    status = propMgr.setFromProperty(Omap4ALSAManager::SUB_MIC);
+    status = propMgr.setFromProperty(Omap4ALSAManager::POWER_MODE);
+
+    // initialize other tunable parameters with internal default values,
+    // the items of the lists by index
+    status = propMgr.set(Omap4ALSAManager::DL2L_EQ_PROFILE, 1);
+    status = propMgr.set(Omap4ALSAManager::DL2R_EQ_PROFILE, 1);
+    status = propMgr.set(Omap4ALSAManager::DL1_EQ_PROFILE, 0);
+    status = propMgr.set(Omap4ALSAManager::AMIC_EQ_PROFILE, 1);
+    status = propMgr.set(Omap4ALSAManager::DMIC_EQ_PROFILE, 1);
+    status = propMgr.set(Omap4ALSAManager::DL1_EAR_MONO_MIXER, 1);
+    status = propMgr.set(Omap4ALSAManager::DL1_HEAD_MONO_MIXER, 0);
+    status = propMgr.set(Omap4ALSAManager::DL2_SPEAK_MONO_MIXER, 0);
+    status = propMgr.set(Omap4ALSAManager::DL2_AUX_MONO_MIXER, 0);
 
     // initialize voice memo gains: multimedia and tone are not recorded by default
-    status = propMgr.set((String8)Omap4ALSAManager::VOICEMEMO_VUL_GAIN,
-                         (String8)"0");
-    status = propMgr.set((String8)Omap4ALSAManager::VOICEMEMO_VDL_GAIN,
-                         (String8)"0");
-    status = propMgr.set((String8)Omap4ALSAManager::VOICEMEMO_MM_GAIN,
-                         (String8)"-120");
-    status = propMgr.set((String8)Omap4ALSAManager::VOICEMEMO_TONE_GAIN,
-                         (String8)"-120");
+    status = propMgr.set(Omap4ALSAManager::VOICEMEMO_VUL_GAIN, 0);
+    status = propMgr.set(Omap4ALSAManager::VOICEMEMO_VDL_GAIN, 0);
+    status = propMgr.set(Omap4ALSAManager::VOICEMEMO_MM_GAIN, -120);
+    status = propMgr.set(Omap4ALSAManager::VOICEMEMO_TONE_GAIN, -120);
 
     return NO_ERROR;
 }
@@ -855,10 +702,29 @@ static status_t s_open(alsa_handle_t *handle, uint32_t devices, int mode, uint32
     audioModem->voiceCallControls(devices, mode, true);
 #endif
 
+    // Out of standby in the configuration it went in, the PCM parked then
+    // only needs preparing. FM opens again for its mixer settings.
+    ALSAStreamCache::Config config;
+    ALSAStreamCache::Granted granted;
+    bool cached = !fm_enable && !(devices & OMAP4_IN_FM);
+    streamConfig(handle, devName, config);
+    if (cached && (handle->handle = pcmCache->resume(config, granted)) != NULL) {
+        handle->bufferSize = granted.bufferSize;
+        handle->latency = granted.latency;
+        mActive = true;
+        LOGI("Resumed ALSA %s device '%s'", stream, devName);
+        return NO_ERROR;
+    }
+
     // The PCM stream is opened in blocking mode, per ALSA defaults.  The
     // AudioFlinger seems to assume blocking mode too, so asynchronous mode
     // should not be used.
     int err = snd_pcm_open(&handle->handle, devName, direction(handle), 0);
+    if (err == -EBUSY) {
+        // another stream's PCM parked on the same device
+        pcmCache->flush();
+        err = snd_pcm_open(&handle->handle, devName, direction(handle), 0);
+    }
 
     if (err < 0) {
         LOGE("Failed to initialize ALSA %s device '%s': %s", stream, devName, strerror(err));
@@ -873,6 +739,12 @@ static status_t s_open(alsa_handle_t *handle, uint32_t devices, int mode, uint32
 
     if (err == NO_ERROR) err = setSoftwareParams(handle);
 
+    if (err == NO_ERROR && cached) {
+        granted.bufferSize = handle->bufferSize;
+        granted.latency = handle->latency;
+        pcmCache->add(handle->handle, config, granted);
+    }
+
     LOGI("Initialized ALSA %s device '%s'", stream, devName);
 
     if (fm_enable) {
@@ -898,11 +770,7 @@ static status_t s_close(alsa_handle_t *handle)
     handle->curMode = 0;
     handle->curChannels = 0;
     if (h) {
-        snd_pcm_drain(h);
-        err = snd_pcm_close(h);
-        LOGV("snd_pcm_close(%p): %s(%d) ", h,
-             err != 0 ? strerror(err) : "no error",
-             err != 0 ? err : 0);
+        err = pcmCache->close(h);
         mActive = false;
     }
 
@@ -911,9 +779,10 @@ static status_t s_close(alsa_handle_t *handle)
 
 /*
     this is same as s_close, but don't discard
-    the device/mode info. This way we can still
-    close the device, hit idle and power-save, reopen the pcm
-    for the same device/mode after resuming
+    the device/mode info. The PCM is drained and parked
+    in pcmCache: an open for the same device/mode resumes
+    it, or it is closed at the end of the hold time to hit
+    idle and power-save
 */
 static status_t s_standby(alsa_handle_t *handle)
 {
@@ -922,13 +791,8 @@ static status_t s_standby(alsa_handle_t *handle)
     handle->handle = 0;
     LOGV("In omap4 standby\n");
     if (h) {
-        snd_pcm_drain(h);
-        err = snd_pcm_close(h);
-        LOGV("snd_pcm_close(%p): %s(%d) ", h,
-             err != 0 ? strerror(err) : "no error",
-             err != 0 ? err : 0);
+        err = pcmCache->park(h);
         mActive = false;
-        LOGE("called drain&close\n");
     }
 
     return err;
@@ -993,27 +857,25 @@ static status_t s_voicevolume(float volume)
 static status_t s_set(const String8& keyValuePairs)
 {
     AudioParameter p = AudioParameter(keyValuePairs);
-    String8 key = (String8) Omap4ALSAManager::MAIN_MIC;
     String8 value;
-    unsigned int i = 0;
 
     LOGI("set:: %s", keyValuePairs.string());
-    while (i < propMgr.size()) {
-        if (p.get(propMgr.mParams.keyAt(i), value) == NO_ERROR) {
-            if(propMgr.set(propMgr.mParams.keyAt(i), value) == BAD_VALUE) {
-                LOGE("PropMgr.set failed to validate new value for %s=%s",
-                      propMgr.mParams.keyAt(i).string(), value.string());
-            }
-            else {
-                LOGV("PropMgr.set %s::%s", propMgr.mParams.keyAt(i).string(), value.string());
-                // @TODO: update any controls that should
-                // based on which property was KVP was sent
-                p.remove(key);
-            }
-            // we found it, so...
-            break;
+    for (int i = 0; i < Omap4ALSAManager::PARAM_COUNT; i++) {
+        Omap4ALSAManager::Param param = (Omap4ALSAManager::Param)i;
+        String8 key = String8(Omap4ALSAManager::keyOf(param));
+
+        if (p.get(key, value) != NO_ERROR)
+            continue;
+        if (propMgr.set(param, value.string()) == BAD_VALUE) {
+            LOGE("PropMgr.set failed to validate new value for %s=%s",
+                  key.string(), value.string());
+        }
+        else {
+            LOGV("PropMgr.set %s::%s", key.string(), value.string());
+            // @TODO: update any controls that should
+            // based on which property was KVP was sent
+            p.remove(key);
         }
-        i++;
     }
     if (p.size()) {
         return BAD_VALUE;
@@ -1024,52 +886,48 @@ static status_t s_set(const String8& keyValuePairs)
 
 void configMicChoices (uint32_t devices) {
 
-    ALSAControl control("hw:00");
-    String8 keyMain = (String8)Omap4ALSAManager::MAIN_MIC;
-    String8 keySub = (String8)Omap4ALSAManager::SUB_MIC;
-    String8 main;
-    String8 sub;
+    const char *main = "";
+    const char *sub = "";
 
-    if(propMgr.get(keyMain, main) == NO_ERROR)
-        control.set("MUX_UL00", main.string());
+    if(propMgr.get(Omap4ALSAManager::MAIN_MIC, main) == NO_ERROR)
+        mixer->set("MUX_UL00", main);
 
-    if(propMgr.get(keySub, sub) == NO_ERROR)
-        control.set("MUX_UL01", sub.string());
+    if(propMgr.get(Omap4ALSAManager::SUB_MIC, sub) == NO_ERROR)
+        mixer->set("MUX_UL01", sub);
 
     // if either mic is analog, turn on AMIC_UL_PDM switch
-    if(strncmp(main.string(), "A", 1) == 0 ||
-        strncmp(sub.string() , "A", 1) == 0) {
-        control.set("AMIC_UL PDM Switch", 1);
+    if(strncmp(main, "A", 1) == 0 ||
+        strncmp(sub, "A", 1) == 0) {
+        mixer->set("AMIC_UL PDM Switch", 1);
     } else {
-        control.set("AMIC_UL PDM Switch", 0, 0);
+        mixer->set("AMIC_UL PDM Switch", 0, 0);
     }
     // if mic is digital, turn up the associated gain
-    if(strncmp(main.string(), "DMic0", 5) == 0 ||
-        strncmp(sub.string() , "DMic0", 5) == 0) {
-        control.set("DMIC1 UL Volume", 120);      // DMIC1: 1dB=Mute --> 149dB
-    } else if(strncmp(main.string(), "DMic1", 5) == 0 ||
-        strncmp(sub.string() , "DMic1", 5) == 0) {
-        control.set("DMIC2 UL Volume", 120);      // DMIC2: 1dB=Mute --> 149dB
-    } else if(strncmp(main.string(), "DMic2", 5) == 0 ||
-        strncmp(sub.string() , "DMic2", 5) == 0) {
-        control.set("DMIC3 UL Volume", 120);      // DMIC3: 1dB=Mute --> 149dB
+    if(strncmp(main, "DMic0", 5) == 0 ||
+        strncmp(sub, "DMic0", 5) == 0) {
+        mixer->set("DMIC1 UL Volume", 120);      // DMIC1: 1dB=Mute --> 149dB
+    } else if(strncmp(main, "DMic1", 5) == 0 ||
+        strncmp(sub, "DMic1", 5) == 0) {
+        mixer->set("DMIC2 UL Volume", 120);      // DMIC2: 1dB=Mute --> 149dB
+    } else if(strncmp(main, "DMic2", 5) == 0 ||
+        strncmp(sub, "DMic2", 5) == 0) {
+        mixer->set("DMIC3 UL Volume", 120);      // DMIC3: 1dB=Mute --> 149dB
     } else {
-        control.set("DMIC1 UL Volume", 1);        // DMIC1 -> MUTE
-        control.set("DMIC2 UL Volume", 1);        // DMIC1 -> MUTE
-        control.set("DMIC3 UL Volume", 1);        // DMIC1 -> MUTE
+        mixer->set("DMIC1 UL Volume", 1);        // DMIC1 -> MUTE
+        mixer->set("DMIC2 UL Volume", 1);        // DMIC1 -> MUTE
+        mixer->set("DMIC3 UL Volume", 1);        // DMIC1 -> MUTE
     }
-    LOGI("main mic selected %s", main.string());
-    LOGI("sub mic selected %s", sub.string());
+    LOGI("main mic selected %s", main);
+    LOGI("sub mic selected %s", sub);
 
 }
 
 void configEqualizer (uint32_t devices) {
 
-    ALSAControl control("hw:00");
 
     if ((devices & AudioSystem::DEVICE_IN_BUILTIN_MIC) ||
         (devices & AudioSystem::DEVICE_IN_BACK_MIC)) {
-        control.set("DMIC Equalizer", "Flat response");
+        mixer->set("DMIC Equalizer", "Flat response");
     }
 
     if ((devices & AudioSystem::DEVICE_IN_BUILTIN_MIC) ||
@@ -1077,8 +935,9 @@ void configEqualizer (uint32_t devices) {
         (devices & AudioSystem::DEVICE_IN_WIRED_HEADSET) ||
         (devices & AudioSystem::DEVICE_IN_AUX_DIGITAL) ||
         (devices & AudioSystem::DEVICE_IN_FM_ANALOG)) {
-        control.set("AMIC Equalizer", "Flat response");
+        mixer->set("AMIC Equalizer", "Flat response");
     }
+    mixer->apply();
 }
 static status_t s_resetDefaults(alsa_handle_t *handle)
 {
@@ -1087,16 +946,15 @@ static status_t s_resetDefaults(alsa_handle_t *handle)
 
 void configVoiceMemo (uint32_t channels) {
 
-    ALSAControl control("hw:00");
     int voiceUlGain = -120;
     int voiceDlGain = -120;
     int voiceMmGain = -120;
     int voiceToneGain = -120;
 
-    propMgr.get((String8)Omap4ALSAManager::VOICEMEMO_VUL_GAIN, voiceUlGain);
-    propMgr.get((String8)Omap4ALSAManager::VOICEMEMO_VDL_GAIN, voiceDlGain);
-    propMgr.get((String8)Omap4ALSAManager::VOICEMEMO_MM_GAIN, voiceMmGain);
-    propMgr.get((String8)Omap4ALSAManager::VOICEMEMO_TONE_GAIN, voiceToneGain);
+    propMgr.get(Omap4ALSAManager::VOICEMEMO_VUL_GAIN, voiceUlGain);
+    propMgr.get(Omap4ALSAManager::VOICEMEMO_VDL_GAIN, voiceDlGain);
+    propMgr.get(Omap4ALSAManager::VOICEMEMO_MM_GAIN, voiceMmGain);
+    propMgr.get(Omap4ALSAManager::VOICEMEMO_TONE_GAIN, voiceToneGain);
 
     // conversion from properties to ABE HAL gains:
     // Voice call record gains properties:
@@ -1111,33 +969,33 @@ void configVoiceMemo (uint32_t channels) {
     voiceToneGain += 120;
 
     if (voiceMmGain)
-        control.set("Capture Mixer Media Playback", 1);
+        mixer->set("Capture Mixer Media Playback", 1);
     else
-        control.set("Capture Mixer Media Playback", 0, 0);
+        mixer->set("Capture Mixer Media Playback", 0, 0);
     if (voiceToneGain)
-        control.set("Capture Mixer Tones", 1);
+        mixer->set("Capture Mixer Tones", 1);
     else
-        control.set("Capture Mixer Tones", 0, 0);
+        mixer->set("Capture Mixer Tones", 0, 0);
 
-    control.set("VXREC Media Volume", voiceMmGain);
-    control.set("VXREC Tones Volume", voiceToneGain);
+    mixer->set("VXREC Media Volume", voiceMmGain);
+    mixer->set("VXREC Tones Volume", voiceToneGain);
 
 
     if (channels & AudioSystem::CHANNEL_IN_VOICE_UPLINK) {
-        control.set("Capture Mixer Voice Capture", 1);
-        control.set("Capture Mixer Voice Playback", 0, 0);
-        control.set("VXREC Voice UL Volume", voiceUlGain);
-        control.set("VXREC Voice DL Volume", 0 ,0);
+        mixer->set("Capture Mixer Voice Capture", 1);
+        mixer->set("Capture Mixer Voice Playback", 0, 0);
+        mixer->set("VXREC Voice UL Volume", voiceUlGain);
+        mixer->set("VXREC Voice DL Volume", 0 ,0);
     } else if (channels & AudioSystem::CHANNEL_IN_VOICE_DNLINK) {
-        control.set("Capture Mixer Voice Capture", 0, 0);
-        control.set("Capture Mixer Voice Playback", 1);
-        control.set("VXREC Voice DL Volume", voiceDlGain);
-        control.set("VXREC Voice UL Volume", 0, 0);
+        mixer->set("Capture Mixer Voice Capture", 0, 0);
+        mixer->set("Capture Mixer Voice Playback", 1);
+        mixer->set("VXREC Voice DL Volume", voiceDlGain);
+        mixer->set("VXREC Voice UL Volume", 0, 0);
     } else if (channels & AudioSystem::CHANNEL_IN_VOICE_UPLINK_DNLINK) {
-        control.set("Capture Mixer Voice Capture", 1);
-        control.set("Capture Mixer Voice Playback", 1);
-        control.set("VXREC Voice UL Volume", voiceUlGain);
-        control.set("VXREC Voice DL Volume", voiceDlGain);
+        mixer->set("Capture Mixer Voice Capture", 1);
+        mixer->set("Capture Mixer Voice Playback", 1);
+        mixer->set("VXREC Voice UL Volume", voiceUlGain);
+        mixer->set("VXREC Voice DL Volume", voiceDlGain);
     }
 }
 }
@@ -19,6 +19,7 @@
 #define ANDROID_ALSA_OMAP4
 
 #include "Omap4ALSAManager.h"
+#include "ALSARouteGraph.h"
 
 #ifdef AUDIO_MODEM_TI
 #include "audio_modem_interface.h"
@@ -77,4 +78,14 @@
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(x[0]))
 
+// route flags
+#define OMAP4_ROUTE_FM      0x00000001  // FM radio looped back to the outputs
+
+namespace android
+{
+// the mixer routes, alsa_omap4_routes.cpp
+extern const RoutePath omap4Routes[];
+extern const size_t omap4RouteCount;
+}
+
 #endif    // ANDROID_ALSA_OMAP4
@@ -20,7 +20,6 @@
 #include <utils/Log.h>
 #include <cutils/properties.h>
 #include <dlfcn.h>
-#include <pthread.h>
 
 #include "AudioHardwareALSA.h"
 #include <media/AudioRecord.h>
@@ -55,9 +54,6 @@ voiceCallVolumeProp[] = {
 #define WORKAROUND_AVOID_VOICE_VOLUME_MIN   1
 #define WORKAROUND_MIN_VOICE_VOLUME         90
 
-// Pointer to Thread local info
-voiceCallControlLocalInfo    *mInfo;
-
 // Properties manager
 Omap4ALSAManager propModemMgr;
 // ----------------------------------------------------------------------------
@@ -66,40 +62,10 @@ Omap4ALSAManager propModemMgr;
                                      __FUNCTION__, __LINE__); \
                                 return error; \
                             }
-#define mAlsaControl mInfo->mAlsaControl
-// ----------------------------------------------------------------------------
-#if !LOG_NDEBUG
-// Mutex counter for debug
-static int voiceCallControlMutexCount = 0;
-#endif
-extern "C"
-{
-    void *VoiceCallControlsThreadStartup(void *_mAudioModemAlsa) {
-        LOGV("%s",__FUNCTION__);
-        AudioModemAlsa *mAudioModemAlsa = (AudioModemAlsa * )_mAudioModemAlsa;
-        mAudioModemAlsa->voiceCallControlsThread();
-        delete mAudioModemAlsa;
-        return (NULL);
-    }
-
-    static pthread_key_t   mVoiceCallControlThreadKey;
-    void voiceCallControlInitThreadOnce(void)
-    {
-        status_t error = NO_ERROR;
-        LOGV("%s",__FUNCTION__);
-        error = pthread_key_create(&mVoiceCallControlThreadKey,
-                                    NULL);
-        if (error != NO_ERROR) {
-            LOGE("Can't create the Voice Call Control Thread key");
-            exit(error);
-        }
-    }
-}
 // ----------------------------------------------------------------------------
 AudioModemAlsa::AudioModemAlsa()
 {
     status_t error;
-    pthread_attr_t  mVoiceCallControlAttr;
 
     LOGV("Build date: %s time: %s", __DATE__, __TIME__);
 
@@ -119,7 +85,6 @@ AudioModemAlsa::AudioModemAlsa()
         LOGE("No Audio Modem Interface found.");
         exit(-1);
     }
-    mVoiceCallState = AUDIO_MODEM_VOICE_CALL_OFF;
 
     // Initialize Min and Max volume
     int i = 0;
@@ -151,61 +116,59 @@ AudioModemAlsa::AudioModemAlsa()
         i++;
     }
 
-    // Initialize voice call control key once
-    mVoiceCallControlKeyOnce = PTHREAD_ONCE_INIT;
-
-    // Initialize voice call control mutex
-    pthread_mutex_init(&mVoiceCallControlMutex, NULL);
-
-    // Initialize voice call control param condition
-    // This is used to wake up Voice call control thread when
-    // new param is available
-    pthread_cond_init(&mVoiceCallControlNewParams, NULL);
+    // Properties manager init
+    propModemMgr.clear();
+
+    // initialize all equalizers to flat response for voice call,
+    // high-pass 0dB for the microphones that have no flat one.
+    propModemMgr.set(Omap4ALSAManager::DL2L_EQ_PROFILE, 0);
+    propModemMgr.set(Omap4ALSAManager::DL2R_EQ_PROFILE, 0);
+    propModemMgr.set(Omap4ALSAManager::DL1_EQ_PROFILE, 0);
+    propModemMgr.set(Omap4ALSAManager::AMIC_EQ_PROFILE, 1);
+    propModemMgr.set(Omap4ALSAManager::DMIC_EQ_PROFILE, 1);
+    propModemMgr.set(Omap4ALSAManager::SDT_EQ_PROFILE, 0);
+
+    mControl = new VoiceCallControl(mModem, "hw:00", AUDIO_MODEM_PCM_HANDLE_NAME);
+    if (mControl->initCheck() != NO_ERROR) {
+        LOGE("Voice call controls can't reach the codec");
+        delete mModem;
+        exit(-1);
+    }
 
-    // Initialize and set thread detached attribute
-    pthread_attr_init(&mVoiceCallControlAttr);
-    pthread_attr_setdetachstate(&mVoiceCallControlAttr, PTHREAD_CREATE_JOINABLE);
+    // what each audio modem mode asks of the calls
+    for (size_t i = 0; i < mDevicePropList.size(); i++) {
+        AudioModemDeviceProperties *deviceProp = mDevicePropList.valueAt(i);
+        const char *sampleRate =
+                deviceProp->settingsList[AUDIO_MODEM_VOICE_CALL_SAMPLERATE].name;
+        VoiceCallConfig config;
 
-    voiceCallControlsMutexLock();
-    mVoiceCallControlMainInfo.updateFlag = false;
-    voiceCallControlsMutexUnlock();
+        config.multiMic = !strcmp(
+                deviceProp->settingsList[AUDIO_MODEM_VOICE_CALL_MULTIMIC].name, "Yes");
+        if (!strcmp(sampleRate, "auto")) {
+            config.sampleRate = AudioModemInterface::INVALID_SAMPLE_RATE;
+        } else if (!strcmp(sampleRate, "16Khz")) {
+            config.sampleRate = AudioModemInterface::PCM_16_KHZ;
+        } else {
+            config.sampleRate = AudioModemInterface::PCM_8_KHZ;
+        }
+        mControl->setConfig(deviceProp->audioMode, config);
+    }
+    configEqualizers();
 
-    // Create thread for voice control
-    error = pthread_create(&mVoiceCallControlThread, &mVoiceCallControlAttr,
-                            VoiceCallControlsThreadStartup, (void *)this);
+    error = mControl->run("VoiceCallControl", PRIORITY_URGENT_AUDIO);
     if (error != NO_ERROR) {
-        LOGE("Error creating mVoiceCallControlThread");
+        LOGE("Error creating the voice call control thread");
         delete mModem;
         exit(error);
     }
-    pthread_attr_destroy(&mVoiceCallControlAttr);
-
-    // Properties manager init
-    propModemMgr = Omap4ALSAManager();
-
-    // initialize all equalizers to flat response for voice call.
-    propModemMgr.set((String8)Omap4ALSAManager::DL2L_EQ_PROFILE,
-                        (String8)Omap4ALSAManager::EqualizerProfileList[0]);
-    propModemMgr.set((String8)Omap4ALSAManager::DL2R_EQ_PROFILE,
-                        (String8)Omap4ALSAManager::EqualizerProfileList[0]);
-    propModemMgr.set((String8)Omap4ALSAManager::DL1_EQ_PROFILE,
-                        (String8)Omap4ALSAManager::EqualizerProfileList[0]);
-    propModemMgr.set((String8)Omap4ALSAManager::AMIC_EQ_PROFILE,
-                        (String8)Omap4ALSAManager::EqualizerProfileList[1]);
-    propModemMgr.set((String8)Omap4ALSAManager::DMIC_EQ_PROFILE,
-                        (String8)Omap4ALSAManager::EqualizerProfileList[1]);
-    propModemMgr.set((String8)Omap4ALSAManager::SDT_EQ_PROFILE,
-                        (String8)Omap4ALSAManager::EqualizerProfileList[0]);
 }
 
 AudioModemAlsa::~AudioModemAlsa()
 {
     LOGD("Destroy devices for Modem OMAP4 ALSA module");
+    delete mControl;
     mDevicePropList.clear();
     if (mModem) delete mModem;
-
-    pthread_mutex_destroy(&mVoiceCallControlMutex);
-    pthread_kill(mVoiceCallControlThread, SIGKILL);
 }
 
 AudioModemInterface* AudioModemAlsa::create()
@@ -311,781 +274,20 @@ status_t AudioModemAlsa::voiceCallControls(uint32_t devices, int mode, bool mult
 {
     LOGV("%s: devices %04x mode %d MultimediaUpdate %d", __FUNCTION__, devices, mode, multimediaUpdate);
 
-    // Ignore input devices
-    if (!(devices & AudioSystem::DEVICE_IN_ALL)) {
-        if ((mVoiceCallControlMainInfo.devices != devices) ||
-            (mVoiceCallControlMainInfo.mode != mode) ||
-            (multimediaUpdate)) {
-            voiceCallControlsMutexLock();
-            mVoiceCallControlMainInfo.devices = devices;
-            mVoiceCallControlMainInfo.mode = mode;
-            mVoiceCallControlMainInfo.updateFlag = true;
-            mVoiceCallControlMainInfo.multimediaUpdate = multimediaUpdate;
-            voiceCallControlsMutexUnlock();
-            pthread_cond_signal(&mVoiceCallControlNewParams);
-        }
-    }
+    // Check mics config, the control thread picks them up with the request
+    microphoneChosen();
+    mControl->request(devices, mode, multimediaUpdate);
     return NO_ERROR;
 }
 
 void AudioModemAlsa::voiceCallControlsMutexLock(void)
 {
-    LOGV("%s: %d", __FUNCTION__, ++voiceCallControlMutexCount);
-    pthread_mutex_lock(&mVoiceCallControlMutex);
+    mControl->lock();
 }
 
 void AudioModemAlsa::voiceCallControlsMutexUnlock(void)
 {
-    LOGV("%s: %d", __FUNCTION__, --voiceCallControlMutexCount);
-    pthread_mutex_unlock(&mVoiceCallControlMutex);
-}
-
-void AudioModemAlsa::voiceCallControlsThread(void)
-{
-    status_t error = NO_ERROR;
-    ALSAControl alsaControl("hw:00");
-
-    error = pthread_once(&mVoiceCallControlKeyOnce,
-                           voiceCallControlInitThreadOnce);
-    if (error != NO_ERROR) {
-        LOGE("Error in voiceCallControlInitThreadOnce");
-        goto exit;
-    }
-
-    mInfo = (voiceCallControlLocalInfo *)malloc(sizeof(voiceCallControlLocalInfo));
-    if (mInfo == NULL) {
-        LOGE("Error allocating mVoiceCallControlThreadInfo");
-        error = NO_MEMORY;
-        goto exit;
-    }
-
-    error = pthread_setspecific(mVoiceCallControlThreadKey, mInfo);
-    if (error != NO_ERROR) {
-        LOGE("Error in Voice Call info set specific");
-        goto exit;
-    }
-
-    mInfo->devices = 0;
-    mInfo->mode = AudioSystem::MODE_INVALID;
-    mAlsaControl = &alsaControl;
-
-    for (;;) {
-        voiceCallControlsMutexLock();
-        // Wait for new parameters
-        if (!mVoiceCallControlMainInfo.updateFlag) {
-            pthread_cond_wait(&mVoiceCallControlNewParams, &mVoiceCallControlMutex);
-        }
-        mVoiceCallControlMainInfo.updateFlag = false;
-        mInfo = (voiceCallControlLocalInfo *)pthread_getspecific(mVoiceCallControlThreadKey);
-        if (mInfo == NULL) {
-            LOGE("Error in Voice Call info get specific");
-            goto exit;
-        }
-        mInfo->devices = mVoiceCallControlMainInfo.devices;
-        mInfo->mode = mVoiceCallControlMainInfo.mode;
-        mInfo->multimediaUpdate = mVoiceCallControlMainInfo.multimediaUpdate;
-        voiceCallControlsMutexUnlock();
-        LOGV("%s: devices %04x mode %d forceUpdate %d", __FUNCTION__, mInfo->devices, mInfo->mode,
-                                                                    mInfo->multimediaUpdate);
-
-        // Check mics config
-        error = microphoneChosen();
-        if (error < 0) goto exit;
-
-        if ((mInfo->mode == AudioSystem::MODE_IN_CALL) &&
-            (mVoiceCallState == AUDIO_MODEM_VOICE_CALL_OFF)) {
-            // enter in voice call mode
-            error = setCurrentAudioModemModes(mInfo->devices);
-            if (error < 0) goto exit;
-            mDeviceProp = mDevicePropList.valueFor(mCurrentAudioModemModes);
-            error = voiceCallModemSet();
-            if (error < 0) goto exit;
-            voiceCallControlsMutexLock();
-            error = voiceCallCodecSet();
-            voiceCallControlsMutexUnlock();
-            if (error < 0) goto exit;
-            mVoiceCallState = AUDIO_MODEM_VOICE_CALL_ON;
-        } else if ((mInfo->mode == AudioSystem::MODE_IN_CALL) &&
-                (mVoiceCallState == AUDIO_MODEM_VOICE_CALL_ON)) {
-            // update in voice call mode
-            mPreviousAudioModemModes = mCurrentAudioModemModes;
-            error = setCurrentAudioModemModes(mInfo->devices);
-            if (error < 0) {
-                mCurrentAudioModemModes = mPreviousAudioModemModes;
-                goto exit;
-            }
-            mDevicePropPrevious = mDeviceProp;
-            mDeviceProp = mDevicePropList.valueFor(mCurrentAudioModemModes);
-            if (mCurrentAudioModemModes != mPreviousAudioModemModes) {
-                error = voiceCallModemUpdate();
-                if (error < 0) goto exit;
-                voiceCallControlsMutexLock();
-                error = voiceCallCodecUpdate();
-                voiceCallControlsMutexUnlock();
-                if (error < 0) goto exit;
-            } else if (mInfo->multimediaUpdate) {
-                voiceCallControlsMutexLock();
-                error = multimediaCodecUpdate();
-                voiceCallControlsMutexUnlock();
-                if (error < 0) goto exit;
-            } else {
-                LOGI("Audio Modem Mode doesn't changed: no update needed");
-            }
-        } else if ((mInfo->mode != AudioSystem::MODE_IN_CALL) &&
-                (mVoiceCallState == AUDIO_MODEM_VOICE_CALL_ON)) {
-            // we just exit voice call mode
-            mPreviousAudioModemModes = 0;
-            mCurrentAudioModemModes = 0;
-            error = voiceCallModemReset();
-            if (error < 0) goto exit;
-            voiceCallControlsMutexLock();
-            error = voiceCallCodecReset();
-            voiceCallControlsMutexUnlock();
-            if (error < 0) goto exit;
-            mVoiceCallState = AUDIO_MODEM_VOICE_CALL_OFF;
-        }
-    } // for(;;)
-
-exit:
-    LOGE("%s: exit with error %d (%s)", __FUNCTION__, error, strerror(error));
-    pthread_exit((void*) error);
-}
-
-status_t AudioModemAlsa::setCurrentAudioModemModes(uint32_t devices)
-{
-    if (devices & AudioModemInterface::AUDIO_MODEM_HANDSET) {
-        mCurrentAudioModemModes = AudioModemInterface::AUDIO_MODEM_HANDSET;
-    } else if (devices & AudioModemInterface::AUDIO_MODEM_HANDFREE) {
-        mCurrentAudioModemModes = AudioModemInterface::AUDIO_MODEM_HANDFREE;
-    } else if (devices & AudioModemInterface::AUDIO_MODEM_HEADSET) {
-        mCurrentAudioModemModes = AudioModemInterface::AUDIO_MODEM_HEADSET;
-#ifdef AUDIO_BLUETOOTH
-    } else if (devices & AudioModemInterface::AUDIO_MODEM_BLUETOOTH) {
-        mCurrentAudioModemModes = AudioModemInterface::AUDIO_MODEM_BLUETOOTH;
-#endif
-    } else {
-        LOGE("Devices %04x not supported...", devices);
-        if (!mCurrentAudioModemModes) {
-            LOGE("No current devices switch to AUDIO_MODEM_HANDSET...");
-            mCurrentAudioModemModes = AudioModemInterface::AUDIO_MODEM_HANDSET;
-        } else {
-            LOGE("Stay on the current devices: %04x...", mCurrentAudioModemModes);
-        }
-        return NO_ERROR;
-    }
-    LOGV("New Audio Modem Modes: %04x", mCurrentAudioModemModes);
-    return NO_ERROR;
-}
-
-status_t AudioModemAlsa::voiceCallCodecSet()
-{
-    status_t error = NO_ERROR;
-
-    LOGV("Start Audio Codec Voice call: %04x", mCurrentAudioModemModes);
-
-    if (mCurrentAudioModemModes & AudioModemInterface::AUDIO_MODEM_HANDSET) {
-        error = voiceCallCodecSetHandset();
-    } else if (mCurrentAudioModemModes & AudioModemInterface::AUDIO_MODEM_HANDFREE) {
-        error = voiceCallCodecSetHandfree();
-    } else if (mCurrentAudioModemModes & AudioModemInterface::AUDIO_MODEM_HEADSET) {
-        error = voiceCallCodecSetHeadset();
-#ifdef AUDIO_BLUETOOTH
-    } else if (mCurrentAudioModemModes & AudioModemInterface::AUDIO_MODEM_BLUETOOTH) {
-        error = voiceCallCodecSetBluetooth();
-#endif
-    } else {
-        LOGE("Audio Modem mode not supported: %04x", mCurrentAudioModemModes);
-        return INVALID_OPERATION;
-    }
-
-    error = voiceCallCodecPCMSet();
-    error = voiceCallSidetoneSet(mCurrentAudioModemModes);
-
-    return error;
-}
-
-status_t AudioModemAlsa::voiceCallCodecPCMSet()
-{
-    int error;
-    unsigned int sampleRate;
-
-    if ((error = snd_pcm_open(&cHandle,
-                    AUDIO_MODEM_PCM_HANDLE_NAME,
-                    SND_PCM_STREAM_CAPTURE, 0)) < 0) {
-        LOGE("Modem PCM capture open error: %d:%s", error, snd_strerror(error));
-        return INVALID_OPERATION;
-    }
-    LOGV("snd_pcm_open(%p, %s, SND_PCM_STREAM_CAPTURE, 0)", cHandle, AUDIO_MODEM_PCM_HANDLE_NAME);
-
-    if ((error = snd_pcm_open(&pHandle,
-                    AUDIO_MODEM_PCM_HANDLE_NAME,
-                    SND_PCM_STREAM_PLAYBACK, 0)) < 0) {
-        LOGE("Modem PCM playback open error: %d:%s", error, snd_strerror(error));
-        return INVALID_OPERATION;
-    }
-    LOGV("snd_pcm_open(%p, %s, SND_PCM_STREAM_PLAYBACK, 0)", pHandle, AUDIO_MODEM_PCM_HANDLE_NAME);
-
-    if (!strcmp(mDeviceProp->settingsList[AUDIO_MODEM_VOICE_CALL_SAMPLERATE].name,
-                "auto")) {
-        if (mVoiceCallSampleRate == AudioModemInterface::PCM_16_KHZ) {
-            sampleRate = 16000;
-        } else {
-            sampleRate = 8000;
-        }
-    }
-    else if (!strcmp(mDeviceProp->settingsList[AUDIO_MODEM_VOICE_CALL_SAMPLERATE].name,
-                "16Khz")) {
-        sampleRate = 16000;
-    } else {
-        sampleRate = 8000;
-    }
-
-    if ((error = snd_pcm_set_params(cHandle,
-                    SND_PCM_FORMAT_S16_LE,
-                    SND_PCM_ACCESS_RW_INTERLEAVED,
-                    2,
-                    sampleRate,
-                    1,
-                    AUDIO_MODEM_PCM_LATENCY)) < 0) {
-        LOGE("Modem PCM capture params error: %s", snd_strerror(error));
-        return INVALID_OPERATION;
-    }
-    if ((error = snd_pcm_set_params(pHandle,
-                    SND_PCM_FORMAT_S16_LE,
-                    SND_PCM_ACCESS_RW_INTERLEAVED,
-                    2,
-                    sampleRate,
-                    1,
-                    AUDIO_MODEM_PCM_LATENCY)) < 0) {
-        LOGE("Modem PCM playback params error: %s", snd_strerror(error));
-        return INVALID_OPERATION;
-    }
-
-    if ((error = snd_pcm_start(cHandle)) < 0) {
-        LOGE("Modem PCM capture start error: %d:%s", error, snd_strerror(error));
-        return INVALID_OPERATION;
-    }
-    if ((error = snd_pcm_start(pHandle)) < 0) {
-        LOGE("Modem PCM playback start error: %d:%s", error, snd_strerror(error));
-        return INVALID_OPERATION;
-    }
-
-    return NO_ERROR;
-}
-
-status_t AudioModemAlsa::voiceCallCodecPCMReset()
-{
-    int error;
-
-    if ((error = snd_pcm_drop(cHandle)) < 0) {
-        LOGE("Modem PCM capture drop error: %s", snd_strerror(error));
-        return INVALID_OPERATION;
-    }
-    if ((error = snd_pcm_drop(pHandle)) < 0) {
-        LOGE("Modem PCM playback drop error: %s", snd_strerror(error));
-        return INVALID_OPERATION;
-    }
-
-    if ((error = snd_pcm_close(cHandle)) < 0) {
-        LOGE("Modem PCM capture close error: %s", snd_strerror(error));
-        return INVALID_OPERATION;
-    }
-    LOGV("snd_pcm_close(%p)", cHandle);
-
-    if ((error = snd_pcm_close(pHandle)) < 0) {
-        LOGE("Modem PCM playback close error: %s", snd_strerror(error));
-        return INVALID_OPERATION;
-    }
-    LOGV("snd_pcm_close(%p)", pHandle);
-
-    return NO_ERROR;
-}
-
-status_t AudioModemAlsa::voiceCallCodecSetHandset()
-{
-    status_t error = NO_ERROR;
-    String8 keyMain = (String8)Omap4ALSAManager::MAIN_MIC;
-    String8 keySub = (String8)Omap4ALSAManager::SUB_MIC;
-    String8 main;
-    String8 sub;
-
-    // Enable Playback voice path
-    CHECK_ERROR(mAlsaControl->set("EP Playback", "On"), error);
-    CHECK_ERROR(mAlsaControl->set("Earphone Playback Volume", AUDIO_CODEC_EARPIECE_GAIN), error);
-    CHECK_ERROR(mAlsaControl->set("DL1 Mono Mixer", 1), error);
-    CHECK_ERROR(mAlsaControl->set("DL1 Mixer Voice", 1), error);
-    CHECK_ERROR(mAlsaControl->set("Sidetone Mixer Playback", 1), error);
-    CHECK_ERROR(mAlsaControl->set("DL1 PDM Switch", 1), error);
-    CHECK_ERROR(mAlsaControl->set("SDT DL Volume",
-                                AUDIO_ABE_SIDETONE_DL_VOL_HANDSET, -1), error);
-    // Enable Capture voice path
-    CHECK_ERROR(propModemMgr.get(keyMain, main), error);
-    CHECK_ERROR(propModemMgr.get(keySub, sub), error);
-    if ((strncmp(main.string(), "A", 1) == 0) ||
-        (strncmp(sub.string(), "A", 1) == 0)) {
-        CHECK_ERROR(mAlsaControl->set("Analog Left Capture Route", "Main Mic"), error);
-        if (!strcmp(mDeviceProp->settingsList[AUDIO_MODEM_VOICE_CALL_MULTIMIC].name,
-                    "Yes")) {
-            LOGV("dual mic. enabled");
-
-            // Enable Sub mic
-            CHECK_ERROR(mAlsaControl->set("Analog Right Capture Route", "Sub Mic"),
-                                            error);
-        }
-        CHECK_ERROR(mAlsaControl->set("Capture Preamplifier Volume",
-                                    AUDIO_CODEC_CAPTURE_PREAMP_ATT_HANDSET, -1), error);
-        CHECK_ERROR(mAlsaControl->set("Capture Volume",
-                                    AUDIO_CODEC_CAPTURE_VOL_HANDSET, -1), error);
-    }
-    CHECK_ERROR(mAlsaControl->set("AUDUL Voice UL Volume",
-                                AUDIO_ABE_AUDUL_VOICE_VOL_HANDSET, -1), error);
-    CHECK_ERROR(configMicrophones(), error);
-    CHECK_ERROR(configEqualizers(), error);
-
-    return error;
-}
-
-status_t AudioModemAlsa::voiceCallCodecSetHandfree()
-{
-    status_t error = NO_ERROR;
-    String8 keyMain = (String8)Omap4ALSAManager::MAIN_MIC;
-    String8 keySub = (String8)Omap4ALSAManager::SUB_MIC;
-    String8 main;
-    String8 sub;
-
-    // Enable Playback voice path
-    CHECK_ERROR(mAlsaControl->set("HF Left Playback", "HF DAC"), error);
-    CHECK_ERROR(mAlsaControl->set("HF Right Playback", "HF DAC"), error);
-    CHECK_ERROR(mAlsaControl->set("Handsfree Playback Volume", AUDIO_CODEC_HANDFREE_GAIN), error);
-    CHECK_ERROR(mAlsaControl->set("DL2 Mono Mixer", 1), error);
-    CHECK_ERROR(mAlsaControl->set("DL2 Mixer Voice", 1), error);
-    CHECK_ERROR(mAlsaControl->set("SDT DL Volume",
-                                AUDIO_ABE_SIDETONE_DL_VOL_HANDFREE, -1), error);
-
-    // Enable Capture voice path
-    CHECK_ERROR(propModemMgr.get(keyMain, main), error);
-    CHECK_ERROR(propModemMgr.get(keySub, sub), error);
-    if ((strncmp(main.string(), "A", 1) == 0) ||
-        (strncmp(sub.string(), "A", 1) == 0)) {
-        CHECK_ERROR(mAlsaControl->set("Analog Left Capture Route", "Main Mic"), error);
-        if (!strcmp(mDeviceProp->settingsList[AUDIO_MODEM_VOICE_CALL_MULTIMIC].name,
-                    "Yes")) {
-            LOGV("dual mic. enabled");
-
-            // Enable Sub mic
-            CHECK_ERROR(mAlsaControl->set("Analog Right Capture Route", "Sub Mic"),
-                                            error);
-        }
-        CHECK_ERROR(mAlsaControl->set("Capture Preamplifier Volume",
-                                    AUDIO_CODEC_CAPTURE_PREAMP_ATT_HANDFREE, -1), error);
-        CHECK_ERROR(mAlsaControl->set("Capture Volume",
-                                    AUDIO_CODEC_CAPTURE_VOL_HANDFREE, -1), error);
-    }
-    CHECK_ERROR(mAlsaControl->set("AUDUL Voice UL Volume",
-                                AUDIO_ABE_AUDUL_VOICE_VOL_HANDFREE, -1), error);
-    CHECK_ERROR(configMicrophones(), error);
-    CHECK_ERROR(configEqualizers(), error);
-
-    return error;
-}
-
-status_t AudioModemAlsa::voiceCallCodecSetHeadset()
-{
-    status_t error = NO_ERROR;
-
-    // Enable Playback voice path
-    CHECK_ERROR(mAlsaControl->set("HS Left Playback", "HS DAC"), error);
-    CHECK_ERROR(mAlsaControl->set("HS Right Playback", "HS DAC"), error);
-    CHECK_ERROR(mAlsaControl->set("Headset Playback Volume", AUDIO_CODEC_HEADSET_GAIN), error);
-    CHECK_ERROR(mAlsaControl->set("DL1 Mono Mixer", 1), error);
-    CHECK_ERROR(mAlsaControl->set("DL1 Mixer Voice", 1), error);
-    CHECK_ERROR(mAlsaControl->set("Sidetone Mixer Playback", 1), error);
-    CHECK_ERROR(mAlsaControl->set("DL1 PDM Switch", 1), error);
-    CHECK_ERROR(mAlsaControl->set("SDT DL Volume",
-                                AUDIO_ABE_SIDETONE_DL_VOL_HEADSET, -1), error);
-
-    // Enable Capture voice path
-    CHECK_ERROR(mAlsaControl->set("Analog Left Capture Route", "Headset Mic"), error);
-    CHECK_ERROR(mAlsaControl->set("Analog Right Capture Route", "Headset Mic"), error);
-    CHECK_ERROR(mAlsaControl->set("Capture Preamplifier Volume",
-                                AUDIO_CODEC_CAPTURE_PREAMP_ATT_HEADSET, -1), error);
-    CHECK_ERROR(mAlsaControl->set("Capture Volume",
-                                AUDIO_CODEC_CAPTURE_VOL_HEADSET, -1), error);
-    CHECK_ERROR(mAlsaControl->set("AUDUL Voice UL Volume",
-                                AUDIO_ABE_AUDUL_VOICE_VOL_HEADSET, -1), error);
-    CHECK_ERROR(configMicrophones(), error);
-    CHECK_ERROR(configEqualizers(), error);
-
-    return error;
-}
-
-#ifdef AUDIO_BLUETOOTH
-status_t AudioModemAlsa::voiceCallCodecSetBluetooth()
-{
-    status_t error = NO_ERROR;
-
-    // Enable Playback voice path
-    CHECK_ERROR(mAlsaControl->set("DL1 Mono Mixer", 1), error);
-    CHECK_ERROR(mAlsaControl->set("DL1 Mixer Voice", 1), error);
-    CHECK_ERROR(mAlsaControl->set("Sidetone Mixer Playback", 1), error);
-    CHECK_ERROR(mAlsaControl->set("SDT DL Volume",
-                                AUDIO_ABE_SIDETONE_DL_VOL_BLUETOOTH, -1), error);
-
-    // Enable Capture voice path
-    CHECK_ERROR(mAlsaControl->set("AUDUL Voice UL Volume",
-                                AUDIO_ABE_AUDUL_VOICE_VOL_BLUETOOTH, -1), error);
-    CHECK_ERROR(mAlsaControl->set("DL1 PDM Switch", 0, 0), error);
-    CHECK_ERROR(mAlsaControl->set("DL1 BT_VX Switch", 1), error);
-    CHECK_ERROR(configMicrophones(), error);
-    CHECK_ERROR(configEqualizers(), error);
-
-    return error;
-}
-#endif
-
-status_t AudioModemAlsa::voiceCallCodecUpdateHandset()
-{
-    status_t error = NO_ERROR;
-
-    switch (mPreviousAudioModemModes) {
-    case AudioModemInterface::AUDIO_MODEM_HANDFREE:
-        // Disable the ABE DL2 mixer used for Voice
-        CHECK_ERROR(mAlsaControl->set("DL2 Mixer Voice", 0, 0), error);
-        CHECK_ERROR(mAlsaControl->set("DL2 Mono Mixer", 0, 0), error);
-        CHECK_ERROR(voiceCallCodecSetHandset(), error);
-        break;
-
-    case AudioModemInterface::AUDIO_MODEM_HEADSET:
-    case AudioModemInterface::AUDIO_MODEM_BLUETOOTH:
-        CHECK_ERROR(voiceCallCodecSetHandset(), error);
-        break;
-
-    case AudioModemInterface::AUDIO_MODEM_HANDSET:
-    default:
-        LOGE("%s: Wrong mPreviousAudioModemModes: %04x",
-                __FUNCTION__,
-                mPreviousAudioModemModes);
-        error = INVALID_OPERATION;
-        break;
-
-    } //switch (mPreviousAudioModemModes)
-
-    return error;
-}
-
-status_t AudioModemAlsa::voiceCallCodecUpdateHandfree()
-{
-    status_t error = NO_ERROR;
-
-    switch (mPreviousAudioModemModes) {
-    case AudioModemInterface::AUDIO_MODEM_HANDSET:
-    case AudioModemInterface::AUDIO_MODEM_HEADSET:
-    case AudioModemInterface::AUDIO_MODEM_BLUETOOTH:
-        // Disable the ABE DL1 mixer used for Voice
-        CHECK_ERROR(mAlsaControl->set("DL1 Mixer Voice", 0, 0), error);
-        CHECK_ERROR(mAlsaControl->set("DL1 Mono Mixer", 0, 0), error);
-        CHECK_ERROR(voiceCallCodecSetHandfree(), error);
-        break;
-
-    case AudioModemInterface::AUDIO_MODEM_HANDFREE:
-    default:
-        LOGE("%s: Wrong mPreviousAudioModemModes: %04x",
-                __FUNCTION__,
-                mPreviousAudioModemModes);
-        error = INVALID_OPERATION;
-        break;
-
-    } //switch (mPreviousAudioModemModes)
-
-    return error;
-}
-
-status_t AudioModemAlsa::voiceCallCodecUpdateHeadset()
-{
-    status_t error = NO_ERROR;
-
-    switch (mPreviousAudioModemModes) {
-    case AudioModemInterface::AUDIO_MODEM_HANDFREE:
-        // Disable the ABE DL2 mixer used for Voice
-        CHECK_ERROR(mAlsaControl->set("DL2 Mixer Voice", 0, 0), error);
-        CHECK_ERROR(mAlsaControl->set("DL2 Mono Mixer", 0, 0), error);
-        CHECK_ERROR(voiceCallCodecSetHeadset(), error);
-        break;
-
-    case AudioModemInterface::AUDIO_MODEM_HANDSET:
-    case AudioModemInterface::AUDIO_MODEM_BLUETOOTH:
-        CHECK_ERROR(voiceCallCodecSetHeadset(), error);
-        break;
-
-    case AudioModemInterface::AUDIO_MODEM_HEADSET:
-    default:
-        LOGE("%s: Wrong mPreviousAudioModemModes: %04x",
-                __FUNCTION__,
-                mPreviousAudioModemModes);
-        error = INVALID_OPERATION;
-        break;
-
-    } //switch (mPreviousAudioModemModes)
-
-    return error;
-}
-
-#ifdef AUDIO_BLUETOOTH
-status_t AudioModemAlsa::voiceCallCodecUpdateBluetooth()
-{
-    status_t error = NO_ERROR;
-
-    switch (mPreviousAudioModemModes) {
-    case AudioModemInterface::AUDIO_MODEM_HANDFREE:
-        // Disable the ABE DL2 mixer used for Voice
-        CHECK_ERROR(mAlsaControl->set("DL2 Mixer Voice", 0, 0), error);
-        CHECK_ERROR(mAlsaControl->set("DL2 Mono Mixer", 0, 0), error);
-        CHECK_ERROR(voiceCallCodecSetBluetooth(), error);
-    case AudioModemInterface::AUDIO_MODEM_HANDSET:
-    case AudioModemInterface::AUDIO_MODEM_HEADSET:
-        CHECK_ERROR(voiceCallCodecSetBluetooth(), error);
-        break;
-
-    case AudioModemInterface::AUDIO_MODEM_BLUETOOTH:
-    default:
-        LOGE("%s: Wrong mPreviousAudioModemModes: %04x",
-                __FUNCTION__,
-                mPreviousAudioModemModes);
-        error = INVALID_OPERATION;
-        break;
-
-    } //switch (mPreviousAudioModemModes)
-
-    return error;
-}
-#endif // AUDIO_BLUETOOTH
-
-status_t AudioModemAlsa::voiceCallCodecUpdate()
-{
-    status_t error = NO_ERROR;
-
-    LOGV("Update Audio Codec Voice call: %04x", mCurrentAudioModemModes);
-
-    if (mCurrentAudioModemModes & AudioModemInterface::AUDIO_MODEM_HANDSET) {
-        error = voiceCallCodecPCMReset();
-        error = voiceCallCodecUpdateHandset();
-    } else if (mCurrentAudioModemModes & AudioModemInterface::AUDIO_MODEM_HANDFREE) {
-        error = voiceCallCodecPCMReset();
-        error = voiceCallCodecUpdateHandfree();
-    } else if (mCurrentAudioModemModes & AudioModemInterface::AUDIO_MODEM_HEADSET) {
-        error = voiceCallCodecPCMReset();
-        error = voiceCallCodecUpdateHeadset();
-#ifdef AUDIO_BLUETOOTH
-    } else if (mCurrentAudioModemModes & AudioModemInterface::AUDIO_MODEM_BLUETOOTH) {
-        error = voiceCallCodecPCMReset();
-        error = voiceCallCodecUpdateBluetooth();
-#endif
-    } else {
-        LOGE("Audio Modem mode not supported: %04x", mCurrentAudioModemModes);
-        return INVALID_OPERATION;
-    }
-
-    error = voiceCallCodecPCMSet();
-    error = voiceCallSidetoneSet(mCurrentAudioModemModes);
-
-    return error;
-}
-
-status_t AudioModemAlsa::multimediaCodecUpdate()
-{
-    status_t error = NO_ERROR;
-
-    CHECK_ERROR(mAlsaControl->set("DL1 Mono Mixer", 1), error);
-    CHECK_ERROR(mAlsaControl->set("DL2 Mono Mixer", 1), error);
-    configEqualizers();
-
-    return error;
-}
-
-status_t AudioModemAlsa::voiceCallSidetoneSet(int mCurrentAudioModemModes)
-{
-    status_t error = NO_ERROR;
-
-    CHECK_ERROR(mAlsaControl->set("Sidetone Mixer Capture", 1), error);
-
-    if (mCurrentAudioModemModes & AudioModemInterface::AUDIO_MODEM_HANDSET) {
-        CHECK_ERROR(mAlsaControl->set("SDT UL Volume",
-                                AUDIO_ABE_SIDETONE_UL_VOL_HANDSET, -1), error);
-    } else if (mCurrentAudioModemModes &
-                                AudioModemInterface::AUDIO_MODEM_HANDFREE) {
-        CHECK_ERROR(mAlsaControl->set("SDT UL Volume",
-                                AUDIO_ABE_SIDETONE_UL_VOL_HANDFREE, -1), error);
-    } else if (mCurrentAudioModemModes &
-                                AudioModemInterface::AUDIO_MODEM_HEADSET) {
-        CHECK_ERROR(mAlsaControl->set("SDT UL Volume",
-                                AUDIO_ABE_SIDETONE_UL_VOL_HEADSET, -1), error);
-#ifdef AUDIO_BLUETOOTH
-    } else if (mCurrentAudioModemModes &
-                                AudioModemInterface::AUDIO_MODEM_BLUETOOTH) {
-        CHECK_ERROR(mAlsaControl->set("SDT UL Volume",
-                                AUDIO_ABE_SIDETONE_UL_VOL_BLUETOOTH, -1),
-                                error);
-#endif
-    } else {
-        LOGE("Audio Modem mode not supported: %04x", mCurrentAudioModemModes);
-        CHECK_ERROR(mAlsaControl->set("Sidetone Mixer Capture", 0, 0), error);
-        return INVALID_OPERATION;
-    }
-    return error;
-}
-
-status_t AudioModemAlsa::voiceCallSidetoneReset()
-{
-    status_t error = NO_ERROR;
-    // Disable Sidetone
-    CHECK_ERROR(mAlsaControl->set("SDT UL Volume", 0, -1), error);
-    CHECK_ERROR(mAlsaControl->set("Sidetone Mixer Capture", 0, 0), error);
-
-    return error;
-}
-
-status_t AudioModemAlsa::voiceCallCodecReset()
-{
-    status_t error = NO_ERROR;
-
-    LOGV("Stop Audio Codec Voice call");
-    error = voiceCallSidetoneReset();
-
-    error = voiceCallCodecPCMReset();
-
-    error = voiceCallCodecStop();
-
-    return error;
-}
-
-status_t AudioModemAlsa::voiceCallCodecStop()
-{
-    status_t error = NO_ERROR;
-
-    // Enable Playback voice path
-    CHECK_ERROR(mAlsaControl->set("DL1 Mixer Voice", 0, 0), error);
-    CHECK_ERROR(mAlsaControl->set("DL2 Mixer Voice", 0, 0), error);
-    CHECK_ERROR(mAlsaControl->set("DL1 Mono Mixer", 0, 0), error);
-    CHECK_ERROR(mAlsaControl->set("DL2 Mono Mixer", 0, 0), error);
-
-    // Enable Capture voice path
-    CHECK_ERROR(mAlsaControl->set("Analog Left Capture Route", "Off"), error);
-    CHECK_ERROR(mAlsaControl->set("Analog Right Capture Route", "Off"), error);
-    CHECK_ERROR(mAlsaControl->set("Capture Preamplifier Volume", 0, -1), error);
-    CHECK_ERROR(mAlsaControl->set("Capture Volume", 0, -1), error);
-
-    CHECK_ERROR(mAlsaControl->set("AMIC_UL PDM Switch", 0, 0), error);
-    CHECK_ERROR(mAlsaControl->set("MUX_VX0", "None"), error);
-    CHECK_ERROR(mAlsaControl->set("MUX_VX1", "None"), error);
-    CHECK_ERROR(mAlsaControl->set("AUDUL Voice UL Volume", 0, -1), error);
-    CHECK_ERROR(mAlsaControl->set("Voice Capture Mixer Capture", 0, 0), error);
-
-    return error;
-}
-
-status_t AudioModemAlsa::voiceCallModemSet()
-{
-    status_t error = NO_ERROR;
-
-    LOGV("Start Audio Modem Voice call");
-
-
-    if (!strcmp(mDeviceProp->settingsList[AUDIO_MODEM_VOICE_CALL_SAMPLERATE].name,
-                "auto")) {
-        mVoiceCallSampleRate = mModem->GetVoiceCallSampleRate();
-        LOGV("Sample rate used for this voice call: %d", mVoiceCallSampleRate);
-        if ((mVoiceCallSampleRate == AudioModemInterface::INVALID_SAMPLE_RATE) ||
-            (mVoiceCallSampleRate == AudioModemInterface::PCM_44_1_KHZ))  {
-            LOGE("Invalid Sample rate used for this voice call set to 8KHz");
-            mVoiceCallSampleRate = AudioModemInterface::PCM_8_KHZ;
-        }
-    }
-
-    if (!strcmp(mDeviceProp->settingsList[AUDIO_MODEM_VOICE_CALL_SAMPLERATE].name,
-                "16Khz")) {
-        mVoiceCallSampleRate = AudioModemInterface::PCM_16_KHZ;
-    } else {
-        mVoiceCallSampleRate = AudioModemInterface::PCM_8_KHZ;
-    }
-    error = mModem->setModemRouting(mCurrentAudioModemModes,
-            mVoiceCallSampleRate);
-    if (error < 0) {
-        LOGE("Unable to set Modem Voice Call routing: %s", strerror(error));
-        return error;
-    }
-
-    if (!strcmp(mDeviceProp->settingsList[AUDIO_MODEM_VOICE_CALL_MULTIMIC].name,
-                "Yes")) {
-        error =  mModem->setModemVoiceCallMultiMic(
-                    AudioModemInterface::MODEM_DOUBLE_MIC);
-
-    } else {
-        error =  mModem->setModemVoiceCallMultiMic(
-                    AudioModemInterface::MODEM_SINGLE_MIC);
-    }
-    if (error < 0) {
-        LOGE("Unable to set Modem Voice Call multimic.: %s", strerror(error));
-        return error;
-    }
-
-    error =  mModem->OpenModemVoiceCallStream();
-    if (error < 0) {
-        LOGE("Unable to open Modem Voice Call stream: %s", strerror(error));
-        return error;
-    }
-
-    return error;
-}
-
-status_t AudioModemAlsa::voiceCallModemUpdate()
-{
-    status_t error = NO_ERROR;
-
-    LOGV("Update Audio Modem Voice call");
-
-    if (!strcmp(mDeviceProp->settingsList[AUDIO_MODEM_VOICE_CALL_SAMPLERATE].name,
-                "16Khz")) {
-        mVoiceCallSampleRate = AudioModemInterface::PCM_16_KHZ;
-    } else {
-        mVoiceCallSampleRate = AudioModemInterface::PCM_8_KHZ;
-    }
-    error = mModem->setModemRouting(mCurrentAudioModemModes,
-            mVoiceCallSampleRate);
-    if (error < 0) {
-        LOGE("Unable to set Modem Voice Call routing: %s", strerror(error));
-        return error;
-    }
-
-    if (!strcmp(mDeviceProp->settingsList[AUDIO_MODEM_VOICE_CALL_MULTIMIC].name,
-                "Yes")) {
-        error =  mModem->setModemVoiceCallMultiMic(
-                    AudioModemInterface::MODEM_DOUBLE_MIC);
-
-    } else {
-        error =  mModem->setModemVoiceCallMultiMic(
-                    AudioModemInterface::MODEM_SINGLE_MIC);
-    }
-    if (error < 0) {
-        LOGE("Unable to set Modem Voice Call multimic.: %s", strerror(error));
-        return error;
-    }
-
-    return error;
-}
-
-status_t AudioModemAlsa::voiceCallModemReset()
-{
-    status_t error = NO_ERROR;
-
-    LOGV("Stop Audio Modem Voice call");
-
-    error = mModem->CloseModemVoiceCallStream();
-    if (error < 0) {
-        LOGE("Unable to close Modem Voice Call stream: %s", strerror(error));
-        return error;
-    }
-
-    return error;
+    mControl->unlock();
 }
 
 status_t AudioModemAlsa::voiceCallVolume(ALSAControl *alsaControl, float volume)
@@ -1119,154 +321,40 @@ status_t AudioModemAlsa::voiceCallVolume(ALSAControl *alsaControl, float volume)
 status_t AudioModemAlsa::microphoneChosen(void)
 {
     status_t error = NO_ERROR;
+    const char *main;
+    const char *sub;
 
     // initialize mics from system property defaults
-    CHECK_ERROR(propModemMgr.setFromProperty((String8)Omap4ALSAManager::MAIN_MIC,
-                (const String8)"AMic0"), error);
-    CHECK_ERROR(propModemMgr.setFromProperty((String8)Omap4ALSAManager::SUB_MIC,
-                (const String8)"AMic1"), error);
-
-    return error;
-}
-
-status_t AudioModemAlsa::configMicrophones(void)
-{
-    ALSAControl control("hw:00");
-    String8 keyMain = (String8)Omap4ALSAManager::MAIN_MIC;
-    String8 keySub = (String8)Omap4ALSAManager::SUB_MIC;
-    String8 main;
-    String8 sub;
-    status_t error = NO_ERROR;
-    char dmicVolumeName[20];
-    char dmicMainName[7], dmicSubName[7];
+    CHECK_ERROR(propModemMgr.setFromProperty(Omap4ALSAManager::MAIN_MIC, "AMic0"), error);
+    CHECK_ERROR(propModemMgr.setFromProperty(Omap4ALSAManager::SUB_MIC, "AMic1"), error);
 
-    CHECK_ERROR(propModemMgr.get(keyMain, main), error);
-    CHECK_ERROR(propModemMgr.get(keySub, sub), error);
-
-    strcpy(dmicMainName ,main.string());
-    strcpy(dmicSubName ,sub.string());
-
-    switch (mCurrentAudioModemModes) {
-    case AudioModemInterface::AUDIO_MODEM_HANDFREE:
-        if ((strncmp(dmicMainName, "D", 1) == 0) &&
-            (strncmp(dmicSubName, "D", 1) == 0)) {
-            CHECK_ERROR(control.set("AMIC_UL PDM Switch", 0, 0), error);
-        } else {
-            CHECK_ERROR(control.set("AMIC_UL PDM Switch", 1), error);
-            CHECK_ERROR(control.set("AMIC UL Volume",
-                        AUDIO_ABE_AMIC_UL_VOL_HANDFREE, -1), error);
-        }
-
-        if (strncmp(dmicMainName, "D", 1) == 0) {
-            sprintf(dmicVolumeName, "DMIC%c UL Volume", dmicMainName[4] + 1);
-            CHECK_ERROR(control.set(dmicVolumeName,
-                        AUDIO_ABE_DMIC_MAIN_UL_VOL_HANDFREE, -1), error);
-        }
-        if (strncmp(dmicSubName, "D", 1) == 0) {
-            sprintf(dmicVolumeName, "DMIC%c UL Volume", dmicMainName[4] + 1);
-            CHECK_ERROR(control.set(dmicVolumeName,
-                        AUDIO_ABE_DMIC_SUB_UL_VOL_HANDFREE, -1), error);
-        }
-
-        CHECK_ERROR(control.set("MUX_VX0", dmicMainName), error);
-        if (!strcmp(mDeviceProp->settingsList[AUDIO_MODEM_VOICE_CALL_MULTIMIC].name,
-                    "Yes")) {
-            CHECK_ERROR(control.set("MUX_VX1", dmicSubName), error);
-        } else {
-            CHECK_ERROR(control.set("MUX_VX1", dmicMainName), error);
-        }
-        break;
-
-    case AudioModemInterface::AUDIO_MODEM_HANDSET:
-        if ((strncmp(dmicMainName, "D", 1) == 0) &&
-            (strncmp(dmicSubName, "D", 1) == 0)) {
-            CHECK_ERROR(control.set("AMIC_UL PDM Switch", 0, 0), error);
-        } else {
-            CHECK_ERROR(control.set("AMIC_UL PDM Switch", 1), error);
-            CHECK_ERROR(control.set("AMIC UL Volume",
-                        AUDIO_ABE_AMIC_UL_VOL_HANDSET, -1), error);
-        }
-
-        if (strncmp(dmicMainName, "D", 1) == 0) {
-            sprintf(dmicVolumeName, "DMIC%c UL Volume", dmicMainName[4] + 1);
-            CHECK_ERROR(control.set(dmicVolumeName,
-                        AUDIO_ABE_DMIC_MAIN_UL_VOL_HANDSET, -1), error);
-        }
-        if (strncmp(dmicSubName, "D", 1) == 0) {
-            sprintf(dmicVolumeName, "DMIC%c UL Volume", dmicMainName[4] + 1);
-            CHECK_ERROR(control.set(dmicVolumeName,
-                        AUDIO_ABE_DMIC_SUB_UL_VOL_HANDSET, -1), error);
-        }
-
-        CHECK_ERROR(control.set("MUX_VX0", dmicMainName), error);
-        if (!strcmp(mDeviceProp->settingsList[AUDIO_MODEM_VOICE_CALL_MULTIMIC].name,
-                    "Yes")) {
-            LOGV("dual mic. enabled");
-            CHECK_ERROR(control.set("MUX_VX1", dmicSubName), error);
-        } else {
-            CHECK_ERROR(control.set("MUX_VX1", dmicMainName), error);
-        }
-        break;
-
-    case AudioModemInterface::AUDIO_MODEM_HEADSET:
-        // In headset the microphone allways comes from analog
-        CHECK_ERROR(control.set("AMIC_UL PDM Switch", 1), error);
-        CHECK_ERROR(mAlsaControl->set("MUX_VX0", "AMic0"), error);
-        CHECK_ERROR(mAlsaControl->set("MUX_VX1", "AMic0"), error);
-        break;
-
-    case AudioModemInterface::AUDIO_MODEM_BLUETOOTH:
-        CHECK_ERROR(control.set("AMIC_UL PDM Switch", 0, 0), error);
-        CHECK_ERROR(mAlsaControl->set("MUX_VX0", "BT Left"), error);
-        CHECK_ERROR(mAlsaControl->set("MUX_VX1", "BT Left"), error);
-        CHECK_ERROR(control.set("BT UL Volume",
-                    AUDIO_ABE_BT_MIC_UL_VOL, -1), error);
-        break;
-
-    default:
-        LOGE("%s: Wrong mCurrentAudioModemModes: %04x",
-                __FUNCTION__,
-                mCurrentAudioModemModes);
-        error = INVALID_OPERATION;
-        break;
-    } //switch (modem_mode)
-
-    //always enable vx mixer
-    CHECK_ERROR(mAlsaControl->set("Voice Capture Mixer Capture", 1), error);
+    CHECK_ERROR(propModemMgr.get(Omap4ALSAManager::MAIN_MIC, main), error);
+    CHECK_ERROR(propModemMgr.get(Omap4ALSAManager::SUB_MIC, sub), error);
+    mControl->setMicrophones(main, sub);
 
     return error;
 }
 
 status_t AudioModemAlsa::configEqualizers(void)
 {
-    ALSAControl control("hw:00");
+    static const struct {
+        Omap4ALSAManager::Param param;
+        const char *control;
+    } equalizers[] = {
+        { Omap4ALSAManager::AMIC_EQ_PROFILE, "AMIC Equalizer" },
+        { Omap4ALSAManager::DMIC_EQ_PROFILE, "DMIC Equalizer" },
+        { Omap4ALSAManager::DL1_EQ_PROFILE, "DL1 Equalizer" },
+        { Omap4ALSAManager::DL2L_EQ_PROFILE, "DL2 Left Equalizer" },
+        { Omap4ALSAManager::DL2R_EQ_PROFILE, "DL2 Right Equalizer" },
+        { Omap4ALSAManager::SDT_EQ_PROFILE, "Sidetone Equalizer" },
+    };
     status_t error = NO_ERROR;
-    String8 equalizerSetting;
-    String8 keyEqualizer;
-
-    keyEqualizer = (String8)Omap4ALSAManager::AMIC_EQ_PROFILE;
-    CHECK_ERROR(propModemMgr.get(keyEqualizer, equalizerSetting), error);
-    CHECK_ERROR(control.set("AMIC Equalizer", equalizerSetting.string()), error);
-
-    keyEqualizer = (String8)Omap4ALSAManager::DMIC_EQ_PROFILE;
-    CHECK_ERROR(propModemMgr.get(keyEqualizer, equalizerSetting), error);
-    CHECK_ERROR(control.set("DMIC Equalizer", equalizerSetting.string()), error);
+    const char *equalizerSetting;
 
-    keyEqualizer = (String8)Omap4ALSAManager::DL1_EQ_PROFILE;
-    CHECK_ERROR(propModemMgr.get(keyEqualizer, equalizerSetting), error);
-    CHECK_ERROR(control.set("DL1 Equalizer", equalizerSetting.string()), error);
-
-    keyEqualizer = (String8)Omap4ALSAManager::DL2L_EQ_PROFILE;
-    CHECK_ERROR(propModemMgr.get(keyEqualizer, equalizerSetting), error);
-    CHECK_ERROR(control.set("DL2 Left Equalizer", equalizerSetting.string()), error);
-
-    keyEqualizer = (String8)Omap4ALSAManager::DL2R_EQ_PROFILE;
-    CHECK_ERROR(propModemMgr.get(keyEqualizer, equalizerSetting), error);
-    CHECK_ERROR(control.set("DL2 Right Equalizer", equalizerSetting.string()), error);
-
-    keyEqualizer = (String8)Omap4ALSAManager::SDT_EQ_PROFILE;
-    CHECK_ERROR(propModemMgr.get(keyEqualizer, equalizerSetting), error);
-    CHECK_ERROR(control.set("Sidetone Equalizer", equalizerSetting.string()), error);
+    for (size_t i = 0; i < sizeof(equalizers) / sizeof(equalizers[0]); i++) {
+        CHECK_ERROR(propModemMgr.get(equalizers[i].param, equalizerSetting), error);
+        mControl->setEqualizer(equalizers[i].control, equalizerSetting);
+    }
 
     return error;
 }
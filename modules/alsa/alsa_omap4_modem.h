@@ -21,6 +21,8 @@
 #include <utils/Errors.h>
 #include <utils/KeyedVector.h>
 
+#include "VoiceCallControl.h"
+
 namespace android
 {
 // The name of the audio modem properties keys is defined like below:
@@ -169,99 +171,6 @@ static const char *recordTypeValue[] = {
 };
 static const int recordTypeValueLen = (sizeof(recordTypeValue) / sizeof(char *));
 
-//
-// Audio Codec fine tuning paratemers:
-//
-// TODO put in property keys
-// Preamplifier attenuation gain are
-//  index       gain
-//  1           0dB
-//  0           6dB
-#define AUDIO_CODEC_CAPTURE_PREAMP_ATT_HANDSET      1
-#define AUDIO_CODEC_CAPTURE_PREAMP_ATT_HANDFREE     1
-#define AUDIO_CODEC_CAPTURE_PREAMP_ATT_HEADSET      1
-
-// amplifier volumes are
-//  index       gain
-//  0           6dB
-//  1           12dB
-//  2           18dB
-//  3           24dB
-//  4           30dB
-#define AUDIO_CODEC_CAPTURE_VOL_HANDSET             3
-#define AUDIO_CODEC_CAPTURE_VOL_HANDFREE            3
-#define AUDIO_CODEC_CAPTURE_VOL_HEADSET             3
-
-// amplifier volumes are
-//  index       gain
-//  0           -24dB
-//  ...
-//  15          6dB
-//
-//  step 2dB
-#define AUDIO_CODEC_EARPIECE_GAIN        15
-
-// amplifier volumes are
-//  index       gain
-//  0           -52dB
-//  ...
-//  29          6dB
-//
-//  step 2dB
-#define AUDIO_CODEC_HANDFREE_GAIN        23
-
-// amplifier volumes are
-//  index       gain
-//  0           -30dB
-//  ...
-//  15          0dB
-//
-//  step 2dB
-#define AUDIO_CODEC_HEADSET_GAIN        15
-
-// ABE Audio UL voice mixer Volume
-// Range values: min=0,max=149,step=1
-// dBscale-min=-120.00dB,step=1.00dB,mute=0
-#define AUDIO_ABE_AUDUL_VOICE_VOL_HANDSET       120
-#define AUDIO_ABE_AUDUL_VOICE_VOL_HANDFREE      120
-#define AUDIO_ABE_AUDUL_VOICE_VOL_HEADSET       120
-#define AUDIO_ABE_AUDUL_VOICE_VOL_BLUETOOTH     120
-
-// DMIC ABE Uplink Volume
-// Range values: min=0,max=149,step=1
-// dBscale-min=-120.00dB,step=1.00dB,mute=0
-#define AUDIO_ABE_DMIC_MAIN_UL_VOL_HANDFREE     140
-#define AUDIO_ABE_DMIC_SUB_UL_VOL_HANDFREE      140
-#define AUDIO_ABE_DMIC_MAIN_UL_VOL_HANDSET      140
-#define AUDIO_ABE_DMIC_SUB_UL_VOL_HANDSET       140
-
-// AMIC ABE Uplink Volume
-// Range values: min=0,max=149,step=1
-// dBscale-min=-120.00dB,step=1.00dB,mute=0
-#define AUDIO_ABE_AMIC_UL_VOL_HANDFREE          120
-#define AUDIO_ABE_AMIC_UL_VOL_HANDSET           120
-
-// Bluetooth MIC ABE Uplink Volume
-// Range values: min=0,max=149,step=1
-// dBscale-min=-120.00dB,step=1.00dB,mute=0
-#define AUDIO_ABE_BT_MIC_UL_VOL 120
-
-// Sidetone Downlink Volume
-// Range values: min=0,max=149,step=1
-// dBscale-min=-120.00dB,step=1.00dB,mute=0
-#define AUDIO_ABE_SIDETONE_DL_VOL_HANDSET       118
-#define AUDIO_ABE_SIDETONE_DL_VOL_HANDFREE     0
-#define AUDIO_ABE_SIDETONE_DL_VOL_HEADSET       118
-#define AUDIO_ABE_SIDETONE_DL_VOL_BLUETOOTH     118
-
-// Sidetone Uplink Volume
-// Range values: min=0,max=149,step=1
-// dBscale-min=-120.00dB,step=1.00dB,mute=0
-#define AUDIO_ABE_SIDETONE_UL_VOL_HANDSET       90
-#define AUDIO_ABE_SIDETONE_UL_VOL_HANDFREE      0
-#define AUDIO_ABE_SIDETONE_UL_VOL_HEADSET       90
-#define AUDIO_ABE_SIDETONE_UL_VOL_BLUETOOTH     90
-
 // Modem interface static library to use
 // are declared in the prop. key modem.audio.libpath
 // if not found the generic library is used
@@ -270,7 +179,6 @@ static const int recordTypeValueLen = (sizeof(recordTypeValue) / sizeof(char *))
 
 // Audio ALSA PCM configuration
 #define AUDIO_MODEM_PCM_HANDLE_NAME    "hw:0,5"
-#define AUDIO_MODEM_PCM_LATENCY     500000
 
 // Voice Call Volume
 struct voiceCallVolumeInfo
@@ -286,22 +194,6 @@ struct voiceCallVolumeList
     voiceCallVolumeInfo *mInfo;
 };
 
-struct voiceCallControlMainInfo
-{
-    bool        updateFlag;
-    uint32_t    devices;
-    int         mode;
-    bool       multimediaUpdate;
-};
-
-struct voiceCallControlLocalInfo
-{
-    uint32_t    devices;
-    int         mode;
-    bool       multimediaUpdate;
-    ALSAControl *mAlsaControl;
-};
-
 class AudioModemAlsa
 {
 public:
@@ -339,88 +231,28 @@ public:
         uint32_t audioMode;
     };
 
-    enum audio_modem_voice_call_state {
-        AUDIO_MODEM_VOICE_CALL_OFF = 0,
-        AUDIO_MODEM_VOICE_CALL_ON,
-        AUDIO_MODEM_VOICE_CALL_STATE_INVALID
-    };
-
-
     AudioModemInterface *create(void);
     status_t     audioModemSetProperties(void);
     status_t     voiceCallControls(uint32_t devices, int mode, bool multimediaUpdate);
-    // Voice Call control thread
-    void        voiceCallControlsThread(void);
     void        voiceCallControlsMutexLock(void);
     void        voiceCallControlsMutexUnlock(void);
 
-    status_t     setCurrentAudioModemModes(uint32_t devices);
-
-    status_t     voiceCallCodecSet(void);
-    status_t     voiceCallCodecUpdate(void);
-    status_t     voiceCallCodecReset(void);
-    status_t     voiceCallCodecSetHandset(void);
-    status_t     voiceCallCodecSetHandfree(void);
-    status_t     voiceCallCodecSetHeadset(void);
-    status_t     voiceCallCodecUpdateHandset(void);
-    status_t     voiceCallCodecUpdateHandfree(void);
-    status_t     voiceCallCodecUpdateHeadset(void);
-    status_t     voiceCallCodecPCMSet(void);
-    status_t     voiceCallCodecPCMReset(void);
-    status_t     voiceCallCodecStop(void);
-
-    status_t     voiceCallModemSet(void);
-    status_t     voiceCallModemUpdate(void);
-    status_t     voiceCallModemReset(void);
-
-    status_t     voiceCallBTDeviceEnable(void);
-    status_t     voiceCallBTDeviceDisable(void);
-
-    status_t     voiceCallSidetoneSet(int mode);
-    status_t     voiceCallSidetoneReset();
-
-    #ifdef AUDIO_BLUETOOTH
-        status_t     voiceCallCodecSetBluetooth(void);
-        status_t     voiceCallCodecUpdateBluetooth(void);
-        status_t     voiceCallCodecBTPCMSet(void);
-        status_t     voiceCallCodecBTPCMReset(void);
-    #endif
     status_t voiceCallVolume(ALSAControl *alsaControl, float volume);
 
     char        *mBoardName;
-    int         mVoiceCallState;
-    uint32_t    mCurrentAudioModemModes;
-    uint32_t    mPreviousAudioModemModes;
     // list of properties per devices
     KeyedVector<uint32_t, AudioModemDeviceProperties *> mDevicePropList;
-    AudioModemDeviceProperties *mDeviceProp;
-    AudioModemDeviceProperties *mDevicePropPrevious;
-
-    voiceCallControlMainInfo    mVoiceCallControlMainInfo;
 
     AudioModemInterface     *mModem;
 
-    snd_pcm_t *pHandle;
-    snd_pcm_t *cHandle;
+    // The codec, modem and PCM of the calls
+    VoiceCallControl        *mControl;
 
     // DMIC/AMIC allocation
-    status_t configMicrophones(void);
     status_t microphoneChosen(void);
 
     // Equalizer
     status_t configEqualizers(void);
-
-    // Posix thread
-    pthread_t       mVoiceCallControlThread;
-    pthread_mutex_t mVoiceCallControlMutex;
-    pthread_once_t  mVoiceCallControlKeyOnce;
-    pthread_cond_t  mVoiceCallControlNewParams;
-
-    // Multimedia update
-    status_t     multimediaCodecUpdate(void);
-
-    // Automatic sample rate
-    uint32_t mVoiceCallSampleRate;
 };
 };        // namespace android
 #endif    // ANDROID_ALSA_OMAP4_MODEM_H
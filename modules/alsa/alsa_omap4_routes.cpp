@@ -0,0 +1,310 @@
+/* alsa_omap4_routes.cpp
+ **
+ ** Copyright 2009-2011 Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include <media/AudioSystem.h>
+
+#include "alsa_omap4.h"
+
+namespace android
+{
+
+#define OUT     0x0000FFFF
+#define IN      0xFFFF0000
+
+// ---- outputs ---------------------------------------------------------------
+
+static const RouteSetting speakerOn[] = {
+    /* OMAP4 ABE */
+    { "DL2 Mixer Multimedia",           NULL,               1,      -1 },   // MM_DL -> DL2 Mixer
+    { "DL2 Media Playback Volume",      NULL,               118,    -1 },
+    { "DL2 Capture Playback Volume",    NULL,               0,      -1 },
+    /* TWL6040 */
+    { "HF Left Playback",               "HF DAC",           0,      -1 },   // HFDAC L -> HF Mux
+    { "HF Right Playback",              "HF DAC",           0,      -1 },   // HFDAC R -> HF Mux
+    { "Handsfree Playback Volume",      NULL,               23,     -1 },
+    { NULL }
+};
+
+static const RouteSetting speakerOff[] = {
+    /* OMAP4 ABE */
+    { "DL2 Mixer Multimedia",           NULL,               0,      0 },
+    { "DL2 Media Playback Volume",      NULL,               0,      -1 },
+    { "DL2 Capture Playback Volume",    NULL,               0,      -1 },
+    /* TWL6040 */
+    { "HF Left Playback",               "Off",              0,      -1 },
+    { "HF Right Playback",              "Off",              0,      -1 },
+    { "Handsfree Playback Volume",      NULL,               0,      -1 },
+    { NULL }
+};
+
+// FM radio looped back to the speaker, and away from DL1
+static const RouteSetting speakerFmOn[] = {
+    { "DL2 Capture Playback Volume",    NULL,               115,    -1 },
+    { "DL1 Capture Playback Volume",    NULL,               0,      -1 },
+    { NULL }
+};
+
+static const RouteSetting headsetOn[] = {
+    /* TWL6040 */
+    { "HS Left Playback",               "HS DAC",           0,      -1 },   // HSDAC L -> HS Mux
+    { "HS Right Playback",              "HS DAC",           0,      -1 },   // HSDAC R -> HS Mux
+    { "Headset Playback Volume",        NULL,               15,     -1 },
+    { NULL }
+};
+
+static const RouteSetting headsetOff[] = {
+    /* TWL6040 */
+    { "HS Left Playback",               "Off",              0,      -1 },
+    { "HS Right Playback",              "Off",              0,      -1 },
+    { "Headset Playback Volume",        NULL,               0,      -1 },
+    { NULL }
+};
+
+static const RouteSetting earpieceOn[] = {
+    /* TWL6040 */
+    { "EP Playback",                    "On",               0,      -1 },   // HSDACL -> Earpiece
+    { "Earphone Playback Volume",       NULL,               15,     -1 },
+    { NULL }
+};
+
+static const RouteSetting earpieceOff[] = {
+    /* TWL6040 */
+    { "Earphone Playback Volume",       NULL,               0,      -1 },
+    { "EP Playback",                    "Off",              0,      -1 },
+    { NULL }
+};
+
+static const RouteSetting dl1On[] = {
+    /* OMAP4 ABE */
+    { "DL1 Mixer Multimedia",           NULL,               1,      -1 },   // MM_DL -> DL1 Mixer
+    { "Sidetone Mixer Playback",        NULL,               1,      -1 },   // DL1 Mixer -> Sidetone Mixer
+    { "SDT DL Volume",                  NULL,               118,    -1 },
+    { "DL1 Media Playback Volume",      NULL,               118,    -1 },
+    { "DL1 PDM Switch",                 NULL,               1,      -1 },
+    { "DL1 Capture Playback Volume",    NULL,               0,      -1 },
+    { NULL }
+};
+
+static const RouteSetting dl1Off[] = {
+    /* OMAP4 ABE */
+    { "DL1 Mixer Multimedia",           NULL,               0,      0 },
+    { "Sidetone Mixer Playback",        NULL,               0,      0 },
+    { "SDT DL Volume",                  NULL,               0,      0 },
+    { "DL1 PDM Switch",                 NULL,               0,      0 },
+    { "DL1 Media Playback Volume",      NULL,               0,      -1 },
+    { "DL1 Capture Playback Volume",    NULL,               0,      -1 },
+    { NULL }
+};
+
+// FM radio looped back to DL1, and away from the speaker
+static const RouteSetting dl1FmOn[] = {
+    { "DL1 Capture Playback Volume",    NULL,               115,    -1 },
+    { "DL2 Capture Playback Volume",    NULL,               0,      -1 },
+    { NULL }
+};
+
+static const RouteSetting fmTransmitOn[] = {
+    /* OMAP4 ABE */
+    { "DL1 Mixer Multimedia",           NULL,               1,      -1 },   // MM_DL -> DL1 Mixer
+    { "Sidetone Mixer Playback",        NULL,               1,      -1 },   // DL1 Mixer -> Sidetone Mixer
+    { "SDT DL Volume",                  NULL,               118,    -1 },
+    { "DL1 Media Playback Volume",      NULL,               118,    -1 },
+    { "DL1 MM_EXT Switch",              NULL,               1,      -1 },
+    { "DL1 PDM Switch",                 NULL,               0,      0 },
+    { NULL }
+};
+
+static const RouteSetting fmTransmitOff[] = {
+    { "DL1 MM_EXT Switch",              NULL,               0,      0 },
+    { NULL }
+};
+
+static const RouteSetting bluetoothOn[] = {
+    /* OMAP4 ABE */
+    { "DL1 Mixer Multimedia",           NULL,               1,      -1 },   // MM_DL -> DL1 Mixer
+    { "Sidetone Mixer Playback",        NULL,               1,      -1 },   // DL1 Mixer -> Sidetone Mixer
+    { "SDT DL Volume",                  NULL,               118,    -1 },
+    { "DL1 BT_VX Switch",               NULL,               1,      -1 },   // Sidetone Mixer -> BT-VX-DL
+    { "DL1 Media Playback Volume",      NULL,               118,    -1 },
+    { NULL }
+};
+
+static const RouteSetting bluetoothOff[] = {
+    { "DL1 BT_VX Switch",               NULL,               0,      0 },
+    { NULL }
+};
+
+// 800Hz cut-off, a flat response saturates the handsfree speakers
+static const RouteSetting dl2EqualizerOn[] = {
+    { "DL2 Left Equalizer",             "High-pass 0dB",    0,      -1 },
+    { "DL2 Right Equalizer",            "High-pass 0dB",    0,      -1 },
+    { NULL }
+};
+
+static const RouteSetting dl1EqualizerOn[] = {
+    { "DL1 Equalizer",                  "Flat response",    0,      -1 },
+    { NULL }
+};
+
+static const RouteSetting powerModeOn[] = {
+    { "TWL6040 Power Mode",             "Low-Power",        0,      -1 },
+    { NULL }
+};
+
+// ---- inputs ----------------------------------------------------------------
+
+// the mics themselves are the properties' choice, configMicChoices
+static const RouteSetting mainMicOn[] = {
+    /* TWL6040 */
+    { "Analog Left Capture Route",      "Main Mic",         0,      -1 },   // Main Mic -> Mic Mux
+    { "Analog Right Capture Route",     "Sub Mic",          0,      -1 },   // Sub Mic -> Mic Mux
+    { "Capture Preamplifier Volume",    NULL,               1,      -1 },
+    { "Capture Volume",                 NULL,               4,      -1 },
+    { NULL }
+};
+
+static const RouteSetting headsetMicOn[] = {
+    /* TWL6040 */
+    { "Analog Left Capture Route",      "Headset Mic",      0,      -1 },   // Headset Mic -> Mic Mux
+    { "Analog Right Capture Route",     "Headset Mic",      0,      -1 },   // Headset Mic -> Mic Mux
+    { "Capture Preamplifier Volume",    NULL,               1,      -1 },
+    { "Capture Volume",                 NULL,               4,      -1 },
+    /* OMAP4 ABE */
+    { "AMIC_UL PDM Switch",             NULL,               1,      -1 },
+    { "MUX_UL00",                       "AMic1",            0,      -1 },
+    { "MUX_UL11",                       "AMic0",            0,      -1 },
+    { NULL }
+};
+
+static const RouteSetting fmCaptureOn[] = {
+    /* TWL6040 */
+    { "Analog Left Capture Route",      "Aux/FM Left",      0,      -1 },   // FM -> Mic Mux
+    { "Analog Right Capture Route",     "Aux/FM Right",     0,      -1 },   // FM -> Mic Mux
+    { "Capture Preamplifier Volume",    NULL,               1,      -1 },
+    { "Capture Volume",                 NULL,               1,      -1 },
+    /* OMAP4 ABE */
+    { "AMIC_UL PDM Switch",             NULL,               1,      -1 },
+    { "MUX_UL10",                       "AMic1",            0,      -1 },
+    { "MUX_UL11",                       "AMic0",            0,      -1 },
+    { NULL }
+};
+
+static const RouteSetting bluetoothMicOn[] = {
+    /* OMAP4 ABE */
+    { "AMIC_UL PDM Switch",             NULL,               0,      0 },
+    { "MUX_UL00",                       "BT Right",         0,      -1 },
+    { "MUX_UL01",                       "BT Left",          0,      -1 },
+    { "MUX_UL10",                       "BT Right",         0,      -1 },
+    { "MUX_UL11",                       "BT Left",          0,      -1 },
+    { "BT UL Volume",                   NULL,               120,    -1 },
+    { "Voice Capture Mixer Capture",    NULL,               1,      -1 },
+    { NULL }
+};
+
+// the gains and sides are the properties' choice, configVoiceMemo
+static const RouteSetting voiceMemoOn[] = {
+    /* OMAP4 ABE */
+    { "MUX_UL00",                       "VX Right",         0,      -1 },
+    { "MUX_UL01",                       "VX Left",          0,      -1 },
+    { NULL }
+};
+
+static const RouteSetting captureOffOn[] = {
+    /* TWL6040 */
+    { "Analog Left Capture Route",      "Off",              0,      -1 },
+    { "Analog Right Capture Route",     "Off",              0,      -1 },
+    { "Capture Preamplifier Volume",    NULL,               0,      -1 },
+    { "Capture Volume",                 NULL,               0,      -1 },
+    /* OMAP4 ABE */
+    { "BT UL Volume",                   NULL,               0,      -1 },   // BT UL -> mute
+    { "Voice Capture Mixer Capture",    NULL,               0,      0 },
+    { "AMIC_UL PDM Switch",             NULL,               0,      0 },
+    { "MUX_UL00",                       "None",             0,      -1 },
+    { "MUX_UL01",                       "None",             0,      -1 },
+    { "MUX_UL10",                       "None",             0,      -1 },
+    { "MUX_UL11",                       "None",             0,      -1 },
+    { NULL }
+};
+
+#define IN_MICS     (AudioSystem::DEVICE_IN_BUILTIN_MIC |\
+                     AudioSystem::DEVICE_IN_WIRED_HEADSET |\
+                     OMAP4_IN_FM |\
+                     OMAP4_IN_SCO |\
+                     AudioSystem::DEVICE_IN_VOICE_CALL)
+
+// The capture paths take the first of the devices in this order, only
+// one source feeds the uplink
+const RoutePath omap4Routes[] = {
+//    name              scope   devices                                     exclude
+//                      flags           on                  off
+    { "speaker",        OUT,    AudioSystem::DEVICE_OUT_SPEAKER,            0,
+                        0,              speakerOn,          speakerOff },
+    { "speaker-fm",     OUT,    AudioSystem::DEVICE_OUT_SPEAKER,            0,
+                        OMAP4_ROUTE_FM, speakerFmOn,        NULL },
+    { "headset",        OUT,    AudioSystem::DEVICE_OUT_WIRED_HEADSET |
+                                OMAP4_OUT_LP,                               0,
+                        0,              headsetOn,          headsetOff },
+    { "earpiece",       OUT,    AudioSystem::DEVICE_OUT_EARPIECE,           0,
+                        0,              earpieceOn,         earpieceOff },
+    { "dl1",            OUT,    AudioSystem::DEVICE_OUT_EARPIECE |
+                                AudioSystem::DEVICE_OUT_WIRED_HEADSET |
+                                OMAP4_OUT_LP,                               0,
+                        0,              dl1On,              dl1Off },
+    { "dl1-fm",         OUT,    AudioSystem::DEVICE_OUT_EARPIECE |
+                                AudioSystem::DEVICE_OUT_WIRED_HEADSET |
+                                OMAP4_OUT_LP,                               0,
+                        OMAP4_ROUTE_FM, dl1FmOn,            NULL },
+    { "fm-transmit",    OUT,    OMAP4_OUT_FM,                               0,
+                        0,              fmTransmitOn,       fmTransmitOff },
+    { "bluetooth",      OUT,    OMAP4_OUT_SCO,                              0,
+                        0,              bluetoothOn,        bluetoothOff },
+    { "dl2-equalizer",  OUT,    AudioSystem::DEVICE_OUT_SPEAKER |
+                                OMAP4_OUT_HDMI,                             0,
+                        0,              dl2EqualizerOn,     NULL },
+    { "dl1-equalizer",  OUT,    AudioSystem::DEVICE_OUT_WIRED_HEADSET |
+                                AudioSystem::DEVICE_OUT_EARPIECE,           0,
+                        0,              dl1EqualizerOn,     NULL },
+    { "power-mode",     OUT,    OUT,                                        0,
+                        0,              powerModeOn,        NULL },
+
+    { "main-mic",       IN,     AudioSystem::DEVICE_IN_BUILTIN_MIC,         0,
+                        0,              mainMicOn,          NULL },
+    { "headset-mic",    IN,     AudioSystem::DEVICE_IN_WIRED_HEADSET,
+                                AudioSystem::DEVICE_IN_BUILTIN_MIC,
+                        0,              headsetMicOn,       NULL },
+    { "fm-capture",     IN,     OMAP4_IN_FM,
+                                AudioSystem::DEVICE_IN_BUILTIN_MIC |
+                                AudioSystem::DEVICE_IN_WIRED_HEADSET,
+                        0,              fmCaptureOn,        NULL },
+    { "bluetooth-mic",  IN,     OMAP4_IN_SCO,
+                                AudioSystem::DEVICE_IN_BUILTIN_MIC |
+                                AudioSystem::DEVICE_IN_WIRED_HEADSET |
+                                OMAP4_IN_FM,
+                        0,              bluetoothMicOn,     NULL },
+    { "voice-memo",     IN,     AudioSystem::DEVICE_IN_VOICE_CALL,
+                                AudioSystem::DEVICE_IN_BUILTIN_MIC |
+                                AudioSystem::DEVICE_IN_WIRED_HEADSET |
+                                OMAP4_IN_FM |
+                                OMAP4_IN_SCO,
+                        0,              voiceMemoOn,        NULL },
+    { "capture-off",    IN,     IN,                         IN_MICS,
+                        0,              captureOffOn,       NULL },
+};
+
+const size_t omap4RouteCount = sizeof(omap4Routes) / sizeof(omap4Routes[0]);
+
+}
@@ -0,0 +1,85 @@
+LOCAL_PATH:= $(call my-dir)
+
+################################################
+# RingBuffer of the acoustics module: threaded stress and wake-up latency
+# against the old mutex ring, on the host and on the target
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    RingBuffer_Test.cpp \
+    ../../modules/acoustics/RingBuffer.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/acoustics
+
+LOCAL_STATIC_LIBRARIES := libutils libcutils
+LOCAL_LDLIBS += -lpthread -lrt
+
+LOCAL_MODULE := RingBuffer_HostTest
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    RingBuffer_Test.cpp \
+    ../../modules/acoustics/RingBuffer.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/acoustics
+
+LOCAL_SHARED_LIBRARIES := libutils libcutils
+
+LOCAL_MODULE := RingBuffer_Test
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
+
+################################################
+# Capture processing chain: node checks on generated signals, or a chain
+# over WAV files, with the CPU time of each node
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    AudioChain_Test.cpp \
+    ../../modules/acoustics/AudioChain.cpp \
+    ../../modules/acoustics/AudioProcessors.cpp \
+    ../../modules/alsa/ALSAResampler.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/acoustics \
+    hardware/ti/omap3/modules/alsa
+
+LOCAL_STATIC_LIBRARIES := libutils libcutils
+LOCAL_LDLIBS += -lpthread -lrt -lm
+
+LOCAL_MODULE := AudioChain_HostTest
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    AudioChain_Test.cpp \
+    ../../modules/acoustics/AudioChain.cpp \
+    ../../modules/acoustics/AudioProcessors.cpp \
+    ../../modules/alsa/ALSAResampler.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/acoustics \
+    hardware/ti/omap3/modules/alsa
+
+LOCAL_SHARED_LIBRARIES := libutils libcutils
+
+LOCAL_MODULE := AudioChain_Test
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,437 @@
+/* AudioChain_Test.cpp
+ **
+ ** Copyright 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/*
+ * Runs the capture processing chain of the acoustics module on the host.
+ *
+ * Without files it checks each node on generated signals (echo return loss
+ * enhancement, noise reduction, gain, rate) and prints the CPU each node
+ * took per period:
+ *
+ *   AudioChain_Test
+ *
+ * With files it feeds a 16 bit WAV capture, and optionally the WAV of what
+ * was played meanwhile, through a chain in periods and writes the result:
+ *
+ *   AudioChain_Test -c aec:256,ns,gain:6 [-r playback.wav] [-p frames]
+ *                   [-b budget_us] capture.wav out.wav
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+
+#include <AudioChain.h>
+#include <AudioProcessors.h>
+
+using namespace android;
+
+#define PRINT printf
+
+#define PERIOD_FRAMES   512
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        PRINT("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+/* --- WAV files ----------------------------------------------------------- */
+
+struct Wav {
+    int         rate;
+    int         channels;
+    size_t      frames;
+    int16_t *   samples;
+};
+
+static uint32_t le32(const unsigned char *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint16_t le16(const unsigned char *p) { return p[0] | p[1] << 8; }
+
+static bool readWav(const char *path, Wav &wav)
+{
+    FILE *f = fopen(path, "rb");
+    unsigned char header[12], chunk[8], fmt[16];
+    bool haveFmt = false;
+
+    if (!f) {
+        PRINT("can't open %s\n", path);
+        return false;
+    }
+    if (fread(header, 1, 12, f) != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4)) {
+        PRINT("%s isn't a WAV file\n", path);
+        fclose(f);
+        return false;
+    }
+
+    while (fread(chunk, 1, 8, f) == 8) {
+        uint32_t size = le32(chunk + 4);
+        if (!memcmp(chunk, "fmt ", 4) && size >= 16) {
+            fread(fmt, 1, 16, f);
+            fseek(f, size - 16 + (size & 1), SEEK_CUR);
+            if (le16(fmt) != 1 || le16(fmt + 14) != 16) {
+                PRINT("%s: only 16 bit PCM\n", path);
+                break;
+            }
+            wav.channels = le16(fmt + 2);
+            wav.rate = le32(fmt + 4);
+            haveFmt = true;
+        } else if (!memcmp(chunk, "data", 4) && haveFmt) {
+            wav.frames = size / (2 * wav.channels);
+            wav.samples = new int16_t[wav.frames * wav.channels];
+            wav.frames = fread(wav.samples, 2 * wav.channels, wav.frames, f);
+            fclose(f);
+            return true;
+        } else {
+            fseek(f, size + (size & 1), SEEK_CUR);
+        }
+    }
+
+    PRINT("%s: no 16 bit PCM data\n", path);
+    fclose(f);
+    return false;
+}
+
+static void put32(unsigned char *p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+static void put16(unsigned char *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+
+static bool writeWav(const char *path, const Wav &wav)
+{
+    FILE *f = fopen(path, "wb");
+    unsigned char h[44];
+    uint32_t bytes = wav.frames * wav.channels * 2;
+
+    if (!f) {
+        PRINT("can't create %s\n", path);
+        return false;
+    }
+    memcpy(h, "RIFF", 4);
+    put32(h + 4, 36 + bytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put32(h + 16, 16);
+    put16(h + 20, 1);
+    put16(h + 22, wav.channels);
+    put32(h + 24, wav.rate);
+    put32(h + 28, wav.rate * wav.channels * 2);
+    put16(h + 32, wav.channels * 2);
+    put16(h + 34, 16);
+    memcpy(h + 36, "data", 4);
+    put32(h + 40, bytes);
+    fwrite(h, 1, 44, f);
+    fwrite(wav.samples, 2, wav.frames * wav.channels, f);
+    fclose(f);
+    return true;
+}
+
+/* --- running a chain --------------------------------------------------------- */
+
+// Feeds in through the chain period by period, the output grows as needed
+static Wav run(AudioChain &chain, const Wav &in, const Wav *ref, size_t period, nsecs_t budget)
+{
+    Wav out;
+
+    if (chain.configure(in.rate, in.channels, period, budget) != NO_ERROR) {
+        out.frames = 0;
+        out.samples = NULL;
+        return out;
+    }
+
+    size_t capacity = chain.capacity();
+    int16_t *block = new int16_t[capacity * in.channels];
+    int16_t *silence = new int16_t[period * in.channels];
+    size_t room = in.frames * 2 + capacity;
+
+    memset(silence, 0, period * in.channels * sizeof(int16_t));
+    out.rate = chain.outputRate();
+    out.channels = in.channels;
+    out.frames = 0;
+    out.samples = new int16_t[room * in.channels];
+
+    for (size_t pos = 0; pos + period <= in.frames; pos += period) {
+        AudioBlock b;
+        memcpy(block, in.samples + pos * in.channels, period * in.channels * sizeof(int16_t));
+        b.data = block;
+        b.frames = period;
+        b.capacity = capacity;
+        b.channels = in.channels;
+        b.rate = in.rate;
+        b.refChannels = ref ? ref->channels : in.channels;
+        b.reference = ref && pos + period <= ref->frames ? ref->samples + pos * ref->channels : silence;
+
+        chain.process(b);
+
+        if (out.frames + b.frames > room) {
+            int16_t *bigger = new int16_t[2 * room * in.channels];
+            memcpy(bigger, out.samples, out.frames * in.channels * sizeof(int16_t));
+            delete [] out.samples;
+            out.samples = bigger;
+            room *= 2;
+        }
+        memcpy(out.samples + out.frames * in.channels, b.data, b.frames * in.channels * sizeof(int16_t));
+        out.frames += b.frames;
+    }
+
+    delete [] block;
+    delete [] silence;
+    return out;
+}
+
+static void printStats(const AudioChain &chain, int rate, size_t period)
+{
+    AudioChain::Stats stats[AudioChain::MAX_NODES];
+    size_t n = chain.stats(stats, AudioChain::MAX_NODES);
+    double periodUs = 1e6 * period / rate;
+
+    for (size_t i = 0; i < n; i++) {
+        double average = stats[i].blocks ? stats[i].total / 1000.0 / stats[i].blocks : 0;
+        PRINT("  %-10s %6u blocks %5u skipped  %8.1f us average %8.1f us worst  %5.1f%% of the period\n",
+              stats[i].name, stats[i].blocks, stats[i].skipped, average, stats[i].worst / 1000.0,
+              100.0 * average / periodUs);
+    }
+}
+
+/* --- generated signals ----------------------------------------------------- */
+
+static Wav makeWav(int rate, int channels, size_t frames)
+{
+    Wav wav;
+    wav.rate = rate;
+    wav.channels = channels;
+    wav.frames = frames;
+    wav.samples = new int16_t[frames * channels];
+    memset(wav.samples, 0, frames * channels * sizeof(int16_t));
+    return wav;
+}
+
+static double power(const int16_t *samples, size_t count)
+{
+    double sum = 0;
+    for (size_t i = 0; i < count; i++)
+        sum += (double)samples[i] * samples[i];
+    return count ? sum / count : 0;
+}
+
+static double db(double ratio)
+{
+    return 10 * log10(ratio > 1e-12 ? ratio : 1e-12);
+}
+
+static int16_t noise(unsigned int &seed, int amplitude)
+{
+    return (int16_t)((int)(rand_r(&seed) % (2 * amplitude + 1)) - amplitude);
+}
+
+static void checkEchoCanceller()
+{
+    const int rate = 8000;
+    const size_t frames = rate * 8;
+    Wav ref = makeWav(rate, 1, frames);
+    Wav mic = makeWav(rate, 1, frames);
+    unsigned int seed = 1;
+
+    // far end noise, echoed 30 samples later at -6 dB with a short tail
+    for (size_t n = 0; n < frames; n++)
+        ref.samples[n] = noise(seed, 8000);
+    for (size_t n = 40; n < frames; n++)
+        mic.samples[n] = ref.samples[n - 30] / 2 + ref.samples[n - 35] / 8 - ref.samples[n - 40] / 16;
+
+    AudioChain chain;
+    CHECK(chain.parse("aec:64") == NO_ERROR);
+    Wav out = run(chain, mic, &ref, PERIOD_FRAMES, 0);
+    CHECK(out.frames == frames / PERIOD_FRAMES * PERIOD_FRAMES);
+
+    // the last two seconds, after convergence
+    size_t from = out.frames - 2 * rate;
+    double erle = db(power(mic.samples + from, 2 * rate) / power(out.samples + from, 2 * rate));
+    PRINT("aec: %.1f dB echo return loss enhancement\n", erle);
+    CHECK(erle > 20);
+    printStats(chain, rate, PERIOD_FRAMES);
+
+    delete [] out.samples;
+    delete [] ref.samples;
+    delete [] mic.samples;
+}
+
+static void checkNoiseSuppressor()
+{
+    const int rate = 16000;
+    const size_t frames = rate * 6;
+    Wav in = makeWav(rate, 1, frames);
+    unsigned int seed = 2;
+
+    // noise all along, a loud tone in the second half
+    for (size_t n = 0; n < frames; n++) {
+        in.samples[n] = noise(seed, 300);
+        if (n >= frames / 2)
+            in.samples[n] += (int16_t)(8000 * sin(2 * M_PI * 440 * n / rate));
+    }
+
+    AudioChain chain;
+    CHECK(chain.parse("ns:-20") == NO_ERROR);
+    Wav out = run(chain, in, NULL, PERIOD_FRAMES, 0);
+
+    size_t quiet = rate;                   // the second second, noise only
+    size_t loud = frames / 2 + rate;       // the tone, settled
+    double noiseDb = db(power(out.samples + quiet, rate) / power(in.samples + quiet, rate));
+    double toneDb = db(power(out.samples + loud, rate) / power(in.samples + loud, rate));
+    PRINT("ns: noise %.1f dB, tone %.1f dB\n", noiseDb, toneDb);
+    CHECK(noiseDb < -10);
+    CHECK(toneDb > -1);
+    printStats(chain, rate, PERIOD_FRAMES);
+
+    delete [] out.samples;
+    delete [] in.samples;
+}
+
+static void checkGainAndRate()
+{
+    const int rate = 8000;
+    const size_t frames = rate * 2;
+    Wav in = makeWav(rate, 2, frames);
+
+    for (size_t n = 0; n < frames; n++) {
+        in.samples[2 * n] = (int16_t)(10000 * sin(2 * M_PI * 300 * n / rate));
+        in.samples[2 * n + 1] = (int16_t)(20000 * sin(2 * M_PI * 300 * n / rate));
+    }
+
+    AudioChain gain;
+    CHECK(gain.parse("gain:6") == NO_ERROR);
+    Wav out = run(gain, in, NULL, PERIOD_FRAMES, 0);
+    int32_t q12 = (int32_t)lrintf(powf(10.0f, 6 / 20.0f) * 4096.0f);
+    bool exact = true;
+    for (size_t i = 0; i < out.frames * 2; i++) {
+        int32_t expected = (in.samples[i] * q12 + 2048) >> 12;
+        if (expected > 32767) expected = 32767;
+        if (expected < -32768) expected = -32768;
+        exact = exact && out.samples[i] == expected;
+    }
+    CHECK(exact);
+    delete [] out.samples;
+
+    AudioChain resample;
+    CHECK(resample.parse("resample:44100") == NO_ERROR);
+    out = run(resample, in, NULL, PERIOD_FRAMES, 0);
+    size_t expected = (frames / PERIOD_FRAMES * PERIOD_FRAMES) * 44100 / rate;
+    PRINT("resample: %zu frames at 8000 Hz to %zu at %d Hz\n",
+          frames / PERIOD_FRAMES * PERIOD_FRAMES, out.frames, out.rate);
+    CHECK(out.rate == 44100);
+    CHECK(out.frames + 2 >= expected && out.frames <= expected + 2);
+    // still the same tone, the right channel twice the left
+    double left = 0, right = 0;
+    for (size_t n = 0; n < out.frames; n++) {
+        left += (double)out.samples[2 * n] * out.samples[2 * n];
+        right += (double)out.samples[2 * n + 1] * out.samples[2 * n + 1];
+    }
+    CHECK(fabs(db(right / left) - db(4)) < 0.1);
+    delete [] out.samples;
+    delete [] in.samples;
+}
+
+static void checkBudget()
+{
+    const int rate = 8000;
+    Wav in = makeWav(rate, 1, rate * 2);
+    unsigned int seed = 3;
+
+    for (size_t n = 0; n < in.frames; n++)
+        in.samples[n] = noise(seed, 1000);
+
+    // once their cost is known no node fits a budget of 1 us, the
+    // resampler runs anyway
+    AudioChain chain;
+    CHECK(chain.parse("aec:512,ns,resample:16000") == NO_ERROR);
+    Wav out = run(chain, in, &in, PERIOD_FRAMES, 1000);
+
+    AudioChain::Stats stats[AudioChain::MAX_NODES];
+    CHECK(chain.stats(stats, AudioChain::MAX_NODES) == 3);
+    CHECK(stats[0].blocks > 0);
+    CHECK(stats[1].skipped > 0);
+    CHECK(stats[2].skipped == 0 && stats[2].blocks == in.frames / PERIOD_FRAMES);
+    CHECK(out.rate == 16000);
+    PRINT("budget of 1 us:\n");
+    printStats(chain, rate, PERIOD_FRAMES);
+
+    delete [] out.samples;
+    delete [] in.samples;
+}
+
+int main(int argc, char **argv)
+{
+    const char *spec = NULL;
+    const char *refPath = NULL;
+    size_t period = PERIOD_FRAMES;
+    int budgetUs = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:r:p:b:")) != -1) {
+        switch (opt) {
+            case 'c': spec = optarg; break;
+            case 'r': refPath = optarg; break;
+            case 'p': period = atoi(optarg); break;
+            case 'b': budgetUs = atoi(optarg); break;
+            default:
+                PRINT("usage: %s [-c chain [-r playback.wav] [-p frames] [-b budget_us] capture.wav out.wav]\n",
+                      argv[0]);
+                return 1;
+        }
+    }
+
+    if (!spec) {
+        AudioChain chain;
+        CHECK(chain.parse("aec,bogus") == BAD_VALUE && chain.size() == 0);
+        CHECK(chain.parse("gain") == BAD_VALUE);
+        CHECK(chain.parse("resample:16000,aec") == BAD_VALUE && chain.size() == 0);
+        CHECK(chain.parse("aec:128, ns:-12 ,gain:-3") == NO_ERROR && chain.size() == 3);
+        CHECK(chain.find("ns") != NULL && chain.find("resample") == NULL);
+
+        checkEchoCanceller();
+        checkNoiseSuppressor();
+        checkGainAndRate();
+        checkBudget();
+
+        PRINT("%d failures\n", failures);
+        return failures ? 1 : 0;
+    }
+
+    if (optind + 2 != argc || period == 0) {
+        PRINT("a capture and an output file\n");
+        return 1;
+    }
+
+    Wav in, ref;
+    if (!readWav(argv[optind], in) || (refPath && !readWav(refPath, ref)))
+        return 1;
+    if (refPath && ref.rate != in.rate) {
+        PRINT("the playback has to be at the capture rate\n");
+        return 1;
+    }
+
+    AudioChain chain;
+    if (chain.parse(spec) != NO_ERROR)
+        return 1;
+    Wav out = run(chain, in, refPath ? &ref : NULL, period, (nsecs_t)budgetUs * 1000);
+    if (!out.samples)
+        return 1;
+
+    PRINT("%zu frames at %d Hz in, %zu at %d Hz out\n", in.frames, in.rate, out.frames, out.rate);
+    printStats(chain, in.rate, period);
+    return writeWav(argv[optind + 1], out) ? 0 : 1;
+}
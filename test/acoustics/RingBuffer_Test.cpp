@@ -0,0 +1,492 @@
+/* RingBuffer_Test.cpp
+ **
+ ** Copyright 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/*
+ * Checks the acoustics ring buffer single threaded, also with the positions
+ * wrapping, then runs a writer and a reader thread against it in both modes
+ * checking every word that comes out, from 0 and from just before 2^31 and
+ * 2^32, and measures how long a reader blocked on an empty ring takes to get
+ * a chunk, against the mutex and condition ring it replaced:
+ *
+ *   RingBuffer_Test [-s seconds] [-p period_us] [-n chunks]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <RingBuffer.h>
+
+using namespace android;
+
+#define PRINT printf
+
+#define AUDIO_CHUNK_SIZE    2048
+#define RING_SIZE           (20 * AUDIO_CHUNK_SIZE)
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        PRINT("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+static long long nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* The ring AudioEngine used before, a mutex and a condition around the copies */
+class LegacyRing
+{
+public:
+    LegacyRing(size_t size) : mSize(size), mEmpty(1), mBegin(0), mEnd(0)
+    {
+        mBuffer = new char[mSize];
+        pthread_mutex_init(&mLock, NULL);
+        pthread_cond_init(&mCond, NULL);
+    }
+
+    ~LegacyRing() { delete [] mBuffer; }
+
+    size_t write(const void *buffer, size_t size)
+    {
+        const char *cbuf = (const char *)buffer;
+
+        pthread_mutex_lock(&mLock);
+        size_t avail = (mEmpty || mBegin <= mEnd) ? mSize + mBegin - mEnd : mBegin - mEnd;
+        size_t len = mSize - mEnd;
+        if (len > size) len = size;
+        memcpy(mBuffer + mEnd, cbuf, len);
+        cbuf += len;
+        mEnd = (mEnd + len) % mSize;
+        len = size - len;
+        if (len) {
+            memcpy(mBuffer, cbuf, len);
+            mEnd = len;
+        }
+        mEmpty = 0;
+        if (size > avail) mBegin = mEnd;
+        pthread_cond_signal(&mCond);
+        pthread_mutex_unlock(&mLock);
+        return size;
+    }
+
+    size_t read(void *buffer, size_t size)
+    {
+        char *cbuf = (char *)buffer;
+        size_t len = size;
+
+        pthread_mutex_lock(&mLock);
+        while (len) {
+            if (mEmpty) pthread_cond_wait(&mCond, &mLock);
+            size_t s = (mBegin < mEnd) ? mEnd - mBegin : mSize - mBegin;
+            if (len < s) s = len;
+            memcpy(cbuf, mBuffer + mBegin, s);
+            cbuf += s;
+            len -= s;
+            mBegin = (mBegin + s) % mSize;
+            if (mBegin == mEnd) mEmpty = 1;
+        }
+        pthread_mutex_unlock(&mLock);
+        return size;
+    }
+
+private:
+    char *          mBuffer;
+    size_t          mSize;
+    int             mEmpty;
+    size_t          mBegin;
+    size_t          mEnd;
+    pthread_mutex_t mLock;
+    pthread_cond_t  mCond;
+};
+
+/* --- single threaded ------------------------------------------------------- */
+
+static void fillBytes(char *buf, size_t size, int first)
+{
+    for (size_t i = 0; i < size; i++)
+        buf[i] = (char)(first + i);
+}
+
+static bool checkBytes(const char *buf, size_t size, int first)
+{
+    for (size_t i = 0; i < size; i++) {
+        if (buf[i] != (char)(first + i))
+            return false;
+    }
+    return true;
+}
+
+static void checkBasics()
+{
+    char in[256], out[256];
+    RingBuffer ring(100);
+
+    // wraps around the end of the storage a few times
+    for (int i = 0; i < 50; i++) {
+        fillBytes(in, 70, i);
+        CHECK(ring.write(in, 70) == 70);
+        CHECK(ring.copy(out, 100) == 70);
+        CHECK(ring.read(out, 70) == 70);
+        CHECK(checkBytes(out, 70, i));
+    }
+
+    // a full ring drops the oldest data
+    fillBytes(in, 150, 0);
+    ring.write(in, 60);
+    ring.write(in + 60, 90);
+    CHECK(ring.copy(out, 100) == 100);
+    CHECK(checkBytes(out, 100, 50));
+    CHECK(ring.read(out, 30) == 30);
+    CHECK(checkBytes(out, 30, 50));
+    CHECK(ring.copy(out, 100) == 70);
+
+    // larger than the ring, the end of it is kept
+    ring.write(in, 150);
+    CHECK(ring.copy(out, 100) == 100);
+    CHECK(checkBytes(out, 100, 50));
+
+    ring.reset();
+    CHECK(ring.copy(out, 100) == 0);
+    ring.write(in, 10);
+    CHECK(ring.read(out, 10) == 10);
+    CHECK(checkBytes(out, 10, 0));
+
+    // reserve and commit straight into the ring, the views split on the wrap
+    RingBuffer::Region region;
+    size_t n = ring.reserve(40, region);
+    CHECK(n == 40);
+    CHECK(region.size[0] + region.size[1] == 40);
+    fillBytes(in, 40, 7);
+    memcpy(region.data[0], in, region.size[0]);
+    memcpy(region.data[1], in + region.size[0], region.size[1]);
+    CHECK(ring.peek(100, region) == 0);
+    ring.commit(40);
+    CHECK(ring.peek(100, region) == 40);
+    CHECK(checkBytes(region.data[0], region.size[0], 7));
+    CHECK(checkBytes(region.data[1], region.size[1], 7 + region.size[0]));
+    CHECK(ring.consume(25));
+    CHECK(ring.peek(100, region) == 15);
+    CHECK(region.data[0][0] == (char)(7 + 25));
+    CHECK(ring.consume(15));
+
+    // a blocking ring only reserves what's free
+    RingBuffer blocking(64, RingBuffer::BLOCK);
+    CHECK(blocking.reserve(100, region) == 64);
+    blocking.commit(48);
+    CHECK(blocking.reserve(100, region) == 16);
+    CHECK(blocking.peek(100, region) == 48);
+    CHECK(blocking.consume(48));
+    CHECK(blocking.reserve(100, region) == 64);
+    blocking.commit(64);
+    CHECK(blocking.reserve(1, region) == 0);
+    blocking.reset();
+    CHECK(blocking.reserve(100, region) == 64);
+}
+
+// Moves both positions ahead by bytes through reserve and commit, nothing copied
+static void advance(RingBuffer &ring, uint32_t bytes)
+{
+    RingBuffer::Region region;
+
+    while (bytes) {
+        size_t n = ring.reserve(bytes < ring.size() ? bytes : ring.size(), region);
+        ring.commit(n);
+        ring.peek(n, region);
+        ring.consume(n);
+        bytes -= n;
+    }
+}
+
+static void checkWrap()
+{
+    char in[256], out[256];
+    RingBuffer::Region region;
+
+    fillBytes(in, 256, 3);
+
+    // the reset at 0 is long done once the positions are past 2^31
+    RingBuffer ring(4096);
+    ring.reset();
+    advance(ring, 0x80002000);
+    CHECK(ring.copy(out, 16) == 0);
+    CHECK(ring.peek(100, region) == 0);
+    ring.write(in, 40);
+    CHECK(ring.read(out, 40) == 40);
+    CHECK(checkBytes(out, 40, 3));
+
+    RingBuffer blocking(4096, RingBuffer::BLOCK);
+    blocking.reset();
+    advance(blocking, 0x80002000);
+    CHECK(blocking.reserve(8192, region) == 4096);
+
+    // a reset just before 2^32 drops what's unread, not what comes after
+    advance(ring, 0x7fffdff0);
+    ring.write(in, 100);
+    ring.reset();
+    CHECK(ring.copy(out, 100) == 0);
+    ring.write(in, 64);
+    CHECK(ring.copy(out, 100) == 64);
+    CHECK(ring.read(out, 64) == 64);
+    CHECK(checkBytes(out, 64, 3));
+
+    // and doesn't come back 2^32 bytes later
+    advance(ring, 0xffffff00);
+    ring.write(in, 200);
+    CHECK(ring.read(out, 200) == 200);
+    CHECK(checkBytes(out, 200, 3));
+
+    advance(blocking, 0x7fffdff0);
+    blocking.reserve(100, region);
+    blocking.commit(100);
+    blocking.reset();
+    CHECK(blocking.reserve(8192, region) == 4096);
+    advance(blocking, 0xffffff00);
+    CHECK(blocking.reserve(8192, region) == 4096);
+}
+
+/* --- writer and reader threads ---------------------------------------------- */
+
+struct StressArgs {
+    RingBuffer *    ring;
+    long long       deadline;
+    uint32_t        written;    // words
+    unsigned int    seed;
+};
+
+static void *stressWriter(void *arg)
+{
+    StressArgs *args = (StressArgs *)arg;
+    uint32_t words[AUDIO_CHUNK_SIZE];
+    uint32_t next = 1;
+
+    while (nowNs() < args->deadline) {
+        size_t count = 1 + rand_r(&args->seed) % AUDIO_CHUNK_SIZE;
+        for (size_t i = 0; i < count; i++)
+            words[i] = next++;
+        if (rand_r(&args->seed) & 1) {
+            args->ring->write(words, count * 4);
+        } else {
+            // through reserve and commit, maybe in pieces
+            size_t done = 0;
+            while (done < count) {
+                RingBuffer::Region region;
+                size_t n = args->ring->reserve((count - done) * 4, region) & ~3;
+                if (n == 0) {
+                    sched_yield();
+                    continue;
+                }
+                memcpy(region.data[0], (char *)(words + done), region.size[0]);
+                memcpy(region.data[1], (char *)(words + done) + region.size[0], n - region.size[0]);
+                args->ring->commit(n);
+                done += n / 4;
+            }
+        }
+        if ((rand_r(&args->seed) & 63) == 0)
+            usleep(100);
+    }
+    // zeros to the end of any read the reader has going
+    memset(words, 0, sizeof(words));
+    args->ring->write(words, sizeof(words));
+    args->written = next - 1;
+    return NULL;
+}
+
+// start: where the positions are when the threads begin, to cross 2^31 and 2^32
+static void stress(RingBuffer::Mode mode, int seconds, uint32_t start = 0)
+{
+    RingBuffer ring(RING_SIZE, mode);
+    StressArgs args = { &ring, nowNs() + seconds * 1000000000LL, 0, 1234 };
+    pthread_t writer;
+    uint32_t words[AUDIO_CHUNK_SIZE];
+    uint32_t last = 0, received = 0, skipped = 0;
+    unsigned int seed = 4321;
+    bool done = false;
+    int errors = 0;
+
+    ring.reset();
+    advance(ring, start);
+    pthread_create(&writer, NULL, stressWriter, &args);
+
+    while (!done) {
+        size_t count = 1 + rand_r(&seed) % AUDIO_CHUNK_SIZE;
+        if (rand_r(&seed) & 1) {
+            ring.read(words, count * 4);
+        } else {
+            RingBuffer::Region region;
+            size_t n = ring.peek(count * 4, region) & ~3;
+            if (n == 0) {
+                sched_yield();
+                continue;
+            }
+            memcpy((char *)words, region.data[0], region.size[0]);
+            memcpy((char *)words + region.size[0], region.data[1], n - region.size[0]);
+            if (!ring.consume(n)) continue;
+            count = n / 4;
+        }
+        for (size_t i = 0; i < count && !done; i++) {
+            if (words[i] == 0) {
+                done = true;
+            } else if (words[i] <= last || (mode == RingBuffer::BLOCK && words[i] != last + 1)) {
+                if (errors++ < 5)
+                    PRINT("  word %u after %u\n", words[i], last);
+            } else {
+                skipped += words[i] - last - 1;
+                last = words[i];
+                received++;
+            }
+        }
+        if ((rand_r(&seed) & 63) == 0)
+            usleep(150);
+    }
+    pthread_join(writer, NULL);
+
+    CHECK(errors == 0);
+    CHECK(last == args.written || mode == RingBuffer::OVERWRITE);
+    CHECK(received + skipped == last);
+    PRINT("%s from %#x: %u words written, %u read in order, %u dropped\n",
+          mode == RingBuffer::BLOCK ? "block" : "overwrite", start, args.written, received, skipped);
+}
+
+/* --- wake-up latency ------------------------------------------------------ */
+
+struct LatencyArgs {
+    RingBuffer *    ring;
+    LegacyRing *    legacy;
+    int             chunks;
+    int             periodUs;
+};
+
+static void *latencyWriter(void *arg)
+{
+    LatencyArgs *args = (LatencyArgs *)arg;
+    char chunk[AUDIO_CHUNK_SIZE];
+
+    memset(chunk, 0, sizeof(chunk));
+    for (int i = 0; i < args->chunks; i++) {
+        usleep(args->periodUs);
+        long long t = nowNs();
+        memcpy(chunk, &t, sizeof(t));
+        if (args->ring)
+            args->ring->write(chunk, sizeof(chunk));
+        else
+            args->legacy->write(chunk, sizeof(chunk));
+    }
+    return NULL;
+}
+
+static int compareLL(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void latency(const char *name, RingBuffer *ring, LegacyRing *legacy, int chunks, int periodUs)
+{
+    LatencyArgs args = { ring, legacy, chunks, periodUs };
+    long long *samples = new long long[chunks];
+    char chunk[AUDIO_CHUNK_SIZE];
+    pthread_t writer;
+
+    pthread_create(&writer, NULL, latencyWriter, &args);
+    for (int i = 0; i < chunks; i++) {
+        long long t;
+        if (ring)
+            ring->read(chunk, sizeof(chunk));
+        else
+            legacy->read(chunk, sizeof(chunk));
+        memcpy(&t, chunk, sizeof(t));
+        samples[i] = nowNs() - t;
+    }
+    pthread_join(writer, NULL);
+
+    qsort(samples, chunks, sizeof(samples[0]), compareLL);
+    PRINT("%-10s write to read, us: p50 %6.1f  p99 %6.1f  max %6.1f\n", name,
+          samples[chunks / 2] / 1000.0, samples[chunks * 99 / 100] / 1000.0,
+          samples[chunks - 1] / 1000.0);
+    delete [] samples;
+}
+
+static void throughput(int chunks)
+{
+    char chunk[AUDIO_CHUNK_SIZE];
+    RingBuffer ring(RING_SIZE);
+    LegacyRing legacy(RING_SIZE);
+
+    memset(chunk, 0, sizeof(chunk));
+    long long t0 = nowNs();
+    for (int i = 0; i < chunks; i++) {
+        ring.write(chunk, sizeof(chunk));
+        ring.read(chunk, sizeof(chunk));
+    }
+    long long t1 = nowNs();
+    for (int i = 0; i < chunks; i++) {
+        legacy.write(chunk, sizeof(chunk));
+        legacy.read(chunk, sizeof(chunk));
+    }
+    long long t2 = nowNs();
+
+    PRINT("one thread, ns per %d byte write and read: lock-free %.0f, legacy %.0f\n",
+          AUDIO_CHUNK_SIZE, (double)(t1 - t0) / chunks, (double)(t2 - t1) / chunks);
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = 2;
+    int periodUs = 1000;
+    int chunks = 2000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:p:n:")) != -1) {
+        switch (opt) {
+            case 's': seconds = atoi(optarg); break;
+            case 'p': periodUs = atoi(optarg); break;
+            case 'n': chunks = atoi(optarg); break;
+            default:
+                PRINT("usage: %s [-s seconds] [-p period_us] [-n chunks]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (chunks < 1) chunks = 1;
+
+    checkBasics();
+    checkWrap();
+    stress(RingBuffer::BLOCK, seconds);
+    stress(RingBuffer::OVERWRITE, seconds);
+    stress(RingBuffer::BLOCK, seconds, 0x7ffff000);
+    stress(RingBuffer::OVERWRITE, seconds, 0x7ffff000);
+    stress(RingBuffer::BLOCK, seconds, 0xfffff000);
+    stress(RingBuffer::OVERWRITE, seconds, 0xfffff000);
+
+    RingBuffer ring(RING_SIZE);
+    LegacyRing legacy(RING_SIZE);
+    latency("lock-free", &ring, NULL, chunks, periodUs);
+    latency("legacy", NULL, &legacy, chunks, periodUs);
+    throughput(chunks * 10);
+
+    PRINT("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,279 @@
+/* ALSAControlCache_Test.cpp
+ **
+ ** Copyright 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/*
+ * Route switches through ALSAControlCache against setting every control by
+ * name as ALSAControl does, on the mixer of any card. Two routes are made
+ * of the card's switches and volumes, one all at their minimum and one
+ * with every other control at its maximum.
+ *
+ * On a Linux host with the dummy driver (modprobe snd-dummy):
+ *
+ *   ALSAControlCache_HostTest -D hw:Dummy
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <ALSAControlCache.h>
+
+using namespace android;
+
+#define PRINT printf
+
+#define MAX_CONTROLS    64
+#define SWITCHES        200
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        PRINT("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+struct Route {
+    unsigned int    count;
+    const char *    names[MAX_CONTROLS];
+    unsigned int    values[MAX_CONTROLS];
+};
+
+static char names[MAX_CONTROLS][44];
+static long mins[MAX_CONTROLS], maxs[MAX_CONTROLS];
+static unsigned int controls;
+static char enumName[44], enumItem[64];
+
+static int64_t now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// The writable switches and volumes of the card, and one enumeration
+static bool listControls(const char *device)
+{
+    snd_ctl_t *ctl;
+    snd_ctl_elem_list_t *list;
+    snd_ctl_elem_info_t *info;
+
+    if (snd_ctl_open(&ctl, device, 0) < 0) {
+        PRINT("can't open the controls of %s\n", device);
+        return false;
+    }
+    snd_ctl_elem_list_alloca(&list);
+    snd_ctl_elem_info_alloca(&info);
+    snd_ctl_elem_list(ctl, list);
+    snd_ctl_elem_list_alloc_space(list, snd_ctl_elem_list_get_count(list));
+    snd_ctl_elem_list(ctl, list);
+
+    for (unsigned int i = 0; i < snd_ctl_elem_list_get_used(list) && controls < MAX_CONTROLS; i++) {
+        // by name is the first of the elements of a name
+        if (snd_ctl_elem_list_get_index(list, i))
+            continue;
+        snd_ctl_elem_info_set_numid(info, snd_ctl_elem_list_get_numid(list, i));
+        if (snd_ctl_elem_info(ctl, info) < 0 || !snd_ctl_elem_info_is_writable(info) ||
+            snd_ctl_elem_info_get_count(info) > ALSAControlCache::MAX_VALUES)
+            continue;
+
+        const char *name = snd_ctl_elem_list_get_name(list, i);
+        snd_ctl_elem_type_t type = snd_ctl_elem_info_get_type(info);
+        if (type == SND_CTL_ELEM_TYPE_ENUMERATED && !enumName[0] &&
+            snd_ctl_elem_info_get_items(info) > 1) {
+            strncpy(enumName, name, sizeof(enumName) - 1);
+            snd_ctl_elem_info_set_item(info, 1);
+            snd_ctl_elem_info(ctl, info);
+            strncpy(enumItem, snd_ctl_elem_info_get_item_name(info), sizeof(enumItem) - 1);
+        } else if (type == SND_CTL_ELEM_TYPE_BOOLEAN || type == SND_CTL_ELEM_TYPE_INTEGER) {
+            strncpy(names[controls], name, sizeof(names[controls]) - 1);
+            mins[controls] = type == SND_CTL_ELEM_TYPE_BOOLEAN ? 0 : snd_ctl_elem_info_get_min(info);
+            maxs[controls] = type == SND_CTL_ELEM_TYPE_BOOLEAN ? 1 : snd_ctl_elem_info_get_max(info);
+            controls++;
+        }
+    }
+
+    snd_ctl_elem_list_free_space(list);
+    snd_ctl_close(ctl);
+    return controls >= 2;
+}
+
+// What ALSAControl does for each set: the element by name, its info, a write
+static int legacySet(snd_ctl_t *ctl, const char *name, unsigned int value)
+{
+    snd_ctl_elem_id_t *id;
+    snd_ctl_elem_info_t *info;
+    snd_ctl_elem_value_t *control;
+    int err;
+
+    snd_ctl_elem_id_alloca(&id);
+    snd_ctl_elem_info_alloca(&info);
+    snd_ctl_elem_value_alloca(&control);
+
+    snd_ctl_elem_id_set_interface(id, SND_CTL_ELEM_IFACE_MIXER);
+    snd_ctl_elem_id_set_name(id, name);
+    snd_ctl_elem_info_set_id(info, id);
+    if ((err = snd_ctl_elem_info(ctl, info)) < 0)
+        return err;
+
+    snd_ctl_elem_info_get_id(info, id);
+    snd_ctl_elem_value_set_id(control, id);
+    for (unsigned int i = 0; i < snd_ctl_elem_info_get_count(info); i++) {
+        if (snd_ctl_elem_info_get_type(info) == SND_CTL_ELEM_TYPE_BOOLEAN)
+            snd_ctl_elem_value_set_boolean(control, i, value);
+        else
+            snd_ctl_elem_value_set_integer(control, i, value);
+    }
+    return snd_ctl_elem_write(ctl, control);
+}
+
+static long readBack(snd_ctl_t *ctl, const char *name)
+{
+    snd_ctl_elem_id_t *id;
+    snd_ctl_elem_value_t *control;
+
+    snd_ctl_elem_id_alloca(&id);
+    snd_ctl_elem_value_alloca(&control);
+    snd_ctl_elem_id_set_interface(id, SND_CTL_ELEM_IFACE_MIXER);
+    snd_ctl_elem_id_set_name(id, name);
+    snd_ctl_elem_value_set_id(control, id);
+    if (snd_ctl_elem_read(ctl, control) < 0)
+        return -1;
+    return snd_ctl_elem_value_get_integer(control, 0);
+}
+
+static void applyRoute(ALSAControlCache &mixer, const Route &route)
+{
+    for (unsigned int i = 0; i < route.count; i++)
+        mixer.set(route.names[i], route.values[i]);
+}
+
+int main(int argc, char **argv)
+{
+    const char *device = "hw:Dummy";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "D:")) != -1) {
+        switch (opt) {
+            case 'D': device = optarg; break;
+            default:
+                PRINT("usage: %s [-D device]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (!listControls(device)) {
+        PRINT("no mixer to run against on %s\n", device);
+        return 1;
+    }
+
+    Route routes[2];
+    unsigned int differ = 0;
+    for (unsigned int r = 0; r < 2; r++) {
+        routes[r].count = controls;
+        for (unsigned int i = 0; i < controls; i++) {
+            routes[r].names[i] = names[i];
+            routes[r].values[i] = r && i % 2 ? maxs[i] : mins[i];
+        }
+    }
+    for (unsigned int i = 0; i < controls; i++)
+        differ += routes[0].values[i] != routes[1].values[i];
+
+    // every control by name, as many writes as the route has controls
+    int64_t start = now();
+    for (int s = 0; s < SWITCHES; s++) {
+        snd_ctl_t *ctl;
+        CHECK(snd_ctl_open(&ctl, device, 0) == 0);
+        for (unsigned int i = 0; i < controls; i++)
+            legacySet(ctl, routes[s % 2].names[i], routes[s % 2].values[i]);
+        snd_ctl_close(ctl);
+    }
+    int64_t legacy = now() - start;
+
+    ALSAControlCache mixer(device);
+    CHECK(mixer.initCheck() == NO_ERROR);
+
+    applyRoute(mixer, routes[1]);
+    mixer.apply();
+    mixer.resetStats();
+
+    start = now();
+    for (int s = 0; s < SWITCHES; s++) {
+        applyRoute(mixer, routes[s % 2]);
+        int written = mixer.apply();
+        CHECK(written == (int)differ);
+    }
+    int64_t cached = now() - start;
+    ALSAControlCache::Stats stats = mixer.stats();
+
+    PRINT("%u controls, %u differ between the routes, %d switches\n", controls, differ, SWITCHES);
+    PRINT("  by name   %7.1f us a switch, %u writes\n", (double)legacy / SWITCHES, controls * SWITCHES);
+    PRINT("  cached    %7.1f us a switch, %u writes, %u unchanged, %u reads\n",
+          (double)cached / SWITCHES, stats.writes, stats.skipped, stats.reads);
+    CHECK(stats.writes == differ * SWITCHES);
+
+    // the same route again writes nothing
+    applyRoute(mixer, routes[1]);
+    CHECK(mixer.apply() == 0);
+
+    // the card has what the cache thinks it has
+    snd_ctl_t *other;
+    CHECK(snd_ctl_open(&other, device, 0) == 0);
+    for (unsigned int i = 0; i < controls; i++) {
+        unsigned int value = 0;
+        CHECK(mixer.get(names[i], value) == NO_ERROR && value == routes[1].values[i]);
+        CHECK(readBack(other, names[i]) == (long)routes[1].values[i]);
+    }
+
+    // a write from elsewhere isn't masked by the cache
+    unsigned int changed = 0;
+    while (changed < controls && mins[changed] == maxs[changed])
+        changed++;
+    if (changed < controls) {
+        long outside = routes[1].values[changed] == (unsigned int)mins[changed] ? maxs[changed]
+                                                                                 : mins[changed];
+        CHECK(legacySet(other, names[changed], outside) >= 0);
+        applyRoute(mixer, routes[1]);
+        CHECK(mixer.apply() == 1);
+        CHECK(readBack(other, names[changed]) == (long)routes[1].values[changed]);
+    }
+    snd_ctl_close(other);
+
+    // staged values can be dropped, the last one staged wins
+    mixer.set(names[0], maxs[0]);
+    mixer.discard();
+    CHECK(mixer.apply() == 0);
+    mixer.set(names[1], routes[1].values[1] == (unsigned int)maxs[1] ? mins[1] : maxs[1]);
+    mixer.set(names[1], routes[1].values[1]);
+    CHECK(mixer.apply() == 0);
+
+    if (enumName[0]) {
+        unsigned int item = 0;
+        CHECK(mixer.set(enumName, enumItem) == NO_ERROR);
+        CHECK(mixer.apply() >= 0);
+        CHECK(mixer.get(enumName, item) == NO_ERROR && item == 1);
+        CHECK(mixer.set(enumName, "no such item") == BAD_VALUE);
+    }
+
+    CHECK(mixer.set("No Such Control", 1) == BAD_VALUE);
+    CHECK(mixer.set(names[0], maxs[0] + 1) == BAD_VALUE);
+
+    PRINT("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,346 @@
+/* ALSAResampler_Test.cpp
+ **
+ ** Copyright 2011-2012, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/*
+ * The polyphase resampler of each quality against the linear interpolation
+ * the acoustics "resample" node did before, kept here as it was: THD+N of
+ * tones through the usual rate pairs, then the CPU time per output frame
+ * and per second of stereo. The output must not depend on how the input
+ * is cut into blocks, and DC must come out as it went in.
+ *
+ *   ALSAResampler_HostTest [-s seconds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include <utils/Timers.h>
+
+#include <ALSAResampler.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace android;
+
+#define PRINT printf
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        PRINT("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+#define PERIOD_FRAMES 256
+
+// The linear interpolation as it was
+class LinearResampler
+{
+public:
+    LinearResampler(int inRate, int outRate, int channels) :
+        mInRate(inRate), mOutRate(outRate), mChannels(channels),
+        mStep((uint32_t)(((uint64_t)inRate << 16) / outRate)), mPhase(1 << 16)
+    {
+        memset(mLast, 0, sizeof(mLast));
+    }
+
+    size_t resample(const int16_t *in, size_t frames, int16_t *out, size_t capacity)
+    {
+        size_t count = 0;
+        uint32_t end = (uint32_t)frames << 16;
+        while (mPhase < end && count < capacity) {
+            size_t i = mPhase >> 16;
+            int32_t frac = mPhase & 0xffff;
+            const int16_t *b = in + i * mChannels;
+            for (int c = 0; c < mChannels; c++) {
+                int32_t a = i ? b[c - mChannels] : mLast[c];
+                *out++ = a + (((b[c] - a) * frac) >> 16);
+            }
+            mPhase += mStep;
+            count++;
+        }
+        mPhase -= end;
+        memcpy(mLast, in + (frames - 1) * mChannels, mChannels * sizeof(int16_t));
+        return count;
+    }
+
+private:
+    int         mInRate;
+    int         mOutRate;
+    int         mChannels;
+    uint32_t    mStep;
+    uint32_t    mPhase;
+    int16_t     mLast[2];
+};
+
+static const char *qualityName(int quality)
+{
+    static const char *names[] = { "low", "medium", "high" };
+    return quality < 0 ? "linear" : names[quality];
+}
+
+static int16_t *makeTone(int rate, int channels, size_t frames, double freq, double level)
+{
+    int16_t *samples = new int16_t[frames * channels];
+
+    for (size_t n = 0; n < frames; n++)
+        for (int c = 0; c < channels; c++)
+            samples[n * channels + c] = (int16_t)lrint(level * 32767 * sin(2 * M_PI * freq * n / rate));
+    return samples;
+}
+
+// Runs frames of in through the linear interpolation for quality -1 or
+// the polyphase resampler, in blocks of period. Returns the output frames.
+static size_t run(int quality, int inRate, int outRate, int channels,
+                  const int16_t *in, size_t frames, size_t period, int16_t *out)
+{
+    ALSAResampler resampler;
+    LinearResampler linear(inRate, outRate, channels);
+    size_t written = 0;
+
+    if (quality >= 0 &&
+        resampler.configure(inRate, outRate, channels, period, quality) != NO_ERROR)
+        return 0;
+
+    for (size_t done = 0; done < frames; done += period) {
+        size_t n = frames - done < period ? frames - done : period;
+        const int16_t *src = in + done * channels;
+        int16_t *dst = out + written * channels;
+        written += quality >= 0 ?
+                resampler.resample(src, n, dst, resampler.outputFrames(n)) :
+                linear.resample(src, n, dst, (n * outRate + inRate - 1) / inRate + 1);
+    }
+    return written;
+}
+
+// Fits a sine of freq and a DC to the first channel of the middle of out,
+// what is left over against the tone in dB
+static double thdN(const int16_t *out, size_t frames, int channels, int rate, double freq)
+{
+    size_t skip = frames / 8;
+    double sxx = 0, syy = 0, sxy = 0, sx = 0, sy = 0;
+    double bx = 0, by = 0, b1 = 0;
+    size_t count = frames - 2 * skip;
+
+    for (size_t n = skip; n < frames - skip; n++) {
+        double x = sin(2 * M_PI * freq * n / rate);
+        double y = cos(2 * M_PI * freq * n / rate);
+        double v = out[n * channels];
+        sxx += x * x; syy += y * y; sxy += x * y; sx += x; sy += y;
+        bx += v * x; by += v * y; b1 += v;
+    }
+
+    // normal equations of v ~ a x + b y + c
+    double m[3][4] = {
+        { sxx, sxy, sx, bx },
+        { sxy, syy, sy, by },
+        { sx, sy, (double)count, b1 },
+    };
+    for (int i = 0; i < 3; i++) {
+        for (int j = i + 1; j < 3; j++) {
+            double f = m[j][i] / m[i][i];
+            for (int k = i; k < 4; k++)
+                m[j][k] -= f * m[i][k];
+        }
+    }
+    double coef[3];
+    for (int i = 2; i >= 0; i--) {
+        double s = m[i][3];
+        for (int k = i + 1; k < 3; k++)
+            s -= m[i][k] * coef[k];
+        coef[i] = s / m[i][i];
+    }
+
+    double signal = 0, residual = 0;
+    for (size_t n = skip; n < frames - skip; n++) {
+        double x = sin(2 * M_PI * freq * n / rate);
+        double y = cos(2 * M_PI * freq * n / rate);
+        double fit = coef[0] * x + coef[1] * y;
+        double r = out[n * channels] - fit - coef[2];
+        signal += fit * fit;
+        residual += r * r;
+    }
+    return 10 * log10(residual / signal);
+}
+
+struct RatePair {
+    int in;
+    int out;
+};
+
+static const RatePair kPairs[] = {
+    { 44100, 48000 },
+    { 48000, 44100 },
+    { 8000, 48000 },
+    { 48000, 16000 },
+    { 16000, 8000 },
+    { 11025, 16000 },
+};
+
+// The lowest THD+N each quality must reach on every pair
+static const double kLimit[ALSAResampler::QUALITY_COUNT] = { -45.0, -65.0, -85.0 };
+
+static void checkThdN()
+{
+    PRINT("THD+N, dB          tone    linear       low    medium      high\n");
+    for (size_t i = 0; i < sizeof(kPairs) / sizeof(kPairs[0]); i++) {
+        const RatePair &p = kPairs[i];
+        int lower = p.in < p.out ? p.in : p.out;
+        double tones[] = { 1000.0 * lower / 48000, 0.3 * lower };
+        size_t frames = p.in;
+
+        for (int t = 0; t < 2; t++) {
+            int16_t *in = makeTone(p.in, 1, frames, tones[t], 0.5);
+            size_t capacity = (size_t)((uint64_t)frames * p.out / p.in) + frames / PERIOD_FRAMES + 2;
+            int16_t *out = new int16_t[capacity];
+            double result[ALSAResampler::QUALITY_COUNT + 1];
+
+            for (int q = -1; q < ALSAResampler::QUALITY_COUNT; q++) {
+                size_t n = run(q, p.in, p.out, 1, in, frames, PERIOD_FRAMES, out);
+                size_t expected = (size_t)((uint64_t)frames * p.out / p.in);
+                if (q >= 0)
+                    CHECK(n + 2 >= expected && n <= expected + 2);
+                result[q + 1] = thdN(out, n, 1, p.out, tones[t]);
+                if (q >= 0 && result[q + 1] > kLimit[q]) {
+                    PRINT("FAILED %d to %d Hz, %.0f Hz, %s: %.1f dB\n", p.in, p.out,
+                          tones[t], qualityName(q), result[q + 1]);
+                    failures++;
+                }
+            }
+            PRINT("%5d to %5d %7.0f  %8.1f  %8.1f  %8.1f  %8.1f\n", p.in, p.out, tones[t],
+                  result[0], result[1], result[2], result[3]);
+
+            delete [] out;
+            delete [] in;
+        }
+    }
+}
+
+// The same output cut in blocks of 1, 7 and a period, DC kept exactly
+static void checkBlocks()
+{
+    const int inRate = 44100, outRate = 48000;
+    const size_t frames = 4410;
+    int16_t *in = makeTone(inRate, 2, frames, 997, 0.9);
+    size_t capacity = frames * outRate / inRate + frames + 2;
+    int16_t *ref = new int16_t[capacity * 2];
+    int16_t *out = new int16_t[capacity * 2];
+
+    for (int q = 0; q < ALSAResampler::QUALITY_COUNT; q++) {
+        size_t n = run(q, inRate, outRate, 2, in, frames, PERIOD_FRAMES, ref);
+        size_t sizes[] = { 1, 7, 1000 };
+        for (int s = 0; s < 3; s++) {
+            size_t m = run(q, inRate, outRate, 2, in, frames, sizes[s], out);
+            CHECK(m == n && !memcmp(ref, out, n * 2 * sizeof(int16_t)));
+        }
+    }
+
+    for (size_t i = 0; i < frames * 2; i++)
+        in[i] = -12345;
+    for (size_t i = 0; i < sizeof(kPairs) / sizeof(kPairs[0]); i++) {
+        ALSAResampler r;
+        CHECK(r.configure(kPairs[i].in, kPairs[i].out, 2, frames, ALSAResampler::QUALITY_HIGH) == NO_ERROR);
+        size_t n = r.resample(in, frames, out, capacity);
+        size_t settled = (size_t)r.taps() * kPairs[i].out / kPairs[i].in + 1;
+        bool exact = n > settled;
+        for (size_t k = settled * 2; k < n * 2; k++)
+            exact = exact && out[k] == -12345;
+        CHECK(exact);
+    }
+
+    delete [] out;
+    delete [] ref;
+    delete [] in;
+}
+
+static void checkConfigure()
+{
+    ALSAResampler r;
+    int16_t in[16] = { 0 }, out[64];
+
+    CHECK(r.configure(0, 48000, 2, 256, ALSAResampler::QUALITY_LOW) == BAD_VALUE);
+    CHECK(r.configure(44100, 48000, 3, 256, ALSAResampler::QUALITY_LOW) == BAD_VALUE);
+    CHECK(r.configure(44100, 48000, 2, 256, ALSAResampler::QUALITY_COUNT) == BAD_VALUE);
+    CHECK(r.resample(in, 8, out, 32) == 0);
+
+    // the budget buys the best quality it can
+    uint32_t high = ALSAResampler::cost(ALSAResampler::QUALITY_HIGH, 44100, 48000, 2);
+    uint32_t medium = ALSAResampler::cost(ALSAResampler::QUALITY_MEDIUM, 44100, 48000, 2);
+    CHECK(medium < high);
+    CHECK(ALSAResampler::qualityFor(high, 44100, 48000, 2) == ALSAResampler::QUALITY_HIGH);
+    CHECK(ALSAResampler::qualityFor(high - 1, 44100, 48000, 2) == ALSAResampler::QUALITY_MEDIUM);
+    CHECK(ALSAResampler::qualityFor(0, 44100, 48000, 2) == ALSAResampler::QUALITY_LOW);
+    // decimating, the taps grow by the ratio
+    CHECK(ALSAResampler::cost(ALSAResampler::QUALITY_HIGH, 48000, 8000, 1) == 6 * 64 * 8000);
+}
+
+// CPU time per output frame and the share of a core one stereo stream takes
+static void benchmark(unsigned int seconds)
+{
+    const RatePair pairs[] = { { 44100, 48000 }, { 8000, 48000 }, { 48000, 16000 } };
+
+    PRINT("stereo, ns/frame   quality  MMAC/s  ns/frame  %%CPU\n");
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+        const RatePair &p = pairs[i];
+        size_t frames = p.in * seconds;
+        int16_t *in = makeTone(p.in, 2, frames, 1000, 0.5);
+        size_t capacity = (size_t)((uint64_t)frames * p.out / p.in) + frames / PERIOD_FRAMES + 2;
+        int16_t *out = new int16_t[capacity * 2];
+
+        for (int q = -1; q < ALSAResampler::QUALITY_COUNT; q++) {
+            nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+            size_t n = run(q, p.in, p.out, 2, in, frames, PERIOD_FRAMES, out);
+            nsecs_t took = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+            PRINT("%5d to %5d  %9s  %6.1f  %8.1f  %5.2f\n", p.in, p.out, qualityName(q),
+                  q >= 0 ? ALSAResampler::cost(q, p.in, p.out, 2) / 1e6 : 0.0,
+                  n ? (double)took / n : 0.0, 100.0 * took / (seconds * 1e9));
+        }
+
+        delete [] out;
+        delete [] in;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int seconds = 10;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+        case 's': seconds = atoi(optarg); break;
+        default:
+            PRINT("usage: %s [-s seconds]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    checkConfigure();
+    checkBlocks();
+    checkThdN();
+    if (seconds)
+        benchmark(seconds);
+
+    PRINT("%s: %d failures\n", argv[0], failures);
+    return failures ? 1 : 0;
+}
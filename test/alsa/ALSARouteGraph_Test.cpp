@@ -0,0 +1,466 @@
+/* ALSARouteGraph_Test.cpp
+ **
+ ** Copyright 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/*
+ * The OMAP4 route table simulated on a mixer in memory, no codec needed.
+ * Every route is checked against the routing code the table replaced,
+ * kept here as it was, and the transitions the graph computes are played
+ * on top of each other to check they land on the same mixer.
+ *
+ *   ALSARouteGraph_HostTest
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <media/AudioSystem.h>
+
+#include <alsa_omap4.h>
+
+using namespace android;
+
+#define PRINT printf
+
+#define MAX_CONTROLS    128
+#define ROUTES          2000
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        PRINT("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+// The last value each control was given
+struct Mixer {
+    unsigned int    count;
+    RouteSetting    controls[MAX_CONTROLS];
+    unsigned int    writes;
+
+    Mixer() : count(0), writes(0) {}
+
+    void set(const char *control, const char *item, unsigned int value, int index)
+    {
+        unsigned int i;
+        for (i = 0; i < count && strcmp(controls[i].control, control); i++)
+            ;
+        if (i == count && count < MAX_CONTROLS)
+            count++;
+        RouteSetting setting = { control, item, value, index };
+        controls[i] = setting;
+        writes++;
+    }
+
+    const RouteSetting *get(const char *control) const
+    {
+        for (unsigned int i = 0; i < count; i++) {
+            if (!strcmp(controls[i].control, control))
+                return &controls[i];
+        }
+        return NULL;
+    }
+};
+
+static bool same(const RouteSetting *a, const RouteSetting *b)
+{
+    if (!a || !b)
+        return a == b;
+    if (a->index != b->index)
+        return false;
+    if (a->item || b->item)
+        return a->item && b->item && !strcmp(a->item, b->item);
+    return a->value == b->value;
+}
+
+static bool same(const Mixer &a, const Mixer &b)
+{
+    bool equal = a.count == b.count;
+
+    for (unsigned int i = 0; i < a.count; i++) {
+        const RouteSetting *s = &a.controls[i];
+        const RouteSetting *o = b.get(s->control);
+        if (!same(s, o)) {
+            PRINT("  '%s' is %s/%u[%d] and %s/%u[%d]\n", s->control,
+                  s->item ? s->item : "-", s->value, s->index,
+                  o && o->item ? o->item : "-", o ? o->value : 0, o ? o->index : 0);
+            equal = false;
+        }
+    }
+    return equal;
+}
+
+// ALSAControl's calls of the code the table replaced
+static Mixer *legacyMixer;
+
+static void set(const char *control, unsigned int value, int index = -1)
+{
+    legacyMixer->set(control, NULL, value, index);
+}
+
+static void set(const char *control, const char *item)
+{
+    legacyMixer->set(control, item, 0, -1);
+}
+
+// setAlsaControls as it was, less what the properties set. "BT UL VOlume"
+// is spelled as the control it meant to mute.
+static void legacyRoute(Mixer &mixer, uint32_t devices, bool fm)
+{
+    legacyMixer = &mixer;
+
+    /* check whether the devices is input or not */
+    /* for output devices */
+    if (devices & 0x0000FFFF){
+        if (devices & AudioSystem::DEVICE_OUT_SPEAKER) {
+            /* OMAP4 ABE */
+            set("DL2 Mixer Multimedia", 1);		// MM_DL    -> DL2 Mixer
+            set("DL2 Media Playback Volume", 118);
+            /* TWL6040 */
+            set("HF Left Playback", "HF DAC");		// HFDAC L -> HF Mux
+            set("HF Right Playback", "HF DAC");		// HFDAC R -> HF Mux
+            set("Handsfree Playback Volume", 23);
+            if (fm) {
+                set("DL2 Capture Playback Volume", 115);
+                set("DL1 Capture Playback Volume", 0, -1);
+            }
+            else {
+                set("DL2 Capture Playback Volume", 0, -1);
+            }
+        } else {
+            /* OMAP4 ABE */
+            set("DL2 Mixer Multimedia", 0, 0);
+            set("DL2 Media Playback Volume", 0, -1);
+            set("DL2 Capture Playback Volume", 0, -1);
+            /* TWL6040 */
+            set("HF Left Playback", "Off");
+            set("HF Right Playback", "Off");
+            set("Handsfree Playback Volume", 0, -1);
+        }
+
+        if ((devices & AudioSystem::DEVICE_OUT_WIRED_HEADSET) ||
+            (devices & AudioSystem::DEVICE_OUT_LOW_POWER)) {
+            /* TWL6040 */
+            set("HS Left Playback", "HS DAC");		// HSDAC L -> HS Mux
+            set("HS Right Playback", "HS DAC");		// HSDAC R -> HS Mux
+            set("Headset Playback Volume", 15);
+        } else {
+            /* TWL6040 */
+            set("HS Left Playback", "Off");
+            set("HS Right Playback", "Off");
+            set("Headset Playback Volume", 0, -1);
+        }
+
+        if (devices & AudioSystem::DEVICE_OUT_EARPIECE) {
+            /* TWL6040 */
+            set("EP Playback", "On");		// HSDACL -> Earpiece
+            set("Earphone Playback Volume", 15);
+        } else {
+            /* TWL6040 */
+            set("Earphone Playback Volume", 0, -1);
+            set("EP Playback", "Off");
+        }
+        if ((devices & AudioSystem::DEVICE_OUT_EARPIECE) ||
+            (devices & AudioSystem::DEVICE_OUT_WIRED_HEADSET) ||
+            (devices & AudioSystem::DEVICE_OUT_LOW_POWER)) {
+            /* OMAP4 ABE */
+            set("DL1 Mixer Multimedia", 1);		// MM_DL    -> DL1 Mixer
+            set("Sidetone Mixer Playback", 1);		// DL1 Mixer-> Sidetone Mixer
+            set("SDT DL Volume", 118);
+            set("DL1 Media Playback Volume", 118);
+            set("DL1 PDM Switch", 1);
+            if (fm) {
+                set("DL1 Capture Playback Volume", 115);
+                set("DL2 Capture Playback Volume", 0, -1);
+            }
+            else {
+                set("DL1 Capture Playback Volume", 0, -1);
+            }
+        } else {
+            /* OMAP4 ABE */
+            set("DL1 Mixer Multimedia", 0, 0);
+            set("Sidetone Mixer Playback", 0, 0);
+            set("SDT DL Volume", 0, 0);
+            set("DL1 PDM Switch", 0, 0);
+            set("DL1 Media Playback Volume", 0, -1);
+            set("DL1 Capture Playback Volume", 0, -1);
+        }
+        if (devices & AudioSystem::DEVICE_OUT_FM_TRANSMIT) {
+            /* OMAP4 ABE */
+            set("DL1 Mixer Multimedia", 1);             // MM_DL    -> DL1 Mixer
+            set("Sidetone Mixer Playback", 1);          // DL1 Mixer-> Sidetone Mixer
+            set("SDT DL Volume", 118);
+            set("DL1 Media Playback Volume", 118);
+            set("DL1 MM_EXT Switch", 1);
+            set("DL1 PDM Switch", 0, 0);
+        } else {
+            /* Disable MM_EXT Switch */
+            set("DL1 MM_EXT Switch", 0, 0);
+        }
+        if ((devices & AudioSystem::DEVICE_OUT_BLUETOOTH_SCO) ||
+            (devices & AudioSystem::DEVICE_OUT_BLUETOOTH_SCO_HEADSET) ||
+            (devices & AudioSystem::DEVICE_OUT_BLUETOOTH_SCO_CARKIT)) {
+            /* OMAP4 ABE */
+            /* Bluetooth: DL1 Mixer */
+            set("DL1 Mixer Multimedia", 1);        // MM_DL    -> DL1 Mixer
+            set("Sidetone Mixer Playback", 1);     // DL1 Mixer-> Sidetone Mixer
+            set("SDT DL Volume", 118);
+            set("DL1 BT_VX Switch", 1);            // Sidetone Mixer -> BT-VX-DL
+            set("DL1 Media Playback Volume", 118);
+        } else {
+            set("DL1 BT_VX Switch", 0, 0);
+        }
+        if ((devices & AudioSystem::DEVICE_OUT_SPEAKER) ||
+            (devices & AudioSystem::DEVICE_OUT_AUX_DIGITAL)) {
+            // Setting DL2 EQ's to 800Hz cut-off frequency, as setting
+            // to flat response saturates the audio quality in the
+            // handsfree speakers
+            set("DL2 Left Equalizer", "High-pass 0dB");
+            set("DL2 Right Equalizer", "High-pass 0dB");
+        }
+        if ((devices & AudioSystem::DEVICE_OUT_WIRED_HEADSET) ||
+            (devices & AudioSystem::DEVICE_OUT_EARPIECE)) {
+            set("DL1 Equalizer", "Flat response");
+        }
+        set("TWL6040 Power Mode", "Low-Power");
+
+    }
+
+    /* for input devices */
+    if (devices >> 16) {
+        if (devices & AudioSystem::DEVICE_IN_BUILTIN_MIC) {
+            /* TWL6040 */
+            set("Analog Left Capture Route", "Main Mic");	// Main Mic -> Mic Mux
+            set("Analog Right Capture Route", "Sub Mic");	// Sub Mic  -> Mic Mux
+            set("Capture Preamplifier Volume", 1);
+            set("Capture Volume", 4);
+        } else if (devices & AudioSystem::DEVICE_IN_WIRED_HEADSET) {
+            /* TWL6040 */
+            set("Analog Left Capture Route", "Headset Mic");	// Headset Mic -> Mic Mux
+            set("Analog Right Capture Route", "Headset Mic");	// Headset Mic -> Mic Mux
+            set("Capture Preamplifier Volume", 1);
+            set("Capture Volume", 4);
+            set("AMIC_UL PDM Switch", 1);
+            set("MUX_UL00", "AMic1");
+            set("MUX_UL11", "AMic0");
+        } else if (devices & OMAP4_IN_FM) {
+            /* TWL6040 */
+            set("Analog Left Capture Route", "Aux/FM Left");     // FM -> Mic Mux
+            set("Analog Right Capture Route", "Aux/FM Right");   // FM -> Mic Mux
+            set("Capture Preamplifier Volume", 1);
+            set("Capture Volume", 1);
+            set("AMIC_UL PDM Switch", 1);
+            set("MUX_UL10", "AMic1");
+            set("MUX_UL11", "AMic0");
+        } else if(devices & OMAP4_IN_SCO) {
+            set("AMIC_UL PDM Switch", 0, 0);
+            set("MUX_UL00", "BT Right");
+            set("MUX_UL01", "BT Left");
+            set("MUX_UL10", "BT Right");
+            set("MUX_UL11", "BT Left");
+            set("BT UL Volume", 120);
+            set("Voice Capture Mixer Capture", 1);
+        } else if (devices & AudioSystem::DEVICE_IN_VOICE_CALL) {
+            set("MUX_UL00", "VX Right");
+            set("MUX_UL01", "VX Left");
+        } else {
+            /* TWL6040 */
+            set("Analog Left Capture Route", "Off");
+            set("Analog Right Capture Route", "Off");
+            set("Capture Preamplifier Volume", 0, -1);
+            set("Capture Volume", 0, -1);
+            set("BT UL Volume", 0, -1);        // BT UL --> MUTE
+            set("Voice Capture Mixer Capture", 0, 0);
+            set("AMIC_UL PDM Switch", 0, 0);
+            /* ABE */
+            set("MUX_UL00", "None");
+            set("MUX_UL01", "None");
+            set("MUX_UL10", "None");
+            set("MUX_UL11", "None");
+        }
+    }
+
+}
+
+static void graphRoute(ALSARouteGraph &graph, Mixer &mixer, uint32_t devices, bool fm)
+{
+    const RouteSetting *list[MAX_CONTROLS];
+
+    size_t changed = graph.select(devices, fm ? OMAP4_ROUTE_FM : 0);
+    size_t n = graph.changes(list, MAX_CONTROLS);
+    CHECK(n == changed);
+    for (size_t i = 0; i < n && i < MAX_CONTROLS; i++)
+        mixer.set(list[i]->control, list[i]->item, list[i]->value, list[i]->index);
+    graph.commit();
+}
+
+static const uint32_t outputs[] = {
+    AudioSystem::DEVICE_OUT_EARPIECE,
+    AudioSystem::DEVICE_OUT_SPEAKER,
+    AudioSystem::DEVICE_OUT_WIRED_HEADSET,
+    AudioSystem::DEVICE_OUT_LOW_POWER,
+    AudioSystem::DEVICE_OUT_FM_TRANSMIT,
+    AudioSystem::DEVICE_OUT_BLUETOOTH_SCO,
+    AudioSystem::DEVICE_OUT_BLUETOOTH_SCO_HEADSET,
+    AudioSystem::DEVICE_OUT_AUX_DIGITAL,
+};
+
+static const uint32_t inputs[] = {
+    AudioSystem::DEVICE_IN_BUILTIN_MIC,
+    AudioSystem::DEVICE_IN_WIRED_HEADSET,
+    AudioSystem::DEVICE_IN_FM_ANALOG,
+    AudioSystem::DEVICE_IN_BLUETOOTH_SCO_HEADSET,
+    AudioSystem::DEVICE_IN_VOICE_CALL,
+    AudioSystem::DEVICE_IN_BACK_MIC,
+};
+
+#define COUNT(a) (sizeof(a) / sizeof(a[0]))
+
+static uint32_t randomRoute()
+{
+    const uint32_t *devices = rand() % 2 ? outputs : inputs;
+    unsigned int count = devices == outputs ? COUNT(outputs) : COUNT(inputs);
+    uint32_t route = 0;
+
+    // one device most of the time, as in a call, a few at once otherwise
+    do {
+        route |= devices[rand() % count];
+    } while (rand() % 3 == 0);
+    return route;
+}
+
+// The legacy code writes every control of a side on each route, the graph
+// its changes
+static void transition(const char *name, uint32_t from, uint32_t to)
+{
+    ALSARouteGraph graph(omap4Routes, omap4RouteCount);
+    Mixer legacy, routed;
+
+    legacyRoute(legacy, from, false);
+    graphRoute(graph, routed, from, false);
+    legacy.writes = routed.writes = 0;
+
+    legacyRoute(legacy, to, false);
+    graphRoute(graph, routed, to, false);
+    CHECK(same(legacy, routed));
+    PRINT("  %-24s %3u sets, %3u changes\n", name, legacy.writes, routed.writes);
+}
+
+int main()
+{
+    ALSARouteGraph graph(omap4Routes, omap4RouteCount);
+    Mixer legacy, routed;
+
+    PRINT("%u paths on %u controls\n", (unsigned int)omap4RouteCount,
+          (unsigned int)graph.controls());
+
+    // every output on its own and with each other, with and without FM
+    for (unsigned int mask = 1; mask < 1U << COUNT(outputs); mask++) {
+        uint32_t devices = 0;
+        for (unsigned int i = 0; i < COUNT(outputs); i++)
+            if (mask & 1 << i) devices |= outputs[i];
+
+        for (int fm = 0; fm < 2; fm++) {
+            Mixer l, r;
+            ALSARouteGraph g(omap4Routes, omap4RouteCount);
+            legacyRoute(l, devices, fm);
+            graphRoute(g, r, devices, fm);
+            if (!same(l, r)) {
+                PRINT("FAILED output route %08x fm %d\n", devices, fm);
+                failures++;
+            }
+        }
+    }
+
+    // every input on its own and with each other
+    for (unsigned int mask = 1; mask < 1U << COUNT(inputs); mask++) {
+        uint32_t devices = 0;
+        for (unsigned int i = 0; i < COUNT(inputs); i++)
+            if (mask & 1 << i) devices |= inputs[i];
+
+        Mixer l, r;
+        ALSARouteGraph g(omap4Routes, omap4RouteCount);
+        legacyRoute(l, devices, false);
+        graphRoute(g, r, devices, false);
+        if (!same(l, r)) {
+            PRINT("FAILED input route %08x\n", devices);
+            failures++;
+        }
+    }
+
+    // routes one after the other, the changes alone land where every
+    // control written does
+    srand(1);
+    unsigned int legacyWrites = 0, routedWrites = 0;
+    for (int r = 0; r < ROUTES; r++) {
+        uint32_t devices = randomRoute();
+        bool fm = rand() % 4 == 0;
+
+        legacyRoute(legacy, devices, fm);
+        graphRoute(graph, routed, devices, fm);
+        if (!same(legacy, routed)) {
+            PRINT("FAILED route %d to %08x fm %d\n", r, devices, fm);
+            failures++;
+            break;
+        }
+    }
+    legacyWrites = legacy.writes;
+    routedWrites = routed.writes;
+    PRINT("%d routes: %u sets by the code, %u changes by the graph\n", ROUTES,
+          legacyWrites, routedWrites);
+
+    // the same route again changes nothing
+    graph.select(AudioSystem::DEVICE_OUT_SPEAKER, 0);
+    graph.commit();
+    CHECK(graph.select(AudioSystem::DEVICE_OUT_SPEAKER, 0) == 0);
+    CHECK(graph.isOn("speaker") && !graph.isOn("earpiece"));
+
+    // FM only moves the loopback volumes
+    const RouteSetting *list[MAX_CONTROLS];
+    CHECK(graph.select(AudioSystem::DEVICE_OUT_SPEAKER, OMAP4_ROUTE_FM) == 1);
+    CHECK(graph.changes(list, MAX_CONTROLS) == 1 &&
+          !strcmp(list[0]->control, "DL2 Capture Playback Volume") && list[0]->value == 115);
+    CHECK(graph.isOn("speaker-fm"));
+
+    // an input route leaves the outputs as they are
+    graph.commit();
+    graph.select(AudioSystem::DEVICE_IN_BUILTIN_MIC, 0);
+    CHECK(graph.isOn("speaker") && graph.isOn("main-mic") && !graph.isOn("capture-off"));
+    size_t n = graph.changes(list, MAX_CONTROLS);
+    for (size_t i = 0; i < n; i++)
+        CHECK(strncmp(list[i]->control, "DL", 2) && strncmp(list[i]->control, "HF", 2));
+    graph.commit();
+    CHECK(graph.current("Capture Volume") && graph.current("Capture Volume")->value == 4);
+    CHECK(graph.current("No Such Control") == NULL);
+
+    // a call set up from music on the speaker and moved around
+    PRINT("call transitions:\n");
+    transition("speaker -> earpiece", AudioSystem::DEVICE_OUT_SPEAKER,
+               AudioSystem::DEVICE_OUT_EARPIECE);
+    transition("earpiece -> speaker", AudioSystem::DEVICE_OUT_EARPIECE,
+               AudioSystem::DEVICE_OUT_SPEAKER);
+    transition("earpiece -> headset", AudioSystem::DEVICE_OUT_EARPIECE,
+               AudioSystem::DEVICE_OUT_WIRED_HEADSET);
+    transition("earpiece -> bluetooth", AudioSystem::DEVICE_OUT_EARPIECE,
+               AudioSystem::DEVICE_OUT_BLUETOOTH_SCO);
+    transition("main mic -> headset mic", AudioSystem::DEVICE_IN_BUILTIN_MIC,
+               AudioSystem::DEVICE_IN_WIRED_HEADSET);
+
+    PRINT("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+/* ALSAStreamCache_Test.cpp
+ **
+ ** Copyright 2011-2012, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/*
+ * Standby and resume through the PCM cache against the close and open
+ * they replace: the time from asking for a stream to its first period
+ * running, the way a short sound after standby pays it. Then what the
+ * cache must get right: another configuration misses and frees the
+ * device, the hold closes what isn't resumed, a hold of 0 closes on
+ * standby as before.
+ *
+ * On a Linux host with the dummy driver (modprobe snd-dummy):
+ *
+ *   ALSAStreamCache_HostTest -P hw:Dummy,0 [-n sounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#include <ALSAStreamCache.h>
+
+using namespace android;
+
+#define PRINT printf
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        PRINT("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+typedef ALSAStreamCache::Config Config;
+typedef ALSAStreamCache::Granted Granted;
+
+static const char *device = "hw:Dummy,0";
+static unsigned int rate = 48000;
+static unsigned int channels = 2;
+static unsigned int latency = 20000;        // us
+
+static Config makeConfig(unsigned int streamRate)
+{
+    Config config;
+
+    memset(&config, 0, sizeof(config));
+    strncpy(config.device, device, sizeof(config.device) - 1);
+    config.stream = SND_PCM_STREAM_PLAYBACK;
+    config.format = SND_PCM_FORMAT_S16_LE;
+    config.channels = channels;
+    config.rate = streamRate;
+    config.mmap = false;
+    config.latency = latency;
+    config.devices = 0x2;
+    return config;
+}
+
+// What s_open does without the cache: open, then the hw and sw parameters
+static snd_pcm_t *openPcm(const Config &config, Granted &granted)
+{
+    snd_pcm_t *pcm;
+    snd_pcm_uframes_t buffer, period;
+
+    if (snd_pcm_open(&pcm, config.device, config.stream, 0) < 0)
+        return NULL;
+    if (snd_pcm_set_params(pcm, config.format, SND_PCM_ACCESS_RW_INTERLEAVED,
+                           config.channels, config.rate, 1, config.latency) < 0) {
+        snd_pcm_close(pcm);
+        return NULL;
+    }
+    snd_pcm_get_params(pcm, &buffer, &period);
+    granted.bufferSize = buffer;
+    granted.latency = (unsigned int)((uint64_t)buffer * 1000000 / config.rate);
+    return pcm;
+}
+
+// A period written and the PCM running: the first sample is on its way
+static bool firstPeriod(snd_pcm_t *pcm, const Granted &granted, int16_t *silence)
+{
+    snd_pcm_uframes_t period = granted.bufferSize / 4;
+
+    if (snd_pcm_writei(pcm, silence, period) != (snd_pcm_sframes_t)period)
+        return false;
+    if (snd_pcm_state(pcm) != SND_PCM_STATE_RUNNING && snd_pcm_start(pcm) < 0)
+        return false;
+    return snd_pcm_state(pcm) == SND_PCM_STATE_RUNNING;
+}
+
+static int compare(const void *a, const void *b)
+{
+    nsecs_t x = *(const nsecs_t *)a, y = *(const nsecs_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report(const char *what, nsecs_t *times, unsigned int n)
+{
+    nsecs_t total = 0;
+
+    qsort(times, n, sizeof(times[0]), compare);
+    for (unsigned int i = 0; i < n; i++)
+        total += times[i];
+    PRINT("%-12s %9.1f %9.1f %9.1f %9.1f\n", what, ns2us(total) / (double)n,
+          (double)ns2us(times[n / 2]), (double)ns2us(times[n * 95 / 100]),
+          (double)ns2us(times[n - 1]));
+}
+
+// Time to the first period of n short sounds, each after a standby
+static void timeFirstSample(unsigned int n)
+{
+    Config config = makeConfig(rate);
+    Granted granted;
+    nsecs_t *cold = new nsecs_t[n];
+    nsecs_t *warm = new nsecs_t[n];
+    int16_t *silence = new int16_t[(size_t)rate * channels];
+    memset(silence, 0, (size_t)rate * channels * sizeof(int16_t));
+
+    // standby closes, resume opens and negotiates
+    ALSAStreamCache *closing = new ALSAStreamCache(0);
+    for (unsigned int i = 0; i < n; i++) {
+        nsecs_t start = systemTime();
+        snd_pcm_t *pcm = closing->resume(config, granted);
+        if (!pcm)
+            pcm = openPcm(config, granted);
+        CHECK(pcm && firstPeriod(pcm, granted, silence));
+        cold[i] = systemTime() - start;
+        if (pcm) {
+            closing->add(pcm, config, granted);
+            closing->park(pcm);
+        }
+    }
+    CHECK(closing->parkedCount() == 0 && closing->stats().resumed == 0);
+    delete closing;
+
+    // standby parks, resume prepares
+    ALSAStreamCache *cache = new ALSAStreamCache();
+    cache->run("ALSAStreamCache", PRIORITY_NORMAL);
+    snd_pcm_t *first = NULL;
+    for (unsigned int i = 0; i < n; i++) {
+        nsecs_t start = systemTime();
+        snd_pcm_t *pcm = cache->resume(config, granted);
+        if (!pcm)
+            pcm = openPcm(config, granted);
+        CHECK(pcm && firstPeriod(pcm, granted, silence));
+        warm[i] = systemTime() - start;
+        if (!first)
+            first = pcm;
+        CHECK(pcm == first);
+        if (pcm) {
+            cache->add(pcm, config, granted);
+            cache->park(pcm);
+        }
+    }
+    ALSAStreamCache::Stats stats = cache->stats();
+    CHECK(stats.resumed == n - 1 && stats.missed == 1 && stats.parked == n);
+    CHECK(cache->parkedCount() == 1);
+    delete cache;
+
+    PRINT("first period, us   average    median       95%%     worst\n");
+    report("open", cold, n);
+    report("resume", warm, n);
+    qsort(cold, n, sizeof(cold[0]), compare);
+    qsort(warm, n, sizeof(warm[0]), compare);
+    CHECK(warm[n / 2] < cold[n / 2]);
+
+    delete [] silence;
+    delete [] warm;
+    delete [] cold;
+}
+
+// Another rate misses and takes the device back, the hold runs out
+static void checkConfigs()
+{
+    Config config = makeConfig(rate);
+    Config other = makeConfig(rate == 48000 ? 44100 : 48000);
+    Granted granted;
+
+    ALSAStreamCache *cache = new ALSAStreamCache(milliseconds(100));
+    cache->run("ALSAStreamCache", PRIORITY_NORMAL);
+
+    snd_pcm_t *pcm = openPcm(config, granted);
+    CHECK(pcm != NULL);
+    if (!pcm)
+        goto done;
+    CHECK(cache->add(pcm, config, granted) == NO_ERROR);
+    CHECK(cache->park(pcm) == NO_ERROR && cache->parkedCount() == 1);
+
+    // the parked PCM would keep the device busy for the other rate
+    CHECK(cache->resume(other, granted) == NULL);
+    CHECK(cache->parkedCount() == 0 && cache->stats().evicted == 1);
+    pcm = openPcm(other, granted);
+    CHECK(pcm != NULL);
+    if (!pcm)
+        goto done;
+
+    // not resumed within the hold
+    CHECK(cache->add(pcm, other, granted) == NO_ERROR);
+    CHECK(cache->park(pcm) == NO_ERROR && cache->parkedCount() == 1);
+    usleep(300000);
+    CHECK(cache->parkedCount() == 0 && cache->stats().expired == 1);
+    CHECK(cache->resume(other, granted) == NULL);
+
+    // a hold of 0 closes on standby
+    cache->setHold(0);
+    pcm = openPcm(other, granted);
+    CHECK(pcm != NULL);
+    if (!pcm)
+        goto done;
+    cache->add(pcm, other, granted);
+    CHECK(cache->park(pcm) == NO_ERROR && cache->parkedCount() == 0);
+
+    // a PCM it doesn't know is closed, not kept
+    cache->setHold(milliseconds(ALSAStreamCache::DEFAULT_HOLD));
+    pcm = openPcm(other, granted);
+    CHECK(pcm != NULL);
+    if (pcm)
+        CHECK(cache->park(pcm) == NO_ERROR && cache->parkedCount() == 0);
+
+done:
+    delete cache;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int n = 50;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "P:n:r:c:l:")) != -1) {
+        switch (opt) {
+        case 'P': device = optarg; break;
+        case 'n': n = atoi(optarg); break;
+        case 'r': rate = atoi(optarg); break;
+        case 'c': channels = atoi(optarg); break;
+        case 'l': latency = atoi(optarg); break;
+        default:
+            PRINT("usage: %s [-P pcm] [-n sounds] [-r rate] [-c channels] [-l latency_us]\n",
+                  argv[0]);
+            return 1;
+        }
+    }
+    if (!n || !rate || !channels || !latency) {
+        PRINT("%s: sounds, rate, channels and latency can't be 0\n", argv[0]);
+        return 1;
+    }
+
+    checkConfigs();
+    timeFirstSample(n);
+
+    PRINT("%s: %d failures\n", argv[0], failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,354 @@
+/* AlsaLatency_Test.cpp
+ **
+ ** Copyright 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/*
+ * Output latency of a buffer the OMAP ALSA modules size from a latency
+ * target against the fixed buffer the multimedia output had, 4096 frames
+ * in 4 periods.
+ *
+ * On a Linux host, with the loopback driver (modprobe snd-aloop) each
+ * pass plays impulses and times them to the capture side:
+ *
+ *   AlsaLatency_HostTest -l 10000
+ *
+ * With the dummy driver (modprobe snd-dummy) only the delay of the
+ * playback is measured:
+ *
+ *   AlsaLatency_HostTest -D hw:Dummy -C none
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <alsa_geometry.h>
+
+using namespace android;
+
+#define PRINT printf
+
+#define LEGACY_BUFFER       4096
+#define LEGACY_PERIODS      4
+#define CAPTURE_LATENCY     10000       // usec
+#define IMPULSE_INTERVAL    250000      // usec
+#define IMPULSE_LEVEL       16384
+#define MAX_IMPULSES        256
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        PRINT("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+static unsigned int rate = 48000;
+static int channels = 2;
+
+static int64_t now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+struct Pass {
+    const char *        name;
+    bool                sized;          // from latency, or the fixed buffer
+    unsigned int        latency;
+
+    // what the playback was granted
+    PcmGeometry         geometry;
+
+    // playback delay after each transfer
+    int64_t             delaySum;
+    int64_t             delayMax;
+    int                 delayCount;
+    int                 xruns;
+
+    // impulses, committed by the player and found by the recorder
+    pthread_mutex_t     lock;
+    int64_t             played[MAX_IMPULSES];
+    int                 playedCount;
+    int64_t             roundTripSum;
+    int64_t             roundTripMax;
+    int                 found;
+
+    volatile bool       done;
+    snd_pcm_t *         capture;
+};
+
+static int setParams(snd_pcm_t *pcm, Pass &pass, bool sized, unsigned int latency)
+{
+    snd_pcm_hw_params_t *hw;
+    snd_pcm_sw_params_t *sw;
+    int err;
+
+    snd_pcm_hw_params_alloca(&hw);
+    snd_pcm_sw_params_alloca(&sw);
+
+    if ((err = snd_pcm_hw_params_any(pcm, hw)) < 0 ||
+        (err = snd_pcm_hw_params_set_access(pcm, hw, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0 ||
+        (err = snd_pcm_hw_params_set_format(pcm, hw, SND_PCM_FORMAT_S16_LE)) < 0 ||
+        (err = snd_pcm_hw_params_set_channels(pcm, hw, channels)) < 0 ||
+        (err = snd_pcm_hw_params_set_rate(pcm, hw, rate, 0)) < 0) {
+        PRINT("%s: can't set the format: %s\n", pass.name, snd_strerror(err));
+        return err;
+    }
+
+    if (sized) {
+        if ((err = pcmSetGeometry(pcm, hw, latency, false, pass.geometry)) < 0)
+            return err;
+    } else {
+        // the sizing alsa_omap4 had before it took a latency target
+        snd_pcm_uframes_t buffer = LEGACY_BUFFER, period = LEGACY_BUFFER / LEGACY_PERIODS;
+        if ((err = snd_pcm_hw_params_set_buffer_size_near(pcm, hw, &buffer)) < 0 ||
+            (err = snd_pcm_hw_params_set_period_size_near(pcm, hw, &period, NULL)) < 0) {
+            PRINT("%s: can't set the buffer: %s\n", pass.name, snd_strerror(err));
+            return err;
+        }
+        snd_pcm_hw_params_get_period_size(hw, &pass.geometry.periodSize, NULL);
+        snd_pcm_hw_params_get_buffer_size(hw, &pass.geometry.bufferSize);
+        snd_pcm_hw_params_get_period_time(hw, &pass.geometry.periodTime, NULL);
+        snd_pcm_hw_params_get_buffer_time(hw, &pass.geometry.bufferTime, NULL);
+        snd_pcm_hw_params_get_periods(hw, &pass.geometry.periods, NULL);
+    }
+
+    if ((err = snd_pcm_hw_params(pcm, hw)) < 0) {
+        PRINT("%s: hw params refused: %s\n", pass.name, snd_strerror(err));
+        return err;
+    }
+
+    // as setSoftwareParams does: start and wake up a period at a time
+    snd_pcm_uframes_t buffer, period;
+    snd_pcm_get_params(pcm, &buffer, &period);
+    if ((err = snd_pcm_sw_params_current(pcm, sw)) < 0 ||
+        (err = snd_pcm_sw_params_set_start_threshold(pcm, sw, period)) < 0 ||
+        (err = snd_pcm_sw_params_set_avail_min(pcm, sw, period)) < 0 ||
+        (err = snd_pcm_sw_params(pcm, sw)) < 0) {
+        PRINT("%s: sw params refused: %s\n", pass.name, snd_strerror(err));
+        return err;
+    }
+    return 0;
+}
+
+// Silence with an impulse on every channel every IMPULSE_INTERVAL
+static bool fill(int16_t *data, snd_pcm_uframes_t frames, uint64_t &position)
+{
+    uint64_t interval = (uint64_t)rate * IMPULSE_INTERVAL / 1000000;
+    bool impulse = false;
+
+    memset(data, 0, frames * channels * sizeof(int16_t));
+    for (snd_pcm_uframes_t n = 0; n < frames; n++, position++) {
+        if (position % interval == interval - 1) {
+            for (int c = 0; c < channels; c++)
+                data[n * channels + c] = IMPULSE_LEVEL;
+            impulse = true;
+        }
+    }
+    return impulse;
+}
+
+static void *recorder(void *arg)
+{
+    Pass &pass = *(Pass *)arg;
+    snd_pcm_uframes_t buffer, period;
+
+    snd_pcm_get_params(pass.capture, &buffer, &period);
+    int16_t *data = new int16_t[period * channels];
+    bool inImpulse = false;
+
+    while (!pass.done) {
+        snd_pcm_sframes_t n = snd_pcm_readi(pass.capture, data, period);
+        if (n < 0) {
+            snd_pcm_recover(pass.capture, n, 1);
+            continue;
+        }
+        int64_t t = now();
+        snd_pcm_sframes_t delay = 0;
+        snd_pcm_delay(pass.capture, &delay);
+
+        for (snd_pcm_sframes_t i = 0; i < n; i++) {
+            bool high = data[i * channels] > IMPULSE_LEVEL / 2;
+            if (high && !inImpulse) {
+                // when the frame came in: what was read after it and what
+                // is still in the capture buffer came in later
+                int64_t captured = t - (int64_t)(n - i + delay) * 1000000 / rate;
+                pthread_mutex_lock(&pass.lock);
+                if (pass.found < pass.playedCount) {
+                    int64_t roundTrip = captured - pass.played[pass.found];
+                    pass.roundTripSum += roundTrip;
+                    if (roundTrip > pass.roundTripMax) pass.roundTripMax = roundTrip;
+                    pass.found++;
+                }
+                pthread_mutex_unlock(&pass.lock);
+            }
+            inImpulse = high;
+        }
+    }
+
+    delete [] data;
+    return NULL;
+}
+
+static bool run(Pass &pass, const char *playbackDevice, const char *captureDevice, int seconds)
+{
+    snd_pcm_t *playback;
+    pthread_t thread;
+    int err;
+
+    if ((err = snd_pcm_open(&playback, playbackDevice, SND_PCM_STREAM_PLAYBACK, 0)) < 0) {
+        PRINT("can't open %s: %s\n", playbackDevice, snd_strerror(err));
+        return false;
+    }
+    if (setParams(playback, pass, pass.sized, pass.latency) < 0) {
+        snd_pcm_close(playback);
+        return false;
+    }
+
+    pass.capture = NULL;
+    if (captureDevice) {
+        Pass captureParams = pass;
+        captureParams.name = "capture";
+        if (snd_pcm_open(&pass.capture, captureDevice, SND_PCM_STREAM_CAPTURE, 0) < 0 ||
+            setParams(pass.capture, captureParams, true, CAPTURE_LATENCY) < 0) {
+            PRINT("no capture from %s, playback delay only\n", captureDevice);
+            if (pass.capture) snd_pcm_close(pass.capture);
+            pass.capture = NULL;
+        }
+    }
+
+    pthread_mutex_init(&pass.lock, NULL);
+    pass.done = false;
+    if (pass.capture) {
+        snd_pcm_start(pass.capture);
+        pthread_create(&thread, NULL, recorder, &pass);
+    }
+
+    snd_pcm_uframes_t period = pass.geometry.periodSize;
+    int16_t *data = new int16_t[period * channels];
+    uint64_t position = 0, end = (uint64_t)rate * seconds;
+
+    while (position < end) {
+        bool impulse = fill(data, period, position);
+        snd_pcm_sframes_t n = snd_pcm_writei(playback, data, period);
+
+        if (n < 0) {
+            pass.xruns++;
+            snd_pcm_recover(playback, n, 1);
+            continue;
+        }
+
+        snd_pcm_sframes_t delay;
+        if (snd_pcm_delay(playback, &delay) == 0) {
+            int64_t us = (int64_t)delay * 1000000 / rate;
+            pass.delaySum += us;
+            pass.delayCount++;
+            if (us > pass.delayMax) pass.delayMax = us;
+        }
+
+        if (impulse) {
+            pthread_mutex_lock(&pass.lock);
+            if (pass.playedCount < MAX_IMPULSES)
+                pass.played[pass.playedCount++] = now();
+            pthread_mutex_unlock(&pass.lock);
+        }
+    }
+
+    snd_pcm_drain(playback);
+    pass.done = true;
+    if (pass.capture) {
+        pthread_join(thread, NULL);
+        snd_pcm_close(pass.capture);
+    }
+    snd_pcm_close(playback);
+    delete [] data;
+    return true;
+}
+
+static void report(const Pass &pass)
+{
+    PRINT("%-28s %u periods of %4lu frames, buffer %6u us  delay %6lld us average %6lld us worst",
+          pass.name, pass.geometry.periods, pass.geometry.periodSize, pass.geometry.bufferTime,
+          pass.delayCount ? (long long)(pass.delaySum / pass.delayCount) : 0LL,
+          (long long)pass.delayMax);
+    if (pass.found)
+        PRINT("  round trip %6lld us average %6lld us worst (%d impulses)",
+              (long long)(pass.roundTripSum / pass.found), (long long)pass.roundTripMax, pass.found);
+    PRINT("  %d xruns\n", pass.xruns);
+}
+
+int main(int argc, char **argv)
+{
+    const char *playbackDevice = "hw:Loopback,0,0";
+    const char *captureDevice = "hw:Loopback,1,0";
+    unsigned int latency = 10000;
+    int seconds = 5;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "D:C:r:c:l:t:")) != -1) {
+        switch (opt) {
+            case 'D': playbackDevice = optarg; break;
+            case 'C': captureDevice = strcmp(optarg, "none") ? optarg : NULL; break;
+            case 'r': rate = atoi(optarg); break;
+            case 'c': channels = atoi(optarg); break;
+            case 'l': latency = atoi(optarg); break;
+            case 't': seconds = atoi(optarg); break;
+            default:
+                PRINT("usage: %s [-D playback] [-C capture|none] [-r rate] [-c channels] "
+                      "[-l latency_us] [-t seconds]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    static Pass passes[2];
+    char sizedName[64];
+    snprintf(sizedName, sizeof(sizedName), "%u us target", latency);
+    passes[0].name = "fixed, 4096 frames";
+    passes[0].sized = false;
+    passes[1].name = sizedName;
+    passes[1].sized = true;
+    passes[1].latency = latency;
+
+    for (int i = 0; i < 2; i++) {
+        if (!run(passes[i], playbackDevice, captureDevice, seconds)) {
+            PRINT("no %s to run against\n", playbackDevice);
+            return 1;
+        }
+        report(passes[i]);
+    }
+
+    const Pass &legacy = passes[0], &sized = passes[1];
+
+    // the granted buffer is within a period of the target
+    CHECK(sized.geometry.bufferTime <= latency + sized.geometry.periodTime);
+    CHECK(sized.geometry.periods >= 2 && sized.geometry.periods <= PCM_MAX_PERIODS);
+    CHECK(sized.xruns == 0);
+    if (sized.geometry.bufferTime < legacy.geometry.bufferTime) {
+        CHECK(sized.delayCount && sized.delaySum / sized.delayCount <
+              legacy.delaySum / (legacy.delayCount ? legacy.delayCount : 1));
+        if (sized.found && legacy.found)
+            CHECK(sized.roundTripSum / sized.found < legacy.roundTripSum / legacy.found);
+    }
+
+    PRINT("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,266 @@
+LOCAL_PATH:= $(call my-dir)
+
+################################################
+# Latency sizing of the ALSA modules: output latency against the fixed
+# buffer, on the host with the loopback or dummy driver and on the target
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    AlsaLatency_Test.cpp \
+    ../../modules/alsa/alsa_geometry.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/alsa
+
+LOCAL_STATIC_LIBRARIES := libutils libcutils
+LOCAL_LDLIBS += -lasound -lpthread -lrt
+
+LOCAL_MODULE := AlsaLatency_HostTest
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    AlsaLatency_Test.cpp \
+    ../../modules/alsa/alsa_geometry.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/alsa \
+    external/alsa-lib/include
+
+LOCAL_SHARED_LIBRARIES := libasound libutils libcutils liblog
+
+LOCAL_MODULE := AlsaLatency_Test
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
+
+################################################
+# Cached mixer controls: route switches written as a diff against every
+# control set by name, on the host with the dummy driver and on the target
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    ALSAControlCache_Test.cpp \
+    ../../modules/alsa/ALSAControlCache.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/alsa
+
+LOCAL_STATIC_LIBRARIES := libutils libcutils
+LOCAL_LDLIBS += -lasound -lpthread -lrt
+
+LOCAL_MODULE := ALSAControlCache_HostTest
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    ALSAControlCache_Test.cpp \
+    ../../modules/alsa/ALSAControlCache.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/alsa \
+    external/alsa-lib/include
+
+LOCAL_SHARED_LIBRARIES := libasound libutils libcutils liblog
+
+LOCAL_MODULE := ALSAControlCache_Test
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
+
+################################################
+# Route tables: the OMAP4 routes simulated in memory against the routing
+# code they replaced, no codec needed
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    ALSARouteGraph_Test.cpp \
+    ../../modules/alsa/ALSARouteGraph.cpp \
+    ../../modules/alsa/ALSAControlCache.cpp \
+    ../../modules/alsa/alsa_omap4_routes.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/alsa
+
+LOCAL_STATIC_LIBRARIES := libutils libcutils
+LOCAL_LDLIBS += -lasound -lpthread -lrt
+
+LOCAL_MODULE := ALSARouteGraph_HostTest
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+################################################
+# Voice call control: bursts of routing requests against a fake modem,
+# on the host with the dummy driver and on the target
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    VoiceCallControl_Test.cpp \
+    ../../modules/alsa/VoiceCallControl.cpp \
+    ../../modules/alsa/ALSARouteGraph.cpp \
+    ../../modules/alsa/ALSAControlCache.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/alsa
+
+LOCAL_STATIC_LIBRARIES := libutils libcutils
+LOCAL_LDLIBS += -lasound -lpthread -lrt
+
+LOCAL_MODULE := VoiceCallControl_HostTest
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    VoiceCallControl_Test.cpp \
+    ../../modules/alsa/VoiceCallControl.cpp \
+    ../../modules/alsa/ALSARouteGraph.cpp \
+    ../../modules/alsa/ALSAControlCache.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/alsa \
+    external/alsa-lib/include
+
+LOCAL_SHARED_LIBRARIES := libasound libutils libcutils liblog
+
+LOCAL_MODULE := VoiceCallControl_Test
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
+
+################################################
+# Parameter table: the values it takes against the KeyedVector store it
+# replaced, and the cost of the lookups and updates a route change makes
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    Omap4ALSAManager_Test.cpp \
+    ../../modules/alsa/Omap4ALSAManager.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/alsa
+
+LOCAL_STATIC_LIBRARIES := libutils libcutils
+LOCAL_LDLIBS += -lpthread -lrt
+
+LOCAL_MODULE := Omap4ALSAManager_HostTest
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    Omap4ALSAManager_Test.cpp \
+    ../../modules/alsa/Omap4ALSAManager.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/alsa
+
+LOCAL_SHARED_LIBRARIES := libutils libcutils liblog
+
+LOCAL_MODULE := Omap4ALSAManager_Test
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
+
+################################################
+# Polyphase resampler: THD+N of each quality on the usual rate pairs and
+# the CPU time per frame, against the linear interpolation it replaced
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    ALSAResampler_Test.cpp \
+    ../../modules/alsa/ALSAResampler.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/alsa
+
+LOCAL_STATIC_LIBRARIES := libutils libcutils
+LOCAL_LDLIBS += -lpthread -lrt -lm
+
+LOCAL_MODULE := ALSAResampler_HostTest
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    ALSAResampler_Test.cpp \
+    ../../modules/alsa/ALSAResampler.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/alsa
+
+LOCAL_SHARED_LIBRARIES := libutils libcutils liblog
+
+LOCAL_MODULE := ALSAResampler_Test
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
+
+################################################
+# PCM cache: the first period after standby resumed against reopened,
+# and the hold and eviction that give the device back
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    ALSAStreamCache_Test.cpp \
+    ../../modules/alsa/ALSAStreamCache.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/alsa
+
+LOCAL_STATIC_LIBRARIES := libutils libcutils
+LOCAL_LDLIBS += -lasound -lpthread -lrt
+
+LOCAL_MODULE := ALSAStreamCache_HostTest
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    ALSAStreamCache_Test.cpp \
+    ../../modules/alsa/ALSAStreamCache.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/modules/alsa \
+    external/alsa-lib/include
+
+LOCAL_SHARED_LIBRARIES := libasound libutils libcutils liblog
+
+LOCAL_MODULE := ALSAStreamCache_Test
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
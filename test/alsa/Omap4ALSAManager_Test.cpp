@@ -0,0 +1,410 @@
+/* Omap4ALSAManager_Test.cpp
+ **
+ ** Copyright 2011-2012, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/*
+ * The parameter table of Omap4ALSAManager against the KeyedVector of
+ * String8 it replaced, kept here as it was: both must take and refuse
+ * the same values, then the lookups and updates a route change makes
+ * are timed on each. A reader checks it never sees a torn value while
+ * a writer keeps changing the microphones.
+ *
+ *   Omap4ALSAManager_HostTest [-n iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <utils/String8.h>
+#include <utils/KeyedVector.h>
+#include <utils/Timers.h>
+
+#include <Omap4ALSAManager.h>
+
+using namespace android;
+
+#define PRINT printf
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        PRINT("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+typedef Omap4ALSAManager M;
+
+// The manager as it was
+class LegacyManager
+{
+public:
+    status_t get(const String8& key, String8& value)
+    {
+        if (mParams.indexOfKey(key) >= 0) {
+            value = mParams.valueFor(key);
+            return NO_ERROR;
+        }
+        return BAD_VALUE;
+    }
+
+    status_t get(const String8& key, int& value)
+    {
+        String8 stringValue;
+        if (mParams.indexOfKey(key) >= 0) {
+            stringValue = mParams.valueFor(key);
+            value = atoi((const char *)stringValue);
+            return NO_ERROR;
+        }
+        return BAD_VALUE;
+    }
+
+    status_t set(const String8& key, const String8& value)
+    {
+        String8 temp = value;
+        if (validateValueForKey(key, temp) == NO_ERROR) {
+            if (mParams.indexOfKey(key) < 0) {
+                mParams.add(key, value);
+                return NO_ERROR;
+            } else {
+                mParams.replaceValueFor(key, value);
+                return ALREADY_EXISTS;
+            }
+        }
+        return BAD_VALUE;
+    }
+
+    status_t setFromProperty(const String8& key, const String8& init)
+    {
+        char value[PROPERTY_VALUE_MAX];
+
+        if (property_get(key.string(), value, init.string())) {
+            String8 temp = String8(value);
+            if (validateValueForKey(key, temp) == NO_ERROR) {
+                mParams.add(key, (String8)value);
+                return NO_ERROR;
+            }
+        }
+        return BAD_VALUE;
+    }
+
+    static bool inList(const char **list, int first, const String8& value)
+    {
+        for (int i = first; strcmp(list[i], "eof"); i++) {
+            if (!strcmp(list[i], value.string()))
+                return true;
+        }
+        return false;
+    }
+
+    status_t validateValueForKey(const String8& key, String8& value)
+    {
+        const String8 main = String8(M::keyOf(M::MAIN_MIC));
+        const String8 sub = String8(M::keyOf(M::SUB_MIC));
+
+        if (key == main || key == sub) {
+            const String8 &other = key == main ? sub : main;
+            if ((mParams.indexOfKey(other) >= 0) &&
+               (value == mParams.valueFor(other)))
+                return BAD_VALUE;
+            return inList(M::MicNameList, 0, value) ? NO_ERROR : BAD_VALUE;
+        }
+        else if (key == (String8)M::keyOf(M::POWER_MODE)) {
+            return inList(M::PowerModeList, 0, value) ? NO_ERROR : BAD_VALUE;
+        }
+        else if ((key == (String8)M::keyOf(M::DL2L_EQ_PROFILE)) ||
+                 (key == (String8)M::keyOf(M::DL2R_EQ_PROFILE)) ||
+                 (key == (String8)M::keyOf(M::DL1_EQ_PROFILE)) ||
+                 (key == (String8)M::keyOf(M::SDT_EQ_PROFILE))) {
+            return inList(M::EqualizerProfileList, 0, value) ? NO_ERROR : BAD_VALUE;
+        }
+        else if ((key == (String8)M::keyOf(M::AMIC_EQ_PROFILE)) ||
+                 (key == (String8)M::keyOf(M::DMIC_EQ_PROFILE))) {
+            return inList(M::EqualizerProfileList, 1, value) ? NO_ERROR : BAD_VALUE;
+        }
+        else if ((key == (String8)M::keyOf(M::VOICEMEMO_VUL_GAIN)) ||
+                 (key == (String8)M::keyOf(M::VOICEMEMO_VDL_GAIN)) ||
+                 (key == (String8)M::keyOf(M::VOICEMEMO_MM_GAIN)) ||
+                 (key == (String8)M::keyOf(M::VOICEMEMO_TONE_GAIN))) {
+            int gain = atoi((const char *)value);
+            return (-120 <= gain) && (gain <= 29) ? NO_ERROR : BAD_VALUE;
+        }
+        return NO_ERROR;
+    }
+
+    KeyedVector <String8, String8> mParams;
+};
+
+// Both take and refuse the same values, and read them back alike
+static void checkValues()
+{
+    static const struct {
+        M::Param    param;
+        const char  *value;
+    } sets[] = {
+        { M::MAIN_MIC, "AMic0" },
+        { M::SUB_MIC, "AMic0" },        // same as main
+        { M::SUB_MIC, "DMic1L" },
+        { M::MAIN_MIC, "DMic1L" },      // same as sub
+        { M::MAIN_MIC, "DMic3L" },
+        { M::MAIN_MIC, "DMic2R" },
+        { M::POWER_MODE, "PingPong" },
+        { M::POWER_MODE, "pingpong" },
+        { M::DL1_EQ_PROFILE, "Flat response" },
+        { M::AMIC_EQ_PROFILE, "Flat response" },
+        { M::DMIC_EQ_PROFILE, "High-pass -20dB" },
+        { M::SDT_EQ_PROFILE, "High-pass -12dB" },
+        { M::VOICEMEMO_VUL_GAIN, "-120" },
+        { M::VOICEMEMO_VDL_GAIN, "29" },
+        { M::VOICEMEMO_MM_GAIN, "30" },
+        { M::VOICEMEMO_TONE_GAIN, "-121" },
+        { M::VOICEMEMO_TONE_GAIN, "-6" },
+        { M::DL1_EAR_MONO_MIXER, "1" },
+        { M::DL2_SPEAK_MONO_MIXER, "0" },
+    };
+    LegacyManager legacy;
+    M table;
+
+    for (size_t i = 0; i < sizeof(sets) / sizeof(sets[0]); i++) {
+        String8 key = String8(M::keyOf(sets[i].param));
+        status_t was = legacy.set(key, String8(sets[i].value));
+        status_t is = table.set(sets[i].param, sets[i].value);
+        if (was != is)
+            PRINT("%s=%s: %d, was %d\n", key.string(), sets[i].value, is, was);
+        CHECK(was == is);
+    }
+
+    for (int i = 0; i < M::PARAM_COUNT; i++) {
+        M::Param param = (M::Param)i;
+        String8 key = String8(M::keyOf(param));
+        String8 was;
+        const char *item;
+        int value;
+
+        CHECK(M::find(key.string()) == param);
+        if (legacy.get(key, was) != NO_ERROR) {
+            CHECK(table.get(param) == M::NOT_SET);
+        } else if (M::itemsOf(param)) {
+            CHECK(table.get(param, item) == NO_ERROR && !strcmp(item, was.string()));
+        } else {
+            CHECK(table.get(param, value) == NO_ERROR && value == atoi(was.string()));
+        }
+    }
+
+    CHECK(M::find("omap.audio.none") == M::PARAM_COUNT);
+    CHECK(table.remove(M::MAIN_MIC) == NO_ERROR);
+    CHECK(table.remove(M::MAIN_MIC) == BAD_VALUE);
+    CHECK(table.set(M::SUB_MIC, "AMic0") == ALREADY_EXISTS);
+    table.clear();
+    CHECK(table.get(M::SUB_MIC) == M::NOT_SET);
+}
+
+// What a route change asks: the mono mixers from their properties, the
+// microphones and the voice memo gains
+static nsecs_t routeLegacy(LegacyManager &legacy, unsigned int n, int &sum)
+{
+    nsecs_t start = systemTime();
+
+    for (unsigned int i = 0; i < n; i++) {
+        String8 value;
+        int gain;
+
+        if (legacy.setFromProperty((String8)M::keyOf(M::DL2_SPEAK_MONO_MIXER), (String8)"0") == NO_ERROR &&
+            legacy.get((String8)M::keyOf(M::DL2_SPEAK_MONO_MIXER), value) == NO_ERROR)
+            sum += atoi(value.string());
+        if (legacy.setFromProperty((String8)M::keyOf(M::DL1_EAR_MONO_MIXER), (String8)"1") == NO_ERROR &&
+            legacy.get((String8)M::keyOf(M::DL1_EAR_MONO_MIXER), value) == NO_ERROR)
+            sum += atoi(value.string());
+        if (legacy.get((String8)M::keyOf(M::MAIN_MIC), value) == NO_ERROR)
+            sum += value.string()[0];
+        if (legacy.get((String8)M::keyOf(M::SUB_MIC), value) == NO_ERROR)
+            sum += value.string()[0];
+        for (int g = M::VOICEMEMO_VUL_GAIN; g <= M::VOICEMEMO_TONE_GAIN; g++) {
+            if (legacy.get((String8)M::keyOf((M::Param)g), gain) == NO_ERROR)
+                sum += gain;
+        }
+    }
+    return systemTime() - start;
+}
+
+static nsecs_t routeTable(M &table, unsigned int n, int &sum)
+{
+    nsecs_t start = systemTime();
+
+    for (unsigned int i = 0; i < n; i++) {
+        const char *item;
+        int value;
+
+        if (table.setFromProperty(M::DL2_SPEAK_MONO_MIXER, "0") == NO_ERROR &&
+            table.get(M::DL2_SPEAK_MONO_MIXER, value) == NO_ERROR)
+            sum += value;
+        if (table.setFromProperty(M::DL1_EAR_MONO_MIXER, "1") == NO_ERROR &&
+            table.get(M::DL1_EAR_MONO_MIXER, value) == NO_ERROR)
+            sum += value;
+        if (table.get(M::MAIN_MIC, item) == NO_ERROR)
+            sum += item[0];
+        if (table.get(M::SUB_MIC, item) == NO_ERROR)
+            sum += item[0];
+        for (int g = M::VOICEMEMO_VUL_GAIN; g <= M::VOICEMEMO_TONE_GAIN; g++) {
+            if (table.get((M::Param)g, value) == NO_ERROR)
+                sum += value;
+        }
+    }
+    return systemTime() - start;
+}
+
+// Lookups alone: what the voice call and record paths read
+static nsecs_t getLegacy(LegacyManager &legacy, unsigned int n, int &sum)
+{
+    nsecs_t start = systemTime();
+
+    for (unsigned int i = 0; i < n; i++) {
+        int value;
+        M::Param param = (M::Param)(M::VOICEMEMO_VUL_GAIN + i % 4);
+        if (legacy.get((String8)M::keyOf(param), value) == NO_ERROR)
+            sum += value;
+    }
+    return systemTime() - start;
+}
+
+static nsecs_t getTable(M &table, unsigned int n, int &sum)
+{
+    nsecs_t start = systemTime();
+
+    for (unsigned int i = 0; i < n; i++) {
+        int value;
+        M::Param param = (M::Param)(M::VOICEMEMO_VUL_GAIN + i % 4);
+        if (table.get(param, value) == NO_ERROR)
+            sum += value;
+    }
+    return systemTime() - start;
+}
+
+// Updates alone, from strings as AudioParameter hands them
+static nsecs_t setLegacy(LegacyManager &legacy, unsigned int n)
+{
+    static const char *gains[] = { "-120", "-6", "0", "12" };
+    nsecs_t start = systemTime();
+
+    for (unsigned int i = 0; i < n; i++)
+        legacy.set((String8)M::keyOf(M::VOICEMEMO_MM_GAIN), (String8)gains[i % 4]);
+    return systemTime() - start;
+}
+
+static nsecs_t setTable(M &table, unsigned int n)
+{
+    static const char *gains[] = { "-120", "-6", "0", "12" };
+    nsecs_t start = systemTime();
+
+    for (unsigned int i = 0; i < n; i++)
+        table.set(M::VOICEMEMO_MM_GAIN, gains[i % 4]);
+    return systemTime() - start;
+}
+
+static void initBoth(LegacyManager &legacy, M &table)
+{
+    for (int i = 0; i < M::PARAM_COUNT; i++) {
+        M::Param param = (M::Param)i;
+        const char *value = M::itemsOf(param) ?
+                (param == M::SUB_MIC ? "DMic0L" : M::itemsOf(param)[1]) : "0";
+        legacy.set((String8)M::keyOf(param), (String8)value);
+        table.set(param, value);
+    }
+}
+
+static void report(const char *what, nsecs_t was, nsecs_t is, unsigned int n)
+{
+    PRINT("%-20s %8.1f ns  %8.1f ns  x%.1f\n", what,
+          (double)was / n, (double)is / n, is ? (double)was / is : 0.0);
+}
+
+static M *shared;
+static volatile bool done;
+static volatile int sink;       // keeps the timed reads
+
+static void *writer(void *)
+{
+    static const char *mics[] = { "AMic1", "DMic0L", "DMic2R", "DMic1R" };
+
+    for (unsigned int i = 0; !done; i++)
+        shared->set(M::MAIN_MIC, mics[i % 4]);
+    return NULL;
+}
+
+// The reader takes no lock and must only ever see items of the list
+static void checkReaders(unsigned int n)
+{
+    M table;
+    pthread_t thread;
+    unsigned int torn = 0;
+
+    table.set(M::SUB_MIC, "AMic0");
+    table.set(M::MAIN_MIC, "AMic1");
+    shared = &table;
+    done = false;
+    pthread_create(&thread, NULL, writer, NULL);
+
+    for (unsigned int i = 0; i < n; i++) {
+        const char *item = NULL;
+        if (table.get(M::MAIN_MIC, item) != NO_ERROR ||
+            !LegacyManager::inList(M::MicNameList, 0, String8(item)) ||
+            !strcmp(item, "AMic0"))
+            torn++;
+    }
+
+    done = true;
+    pthread_join(thread, NULL);
+    CHECK(torn == 0);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int n = 200000;
+    int opt;
+    int sum = 0;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+        case 'n': n = atoi(optarg); break;
+        default:
+            PRINT("usage: %s [-n iterations]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    checkValues();
+    checkReaders(n);
+
+    LegacyManager legacy;
+    M table;
+    initBoth(legacy, table);
+
+    // warm both up before timing
+    routeLegacy(legacy, n / 10, sum);
+    routeTable(table, n / 10, sum);
+
+    PRINT("%-20s %11s  %11s\n", "per operation", "KeyedVector", "table");
+    report("route change", routeLegacy(legacy, n, sum), routeTable(table, n, sum), n);
+    report("get", getLegacy(legacy, n, sum), getTable(table, n, sum), n);
+    report("set", setLegacy(legacy, n), setTable(table, n), n);
+
+    sink = sum;
+    PRINT("%s: %d failures\n", argv[0], failures);
+    return failures ? 1 : 0;
+}
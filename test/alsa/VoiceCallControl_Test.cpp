@@ -0,0 +1,374 @@
+/* VoiceCallControl_Test.cpp
+ **
+ ** Copyright 2009-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/*
+ * The voice call state machine against a modem that counts what it is
+ * asked and the mixer and PCM of any card. The codec paths are made of
+ * the card's own volumes and switches, set apart per mode so the test
+ * can read back which route the card has.
+ *
+ * On a Linux host with the dummy driver (modprobe snd-dummy):
+ *
+ *   VoiceCallControl_HostTest -D hw:Dummy -P hw:Dummy,0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#include <VoiceCallControl.h>
+
+using namespace android;
+
+#define PRINT printf
+
+#define CONTROLS    4
+#define BURST       50
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        PRINT("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+// A modem that does what it is told and counts it
+class FakeModem : public AudioModemInterface
+{
+public:
+    FakeModem() : routes(0), multiMics(0), opens(0), closes(0), rateQueries(0),
+                  modes(0), rate(INVALID_SAMPLE_RATE), multiMic(-1), open(false),
+                  reportedRate(PCM_16_KHZ) {}
+
+    virtual status_t initCheck() { return NO_ERROR; }
+    virtual status_t setModemRouting(uint32_t r, uint32_t s)
+        { routes++; modes = r; rate = s; return NO_ERROR; }
+    virtual status_t setModemAudioOutputVolume(float, float) { return NO_ERROR; }
+    virtual status_t setModemAudioInputVolume(float, float) { return NO_ERROR; }
+    virtual status_t setModemVoiceCallMultiMic(int m) { multiMics++; multiMic = m; return NO_ERROR; }
+    virtual status_t OpenModemVoiceCallStream() { opens++; open = true; return NO_ERROR; }
+    virtual status_t OpenModemAudioOutputStream(uint32_t, int, int) { return NO_ERROR; }
+    virtual status_t OpenModemAudioInputStream(uint32_t, int, int) { return NO_ERROR; }
+    virtual status_t CloseModemVoiceCallStream() { closes++; open = false; return NO_ERROR; }
+    virtual status_t CloseModemAudioOutputStream() { return NO_ERROR; }
+    virtual status_t CloseModemAudioInputStream() { return NO_ERROR; }
+    virtual uint32_t GetVoiceCallSampleRate() { rateQueries++; return reportedRate; }
+
+    unsigned int    routes, multiMics, opens, closes, rateQueries;
+    uint32_t        modes, rate;
+    int             multiMic;
+    bool            open;
+    uint32_t        reportedRate;
+};
+
+static char names[CONTROLS][44];
+static unsigned int mins[CONTROLS], maxs[CONTROLS];
+
+// Writable volumes and switches of the card with some range
+static bool listControls(const char *device)
+{
+    snd_ctl_t *ctl;
+    snd_ctl_elem_list_t *list;
+    snd_ctl_elem_info_t *info;
+    unsigned int found = 0;
+
+    if (snd_ctl_open(&ctl, device, 0) < 0) {
+        PRINT("can't open the controls of %s\n", device);
+        return false;
+    }
+    snd_ctl_elem_list_alloca(&list);
+    snd_ctl_elem_info_alloca(&info);
+    snd_ctl_elem_list(ctl, list);
+    snd_ctl_elem_list_alloc_space(list, snd_ctl_elem_list_get_count(list));
+    snd_ctl_elem_list(ctl, list);
+
+    for (unsigned int i = 0; i < snd_ctl_elem_list_get_used(list) && found < CONTROLS; i++) {
+        if (snd_ctl_elem_list_get_index(list, i))
+            continue;
+        snd_ctl_elem_info_set_numid(info, snd_ctl_elem_list_get_numid(list, i));
+        if (snd_ctl_elem_info(ctl, info) < 0 || !snd_ctl_elem_info_is_writable(info) ||
+            snd_ctl_elem_info_get_count(info) > ALSAControlCache::MAX_VALUES)
+            continue;
+
+        snd_ctl_elem_type_t type = snd_ctl_elem_info_get_type(info);
+        if (type == SND_CTL_ELEM_TYPE_BOOLEAN) {
+            mins[found] = 0;
+            maxs[found] = 1;
+        } else if (type == SND_CTL_ELEM_TYPE_INTEGER &&
+                   snd_ctl_elem_info_get_max(info) - snd_ctl_elem_info_get_min(info) >= 2) {
+            mins[found] = snd_ctl_elem_info_get_min(info);
+            maxs[found] = snd_ctl_elem_info_get_max(info);
+        } else {
+            continue;
+        }
+        strncpy(names[found], snd_ctl_elem_list_get_name(list, i), sizeof(names[found]) - 1);
+        found++;
+    }
+
+    snd_ctl_elem_list_free_space(list);
+    snd_ctl_close(ctl);
+    // the mode control needs three values
+    return found == CONTROLS && maxs[0] - mins[0] >= 2;
+}
+
+static long readBack(snd_ctl_t *ctl, const char *name)
+{
+    snd_ctl_elem_id_t *id;
+    snd_ctl_elem_value_t *control;
+
+    snd_ctl_elem_id_alloca(&id);
+    snd_ctl_elem_value_alloca(&control);
+    snd_ctl_elem_id_set_interface(id, SND_CTL_ELEM_IFACE_MIXER);
+    snd_ctl_elem_id_set_name(id, name);
+    snd_ctl_elem_value_set_id(control, id);
+    if (snd_ctl_elem_read(ctl, control) < 0)
+        return -1;
+    return snd_ctl_elem_value_get_integer(control, 0);
+}
+
+static void writeOutside(snd_ctl_t *ctl, const char *name, long value)
+{
+    snd_ctl_elem_id_t *id;
+    snd_ctl_elem_value_t *control;
+
+    snd_ctl_elem_id_alloca(&id);
+    snd_ctl_elem_value_alloca(&control);
+    snd_ctl_elem_id_set_interface(id, SND_CTL_ELEM_IFACE_MIXER);
+    snd_ctl_elem_id_set_name(id, name);
+    snd_ctl_elem_value_set_id(control, id);
+    snd_ctl_elem_read(ctl, control);
+    snd_ctl_elem_value_set_integer(control, 0, value);
+    snd_ctl_elem_write(ctl, control);
+}
+
+// control 0 tells the mode, 1 and 2 are the two downlinks, 3 the call
+static RouteSetting handsetOn[2], handfreeOn[2], headsetOn[2];
+static RouteSetting dl1On[2], dl1Off[2], dl2On[2], dl2Off[2];
+static RouteSetting multimediaOn[3], callOn[2], callOff[4];
+
+static void set(RouteSetting *list, unsigned int n, unsigned int control, unsigned int value)
+{
+    list[n].control = names[control];
+    list[n].item = NULL;
+    list[n].value = value;
+    list[n].index = -1;
+    list[n + 1].control = NULL;
+}
+
+#define HANDSET     AudioModemInterface::AUDIO_MODEM_HANDSET
+#define HANDFREE    AudioModemInterface::AUDIO_MODEM_HANDFREE
+#define HEADSET     AudioModemInterface::AUDIO_MODEM_HEADSET
+
+static const RoutePath paths[] = {
+    { "handset",    0xFFFFFFFF, HANDSET,            0, 0, handsetOn,    NULL },
+    { "handfree",   0xFFFFFFFF, HANDFREE,           0, 0, handfreeOn,   NULL },
+    { "headset",    0xFFFFFFFF, HEADSET,            0, 0, headsetOn,    NULL },
+    { "dl1-voice",  0xFFFFFFFF, HANDSET | HEADSET,  0, 0, dl1On,        dl1Off },
+    { "dl2-voice",  0xFFFFFFFF, HANDFREE,           0, 0, dl2On,        dl2Off },
+    { "multimedia", 0xFFFFFFFF, HANDSET | HANDFREE | HEADSET,
+                                                    0, VoiceCallControl::MULTIMEDIA,
+                                                          multimediaOn, NULL },
+    { "call",       0xFFFFFFFF, VoiceCallControl::CALL_ON,
+                                                    0, 0, callOn,       NULL },
+    { "call-off",   0xFFFFFFFF, VoiceCallControl::CALL_OFF,
+                                                    0, 0, callOff,      NULL },
+};
+
+static void makePaths()
+{
+    set(handsetOn, 0, 0, mins[0] + 1);
+    set(handfreeOn, 0, 0, maxs[0]);
+    set(headsetOn, 0, 0, mins[0] + 2);
+    set(dl1On, 0, 1, maxs[1]);
+    set(dl1Off, 0, 1, mins[1]);
+    set(dl2On, 0, 2, maxs[2]);
+    set(dl2Off, 0, 2, mins[2]);
+    set(multimediaOn, 0, 1, maxs[1]);
+    set(multimediaOn, 1, 2, maxs[2]);
+    set(callOn, 0, 3, maxs[3]);
+    set(callOff, 0, 3, mins[3]);
+    set(callOff, 1, 0, mins[0]);
+}
+
+int main(int argc, char **argv)
+{
+    const char *device = "hw:Dummy";
+    const char *pcm = "hw:Dummy,0";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "D:P:")) != -1) {
+        switch (opt) {
+            case 'D': device = optarg; break;
+            case 'P': pcm = optarg; break;
+            default:
+                PRINT("usage: %s [-D device] [-P pcm]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (!listControls(device)) {
+        PRINT("not enough controls to run against on %s\n", device);
+        return 1;
+    }
+    makePaths();
+
+    snd_ctl_t *card;
+    CHECK(snd_ctl_open(&card, device, 0) == 0);
+
+    FakeModem modem;
+    VoiceCallControl *control = new VoiceCallControl(&modem, device, pcm, paths,
+                                                     sizeof(paths) / sizeof(paths[0]));
+    CHECK(control->initCheck() == NO_ERROR);
+    VoiceCallConfig config = { false, AudioModemInterface::PCM_8_KHZ };
+    control->setConfig(HANDSET, config);
+    control->setConfig(HANDFREE, config);
+    config.multiMic = true;
+    config.sampleRate = AudioModemInterface::INVALID_SAMPLE_RATE;
+    control->setConfig(HEADSET, config);
+    control->run("VoiceCallControl", PRIORITY_AUDIO);
+
+    // out of a call nothing is touched
+    control->request(AudioSystem::DEVICE_OUT_SPEAKER, AudioSystem::MODE_NORMAL, false);
+    control->flush();
+    CHECK(modem.routes == 0 && modem.opens == 0);
+    CHECK(control->stats().pcmOpens == 0 && control->stats().controlWrites == 0);
+
+    // into a call
+    control->request(AudioSystem::DEVICE_OUT_EARPIECE, AudioSystem::MODE_IN_CALL, false);
+    control->flush();
+    CHECK(modem.opens == 1 && modem.routes == 1 && modem.multiMics == 1);
+    CHECK(modem.modes == HANDSET && modem.rate == AudioModemInterface::PCM_8_KHZ);
+    CHECK(modem.multiMic == AudioModemInterface::MODEM_SINGLE_MIC);
+    CHECK(control->stats().pcmOpens == 1);
+    CHECK(readBack(card, names[0]) == (long)mins[0] + 1);
+    CHECK(readBack(card, names[1]) == (long)maxs[1]);
+    CHECK(readBack(card, names[2]) == (long)mins[2]);
+    CHECK(readBack(card, names[3]) == (long)maxs[3]);
+
+    // a burst of routing changes is one update to the last of them
+    VoiceCallControl::Stats before = control->stats();
+    unsigned int routes = modem.routes;
+    static const uint32_t devices[] = {
+        AudioSystem::DEVICE_OUT_SPEAKER,
+        AudioSystem::DEVICE_OUT_WIRED_HEADSET,
+        AudioSystem::DEVICE_OUT_EARPIECE,
+    };
+    for (int i = 0; i < BURST; i++)
+        control->request(devices[i % 3], AudioSystem::MODE_IN_CALL, false);
+    control->request(AudioSystem::DEVICE_OUT_SPEAKER, AudioSystem::MODE_IN_CALL, false);
+    control->flush();
+    VoiceCallControl::Stats after = control->stats();
+    PRINT("%d requests: %u updates, %u modem calls, %u PCM opens, %u controls written\n",
+          BURST + 1, after.updates - before.updates, modem.routes - routes,
+          after.pcmOpens - before.pcmOpens, after.controlWrites - before.controlWrites);
+    CHECK(after.updates - before.updates <= 2);
+    CHECK(modem.modes == HANDFREE && modem.routes - routes <= 2);
+    // the mode changed, not the rate: the PCM and the stream stay open
+    CHECK(after.pcmOpens == before.pcmOpens && modem.opens == 1 && modem.closes == 0);
+    CHECK(readBack(card, names[0]) == (long)maxs[0]);
+    CHECK(readBack(card, names[1]) == (long)mins[1]);
+    CHECK(readBack(card, names[2]) == (long)maxs[2]);
+
+    // the same request again is no update
+    before = control->stats();
+    control->request(AudioSystem::DEVICE_OUT_SPEAKER, AudioSystem::MODE_IN_CALL, false);
+    control->flush();
+    CHECK(control->stats().updates == before.updates);
+
+    // requests that never settle are still applied within the latency bound
+    before = control->stats();
+    for (int i = 0; i < 60; i++) {
+        control->request(devices[i % 2], AudioSystem::MODE_IN_CALL, false);
+        usleep(5000);
+    }
+    control->flush();
+    after = control->stats();
+    PRINT("300 ms of requests every 5 ms: %u updates, worst latency %.1f ms\n",
+          after.updates - before.updates, after.maxLatency / 1e6);
+    CHECK(after.updates - before.updates >= 3);
+    CHECK(after.maxLatency < milliseconds(VoiceCallControl::MAX_LATENCY + 40));
+
+    // a multimedia route over the call: its controls are written back and
+    // the shared downlinks stay on
+    control->request(AudioSystem::DEVICE_OUT_SPEAKER, AudioSystem::MODE_IN_CALL, false);
+    control->flush();
+    writeOutside(card, names[3], mins[3]);
+    before = control->stats();
+    control->lock();
+    control->request(AudioSystem::DEVICE_OUT_SPEAKER, AudioSystem::MODE_IN_CALL, true);
+    usleep(milliseconds(VoiceCallControl::MAX_LATENCY) / 1000 * 2);
+    // held off the codec while the HAL routes
+    CHECK(control->stats().updates == before.updates);
+    control->unlock();
+    control->flush();
+    CHECK(readBack(card, names[3]) == (long)maxs[3]);
+    CHECK(readBack(card, names[1]) == (long)maxs[1]);
+    CHECK(readBack(card, names[2]) == (long)maxs[2]);
+
+    // the rate the modem reports is asked for once a call, a mode at
+    // another rate opens the PCM again, as does the number of microphones
+    before = control->stats();
+    routes = modem.routes;
+    control->request(AudioSystem::DEVICE_OUT_WIRED_HEADSET, AudioSystem::MODE_IN_CALL, false);
+    control->flush();
+    CHECK(modem.rateQueries == 0);
+    CHECK(modem.rate == AudioModemInterface::PCM_8_KHZ);
+    CHECK(control->stats().pcmOpens == before.pcmOpens);
+    CHECK(modem.multiMic == AudioModemInterface::MODEM_DOUBLE_MIC);
+    CHECK(readBack(card, names[0]) == (long)mins[0] + 2);
+    // multimedia ended with the mode
+    CHECK(readBack(card, names[2]) == (long)mins[2]);
+
+    config.multiMic = false;
+    config.sampleRate = AudioModemInterface::PCM_16_KHZ;
+    control->setConfig(HANDSET, config);
+    control->request(AudioSystem::DEVICE_OUT_EARPIECE, AudioSystem::MODE_IN_CALL, false);
+    control->flush();
+    CHECK(modem.rate == AudioModemInterface::PCM_16_KHZ);
+    CHECK(control->stats().pcmOpens == before.pcmOpens + 1);
+    CHECK(modem.multiMic == AudioModemInterface::MODEM_SINGLE_MIC);
+
+    // out of the call
+    control->request(AudioSystem::DEVICE_OUT_EARPIECE, AudioSystem::MODE_NORMAL, false);
+    control->flush();
+    CHECK(modem.closes == 1 && !modem.open);
+    CHECK(readBack(card, names[0]) == (long)mins[0]);
+    CHECK(readBack(card, names[1]) == (long)mins[1]);
+    CHECK(readBack(card, names[3]) == (long)mins[3]);
+
+    // a call on a mode at the modem's rate asks for it
+    control->request(AudioSystem::DEVICE_OUT_WIRED_HEADSET, AudioSystem::MODE_IN_CALL, false);
+    control->flush();
+    CHECK(modem.rateQueries == 1 && modem.rate == AudioModemInterface::PCM_16_KHZ);
+    CHECK(modem.opens == 2);
+    control->request(AudioSystem::DEVICE_OUT_WIRED_HEADSET, AudioSystem::MODE_NORMAL, false);
+    control->flush();
+    CHECK(modem.closes == 2);
+
+    after = control->stats();
+    PRINT("%u requests: %u updates, %u modem calls, %u PCM opens, %u controls written\n",
+          after.requests, after.updates, after.modemCalls, after.pcmOpens, after.controlWrites);
+
+    delete control;
+    snd_ctl_close(card);
+
+    PRINT("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -4,10 +4,12 @@ include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES:=               \
     main.cpp \
+    measure.cpp \
 
 LOCAL_SHARED_LIBRARIES:= \
 	libaudio \
-	libhardware_legacy
+	libhardware_legacy \
+	libutils
 
 LOCAL_C_INCLUDES += \
 	hardware/alsa_sound \
@@ -19,3 +21,21 @@ LOCAL_MODULE:= audiotest
 LOCAL_MODULE_TAGS:= optional
 
 include $(BUILD_EXECUTABLE)
+
+################################################
+# The measurement of audiotest -t measure on a Linux host, through the
+# ALSA loopback driver
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=               \
+    measure.cpp \
+    measure_host.cpp \
+
+LOCAL_STATIC_LIBRARIES := libutils libcutils
+LOCAL_LDLIBS += -lasound -lpthread -lrt -lm
+
+LOCAL_MODULE:= audiotest_measure
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_HOST_EXECUTABLE)
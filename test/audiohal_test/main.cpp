@@ -8,6 +8,7 @@
 #include <fcntl.h>
 #include <getopt.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <string.h>
@@ -17,6 +18,7 @@
 #include <hardware_legacy/AudioHardwareInterface.h>
 
 #include "AudioHardwareALSA.h"
+#include "measure.h"
 
 
 #define BUFFER_LENGTH    4096
@@ -75,6 +77,7 @@ enum test_type_t {
     TEST_REC,
     TEST_LOOPBACK,
     TEST_DUPLEX,
+    TEST_MEASURE,
     TEST_UNDEFINED
 };
 
@@ -106,6 +109,8 @@ pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 char playback_file[100] = {0};
 char rec_file[100] = {0};
 int timelimit = 0;
+int signal_type = SIGNAL_IMPULSE;
+uint32_t pulse_interval = 500;
 
 void audioHal_Initialize()
 {
@@ -601,6 +606,97 @@ int loopback(int duration)
     return 0;
 }
 
+// The HAL streams as the ends of a measurement. An output can't tell
+// its underruns: a write returning later than the stream latency after
+// the previous one is counted as one.
+class HalPort : public MeasurePort
+{
+public:
+    HalPort(AudioStreamOut *out, AudioStreamIn *in) :
+        mOut(out), mIn(in), mLastWrite(0), mUnderruns(0), mOverruns(0)
+    {
+        mLatency = (nsecs_t)out->latency() * 1000000LL;
+    }
+
+    virtual ssize_t write(const void *buffer, size_t bytes)
+    {
+        ssize_t written = mOut->write(buffer, bytes);
+        nsecs_t now = systemTime();
+        if (mLastWrite && now - mLastWrite > mLatency)
+            mUnderruns++;
+        mLastWrite = now;
+        return written;
+    }
+
+    virtual ssize_t read(void *buffer, size_t bytes)
+    {
+        ssize_t got = mIn->read(buffer, bytes);
+        if (mIn->getInputFramesLost())
+            mOverruns++;
+        return got;
+    }
+
+    virtual unsigned int underruns() { return mUnderruns; }
+    virtual unsigned int overruns() { return mOverruns; }
+
+private:
+    AudioStreamOut *mOut;
+    AudioStreamIn *mIn;
+    nsecs_t mLatency;
+    nsecs_t mLastWrite;
+    unsigned int mUnderruns;
+    unsigned int mOverruns;
+};
+
+// Measurement Test: round trip latency, xruns and call times of the
+// output looped back to the input
+int measure_loop()
+{
+    MeasureParams params;
+    int ret;
+
+    printf("Running Measurement Test!\n");
+
+    pthread_mutex_lock (&mutex);
+    if (audioStreamOutOpen() < 0) {
+        pthread_mutex_unlock (&mutex);
+        return -1;
+    }
+    if (audioStreamInOpen() < 0) {
+        g_AudioHalParams.hardware->closeOutputStream(g_AudioHalParams.streamOutParams.streamOut);
+        pthread_mutex_unlock (&mutex);
+        return -1;
+    }
+    g_AudioHalParams.hardware->setMasterVolume(m_volume);
+    pthread_mutex_unlock (&mutex);
+
+    AudioStreamOut *out = g_AudioHalParams.streamOutParams.streamOut;
+    AudioStreamIn *in = g_AudioHalParams.streamInParams.streamIn;
+
+    params.rate = out->sampleRate();
+    params.outChannels = popCount(out->channels());
+    params.inChannels = popCount(in->channels());
+    params.frames = out->bufferSize() / out->frameSize();
+    params.duration = timelimit ? timelimit : 10;
+    params.interval = pulse_interval;
+    params.signal = signal_type;
+
+    if (in->sampleRate() != params.rate) {
+        fprintf(stderr, "Measure: input at %d Hz, output at %d Hz\n",
+                in->sampleRate(), params.rate);
+        ret = -1;
+    } else {
+        HalPort port(out, in);
+        ret = measure(&port, params);
+    }
+
+    pthread_mutex_lock (&mutex);
+    g_AudioHalParams.hardware->closeInputStream(in);
+    g_AudioHalParams.hardware->closeOutputStream(out);
+    pthread_mutex_unlock (&mutex);
+    return ret;
+}
+
 static void usage()
 {
     printf(
@@ -610,14 +706,17 @@ static void usage()
 "Record Wav :    audiotest -t rec [OPTION] <filename>\n"
 "Loopback:    audiotest -t loopback [OPTION]\n"
 "duplex  :    audiotest -t duplex [OPTION] <playback file> <recorded file to save> \n"
+"Measure :    audiotest -t measure [OPTION]\n"
 "[OPTION]  \n"
 "-h, --help              help\n"
-"-t, --test              play/rec/loopback/duplex\n"
+"-t, --test              play/rec/loopback/duplex/measure\n"
 "-D, --deviceE           select device (speaker - 0/headset - 1) -only playback case\n"
 "-c, --channels=#        channels (1/2)- rec case\n"
 "-f, --format=FORMAT     sample (8/16)-rec case\n"
-"-r, --rate=#            sample rate(8000/16000) - rec case\n"
-"-d, --duration=#        seconds - loopback case\n"
+"-r, --rate=#            sample rate(8000/16000) - rec case, of both sides - measure case\n"
+"-d, --duration=#        seconds - loopback and measure cases\n"
+"-s, --signal=NAME       impulse/chirp - measure case\n"
+"-i, --interval=#        ms between pulses - measure case\n"
 "-v, --volume=#          0-10 mute=0 - all cases\n")
     );
 }
@@ -640,7 +739,7 @@ int main(int argc, char *argv[    ])
     printf("********** AUDIO HAL TEST FRAMEWORK **********\n");
     printf("**********************************************\n\n");
     int option_index;
-    static const char short_options[] = "t:D:c:f:r:d:v:h";
+    static const char short_options[] = "t:D:c:f:r:d:v:s:i:h";
     static const struct option long_options[] = {
         {"help", 0, 0, 'h'},
         {"test", 1, 0, 't'},
@@ -650,6 +749,8 @@ int main(int argc, char *argv[    ])
         {"rate", 1, 0, 'r'},
         {"duration", 1, 0 ,'d'},
         {"volume", 1, 0 ,'v'},
+        {"signal", 1, 0 ,'s'},
+        {"interval", 1, 0 ,'i'},
         {0, 0, 0, 0}
     };
 
@@ -671,6 +772,8 @@ int main(int argc, char *argv[    ])
                     test_type = TEST_LOOPBACK;
                 else if (strcasecmp(optarg, "duplex") == 0)
                     test_type = TEST_DUPLEX;
+                else if (strcasecmp(optarg, "measure") == 0)
+                    test_type = TEST_MEASURE;
                 else
                     test_type = TEST_UNDEFINED;
                 break;
@@ -721,6 +824,8 @@ int main(int argc, char *argv[    ])
                         printf("doesn't support rate-using default rate %d\n",m_rate);
                     } else
                         m_rate = tmp;
+                } else if (test_type == TEST_MEASURE) {
+                    m_rate = strtol(optarg, NULL, 0);
                 } else
                     printf("currently not supported \n");
                 break;
@@ -734,6 +839,17 @@ int main(int argc, char *argv[    ])
             case 'f':
                 printf("currently not supported \n");
                 break;
+            case 's':
+                if (strcasecmp(optarg, "chirp") == 0)
+                    signal_type = SIGNAL_CHIRP;
+                else
+                    signal_type = SIGNAL_IMPULSE;
+                break;
+            case 'i':
+                tmp = strtol(optarg, NULL, 0);
+                if (tmp > 0)
+                    pulse_interval = tmp;
+                break;
             case ':':
             case '?':
                 printf("missing param/unknown option\n");
@@ -780,6 +896,16 @@ int main(int argc, char *argv[    ])
             printf("duplex started\n");
             duplex();
             break;
+
+        case TEST_MEASURE:
+            if(m_device)
+                g_AudioHalParams.streamOutParams.device = m_device;
+            // both sides at the same rate, the input on one channel
+            g_AudioHalParams.streamOutParams.rate = m_rate ? m_rate : 48000;
+            g_AudioHalParams.streamInParams.rate = g_AudioHalParams.streamOutParams.rate;
+            g_AudioHalParams.streamInParams.channels = AudioSystem::CHANNEL_IN_LEFT;
+            measure_loop();
+            break;
         default:
             printf("Play: start playback out.wav\n");
             wav_play();
@@ -0,0 +1,424 @@
+/* measure.cpp
+ **
+ ** Copyright 2010-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <utils/Timers.h>
+
+#include "measure.h"
+
+#ifndef M_PI
+#define M_PI                3.14159265358979323846
+#endif
+
+#define IMPULSE_LEVEL       30000
+#define IMPULSE_THRESHOLD   16384
+#define CHIRP_LEVEL         16384.0f
+#define CHIRP_THRESHOLD     0.6         // normalized correlation
+#define CHIRP_GATE          1e5         // mean square below which nothing is correlated
+
+// Call times of one side of the loop
+struct CallStats {
+    nsecs_t     *duration;      // of each call
+    nsecs_t     *gap;           // from the return of the previous one
+    size_t      count;
+    size_t      size;
+    nsecs_t     last;
+
+    void init(size_t n)
+    {
+        duration = new nsecs_t[n];
+        gap = new nsecs_t[n];
+        count = 0;
+        size = n;
+        last = 0;
+    }
+
+    void add(nsecs_t start, nsecs_t end)
+    {
+        if (count == size)
+            return;
+        duration[count] = end - start;
+        gap[count] = last ? end - last : 0;
+        last = end;
+        count++;
+    }
+
+    void release()
+    {
+        delete [] duration;
+        delete [] gap;
+    }
+};
+
+struct Measure {
+    const MeasureParams *params;
+    MeasurePort         *port;
+
+    // pulses, the send times under lock
+    pthread_mutex_t     lock;
+    nsecs_t             *sent;
+    size_t              sentCount;
+    size_t              maxPulses;
+    bool                writing;
+    nsecs_t             writeEnd;
+
+    int16_t             *chirp;
+    size_t              chirpLength;
+
+    CallStats           writes;
+    CallStats           reads;
+    size_t              writeErrors;
+    size_t              readErrors;
+};
+
+static int compare(const void *a, const void *b)
+{
+    nsecs_t x = *(const nsecs_t *)a;
+    nsecs_t y = *(const nsecs_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static nsecs_t percentile(nsecs_t *values, size_t count, double p)
+{
+    size_t i = (size_t)(p / 100.0 * (count - 1) + 0.5);
+    return values[i];
+}
+
+// Sorts the values in place
+static void report(const char *what, nsecs_t *values, size_t count)
+{
+    if (count == 0) {
+        printf("%-18s no samples\n", what);
+        return;
+    }
+    qsort(values, count, sizeof(values[0]), compare);
+    printf("%-18s p50 %8.3f  p90 %8.3f  p99 %8.3f  p99.9 %8.3f  max %8.3f ms\n",
+           what,
+           percentile(values, count, 50) / 1e6,
+           percentile(values, count, 90) / 1e6,
+           percentile(values, count, 99) / 1e6,
+           percentile(values, count, 99.9) / 1e6,
+           values[count - 1] / 1e6);
+}
+
+// How far each call returned from where the period says it should
+static void reportJitter(const char *what, CallStats &stats, nsecs_t period)
+{
+    size_t n = 0;
+
+    for (size_t i = 1; i < stats.count; i++) {
+        nsecs_t d = stats.gap[i] - period;
+        stats.gap[n++] = d < 0 ? -d : d;
+    }
+    report(what, stats.gap, n);
+}
+
+static void makeChirp(Measure &m)
+{
+    const MeasureParams &p = *m.params;
+    double f0 = 500.0;
+    double f1 = p.rate * 0.4 < 8000.0 ? p.rate * 0.4 : 8000.0;
+
+    // 10 ms linear sweep under a Hann window
+    m.chirpLength = p.rate / 100;
+    m.chirp = new int16_t[m.chirpLength];
+    for (size_t i = 0; i < m.chirpLength; i++) {
+        double t = (double)i / p.rate;
+        double T = (double)m.chirpLength / p.rate;
+        double phase = 2 * M_PI * (f0 * t + (f1 - f0) * t * t / (2 * T));
+        double window = 0.5 - 0.5 * cos(2 * M_PI * i / (m.chirpLength - 1));
+        m.chirp[i] = (int16_t)(CHIRP_LEVEL * window * sin(phase));
+    }
+}
+
+static void *writer(void *arg)
+{
+    Measure &m = *(Measure *)arg;
+    const MeasureParams &p = *m.params;
+    size_t bytes = p.frames * p.outChannels * sizeof(int16_t);
+    int16_t *buffer = new int16_t[p.frames * p.outChannels];
+    // pulses start on a buffer
+    size_t every = ((size_t)p.rate * p.interval / 1000 + p.frames - 1) / p.frames;
+    size_t calls = (size_t)p.rate * p.duration / p.frames;
+    size_t pulseLength = p.signal == SIGNAL_CHIRP ? m.chirpLength : 1;
+    size_t pulsePos = pulseLength;
+
+    for (size_t call = 0; call < calls; call++) {
+        memset(buffer, 0, bytes);
+
+        // the first interval lets both sides settle
+        bool pulse = call >= every && call % every == 0 && m.sentCount < m.maxPulses;
+        if (pulse)
+            pulsePos = 0;
+        for (size_t f = 0; f < p.frames && pulsePos < pulseLength; f++, pulsePos++) {
+            int16_t s = p.signal == SIGNAL_CHIRP ? m.chirp[pulsePos] : IMPULSE_LEVEL;
+            for (size_t c = 0; c < p.outChannels; c++)
+                buffer[f * p.outChannels + c] = s;
+        }
+
+        nsecs_t start = systemTime();
+        if (pulse) {
+            pthread_mutex_lock(&m.lock);
+            m.sent[m.sentCount++] = start;
+            pthread_mutex_unlock(&m.lock);
+        }
+        ssize_t written = m.port->write(buffer, bytes);
+        m.writes.add(start, systemTime());
+        if (written != (ssize_t)bytes)
+            m.writeErrors++;
+    }
+
+    pthread_mutex_lock(&m.lock);
+    m.writing = false;
+    m.writeEnd = systemTime();
+    pthread_mutex_unlock(&m.lock);
+
+    delete [] buffer;
+    return NULL;
+}
+
+// Finds the pulses in the input, one sample at a time
+struct Detector {
+    const Measure   *m;
+    int             signal;
+    size_t          refractory;     // samples to skip after a pulse
+    size_t          quiet;
+    // chirp correlation
+    float           *history;
+    size_t          length;
+    size_t          pos;
+    size_t          filled;
+    double          energy;         // of the history
+    double          chirpEnergy;
+    double          peak;           // best correlation of the pulse being found
+    size_t          peakAge;        // samples since it
+
+    void init(const Measure &measure)
+    {
+        const MeasureParams &p = *measure.params;
+        m = &measure;
+        signal = p.signal;
+        refractory = (size_t)p.rate * p.interval / 2000;
+        quiet = 0;
+        length = measure.chirpLength;
+        history = new float[length];
+        memset(history, 0, length * sizeof(float));
+        pos = filled = 0;
+        energy = 0;
+        chirpEnergy = 0;
+        for (size_t i = 0; i < length; i++)
+            chirpEnergy += (double)m->chirp[i] * m->chirp[i];
+        peak = 0;
+        peakAge = 0;
+    }
+
+    // The sample delay from the start of the pulse to this one when it
+    // ends a pulse, -1 if none
+    long add(int16_t sample)
+    {
+        if (quiet) {
+            quiet--;
+            return -1;
+        }
+
+        if (signal == SIGNAL_IMPULSE) {
+            if (sample > IMPULSE_THRESHOLD || sample < -IMPULSE_THRESHOLD) {
+                quiet = refractory;
+                return 0;
+            }
+            return -1;
+        }
+
+        float x = sample;
+        energy += (double)x * x - (double)history[pos] * history[pos];
+        history[pos] = x;
+        pos = (pos + 1) % length;
+        if (filled < length) {
+            filled++;
+            return -1;
+        }
+
+        // the best match is the pulse, once no better one follows in a
+        // pulse length
+        if (peak > 0 && ++peakAge >= length) {
+            long delay = (long)(peakAge + length - 1);
+            peak = 0;
+            quiet = refractory;
+            // correlates nothing of this pulse once quiet again
+            memset(history, 0, length * sizeof(float));
+            energy = 0;
+            filled = 0;
+            return delay;
+        }
+
+        if (energy < CHIRP_GATE * length)
+            return -1;
+
+        double c = 0;
+        for (size_t i = 0; i < length; i++)
+            c += history[(pos + i) % length] * m->chirp[i];
+        c /= sqrt(energy * chirpEnergy);
+        if (c > CHIRP_THRESHOLD && c > peak) {
+            peak = c;
+            peakAge = 0;
+        }
+        return -1;
+    }
+
+    void release()
+    {
+        delete [] history;
+    }
+};
+
+static void release(Measure &m, Detector &detector, nsecs_t *latency, int16_t *buffer)
+{
+    detector.release();
+    m.writes.release();
+    m.reads.release();
+    delete [] m.chirp;
+    delete [] m.sent;
+    delete [] latency;
+    delete [] buffer;
+    pthread_mutex_destroy(&m.lock);
+}
+
+int measure(MeasurePort *port, const MeasureParams &params)
+{
+    const MeasureParams &p = params;
+    Measure m;
+    Detector detector;
+    struct rusage usageStart, usageEnd;
+    size_t bytes = p.frames * p.inChannels * sizeof(int16_t);
+    int16_t *buffer = new int16_t[p.frames * p.inChannels];
+    size_t calls = (size_t)p.rate * (p.duration + 2 + 2 * p.interval / 1000) / p.frames + 16;
+    nsecs_t period = (nsecs_t)p.frames * 1000000000LL / p.rate;
+    nsecs_t interval = (nsecs_t)p.interval * 1000000LL;
+    nsecs_t *latency;
+    size_t latencies = 0, next = 0, lost = 0, spurious = 0;
+    pthread_t thread;
+
+    printf("Measure: %u Hz, %u frames per call, %s every %u ms for %u s\n",
+           p.rate, p.frames, p.signal == SIGNAL_CHIRP ? "chirp" : "impulse",
+           p.interval, p.duration);
+
+    m.params = &p;
+    m.port = port;
+    pthread_mutex_init(&m.lock, NULL);
+    m.maxPulses = (size_t)p.duration * 1000 / p.interval + 1;
+    m.sent = new nsecs_t[m.maxPulses];
+    m.sentCount = 0;
+    m.writing = true;
+    m.writeEnd = 0;
+    m.writeErrors = m.readErrors = 0;
+    m.writes.init(calls);
+    m.reads.init(calls);
+    makeChirp(m);
+    detector.init(m);
+    latency = new nsecs_t[m.maxPulses];
+
+    getrusage(RUSAGE_SELF, &usageStart);
+    nsecs_t begin = systemTime();
+
+    if (pthread_create(&thread, NULL, writer, &m)) {
+        fprintf(stderr, "Measure: cannot start the writer\n");
+        release(m, detector, latency, buffer);
+        return -1;
+    }
+
+    // reads until the last pulse had an interval to come back
+    for (;;) {
+        pthread_mutex_lock(&m.lock);
+        bool over = !m.writing && systemTime() > m.writeEnd + interval;
+        pthread_mutex_unlock(&m.lock);
+        if (over)
+            break;
+
+        nsecs_t start = systemTime();
+        ssize_t got = port->read(buffer, bytes);
+        nsecs_t end = systemTime();
+        m.reads.add(start, end);
+        if (got <= 0) {
+            m.readErrors++;
+            usleep(period / 1000);
+            continue;
+        }
+
+        size_t frames = got / (p.inChannels * sizeof(int16_t));
+        for (size_t f = 0; f < frames; f++) {
+            long delay = detector.add(buffer[f * p.inChannels]);
+            if (delay < 0)
+                continue;
+
+            // when the first sample of the pulse came in
+            nsecs_t arrived = end - (nsecs_t)(frames - 1 - f + delay) * 1000000000LL / p.rate;
+
+            pthread_mutex_lock(&m.lock);
+            while (next < m.sentCount && arrived - m.sent[next] > interval) {
+                lost++;
+                next++;
+            }
+            if (next < m.sentCount && arrived >= m.sent[next])
+                latency[latencies++] = arrived - m.sent[next++];
+            else
+                spurious++;
+            pthread_mutex_unlock(&m.lock);
+        }
+    }
+
+    pthread_join(thread, NULL);
+    nsecs_t wall = systemTime() - begin;
+    getrusage(RUSAGE_SELF, &usageEnd);
+    lost += m.sentCount - next;
+
+    double cpu = (usageEnd.ru_utime.tv_sec - usageStart.ru_utime.tv_sec) * 1e9 +
+                 (usageEnd.ru_utime.tv_usec - usageStart.ru_utime.tv_usec) * 1e3 +
+                 (usageEnd.ru_stime.tv_sec - usageStart.ru_stime.tv_sec) * 1e9 +
+                 (usageEnd.ru_stime.tv_usec - usageStart.ru_stime.tv_usec) * 1e3;
+
+    printf("\nPulses: %u sent, %u back, %u lost, %u unexpected\n",
+           (unsigned)m.sentCount, (unsigned)latencies, (unsigned)lost, (unsigned)spurious);
+    if (latencies) {
+        nsecs_t sum = 0;
+        for (size_t i = 0; i < latencies; i++)
+            sum += latency[i];
+        printf("Round trip latency: mean %.3f ms\n", sum / 1e6 / latencies);
+    }
+    report("  latency", latency, latencies);
+    printf("Xruns: %u underruns, %u overruns, %u short writes, %u failed reads\n",
+           port->underruns(), port->overruns(),
+           (unsigned)m.writeErrors, (unsigned)m.readErrors);
+    printf("Calls: %u writes, %u reads, period %.3f ms\n",
+           (unsigned)m.writes.count, (unsigned)m.reads.count, period / 1e6);
+    report("  write", m.writes.duration, m.writes.count);
+    report("  read", m.reads.duration, m.reads.count);
+    reportJitter("  write jitter", m.writes, period);
+    reportJitter("  read jitter", m.reads, period);
+    printf("CPU: %.2f%% of one core over %.1f s\n", cpu * 100.0 / wall, wall / 1e9);
+
+    release(m, detector, latency, buffer);
+
+    return lost || !latencies ? 1 : 0;
+}
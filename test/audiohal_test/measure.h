@@ -0,0 +1,64 @@
+/* measure.h
+ **
+ ** Copyright 2010-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#ifndef AUDIO_TEST_MEASURE_H
+#define AUDIO_TEST_MEASURE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// Full duplex measurement: pulses are written to the output at a known
+// time and looked for in the input, the output looped back to it by a
+// cable, the acoustic path or the snd-aloop driver. Reported are the
+// round trip latency of each pulse, the pulses lost, the xruns, the time
+// taken by each read and write call and the CPU used.
+
+// The two ends the pulses go through: the HAL streams on the target,
+// ALSA PCMs on the host. Both are 16 bit interleaved.
+class MeasurePort
+{
+public:
+    virtual ~MeasurePort() {}
+
+    virtual ssize_t write(const void *buffer, size_t bytes) = 0;
+    virtual ssize_t read(void *buffer, size_t bytes) = 0;
+
+    // Counted since the ports were opened, as far as they can tell
+    virtual unsigned int underruns() = 0;
+    virtual unsigned int overruns() = 0;
+};
+
+enum measure_signal_t {
+    SIGNAL_IMPULSE = 0,     // one full scale sample, for electrical loops
+    SIGNAL_CHIRP,           // a windowed sweep found by correlation,
+                            // survives acoustic paths and gain changes
+};
+
+struct MeasureParams {
+    uint32_t    rate;
+    uint32_t    outChannels;
+    uint32_t    inChannels;
+    uint32_t    frames;         // per read and write call
+    uint32_t    duration;       // s
+    uint32_t    interval;       // ms between pulses, longer than the latency
+    int         signal;         // measure_signal_t
+};
+
+// Runs the measurement and prints its report, 0 when every pulse came back
+int measure(MeasurePort *port, const MeasureParams &params);
+
+#endif // AUDIO_TEST_MEASURE_H
@@ -0,0 +1,222 @@
+/* measure_host.cpp
+ **
+ ** Copyright 2010-2011, Texas Instruments
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/*
+ * The measurement of audiotest on a Linux host, through ALSA PCMs. With
+ * the loopback driver what is played on one substream is captured on
+ * the other:
+ *
+ *   modprobe snd-aloop
+ *   audiotest_measure -P hw:Loopback,0,0 -C hw:Loopback,1,0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <alsa/asoundlib.h>
+
+#include "measure.h"
+
+class AlsaPort : public MeasurePort
+{
+public:
+    AlsaPort() : mPlayback(NULL), mCapture(NULL), mUnderruns(0), mOverruns(0),
+                 mOutChannels(0), mInChannels(0) {}
+
+    virtual ~AlsaPort()
+    {
+        if (mPlayback)
+            snd_pcm_close(mPlayback);
+        if (mCapture)
+            snd_pcm_close(mCapture);
+    }
+
+    int open(const char *playback, const char *capture, const MeasureParams &p,
+             unsigned int latency)
+    {
+        int err;
+
+        mOutChannels = p.outChannels;
+        mInChannels = p.inChannels;
+
+        if ((err = snd_pcm_open(&mPlayback, playback, SND_PCM_STREAM_PLAYBACK, 0)) < 0 ||
+            (err = snd_pcm_set_params(mPlayback, SND_PCM_FORMAT_S16_LE,
+                                      SND_PCM_ACCESS_RW_INTERLEAVED,
+                                      p.outChannels, p.rate, 0, latency)) < 0) {
+            fprintf(stderr, "Measure: playback %s: %s\n", playback, snd_strerror(err));
+            return err;
+        }
+        if ((err = snd_pcm_open(&mCapture, capture, SND_PCM_STREAM_CAPTURE, 0)) < 0 ||
+            (err = snd_pcm_set_params(mCapture, SND_PCM_FORMAT_S16_LE,
+                                      SND_PCM_ACCESS_RW_INTERLEAVED,
+                                      p.inChannels, p.rate, 0, latency)) < 0) {
+            fprintf(stderr, "Measure: capture %s: %s\n", capture, snd_strerror(err));
+            return err;
+        }
+
+        snd_pcm_uframes_t buffer, period;
+        snd_pcm_get_params(mPlayback, &buffer, &period);
+        printf("Measure: %s to %s, buffer %lu period %lu frames\n",
+               playback, capture, (unsigned long)buffer, (unsigned long)period);
+        return 0;
+    }
+
+    virtual ssize_t write(const void *buffer, size_t bytes)
+    {
+        snd_pcm_uframes_t frames = bytes / (mOutChannels * sizeof(int16_t));
+        const char *data = (const char *)buffer;
+        snd_pcm_uframes_t done = 0;
+
+        while (done < frames) {
+            snd_pcm_sframes_t n = snd_pcm_writei(mPlayback,
+                    data + done * mOutChannels * sizeof(int16_t), frames - done);
+            if (n == -EPIPE)
+                mUnderruns++;
+            if (n < 0) {
+                if (snd_pcm_recover(mPlayback, n, 1) < 0)
+                    return n;
+                continue;
+            }
+            done += n;
+        }
+        return bytes;
+    }
+
+    virtual ssize_t read(void *buffer, size_t bytes)
+    {
+        snd_pcm_uframes_t frames = bytes / (mInChannels * sizeof(int16_t));
+        char *data = (char *)buffer;
+        snd_pcm_uframes_t done = 0;
+
+        // the capture starts with the first read, not a buffer later
+        if (snd_pcm_state(mCapture) == SND_PCM_STATE_PREPARED)
+            snd_pcm_start(mCapture);
+
+        while (done < frames) {
+            snd_pcm_sframes_t n = snd_pcm_readi(mCapture,
+                    data + done * mInChannels * sizeof(int16_t), frames - done);
+            if (n == -EPIPE)
+                mOverruns++;
+            if (n < 0) {
+                if (snd_pcm_recover(mCapture, n, 1) < 0)
+                    return n;
+                snd_pcm_start(mCapture);
+                continue;
+            }
+            done += n;
+        }
+        return bytes;
+    }
+
+    virtual unsigned int underruns() { return mUnderruns; }
+    virtual unsigned int overruns() { return mOverruns; }
+
+private:
+    snd_pcm_t *     mPlayback;
+    snd_pcm_t *     mCapture;
+    unsigned int    mUnderruns;
+    unsigned int    mOverruns;
+    unsigned int    mOutChannels;
+    unsigned int    mInChannels;
+};
+
+static void usage()
+{
+    printf(
+"Usage: audiotest_measure [OPTION]...\n"
+"-P, --playback=PCM      default hw:Loopback,0,0\n"
+"-C, --capture=PCM       default hw:Loopback,1,0\n"
+"-r, --rate=#            sample rate, default 48000\n"
+"-c, --channels=#        channels of both sides, default 2\n"
+"-p, --frames=#          frames per read and write, default 480\n"
+"-l, --latency=#         us of buffer each side, default 4 calls\n"
+"-d, --duration=#        seconds, default 10\n"
+"-i, --interval=#        ms between pulses, default 500\n"
+"-s, --signal=NAME       impulse or chirp, default impulse\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *playback = "hw:Loopback,0,0";
+    const char *capture = "hw:Loopback,1,0";
+    unsigned int latency = 0;
+    MeasureParams params;
+    int ch;
+
+    static const char short_options[] = "P:C:r:c:p:l:d:i:s:h";
+    static const struct option long_options[] = {
+        {"help", 0, 0, 'h'},
+        {"playback", 1, 0, 'P'},
+        {"capture", 1, 0, 'C'},
+        {"rate", 1, 0, 'r'},
+        {"channels", 1, 0, 'c'},
+        {"frames", 1, 0, 'p'},
+        {"latency", 1, 0, 'l'},
+        {"duration", 1, 0, 'd'},
+        {"interval", 1, 0, 'i'},
+        {"signal", 1, 0, 's'},
+        {0, 0, 0, 0}
+    };
+
+    params.rate = 48000;
+    params.outChannels = params.inChannels = 2;
+    params.frames = 480;
+    params.duration = 10;
+    params.interval = 500;
+    params.signal = SIGNAL_IMPULSE;
+
+    while ((ch = getopt_long(argc, argv, short_options, long_options, NULL)) != -1) {
+        switch (ch) {
+        case 'P': playback = optarg; break;
+        case 'C': capture = optarg; break;
+        case 'r': params.rate = strtol(optarg, NULL, 0); break;
+        case 'c': params.outChannels = params.inChannels = strtol(optarg, NULL, 0); break;
+        case 'p': params.frames = strtol(optarg, NULL, 0); break;
+        case 'l': latency = strtol(optarg, NULL, 0); break;
+        case 'd': params.duration = strtol(optarg, NULL, 0); break;
+        case 'i': params.interval = strtol(optarg, NULL, 0); break;
+        case 's':
+            if (strcasecmp(optarg, "chirp") == 0)
+                params.signal = SIGNAL_CHIRP;
+            else if (strcasecmp(optarg, "impulse") == 0)
+                params.signal = SIGNAL_IMPULSE;
+            else {
+                usage();
+                return 1;
+            }
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    if (!params.rate || !params.outChannels || !params.frames || !params.interval) {
+        usage();
+        return 1;
+    }
+    if (!latency)
+        latency = (unsigned int)(4ULL * params.frames * 1000000 / params.rate);
+
+    AlsaPort port;
+    if (port.open(playback, capture, params, latency) < 0)
+        return 1;
+
+    return measure(&port, params);
+}
@@ -45,6 +45,142 @@ endif
 
 include $(BUILD_EXECUTABLE)
 
+################################################
+# Decoder pool benchmark, libskiahw decoder built against the mock OMX core
+
+ifeq ($(TARGET_BOARD_PLATFORM),omap3)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    SkLibTiJpeg_PoolBench.cpp \
+    MockOMXJpegDec.cpp \
+    ../../libskiahw-omap3/SkImageUtility.cpp \
+    ../../libskiahw-omap3/SkImageDecoder_libtijpeg.cpp \
+    ../../libskiahw-omap3/SkImageDecoder_libtijpeg_entry.cpp
+
+LOCAL_C_INCLUDES += \
+    external/skia/include/images \
+    external/skia/include/core \
+    hardware/ti/omap3/libskiahw-omap3 \
+    hardware/ti/omx/system/src/openmax_il/omx_core/inc \
+    $(OMX_VENDOR_INCLUDES)
+
+LOCAL_SHARED_LIBRARIES := libskia \
+                          libutils \
+                          libcutils
+
+LOCAL_MODULE := SkLibTiJpeg_PoolBench
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
+
+################################################
+# Encoder input and output buffer checks against the mock OMX core
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    SkLibTiJpeg_EncBench.cpp \
+    MockOMXJpegEnc.cpp \
+    ../../libskiahw-omap3/SkImageUtility.cpp \
+    ../../libskiahw-omap3/SkImageEncoder_libtijpeg.cpp
+
+LOCAL_C_INCLUDES += \
+    external/skia/include/images \
+    external/skia/include/core \
+    hardware/ti/omap3/libskiahw-omap3 \
+    hardware/ti/omx/system/src/openmax_il/omx_core/inc \
+    $(OMX_VENDOR_INCLUDES)
+
+LOCAL_SHARED_LIBRARIES := libskia \
+                          libutils \
+                          libcutils
+
+LOCAL_MODULE := SkLibTiJpeg_EncBench
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
+
+################################################
+# Batch decode benchmark over a generated corpus, against the mock OMX core
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    SkLibTiJpeg_BatchBench.cpp \
+    MockOMXJpegDec.cpp \
+    ../../libskiahw-omap3/SkImageUtility.cpp \
+    ../../libskiahw-omap3/SkImageDecoder_libtijpeg.cpp \
+    ../../libskiahw-omap3/SkImageDecoder_libtijpeg_entry.cpp
+
+LOCAL_C_INCLUDES += \
+    external/jpeg \
+    external/skia/include/images \
+    external/skia/include/core \
+    hardware/ti/omap3/libskiahw-omap3 \
+    hardware/ti/omx/system/src/openmax_il/omx_core/inc \
+    $(OMX_VENDOR_INCLUDES)
+
+LOCAL_STATIC_LIBRARIES := libjpeg
+
+LOCAL_SHARED_LIBRARIES := libskia \
+                          libutils \
+                          libcutils
+
+LOCAL_MODULE := SkLibTiJpeg_BatchBench
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
+
+endif
+
+################################################
+# SIMCOP availability service against a fake OMX core, runs on the host
+
+ifeq ($(TARGET_BOARD_PLATFORM),omap4)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    SkJpegHwAvailability_Test.cpp \
+    ../../libskiahw-omap4/SkJpegHwAvailability.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/libskiahw-omap4 \
+    hardware/ti/omx/ducati/domx/system/omx_core/inc
+
+LOCAL_STATIC_LIBRARIES := libutils libcutils
+LOCAL_LDLIBS += -lpthread
+
+LOCAL_MODULE := SkJpegHwAvailability_Test
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+################################################
+# MPO view index and seek benchmark on generated files
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    SkLibTiJpeg_MpoBench.cpp \
+    ../../libskiahw-omap4/SkMpoIndex.cpp
+
+LOCAL_C_INCLUDES += \
+    external/skia/include/core \
+    hardware/ti/omap3/libskiahw-omap4 \
+    hardware/ti/omx/ducati/domx/system/omx_core/inc
+
+LOCAL_SHARED_LIBRARIES := libskia
+
+LOCAL_MODULE := SkLibTiJpeg_MpoBench
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
+
+endif
+
 ################################################
 endif
 
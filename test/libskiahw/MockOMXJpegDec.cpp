@@ -0,0 +1,478 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file MockOMXJpegDec.cpp
+*
+* Mock TI OMX core with a single OMX.TI.JPEG.decoder component. Every handle
+* gets its own thread that plays the component: state changes complete
+* asynchronously, input buffers are taken in as they are queued and a decode
+* starts once the EOS input and the output buffer were queued, like the DSP
+* component does.
+*
+*/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+extern "C" {
+    #include "OMX_Component.h"
+    #include "OMX_IVCommon.h"
+}
+
+#include "MockOMXJpegDec.h"
+
+#define MOCK_PORT_COUNT 2
+#define MOCK_QUEUE_SIZE 16
+
+enum {
+    MOCK_MSG_STATE,
+    MOCK_MSG_PORT,
+    MOCK_MSG_EMPTY,
+    MOCK_MSG_FILL,
+    MOCK_MSG_QUIT
+};
+
+// vendor indexes handed out by GetExtensionIndex
+enum {
+    MOCK_INDEX_COLOR_FORMAT = OMX_IndexVendorStartUnused + 1,
+    MOCK_INDEX_PROGRESSIVE,
+    MOCK_INDEX_MAX_RESOLUTION,
+    MOCK_INDEX_SUBREGION
+};
+
+typedef struct MockMessage
+{
+    int type;
+    OMX_U32 param;
+    OMX_BUFFERHEADERTYPE* buffer;
+} MockMessage;
+
+typedef struct MockComponent
+{
+    OMX_COMPONENTTYPE handle;
+    OMX_CALLBACKTYPE callbacks;
+    OMX_PTR appData;
+    OMX_STATETYPE state;
+    OMX_PARAM_PORTDEFINITIONTYPE ports[MOCK_PORT_COUNT];
+    OMX_U32 scale;
+    OMX_U32 inputBytes;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    MockMessage queue[MOCK_QUEUE_SIZE];
+    int head;
+    int count;
+
+    OMX_BUFFERHEADERTYPE* pendingEmpty;
+    OMX_BUFFERHEADERTYPE* pendingFill;
+} MockComponent;
+
+static pthread_mutex_t gMockLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gEngineFree = PTHREAD_COND_INITIALIZER;
+static int gEngines = 1;
+static int gMpixPerSec = 20;
+static int gInputKbPerSec = 0;
+static int gBusyEngines = 0;
+static int gInstances = 0;
+static MockOMXJpegDecStats gStats;
+
+void MockOMXJpegDec_Configure(int engines, int mpixPerSec)
+{
+    pthread_mutex_lock(&gMockLock);
+    gEngines = (engines > 0) ? engines : 1;
+    gMpixPerSec = (mpixPerSec > 0) ? mpixPerSec : 1;
+    memset(&gStats, 0, sizeof(gStats));
+    pthread_mutex_unlock(&gMockLock);
+}
+
+void MockOMXJpegDec_ConfigureInput(int kbPerSec)
+{
+    pthread_mutex_lock(&gMockLock);
+    gInputKbPerSec = (kbPerSec > 0) ? kbPerSec : 0;
+    pthread_mutex_unlock(&gMockLock);
+}
+
+void MockOMXJpegDec_GetStats(MockOMXJpegDecStats* stats)
+{
+    pthread_mutex_lock(&gMockLock);
+    *stats = gStats;
+    pthread_mutex_unlock(&gMockLock);
+}
+
+static MockComponent* mock_component(OMX_HANDLETYPE hComponent)
+{
+    return (MockComponent*)((OMX_COMPONENTTYPE*)hComponent)->pComponentPrivate;
+}
+
+static void mock_post(MockComponent* comp, int type, OMX_U32 param, OMX_BUFFERHEADERTYPE* buffer)
+{
+    pthread_mutex_lock(&comp->lock);
+    if (comp->count < MOCK_QUEUE_SIZE) {
+        MockMessage* msg = &comp->queue[(comp->head + comp->count) % MOCK_QUEUE_SIZE];
+        msg->type = type;
+        msg->param = param;
+        msg->buffer = buffer;
+        comp->count++;
+        pthread_cond_signal(&comp->cond);
+    }
+    pthread_mutex_unlock(&comp->lock);
+}
+
+/* Occupies one emulated engine for as long as the hardware would take to
+ * produce the output, then writes a flat gray frame. */
+static void mock_decode(MockComponent* comp, OMX_BUFFERHEADERTYPE* in, OMX_BUFFERHEADERTYPE* out)
+{
+    OMX_PARAM_PORTDEFINITIONTYPE* outPort = &comp->ports[1];
+    unsigned long long pixels = (unsigned long long)outPort->format.image.nFrameWidth *
+                                outPort->format.image.nFrameHeight * comp->scale * comp->scale / 10000;
+    unsigned int busy;
+
+    pthread_mutex_lock(&gMockLock);
+    while (gBusyEngines >= gEngines) {
+        pthread_cond_wait(&gEngineFree, &gMockLock);
+    }
+    busy = ++gBusyEngines;
+    if (busy > gStats.peakDecodes) {
+        gStats.peakDecodes = busy;
+    }
+    gStats.decodes++;
+    pthread_mutex_unlock(&gMockLock);
+
+    usleep(pixels / gMpixPerSec);
+    memset(out->pBuffer, 0x80, out->nAllocLen);
+
+    pthread_mutex_lock(&gMockLock);
+    gBusyEngines--;
+    pthread_cond_signal(&gEngineFree);
+    pthread_mutex_unlock(&gMockLock);
+
+    out->nFilledLen = out->nAllocLen;
+    in->nFilledLen = 0;
+    // output first, the decoder leaves Run() on EmptyBufferDone
+    comp->callbacks.FillBufferDone(&comp->handle, comp->appData, out);
+    comp->callbacks.EmptyBufferDone(&comp->handle, comp->appData, in);
+}
+
+/* Takes in one compressed buffer at the configured rate. Anything before
+ * EOS goes straight back, the EOS buffer waits for the decode. */
+static bool mock_consume(MockComponent* comp, OMX_BUFFERHEADERTYPE* in)
+{
+    int kbPerSec;
+
+    pthread_mutex_lock(&gMockLock);
+    kbPerSec = gInputKbPerSec;
+    gStats.inputChunks++;
+    pthread_mutex_unlock(&gMockLock);
+
+    if (kbPerSec) {
+        usleep((unsigned long long)in->nFilledLen * 1000 / 1024 * 1000 / kbPerSec);
+    }
+    if (in->nFlags & OMX_BUFFERFLAG_EOS) {
+        return true;
+    }
+    in->nFilledLen = 0;
+    comp->callbacks.EmptyBufferDone(&comp->handle, comp->appData, in);
+    return false;
+}
+
+static void* mock_thread(void* arg)
+{
+    MockComponent* comp = (MockComponent*)arg;
+
+    for (;;) {
+        MockMessage msg;
+
+        pthread_mutex_lock(&comp->lock);
+        while (comp->count == 0) {
+            pthread_cond_wait(&comp->cond, &comp->lock);
+        }
+        msg = comp->queue[comp->head];
+        comp->head = (comp->head + 1) % MOCK_QUEUE_SIZE;
+        comp->count--;
+        pthread_mutex_unlock(&comp->lock);
+
+        switch (msg.type) {
+            case MOCK_MSG_STATE:
+                comp->state = (OMX_STATETYPE)msg.param;
+                comp->callbacks.EventHandler(&comp->handle, comp->appData, OMX_EventCmdComplete,
+                                             OMX_CommandStateSet, msg.param, NULL);
+                break;
+
+            case MOCK_MSG_PORT:
+                comp->callbacks.EventHandler(&comp->handle, comp->appData, OMX_EventCmdComplete,
+                                             OMX_CommandPortDisable, msg.param, NULL);
+                break;
+
+            case MOCK_MSG_EMPTY:
+                if (mock_consume(comp, msg.buffer)) {
+                    comp->pendingEmpty = msg.buffer;
+                }
+                break;
+
+            case MOCK_MSG_FILL:
+                comp->pendingFill = msg.buffer;
+                break;
+
+            case MOCK_MSG_QUIT:
+                return NULL;
+        }
+
+        if (comp->pendingEmpty && comp->pendingFill && comp->state == OMX_StateExecuting) {
+            OMX_BUFFERHEADERTYPE* in = comp->pendingEmpty;
+            OMX_BUFFERHEADERTYPE* out = comp->pendingFill;
+            comp->pendingEmpty = NULL;
+            comp->pendingFill = NULL;
+            mock_decode(comp, in, out);
+        }
+    }
+    return NULL;
+}
+
+static OMX_ERRORTYPE mock_SendCommand(OMX_HANDLETYPE hComponent, OMX_COMMANDTYPE Cmd,
+                                      OMX_U32 nParam1, OMX_PTR pCmdData)
+{
+    MockComponent* comp = mock_component(hComponent);
+
+    switch (Cmd) {
+        case OMX_CommandStateSet:
+            mock_post(comp, MOCK_MSG_STATE, nParam1, NULL);
+            return OMX_ErrorNone;
+        case OMX_CommandPortDisable:
+            mock_post(comp, MOCK_MSG_PORT, nParam1, NULL);
+            return OMX_ErrorNone;
+        default:
+            return OMX_ErrorNotImplemented;
+    }
+}
+
+static OMX_ERRORTYPE mock_GetParameter(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex, OMX_PTR pParam)
+{
+    MockComponent* comp = mock_component(hComponent);
+
+    if (nIndex == OMX_IndexParamImageInit) {
+        OMX_PORT_PARAM_TYPE* ports = (OMX_PORT_PARAM_TYPE*)pParam;
+        ports->nPorts = MOCK_PORT_COUNT;
+        ports->nStartPortNumber = 0;
+    } else if (nIndex == OMX_IndexParamPortDefinition) {
+        OMX_PARAM_PORTDEFINITIONTYPE* port = (OMX_PARAM_PORTDEFINITIONTYPE*)pParam;
+        if (port->nPortIndex >= MOCK_PORT_COUNT) {
+            return OMX_ErrorBadPortIndex;
+        }
+        memcpy(port, &comp->ports[port->nPortIndex], sizeof(*port));
+    }
+    // vendor parameters read back whatever the caller passed in
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_SetParameter(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex, OMX_PTR pParam)
+{
+    MockComponent* comp = mock_component(hComponent);
+
+    if (nIndex == OMX_IndexParamPortDefinition) {
+        OMX_PARAM_PORTDEFINITIONTYPE* port = (OMX_PARAM_PORTDEFINITIONTYPE*)pParam;
+        if (port->nPortIndex >= MOCK_PORT_COUNT) {
+            return OMX_ErrorBadPortIndex;
+        }
+        memcpy(&comp->ports[port->nPortIndex], port, sizeof(*port));
+    }
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_GetConfig(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex, OMX_PTR pConfig)
+{
+    return OMX_ErrorUnsupportedIndex;
+}
+
+static OMX_ERRORTYPE mock_SetConfig(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex, OMX_PTR pConfig)
+{
+    MockComponent* comp = mock_component(hComponent);
+
+    if (nIndex == OMX_IndexConfigCommonScale) {
+        comp->scale = ((OMX_CONFIG_SCALEFACTORTYPE*)pConfig)->xWidth;
+    }
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_GetExtensionIndex(OMX_HANDLETYPE hComponent, OMX_STRING cParameterName,
+                                            OMX_INDEXTYPE* pIndexType)
+{
+    static const struct {
+        const char* name;
+        int index;
+    } extensions[] = {
+        { "OMX.TI.JPEG.decoder.Config.OutputColorFormat", MOCK_INDEX_COLOR_FORMAT },
+        { "OMX.TI.JPEG.decoder.Config.ProgressiveFactor", MOCK_INDEX_PROGRESSIVE },
+        { "OMX.TI.JPEG.decoder.Param.SetMaxResolution", MOCK_INDEX_MAX_RESOLUTION },
+        { "OMX.TI.JPEG.decoder.Param.SubRegionDecode", MOCK_INDEX_SUBREGION },
+    };
+
+    // OutputResolution stays unsupported, the decoder keeps its own bitmap size
+    for (unsigned int i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+        if (!strcmp(cParameterName, extensions[i].name)) {
+            *pIndexType = (OMX_INDEXTYPE)extensions[i].index;
+            return OMX_ErrorNone;
+        }
+    }
+    return OMX_ErrorUnsupportedIndex;
+}
+
+static OMX_ERRORTYPE mock_GetState(OMX_HANDLETYPE hComponent, OMX_STATETYPE* pState)
+{
+    *pState = mock_component(hComponent)->state;
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_UseBuffer(OMX_HANDLETYPE hComponent, OMX_BUFFERHEADERTYPE** ppBufferHdr,
+                                    OMX_U32 nPortIndex, OMX_PTR pAppPrivate, OMX_U32 nSizeBytes,
+                                    OMX_U8* pBuffer)
+{
+    MockComponent* comp = mock_component(hComponent);
+    OMX_BUFFERHEADERTYPE* header;
+
+    if (nPortIndex >= MOCK_PORT_COUNT) {
+        return OMX_ErrorBadPortIndex;
+    }
+
+    header = (OMX_BUFFERHEADERTYPE*)calloc(1, sizeof(OMX_BUFFERHEADERTYPE));
+    if (header == NULL) {
+        return OMX_ErrorInsufficientResources;
+    }
+    header->nSize = sizeof(OMX_BUFFERHEADERTYPE);
+    header->pBuffer = pBuffer;
+    header->nAllocLen = nSizeBytes;
+    header->pAppPrivate = pAppPrivate;
+    if (nPortIndex == 0) {
+        header->nInputPortIndex = nPortIndex;
+        comp->inputBytes += nSizeBytes;
+        pthread_mutex_lock(&gMockLock);
+        if (comp->inputBytes > gStats.peakInputBytes) {
+            gStats.peakInputBytes = comp->inputBytes;
+        }
+        pthread_mutex_unlock(&gMockLock);
+    } else {
+        header->nOutputPortIndex = nPortIndex;
+    }
+    *ppBufferHdr = header;
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_FreeBuffer(OMX_HANDLETYPE hComponent, OMX_U32 nPortIndex,
+                                     OMX_BUFFERHEADERTYPE* pBuffer)
+{
+    // the data buffers belong to the decoder, only the header is ours
+    if (nPortIndex == 0) {
+        mock_component(hComponent)->inputBytes -= pBuffer->nAllocLen;
+    }
+    free(pBuffer);
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_EmptyThisBuffer(OMX_HANDLETYPE hComponent, OMX_BUFFERHEADERTYPE* pBuffer)
+{
+    mock_post(mock_component(hComponent), MOCK_MSG_EMPTY, 0, pBuffer);
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_FillThisBuffer(OMX_HANDLETYPE hComponent, OMX_BUFFERHEADERTYPE* pBuffer)
+{
+    mock_post(mock_component(hComponent), MOCK_MSG_FILL, 0, pBuffer);
+    return OMX_ErrorNone;
+}
+
+extern "C" OMX_ERRORTYPE TIOMX_Init(void)
+{
+    return OMX_ErrorNone;
+}
+
+extern "C" OMX_ERRORTYPE TIOMX_Deinit(void)
+{
+    return OMX_ErrorNone;
+}
+
+extern "C" OMX_ERRORTYPE TIOMX_GetHandle(OMX_HANDLETYPE* pHandle, OMX_STRING cComponentName,
+                                         OMX_PTR pAppData, OMX_CALLBACKTYPE* pCallBacks)
+{
+    MockComponent* comp;
+
+    if (strcmp(cComponentName, "OMX.TI.JPEG.decoder")) {
+        return OMX_ErrorComponentNotFound;
+    }
+
+    comp = (MockComponent*)calloc(1, sizeof(MockComponent));
+    if (comp == NULL) {
+        return OMX_ErrorInsufficientResources;
+    }
+
+    comp->handle.nSize = sizeof(OMX_COMPONENTTYPE);
+    comp->handle.pComponentPrivate = comp;
+    comp->handle.pApplicationPrivate = pAppData;
+    comp->handle.SendCommand = mock_SendCommand;
+    comp->handle.GetParameter = mock_GetParameter;
+    comp->handle.SetParameter = mock_SetParameter;
+    comp->handle.GetConfig = mock_GetConfig;
+    comp->handle.SetConfig = mock_SetConfig;
+    comp->handle.GetExtensionIndex = mock_GetExtensionIndex;
+    comp->handle.GetState = mock_GetState;
+    comp->handle.UseBuffer = mock_UseBuffer;
+    comp->handle.FreeBuffer = mock_FreeBuffer;
+    comp->handle.EmptyThisBuffer = mock_EmptyThisBuffer;
+    comp->handle.FillThisBuffer = mock_FillThisBuffer;
+    comp->callbacks = *pCallBacks;
+    comp->appData = pAppData;
+    comp->state = OMX_StateLoaded;
+    comp->scale = 100;
+    for (int i = 0; i < MOCK_PORT_COUNT; i++) {
+        comp->ports[i].nSize = sizeof(OMX_PARAM_PORTDEFINITIONTYPE);
+        comp->ports[i].nPortIndex = i;
+    }
+    pthread_mutex_init(&comp->lock, NULL);
+    pthread_cond_init(&comp->cond, NULL);
+    pthread_create(&comp->thread, NULL, mock_thread, comp);
+
+    pthread_mutex_lock(&gMockLock);
+    gStats.handles++;
+    if ((unsigned int)++gInstances > gStats.peakInstances) {
+        gStats.peakInstances = gInstances;
+    }
+    pthread_mutex_unlock(&gMockLock);
+
+    *pHandle = &comp->handle;
+    return OMX_ErrorNone;
+}
+
+extern "C" OMX_ERRORTYPE TIOMX_FreeHandle(OMX_HANDLETYPE hComponent)
+{
+    MockComponent* comp = mock_component(hComponent);
+
+    mock_post(comp, MOCK_MSG_QUIT, 0, NULL);
+    pthread_join(comp->thread, NULL);
+    pthread_mutex_destroy(&comp->lock);
+    pthread_cond_destroy(&comp->cond);
+    free(comp);
+
+    pthread_mutex_lock(&gMockLock);
+    gInstances--;
+    pthread_mutex_unlock(&gMockLock);
+    return OMX_ErrorNone;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file MockOMXJpegDec.h
+*
+* Stand-in for the TI OMX core and its OMX.TI.JPEG.decoder component. It is
+* linked in place of the real core so libskiahw can be benchmarked without
+* the DSP: decodes take a time proportional to the output size and run on a
+* configurable number of emulated codec engines.
+*
+*/
+
+#ifndef MOCK_OMX_JPEG_DEC_H
+#define MOCK_OMX_JPEG_DEC_H
+
+typedef struct MockOMXJpegDecStats
+{
+    unsigned int handles;       /* OMX_GetHandle calls */
+    unsigned int decodes;       /* buffers decoded */
+    unsigned int peakInstances; /* most handles alive at once */
+    unsigned int peakDecodes;   /* most decodes running on the engines at once */
+    unsigned int inputChunks;   /* input buffers consumed, EOS included */
+    unsigned int peakInputBytes;/* largest input port allocation of a handle */
+} MockOMXJpegDecStats;
+
+/* engines: decodes that may run at once, more queue for an engine.
+ * mpixPerSec: output megapixels one engine produces per second. */
+void MockOMXJpegDec_Configure(int engines, int mpixPerSec);
+/* kbPerSec: compressed input the component takes in per second before the
+ * decode, 0 for free. Buffers without EOS are returned as soon as they are
+ * consumed, the EOS buffer starts the decode. */
+void MockOMXJpegDec_ConfigureInput(int kbPerSec);
+void MockOMXJpegDec_GetStats(MockOMXJpegDecStats* stats);
+
+#endif
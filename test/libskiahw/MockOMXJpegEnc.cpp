@@ -0,0 +1,434 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file MockOMXJpegEnc.cpp
+*
+* Mock TI OMX core with a single OMX.TI.JPEG.encoder component. Every handle
+* gets its own thread that plays the component: state changes complete
+* asynchronously and an encode starts once both the input and the output
+* buffer were queued, like the DSP component does.
+*
+*/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+extern "C" {
+    #include "OMX_Component.h"
+    #include "OMX_IVCommon.h"
+}
+
+#include "MockOMXJpegEnc.h"
+
+#define MOCK_PORT_COUNT 2
+#define MOCK_QUEUE_SIZE 16
+#define MOCK_MAX_HEADERS 4
+#define MOCK_JPEG_HEADER_SIZE 623   // SOI, DQT, SOF0, DHT, SOS without a thumbnail
+
+enum {
+    MOCK_MSG_STATE,
+    MOCK_MSG_EMPTY,
+    MOCK_MSG_FILL,
+    MOCK_MSG_QUIT
+};
+
+// vendor indexes handed out by GetExtensionIndex
+enum {
+    MOCK_INDEX_QFACTOR = OMX_IndexVendorStartUnused + 1,
+    MOCK_INDEX_INPUT_WIDTH,
+    MOCK_INDEX_INPUT_HEIGHT
+};
+
+typedef struct MockMessage
+{
+    int type;
+    OMX_U32 param;
+    OMX_BUFFERHEADERTYPE* buffer;
+} MockMessage;
+
+typedef struct MockComponent
+{
+    OMX_COMPONENTTYPE handle;
+    OMX_CALLBACKTYPE callbacks;
+    OMX_PTR appData;
+    OMX_STATETYPE state;
+    OMX_PARAM_PORTDEFINITIONTYPE ports[MOCK_PORT_COUNT];
+    OMX_U32 width;
+    OMX_U32 height;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    MockMessage queue[MOCK_QUEUE_SIZE];
+    int head;
+    int count;
+
+    // headers the encoder has not freed yet, released with the handle
+    OMX_BUFFERHEADERTYPE* headers[MOCK_MAX_HEADERS];
+
+    OMX_BUFFERHEADERTYPE* pendingEmpty;
+    OMX_BUFFERHEADERTYPE* pendingFill;
+} MockComponent;
+
+static pthread_mutex_t gMockLock = PTHREAD_MUTEX_INITIALIZER;
+static int gJpegBitsPerPixel = 4;
+static int gMpixPerSec = 20;
+static MockOMXJpegEncStats gStats;
+
+void MockOMXJpegEnc_Configure(int jpegBitsPerPixel, int mpixPerSec)
+{
+    pthread_mutex_lock(&gMockLock);
+    gJpegBitsPerPixel = (jpegBitsPerPixel > 0) ? jpegBitsPerPixel : 1;
+    gMpixPerSec = (mpixPerSec > 0) ? mpixPerSec : 1;
+    memset(&gStats, 0, sizeof(gStats));
+    pthread_mutex_unlock(&gMockLock);
+}
+
+void MockOMXJpegEnc_GetStats(MockOMXJpegEncStats* stats)
+{
+    pthread_mutex_lock(&gMockLock);
+    *stats = gStats;
+    pthread_mutex_unlock(&gMockLock);
+}
+
+static MockComponent* mock_component(OMX_HANDLETYPE hComponent)
+{
+    return (MockComponent*)((OMX_COMPONENTTYPE*)hComponent)->pComponentPrivate;
+}
+
+static void mock_post(MockComponent* comp, int type, OMX_U32 param, OMX_BUFFERHEADERTYPE* buffer)
+{
+    pthread_mutex_lock(&comp->lock);
+    if (comp->count < MOCK_QUEUE_SIZE) {
+        MockMessage* msg = &comp->queue[(comp->head + comp->count) % MOCK_QUEUE_SIZE];
+        msg->type = type;
+        msg->param = param;
+        msg->buffer = buffer;
+        comp->count++;
+        pthread_cond_signal(&comp->cond);
+    }
+    pthread_mutex_unlock(&comp->lock);
+}
+
+/* Reads the frame the way the DSP would, then writes SOI, filler and EOI for
+ * as much of the JPEG as fits the output buffer. */
+static void mock_encode(MockComponent* comp, OMX_BUFFERHEADERTYPE* in, OMX_BUFFERHEADERTYPE* out)
+{
+    OMX_U32 pixels = comp->width * comp->height;
+    OMX_U32 bytesPerPixel = (comp->ports[0].format.image.eColorFormat == OMX_COLOR_Format32bitARGB8888) ? 4 : 2;
+    OMX_U32 frameSize = pixels * bytesPerPixel;
+    OMX_U32 jpegSize;
+    unsigned int sum = 0;
+
+    if (frameSize > in->nAllocLen) {
+        frameSize = in->nAllocLen;
+    }
+    for (OMX_U32 i = 0; i < frameSize; i++) {
+        sum += in->pBuffer[i];
+    }
+    usleep(pixels / gMpixPerSec);
+
+    pthread_mutex_lock(&gMockLock);
+    jpegSize = MOCK_JPEG_HEADER_SIZE + (OMX_U32)((unsigned long long)pixels * gJpegBitsPerPixel / 8);
+    gStats.encodes++;
+    gStats.lastInput = in->pBuffer;
+    gStats.lastInputSum = sum;
+    gStats.lastOutputSize = out->nAllocLen;
+    if (jpegSize > out->nAllocLen) {
+        gStats.truncated++;
+        jpegSize = out->nAllocLen;
+    }
+    pthread_mutex_unlock(&gMockLock);
+
+    memset(out->pBuffer, 0x55, jpegSize);
+    out->pBuffer[0] = 0xFF;
+    out->pBuffer[1] = 0xD8;
+    out->pBuffer[jpegSize - 2] = 0xFF;
+    out->pBuffer[jpegSize - 1] = 0xD9;
+
+    out->nFilledLen = jpegSize;
+    in->nFilledLen = 0;
+    // output first, the encoder leaves Run() on EmptyBufferDone
+    comp->callbacks.FillBufferDone(&comp->handle, comp->appData, out);
+    comp->callbacks.EmptyBufferDone(&comp->handle, comp->appData, in);
+}
+
+static void* mock_thread(void* arg)
+{
+    MockComponent* comp = (MockComponent*)arg;
+
+    for (;;) {
+        MockMessage msg;
+
+        pthread_mutex_lock(&comp->lock);
+        while (comp->count == 0) {
+            pthread_cond_wait(&comp->cond, &comp->lock);
+        }
+        msg = comp->queue[comp->head];
+        comp->head = (comp->head + 1) % MOCK_QUEUE_SIZE;
+        comp->count--;
+        pthread_mutex_unlock(&comp->lock);
+
+        switch (msg.type) {
+            case MOCK_MSG_STATE:
+                comp->state = (OMX_STATETYPE)msg.param;
+                comp->callbacks.EventHandler(&comp->handle, comp->appData, OMX_EventCmdComplete,
+                                             OMX_CommandStateSet, msg.param, NULL);
+                break;
+
+            case MOCK_MSG_EMPTY:
+                comp->pendingEmpty = msg.buffer;
+                break;
+
+            case MOCK_MSG_FILL:
+                comp->pendingFill = msg.buffer;
+                break;
+
+            case MOCK_MSG_QUIT:
+                return NULL;
+        }
+
+        if (comp->pendingEmpty && comp->pendingFill && comp->state == OMX_StateExecuting) {
+            OMX_BUFFERHEADERTYPE* in = comp->pendingEmpty;
+            OMX_BUFFERHEADERTYPE* out = comp->pendingFill;
+            comp->pendingEmpty = NULL;
+            comp->pendingFill = NULL;
+            mock_encode(comp, in, out);
+        }
+    }
+    return NULL;
+}
+
+static OMX_ERRORTYPE mock_SendCommand(OMX_HANDLETYPE hComponent, OMX_COMMANDTYPE Cmd,
+                                      OMX_U32 nParam1, OMX_PTR pCmdData)
+{
+    if (Cmd != OMX_CommandStateSet) {
+        return OMX_ErrorNotImplemented;
+    }
+    mock_post(mock_component(hComponent), MOCK_MSG_STATE, nParam1, NULL);
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_GetParameter(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex, OMX_PTR pParam)
+{
+    MockComponent* comp = mock_component(hComponent);
+
+    if (nIndex == OMX_IndexParamImageInit) {
+        OMX_PORT_PARAM_TYPE* ports = (OMX_PORT_PARAM_TYPE*)pParam;
+        ports->nPorts = MOCK_PORT_COUNT;
+        ports->nStartPortNumber = 0;
+    } else if (nIndex == OMX_IndexParamPortDefinition) {
+        OMX_PARAM_PORTDEFINITIONTYPE* port = (OMX_PARAM_PORTDEFINITIONTYPE*)pParam;
+        if (port->nPortIndex >= MOCK_PORT_COUNT) {
+            return OMX_ErrorBadPortIndex;
+        }
+        memcpy(port, &comp->ports[port->nPortIndex], sizeof(*port));
+    }
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_SetParameter(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex, OMX_PTR pParam)
+{
+    MockComponent* comp = mock_component(hComponent);
+
+    if (nIndex == OMX_IndexParamPortDefinition) {
+        OMX_PARAM_PORTDEFINITIONTYPE* port = (OMX_PARAM_PORTDEFINITIONTYPE*)pParam;
+        if (port->nPortIndex >= MOCK_PORT_COUNT) {
+            return OMX_ErrorBadPortIndex;
+        }
+        memcpy(&comp->ports[port->nPortIndex], port, sizeof(*port));
+    }
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_SetConfig(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex, OMX_PTR pConfig)
+{
+    MockComponent* comp = mock_component(hComponent);
+
+    if ((int)nIndex == MOCK_INDEX_INPUT_WIDTH) {
+        comp->width = *(int*)pConfig;
+    } else if ((int)nIndex == MOCK_INDEX_INPUT_HEIGHT) {
+        comp->height = *(int*)pConfig;
+    }
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_GetExtensionIndex(OMX_HANDLETYPE hComponent, OMX_STRING cParameterName,
+                                            OMX_INDEXTYPE* pIndexType)
+{
+    static const struct {
+        const char* name;
+        int index;
+    } extensions[] = {
+        { "OMX.TI.JPEG.encoder.Config.QFactor", MOCK_INDEX_QFACTOR },
+        { "OMX.TI.JPEG.encoder.Config.InputFrameWidth", MOCK_INDEX_INPUT_WIDTH },
+        { "OMX.TI.JPEG.encoder.Config.InputFrameHeight", MOCK_INDEX_INPUT_HEIGHT },
+    };
+
+    for (unsigned int i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+        if (!strcmp(cParameterName, extensions[i].name)) {
+            *pIndexType = (OMX_INDEXTYPE)extensions[i].index;
+            return OMX_ErrorNone;
+        }
+    }
+    return OMX_ErrorUnsupportedIndex;
+}
+
+static OMX_ERRORTYPE mock_GetState(OMX_HANDLETYPE hComponent, OMX_STATETYPE* pState)
+{
+    *pState = mock_component(hComponent)->state;
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_UseBuffer(OMX_HANDLETYPE hComponent, OMX_BUFFERHEADERTYPE** ppBufferHdr,
+                                    OMX_U32 nPortIndex, OMX_PTR pAppPrivate, OMX_U32 nSizeBytes,
+                                    OMX_U8* pBuffer)
+{
+    MockComponent* comp = mock_component(hComponent);
+    OMX_BUFFERHEADERTYPE* header;
+    int slot;
+
+    if (nPortIndex >= MOCK_PORT_COUNT) {
+        return OMX_ErrorBadPortIndex;
+    }
+    for (slot = 0; slot < MOCK_MAX_HEADERS && comp->headers[slot] != NULL; slot++) {
+    }
+    if (slot == MOCK_MAX_HEADERS) {
+        return OMX_ErrorInsufficientResources;
+    }
+
+    header = (OMX_BUFFERHEADERTYPE*)calloc(1, sizeof(OMX_BUFFERHEADERTYPE));
+    if (header == NULL) {
+        return OMX_ErrorInsufficientResources;
+    }
+    header->nSize = sizeof(OMX_BUFFERHEADERTYPE);
+    header->pBuffer = pBuffer;
+    header->nAllocLen = nSizeBytes;
+    header->pAppPrivate = pAppPrivate;
+    if (nPortIndex == 0) {
+        header->nInputPortIndex = nPortIndex;
+    } else {
+        header->nOutputPortIndex = nPortIndex;
+    }
+    comp->headers[slot] = header;
+    *ppBufferHdr = header;
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_FreeBuffer(OMX_HANDLETYPE hComponent, OMX_U32 nPortIndex,
+                                     OMX_BUFFERHEADERTYPE* pBuffer)
+{
+    MockComponent* comp = mock_component(hComponent);
+
+    // the data buffers belong to the encoder, only the header is ours
+    for (int i = 0; i < MOCK_MAX_HEADERS; i++) {
+        if (comp->headers[i] == pBuffer) {
+            comp->headers[i] = NULL;
+        }
+    }
+    free(pBuffer);
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_EmptyThisBuffer(OMX_HANDLETYPE hComponent, OMX_BUFFERHEADERTYPE* pBuffer)
+{
+    mock_post(mock_component(hComponent), MOCK_MSG_EMPTY, 0, pBuffer);
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_FillThisBuffer(OMX_HANDLETYPE hComponent, OMX_BUFFERHEADERTYPE* pBuffer)
+{
+    mock_post(mock_component(hComponent), MOCK_MSG_FILL, 0, pBuffer);
+    return OMX_ErrorNone;
+}
+
+extern "C" OMX_ERRORTYPE TIOMX_Init(void)
+{
+    return OMX_ErrorNone;
+}
+
+extern "C" OMX_ERRORTYPE TIOMX_Deinit(void)
+{
+    return OMX_ErrorNone;
+}
+
+extern "C" OMX_ERRORTYPE TIOMX_GetHandle(OMX_HANDLETYPE* pHandle, OMX_STRING cComponentName,
+                                         OMX_PTR pAppData, OMX_CALLBACKTYPE* pCallBacks)
+{
+    MockComponent* comp;
+
+    if (strcmp(cComponentName, "OMX.TI.JPEG.encoder")) {
+        return OMX_ErrorComponentNotFound;
+    }
+
+    comp = (MockComponent*)calloc(1, sizeof(MockComponent));
+    if (comp == NULL) {
+        return OMX_ErrorInsufficientResources;
+    }
+
+    comp->handle.nSize = sizeof(OMX_COMPONENTTYPE);
+    comp->handle.pComponentPrivate = comp;
+    comp->handle.pApplicationPrivate = pAppData;
+    comp->handle.SendCommand = mock_SendCommand;
+    comp->handle.GetParameter = mock_GetParameter;
+    comp->handle.SetParameter = mock_SetParameter;
+    comp->handle.SetConfig = mock_SetConfig;
+    comp->handle.GetExtensionIndex = mock_GetExtensionIndex;
+    comp->handle.GetState = mock_GetState;
+    comp->handle.UseBuffer = mock_UseBuffer;
+    comp->handle.FreeBuffer = mock_FreeBuffer;
+    comp->handle.EmptyThisBuffer = mock_EmptyThisBuffer;
+    comp->handle.FillThisBuffer = mock_FillThisBuffer;
+    comp->callbacks = *pCallBacks;
+    comp->appData = pAppData;
+    comp->state = OMX_StateLoaded;
+    for (int i = 0; i < MOCK_PORT_COUNT; i++) {
+        comp->ports[i].nSize = sizeof(OMX_PARAM_PORTDEFINITIONTYPE);
+        comp->ports[i].nPortIndex = i;
+    }
+    pthread_mutex_init(&comp->lock, NULL);
+    pthread_cond_init(&comp->cond, NULL);
+    pthread_create(&comp->thread, NULL, mock_thread, comp);
+
+    pthread_mutex_lock(&gMockLock);
+    gStats.handles++;
+    pthread_mutex_unlock(&gMockLock);
+
+    *pHandle = &comp->handle;
+    return OMX_ErrorNone;
+}
+
+extern "C" OMX_ERRORTYPE TIOMX_FreeHandle(OMX_HANDLETYPE hComponent)
+{
+    MockComponent* comp = mock_component(hComponent);
+
+    mock_post(comp, MOCK_MSG_QUIT, 0, NULL);
+    pthread_join(comp->thread, NULL);
+    // a handle replaced while executing still has its buffers
+    for (int i = 0; i < MOCK_MAX_HEADERS; i++) {
+        free(comp->headers[i]);
+    }
+    pthread_mutex_destroy(&comp->lock);
+    pthread_cond_destroy(&comp->cond);
+    free(comp);
+    return OMX_ErrorNone;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file MockOMXJpegEnc.h
+*
+* Stand-in for the TI OMX core and its OMX.TI.JPEG.encoder component, linked
+* in place of the real core so the libskiahw encoder can be exercised without
+* the DSP. The component reads the whole input frame like the DSP does and
+* writes a JPEG of a configurable size, cut short when the output buffer is
+* too small for it.
+*
+*/
+
+#ifndef MOCK_OMX_JPEG_ENC_H
+#define MOCK_OMX_JPEG_ENC_H
+
+typedef struct MockOMXJpegEncStats
+{
+    unsigned int handles;           /* OMX_GetHandle calls */
+    unsigned int encodes;           /* frames encoded */
+    unsigned int truncated;         /* JPEGs that did not fit the output buffer */
+    const void* lastInput;          /* input buffer of the last encode */
+    unsigned int lastInputSum;      /* byte sum of the frame the last encode read */
+    unsigned int lastOutputSize;    /* output buffer of the last encode */
+} MockOMXJpegEncStats;
+
+/* jpegBitsPerPixel: size of the JPEGs the component produces.
+ * mpixPerSec: input megapixels the DSP reads per second. */
+void MockOMXJpegEnc_Configure(int jpegBitsPerPixel, int mpixPerSec);
+void MockOMXJpegEnc_GetStats(MockOMXJpegEncStats* stats);
+
+#endif
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Runs the OMAP4 SIMCOP availability service against a fake OMX core on the
+ * host, checking that the hardware is probed once, that refusals and resource
+ * events route decodes to ARM without OMX calls, and what a check costs:
+ *   SkJpegHwAvailability_Test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "SkJpegHwAvailability.h"
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+/* Fake OMX core, the component registry and handle outcome are set per test */
+static struct {
+    bool registered;            // the decoder shows up in OMX_ComponentNameEnum
+    bool canEnumerate;          // OMX_ComponentNameEnum is implemented
+    OMX_ERRORTYPE handleResult; // what OMX_GetHandle returns
+    int inits;                  // OMX_Init minus OMX_Deinit
+    int getHandles;
+    int liveHandles;
+} core;
+
+static int fakeComponent;
+
+extern "C" OMX_ERRORTYPE OMX_Init(void)
+{
+    core.inits++;
+    return OMX_ErrorNone;
+}
+
+extern "C" OMX_ERRORTYPE OMX_Deinit(void)
+{
+    core.inits--;
+    return OMX_ErrorNone;
+}
+
+extern "C" OMX_ERRORTYPE OMX_ComponentNameEnum(OMX_STRING name, OMX_U32 length, OMX_U32 index)
+{
+    static const char* names[] = { "OMX.TI.DUCATI1.VIDEO.DECODER", SkJpegHwAvailability::ComponentName };
+    int count = core.registered ? 2 : 1;
+
+    if (!core.canEnumerate) {
+        return OMX_ErrorNotImplemented;
+    }
+    if ((int)index >= count) {
+        return OMX_ErrorNoMore;
+    }
+    strncpy(name, names[index], length);
+    return OMX_ErrorNone;
+}
+
+extern "C" OMX_ERRORTYPE OMX_GetHandle(OMX_HANDLETYPE* handle, OMX_STRING name, OMX_PTR appData,
+                                       OMX_CALLBACKTYPE* callbacks)
+{
+    core.getHandles++;
+    if (core.handleResult != OMX_ErrorNone || strcmp(name, SkJpegHwAvailability::ComponentName)) {
+        *handle = NULL;
+        return core.handleResult != OMX_ErrorNone ? core.handleResult : OMX_ErrorComponentNotFound;
+    }
+    core.liveHandles++;
+    *handle = &fakeComponent;
+    return OMX_ErrorNone;
+}
+
+extern "C" OMX_ERRORTYPE OMX_FreeHandle(OMX_HANDLETYPE handle)
+{
+    core.liveHandles--;
+    return OMX_ErrorNone;
+}
+
+static SkJpegHwAvailability& hw = SkJpegHwAvailability::Get();
+
+static void setup(bool registered, bool canEnumerate, OMX_ERRORTYPE handleResult)
+{
+    hw.reset();
+    core.registered = registered;
+    core.canEnumerate = canEnumerate;
+    core.handleResult = handleResult;
+    core.getHandles = 0;
+}
+
+static OMX_ERRORTYPE decoderHandle(OMX_HANDLETYPE* handle)
+{
+    OMX_CALLBACKTYPE callbacks = { NULL, NULL, NULL };
+    return hw.getHandle(handle, NULL, &callbacks);
+}
+
+static void testProbeOnce()
+{
+    SkJpegHwAvailability::Stats stats;
+    OMX_HANDLETYPE handle;
+
+    setup(true, true, OMX_ErrorNone);
+    for (int i = 0; i < 1000; i++) {
+        CHECK(hw.isAvailable());
+    }
+    hw.getStats(&stats);
+    CHECK(stats.probes == 0);
+    CHECK(core.getHandles == 0);
+    CHECK(core.inits == 1);
+
+    CHECK(decoderHandle(&handle) == OMX_ErrorNone);
+    CHECK(handle == &fakeComponent);
+    hw.freeHandle(handle);
+    CHECK(core.liveHandles == 0);
+    // handles come and go without taking the core down
+    CHECK(core.inits == 1);
+}
+
+static void testMissingComponent()
+{
+    OMX_HANDLETYPE handle;
+
+    setup(false, true, OMX_ErrorNone);
+    CHECK(!hw.isAvailable());
+    CHECK(!hw.isAvailable());
+    CHECK(decoderHandle(&handle) == OMX_ErrorComponentNotFound);
+    CHECK(core.getHandles == 0);
+    CHECK(core.inits == 0);
+}
+
+static void testProbeWithoutEnumeration()
+{
+    SkJpegHwAvailability::Stats stats;
+
+    setup(false, false, OMX_ErrorNone);
+    CHECK(hw.isAvailable());
+    CHECK(hw.isAvailable());
+    hw.getStats(&stats);
+    CHECK(stats.probes == 1);
+    CHECK(core.getHandles == 1);
+    CHECK(core.liveHandles == 0);
+}
+
+static void testRefusedHandleBacksOff()
+{
+    SkJpegHwAvailability::Stats stats;
+    OMX_HANDLETYPE handle;
+
+    setup(true, true, OMX_ErrorInsufficientResources);
+    CHECK(hw.isAvailable());
+    CHECK(decoderHandle(&handle) == OMX_ErrorInsufficientResources);
+    CHECK(handle == NULL);
+
+    // everyone goes to ARM without asking OMX again
+    for (int i = 0; i < 100; i++) {
+        CHECK(!hw.isAvailable());
+    }
+    CHECK(core.getHandles == 1);
+
+    // one caller retries after the back off, the others stay on ARM meanwhile
+    usleep(120 * 1000);
+    CHECK(hw.isAvailable());
+    CHECK(!hw.isAvailable());
+    CHECK(decoderHandle(&handle) == OMX_ErrorInsufficientResources);
+
+    // the back off doubled
+    usleep(120 * 1000);
+    CHECK(!hw.isAvailable());
+    usleep(120 * 1000);
+    CHECK(hw.isAvailable());
+
+    // a granted handle clears it
+    core.handleResult = OMX_ErrorNone;
+    CHECK(decoderHandle(&handle) == OMX_ErrorNone);
+    hw.freeHandle(handle);
+    CHECK(hw.isAvailable());
+    CHECK(hw.isAvailable());
+
+    hw.getStats(&stats);
+    CHECK(stats.contentions == 2);
+    CHECK(stats.armRouted >= 102);
+    CHECK(stats.handles == 1);
+}
+
+static void testResourceEvents()
+{
+    setup(true, true, OMX_ErrorNone);
+    CHECK(hw.isAvailable());
+
+    // preempted by a higher priority client
+    hw.onEvent(OMX_EventError, (OMX_U32)OMX_ErrorResourcesPreempted);
+    CHECK(!hw.isAvailable());
+
+    // unrelated errors say nothing about availability
+    hw.onEvent(OMX_EventError, (OMX_U32)OMX_ErrorHardware);
+    hw.onEvent(OMX_EventCmdComplete, 0);
+    CHECK(!hw.isAvailable());
+
+    hw.onEvent(OMX_EventResourcesAcquired, 0);
+    CHECK(hw.isAvailable());
+
+    hw.onEvent(OMX_EventError, (OMX_U32)OMX_ErrorResourcesLost);
+    CHECK(!hw.isAvailable());
+    CHECK(core.getHandles == 0);
+}
+
+static void measure()
+{
+    const int checks = 1000000;
+    nsecs_t available, contended;
+
+    setup(true, true, OMX_ErrorNone);
+    hw.isAvailable();
+
+    nsecs_t start = systemTime();
+    for (int i = 0; i < checks; i++) {
+        hw.isAvailable();
+    }
+    available = (systemTime() - start) / checks;
+
+    hw.onEvent(OMX_EventError, (OMX_U32)OMX_ErrorResourcesLost);
+    start = systemTime();
+    for (int i = 0; i < checks; i++) {
+        hw.isAvailable();
+    }
+    contended = (systemTime() - start) / checks;
+
+    printf("isAvailable: %lld ns available, %lld ns contended, %d OMX_GetHandle calls\n",
+           (long long)available, (long long)contended, core.getHandles);
+}
+
+int main(int argc, char** argv)
+{
+    testProbeOnce();
+    testMissingComponent();
+    testProbeWithoutEnumeration();
+    testRefusedHandleBacksOff();
+    testResourceEvents();
+    measure();
+
+    hw.reset();
+    CHECK(core.inits == 0);
+
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,560 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file SkLibTiJpeg_BatchBench.cpp
+*
+* Generates a corpus of JPEGs with libjpeg: every size in 4:2:0, 4:2:2,
+* 4:4:4, grayscale, progressive and as a two view MPO. Each image is first
+* decoded alone through the hardware decoder and through libjpeg to find
+* where the hardware starts to win, then the whole corpus is decoded from
+* 1, 2, 4 ... N threads through the libskiahw decoder pool, against the mock
+* OMX JPEG component:
+*
+*   SkLibTiJpeg_BatchBench [-t threads] [-n passes] [-m max Mpix] [-e engines] [-r mpix/s]
+*                          [-c results.csv]
+*
+* Latencies are per image in microseconds, the heap high-water mark is
+* sampled with mallinfo() while the batch runs. -c writes every result as a
+* CSV record, "image" rows for the single image timings and "batch" rows for
+* the thread counts, for tracking regressions between builds.
+*
+*/
+
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+
+extern "C" {
+#include "jpeglib.h"
+}
+
+#include "SkBitmap.h"
+#include "SkStream.h"
+#include "SkImageDecoder.h"
+#include "SkImageDecoder_libtijpeg_entry.h"
+#include "MockOMXJpegDec.h"
+
+#define PRINT printf
+#define MAX_THREADS 16
+#define MAX_CORPUS 64
+#define HEAP_SAMPLE_US 2000
+
+typedef enum {
+    KIND_420,
+    KIND_422,
+    KIND_444,
+    KIND_GRAY,
+    KIND_PROGRESSIVE,
+    KIND_MPO,
+    KIND_COUNT
+} CorpusKind;
+
+static const char* const kKindNames[KIND_COUNT] = { "420", "422", "444", "gray", "prog", "mpo" };
+
+static const struct { int width, height; } kSizes[] = {
+    { 320, 240 }, { 640, 480 }, { 1024, 768 }, { 1600, 1200 }, { 2048, 1536 }, { 2592, 1944 }, { 3264, 2448 }
+};
+
+typedef struct CorpusImage
+{
+    CorpusKind kind;
+    int width;
+    int height;
+    void* data;
+    size_t size;
+} CorpusImage;
+
+typedef struct BatchThread
+{
+    pthread_t thread;
+    const CorpusImage* corpus;
+    int images;
+    int first;
+    int count;
+    int failures;
+    long long* latency;
+} BatchThread;
+
+static long long nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int compareNs(const void* a, const void* b)
+{
+    long long d = *(const long long*)a - *(const long long*)b;
+    return d < 0 ? -1 : d > 0;
+}
+
+static long long percentile(const long long* sorted, int count, int pct)
+{
+    return sorted[(count - 1) * pct / 100];
+}
+
+/* --- corpus ------------------------------------------------------------- */
+
+/* libjpeg in the tree predates jpeg_mem_dest, this destination grows a buffer */
+typedef struct MemoryDest
+{
+    struct jpeg_destination_mgr pub;
+    JOCTET* buffer;
+    size_t capacity;
+} MemoryDest;
+
+static void memInitDestination(j_compress_ptr cinfo)
+{
+    MemoryDest* dest = (MemoryDest*)cinfo->dest;
+    dest->pub.next_output_byte = dest->buffer;
+    dest->pub.free_in_buffer = dest->capacity;
+}
+
+static boolean memEmptyOutputBuffer(j_compress_ptr cinfo)
+{
+    MemoryDest* dest = (MemoryDest*)cinfo->dest;
+    size_t used = dest->capacity;
+
+    dest->capacity *= 2;
+    dest->buffer = (JOCTET*)realloc(dest->buffer, dest->capacity);
+    dest->pub.next_output_byte = dest->buffer + used;
+    dest->pub.free_in_buffer = dest->capacity - used;
+    return TRUE;
+}
+
+static void memTermDestination(j_compress_ptr cinfo)
+{
+}
+
+/* A gradient with some texture, so the entropy coded data has a realistic size.
+ * app2 is written as an APP2 segment right after the JFIF header. */
+static JOCTET* encodeJpeg(int width, int height, CorpusKind kind, int seed,
+                          const JOCTET* app2, size_t app2Length, size_t* size)
+{
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    MemoryDest dest;
+    int components = (kind == KIND_GRAY) ? 1 : 3;
+    JSAMPLE* row = (JSAMPLE*)malloc(width * components);
+
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+
+    dest.pub.init_destination = memInitDestination;
+    dest.pub.empty_output_buffer = memEmptyOutputBuffer;
+    dest.pub.term_destination = memTermDestination;
+    dest.capacity = width * height / 2 + 4096;
+    dest.buffer = (JOCTET*)malloc(dest.capacity);
+    cinfo.dest = &dest.pub;
+
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = components;
+    cinfo.in_color_space = (components == 1) ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 90, TRUE);
+
+    // luma sampling factors against 1x1 chroma
+    switch (kind) {
+        case KIND_422:
+            cinfo.comp_info[0].h_samp_factor = 2;
+            cinfo.comp_info[0].v_samp_factor = 1;
+            break;
+        case KIND_444:
+            cinfo.comp_info[0].h_samp_factor = 1;
+            cinfo.comp_info[0].v_samp_factor = 1;
+            break;
+        case KIND_PROGRESSIVE:
+            jpeg_simple_progression(&cinfo);
+            break;
+        default:
+            break;
+    }
+
+    jpeg_start_compress(&cinfo, TRUE);
+    if (app2 != NULL) {
+        jpeg_write_marker(&cinfo, JPEG_APP0 + 2, app2, app2Length);
+    }
+    while (cinfo.next_scanline < cinfo.image_height) {
+        int y = cinfo.next_scanline;
+        for (int x = 0; x < width; x++) {
+            unsigned int noise = (x * 1103515245u + y * 12345u + seed) >> 24;
+            for (int c = 0; c < components; c++) {
+                int v = (c == 0) ? x * 255 / width : (c == 1) ? y * 255 / height : (x ^ y) & 0xFF;
+                row[x * components + c] = (JSAMPLE)((v * 3 + (noise & 0x3F)) / 4);
+            }
+        }
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+
+    *size = dest.capacity - dest.pub.free_in_buffer;
+    jpeg_destroy_compress(&cinfo);
+    free(row);
+    return dest.buffer;
+}
+
+static void put16(JOCTET* p, unsigned int v)
+{
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static void put32(JOCTET* p, unsigned int v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+/* Two baseline views, the first one with a big endian MP index. The offset of
+ * the second view is only known once the first one is encoded, it is patched
+ * into the index afterwards. */
+static void* encodeMpo(int width, int height, size_t* size)
+{
+    const unsigned int entries = 3;
+    const size_t app2Length = 4 + 8 + 2 + entries * 12 + 4 + 2 * 16;
+    JOCTET app2[app2Length];
+    JOCTET* p = app2;
+    JOCTET* views[2];
+    size_t viewSize[2];
+
+    memset(app2, 0, sizeof(app2));
+    memcpy(p, "MPF", 4);
+    p += 4;
+    p[0] = p[1] = 0x4D;
+    put16(p + 2, 0x2A);
+    put32(p + 4, 8);
+    p += 8;
+    put16(p, entries);
+    p += 2;
+    put16(p, 0xB000); put16(p + 2, 7); put32(p + 4, 4); memcpy(p + 8, "0100", 4);
+    p += 12;
+    put16(p, 0xB001); put16(p + 2, 4); put32(p + 4, 1); put32(p + 8, 2);
+    p += 12;
+    put16(p, 0xB002); put16(p + 2, 7); put32(p + 4, 2 * 16); put32(p + 8, 8 + 2 + entries * 12 + 4);
+    p += 12 + 4;
+    JOCTET* mpEntry = p;
+
+    views[0] = encodeJpeg(width, height, KIND_420, 0, app2, app2Length, &viewSize[0]);
+    views[1] = encodeJpeg(width, height, KIND_420, 1, NULL, 0, &viewSize[1]);
+
+    // find the index again in the encoded view, offsets count from its byte order mark
+    size_t mpf = 0;
+    while (mpf + 4 < viewSize[0] && memcmp(views[0] + mpf, "MPF", 4)) {
+        mpf++;
+    }
+    JOCTET* entry = views[0] + mpf + (mpEntry - app2);
+    put32(entry, 0x20020002);
+    put32(entry + 4, viewSize[0]);
+    put32(entry + 8, 0);
+    put32(entry + 16, 0x00020002);
+    put32(entry + 20, viewSize[1]);
+    put32(entry + 24, viewSize[0] - (mpf + 4));
+
+    *size = viewSize[0] + viewSize[1];
+    JOCTET* file = (JOCTET*)malloc(*size);
+    memcpy(file, views[0], viewSize[0]);
+    memcpy(file + viewSize[0], views[1], viewSize[1]);
+    free(views[0]);
+    free(views[1]);
+    return file;
+}
+
+static int buildCorpus(CorpusImage* corpus, int maxMpix)
+{
+    int count = 0;
+
+    for (unsigned int s = 0; s < sizeof(kSizes) / sizeof(kSizes[0]); s++) {
+        if (kSizes[s].width * kSizes[s].height > maxMpix * 1000000) {
+            break;
+        }
+        for (int k = 0; k < KIND_COUNT && count < MAX_CORPUS; k++) {
+            CorpusImage* image = &corpus[count++];
+            image->kind = (CorpusKind)k;
+            image->width = kSizes[s].width;
+            image->height = kSizes[s].height;
+            if (k == KIND_MPO) {
+                image->data = encodeMpo(image->width, image->height, &image->size);
+            } else {
+                image->data = encodeJpeg(image->width, image->height, image->kind, 0, NULL, 0, &image->size);
+            }
+        }
+    }
+    return count;
+}
+
+/* --- heap high-water mark ---------------------------------------------- */
+
+static pthread_mutex_t gHeapLock = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool gHeapSampling;
+static size_t gHeapPeak;
+
+static size_t heapInUse()
+{
+    struct mallinfo mi = mallinfo();
+    return (size_t)mi.uordblks + (size_t)mi.hblkhd;
+}
+
+static void* heapSampler(void* arg)
+{
+    while (gHeapSampling) {
+        size_t inUse = heapInUse();
+        pthread_mutex_lock(&gHeapLock);
+        if (inUse > gHeapPeak) {
+            gHeapPeak = inUse;
+        }
+        pthread_mutex_unlock(&gHeapLock);
+        usleep(HEAP_SAMPLE_US);
+    }
+    return NULL;
+}
+
+/* --- decodes ----------------------------------------------------------- */
+
+static bool decodeImage(SkImageDecoder* decoder, const CorpusImage* image)
+{
+    SkMemoryStream stream(image->data, image->size);
+    SkBitmap bm;
+
+    return decoder->decode(&stream, &bm, SkBitmap::kRGB_565_Config, SkImageDecoder::kDecodePixels_Mode) &&
+           bm.width() == image->width && bm.height() == image->height;
+}
+
+/* Every thread walks the corpus from its own starting point, so the threads
+ * don't decode the same size at the same time */
+static void* batchThread(void* arg)
+{
+    BatchThread* bt = (BatchThread*)arg;
+
+    for (int i = 0; i < bt->count; i++) {
+        const CorpusImage* image = &bt->corpus[(bt->first + i) % bt->images];
+        SkImageDecoder* decoder = SkImageDecoder_HWJPEG_Factory();
+
+        long long start = nowNs();
+        if (!decodeImage(decoder, image)) {
+            bt->failures++;
+        }
+        bt->latency[i] = nowNs() - start;
+        delete decoder;
+    }
+    return NULL;
+}
+
+static long long medianDecode(SkImageDecoder* decoder, const CorpusImage* image, int passes, int* failures)
+{
+    long long latency[passes];
+
+    for (int i = 0; i < passes; i++) {
+        long long start = nowNs();
+        if (!decodeImage(decoder, image)) {
+            (*failures)++;
+        }
+        latency[i] = nowNs() - start;
+    }
+    qsort(latency, passes, sizeof(long long), compareNs);
+    return latency[passes / 2];
+}
+
+/* One image at a time, the hardware has the pool to itself */
+static int timeImages(const CorpusImage* corpus, int images, int passes, FILE* csv)
+{
+    SkImageDecoder* hw = SkImageDecoder_HWJPEG_Factory();
+    SkMemoryStream stream(corpus[0].data, corpus[0].size, false);
+    SkImageDecoder* arm = SkTIJPEGImageDecoderEntry::NewArmDecoder(&stream);
+    int crossover = -1;
+    int failures = 0;
+
+    if (arm == NULL) {
+        delete hw;
+        return 1;
+    }
+
+    PRINT("image          size        bytes   hw us  arm us\n");
+    for (int i = 0; i < images; i++) {
+        const CorpusImage* image = &corpus[i];
+        long long hwNs = medianDecode(hw, image, passes, &failures);
+        long long armNs = medianDecode(arm, image, passes, &failures);
+
+        PRINT("%-6s %5dx%-5d %10u %7lld %7lld%s\n", kKindNames[image->kind], image->width, image->height,
+              (unsigned int)image->size, hwNs / 1000, armNs / 1000, hwNs < armNs ? "  hw" : "");
+        if (csv) {
+            fprintf(csv, "image,%s,%d,%d,%u,%lld,%lld\n", kKindNames[image->kind], image->width,
+                    image->height, (unsigned int)image->size, hwNs / 1000, armNs / 1000);
+        }
+        // the corpus grows in size, the hardware has to win at every 4:2:0 size from here on
+        if (image->kind == KIND_420) {
+            if (hwNs >= armNs) {
+                crossover = -1;
+            } else if (crossover < 0) {
+                crossover = i;
+            }
+        }
+    }
+    if (crossover >= 0) {
+        PRINT("hardware wins from %dx%d up\n", corpus[crossover].width, corpus[crossover].height);
+    } else {
+        PRINT("libjpeg wins at every size\n");
+    }
+
+    delete hw;
+    delete arm;
+    return failures;
+}
+
+static int runBatch(int threads, const CorpusImage* corpus, int images, int passes, FILE* csv)
+{
+    BatchThread bt[MAX_THREADS];
+    int perThread = images * passes;
+    long long* latency = new long long[threads * perThread];
+    SkTIJPEGImageDecoderEntry::PoolStats before, after;
+    MockOMXJpegDecStats mock;
+    pthread_t sampler;
+    size_t heapBase;
+    int failures = 0;
+
+    SkTIJPEGImageDecoderEntry::GetPoolStats(&before);
+    heapBase = heapInUse();
+    gHeapPeak = heapBase;
+    gHeapSampling = true;
+    pthread_create(&sampler, NULL, heapSampler, NULL);
+
+    long long start = nowNs();
+    for (int i = 0; i < threads; i++) {
+        bt[i].corpus = corpus;
+        bt[i].images = images;
+        bt[i].first = i * images / threads;
+        bt[i].count = perThread;
+        bt[i].failures = 0;
+        bt[i].latency = latency + i * perThread;
+        pthread_create(&bt[i].thread, NULL, batchThread, &bt[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(bt[i].thread, NULL);
+        failures += bt[i].failures;
+    }
+    long long elapsed = nowNs() - start;
+
+    gHeapSampling = false;
+    pthread_join(sampler, NULL);
+    SkTIJPEGImageDecoderEntry::GetPoolStats(&after);
+    MockOMXJpegDec_GetStats(&mock);
+
+    int total = threads * perThread;
+    qsort(latency, total, sizeof(long long), compareNs);
+    double rate = elapsed ? total * 1e9 / elapsed : 0.0;
+    unsigned int heapKb = (unsigned int)((gHeapPeak - heapBase) / 1024);
+
+    PRINT("%7d %9.1f %8lld %8lld %8lld %8lld %6u %6u %9u %5d\n", threads, rate,
+          percentile(latency, total, 50) / 1000, percentile(latency, total, 90) / 1000,
+          percentile(latency, total, 99) / 1000, latency[total - 1] / 1000,
+          after.hwDecodes - before.hwDecodes, after.armDecodes - before.armDecodes, heapKb, failures);
+    if (csv) {
+        fprintf(csv, "batch,%d,%d,%.1f,%lld,%lld,%lld,%lld,%u,%u,%u,%u,%d\n", threads, total, rate,
+                percentile(latency, total, 50) / 1000, percentile(latency, total, 90) / 1000,
+                percentile(latency, total, 99) / 1000, latency[total - 1] / 1000,
+                after.hwDecodes - before.hwDecodes, after.armDecodes - before.armDecodes,
+                heapKb, mock.peakInstances, failures);
+    }
+
+    delete[] latency;
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    const char* csvPath = NULL;
+    int maxThreads = 4;
+    int passes = 3;
+    int maxMpix = 5;
+    int engines = 2;
+    int mpixPerSec = 20;
+    int failures = 0;
+    CorpusImage corpus[MAX_CORPUS];
+    FILE* csv = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:n:m:e:r:c:")) != -1) {
+        switch (opt) {
+            case 't': maxThreads = atoi(optarg); break;
+            case 'n': passes = atoi(optarg); break;
+            case 'm': maxMpix = atoi(optarg); break;
+            case 'e': engines = atoi(optarg); break;
+            case 'r': mpixPerSec = atoi(optarg); break;
+            case 'c': csvPath = optarg; break;
+            default:
+                PRINT("usage: %s [-t threads] [-n passes] [-m max Mpix] [-e mock engines] [-r mock Mpix/s]\n"
+                      "       [-c results.csv]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (maxThreads < 1 || maxThreads > MAX_THREADS || passes < 1 || maxMpix < 1) {
+        PRINT("1 to %d threads, at least one pass and 1 Mpix please\n", MAX_THREADS);
+        return 1;
+    }
+
+    if (csvPath != NULL) {
+        csv = strcmp(csvPath, "-") ? fopen(csvPath, "w") : stdout;
+        if (csv == NULL) {
+            PRINT("can't write %s\n", csvPath);
+            return 1;
+        }
+        fprintf(csv, "record,kind,width,height,bytes,hw_us,arm_us\n");
+        fprintf(csv, "record,threads,images,images_per_sec,p50_us,p90_us,p99_us,max_us,hw,arm,heap_peak_kb,peak_instances,failures\n");
+    }
+
+    int images = buildCorpus(corpus, maxMpix);
+    size_t corpusBytes = 0;
+    for (int i = 0; i < images; i++) {
+        corpusBytes += corpus[i].size;
+    }
+
+    MockOMXJpegDec_Configure(engines, mpixPerSec);
+    PRINT("%d images up to %d Mpix, %u KB, %d mock engines at %d Mpix/s\n",
+          images, maxMpix, (unsigned int)(corpusBytes / 1024), engines, mpixPerSec);
+
+    failures += timeImages(corpus, images, passes, csv);
+
+    PRINT("threads  images/s   p50 us   p90 us   p99 us   max us     hw    arm   heap KB  fail\n");
+    for (int threads = 1; ; threads *= 2) {
+        if (threads > maxThreads) {
+            threads = maxThreads;
+        }
+        failures += runBatch(threads, corpus, images, passes, csv);
+        if (threads == maxThreads) {
+            break;
+        }
+    }
+
+    if (csv != NULL && csv != stdout) {
+        fclose(csv);
+    }
+    for (int i = 0; i < images; i++) {
+        free(corpus[i].data);
+    }
+    PRINT("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
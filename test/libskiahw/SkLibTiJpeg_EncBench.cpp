@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file SkLibTiJpeg_EncBench.cpp
+*
+* Runs the libskiahw JPEG encoder against the mock OMX JPEG encoder. Checks
+* that aligned bitmaps reach the DSP without a copy, that the others share
+* one copy buffer per encoder, that the output buffer follows the JPEG sizes
+* and grows when a JPEG does not fit, then times the input paths:
+*
+*   SkLibTiJpeg_EncBench [-w width] [-h height] [-q quality] [-b jpeg bits/pixel] [-n encodes]
+*
+*/
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "SkBitmap.h"
+#include "SkStream.h"
+#include "SkImageEncoder_libtijpeg.h"
+#include "MockOMXJpegEnc.h"
+
+#define PRINT printf
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        PRINT("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+static long long nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* An RGB565 bitmap over caller owned memory, offset bytes past a 128 byte
+ * boundary and with rowBytes of padding at the end of each row */
+static void* setupBitmap(SkBitmap* bm, int w, int h, int offset, int padding)
+{
+    int rowBytes = w * 2 + padding;
+    char* base = (char*)memalign(128, rowBytes * h + offset);
+
+    for (int i = 0; i < rowBytes * h; i++) {
+        base[offset + i] = (char)(i * 7 + i / rowBytes);
+    }
+    bm->setConfig(SkBitmap::kRGB_565_Config, w, h, rowBytes);
+    bm->setPixels(base + offset);
+    return base;
+}
+
+/* Byte sum of the pixels without the row padding, what the DSP should see */
+static unsigned int pixelSum(const SkBitmap& bm)
+{
+    unsigned int sum = 0;
+
+    for (int y = 0; y < bm.height(); y++) {
+        const unsigned char* row = (const unsigned char*)bm.getPixels() + y * bm.rowBytes();
+        for (int x = 0; x < bm.width() * 2; x++) {
+            sum += row[x];
+        }
+    }
+    return sum;
+}
+
+static bool encode(SkTIJPEGImageEncoder* encoder, const SkBitmap& bm, int quality, size_t* size)
+{
+    SkDynamicMemoryWStream stream;
+    bool ok = encoder->onEncode(NULL, &stream, bm, quality);
+
+    *size = stream.getOffset();
+    return ok;
+}
+
+static void checkInputPaths(int w, int h, int quality)
+{
+    SkTIJPEGImageEncoder* encoder = new SkTIJPEGImageEncoder;
+    MockOMXJpegEncStats stats;
+    SkBitmap aligned, unaligned, padded;
+    void* alignedMem = setupBitmap(&aligned, w, h, 0, 0);
+    void* unalignedMem = setupBitmap(&unaligned, w, h, 64, 0);
+    void* paddedMem = setupBitmap(&padded, w, h, 0, 64);
+    const void* copyBuffer;
+    size_t size;
+
+    MockOMXJpegEnc_Configure(2, 1000);
+
+    CHECK(encode(encoder, aligned, quality, &size));
+    MockOMXJpegEnc_GetStats(&stats);
+    CHECK(stats.lastInput == aligned.getPixels());
+    CHECK(stats.lastInputSum == pixelSum(aligned));
+
+    CHECK(encode(encoder, unaligned, quality, &size));
+    MockOMXJpegEnc_GetStats(&stats);
+    CHECK(stats.lastInput != unaligned.getPixels());
+    CHECK(stats.lastInputSum == pixelSum(unaligned));
+    copyBuffer = stats.lastInput;
+
+    // the copy packs the rows and reuses the buffer of the previous copy
+    CHECK(encode(encoder, padded, quality, &size));
+    MockOMXJpegEnc_GetStats(&stats);
+    CHECK(stats.lastInput == copyBuffer);
+    CHECK(stats.lastInputSum == pixelSum(padded));
+
+    // all of it on the first handle
+    CHECK(stats.handles == 1);
+    CHECK(stats.encodes == 3);
+
+    delete encoder;
+    free(alignedMem);
+    free(unalignedMem);
+    free(paddedMem);
+}
+
+static void checkOutputSizing(int w, int h, int quality)
+{
+    SkTIJPEGImageEncoder* encoder = new SkTIJPEGImageEncoder;
+    MockOMXJpegEncStats stats;
+    SkBitmap bm;
+    void* mem = setupBitmap(&bm, w, h, 0, 0);
+    size_t size, firstOutput;
+    unsigned int expected;
+
+    // a typical photo fits the first guess and stays on one handle
+    MockOMXJpegEnc_Configure(2, 1000);
+    expected = 623 + w * h * 2 / 8;
+    CHECK(encode(encoder, bm, quality, &size));
+    CHECK(size == expected);
+    MockOMXJpegEnc_GetStats(&stats);
+    firstOutput = stats.lastOutputSize;
+    CHECK(stats.truncated == 0);
+    CHECK(encode(encoder, bm, quality, &size));
+    CHECK(size == expected);
+    MockOMXJpegEnc_GetStats(&stats);
+    CHECK(stats.handles == 1);
+    PRINT("output buffer %zu bytes for a %u byte JPEG\n", firstOutput, expected);
+
+    // noise doesn't fit, the buffer doubles until the whole JPEG comes out
+    MockOMXJpegEnc_Configure(12, 1000);
+    expected = 623 + w * h * 12 / 8;
+    CHECK(encode(encoder, bm, quality, &size));
+    CHECK(size == expected);
+    MockOMXJpegEnc_GetStats(&stats);
+    CHECK(stats.truncated > 0);
+    CHECK(stats.lastOutputSize >= expected);
+    PRINT("%u byte JPEG after %u retries into %u bytes\n", expected, stats.truncated, stats.lastOutputSize);
+
+    // and the next one at that quality is sized from it
+    MockOMXJpegEnc_Configure(12, 1000);
+    CHECK(encode(encoder, bm, quality, &size));
+    CHECK(size == expected);
+    MockOMXJpegEnc_GetStats(&stats);
+    CHECK(stats.truncated == 0);
+    CHECK(stats.handles == 0);
+
+    delete encoder;
+    free(mem);
+}
+
+static void timeInputPaths(int w, int h, int quality, int bits, int encodes)
+{
+    SkTIJPEGImageEncoder* encoder = new SkTIJPEGImageEncoder;
+    SkBitmap aligned, unaligned;
+    void* alignedMem = setupBitmap(&aligned, w, h, 0, 0);
+    void* unalignedMem = setupBitmap(&unaligned, w, h, 64, 0);
+    size_t frame = w * h * 2;
+    size_t size;
+    long long start, inPlace, copied, legacy;
+
+    // an instant DSP, what is left is the work on the ARM side
+    MockOMXJpegEnc_Configure(bits, 1000000);
+    encode(encoder, aligned, quality, &size);
+
+    start = nowNs();
+    for (int i = 0; i < encodes; i++) {
+        CHECK(encode(encoder, aligned, quality, &size));
+    }
+    inPlace = (nowNs() - start) / encodes;
+
+    start = nowNs();
+    for (int i = 0; i < encodes; i++) {
+        CHECK(encode(encoder, unaligned, quality, &size));
+    }
+    copied = (nowNs() - start) / encodes;
+
+    // what every encode used to add: a fresh buffer, a copy and the free
+    start = nowNs();
+    for (int i = 0; i < encodes; i++) {
+        void* buffer = memalign(128, frame);
+        memcpy(buffer, unaligned.getPixels(), frame);
+        asm volatile("" : : "r"(buffer) : "memory");
+        free(buffer);
+    }
+    legacy = (nowNs() - start) / encodes + copied;
+
+    // the DSP reads the frame once in every case, a copy reads and writes it once more
+    PRINT("%dx%d RGB565, %d encodes, us per encode and bytes of input traffic\n", w, h, encodes);
+    PRINT("in place     %9.1f %12zu\n", inPlace / 1000.0, frame);
+    PRINT("pooled copy  %9.1f %12zu\n", copied / 1000.0, 3 * frame);
+    PRINT("fresh copy   %9.1f %12zu\n", legacy / 1000.0, 3 * frame);
+
+    delete encoder;
+    free(alignedMem);
+    free(unalignedMem);
+}
+
+int main(int argc, char** argv)
+{
+    int w = 2048;
+    int h = 1536;
+    int quality = 90;
+    int bits = 3;
+    int encodes = 20;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:h:q:b:n:")) != -1) {
+        switch (opt) {
+            case 'w': w = atoi(optarg); break;
+            case 'h': h = atoi(optarg); break;
+            case 'q': quality = atoi(optarg); break;
+            case 'b': bits = atoi(optarg); break;
+            case 'n': encodes = atoi(optarg); break;
+            default:
+                PRINT("usage: %s [-w width] [-h height] [-q quality] [-b jpeg bits/pixel] [-n encodes]\n", argv[0]);
+                return 1;
+        }
+    }
+    // below WVGA or odd sizes go to the ARM encoder and never reach the mock
+    if (w % 16 || h % 16 || w * h <= WVGA_RESOLUTION || quality < 1 || quality > 100 || encodes < 1) {
+        PRINT("even sizes in multiples of 16 above WVGA and a quality of 1 to 100 please\n");
+        return 1;
+    }
+
+    checkInputPaths(w, h, quality);
+    checkOutputSizing(w, h, quality);
+    timeInputPaths(w, h, quality, bits, encodes);
+
+    PRINT("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
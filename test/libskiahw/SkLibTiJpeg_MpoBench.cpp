@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file SkLibTiJpeg_MpoBench.cpp
+*
+* Generates MPO files, checks that SkMpoIndex finds every view in both byte
+* orders, and times how long it takes to get to the views through the index
+* against reading up to them one byte at a time, from memory and from a file:
+*
+*   SkLibTiJpeg_MpoBench [-v views] [-s view KB] [-n iterations] [-d dir]
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "SkStream.h"
+#include "SkMpoIndex.h"
+
+#define PRINT printf
+#define MAX_VIEWS 8
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        PRINT("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+static long long nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void put16(OMX_U8* p, OMX_U32 v, bool le)
+{
+    if (le) { p[0] = v; p[1] = v >> 8; } else { p[0] = v >> 8; p[1] = v; }
+}
+
+static void put32(OMX_U8* p, OMX_U32 v, bool le)
+{
+    if (le) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+    else { p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v; }
+}
+
+static OMX_U8* putTag(OMX_U8* p, OMX_U16 id, OMX_U16 type, OMX_U32 count, OMX_U32 value, bool le)
+{
+    put16(p, id, le);
+    put16(p + 2, type, le);
+    put32(p + 4, count, le);
+    put32(p + 8, value, le);
+    return p + 12;
+}
+
+/* A file of 'views' baseline JPEG stand-ins, each viewSize bytes long: SOI,
+ * an APP2 MPF segment (the first one carries the MP index), entropy coded
+ * filler and EOI. Returns the stream offsets of the views in offsets. */
+static OMX_U8* generateMpo(int views, size_t viewSize, bool le, size_t* size, size_t* offsets)
+{
+    const OMX_U32 indexCount = 3;
+    const OMX_U32 app2Length = 2 + 4 + 8 + 2 + indexCount * 12 + 4 + views * 16;
+    OMX_U8* file;
+
+    *size = views * viewSize;
+    file = (OMX_U8*)malloc(*size);
+    memset(file, 0x5A, *size);
+
+    for (int v = 0; v < views; v++) {
+        OMX_U8* view = file + v * viewSize;
+        offsets[v] = v * viewSize;
+        view[0] = 0xFF; view[1] = 0xD8;
+        view[viewSize - 2] = 0xFF; view[viewSize - 1] = 0xD9;
+    }
+
+    // the MP index of the first view, offsets relative to its byte order mark
+    OMX_U8* p = file + 2;
+    OMX_U8* ref;
+    p[0] = 0xFF; p[1] = 0xE2;
+    put16(p + 2, app2Length, false);
+    memcpy(p + 4, "MPF", 4);
+    ref = p + 8;
+    ref[0] = ref[1] = le ? 0x49 : 0x4D;
+    put16(ref + 2, 0x2A, le);
+    put32(ref + 4, 8, le);
+
+    p = ref + 8;
+    put16(p, indexCount, le);
+    p += 2;
+    p = putTag(p, TAGID_MPFVERSION, TAG_TYPE_UNDEFINED, 4, 0x30303130, le);
+    p = putTag(p, TAGID_NIMAGES, TAG_TYPE_LONG, 1, views, le);
+    p = putTag(p, TAGID_MPENTRY, TAG_TYPE_UNDEFINED, views * 16, (p + 12 + 4) - ref, le);
+    put32(p, 0, le);
+    p += 4;
+
+    size_t refOffset = ref - file;
+    for (int v = 0; v < views; v++, p += 16) {
+        put32(p, v ? 0x020002 : 0x20020002, le);
+        put32(p + 4, viewSize, le);
+        put32(p + 8, v ? offsets[v] - refOffset : 0, le);
+        put16(p + 12, 0, le);
+        put16(p + 14, 0, le);
+    }
+    return file;
+}
+
+/* How the decoder used to find a view */
+static bool seekBytewise(SkStream* stream, size_t offset)
+{
+    stream->rewind();
+    for (size_t j = 0; j < offset; j++) {
+        stream->read(NULL, 1);
+    }
+    return stream->readU8() == 0xFF && stream->readU8() == 0xD8;
+}
+
+static bool parseIndex(const OMX_U8* file, MP_FIELDS_SUPPORTED* fields)
+{
+    OMX_U32 length = (file[4] << 8) | file[5];
+    // the segment body follows SOI, the marker and the length
+    return SkMpoIndex::Parse(file + 6, length - 2, 6, fields);
+}
+
+static void checkIndex(int views, size_t viewSize, bool le)
+{
+    MP_FIELDS_SUPPORTED fields;
+    size_t offsets[MAX_VIEWS];
+    size_t size;
+    OMX_U8* file = generateMpo(views, viewSize, le, &size, offsets);
+
+    memset(&fields, 0, sizeof(fields));
+    CHECK(parseIndex(file, &fields));
+    CHECK(SkMpoIndex::Views(&fields) == views);
+
+    SkMemoryStream stream(file, size);
+    for (int v = 0; v < views; v++) {
+        CHECK(SkMpoIndex::ViewOffset(&fields, v) == offsets[v]);
+        CHECK(SkMpoIndex::ViewLength(&fields, v) == viewSize);
+
+        SkMpoViewStream view(&stream, offsets[v], viewSize);
+        CHECK(view.isValid());
+        CHECK(view.getLength() == viewSize);
+        // a rewind stays inside the view and reads stop at its end
+        CHECK(view.skip(viewSize + 100) == viewSize);
+        CHECK(view.rewind() && view.readU8() == 0xFF && view.readU8() == 0xD8);
+    }
+
+    // a truncated index is refused rather than read past
+    OMX_U32 length = (file[4] << 8) | file[5];
+    CHECK(!SkMpoIndex::Parse(file + 6, length - 2 - 16 * views + 8, 6, &fields));
+    CHECK(fields.MPEntry == NULL);
+
+    SkMpoIndex::Free(&fields);
+    free(file);
+}
+
+static void timeSeeks(const char* name, SkStream* stream, const MP_FIELDS_SUPPORTED* fields,
+                      const size_t* offsets, int views, int iterations)
+{
+    long long start, bytewise, indexed;
+    int ok = 0;
+
+    start = nowNs();
+    for (int i = 0; i < iterations; i++) {
+        for (int v = 1; v < views; v++) {
+            ok += seekBytewise(stream, offsets[v]);
+        }
+    }
+    bytewise = (nowNs() - start) / iterations;
+
+    start = nowNs();
+    for (int i = 0; i < iterations; i++) {
+        for (int v = 1; v < views; v++) {
+            SkMpoViewStream view(stream, SkMpoIndex::ViewOffset(fields, v), SkMpoIndex::ViewLength(fields, v));
+            ok += view.isValid();
+        }
+    }
+    indexed = (nowNs() - start) / iterations;
+
+    CHECK(ok == 2 * iterations * (views - 1));
+    PRINT("%-8s %12.1f %12.1f %9.0fx\n", name, bytewise / 1000.0, indexed / 1000.0,
+          (double)bytewise / (indexed ? indexed : 1));
+}
+
+int main(int argc, char** argv)
+{
+    const char* dir = "/tmp";
+    int views = 2;
+    int viewKb = 2048;
+    int iterations = 5;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "v:s:n:d:")) != -1) {
+        switch (opt) {
+            case 'v': views = atoi(optarg); break;
+            case 's': viewKb = atoi(optarg); break;
+            case 'n': iterations = atoi(optarg); break;
+            case 'd': dir = optarg; break;
+            default:
+                PRINT("usage: %s [-v views] [-s view KB] [-n iterations] [-d dir]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (views < 2 || views > MAX_VIEWS || viewKb < 1 || iterations < 1) {
+        PRINT("2 to %d views of at least 1 KB please\n", MAX_VIEWS);
+        return 1;
+    }
+
+    checkIndex(views, 4096, true);
+    checkIndex(views, 4096, false);
+
+    size_t offsets[MAX_VIEWS];
+    size_t size;
+    MP_FIELDS_SUPPORTED fields;
+    OMX_U8* file = generateMpo(views, viewKb * 1024, false, &size, offsets);
+
+    memset(&fields, 0, sizeof(fields));
+    CHECK(parseIndex(file, &fields));
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/SkLibTiJpeg_MpoBench.mpo", dir);
+    FILE* f = fopen(path, "wb");
+    if (f == NULL || fwrite(file, 1, size, f) != size) {
+        PRINT("can't write %s\n", path);
+        return 1;
+    }
+    fclose(f);
+
+    PRINT("%d views of %d KB, us to reach views 2..%d\n", views, viewKb, views);
+    PRINT("stream       bytewise      indexed   speedup\n");
+
+    SkMemoryStream memory(file, size);
+    timeSeeks("memory", &memory, &fields, offsets, views, iterations);
+
+    SkFILEStream fileStream(path);
+    timeSeeks("file", &fileStream, &fields, offsets, views, iterations);
+
+    unlink(path);
+    SkMpoIndex::Free(&fields);
+    free(file);
+
+    PRINT("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
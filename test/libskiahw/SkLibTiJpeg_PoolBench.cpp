@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file SkLibTiJpeg_PoolBench.cpp
+*
+* Decodes the same JPEG from 1, 2, 4 ... N threads through the libskiahw
+* decoder pool, running against the mock OMX JPEG component, and reports
+* how throughput scales and how many decodes went to the hardware pool or
+* to the ARM fallback:
+*
+*   SkLibTiJpeg_PoolBench [-i file.jpg] [-t threads] [-n images] [-e engines] [-r mpix/s] [-p ms]
+*                         [-R x,y,w,h] [-k KB/s]
+*
+* The pool size and queue depth come from debug.skiahw.jpegdec.instances
+* and debug.skiahw.jpegdec.queue as in any other process. -p idles between
+* the runs so the lifetime manager gets to release decoders, which shows up
+* as cold starts in the next run. -R decodes only that region of the image
+* through buildTileIndex() and decodeRegion(). -k reads the JPEG from a
+* stream that delivers that many KB/s and compares feeding the decoder in
+* chunks while the stream is read against reading the whole stream first
+* (debug.skiahw.jpegdec.chunk=0).
+*
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "SkBitmap.h"
+#include "SkStream.h"
+#include "SkImageDecoder.h"
+#include "SkImageEncoder.h"
+#include "SkTime.h"
+#include "SkImageDecoder_libtijpeg_entry.h"
+#include "SkImageDecoder_libtijpeg.h"
+#include "MockOMXJpegDec.h"
+
+#define PRINT printf
+#define MAX_THREADS 16
+#define SLOW_STREAM_BLOCK 16384
+
+typedef struct BenchThread
+{
+    pthread_t thread;
+    const void* jpeg;
+    size_t jpegSize;
+    int images;
+    int sampleSize;
+    SkIRect region;
+    int failures;
+    SkMSec* latency;
+} BenchThread;
+
+/* A memory stream that takes its time, like a slow card or a network */
+class SlowStream : public SkMemoryStream {
+public:
+    SlowStream(const void* data, size_t length, int kbPerSec)
+        : SkMemoryStream(data, length), fKbPerSec(kbPerSec) {}
+
+    virtual size_t read(void* buffer, size_t size) {
+        if (buffer == NULL) {
+            // lengths and skips are free
+            return SkMemoryStream::read(buffer, size);
+        }
+        if (size > SLOW_STREAM_BLOCK) {
+            size = SLOW_STREAM_BLOCK;
+        }
+        size = SkMemoryStream::read(buffer, size);
+        usleep((unsigned long long)size * 1000 / 1024 * 1000 / fKbPerSec);
+        return size;
+    }
+
+private:
+    int fKbPerSec;
+};
+
+static int compareMSec(const void* a, const void* b)
+{
+    return (int)*(const SkMSec*)a - (int)*(const SkMSec*)b;
+}
+
+static void* decodeThread(void* arg)
+{
+    BenchThread* bt = (BenchThread*)arg;
+
+    for (int i = 0; i < bt->images; i++) {
+        SkMemoryStream stream(bt->jpeg, bt->jpegSize);
+        SkImageDecoder* decoder = SkImageDecoder_HWJPEG_Factory();
+        SkBitmap bm;
+
+        decoder->setSampleSize(bt->sampleSize);
+        SkMSec start = SkTime::GetMSecs();
+        if (!bt->region.isEmpty()) {
+            // the decoder owns a tile index stream
+            SkMemoryStream* tileStream = new SkMemoryStream(bt->jpeg, bt->jpegSize);
+            int width, height;
+
+            if (!decoder->buildTileIndex(tileStream, &width, &height) ||
+                !decoder->decodeRegion(&bm, bt->region, SkBitmap::kRGB_565_Config) ||
+                bm.width() > bt->region.width() || bm.height() > bt->region.height()) {
+                bt->failures++;
+            }
+        } else if (!decoder->decode(&stream, &bm, SkBitmap::kRGB_565_Config, SkImageDecoder::kDecodePixels_Mode)) {
+            bt->failures++;
+        }
+        bt->latency[i] = SkTime::GetMSecs() - start;
+        delete decoder;
+    }
+    return NULL;
+}
+
+/* A gradient frame encoded by libskia, so no input file is needed */
+static void* encodeTestImage(int width, int height, size_t* size)
+{
+    SkBitmap bm;
+    SkDynamicMemoryWStream stream;
+
+    bm.setConfig(SkBitmap::kARGB_8888_Config, width, height);
+    if (!bm.allocPixels()) {
+        return NULL;
+    }
+    for (int y = 0; y < height; y++) {
+        uint32_t* row = bm.getAddr32(0, y);
+        for (int x = 0; x < width; x++) {
+            row[x] = SkPackARGB32(0xFF, x * 255 / width, y * 255 / height, (x ^ y) & 0xFF);
+        }
+    }
+
+    if (!SkImageEncoder::EncodeStream(&stream, bm, SkImageEncoder::kJPEG_Type, 90)) {
+        return NULL;
+    }
+
+    *size = stream.getOffset();
+    void* data = malloc(*size);
+    stream.copyTo(data);
+    return data;
+}
+
+static void* readFile(const char* path, size_t* size)
+{
+    SkFILEStream file(path);
+
+    if (!file.isValid()) {
+        return NULL;
+    }
+    *size = file.getLength();
+    void* data = malloc(*size);
+    if (file.read(data, *size) != *size) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+static void runThreads(int threads, const void* jpeg, size_t jpegSize, int images, int sampleSize,
+                       const SkIRect& region)
+{
+    BenchThread bt[MAX_THREADS];
+    SkMSec* latency = new SkMSec[threads * images];
+    SkTIJPEGImageDecoderEntry::PoolStats before, after;
+    MockOMXJpegDecStats mock;
+    int failures = 0;
+
+    SkTIJPEGImageDecoderEntry::GetPoolStats(&before);
+
+    SkMSec start = SkTime::GetMSecs();
+    for (int i = 0; i < threads; i++) {
+        bt[i].jpeg = jpeg;
+        bt[i].jpegSize = jpegSize;
+        bt[i].images = images;
+        bt[i].sampleSize = sampleSize;
+        bt[i].region = region;
+        bt[i].failures = 0;
+        bt[i].latency = latency + i * images;
+        pthread_create(&bt[i].thread, NULL, decodeThread, &bt[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(bt[i].thread, NULL);
+        failures += bt[i].failures;
+    }
+    SkMSec elapsed = SkTime::GetMSecs() - start;
+
+    SkTIJPEGImageDecoderEntry::GetPoolStats(&after);
+    MockOMXJpegDec_GetStats(&mock);
+
+    int total = threads * images;
+    qsort(latency, total, sizeof(SkMSec), compareMSec);
+
+    PRINT("%7d %9.1f %6u %6u %6u %6u %7u %7u %8u %5d\n",
+          threads, elapsed ? total * 1000.0 / elapsed : 0.0,
+          latency[total / 2], latency[total * 99 / 100], latency[total - 1],
+          after.hwDecodes - before.hwDecodes, after.armDecodes - before.armDecodes,
+          after.queuedDecodes - before.queuedDecodes,
+          (unsigned int)(after.maxQueueWait / 1000000), failures);
+    PRINT("        mock: %u handles, %u decodes, peak %u instances, peak %u concurrent decodes\n",
+          mock.handles, mock.decodes, mock.peakInstances, mock.peakDecodes);
+    // releases happen between the runs, so these are totals
+    PRINT("        lifetime: %u warm, %u cold, %u released idle, %u under pressure, keep warm %u ms\n",
+          after.lifetime.warmHits, after.lifetime.coldStarts, after.lifetime.released,
+          after.lifetime.pressureReleased, (unsigned int)(after.lifetime.idleTimeout / 1000000));
+
+    delete[] latency;
+}
+
+static SkMSec timeStream(const void* jpeg, size_t jpegSize, int images, int kbPerSec, const char* chunk)
+{
+    SkMSec total = 0;
+
+    setenv("debug_skiahw_jpegdec_chunk", chunk, 1);
+    for (int i = 0; i < images; i++) {
+        SlowStream stream(jpeg, jpegSize, kbPerSec);
+        // outside the pool, the chunk size is read when a decoder is created
+        SkImageDecoder* entry = SkImageDecoder_HWJPEG_Factory();
+        SkTIJPEGImageDecoder* decoder = new SkTIJPEGImageDecoder;
+        SkBitmap bm;
+
+        SkMSec start = SkTime::GetMSecs();
+        if (!decoder->onDecode(entry, &stream, &bm, SkBitmap::kRGB_565_Config, SkImageDecoder::kDecodePixels_Mode)) {
+            PRINT("decode from a %d KB/s stream failed with chunk %s\n", kbPerSec, chunk);
+        }
+        total += SkTime::GetMSecs() - start;
+        delete decoder;
+        delete entry;
+    }
+    unsetenv("debug_skiahw_jpegdec_chunk");
+    return total / images;
+}
+
+/* The mock takes in the compressed data as fast as the stream delivers it, so
+ * reading ahead one chunk can hide at most the slower of the two */
+static void compareStreaming(const void* jpeg, size_t jpegSize, int images, int kbPerSec)
+{
+    MockOMXJpegDecStats mock;
+    SkMSec chunked, whole;
+    unsigned int chunkedBytes;
+
+    MockOMXJpegDec_ConfigureInput(kbPerSec);
+
+    MockOMXJpegDec_Configure(1, 1000);
+    chunked = timeStream(jpeg, jpegSize, images, kbPerSec, "128");
+    MockOMXJpegDec_GetStats(&mock);
+    chunkedBytes = mock.peakInputBytes;
+
+    MockOMXJpegDec_Configure(1, 1000);
+    whole = timeStream(jpeg, jpegSize, images, kbPerSec, "0");
+    MockOMXJpegDec_GetStats(&mock);
+
+    PRINT("%d KB/s stream and input, ms per decode and input buffer bytes\n", kbPerSec);
+    PRINT("chunked  %6u %9u\n", chunked, chunkedBytes);
+    PRINT("whole    %6u %9u\n", whole, mock.peakInputBytes);
+
+    MockOMXJpegDec_ConfigureInput(0);
+}
+
+int main(int argc, char** argv)
+{
+    const char* input = NULL;
+    int maxThreads = 4;
+    int images = 20;
+    int engines = 2;
+    int mpixPerSec = 20;
+    int width = 1600;
+    int height = 1200;
+    int sampleSize = 1;
+    int pauseMs = 0;
+    int kbPerSec = 0;
+    SkIRect region;
+    int x, y, w, h;
+    size_t jpegSize = 0;
+    void* jpeg;
+    int opt;
+
+    region.set(0, 0, 0, 0);
+    while ((opt = getopt(argc, argv, "i:t:n:e:r:w:h:s:p:R:k:")) != -1) {
+        switch (opt) {
+            case 'i': input = optarg; break;
+            case 't': maxThreads = atoi(optarg); break;
+            case 'n': images = atoi(optarg); break;
+            case 'e': engines = atoi(optarg); break;
+            case 'r': mpixPerSec = atoi(optarg); break;
+            case 'w': width = atoi(optarg); break;
+            case 'h': height = atoi(optarg); break;
+            case 's': sampleSize = atoi(optarg); break;
+            case 'p': pauseMs = atoi(optarg); break;
+            case 'k': kbPerSec = atoi(optarg); break;
+            case 'R':
+                if (sscanf(optarg, "%d,%d,%d,%d", &x, &y, &w, &h) == 4) {
+                    region.set(x, y, x + w, y + h);
+                }
+                break;
+            default:
+                PRINT("usage: %s [-i file.jpg] [-t threads] [-n images per thread] [-e mock engines]\n"
+                      "       [-r mock Mpix/s] [-w width] [-h height] [-s sample size] [-p pause ms]\n"
+                      "       [-R region x,y,w,h] [-k stream KB/s]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (maxThreads < 1 || maxThreads > MAX_THREADS || images < 1) {
+        PRINT("1 to %d threads and at least one image please\n", MAX_THREADS);
+        return 1;
+    }
+
+    jpeg = input ? readFile(input, &jpegSize) : encodeTestImage(width, height, &jpegSize);
+    if (jpeg == NULL) {
+        PRINT("no input image\n");
+        return 1;
+    }
+
+    MockOMXJpegDec_Configure(engines, mpixPerSec);
+    PRINT("%s, %u bytes, sample size %d, %d mock engines at %d Mpix/s\n",
+          input ? input : "generated", (unsigned int)jpegSize, sampleSize, engines, mpixPerSec);
+    if (!region.isEmpty()) {
+        PRINT("region %dx%d at %d,%d\n", region.width(), region.height(), region.fLeft, region.fTop);
+    }
+    PRINT("threads  images/s  p50ms  p99ms  maxms     hw     arm  queued maxwaitms  fail\n");
+
+    for (int threads = 1; ; threads *= 2) {
+        if (threads > maxThreads) {
+            threads = maxThreads;
+        }
+        runThreads(threads, jpeg, jpegSize, images, sampleSize, region);
+        if (threads == maxThreads) {
+            break;
+        }
+        usleep(pauseMs * 1000);
+    }
+
+    if (kbPerSec > 0) {
+        compareStreaming(jpeg, jpegSize, images, kbPerSec);
+    }
+
+    free(jpeg);
+    return 0;
+}
@@ -776,34 +776,17 @@ int runJPEGDecoderTest(int argc, char** argv) {
     /*check which decoder handle is chosen by the Factory()*/
     flagCodecType = findJPGDType(&inStream);
 
-#ifdef TARGET_OMAP4
-    if( CODECTYPE_SIMCOP == flagCodecType ) {
-        if( bSubRegDecFlag ){
-            //TBD:Implement the subregion decode parameter setting for SIMCOP JPEG decoder here.
-            PRINT("%s():%d:: !!!! Currently SIMCOP JPEG Decoder is not fully functional...\n",__FUNCTION__,__LINE__);
-            PRINT("%s():%d:: !!!! Select SW JPG decoder and run subregion decode tests.\n",__FUNCTION__,__LINE__);
-            return FAIL;
-        }
-    }
-
-#else  //OMAP3
-    if( CODECTYPE_DSP == flagCodecType ) {
-        /*set the subregion decode parameters*/
-        if ( ((SkTIJPEGImageDecoderEntry*)skJpegDec)->SetJpegDecParams((SkTIJPEGImageDecoderEntry::JpegDecoderParams*) &jpegDecParams ) == false ) {
-            PRINT("%s():%d:: !!!! skJpegDec->SetJpegDecodeParameters returned false..\n",__FUNCTION__,__LINE__);
-        }
-    }
-#endif
-
 #ifdef TIME_MEASUREMENT
     {
     AutoTimeMicros atm("Decode Time Measurement:");
 #endif
 
-    //gingerbread- SW(ARM) subregion decode supported
-    if( CODECTYPE_SW == flagCodecType && bSubRegDecFlag ){
+    //subregion decode through the tile index, the hardware decoders support it too
+    if( bSubRegDecFlag ){
         int ht = 0, wd = 0;
 
+        /* the decoder releases the tile index stream, keep ours alive */
+        inStream.ref();
         if( skJpegDec->buildTileIndex(&inStream, &wd, &ht) == false ) {
             PRINT("%s():%d:: !!!! skJpegDec->buildTileIndex() returned false..\n",__FUNCTION__,__LINE__);
             PRINT("%s():%d:: !!!! Test Failed..\n",__FUNCTION__,__LINE__);
@@ -817,7 +800,7 @@ int runJPEGDecoderTest(int argc, char** argv) {
             return FAIL;
         }
     }
-    else {  //if !(CODECTYPE_SW == flagCodecType && bSubRegDecFlag )
+    else {  //if !bSubRegDecFlag
 
         /*call decode*/
         if (skJpegDec->decode(&inStream, &skBM, prefConfig, SkImageDecoder::kDecodePixels_Mode) == false) {
@@ -0,0 +1,69 @@
+LOCAL_PATH:= $(call my-dir)
+
+################################################
+# YuvConvert checks against the old renderer conversions and timings,
+# on the host and on the target where the NEON kernels run
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    YuvConvert_Test.cpp \
+    ../../libtiutils/YuvConvert.cpp \
+    ../../libtiutils/YuvConvert_neon.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/libtiutils
+
+LOCAL_MODULE := YuvConvert_HostTest
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := YuvConvert_Test.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/libtiutils
+
+LOCAL_STATIC_LIBRARIES := libtiutils_yuv
+
+LOCAL_MODULE := YuvConvert_Test
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
+
+################################################
+# OverlayBufferIndex against the linear search the renderers used to do
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    OverlayBufferIndex_Test.cpp \
+    ../../libtiutils/OverlayBufferIndex.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/libtiutils
+
+LOCAL_MODULE := OverlayBufferIndex_HostTest
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := OverlayBufferIndex_Test.cpp
+
+LOCAL_C_INCLUDES += \
+    hardware/ti/omap3/libtiutils
+
+LOCAL_STATIC_LIBRARIES := libtiutils_yuv
+
+LOCAL_MODULE := OverlayBufferIndex_Test
+LOCAL_MODULE_TAGS:= optional
+
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file OverlayBufferIndex_Test.cpp
+*
+* Checks the overlay buffer index of the renderers against a linear search
+* over buffers registered out of address order and times both lookups:
+*
+*   OverlayBufferIndex_Test [-b buffers] [-n lookups]
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "OverlayBufferIndex.h"
+
+using namespace android;
+
+#define PRINT printf
+#define PAGE 4096
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        PRINT("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+static long long nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* the loop the renderers used to run for every frame */
+static int linearLookup(uint8_t* const* bases, size_t length, int count, const uint8_t* p)
+{
+    for (int i = 0; i < count; i++) {
+        if (p >= bases[i] && (size_t)(p - bases[i]) < length)
+            return i;
+    }
+    return -1;
+}
+
+int main(int argc, char** argv)
+{
+    int buffers = 8;
+    int lookups = 1000000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:n:")) != -1) {
+        switch (opt) {
+            case 'b': buffers = atoi(optarg); break;
+            case 'n': lookups = atoi(optarg); break;
+            default:
+                PRINT("usage: %s [-b buffers] [-n lookups]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (buffers < 1 || buffers > OverlayBufferIndex::MAX_BUFFERS) {
+        PRINT("1 to %d buffers\n", (int)OverlayBufferIndex::MAX_BUFFERS);
+        return 1;
+    }
+
+    // one arena with a page gap after every buffer, handed out from the top down
+    const size_t length = 16 * PAGE;
+    uint8_t* arena = (uint8_t*)malloc((length + PAGE) * buffers);
+    uint8_t* bases[OverlayBufferIndex::MAX_BUFFERS];
+    OverlayBufferIndex index;
+
+    for (int i = 0; i < buffers; i++)
+        bases[i] = arena + (length + PAGE) * (buffers - 1 - i);
+
+    CHECK(index.lookup(arena) == -1);
+    for (int i = 0; i < buffers; i++)
+        CHECK(index.add(i, bases[i], length));
+    CHECK(index.size() == buffers);
+
+    // out of order, overlapping and empty registrations are refused
+    CHECK(!index.add(buffers + 1, arena, length));
+    CHECK(!index.add(buffers, bases[0] + PAGE, PAGE));
+    CHECK(!index.add(buffers, bases[0] - PAGE / 2, PAGE));
+    CHECK(!index.add(buffers, bases[0] + length, 0));
+    CHECK(index.size() == buffers);
+
+    // every page of every buffer and the gaps between them, in frame order and shuffled
+    for (int pass = 0; pass < 2; pass++) {
+        for (int n = 0; n < buffers; n++) {
+            int i = pass ? (n * 7) % buffers : n;
+            for (size_t off = 0; off < length + PAGE; off += PAGE / 2) {
+                const uint8_t* p = bases[i] + off;
+                size_t found = (size_t)-1;
+                int expected = linearLookup(bases, length, buffers, p);
+                CHECK(index.lookup(p, &found) == expected);
+                if (expected >= 0)
+                    CHECK(found == off);
+            }
+            CHECK(index.lookup(bases[i] + length - 1) == i);
+        }
+    }
+    CHECK(index.lookup(arena - 1) == -1);
+
+    index.clear();
+    CHECK(index.size() == 0 && index.lookup(bases[0]) == -1);
+    for (int i = 0; i < buffers; i++)
+        index.add(i, bases[i], length);
+
+    // frames come back in the order the decoder got the buffers, with a crop offset
+    volatile int sink = 0;
+    long long t0 = nowNs();
+    for (int n = 0; n < lookups; n++)
+        sink += linearLookup(bases, length, buffers, bases[n % buffers] + 2 * PAGE + 32);
+    long long t1 = nowNs();
+    for (int n = 0; n < lookups; n++)
+        sink += index.lookup(bases[n % buffers] + 2 * PAGE + 32);
+    long long t2 = nowNs();
+    for (int n = 0; n < lookups; n++)
+        sink += index.lookup(bases[(n * 7) % buffers] + 2 * PAGE + 32);
+    long long t3 = nowNs();
+
+    PRINT("%d buffers, ns per lookup: linear %.1f, in order %.1f, shuffled %.1f\n", buffers,
+          (double)(t1 - t0) / lookups, (double)(t2 - t1) / lookups, (double)(t3 - t2) / lookups);
+
+    free(arena);
+    PRINT("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
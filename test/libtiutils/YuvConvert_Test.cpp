@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/**
+* @file YuvConvert_Test.cpp
+*
+* Checks every available YuvConvert implementation byte for byte against
+* the conversions the video renderers used to carry, then against the scalar
+* implementation for crops and strides, and times them all:
+*
+*   YuvConvert_Test [-w width] [-h height] [-n frames]
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "YuvConvert.h"
+
+using namespace android;
+
+#define PRINT printf
+#define PAGE 4096
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        PRINT("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    }
+
+static const YuvConvert::Impl kImpls[] = {
+    YuvConvert::IMPL_SCALAR, YuvConvert::IMPL_WORD, YuvConvert::IMPL_NEON
+};
+
+static long long nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* --- what the renderers did before ------------------------------------------ */
+
+// libstagefrighthw, OMAP4
+static void legacyYuv420ToNV12(int width, int height, const void *src, void *dst)
+{
+    uint32_t stride = 4096;
+    uint8_t* p1y = (uint8_t*) src;
+    uint8_t* p2y = (uint8_t*) dst;
+    for (int i = 0; i < height; i++) {
+        memcpy(p2y + i * stride, p1y + i * width, width);
+    }
+
+    uint8_t* p2uv = (uint8_t*) dst + stride * height;
+    uint8_t* p1u = ((uint8_t*) src + (width * height));
+    uint8_t* p1v = ((uint8_t*) p1u + ((width / 2) * (height / 2)));
+    for (int i = 0; i < height / 2; i++) {
+        for (int j = 0, j1 = 0; j < width / 2; j++, j1 += 2) {
+            p2uv[j1] = p1u[j];
+            p2uv[j1 + 1] = p1v[j];
+        }
+        p2uv += stride;
+        p1u += width / 2;
+        p1v += width / 2;
+    }
+}
+
+// libstagefrighthw, OMAP3: UYVY, rows width * 2 apart
+static void legacyYuv420ToUYVY(int width, int height, const void *src, void *dst)
+{
+    int pixelCount = height * width;
+    int srcLineLength = width / 4;
+    int destLineLength = width / 2;
+    uint32_t* ySrc = (uint32_t*) src;
+    const uint16_t* uSrc = (const uint16_t*) ((uint8_t*)src + pixelCount);
+    const uint16_t* vSrc = (const uint16_t*) ((uint8_t*)uSrc + (pixelCount >> 2));
+    uint32_t *p = (uint32_t*) dst;
+
+    for (int i = 0; i < height; i += 2) {
+        for (int j = 0; j < srcLineLength; j++) {
+            uint32_t y0 = ySrc[0];
+            uint32_t y1 = ySrc[srcLineLength];
+            ySrc++;
+            uint32_t u = *uSrc++;
+            uint32_t v = *vSrc++;
+            uint32_t uv = (u | (v << 16)) & 0x00ff00ff;
+            p[0] = ((y0 & 0xff) << 8) | ((y0 & 0xff00) << 16) | uv;
+            p[destLineLength] = ((y1 & 0xff) << 8) | ((y1 & 0xff00) << 16) | uv;
+            p++;
+            uv = ((u >> 8) | (v << 8)) & 0x00ff00ff;
+            p[0] = ((y0 >> 8) & 0xff00) | (y0 & 0xff000000) | uv;
+            p[destLineLength] = ((y1 >> 8) & 0xff00) | (y1 & 0xff000000) | uv;
+            p++;
+        }
+        ySrc += srcLineLength;
+        p += destLineLength;
+    }
+}
+
+// libopencorehw: YUYV, rows on 4 KB boundaries
+static void legacyYuv420pToYuv422i(int width, int height, void* src, void* dst)
+{
+    uint32_t pixelCount = height * width;
+    uint8_t* ySrc = (uint8_t*) src;
+    uint8_t* uSrc = (uint8_t*) ((uint8_t*)src + pixelCount);
+    uint8_t* vSrc = (uint8_t*) ((uint8_t*)src + pixelCount + pixelCount/4);
+    uint8_t *p = (uint8_t*) dst;
+    uint32_t page_width = (width * 2 + 4096 - 1) & ~(4096 - 1);
+
+    for (int i = 0; i < height; i += 2) {
+        for (int j = 0; j < width; j += 2) {
+            *(uint32_t *)(p) = ((((uint32_t)(ySrc[1] << 16)) | (uint32_t)(ySrc[0])) & 0x00ff00ff) |
+                               ((((uint32_t)(*uSrc << 8)) | (uint32_t)(*vSrc << 24)) & 0xff00ff00);
+            *(uint32_t *)(p + page_width) = ((((uint32_t)(ySrc[width + 1] << 16)) | (uint32_t)(ySrc[width])) & 0x00ff00ff) |
+                                            ((((uint32_t)(*uSrc++ << 8)) | (uint32_t)(*vSrc++ << 24)) & 0xff00ff00);
+            p += 4;
+            ySrc += 2;
+        }
+        ySrc += width;
+        p += 2 * page_width - width * 2;
+    }
+}
+
+/* --- checks ----------------------------------------------------------------- */
+
+static uint8_t* randomFrame(size_t size, unsigned int seed)
+{
+    uint8_t* frame = (uint8_t*)malloc(size);
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        frame[i] = seed >> 24;
+    }
+    return frame;
+}
+
+static size_t pitch422(int width)
+{
+    return (width * 2 + PAGE - 1) & ~(PAGE - 1);
+}
+
+static void checkAgainstLegacy(int width, int height)
+{
+    uint8_t* src = randomFrame(width * height * 3 / 2, width * 31 + height);
+    size_t nv12Size = PAGE * height * 3 / 2;
+    size_t yuyvSize = pitch422(width) * height;
+    size_t uyvySize = width * 2 * height;
+    uint8_t* expected = (uint8_t*)calloc(1, nv12Size + yuyvSize);
+    uint8_t* actual = (uint8_t*)calloc(1, nv12Size + yuyvSize);
+    YuvPlanarFrame frame = YuvConvert::Contiguous(src, width, height);
+
+    for (unsigned int i = 0; i < sizeof(kImpls) / sizeof(kImpls[0]); i++) {
+        if (YuvConvert::Select(kImpls[i]) != kImpls[i]) {
+            continue;
+        }
+
+        // the padding between rows has to stay as it was too
+        memset(expected, 0xA5, nv12Size);
+        memset(actual, 0xA5, nv12Size);
+        legacyYuv420ToNV12(width, height, src, expected);
+        YuvConvert::I420ToNV12(frame, 0, 0, width, height, actual, actual + PAGE * height, PAGE);
+        CHECK(memcmp(expected, actual, nv12Size) == 0);
+
+        memset(expected, 0xA5, yuyvSize);
+        memset(actual, 0xA5, yuyvSize);
+        legacyYuv420pToYuv422i(width, height, src, expected);
+        YuvConvert::I420ToPacked422(frame, 0, 0, width, height, actual, pitch422(width), YuvConvert::ORDER_YUYV);
+        CHECK(memcmp(expected, actual, yuyvSize) == 0);
+
+        if (width % 4 == 0) {
+            legacyYuv420ToUYVY(width, height, src, expected);
+            YuvConvert::I420ToPacked422(frame, 0, 0, width, height, actual, width * 2, YuvConvert::ORDER_UYVY);
+            CHECK(memcmp(expected, actual, uyvySize) == 0);
+        }
+    }
+
+    free(src);
+    free(expected);
+    free(actual);
+}
+
+/* A crop out of a frame with padded strides, every implementation against scalar */
+static void checkCrop(int width, int height, int left, int top, int cropWidth, int cropHeight)
+{
+    uint32_t yStride = width + 40;
+    uint32_t uvStride = width / 2 + 24;
+    uint8_t* planes = randomFrame(yStride * height + 2 * uvStride * height / 2, left * 7 + top);
+    YuvPlanarFrame frame;
+    uint32_t dstStride = cropWidth * 2 + 64;
+    size_t dstSize = dstStride * cropHeight * 2;
+    uint8_t* reference = (uint8_t*)malloc(dstSize);
+    uint8_t* actual = (uint8_t*)malloc(dstSize);
+
+    frame.y = planes;
+    frame.u = planes + yStride * height;
+    frame.v = frame.u + uvStride * height / 2;
+    frame.yStride = yStride;
+    frame.uvStride = uvStride;
+
+    for (int order = YuvConvert::ORDER_YUYV; order <= YuvConvert::ORDER_UYVY + 1; order++) {
+        bool nv12 = order > YuvConvert::ORDER_UYVY;
+
+        memset(reference, 0x5A, dstSize);
+        YuvConvert::Select(YuvConvert::IMPL_SCALAR);
+        if (nv12) {
+            YuvConvert::I420ToNV12(frame, left, top, cropWidth, cropHeight, reference,
+                                   reference + dstStride * cropHeight, dstStride);
+        } else {
+            YuvConvert::I420ToPacked422(frame, left, top, cropWidth, cropHeight, reference, dstStride,
+                                        (YuvConvert::PackedOrder)order);
+        }
+        // spot check the scalar reference itself, top left chroma of the crop
+        const uint8_t* u = frame.u + (top / 2) * uvStride + left / 2;
+        const uint8_t* y = frame.y + top * yStride + left;
+        if (nv12) {
+            CHECK(reference[0] == y[0] && reference[dstStride * cropHeight] == u[0]);
+        } else if (order == YuvConvert::ORDER_YUYV) {
+            CHECK(reference[0] == y[0] && reference[1] == u[0] && reference[dstStride + 1] == u[0]);
+        } else {
+            CHECK(reference[0] == u[0] && reference[1] == y[0] && reference[dstStride + 1] == y[yStride]);
+        }
+
+        for (unsigned int i = 1; i < sizeof(kImpls) / sizeof(kImpls[0]); i++) {
+            if (YuvConvert::Select(kImpls[i]) != kImpls[i]) {
+                continue;
+            }
+            memset(actual, 0x5A, dstSize);
+            if (nv12) {
+                YuvConvert::I420ToNV12(frame, left, top, cropWidth, cropHeight, actual,
+                                       actual + dstStride * cropHeight, dstStride);
+            } else {
+                YuvConvert::I420ToPacked422(frame, left, top, cropWidth, cropHeight, actual, dstStride,
+                                            (YuvConvert::PackedOrder)order);
+            }
+            CHECK(memcmp(reference, actual, dstSize) == 0);
+        }
+    }
+
+    free(planes);
+    free(reference);
+    free(actual);
+}
+
+/* --- timing ----------------------------------------------------------------- */
+
+static void timeConversions(int width, int height, int frames)
+{
+    uint8_t* src = randomFrame(width * height * 3 / 2, 1);
+    uint8_t* dst = (uint8_t*)malloc(PAGE * height * 2);
+    YuvPlanarFrame frame = YuvConvert::Contiguous(src, width, height);
+    long long start;
+
+    PRINT("%dx%d, us per frame\n", width, height);
+    PRINT("            nv12    yuyv    uyvy\n");
+
+    start = nowNs();
+    for (int f = 0; f < frames; f++) {
+        legacyYuv420ToNV12(width, height, src, dst);
+    }
+    long long nv12 = (nowNs() - start) / frames;
+    start = nowNs();
+    for (int f = 0; f < frames; f++) {
+        legacyYuv420pToYuv422i(width, height, src, dst);
+    }
+    long long yuyv = (nowNs() - start) / frames;
+    start = nowNs();
+    for (int f = 0; f < frames; f++) {
+        legacyYuv420ToUYVY(width, height, src, dst);
+    }
+    long long uyvy = (nowNs() - start) / frames;
+    PRINT("legacy  %7lld %7lld %7lld\n", nv12 / 1000, yuyv / 1000, uyvy / 1000);
+
+    for (unsigned int i = 0; i < sizeof(kImpls) / sizeof(kImpls[0]); i++) {
+        if (YuvConvert::Select(kImpls[i]) != kImpls[i]) {
+            PRINT("%-7s not available\n", YuvConvert::Name(kImpls[i]));
+            continue;
+        }
+        start = nowNs();
+        for (int f = 0; f < frames; f++) {
+            YuvConvert::I420ToNV12(frame, 0, 0, width, height, dst, dst + PAGE * height, PAGE);
+        }
+        nv12 = (nowNs() - start) / frames;
+        start = nowNs();
+        for (int f = 0; f < frames; f++) {
+            YuvConvert::I420ToPacked422(frame, 0, 0, width, height, dst, pitch422(width), YuvConvert::ORDER_YUYV);
+        }
+        yuyv = (nowNs() - start) / frames;
+        start = nowNs();
+        for (int f = 0; f < frames; f++) {
+            YuvConvert::I420ToPacked422(frame, 0, 0, width, height, dst, width * 2, YuvConvert::ORDER_UYVY);
+        }
+        uyvy = (nowNs() - start) / frames;
+        PRINT("%-7s %7lld %7lld %7lld\n", YuvConvert::Name(kImpls[i]), nv12 / 1000, yuyv / 1000, uyvy / 1000);
+    }
+    PRINT("auto picks %s\n", YuvConvert::Name(YuvConvert::Select(YuvConvert::IMPL_AUTO)));
+
+    free(src);
+    free(dst);
+}
+
+int main(int argc, char** argv)
+{
+    int width = 1280;
+    int height = 720;
+    int frames = 50;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:h:n:")) != -1) {
+        switch (opt) {
+            case 'w': width = atoi(optarg); break;
+            case 'h': height = atoi(optarg); break;
+            case 'n': frames = atoi(optarg); break;
+            default:
+                PRINT("usage: %s [-w width] [-h height] [-n frames]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (width < 2 || height < 2 || width % 2 || height % 2 || width * 2 > PAGE || frames < 1) {
+        PRINT("even sizes up to %d pixels wide please\n", PAGE / 2);
+        return 1;
+    }
+
+    // sizes that leave tails for every kernel width
+    checkAgainstLegacy(176, 144);
+    checkAgainstLegacy(320, 240);
+    checkAgainstLegacy(854, 480);
+    checkAgainstLegacy(1280, 720);
+    checkAgainstLegacy(1920, 1080);
+    checkAgainstLegacy(width, height);
+
+    checkCrop(640, 480, 0, 0, 640, 480);
+    checkCrop(640, 480, 2, 2, 636, 476);
+    checkCrop(640, 480, 34, 18, 102, 62);
+    checkCrop(720, 576, 8, 0, 706, 570);
+
+    timeConversions(width, height, frames);
+
+    PRINT("%d failures\n", failures);
+    return failures ? 1 : 0;
+}